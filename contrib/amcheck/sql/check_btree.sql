@@ -164,6 +164,18 @@ INSERT INTO varlena_bug VALUES (repeat('Test', 250));
 ALTER TABLE varlena_bug ALTER COLUMN v SET STORAGE extended;
 SELECT bt_index_check('varlena_bug_idx', true);
 
+-- Check pivot tuples whose final attribute was truncated within its datum,
+-- both during CREATE INDEX and during page splits
+CREATE TABLE prefix_trunc (t text COLLATE "C", b bytea);
+INSERT INTO prefix_trunc SELECT 'https://www.example.com/some/long/path/' || i,
+  '\x00010203040506070809'::bytea || int4send(i) FROM generate_series(1, 10000) i;
+CREATE INDEX prefix_trunc_t_idx ON prefix_trunc (t);
+CREATE INDEX prefix_trunc_b_idx ON prefix_trunc (b);
+INSERT INTO prefix_trunc SELECT 'https://www.example.com/some/long/path/' || i,
+  '\x00010203040506070809'::bytea || int4send(i) FROM generate_series(10001, 20000) i;
+SELECT bt_index_parent_check('prefix_trunc_t_idx', true, true);
+SELECT bt_index_parent_check('prefix_trunc_b_idx', true, true);
+
 -- cleanup
 DROP TABLE bttest_a;
 DROP TABLE bttest_b;
@@ -175,3 +187,4 @@ DROP TABLE bttest_unique_nulls;
 DROP OWNED BY regress_bttest_role; -- permissions
 DROP ROLE regress_bttest_role;
 DROP TABLE varlena_bug;
+DROP TABLE prefix_trunc;
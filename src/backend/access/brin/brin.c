@@ -278,6 +278,7 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuildempty = brinbuildempty;
 	amroutine->aminsert = brininsert;
 	amroutine->aminsertcleanup = brininsertcleanup;
+	amroutine->aminsertbatch = NULL;
 	amroutine->ambulkdelete = brinbulkdelete;
 	amroutine->amvacuumcleanup = brinvacuumcleanup;
 	amroutine->amcanreturn = NULL;
@@ -65,6 +65,7 @@ ginhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuildempty = ginbuildempty;
 	amroutine->aminsert = gininsert;
 	amroutine->aminsertcleanup = NULL;
+	amroutine->aminsertbatch = NULL;
 	amroutine->ambulkdelete = ginbulkdelete;
 	amroutine->amvacuumcleanup = ginvacuumcleanup;
 	amroutine->amcanreturn = NULL;
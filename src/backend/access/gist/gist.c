@@ -87,6 +87,7 @@ gisthandler(PG_FUNCTION_ARGS)
 	amroutine->ambuildempty = gistbuildempty;
 	amroutine->aminsert = gistinsert;
 	amroutine->aminsertcleanup = NULL;
+	amroutine->aminsertbatch = NULL;
 	amroutine->ambulkdelete = gistbulkdelete;
 	amroutine->amvacuumcleanup = gistvacuumcleanup;
 	amroutine->amcanreturn = gistcanreturn;
@@ -85,6 +85,7 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuildempty = hashbuildempty;
 	amroutine->aminsert = hashinsert;
 	amroutine->aminsertcleanup = NULL;
+	amroutine->aminsertbatch = NULL;
 	amroutine->ambulkdelete = hashbulkdelete;
 	amroutine->amvacuumcleanup = hashvacuumcleanup;
 	amroutine->amcanreturn = NULL;
@@ -425,6 +425,59 @@ heap_setscanlimits(TableScanDesc sscan, BlockNumber startBlk, BlockNumber numBlk
 	scan->rs_numblocks = numBlks;
 }
 
+/*
+ * Visibility check for heap_prepare_pagescan() on a page that isn't
+ * all-visible, with a regular MVCC snapshot.  The tuples are checked all at
+ * once with HeapTupleSatisfiesMVCCBatch(), so that each inserting or deleting
+ * transaction has to be looked up only once per page.
+ */
+static int
+page_collect_tuples_mvcc(HeapScanDesc scan, Snapshot snapshot,
+						 Page page, Buffer buffer,
+						 BlockNumber block, int lines,
+						 bool check_serializable)
+{
+	HeapTupleData tuples[MaxHeapTuplesPerPage];
+	bool		visible[MaxHeapTuplesPerPage];
+	int			ntups = 0;
+	int			nvistup = 0;
+	OffsetNumber lineoff;
+
+	for (lineoff = FirstOffsetNumber; lineoff <= lines; lineoff++)
+	{
+		ItemId		lpp = PageGetItemId(page, lineoff);
+		HeapTuple	loctup = &tuples[ntups];
+
+		if (!ItemIdIsNormal(lpp))
+			continue;
+
+		loctup->t_data = (HeapTupleHeader) PageGetItem(page, lpp);
+		loctup->t_len = ItemIdGetLength(lpp);
+		loctup->t_tableOid = RelationGetRelid(scan->rs_base.rs_rd);
+		ItemPointerSet(&(loctup->t_self), block, lineoff);
+		ntups++;
+	}
+
+	(void) HeapTupleSatisfiesMVCCBatch(snapshot, buffer, ntups, tuples,
+									   visible);
+
+	for (int i = 0; i < ntups; i++)
+	{
+		if (check_serializable)
+			HeapCheckForSerializableConflictOut(visible[i],
+												scan->rs_base.rs_rd,
+												&tuples[i], buffer, snapshot);
+
+		if (visible[i])
+			scan->rs_vistuples[nvistup++] =
+				ItemPointerGetOffsetNumber(&tuples[i].t_self);
+	}
+
+	Assert(nvistup <= MaxHeapTuplesPerPage);
+
+	return nvistup;
+}
+
 /*
  * Per-tuple loop for heap_prepare_pagescan(). Pulled out so it can be called
  * multiple times, with constant arguments for all_visible,
@@ -440,6 +493,10 @@ page_collect_tuples(HeapScanDesc scan, Snapshot snapshot,
 	int			ntup = 0;
 	OffsetNumber lineoff;
 
+	if (!all_visible && snapshot->snapshot_type == SNAPSHOT_MVCC)
+		return page_collect_tuples_mvcc(scan, snapshot, page, buffer,
+										block, lines, check_serializable);
+
 	for (lineoff = FirstOffsetNumber; lineoff <= lines; lineoff++)
 	{
 		ItemId		lpp = PageGetItemId(page, lineoff);
@@ -2175,15 +2232,12 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 					CommandId cid, int options)
 {
 	/*
-	 * To allow parallel inserts, we need to ensure that they are safe to be
-	 * performed in workers. We have the infrastructure to allow parallel
-	 * inserts in general except for the cases where inserts generate a new
-	 * CommandId (eg. inserts into a table having a foreign key column).
+	 * Parallel workers may insert on behalf of the leader, which assigned the
+	 * transaction ID and command ID before the parallel operation began.
+	 * Inserts that would generate a new CommandId (eg. inserts into a table
+	 * having a foreign key column) are kept out of workers by the planner,
+	 * and CommandCounterIncrement() refuses them anyway.
 	 */
-	if (IsParallelWorker())
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
-				 errmsg("cannot insert tuples in a parallel worker")));
 
 	tup->t_data->t_infomask &= ~(HEAP_XACT_MASK);
 	tup->t_data->t_infomask2 &= ~(HEAP2_XACT_MASK);
@@ -39,6 +39,8 @@
  *
  *	 HeapTupleSatisfiesMVCC()
  *		  visible to supplied snapshot, excludes current command
+ *	 HeapTupleSatisfiesMVCCBatch()
+ *		  like HeapTupleSatisfiesMVCC(), for all tuples of a page at once
  *	 HeapTupleSatisfiesUpdate()
  *		  visible to instant snapshot, with user-supplied command
  *		  counter and more complex result
@@ -1144,6 +1146,174 @@ HeapTupleSatisfiesMVCC(HeapTuple htup, Snapshot snapshot,
 	return false;
 }
 
+/*
+ * Status of a transaction, as resolved by HeapTupleSatisfiesMVCCBatch().
+ */
+typedef enum
+{
+	BATCH_XID_UNKNOWN,			/* our own, or in progress per the snapshot */
+	BATCH_XID_COMMITTED,		/* committed, hint bit may be set */
+	BATCH_XID_COMMITTED_NOHINT, /* committed, but commit record not flushed */
+	BATCH_XID_ABORTED,			/* aborted or crashed */
+} BatchXidStatus;
+
+/*
+ * Number of recently resolved XIDs remembered by HeapTupleSatisfiesMVCCBatch().
+ * Tuples on a page are typically inserted by few transactions, often in runs,
+ * so a small window is enough to catch nearly all duplicates without
+ * degenerating into a quadratic search on pages with many distinct XIDs.
+ */
+#define BATCH_XID_WINDOW	8
+
+typedef struct BatchXidCache
+{
+	TransactionId xids[BATCH_XID_WINDOW];
+	BatchXidStatus status[BATCH_XID_WINDOW];
+	int			nxids;
+	int			next;
+} BatchXidCache;
+
+/*
+ * Resolve the status of xid for HeapTupleSatisfiesMVCCBatch(), reusing an
+ * earlier result for the same XID if there is one.
+ *
+ * The checks are made in the same order as in HeapTupleSatisfiesMVCC(), and
+ * the commit LSN test mirrors SetHintBits().
+ */
+static BatchXidStatus
+BatchResolveXid(BatchXidCache *cache, TransactionId xid,
+				Snapshot snapshot, Buffer buffer)
+{
+	BatchXidStatus status;
+
+	for (int i = 0; i < cache->nxids; i++)
+	{
+		if (cache->xids[i] == xid)
+			return cache->status[i];
+	}
+
+	if (TransactionIdIsCurrentTransactionId(xid) ||
+		XidInMVCCSnapshot(xid, snapshot))
+		status = BATCH_XID_UNKNOWN;
+	else if (TransactionIdDidCommit(xid))
+	{
+		XLogRecPtr	commitLSN = TransactionIdGetCommitLSN(xid);
+
+		if (BufferIsPermanent(buffer) && XLogNeedsFlush(commitLSN) &&
+			BufferGetLSNAtomic(buffer) < commitLSN)
+			status = BATCH_XID_COMMITTED_NOHINT;
+		else
+			status = BATCH_XID_COMMITTED;
+	}
+	else
+		status = BATCH_XID_ABORTED;
+
+	cache->xids[cache->next] = xid;
+	cache->status[cache->next] = status;
+	cache->next = (cache->next + 1) % BATCH_XID_WINDOW;
+	if (cache->nxids < BATCH_XID_WINDOW)
+		cache->nxids++;
+
+	return status;
+}
+
+/*
+ * HeapTupleSatisfiesMVCCBatch
+ *		Determine the visibility of a number of tuples on the same page.
+ *
+ * This is equivalent to calling HeapTupleSatisfiesMVCC() for each of the
+ * tuples, storing the results in visible[], but is cheaper when many of them
+ * lack hint bits, as is typical for the first scan after a bulk load.  In a
+ * first pass, the status of each distinct unhinted xmin and xmax is looked up
+ * only once, and all hint bits that can be set are set at once, dirtying the
+ * buffer only a single time.  The visibility of each tuple is then decided
+ * by HeapTupleSatisfiesMVCC(), which for hinted tuples needs no further
+ * lookups.
+ *
+ * Tuples whose hint bits can't be set, e.g. ones modified by our own or
+ * by in-progress transactions, simply go through the regular code path.
+ * Multixacts and pre-9.0 moved tuples are left to it as well.
+ *
+ * Returns the number of visible tuples.
+ */
+int
+HeapTupleSatisfiesMVCCBatch(Snapshot snapshot, Buffer buffer,
+							int ntups, HeapTupleData *tuples, bool *visible)
+{
+	BatchXidCache cache;
+	bool		hinted = false;
+	int			nvisible = 0;
+
+	Assert(snapshot->snapshot_type == SNAPSHOT_MVCC);
+
+	cache.nxids = 0;
+	cache.next = 0;
+
+	for (int i = 0; i < ntups; i++)
+	{
+		HeapTupleHeader tuple = tuples[i].t_data;
+		uint16		infomask = 0;
+
+		if (!HeapTupleHeaderXminCommitted(tuple) &&
+			!HeapTupleHeaderXminInvalid(tuple) &&
+			!(tuple->t_infomask & HEAP_MOVED))
+		{
+			switch (BatchResolveXid(&cache, HeapTupleHeaderGetRawXmin(tuple),
+									snapshot, buffer))
+			{
+				case BATCH_XID_COMMITTED:
+					infomask |= HEAP_XMIN_COMMITTED;
+					break;
+				case BATCH_XID_ABORTED:
+					/* the tuple is dead, no need to look at xmax */
+					tuple->t_infomask |= HEAP_XMIN_INVALID;
+					hinted = true;
+					continue;
+				case BATCH_XID_UNKNOWN:
+				case BATCH_XID_COMMITTED_NOHINT:
+					break;
+			}
+		}
+
+		if (!(tuple->t_infomask & (HEAP_XMAX_INVALID | HEAP_XMAX_COMMITTED |
+								   HEAP_XMAX_IS_MULTI)) &&
+			!HEAP_XMAX_IS_LOCKED_ONLY(tuple->t_infomask))
+		{
+			switch (BatchResolveXid(&cache, HeapTupleHeaderGetRawXmax(tuple),
+									snapshot, buffer))
+			{
+				case BATCH_XID_COMMITTED:
+					infomask |= HEAP_XMAX_COMMITTED;
+					break;
+				case BATCH_XID_ABORTED:
+					infomask |= HEAP_XMAX_INVALID;
+					break;
+				case BATCH_XID_UNKNOWN:
+				case BATCH_XID_COMMITTED_NOHINT:
+					break;
+			}
+		}
+
+		if (infomask != 0)
+		{
+			tuple->t_infomask |= infomask;
+			hinted = true;
+		}
+	}
+
+	if (hinted)
+		MarkBufferDirtyHint(buffer, true);
+
+	for (int i = 0; i < ntups; i++)
+	{
+		visible[i] = HeapTupleSatisfiesMVCC(&tuples[i], snapshot, buffer);
+		if (visible[i])
+			nvisible++;
+	}
+
+	return nvisible;
+}
+
 
 /*
  * HeapTupleSatisfiesVacuum
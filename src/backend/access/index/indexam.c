@@ -247,6 +247,49 @@ index_insert_cleanup(Relation indexRelation,
 		indexRelation->rd_indam->aminsertcleanup(indexRelation, indexInfo);
 }
 
+/* ----------------
+ *		index_insert_batch - insert many index tuples
+ *
+ * values[i], isnull[i] and heap_tids[i] describe the i'th tuple, and
+ * is_unique[i] is set to what index_insert() would return for it.  Access
+ * methods that don't provide aminsertbatch get one aminsert call per tuple.
+ * ----------------
+ */
+void
+index_insert_batch(Relation indexRelation,
+				   int ntuples,
+				   Datum **values,
+				   bool **isnull,
+				   ItemPointer heap_tids,
+				   Relation heapRelation,
+				   IndexUniqueCheck checkUnique,
+				   bool *is_unique,
+				   IndexInfo *indexInfo)
+{
+	int			i;
+
+	RELATION_CHECKS;
+
+	if (indexRelation->rd_indam->aminsertbatch == NULL)
+	{
+		for (i = 0; i < ntuples; i++)
+			is_unique[i] = index_insert(indexRelation, values[i], isnull[i],
+										&heap_tids[i], heapRelation,
+										checkUnique, false, indexInfo);
+		return;
+	}
+
+	if (!(indexRelation->rd_indam->ampredlocks))
+		CheckForSerializableConflictIn(indexRelation,
+									   (ItemPointer) NULL,
+									   InvalidBlockNumber);
+
+	indexRelation->rd_indam->aminsertbatch(indexRelation, ntuples,
+										   values, isnull, heap_tids,
+										   heapRelation, checkUnique,
+										   is_unique, indexInfo);
+}
+
 /*
  * index_beginscan - start a scan of an index with amgettuple
  *
@@ -30,8 +30,17 @@
 #define BTREE_FASTPATH_MIN_LEVEL	2
 
 
+static bool _bt_doinsert_internal(Relation rel, IndexTuple itup,
+								  BTScanInsert itup_key,
+								  IndexUniqueCheck checkUnique,
+								  bool indexUnchanged, Relation heapRel,
+								  BlockNumber *leafhint);
+static int	_bt_batch_item_cmp(const void *a, const void *b, void *arg);
 static BTStack _bt_search_insert(Relation rel, Relation heaprel,
-								 BTInsertState insertstate);
+								 BTInsertState insertstate,
+								 BlockNumber leafhint);
+static bool _bt_search_insert_hint(Relation rel, BTInsertState insertstate,
+								   BlockNumber leafhint);
 static TransactionId _bt_check_unique(Relation rel, BTInsertState insertstate,
 									  Relation heapRel,
 									  IndexUniqueCheck checkUnique, bool *is_unique,
@@ -103,15 +112,146 @@ _bt_doinsert(Relation rel, IndexTuple itup,
 			 IndexUniqueCheck checkUnique, bool indexUnchanged,
 			 Relation heapRel)
 {
-	bool		is_unique = false;
-	BTInsertStateData insertstate;
 	BTScanInsert itup_key;
-	BTStack		stack;
-	bool		checkingunique = (checkUnique != UNIQUE_CHECK_NO);
+	bool		is_unique;
 
 	/* we need an insertion scan key to do our search, so build one */
 	itup_key = _bt_mkscankey(rel, itup);
 
+	is_unique = _bt_doinsert_internal(rel, itup, itup_key, checkUnique,
+									  indexUnchanged, heapRel, NULL);
+
+	pfree(itup_key);
+
+	return is_unique;
+}
+
+/*
+ * Item of a batch of tuples inserted by _bt_doinsert_batch()
+ */
+typedef struct BTInsertBatchItem
+{
+	IndexTuple	itup;
+	BTScanInsert itup_key;
+	int			position;		/* index in caller's arrays */
+} BTInsertBatchItem;
+
+/*
+ *	_bt_doinsert_batch() -- Handle insertion of a batch of index tuples.
+ *
+ *		This routine is called by the public interface routine,
+ *		btinsertbatch.  The tuples are inserted in index key order, and the
+ *		insertion of each tuple first tries the leaf page that the previous
+ *		tuple was inserted on before searching the tree from the root page.
+ *		When many of the tuples belong on the same leaf pages, this saves
+ *		most of the descents.
+ *
+ *		is_unique[i] is set to the _bt_doinsert() result for itups[i].
+ */
+void
+_bt_doinsert_batch(Relation rel, IndexTuple *itups, int ntuples,
+				   IndexUniqueCheck checkUnique, bool *is_unique,
+				   Relation heapRel)
+{
+	BTInsertBatchItem *items;
+	BlockNumber leafhint = InvalidBlockNumber;
+	int			i;
+
+	items = palloc(ntuples * sizeof(BTInsertBatchItem));
+	for (i = 0; i < ntuples; i++)
+	{
+		items[i].itup = itups[i];
+		items[i].itup_key = _bt_mkscankey(rel, itups[i]);
+		items[i].position = i;
+	}
+
+	if (ntuples > 1)
+		qsort_arg(items, ntuples, sizeof(BTInsertBatchItem),
+				  _bt_batch_item_cmp, NULL);
+
+	for (i = 0; i < ntuples; i++)
+	{
+		bool		result;
+
+		CHECK_FOR_INTERRUPTS();
+
+		result = _bt_doinsert_internal(rel, items[i].itup, items[i].itup_key,
+									   checkUnique, false, heapRel,
+									   &leafhint);
+		is_unique[items[i].position] = result;
+
+		pfree(items[i].itup_key);
+	}
+
+	pfree(items);
+}
+
+/*
+ * qsort_arg comparator for sorting BTInsertBatchItems in index order
+ *
+ * This compares the insertion scan keys of the items the same way
+ * _bt_compare() compares a scan key to an index tuple.
+ */
+static int
+_bt_batch_item_cmp(const void *a, const void *b, void *arg)
+{
+	const BTInsertBatchItem *itema = (const BTInsertBatchItem *) a;
+	const BTInsertBatchItem *itemb = (const BTInsertBatchItem *) b;
+	BTScanInsert keya = itema->itup_key;
+	BTScanInsert keyb = itemb->itup_key;
+	int			i;
+
+	Assert(keya->keysz == keyb->keysz);
+
+	for (i = 0; i < keya->keysz; i++)
+	{
+		ScanKey		ska = &keya->scankeys[i];
+		ScanKey		skb = &keyb->scankeys[i];
+		int32		result;
+
+		if (ska->sk_flags & SK_ISNULL)
+		{
+			if (skb->sk_flags & SK_ISNULL)
+				continue;
+			result = (ska->sk_flags & SK_BT_NULLS_FIRST) ? -1 : 1;
+		}
+		else if (skb->sk_flags & SK_ISNULL)
+			result = (ska->sk_flags & SK_BT_NULLS_FIRST) ? 1 : -1;
+		else
+		{
+			result = DatumGetInt32(FunctionCall2Coll(&ska->sk_func,
+													 ska->sk_collation,
+													 ska->sk_argument,
+													 skb->sk_argument));
+			if (ska->sk_flags & SK_BT_DESC)
+				INVERT_COMPARE_RESULT(result);
+		}
+
+		if (result != 0)
+			return result;
+	}
+
+	return ItemPointerCompare(&itema->itup->t_tid, &itemb->itup->t_tid);
+}
+
+/*
+ *	_bt_doinsert_internal() -- Workhorse for _bt_doinsert and
+ *		_bt_doinsert_batch.
+ *
+ *		If leafhint is not NULL, it is the block number of a leaf page to try
+ *		before searching the tree (or InvalidBlockNumber), and is set to the
+ *		leaf page that the tuple is inserted on.
+ */
+static bool
+_bt_doinsert_internal(Relation rel, IndexTuple itup, BTScanInsert itup_key,
+					  IndexUniqueCheck checkUnique, bool indexUnchanged,
+					  Relation heapRel, BlockNumber *leafhint)
+{
+	bool		is_unique = false;
+	BTInsertStateData insertstate;
+	BTStack		stack;
+	bool		checkingunique = (checkUnique != UNIQUE_CHECK_NO);
+
 	if (checkingunique)
 	{
 		if (!itup_key->anynullkeys)
@@ -164,7 +304,8 @@ search:
 	 * searching from the root page.  insertstate.buf will hold a buffer that
 	 * is locked in exclusive mode afterwards.
 	 */
-	stack = _bt_search_insert(rel, heapRel, &insertstate);
+	stack = _bt_search_insert(rel, heapRel, &insertstate,
+							  leafhint ? *leafhint : InvalidBlockNumber);
 
 	/*
 	 * checkingunique inserts are not allowed to go ahead when two tuples with
@@ -257,6 +398,8 @@ search:
 		 */
 		newitemoff = _bt_findinsertloc(rel, &insertstate, checkingunique,
 									   indexUnchanged, stack, heapRel);
+		if (leafhint)
+			*leafhint = BufferGetBlockNumber(insertstate.buf);
 		_bt_insertonpg(rel, heapRel, itup_key, insertstate.buf, InvalidBuffer,
 					   stack, itup, insertstate.itemsz, newitemoff,
 					   insertstate.postingoff, false);
@@ -270,7 +413,6 @@ search:
 	/* be tidy */
 	if (stack)
 		_bt_freestack(stack);
-	pfree(itup_key);
 
 	return is_unique;
 }
@@ -312,14 +454,24 @@ search:
  * rightmost page (we give up if we'd have to wait for the lock).  We assume
  * that it isn't useful to apply the optimization when there is contention,
  * since each per-backend cache won't stay valid for long.
+ *
+ * Callers inserting a batch of tuples in key order can also pass the leaf
+ * page that the previous tuple went to as leafhint.  It is used the same way
+ * as the rightmost leaf page cache, see _bt_search_insert_hint().
  */
 static BTStack
-_bt_search_insert(Relation rel, Relation heaprel, BTInsertState insertstate)
+_bt_search_insert(Relation rel, Relation heaprel, BTInsertState insertstate,
+				  BlockNumber leafhint)
 {
 	Assert(insertstate->buf == InvalidBuffer);
 	Assert(!insertstate->bounds_valid);
 	Assert(insertstate->postingoff == 0);
 
+	if (BlockNumberIsValid(leafhint) &&
+		leafhint != RelationGetTargetBlock(rel) &&
+		_bt_search_insert_hint(rel, insertstate, leafhint))
+		return NULL;
+
 	if (RelationGetTargetBlock(rel) != InvalidBlockNumber)
 	{
 		/* Simulate a _bt_getbuf() call with conditional locking */
@@ -381,6 +533,64 @@ _bt_search_insert(Relation rel, Relation heaprel, BTInsertState insertstate)
 					  BT_WRITE);
 }
 
+/*
+ *	_bt_search_insert_hint() -- Try to insert on a known leaf page
+ *
+ * Returns true if the leaf page leafhint is where the new tuple belongs and
+ * can fit it without a page split, in which case insertstate->buf is set to
+ * the page, write-locked and pinned.  Otherwise returns false.
+ *
+ * Like the rightmost leaf page fastpath, we cannot return a descent stack for
+ * the page, so we must be sure that _bt_findinsertloc() won't have to step
+ * right or split the page.  The former is guaranteed by requiring the
+ * insertion scan key to be strictly between the first data item and the high
+ * key of the page (which also makes the page the first one the value could
+ * be on for a checkingunique inserter), and by not applying this to
+ * !heapkeyspace indexes.  The lock is acquired conditionally for the same
+ * reason as in the fastpath.
+ */
+static bool
+_bt_search_insert_hint(Relation rel, BTInsertState insertstate,
+					   BlockNumber leafhint)
+{
+	BTScanInsert itup_key = insertstate->itup_key;
+	Buffer		buf;
+	Page		page;
+	BTPageOpaque opaque;
+
+	if (!itup_key->heapkeyspace)
+		return false;
+
+	buf = ReadBuffer(rel, leafhint);
+	if (!_bt_conditionallockbuf(rel, buf))
+	{
+		ReleaseBuffer(buf);
+		return false;
+	}
+
+	_bt_checkpage(rel, buf);
+	page = BufferGetPage(buf);
+	opaque = BTPageGetOpaque(page);
+
+	if (P_ISLEAF(opaque) &&
+		!P_IGNORE(opaque) &&
+		!P_INCOMPLETE_SPLIT(opaque) &&
+		PageGetFreeSpace(page) > insertstate->itemsz &&
+		PageGetMaxOffsetNumber(page) >= P_FIRSTDATAKEY(opaque) &&
+		(P_LEFTMOST(opaque) ||
+		 _bt_compare(rel, itup_key, page, P_FIRSTDATAKEY(opaque)) > 0) &&
+		(P_RIGHTMOST(opaque) ||
+		 _bt_compare(rel, itup_key, page, P_HIKEY) < 0))
+	{
+		insertstate->buf = buf;
+		return true;
+	}
+
+	_bt_relbuf(rel, buf);
+
+	return false;
+}
+
 /*
  *	_bt_check_unique() -- Check for violation of unique index constraint
  *
@@ -131,6 +131,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->ambuildempty = btbuildempty;
 	amroutine->aminsert = btinsert;
 	amroutine->aminsertcleanup = NULL;
+	amroutine->aminsertbatch = btinsertbatch;
 	amroutine->ambulkdelete = btbulkdelete;
 	amroutine->amvacuumcleanup = btvacuumcleanup;
 	amroutine->amcanreturn = btcanreturn;
@@ -202,6 +203,37 @@ btinsert(Relation rel, Datum *values, bool *isnull,
 	return result;
 }
 
+/*
+ *	btinsertbatch() -- insert a batch of index tuples into a btree.
+ *
+ *		Like btinsert(), but the tuples are inserted in key order so that
+ *		runs of tuples that go to the same leaf page need only one descent
+ *		of the tree.
+ */
+void
+btinsertbatch(Relation rel, int ntuples, Datum **values, bool **isnull,
+			  ItemPointer ht_ctids, Relation heapRel,
+			  IndexUniqueCheck checkUnique, bool *is_unique,
+			  IndexInfo *indexInfo)
+{
+	IndexTuple *itups;
+	int			i;
+
+	/* generate the index tuples */
+	itups = palloc(ntuples * sizeof(IndexTuple));
+	for (i = 0; i < ntuples; i++)
+	{
+		itups[i] = index_form_tuple(RelationGetDescr(rel), values[i], isnull[i]);
+		itups[i]->t_tid = ht_ctids[i];
+	}
+
+	_bt_doinsert_batch(rel, itups, ntuples, checkUnique, is_unique, heapRel);
+
+	for (i = 0; i < ntuples; i++)
+		pfree(itups[i]);
+	pfree(itups);
+}
+
 /*
  *	btgettuple() -- Get the next tuple in the scan.
  */
@@ -328,7 +360,13 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	BTScanPosInvalidate(so->currPos);
 	BTScanPosInvalidate(so->markPos);
 	if (scan->numberOfKeys > 0)
-		so->keyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
+	{
+		/* Leave room for skip array keys added by preprocessing */
+		so->keyData = (ScanKey)
+			palloc((scan->numberOfKeys +
+					IndexRelationGetNumberOfKeyAttributes(rel)) *
+				   sizeof(ScanKeyData));
+	}
 	else
 		so->keyData = NULL;
 
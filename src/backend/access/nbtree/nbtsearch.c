@@ -887,6 +887,7 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	BTScanInsertData inskey;
 	ScanKey		startKeys[INDEX_MAX_KEYS];
 	ScanKeyData notnullkeys[INDEX_MAX_KEYS];
+	ScanKeyData skipkeys[INDEX_MAX_KEYS];
 	int			keysz = 0;
 	int			i;
 	StrategyNumber strat_total;
@@ -1120,6 +1121,33 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 				impliesNN = NULL;
 			}
 
+			/*
+			 * A skip array key that isn't positioned on an actual value can
+			 * only be used as a boundary when it's just past the value that
+			 * the scan saw last (in the current scan direction).  We then
+			 * use a > (or <) key on that value.  A skip array at -inf or
+			 * +inf provides no boundary for this attr.
+			 */
+			if (cur->sk_flags & SK_BT_SKIP_SENTINEL)
+			{
+				ScanKey		skipkey;
+
+				Assert(cur->sk_flags & SK_BT_SKIP);
+				Assert(cur->sk_strategy == BTEqualStrategyNumber);
+				if (ScanDirectionIsForward(dir) ?
+					!(cur->sk_flags & SK_BT_NEXT) :
+					!(cur->sk_flags & SK_BT_PRIOR))
+					continue;
+
+				skipkey = &skipkeys[curattr - 1];
+				memcpy(skipkey, cur, sizeof(ScanKeyData));
+				skipkey->sk_flags &= ~SK_BT_SKIP_SENTINEL;
+				skipkey->sk_strategy = ScanDirectionIsForward(dir) ?
+					BTGreaterStrategyNumber : BTLessStrategyNumber;
+				chosen = skipkey;
+				continue;
+			}
+
 			/*
 			 * Can we use this key as a starting boundary for this attr?
 			 *
@@ -21,7 +21,9 @@
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "commands/progress.h"
+#include "catalog/pg_type_d.h"
 #include "lib/qunique.h"
+#include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "utils/array.h"
 #include "utils/datum.h"
@@ -63,6 +65,17 @@ static bool _bt_compare_array_scankey_args(IndexScanDesc scan,
 										   FmgrInfo *orderproc, BTArrayKeyInfo *array,
 										   bool *qual_ok);
 static ScanKey _bt_preprocess_array_keys(IndexScanDesc scan, int *new_numberOfKeys);
+static int	_bt_num_skip_arrays(IndexScanDesc scan, bool *skipatts);
+static void _bt_preprocess_skip_array(IndexScanDesc scan, AttrNumber attno,
+									  ScanKey skey, BTArrayKeyInfo *array,
+									  FmgrInfo *orderproc);
+static void _bt_skiparray_set_element(IndexScanDesc scan,
+									  BTArrayKeyInfo *array, ScanKey skey,
+									  Datum tupdatum, bool tupnull);
+static void _bt_skiparray_set_first(BTArrayKeyInfo *array, ScanKey skey,
+									ScanDirection dir);
+static bool _bt_skiparray_increment(BTArrayKeyInfo *array, ScanKey skey,
+									ScanDirection dir);
 static void _bt_preprocess_array_keys_final(IndexScanDesc scan, int *keyDataMap);
 static int	_bt_compare_array_elements(const void *a, const void *b, void *arg);
 static inline int32 _bt_compare_array_skey(FmgrInfo *orderproc,
@@ -102,6 +115,9 @@ static void _bt_checkkeys_look_ahead(IndexScanDesc scan, BTReadPageState *pstate
 									 int tupnatts, TupleDesc tupdesc);
 static int	_bt_keep_natts(Relation rel, IndexTuple lastleft,
 						   IndexTuple firstright, BTScanInsert itup_key);
+static IndexTuple _bt_truncate_datum(Relation rel, IndexTuple lastleft,
+									 IndexTuple firstright, int keepnatts,
+									 BTScanInsert itup_key);
 
 
 /*
@@ -262,6 +278,11 @@ _bt_freestack(BTStack stack)
  * preprocessing steps are complete.  This will convert the scan key offset
  * references into references to the scan's so->keyData[] output scan keys.
  *
+ * We also add skip arrays here, for index columns that have no input scan
+ * keys of their own but precede columns that do (see _bt_num_skip_arrays).
+ * Each skip array gets a scan key of its own in the returned array, which
+ * can therefore be larger than scan->keyData[].
+ *
  * Note: the reason we need to return a temp scan key array, rather than just
  * scribbling on scan->keyData, is that callers are permitted to call btrescan
  * without supplying a new set of scankey data.
@@ -274,10 +295,13 @@ _bt_preprocess_array_keys(IndexScanDesc scan, int *new_numberOfKeys)
 	int			numberOfKeys = scan->numberOfKeys;
 	int16	   *indoption = rel->rd_indoption;
 	int			numArrayKeys,
+				numSkipArrays,
 				output_ikey = 0;
 	int			origarrayatt = InvalidAttrNumber,
 				origarraykey = -1;
 	Oid			origelemtype = InvalidOid;
+	AttrNumber	attno_skip = 1;
+	bool		skipatts[INDEX_MAX_KEYS];
 	ScanKey		cur;
 	MemoryContext oldContext;
 	ScanKey		arrayKeyData;	/* modified copy of scan->keyData */
@@ -302,8 +326,11 @@ _bt_preprocess_array_keys(IndexScanDesc scan, int *new_numberOfKeys)
 		}
 	}
 
+	/* Determine which index columns need a skip array, if any */
+	numSkipArrays = _bt_num_skip_arrays(scan, skipatts);
+
 	/* Quit if nothing to do. */
-	if (numArrayKeys == 0)
+	if (numArrayKeys == 0 && numSkipArrays == 0)
 		return NULL;
 
 	/*
@@ -320,13 +347,16 @@ _bt_preprocess_array_keys(IndexScanDesc scan, int *new_numberOfKeys)
 	oldContext = MemoryContextSwitchTo(so->arrayContext);
 
 	/* Create output scan keys in the workspace context */
-	arrayKeyData = (ScanKey) palloc(numberOfKeys * sizeof(ScanKeyData));
+	arrayKeyData = (ScanKey) palloc((numberOfKeys + numSkipArrays) *
+									sizeof(ScanKeyData));
 
 	/* Allocate space for per-array data in the workspace context */
-	so->arrayKeys = (BTArrayKeyInfo *) palloc(numArrayKeys * sizeof(BTArrayKeyInfo));
+	so->arrayKeys = (BTArrayKeyInfo *)
+		palloc((numArrayKeys + numSkipArrays) * sizeof(BTArrayKeyInfo));
 
 	/* Allocate space for ORDER procs used to help _bt_checkkeys */
-	so->orderProcs = (FmgrInfo *) palloc(numberOfKeys * sizeof(FmgrInfo));
+	so->orderProcs = (FmgrInfo *) palloc((numberOfKeys + numSkipArrays) *
+										 sizeof(FmgrInfo));
 
 	/* Now process each array key */
 	numArrayKeys = 0;
@@ -346,6 +376,24 @@ _bt_preprocess_array_keys(IndexScanDesc scan, int *new_numberOfKeys)
 		int			num_nonnulls;
 		int			j;
 
+		/*
+		 * Add skip arrays for columns before this scan key's column first, so
+		 * that arrayKeyData[] stays in index column order
+		 */
+		for (; attno_skip < scan->keyData[input_ikey].sk_attno; attno_skip++)
+		{
+			if (!skipatts[attno_skip - 1])
+				continue;
+
+			_bt_preprocess_skip_array(scan, attno_skip,
+									  &arrayKeyData[output_ikey],
+									  &so->arrayKeys[numArrayKeys],
+									  &so->orderProcs[output_ikey]);
+			so->arrayKeys[numArrayKeys].scan_key = output_ikey;
+			numArrayKeys++;
+			output_ikey++;
+		}
+
 		/*
 		 * Provisionally copy scan key into arrayKeyData[] array we'll return
 		 * to _bt_preprocess_keys caller
@@ -534,6 +582,107 @@ _bt_preprocess_array_keys(IndexScanDesc scan, int *new_numberOfKeys)
 	return arrayKeyData;
 }
 
+/*
+ *	_bt_num_skip_arrays() -- decide which index columns get a skip array
+ *
+ * An index column gets a skip array when it has no input scan keys at all,
+ * some later column has input scan keys, and each earlier column has an
+ * equality key or gets a skip array itself.  The skip array makes it possible
+ * to treat the keys on later columns as required, and to use them to
+ * reposition the scan once for each distinct value of the skipped column
+ * (rather than scanning the whole index).  A column whose only keys are
+ * inequalities ends the search: keys on the columns after it can't be
+ * required, skip array or no skip array.
+ *
+ * Sets skipatts[attno - 1] for each column that needs a skip array, and
+ * returns the number of skip arrays.
+ *
+ * Parallel index scans don't use skip arrays, since workers share array state
+ * in the form of offsets into the arrays' elements.
+ */
+static int
+_bt_num_skip_arrays(IndexScanDesc scan, bool *skipatts)
+{
+	bool		has_key[INDEX_MAX_KEYS] = {0};
+	bool		has_eq[INDEX_MAX_KEYS] = {0};
+	AttrNumber	last_attno = InvalidAttrNumber;
+	int			numSkipArrays = 0;
+
+	memset(skipatts, 0, sizeof(bool) * INDEX_MAX_KEYS);
+
+	if (scan->parallel_scan != NULL)
+		return 0;
+
+	for (int i = 0; i < scan->numberOfKeys; i++)
+	{
+		ScanKey		cur = &scan->keyData[i];
+
+		Assert(cur->sk_attno >= 1 && cur->sk_attno <= INDEX_MAX_KEYS);
+
+		has_key[cur->sk_attno - 1] = true;
+		if ((cur->sk_strategy == BTEqualStrategyNumber &&
+			 !(cur->sk_flags & (SK_ROW_HEADER | SK_ISNULL))) ||
+			(cur->sk_flags & SK_SEARCHNULL))
+			has_eq[cur->sk_attno - 1] = true;
+		last_attno = Max(last_attno, cur->sk_attno);
+	}
+
+	for (AttrNumber attno = 1; attno < last_attno; attno++)
+	{
+		if (has_eq[attno - 1])
+			continue;
+		if (has_key[attno - 1])
+			break;
+
+		skipatts[attno - 1] = true;
+		numSkipArrays++;
+	}
+
+	return numSkipArrays;
+}
+
+/*
+ *	_bt_preprocess_skip_array() -- set up a skip array for an index column
+ *
+ * Initializes caller's skey as an equality scan key on attno, using the
+ * opfamily's equality operator, and caller's array as the corresponding skip
+ * array.  The array's current element is set later, by _bt_start_array_keys.
+ */
+static void
+_bt_preprocess_skip_array(IndexScanDesc scan, AttrNumber attno,
+						  ScanKey skey, BTArrayKeyInfo *array,
+						  FmgrInfo *orderproc)
+{
+	Relation	rel = scan->indexRelation;
+	Oid			opfamily = rel->rd_opfamily[attno - 1];
+	Oid			opcintype = rel->rd_opcintype[attno - 1];
+	Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(rel), attno - 1);
+	Oid			eq_op;
+
+	eq_op = get_opfamily_member(opfamily, opcintype, opcintype,
+								BTEqualStrategyNumber);
+	if (!OidIsValid(eq_op))
+		elog(ERROR, "missing operator %d(%u,%u) in opfamily %u",
+			 BTEqualStrategyNumber, opcintype, opcintype, opfamily);
+
+	ScanKeyEntryInitialize(skey,
+						   SK_SEARCHARRAY | SK_BT_SKIP,
+						   attno,
+						   BTEqualStrategyNumber,
+						   InvalidOid,
+						   rel->rd_indcollation[attno - 1],
+						   get_opcode(eq_op),
+						   (Datum) 0);
+
+	_bt_setup_array_cmp(scan, skey, opcintype, orderproc, NULL);
+
+	array->cur_elem = 0;
+	array->num_elems = -1;
+	array->elem_values = NULL;
+	array->attlen = attr->attlen;
+	array->attbyval = attr->attbyval;
+}
+
 /*
  *	_bt_preprocess_array_keys_final() -- fix up array scan key references
  *
@@ -633,7 +782,7 @@ _bt_preprocess_array_keys_final(IndexScanDesc scan, int *keyDataMap)
 		{
 			BTArrayKeyInfo *array = &so->arrayKeys[arrayidx];
 
-			Assert(array->num_elems > 0);
+			Assert(array->num_elems > 0 || BTArrayIsSkip(array));
 
 			if (array->scan_key == input_ikey)
 			{
@@ -1145,6 +1294,10 @@ _bt_compare_array_skey(FmgrInfo *orderproc,
 
 	Assert(cur->sk_strategy == BTEqualStrategyNumber);
 
+	/* Skip array at -inf or +inf */
+	if (unlikely(cur->sk_flags & (SK_BT_MINVAL | SK_BT_MAXVAL)))
+		return (cur->sk_flags & SK_BT_MINVAL) ? 1 : -1;
+
 	if (tupnull)				/* NULL tupdatum */
 	{
 		if (cur->sk_flags & SK_ISNULL)
@@ -1183,6 +1336,13 @@ _bt_compare_array_skey(FmgrInfo *orderproc,
 			INVERT_COMPARE_RESULT(result);
 	}
 
+	/*
+	 * A skip array positioned just after (or just before) arrdatum sorts
+	 * after (or before) an equal tupdatum
+	 */
+	if (unlikely(result == 0 && (cur->sk_flags & (SK_BT_NEXT | SK_BT_PRIOR))))
+		result = (cur->sk_flags & SK_BT_NEXT) ? -1 : 1;
+
 	return result;
 }
 
@@ -1362,9 +1522,15 @@ _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir)
 		BTArrayKeyInfo *curArrayKey = &so->arrayKeys[i];
 		ScanKey		skey = &so->keyData[curArrayKey->scan_key];
 
-		Assert(curArrayKey->num_elems > 0);
+		Assert(curArrayKey->num_elems > 0 || BTArrayIsSkip(curArrayKey));
 		Assert(skey->sk_flags & SK_SEARCHARRAY);
 
+		if (BTArrayIsSkip(curArrayKey))
+		{
+			_bt_skiparray_set_first(curArrayKey, skey, dir);
+			continue;
+		}
+
 		if (ScanDirectionIsBackward(dir))
 			curArrayKey->cur_elem = curArrayKey->num_elems - 1;
 		else
@@ -1404,6 +1570,15 @@ _bt_advance_array_keys_increment(IndexScanDesc scan, ScanDirection dir)
 		int			num_elems = curArrayKey->num_elems;
 		bool		rolled = false;
 
+		if (BTArrayIsSkip(curArrayKey))
+		{
+			if (_bt_skiparray_increment(curArrayKey, skey, dir))
+				return true;
+
+			/* Need to advance next array key, if any */
+			continue;
+		}
+
 		if (ScanDirectionIsForward(dir) && ++cur_elem >= num_elems)
 		{
 			cur_elem = 0;
@@ -1438,6 +1613,126 @@ _bt_advance_array_keys_increment(IndexScanDesc scan, ScanDirection dir)
 	return false;
 }
 
+/*
+ * _bt_skiparray_clear() -- forget skip array's current element
+ *
+ * Frees the copy of the element's value, if any, and clears all flags that
+ * describe the current element.
+ */
+static void
+_bt_skiparray_clear(BTArrayKeyInfo *array, ScanKey skey)
+{
+	if (!array->attbyval && !(skey->sk_flags & SK_ISNULL) &&
+		DatumGetPointer(skey->sk_argument) != NULL)
+		pfree(DatumGetPointer(skey->sk_argument));
+
+	skey->sk_argument = (Datum) 0;
+	skey->sk_flags &= ~(SK_ISNULL | SK_SEARCHNULL | SK_BT_SKIP_SENTINEL);
+}
+
+/*
+ * _bt_skiparray_set_element() -- set skip array to an index tuple's value
+ *
+ * Every value is an element of a skip array, so this is how skip arrays
+ * advance to the "closest matching element".  A NULL element is represented
+ * the same way as an IS NULL scan key.
+ */
+static void
+_bt_skiparray_set_element(IndexScanDesc scan, BTArrayKeyInfo *array,
+						  ScanKey skey, Datum tupdatum, bool tupnull)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	MemoryContext oldContext;
+
+	Assert(skey->sk_flags & SK_BT_SKIP);
+
+	_bt_skiparray_clear(array, skey);
+
+	if (tupnull)
+	{
+		skey->sk_flags |= (SK_ISNULL | SK_SEARCHNULL);
+		return;
+	}
+
+	oldContext = MemoryContextSwitchTo(so->arrayContext);
+	skey->sk_argument = datumCopy(tupdatum, array->attbyval, array->attlen);
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * _bt_skiparray_set_first() -- set skip array to its first position for dir
+ *
+ * That's -inf for a forward scan, and +inf for a backward scan.  Neither is
+ * satisfied by any tuple; the array advances to the first actual value that
+ * the scan comes across.  Callers can pass the opposite direction to set the
+ * array to its final position instead.
+ */
+static void
+_bt_skiparray_set_first(BTArrayKeyInfo *array, ScanKey skey,
+						ScanDirection dir)
+{
+	Assert(skey->sk_flags & SK_BT_SKIP);
+
+	_bt_skiparray_clear(array, skey);
+
+	if (ScanDirectionIsForward(dir))
+		skey->sk_flags |= SK_BT_MINVAL;
+	else
+		skey->sk_flags |= SK_BT_MAXVAL;
+}
+
+/*
+ * _bt_skiparray_increment() -- advance skip array by a single increment
+ *
+ * We don't know what the next value in the index is, so we just move the
+ * array to a position immediately after its current value (or immediately
+ * before it, for a backward scan).  The array will advance to the next value
+ * once the scan reaches it; _bt_first can use the position as a > or <
+ * boundary in the meantime.
+ *
+ * Returns false when the array rolls over, which happens when it was at its
+ * final position for the scan direction already.  The array is then reset to
+ * its first position, as with any other array.
+ */
+static bool
+_bt_skiparray_increment(BTArrayKeyInfo *array, ScanKey skey,
+						ScanDirection dir)
+{
+	bool		nulls_first = (skey->sk_flags & SK_BT_NULLS_FIRST) != 0;
+
+	Assert(skey->sk_flags & SK_BT_SKIP);
+	Assert(!(skey->sk_flags & (SK_BT_NEXT | SK_BT_PRIOR)));
+
+	if (ScanDirectionIsForward(dir))
+	{
+		/* Already at +inf, or at NULL when NULLs sort last? */
+		if ((skey->sk_flags & SK_BT_MAXVAL) ||
+			((skey->sk_flags & SK_ISNULL) && !nulls_first))
+		{
+			_bt_skiparray_set_first(array, skey, dir);
+			return false;
+		}
+
+		/* Can't be at -inf, but stay there if we are, to be safe */
+		if (!(skey->sk_flags & SK_BT_MINVAL))
+			skey->sk_flags |= SK_BT_NEXT;
+	}
+	else
+	{
+		if ((skey->sk_flags & SK_BT_MINVAL) ||
+			((skey->sk_flags & SK_ISNULL) && nulls_first))
+		{
+			_bt_skiparray_set_first(array, skey, dir);
+			return false;
+		}
+
+		if (!(skey->sk_flags & SK_BT_MAXVAL))
+			skey->sk_flags |= SK_BT_PRIOR;
+	}
+
+	return true;
+}
+
 /*
  * _bt_rewind_nonrequired_arrays() -- Rewind non-required arrays
  *
@@ -1964,6 +2259,12 @@ _bt_advance_array_keys(IndexScanDesc scan, BTReadPageState *pstate,
 		{
 			int			final_elem_dir;
 
+			if (array && BTArrayIsSkip(array))
+			{
+				_bt_skiparray_set_first(array, cur, -dir);
+				continue;
+			}
+
 			if (ScanDirectionIsBackward(dir) || !array)
 				final_elem_dir = 0;
 			else
@@ -2000,6 +2301,12 @@ _bt_advance_array_keys(IndexScanDesc scan, BTReadPageState *pstate,
 		{
 			int			first_elem_dir;
 
+			if (array && BTArrayIsSkip(array))
+			{
+				_bt_skiparray_set_first(array, cur, dir);
+				continue;
+			}
+
 			if (ScanDirectionIsForward(dir) || !array)
 				first_elem_dir = 0;
 			else
@@ -2020,7 +2327,16 @@ _bt_advance_array_keys(IndexScanDesc scan, BTReadPageState *pstate,
 		 */
 		tupdatum = index_getattr(tuple, cur->sk_attno, tupdesc, &tupnull);
 
-		if (array)
+		if (array && BTArrayIsSkip(array))
+		{
+			/*
+			 * Every value is an element of a skip array, so the tuple's value
+			 * is always an exact match
+			 */
+			Assert(required);
+			result = 0;
+		}
+		else if (array)
 		{
 			bool		cur_elem_trig = (sktrig_required && ikey == sktrig);
 
@@ -2109,7 +2425,9 @@ _bt_advance_array_keys(IndexScanDesc scan, BTReadPageState *pstate,
 		}
 
 		/* Advance array keys, even when set_elem isn't an exact match */
-		if (array && array->cur_elem != set_elem)
+		if (array && BTArrayIsSkip(array))
+			_bt_skiparray_set_element(scan, array, cur, tupdatum, tupnull);
+		else if (array && array->cur_elem != set_elem)
 		{
 			array->cur_elem = set_elem;
 			cur->sk_argument = array->elem_values[set_elem];
@@ -2473,7 +2791,9 @@ end_toplevel_scan:
  * This can be seen to be correct by considering the above example.  Note
  * in particular that if there are no keys for a given attribute, the keys for
  * subsequent attributes can never be required; for instance "WHERE y = 4"
- * requires a full-index scan.
+ * would require a full-index scan.  That's why _bt_preprocess_array_keys adds
+ * a skip array on "x" in that case: it acts as an "=" key that matches every
+ * value of "x", allowing the "y" key to be marked required after all.
  *
  * If possible, redundant keys are eliminated: we keep only the tightest
  * >/>= bound and the tightest </<= bound, and if there's an = key then
@@ -3018,11 +3338,19 @@ _bt_verify_keys_with_arraykeys(IndexScanDesc scan)
 		if (array->scan_key != ikey)
 			return false;
 
-		if (array->num_elems <= 0)
-			return false;
+		if (BTArrayIsSkip(array))
+		{
+			if (!(cur->sk_flags & SK_BT_SKIP))
+				return false;
+		}
+		else
+		{
+			if (array->num_elems <= 0)
+				return false;
 
-		if (cur->sk_argument != array->elem_values[array->cur_elem])
-			return false;
+			if (cur->sk_argument != array->elem_values[array->cur_elem])
+				return false;
+		}
 		if (last_sk_attno > cur->sk_attno)
 			return false;
 		last_sk_attno = cur->sk_attno;
@@ -3730,6 +4058,18 @@ _bt_check_compare(IndexScanDesc scan, ScanDirection dir,
 			continue;
 		}
 
+		/*
+		 * A skip array that isn't positioned on an actual value can't be
+		 * satisfied by any tuple.  Stop, so that the array gets advanced.
+		 */
+		if (unlikely(key->sk_flags & SK_BT_SKIP_SENTINEL))
+		{
+			Assert(key->sk_flags & SK_BT_SKIP);
+			if (requiredSameDir)
+				*continuescan = false;
+			return false;
+		}
+
 		/* row-comparison keys need special processing */
 		if (key->sk_flags & SK_ROW_HEADER)
 		{
@@ -4628,14 +4968,16 @@ btbuildphasename(int64 phasenum)
  * key attributes are treated as containing "minus infinity" values by
  * _bt_compare().
  *
+ * When the final distinguishing key attribute is of a variable-width string
+ * type, we also try to truncate within that attribute's datum; see
+ * _bt_truncate_datum.
+ *
  * In the worst case (when a heap TID must be appended to distinguish lastleft
  * from firstright), the size of the returned tuple is the size of firstright
  * plus the size of an additional MAXALIGN()'d item pointer.  This guarantee
  * is important, since callers need to stay under the 1/3 of a page
- * restriction on tuple size.  If this routine is ever taught to truncate
- * within an attribute/datum, it will need to avoid returning an enlarged
- * tuple to caller when truncation + TOAST compression ends up enlarging the
- * final datum.
+ * restriction on tuple size.  Truncation within an attribute/datum is
+ * abandoned whenever it would end up enlarging the final tuple.
  */
 IndexTuple
 _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
@@ -4685,6 +5027,21 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	 */
 	if (keepnatts <= nkeyatts)
 	{
+#ifndef DEBUG_NO_TRUNCATE
+		IndexTuple	datumpivot;
+
+		datumpivot = _bt_truncate_datum(rel, lastleft, firstright, keepnatts,
+										itup_key);
+		if (datumpivot != NULL &&
+			IndexTupleSize(datumpivot) < IndexTupleSize(pivot))
+		{
+			pfree(pivot);
+			pivot = datumpivot;
+		}
+		else if (datumpivot != NULL)
+			pfree(datumpivot);
+#endif
+
 		BTreeTupleSetNAtts(pivot, keepnatts, false);
 		return pivot;
 	}
@@ -4771,6 +5128,132 @@ _bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright,
 	return tidpivot;
 }
 
+/*
+ * _bt_truncate_datum - truncate within final distinguishing key attribute.
+ *
+ * Caller has determined that attribute keepnatts is the first attribute that
+ * distinguishes lastleft from firstright.  When that attribute is of type
+ * text, varchar, or bytea, we try to build a pivot tuple whose final
+ * attribute holds only the shortest prefix of firstright's value that still
+ * sorts after lastleft's value.  Long values that share a common prefix
+ * (URLs, file paths, and the like) then produce short pivot tuples, which
+ * improves fan-out of internal pages.
+ *
+ * The prefix is obtained by keeping the bytes that lastleft and firstright
+ * have in common, plus the next (possibly multibyte) character.  That's
+ * guaranteed to work with bytewise orderings such as the "C" collation, but
+ * not with most other collations.  We therefore check that the prefix really
+ * does separate lastleft from firstright using the opclass comparator, and
+ * give up when it doesn't.  Since the comparator is a total order, that's all
+ * that's needed for the pivot to be correct.
+ *
+ * Returns NULL when no such pivot tuple could be built.  Otherwise returns a
+ * new tuple with keepnatts attributes, in the same format as a tuple returned
+ * by index_truncate_tuple(); caller must still set the number of attributes.
+ */
+static IndexTuple
+_bt_truncate_datum(Relation rel, IndexTuple lastleft, IndexTuple firstright,
+				   int keepnatts, BTScanInsert itup_key)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	Form_pg_attribute att = TupleDescAttr(itupdesc, keepnatts - 1);
+	ScanKey		scankey = &itup_key->scankeys[keepnatts - 1];
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	Datum		leftdatum;
+	bool		leftnull;
+	struct varlena *left;
+	struct varlena *right;
+	struct varlena *prefix;
+	char	   *leftdata;
+	char	   *rightdata;
+	int			leftlen;
+	int			rightlen;
+	int			commonlen;
+	int			prefixlen;
+	TupleDesc	truncdesc;
+	IndexTuple	pivot;
+
+	if (!itup_key->heapkeyspace)
+		return NULL;
+
+	if (att->atttypid != TEXTOID && att->atttypid != VARCHAROID &&
+		att->atttypid != BYTEAOID)
+		return NULL;
+
+	leftdatum = index_getattr(lastleft, keepnatts, itupdesc, &leftnull);
+	if (leftnull)
+		return NULL;
+
+	/* Create temporary descriptor to scribble on, as index_truncate_tuple */
+	truncdesc = palloc(TupleDescSize(itupdesc));
+	TupleDescCopy(truncdesc, itupdesc);
+	truncdesc->natts = keepnatts;
+
+	index_deform_tuple(firstright, truncdesc, values, isnull);
+	if (isnull[keepnatts - 1])
+	{
+		pfree(truncdesc);
+		return NULL;
+	}
+
+	left = PG_DETOAST_DATUM_PACKED(leftdatum);
+	right = PG_DETOAST_DATUM_PACKED(values[keepnatts - 1]);
+	leftdata = VARDATA_ANY(left);
+	leftlen = VARSIZE_ANY_EXHDR(left);
+	rightdata = VARDATA_ANY(right);
+	rightlen = VARSIZE_ANY_EXHDR(right);
+
+	commonlen = 0;
+	while (commonlen < leftlen && commonlen < rightlen &&
+		   leftdata[commonlen] == rightdata[commonlen])
+		commonlen++;
+
+	/* Keep common prefix, plus firstright's next character */
+	if (att->atttypid == BYTEAOID || pg_database_encoding_max_length() == 1)
+		prefixlen = commonlen + 1;
+	else
+	{
+		prefixlen = 0;
+		while (prefixlen <= commonlen && prefixlen < rightlen)
+			prefixlen += pg_mblen(rightdata + prefixlen);
+	}
+
+	/* Nothing to gain unless we actually make the datum shorter */
+	if (prefixlen >= rightlen)
+	{
+		pfree(truncdesc);
+		return NULL;
+	}
+
+	prefix = (struct varlena *) palloc(VARHDRSZ + prefixlen);
+	SET_VARSIZE(prefix, VARHDRSZ + prefixlen);
+	memcpy(VARDATA(prefix), rightdata, prefixlen);
+
+	/* Verify that lastleft < prefix <= firstright, per the opclass */
+	if (DatumGetInt32(FunctionCall2Coll(&scankey->sk_func,
+										scankey->sk_collation,
+										leftdatum,
+										PointerGetDatum(prefix))) >= 0 ||
+		DatumGetInt32(FunctionCall2Coll(&scankey->sk_func,
+										scankey->sk_collation,
+										PointerGetDatum(prefix),
+										values[keepnatts - 1])) > 0)
+	{
+		pfree(prefix);
+		pfree(truncdesc);
+		return NULL;
+	}
+
+	values[keepnatts - 1] = PointerGetDatum(prefix);
+	pivot = index_form_tuple(truncdesc, values, isnull);
+	pivot->t_tid = firstright->t_tid;
+	pfree(truncdesc);
+	pfree(prefix);
+
+	return pivot;
+}
+
 /*
  * _bt_keep_natts - how many key attributes to keep when truncating.
  *
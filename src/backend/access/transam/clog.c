@@ -109,7 +109,44 @@ static SlruCtlData XactCtlData;
 
 #define XactCtl (&XactCtlData)
 
+/*
+ * Backend-local cache of ranges of consecutive committed XIDs.
+ *
+ * Visibility checks on tuples without hint bits, e.g. in a table that has
+ * just been bulk loaded, call TransactionIdGetStatus() once per tuple.  When
+ * a lookup finds a committed XID, we remember the run of committed XIDs
+ * around it on the same CLOG page, so that lookups of neighboring XIDs can
+ * be answered without a bank lock.  Commit status never changes once set, so
+ * the ranges can only become stale through XID wraparound.  Since that
+ * cannot happen to XIDs looked up while a transaction is running, the cache
+ * is simply reset whenever a new transaction looks something up.
+ *
+ * A run is only followed up to COMMITTED_RANGE_MAX_EXTEND XIDs in each
+ * direction, to bound the cost of building a range on a cache miss.
+ */
+#define COMMITTED_RANGE_CACHE_SIZE	16
+#define COMMITTED_RANGE_MAX_EXTEND	4096
+
+/* four committed xacts in a byte */
+#define CLOG_ALL_COMMITTED_BYTE		0x55
+
+typedef struct CommittedXidRange
+{
+	TransactionId first;		/* first XID of the range */
+	TransactionId last;			/* last XID of the range, inclusive */
+	XLogRecPtr	lsn;			/* latest group LSN of the range's XIDs */
+} CommittedXidRange;
+
+static CommittedXidRange committedRanges[COMMITTED_RANGE_CACHE_SIZE];
+static int	numCommittedRanges = 0;
+static int	lastCommittedRange = 0;
+static LocalTransactionId committedRangesLxid = InvalidLocalTransactionId;
+
 
+static bool CommittedRangeCacheValid(void);
+static inline bool CommittedRangeCacheLookup(TransactionId xid,
+											 XLogRecPtr *lsn);
+static void CommittedRangeCacheAdd(int slotno, TransactionId xid);
 static int	ZeroCLOGPage(int64 pageno, bool writeXlog);
 static bool CLOGPagePrecedes(int64 page1, int64 page2);
 static void WriteZeroPageXlogRec(int64 pageno);
@@ -741,6 +778,18 @@ TransactionIdGetStatus(TransactionId xid, XLogRecPtr *lsn)
 	int			lsnindex;
 	char	   *byteptr;
 	XidStatus	status;
+	bool		use_cache;
+
+	use_cache = CommittedRangeCacheValid();
+	if (use_cache)
+	{
+		if (CommittedRangeCacheLookup(xid, lsn))
+		{
+			pgstat_count_slru_xid_cache_hit(XactCtl->shared->slru_stats_idx);
+			return TRANSACTION_STATUS_COMMITTED;
+		}
+		pgstat_count_slru_xid_cache_miss(XactCtl->shared->slru_stats_idx);
+	}
 
 	/* lock is acquired by SimpleLruReadPage_ReadOnly */
 
@@ -752,11 +801,145 @@ TransactionIdGetStatus(TransactionId xid, XLogRecPtr *lsn)
 	lsnindex = GetLSNIndex(slotno, xid);
 	*lsn = XactCtl->shared->group_lsn[lsnindex];
 
+	if (use_cache && status == TRANSACTION_STATUS_COMMITTED)
+		CommittedRangeCacheAdd(slotno, xid);
+
 	LWLockRelease(SimpleLruGetBankLock(XactCtl, pageno));
 
 	return status;
 }
 
+/*
+ * Can the committed range cache be used?  Resets it if it was filled by a
+ * previous transaction.
+ */
+static bool
+CommittedRangeCacheValid(void)
+{
+	LocalTransactionId lxid;
+
+	if (MyProc == NULL)
+		return false;
+
+	lxid = MyProc->vxid.lxid;
+	if (lxid != committedRangesLxid)
+	{
+		numCommittedRanges = 0;
+		lastCommittedRange = 0;
+		committedRangesLxid = lxid;
+	}
+
+	return LocalTransactionIdIsValid(lxid);
+}
+
+/*
+ * Look up xid in the committed range cache.  On success, sets *lsn to an LSN
+ * suitable for TransactionIdGetStatus() to return.
+ */
+static inline bool
+CommittedRangeCacheLookup(TransactionId xid, XLogRecPtr *lsn)
+{
+	CommittedXidRange *range;
+
+	if (numCommittedRanges == 0)
+		return false;
+
+	/* Consecutive lookups are likely to hit the same range */
+	range = &committedRanges[lastCommittedRange];
+	if (xid >= range->first && xid <= range->last)
+	{
+		*lsn = range->lsn;
+		return true;
+	}
+
+	for (int i = 0; i < numCommittedRanges; i++)
+	{
+		range = &committedRanges[i];
+
+		/* ranges don't cross page boundaries, so they can't wrap around */
+		if (xid >= range->first && xid <= range->last)
+		{
+			lastCommittedRange = i;
+			*lsn = range->lsn;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Remember the run of committed XIDs around the given committed xid, which
+ * is on the CLOG page in slotno.  Bank lock must be held.
+ */
+static void
+CommittedRangeCacheAdd(int slotno, TransactionId xid)
+{
+	char	   *page = XactCtl->shared->page_buffer[slotno];
+	int			entry = TransactionIdToPgIndex(xid);
+	int			lo = entry;
+	int			hi = entry;
+	int			minlo = Max(entry - COMMITTED_RANGE_MAX_EXTEND, 0);
+	int			maxhi = Min(entry + COMMITTED_RANGE_MAX_EXTEND,
+							CLOG_XACTS_PER_PAGE - 1);
+	XLogRecPtr	maxlsn = InvalidXLogRecPtr;
+	CommittedXidRange *range;
+
+#define CLOG_ENTRY_STATUS(e) \
+	((page[(e) / CLOG_XACTS_PER_BYTE] >> (((e) % CLOG_XACTS_PER_BYTE) * CLOG_BITS_PER_XACT)) & CLOG_XACT_BITMASK)
+
+	/* Extend downwards, skipping whole bytes where possible */
+	while (lo > minlo)
+	{
+		if (lo % CLOG_XACTS_PER_BYTE == 0 && lo - CLOG_XACTS_PER_BYTE >= minlo &&
+			(uint8) page[lo / CLOG_XACTS_PER_BYTE - 1] == CLOG_ALL_COMMITTED_BYTE)
+			lo -= CLOG_XACTS_PER_BYTE;
+		else if (CLOG_ENTRY_STATUS(lo - 1) == TRANSACTION_STATUS_COMMITTED)
+			lo--;
+		else
+			break;
+	}
+
+	/* Likewise upwards */
+	while (hi < maxhi)
+	{
+		if ((hi + 1) % CLOG_XACTS_PER_BYTE == 0 &&
+			hi + CLOG_XACTS_PER_BYTE <= maxhi &&
+			(uint8) page[(hi + 1) / CLOG_XACTS_PER_BYTE] == CLOG_ALL_COMMITTED_BYTE)
+			hi += CLOG_XACTS_PER_BYTE;
+		else if (CLOG_ENTRY_STATUS(hi + 1) == TRANSACTION_STATUS_COMMITTED)
+			hi++;
+		else
+			break;
+	}
+
+#undef CLOG_ENTRY_STATUS
+
+	/* Not worth a cache entry */
+	if (lo == hi)
+		return;
+
+	for (int group = lo / CLOG_XACTS_PER_LSN_GROUP;
+		 group <= hi / CLOG_XACTS_PER_LSN_GROUP; group++)
+	{
+		XLogRecPtr	grouplsn;
+
+		grouplsn = XactCtl->shared->group_lsn[slotno * CLOG_LSNS_PER_PAGE + group];
+		if (grouplsn > maxlsn)
+			maxlsn = grouplsn;
+	}
+
+	if (numCommittedRanges < COMMITTED_RANGE_CACHE_SIZE)
+		lastCommittedRange = numCommittedRanges++;
+	else
+		lastCommittedRange = (lastCommittedRange + 1) % COMMITTED_RANGE_CACHE_SIZE;
+
+	range = &committedRanges[lastCommittedRange];
+	range->first = xid - (entry - lo);
+	range->last = xid + (hi - entry);
+	range->lsn = maxlsn;
+}
+
 /*
  * Number of shared CLOG buffers.
  *
@@ -0,0 +1,574 @@
+/*-------------------------------------------------------------------------
+ *
+ * csnlog.c
+ *		Commit sequence number log manager
+ *
+ * When csn_snapshots is enabled, every committing transaction is assigned a
+ * commit sequence number (CSN) from a shared counter, and the CSN of each
+ * of its XIDs is stored in pg_csn.  An MVCC snapshot then consists of just
+ * the current value of the counter plus xmin and xmax bounds, all of which
+ * are read from shared atomics.  This avoids the ProcArray scan that
+ * GetSnapshotData() performs otherwise, at the cost of a pg_csn lookup for
+ * each XID between the snapshot's xmin and xmax that needs to be checked.
+ *
+ * The bounds are maintained as follows:
+ *
+ * - the oldest active XID is the oldest top-level XID still present in the
+ *	 ProcArray (or the next XID to be assigned if there is none).  All XIDs
+ *	 preceding it have completed, and it serves as snapshot xmin.  It only
+ *	 needs to be recomputed when the transaction it points to ends, see
+ *	 ProcArrayEndTransaction().
+ *
+ * - the latest committed XID plus one, used as snapshot xmax.  It is
+ *	 advanced by committing transactions before they take their CSN.
+ *
+ * A committing transaction first marks its XIDs as CommittingCommitSeqNo,
+ * then takes its CSN and stores it.  A reader that finds an XID marked as
+ * committing has to wait until the CSN has been stored, as it cannot know
+ * whether the CSN will precede the snapshot's or not.
+ *
+ * Like pg_subtrans, pg_csn only needs to cover XIDs that are still of
+ * interest to some running transaction, and is not preserved across crashes.
+ * During startup, all XIDs known to have committed are marked as
+ * FrozenCommitSeqNo, which makes them visible to every snapshot.
+ *
+ * Snapshots taken during recovery do not use CSNs.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/backend/access/transam/csnlog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/csnlog.h"
+#include "access/slru.h"
+#include "access/transam.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/s_lock.h"
+#include "storage/shmem.h"
+#include "utils/snapmgr.h"
+
+
+/*
+ * Defines for CSNLog page sizes.  A page is the same BLCKSZ as is used
+ * everywhere else in Postgres.
+ *
+ * Like for SUBTRANS, page and segment numbering wrap around with
+ * TransactionIds.  We need take no explicit notice of that fact in this
+ * module, except when comparing segment and page numbers in TruncateCSNLog
+ * (see CSNLogPagePrecedes) and zeroing them in StartupCSNLog.
+ */
+
+/* We need eight bytes per xact */
+#define CSNLOG_XACTS_PER_PAGE (BLCKSZ / sizeof(CommitSeqNo))
+
+/*
+ * Although we return an int64 the actual value can't currently exceed
+ * 0xFFFFFFFF/CSNLOG_XACTS_PER_PAGE.
+ */
+static inline int64
+TransactionIdToPage(TransactionId xid)
+{
+	return xid / (int64) CSNLOG_XACTS_PER_PAGE;
+}
+
+#define TransactionIdToEntry(xid) ((xid) % (TransactionId) CSNLOG_XACTS_PER_PAGE)
+
+/*
+ * Shared state used to build CSN snapshots.  The XIDs are stored as
+ * FullTransactionIds, so that they can be read and compared without locks.
+ */
+typedef struct CSNLogSharedData
+{
+	/* CSN to be assigned to the next committing transaction */
+	pg_atomic_uint64 nextCommitSeqNo;
+
+	/* oldest XID still running, see ProcArrayEndTransaction() */
+	pg_atomic_uint64 oldestActiveXid;
+
+	/* latest committed XID, plus one */
+	pg_atomic_uint64 latestCommittedXidPlusOne;
+} CSNLogSharedData;
+
+static CSNLogSharedData *CSNLogShared = NULL;
+
+/*
+ * Link to shared-memory data structures for CSNLog control
+ */
+static SlruCtlData CSNLogCtlData;
+
+#define CSNLogCtl  (&CSNLogCtlData)
+
+/* GUC variable */
+bool		csn_snapshots = false;
+
+
+static int	ZeroCSNLogPage(int64 pageno);
+static bool CSNLogPagePrecedes(int64 page1, int64 page2);
+static void CSNLogSetCSN(TransactionId xid, int nsubxids,
+						 TransactionId *subxids, CommitSeqNo csn);
+static CommitSeqNo CSNLogGetCSN(TransactionId xid);
+
+
+/*
+ * Record the commit of a transaction and its committed subtransactions.
+ *
+ * latestXid is the latest of xid and subxids.  Must be called in a critical
+ * section, after the commit has been recorded in pg_xact but before the
+ * transaction is removed from the ProcArray.
+ */
+void
+CSNLogSetCommitted(TransactionId xid, int nsubxids,
+				   TransactionId *subxids, TransactionId latestXid)
+{
+	FullTransactionId oldestActive;
+	uint64		newxmax;
+	uint64		curxmax;
+	CommitSeqNo csn;
+
+	Assert(csn_snapshots);
+	Assert(CritSectionCount > 0);
+	Assert(TransactionIdIsNormal(xid));
+
+	/* Make readers wait until we know our CSN */
+	CSNLogSetCSN(xid, nsubxids, subxids, CommittingCommitSeqNo);
+
+	/*
+	 * Advance the snapshot xmax bound past our XIDs, so that any snapshot
+	 * that might see our CSN as committed also has them below its xmax.
+	 * latestXid is still running, so it can be widened relative to the
+	 * oldest active XID.
+	 */
+	oldestActive = FullTransactionIdFromU64(pg_atomic_read_u64(&CSNLogShared->oldestActiveXid));
+	newxmax = U64FromFullTransactionId(oldestActive) +
+		(uint32) (latestXid - XidFromFullTransactionId(oldestActive)) + 1;
+
+	curxmax = pg_atomic_read_u64(&CSNLogShared->latestCommittedXidPlusOne);
+	while (curxmax < newxmax)
+	{
+		if (pg_atomic_compare_exchange_u64(&CSNLogShared->latestCommittedXidPlusOne,
+										   &curxmax, newxmax))
+			break;
+	}
+
+	/* This is the point at which the transaction becomes visible */
+	csn = pg_atomic_fetch_add_u64(&CSNLogShared->nextCommitSeqNo, 1);
+
+	CSNLogSetCSN(xid, nsubxids, subxids, csn);
+}
+
+/*
+ * Does the given XID appear as committed to a snapshot with the given CSN?
+ *
+ * Returns false for XIDs that are in progress, aborted, or committed after
+ * the snapshot was taken.
+ */
+bool
+CSNLogXidCommittedBefore(TransactionId xid, CommitSeqNo snapshotcsn)
+{
+	CommitSeqNo csn = CSNLogGetCSN(xid);
+
+	if (unlikely(csn == CommittingCommitSeqNo))
+	{
+		SpinDelayStatus delay;
+
+		/*
+		 * The committing backend does nothing but take a CSN between marking
+		 * and storing it, so this will not take long.  The bank lock must not
+		 * be held while waiting.
+		 */
+		init_local_spin_delay(&delay);
+		while ((csn = CSNLogGetCSN(xid)) == CommittingCommitSeqNo)
+			perform_spin_delay(&delay);
+		finish_spin_delay(&delay);
+	}
+
+	return CommitSeqNoIsValid(csn) && csn < snapshotcsn;
+}
+
+/*
+ * Set the CSN of a transaction and its subtransactions.
+ *
+ * XIDs on the same page are set while holding the bank lock once.
+ */
+static void
+CSNLogSetCSN(TransactionId xid, int nsubxids, TransactionId *subxids,
+			 CommitSeqNo csn)
+{
+	LWLock	   *prevlock = NULL;
+	int64		prevpage = -1;
+	int			slotno = -1;
+
+	for (int i = -1; i < nsubxids; i++)
+	{
+		TransactionId curxid = (i < 0) ? xid : subxids[i];
+		int64		pageno = TransactionIdToPage(curxid);
+		CommitSeqNo *ptr;
+
+		if (pageno != prevpage)
+		{
+			LWLock	   *lock = SimpleLruGetBankLock(CSNLogCtl, pageno);
+
+			if (prevlock != lock)
+			{
+				if (prevlock)
+					LWLockRelease(prevlock);
+				LWLockAcquire(lock, LW_EXCLUSIVE);
+				prevlock = lock;
+			}
+			slotno = SimpleLruReadPage(CSNLogCtl, pageno, true, curxid);
+			prevpage = pageno;
+		}
+
+		ptr = (CommitSeqNo *) CSNLogCtl->shared->page_buffer[slotno];
+		ptr += TransactionIdToEntry(curxid);
+		*ptr = csn;
+		CSNLogCtl->shared->page_dirty[slotno] = true;
+	}
+
+	if (prevlock)
+		LWLockRelease(prevlock);
+}
+
+/*
+ * Interrogate the CSN of a transaction in the CSN log.
+ */
+static CommitSeqNo
+CSNLogGetCSN(TransactionId xid)
+{
+	int64		pageno = TransactionIdToPage(xid);
+	int			entryno = TransactionIdToEntry(xid);
+	int			slotno;
+	CommitSeqNo *ptr;
+	CommitSeqNo csn;
+
+	/* Can't ask about stuff that might not be around anymore */
+	Assert(TransactionIdFollowsOrEquals(xid, TransactionXmin));
+
+	/* lock is acquired by SimpleLruReadPage_ReadOnly */
+
+	slotno = SimpleLruReadPage_ReadOnly(CSNLogCtl, pageno, xid);
+	ptr = (CommitSeqNo *) CSNLogCtl->shared->page_buffer[slotno];
+	ptr += entryno;
+
+	csn = *ptr;
+
+	LWLockRelease(SimpleLruGetBankLock(CSNLogCtl, pageno));
+
+	return csn;
+}
+
+/*
+ * Oldest XID that might still be running.  Used as snapshot xmin.
+ */
+FullTransactionId
+CSNLogGetOldestActiveXid(void)
+{
+	return FullTransactionIdFromU64(pg_atomic_read_u64(&CSNLogShared->oldestActiveXid));
+}
+
+/*
+ * Install a new oldest active XID.
+ *
+ * The caller must hold ProcArrayLock exclusively, and must have determined
+ * oldestActiveXid after the previous oldest active XID was removed from the
+ * ProcArray.  The xmax bound is advanced along with it, as xmax must never
+ * precede xmin.
+ */
+void
+CSNLogSetOldestActiveXid(FullTransactionId oldestActiveXid)
+{
+	uint64		newxmin = U64FromFullTransactionId(oldestActiveXid);
+	uint64		curxmax;
+
+	Assert(newxmin >= pg_atomic_read_u64(&CSNLogShared->oldestActiveXid));
+
+	curxmax = pg_atomic_read_u64(&CSNLogShared->latestCommittedXidPlusOne);
+	while (curxmax < newxmin)
+	{
+		if (pg_atomic_compare_exchange_u64(&CSNLogShared->latestCommittedXidPlusOne,
+										   &curxmax, newxmin))
+			break;
+	}
+
+	pg_atomic_write_u64(&CSNLogShared->oldestActiveXid, newxmin);
+}
+
+/*
+ * Read the CSN and xmax for a new snapshot.
+ *
+ * The caller must have read the snapshot's xmin before calling this.
+ */
+CommitSeqNo
+CSNLogGetSnapshotCSN(FullTransactionId *xmax)
+{
+	CommitSeqNo csn;
+
+	pg_read_barrier();
+	csn = pg_atomic_read_u64(&CSNLogShared->nextCommitSeqNo);
+	pg_read_barrier();
+	*xmax = FullTransactionIdFromU64(pg_atomic_read_u64(&CSNLogShared->latestCommittedXidPlusOne));
+
+	return csn;
+}
+
+/*
+ * Number of shared CSNLog buffers.
+ *
+ * Entries are twice as wide as SUBTRANS's, so use 4MB for every 1GB of
+ * shared buffers, up to 8MB.
+ */
+static int
+CSNLogShmemBuffers(void)
+{
+	return SimpleLruAutotuneBuffers(256, 1024);
+}
+
+/*
+ * Initialization of shared memory for CSNLog
+ */
+Size
+CSNLogShmemSize(void)
+{
+	if (!csn_snapshots)
+		return 0;
+
+	return add_size(SimpleLruShmemSize(CSNLogShmemBuffers(), 0),
+					sizeof(CSNLogSharedData));
+}
+
+void
+CSNLogShmemInit(void)
+{
+	bool		found;
+
+	if (!csn_snapshots)
+		return;
+
+	CSNLogCtl->PagePrecedes = CSNLogPagePrecedes;
+	SimpleLruInit(CSNLogCtl, "commit_sequence", CSNLogShmemBuffers(), 0,
+				  "pg_csn", LWTRANCHE_CSNLOG_BUFFER,
+				  LWTRANCHE_CSNLOG_SLRU, SYNC_HANDLER_NONE, false);
+	SlruPagePrecedesUnitTests(CSNLogCtl, CSNLOG_XACTS_PER_PAGE);
+
+	CSNLogShared = ShmemInitStruct("CSNLog Data", sizeof(CSNLogSharedData),
+								   &found);
+	if (!found)
+	{
+		pg_atomic_init_u64(&CSNLogShared->nextCommitSeqNo,
+						   FirstNormalCommitSeqNo);
+		pg_atomic_init_u64(&CSNLogShared->oldestActiveXid, 0);
+		pg_atomic_init_u64(&CSNLogShared->latestCommittedXidPlusOne, 0);
+	}
+}
+
+/*
+ * This func must be called ONCE on system install.  It creates
+ * the initial CSNLog segment, if CSN snapshots are enabled.  (The CSNLog
+ * directory is assumed to have been created by initdb, and CSNLogShmemInit
+ * must have been called already.)
+ */
+void
+BootStrapCSNLog(void)
+{
+	int			slotno;
+	LWLock	   *lock;
+
+	if (!csn_snapshots)
+		return;
+
+	lock = SimpleLruGetBankLock(CSNLogCtl, 0);
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+
+	/* Create and zero the first page of the CSN log */
+	slotno = ZeroCSNLogPage(0);
+
+	/* Make sure it's written out */
+	SimpleLruWritePage(CSNLogCtl, slotno);
+	Assert(!CSNLogCtl->shared->page_dirty[slotno]);
+
+	LWLockRelease(lock);
+}
+
+/*
+ * Initialize (or reinitialize) a page of CSNLog to zeroes.
+ *
+ * The page is not actually written, just set up in shared memory.
+ * The slot number of the new page is returned.
+ *
+ * Control lock must be held at entry, and will be held at exit.
+ */
+static int
+ZeroCSNLogPage(int64 pageno)
+{
+	return SimpleLruZeroPage(CSNLogCtl, pageno);
+}
+
+/*
+ * This must be called ONCE at the end of recovery, after
+ * TransamVariables->nextXid has been initialized and prepared transactions
+ * have been restored.
+ *
+ * oldestActiveXID is the oldest XID of any prepared transaction, or nextXid
+ * if there are none.
+ */
+void
+StartupCSNLog(TransactionId oldestActiveXID)
+{
+	FullTransactionId nextXid;
+	TransactionId xid;
+	int64		startPage;
+	int64		endPage;
+	LWLock	   *prevlock = NULL;
+	LWLock	   *lock;
+
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * Like pg_subtrans, pg_csn is not valid across crashes, so initialize
+	 * the currently-active page(s) to zeroes.  Whenever we advance into a new
+	 * page, ExtendCSNLog will likewise zero the new page.
+	 */
+	startPage = TransactionIdToPage(oldestActiveXID);
+	nextXid = TransamVariables->nextXid;
+	endPage = TransactionIdToPage(XidFromFullTransactionId(nextXid));
+
+	for (;;)
+	{
+		lock = SimpleLruGetBankLock(CSNLogCtl, startPage);
+		if (prevlock != lock)
+		{
+			if (prevlock)
+				LWLockRelease(prevlock);
+			LWLockAcquire(lock, LW_EXCLUSIVE);
+			prevlock = lock;
+		}
+
+		(void) ZeroCSNLogPage(startPage);
+		if (startPage == endPage)
+			break;
+
+		startPage++;
+		/* must account for wraparound */
+		if (startPage > TransactionIdToPage(MaxTransactionId))
+			startPage = 0;
+	}
+
+	LWLockRelease(lock);
+
+	/*
+	 * Transactions that committed after the oldest prepared transaction
+	 * started precede every snapshot taken from now on.
+	 */
+	xid = oldestActiveXID;
+	while (TransactionIdPrecedes(xid, XidFromFullTransactionId(nextXid)))
+	{
+		if (TransactionIdDidCommit(xid))
+			CSNLogSetCSN(xid, 0, NULL, FrozenCommitSeqNo);
+		TransactionIdAdvance(xid);
+	}
+
+	pg_atomic_write_u64(&CSNLogShared->oldestActiveXid,
+						U64FromFullTransactionId(nextXid) -
+						(uint32) (XidFromFullTransactionId(nextXid) - oldestActiveXID));
+	pg_atomic_write_u64(&CSNLogShared->latestCommittedXidPlusOne,
+						U64FromFullTransactionId(nextXid));
+	pg_atomic_write_u64(&CSNLogShared->nextCommitSeqNo, FirstNormalCommitSeqNo);
+}
+
+/*
+ * Perform a checkpoint --- either during shutdown, or on-the-fly
+ */
+void
+CheckPointCSNLog(void)
+{
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * Write dirty CSNLog pages to disk.  As for SUBTRANS, this is not
+	 * necessary for correctness, it just keeps backends from having to do it.
+	 */
+	SimpleLruWriteAll(CSNLogCtl, true);
+}
+
+
+/*
+ * Make sure that CSNLog has room for a newly-allocated XID.
+ *
+ * NB: this is called while holding XidGenLock.
+ */
+void
+ExtendCSNLog(TransactionId newestXact)
+{
+	int64		pageno;
+	LWLock	   *lock;
+
+	if (!csn_snapshots)
+		return;
+
+	/*
+	 * No work except at first XID of a page.  But beware: just after
+	 * wraparound, the first XID of page zero is FirstNormalTransactionId.
+	 */
+	if (TransactionIdToEntry(newestXact) != 0 &&
+		!TransactionIdEquals(newestXact, FirstNormalTransactionId))
+		return;
+
+	pageno = TransactionIdToPage(newestXact);
+
+	lock = SimpleLruGetBankLock(CSNLogCtl, pageno);
+	LWLockAcquire(lock, LW_EXCLUSIVE);
+
+	/* Zero the page */
+	ZeroCSNLogPage(pageno);
+
+	LWLockRelease(lock);
+}
+
+
+/*
+ * Remove all CSNLog segments before the one holding the passed transaction ID
+ *
+ * oldestXact is the oldest TransactionXmin of any running transaction.  This
+ * is called only during checkpoint.
+ */
+void
+TruncateCSNLog(TransactionId oldestXact)
+{
+	int64		cutoffPage;
+
+	if (!csn_snapshots)
+		return;
+
+	/* See TruncateSUBTRANS() for why we step back one transaction */
+	TransactionIdRetreat(oldestXact);
+	cutoffPage = TransactionIdToPage(oldestXact);
+
+	SimpleLruTruncate(CSNLogCtl, cutoffPage);
+}
+
+
+/*
+ * Decide whether a CSNLog page number is "older" for truncation purposes.
+ * Analogous to CLOGPagePrecedes().
+ */
+static bool
+CSNLogPagePrecedes(int64 page1, int64 page2)
+{
+	TransactionId xid1;
+	TransactionId xid2;
+
+	xid1 = ((TransactionId) page1) * CSNLOG_XACTS_PER_PAGE;
+	xid1 += FirstNormalTransactionId + 1;
+	xid2 = ((TransactionId) page2) * CSNLOG_XACTS_PER_PAGE;
+	xid2 += FirstNormalTransactionId + 1;
+
+	return (TransactionIdPrecedes(xid1, xid2) &&
+			TransactionIdPrecedes(xid1, xid2 + CSNLOG_XACTS_PER_PAGE - 1));
+}
@@ -148,6 +148,9 @@ static const struct
 	},
 	{
 		"parallel_vacuum_main", parallel_vacuum_main
+	},
+	{
+		"parallel_analyze_main", parallel_analyze_main
 	}
 };
 
@@ -77,6 +77,7 @@
 #include <unistd.h>
 
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/htup_details.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
@@ -104,6 +105,9 @@
 #include "storage/procarray.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
+#include "utils/sharedresultcache.h"
 #include "utils/timestamp.h"
 
 /*
@@ -1588,6 +1592,13 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 									   abortstats,
 									   gid);
 
+	if (isCommit && csn_snapshots)
+	{
+		START_CRIT_SECTION();
+		CSNLogSetCommitted(xid, hdr->nsubxacts, children, latestXid);
+		END_CRIT_SECTION();
+	}
+
 	ProcArrayRemove(proc, latestXid);
 
 	/*
@@ -1637,7 +1648,10 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	{
 		if (hdr->initfileinval)
 			RelationCacheInitFilePreInvalidate();
+		SharedCatCacheInvalidate(invalmsgs, hdr->ninvalmsgs);
 		SendSharedInvalidMessages(invalmsgs, hdr->ninvalmsgs);
+		SharedPlanCacheInvalidate(invalmsgs, hdr->ninvalmsgs);
+		SharedResultCacheInvalidate(invalmsgs, hdr->ninvalmsgs);
 		if (hdr->initfileinval)
 			RelationCacheInitFilePostInvalidate();
 	}
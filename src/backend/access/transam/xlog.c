@@ -48,6 +48,7 @@
 
 #include "access/clog.h"
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/heaptoast.h"
 #include "access/multixact.h"
 #include "access/rewriteheap.h"
@@ -5177,6 +5178,7 @@ BootStrapXLOG(uint32 data_checksum_version)
 	BootStrapCLOG();
 	BootStrapCommitTs();
 	BootStrapSUBTRANS();
+	BootStrapCSNLog();
 	BootStrapMultiXact();
 
 	pfree(buffer);
@@ -6085,6 +6087,9 @@ StartupXLOG(void)
 	if (standbyState == STANDBY_DISABLED)
 		StartupSUBTRANS(oldestActiveXID);
 
+	/* CSN snapshots are not used in recovery, so start the CSN log now */
+	StartupCSNLog(oldestActiveXID);
+
 	/*
 	 * Perform end of recovery actions for any SLRUs that need it.
 	 */
@@ -7345,7 +7350,12 @@ CreateCheckPoint(int flags)
 	 * StartupSUBTRANS hasn't been called yet.
 	 */
 	if (!RecoveryInProgress())
-		TruncateSUBTRANS(GetOldestTransactionIdConsideredRunning());
+	{
+		TransactionId oldestXact = GetOldestTransactionIdConsideredRunning();
+
+		TruncateSUBTRANS(oldestXact);
+		TruncateCSNLog(oldestXact);
+	}
 
 	/* Real work is done; log and update stats. */
 	LogCheckpointEnd(false);
@@ -7520,6 +7530,7 @@ CheckPointGuts(XLogRecPtr checkPointRedo, int flags)
 	CheckPointCLOG();
 	CheckPointCommitTs();
 	CheckPointSUBTRANS();
+	CheckPointCSNLog();
 	CheckPointMultiXact();
 	CheckPointPredicate();
 	CheckPointBuffers(flags);
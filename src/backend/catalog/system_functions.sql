@@ -688,6 +688,10 @@ REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared(text) FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_slru(text) FROM public;
 
+REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared_plan_cache() FROM public;
+
+REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared_result_cache() FROM public;
+
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_table_counters(oid) FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_function_counters(oid) FROM public;
@@ -294,6 +294,7 @@ CREATE VIEW pg_stats_ext WITH (security_barrier) AS
          JOIN pg_statistic_ext_data sd ON (s.oid = sd.stxoid)
          LEFT JOIN pg_namespace cn ON (cn.oid = c.relnamespace)
          LEFT JOIN pg_namespace sn ON (sn.oid = s.stxnamespace)
+         LEFT JOIN pg_constraint fk ON (fk.oid = s.stxfkey)
          LEFT JOIN LATERAL
                    ( SELECT array_agg(values) AS most_common_vals,
                             array_agg(nulls) AS most_common_val_nulls,
@@ -302,7 +303,11 @@ CREATE VIEW pg_stats_ext WITH (security_barrier) AS
                      FROM pg_mcv_list_items(sd.stxdmcv)
                    ) m ON sd.stxdmcv IS NOT NULL
     WHERE pg_has_role(c.relowner, 'USAGE')
-    AND (c.relrowsecurity = false OR NOT row_security_active(c.oid));
+    AND (c.relrowsecurity = false OR NOT row_security_active(c.oid))
+    AND (s.stxfkey = 0 OR
+         (has_table_privilege(c.oid, 'SELECT') AND
+          has_table_privilege(fk.conrelid, 'SELECT') AND
+          NOT row_security_active(fk.conrelid)));
 
 CREATE VIEW pg_stats_ext_exprs WITH (security_barrier) AS
     SELECT cn.nspname AS schemaname,
@@ -922,9 +927,50 @@ CREATE VIEW pg_stat_slru AS
             s.blks_exists,
             s.flushes,
             s.truncates,
+            s.xid_cache_hits,
+            s.xid_cache_misses,
             s.stats_reset
     FROM pg_stat_get_slru() s;
 
+CREATE VIEW pg_stat_shared_plan_cache AS
+    SELECT
+            s.hits,
+            s.misses,
+            s.entries,
+            s.memory_bytes
+    FROM pg_stat_get_shared_plan_cache() s;
+
+CREATE VIEW pg_stat_shared_result_cache AS
+    SELECT
+            s.hits,
+            s.misses,
+            s.stores,
+            s.invalidations,
+            s.evictions,
+            s.entries,
+            s.memory_bytes
+    FROM pg_stat_get_shared_result_cache() s;
+
+CREATE VIEW pg_stat_connection_proxies AS
+    SELECT
+            s.proxy_id,
+            s.pid,
+            s.clients,
+            s.pinned_clients,
+            s.waiting_clients,
+            s.backends,
+            s.idle_backends,
+            s.transactions
+    FROM pg_stat_get_connection_proxies() s;
+
+CREATE VIEW pg_stat_backend_pool AS
+    SELECT
+            s.database,
+            s.idle,
+            s.handoffs,
+            s.misses
+    FROM pg_stat_get_backend_pool() s;
+
 CREATE VIEW pg_stat_wal_receiver AS
     SELECT
             s.pid,
@@ -19,6 +19,7 @@
 #include "access/detoast.h"
 #include "access/genam.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/relation.h"
 #include "access/table.h"
 #include "access/tableam.h"
@@ -38,6 +39,7 @@
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/paths.h"
 #include "parser/parse_oper.h"
 #include "parser/parse_relation.h"
 #include "pgstat.h"
@@ -46,6 +48,8 @@
 #include "statistics/statistics.h"
 #include "storage/bufmgr.h"
 #include "storage/procarray.h"
+#include "storage/shm_mq.h"
+#include "tcop/tcopprot.h"
 #include "utils/attoptcache.h"
 #include "utils/datum.h"
 #include "utils/guc.h"
@@ -68,6 +72,116 @@ typedef struct AnlIndexData
 	int			attr_cnt;
 } AnlIndexData;
 
+/*
+ * DSM keys for parallel ANALYZE.  Unlike other parallel execution code, since
+ * we don't need to worry about DSM keys conflicting with plan_node_id we can
+ * use small integers.
+ */
+#define PARALLEL_ANALYZE_KEY_SHARED			1
+#define PARALLEL_ANALYZE_KEY_QUERY_TEXT		2
+#define PARALLEL_ANALYZE_KEY_BUFFER_USAGE	3
+#define PARALLEL_ANALYZE_KEY_WAL_USAGE		4
+#define PARALLEL_ANALYZE_KEY_ITEMS			5
+#define PARALLEL_ANALYZE_KEY_SAMPLE			6
+#define PARALLEL_ANALYZE_KEY_QUEUES			7
+
+/* Size of the queue each worker sends its results through */
+#define PARALLEL_ANALYZE_QUEUE_SIZE			65536
+
+/*
+ * Unless the user asked for a specific number of workers, the statistics of
+ * the columns are only computed in parallel if the sample has at least this
+ * many values in total.
+ */
+#define PARALLEL_ANALYZE_MIN_VALUES			1000000
+
+/* What the workers of a parallel ANALYZE do */
+typedef enum ParallelAnalyzePhase
+{
+	PARALLEL_ANALYZE_ACQUIRE,	/* sample rows of child tables */
+	PARALLEL_ANALYZE_COMPUTE,	/* compute statistics of columns */
+} ParallelAnalyzePhase;
+
+/*
+ * Struct for information shared among the leader and the workers of a
+ * parallel ANALYZE.  This is allocated in the DSM segment.
+ */
+typedef struct PAShared
+{
+	ParallelAnalyzePhase phase;
+	Oid			relid;			/* relation being analyzed */
+	int			elevel;
+	uint64		queryid;
+	int			ring_nbuffers;	/* size of the buffer access strategy */
+
+	/* The sample the statistics are computed from, for the compute phase */
+	int			numrows;
+	double		totalrows;
+
+	/* Work items, handed out in order to whoever asks for one next */
+	int			nitems;
+	pg_atomic_uint32 nextitem;
+} PAShared;
+
+/*
+ * A work item of a parallel ANALYZE: a child table to sample rows from, or a
+ * column to compute statistics for.
+ */
+typedef struct PAItem
+{
+	Oid			relid;			/* child table to sample */
+	int			targrows;		/* number of rows to sample from it */
+	int			attnum;			/* column to compute statistics for */
+} PAItem;
+
+/*
+ * Message a worker sends before the rows it sampled from a child table.  Each
+ * row then follows in a message of its own, consisting of its t_self and its
+ * contents.
+ */
+typedef struct PASampleHeader
+{
+	int			item;
+	int			numrows;
+	double		totalrows;
+	double		totaldeadrows;
+} PASampleHeader;
+
+/*
+ * Message carrying the statistics a worker computed for a column.  The
+ * stanumbers and the serialized stavalues of each slot follow it.
+ */
+typedef struct PAColumnStats
+{
+	int			item;
+	bool		stats_valid;
+	float4		stanullfrac;
+	int32		stawidth;
+	float4		stadistinct;
+	int16		stakind[STATISTIC_NUM_SLOTS];
+	Oid			staop[STATISTIC_NUM_SLOTS];
+	Oid			stacoll[STATISTIC_NUM_SLOTS];
+	int			numnumbers[STATISTIC_NUM_SLOTS];
+	int			numvalues[STATISTIC_NUM_SLOTS];
+	Oid			statypid[STATISTIC_NUM_SLOTS];
+	int16		statyplen[STATISTIC_NUM_SLOTS];
+	bool		statypbyval[STATISTIC_NUM_SLOTS];
+	char		statypalign[STATISTIC_NUM_SLOTS];
+} PAColumnStats;
+
+/* Leader's state of a parallel ANALYZE */
+typedef struct ParallelAnalyzeState
+{
+	ParallelContext *pcxt;
+	PAShared   *shared;
+	shm_mq_handle **queues;		/* one per launched worker */
+	bool	   *detached;		/* has the worker detached from its queue? */
+	int			nlive;			/* number of queues not detached yet */
+	int			nextqueue;		/* queue to read from next */
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+} ParallelAnalyzeState;
+
 
 /* Default statistics target (GUC parameter) */
 int			default_statistics_target = 100;
@@ -92,8 +206,37 @@ static int	acquire_sample_rows(Relation onerel, int elevel,
 								double *totalrows, double *totaldeadrows);
 static int	compare_rows(const void *a, const void *b, void *arg);
 static int	acquire_inherited_sample_rows(Relation onerel, int elevel,
+										  int nworkers,
 										  HeapTuple *rows, int targrows,
 										  double *totalrows, double *totaldeadrows);
+static void convert_child_rows(Relation childrel, Relation onerel,
+							   HeapTuple *rows, int numrows);
+static bool column_is_parallel_safe(VacAttrStats *stats);
+static bool sample_uses_local_buffers(Relation onerel, bool inh);
+static int	compute_parallel_analyze_workers(int nrequested, int maxworkers,
+											 bool worthwhile);
+static ParallelAnalyzeState *begin_parallel_analyze(Relation onerel,
+													ParallelAnalyzePhase phase,
+													int elevel, int nworkers,
+													PAItem *items, int nitems,
+													HeapTuple *rows, int numrows,
+													double totalrows);
+static void end_parallel_analyze(ParallelAnalyzeState *pas);
+static int	parallel_analyze_next_item(PAShared *shared);
+static bool parallel_analyze_receive(ParallelAnalyzeState *pas, bool nowait,
+									 int *worker, Size *nbytes, void **data);
+static bool compute_stats_parallel(Relation onerel, int elevel, int nworkers,
+								   VacAttrStats **vacattrstats, int attr_cnt,
+								   HeapTuple *rows, int numrows,
+								   double totalrows, MemoryContext col_context);
+static void send_column_stats(shm_mq_handle *mqh, int item,
+							  VacAttrStats *stats);
+static void receive_column_stats(VacAttrStats **itemstats, int nitems,
+								 char *data, Size nbytes);
+static void send_sampled_rows(shm_mq_handle *mqh, int item, HeapTuple *rows,
+							  int numrows, double totalrows,
+							  double totaldeadrows);
+static HeapTuple copy_sampled_row(char *data, Size nbytes, Oid tableoid);
 static void update_attstats(Oid relid, bool inh,
 							int natts, VacAttrStats **vacattrstats);
 static Datum std_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
@@ -529,6 +672,7 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 								 PROGRESS_ANALYZE_PHASE_ACQUIRE_SAMPLE_ROWS);
 	if (inh)
 		numrows = acquire_inherited_sample_rows(onerel, elevel,
+												params->nworkers,
 												rows, targrows,
 												&totalrows, &totaldeadrows);
 	else
@@ -546,6 +690,7 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 	{
 		MemoryContext col_context,
 					old_context;
+		bool		parallel = false;
 
 		pgstat_progress_update_param(PROGRESS_ANALYZE_PHASE,
 									 PROGRESS_ANALYZE_PHASE_COMPUTE_STATS);
@@ -555,17 +700,47 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 											ALLOCSET_DEFAULT_SIZES);
 		old_context = MemoryContextSwitchTo(col_context);
 
+		/*
+		 * Let parallel workers compute the statistics of the columns they
+		 * can deal with, if there's enough work to be worth it.  The leader
+		 * takes part in that, and deals with the remaining columns itself
+		 * afterwards.  Workers can't detoast values stored in temporary
+		 * tables, so those are left alone.
+		 */
+		if (params->nworkers >= 0 && !sample_uses_local_buffers(onerel, inh))
+		{
+			int			nsafe = 0;
+			int			nworkers;
+
+			for (i = 0; i < attr_cnt; i++)
+			{
+				if (column_is_parallel_safe(vacattrstats[i]))
+					nsafe++;
+			}
+			nworkers = compute_parallel_analyze_workers(params->nworkers,
+														nsafe - 1,
+														(double) numrows * nsafe >= PARALLEL_ANALYZE_MIN_VALUES);
+			if (nworkers > 0)
+				parallel = compute_stats_parallel(onerel, elevel, nworkers,
+												  vacattrstats, attr_cnt,
+												  rows, numrows, totalrows,
+												  col_context);
+		}
+
 		for (i = 0; i < attr_cnt; i++)
 		{
 			VacAttrStats *stats = vacattrstats[i];
 			AttributeOpts *aopt;
 
-			stats->rows = rows;
-			stats->tupDesc = onerel->rd_att;
-			stats->compute_stats(stats,
-								 std_fetch_func,
-								 numrows,
-								 totalrows);
+			if (!parallel || !column_is_parallel_safe(stats))
+			{
+				stats->rows = rows;
+				stats->tupDesc = onerel->rd_att;
+				stats->compute_stats(stats,
+									 std_fetch_func,
+									 numrows,
+									 totalrows);
+			}
 
 			/*
 			 * If the appropriate flavor of the n_distinct option is
@@ -1367,9 +1542,12 @@ compare_rows(const void *a, const void *b, void *arg)
  * collected from all inheritance children as well as the specified table.
  * We fail and return zero if there are no inheritance children, or if all
  * children are foreign tables that don't support ANALYZE.
+ *
+ * nworkers is the number of parallel workers requested, as in VacuumParams,
+ * to sample the children with.
  */
 static int
-acquire_inherited_sample_rows(Relation onerel, int elevel,
+acquire_inherited_sample_rows(Relation onerel, int elevel, int nworkers,
 							  HeapTuple *rows, int targrows,
 							  double *totalrows, double *totaldeadrows)
 {
@@ -1383,6 +1561,16 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 				i;
 	ListCell   *lc;
 	bool		has_child;
+	int		   *childstart;
+	int		   *childtargrows;
+	int		   *childrows;
+	bool	   *childdone;
+	PAItem	   *items;
+	int		   *itemchild;
+	int			nitems;
+	double		itemblocks;
+	int			ndone = 0;
+	ParallelAnalyzeState *pas = NULL;
 
 	/* Initialize output parameters to zero now, in case we exit early */
 	*totalrows = 0;
@@ -1516,23 +1704,130 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 	 * Now sample rows from each relation, proportionally to its fraction of
 	 * the total block count.  (This might be less than desirable if the child
 	 * rels have radically different free-space percentages, but it's not
-	 * clear that it's worth working harder.)
+	 * clear that it's worth working harder.)  Each child's share of the
+	 * sample is fixed up front, so that children sampled by parallel workers
+	 * can have their rows stored in place, whatever order they arrive in.
 	 */
 	pgstat_progress_update_param(PROGRESS_ANALYZE_CHILD_TABLES_TOTAL,
 								 nrels);
+	childstart = (int *) palloc(nrels * sizeof(int));
+	childtargrows = (int *) palloc(nrels * sizeof(int));
+	childrows = (int *) palloc0(nrels * sizeof(int));
+	childdone = (bool *) palloc0(nrels * sizeof(bool));
+	items = (PAItem *) palloc0(nrels * sizeof(PAItem));
+	itemchild = (int *) palloc(nrels * sizeof(int));
+	nitems = 0;
+	itemblocks = 0;
 	numrows = 0;
 	for (i = 0; i < nrels; i++)
 	{
-		Relation	childrel = rels[i];
-		AcquireSampleRowsFunc acquirefunc = acquirefuncs[i];
-		double		childblocks = relblocks[i];
+		int			target = 0;
+
+		if (relblocks[i] > 0)
+		{
+			target = (int) rint(targrows * relblocks[i] / totalblocks);
+			/* Make sure we don't overrun due to roundoff error */
+			target = Min(target, targrows - numrows);
+		}
+		childstart[i] = numrows;
+		childtargrows[i] = target;
+		numrows += target;
+
+		/*
+		 * Regular tables can be sampled by parallel workers, unless they are
+		 * temporary tables.  Foreign tables are left to the leader.
+		 */
+		if (target > 0 && acquirefuncs[i] == acquire_sample_rows &&
+			!RelationUsesLocalBuffers(rels[i]))
+		{
+			items[nitems].relid = RelationGetRelid(rels[i]);
+			items[nitems].targrows = target;
+			itemchild[nitems++] = i;
+			itemblocks += relblocks[i];
+		}
+	}
+
+	/*
+	 * The leader doesn't sample any child tables while workers are running,
+	 * since it has to keep reading their queues, so there's no point in
+	 * parallelism unless there are two children to sample.
+	 */
+	if (nworkers >= 0)
+		nworkers = compute_parallel_analyze_workers(nworkers,
+													nitems > 1 ? nitems : 0,
+													itemblocks >= min_parallel_table_scan_size);
+	if (nworkers > 0)
+		pas = begin_parallel_analyze(onerel, PARALLEL_ANALYZE_ACQUIRE, elevel,
+									 nworkers, items, nitems, NULL, 0, 0);
+	if (pas != NULL)
+	{
+		int		   *curchild;
+		int		   *pending;
+		int			worker;
+		Size		nbytes;
+		void	   *data;
+
+		curchild = (int *) palloc0(pas->pcxt->nworkers_launched * sizeof(int));
+		pending = (int *) palloc0(pas->pcxt->nworkers_launched * sizeof(int));
 
 		/*
-		 * Report progress.  The sampling function will normally report blocks
-		 * done/total, but we need to reset them to 0 here, so that they don't
-		 * show an old value until that.
+		 * Collect the rows the workers sampled.  Each child's rows are
+		 * preceded by a header telling which child they came from.
 		 */
+		while (parallel_analyze_receive(pas, false, &worker, &nbytes, &data))
+		{
+			int			c;
+
+			if (pending[worker] == 0)
+			{
+				PASampleHeader hdr;
+
+				Assert(nbytes == sizeof(PASampleHeader));
+				memcpy(&hdr, data, sizeof(PASampleHeader));
+				c = itemchild[hdr.item];
+				if (hdr.numrows > childtargrows[c])
+					elog(ERROR, "parallel worker sampled too many rows");
+				curchild[worker] = c;
+				pending[worker] = hdr.numrows;
+				*totalrows += hdr.totalrows;
+				*totaldeadrows += hdr.totaldeadrows;
+			}
+			else
+			{
+				c = curchild[worker];
+				rows[childstart[c] + childrows[c]] =
+					copy_sampled_row(data, nbytes, RelationGetRelid(rels[c]));
+				childrows[c]++;
+				pending[worker]--;
+			}
+
+			if (pending[worker] == 0)
+			{
+				childdone[c] = true;
+				pgstat_progress_update_param(PROGRESS_ANALYZE_CHILD_TABLES_DONE,
+											 ++ndone);
+			}
+		}
+
+		end_parallel_analyze(pas);
+	}
+
+	/*
+	 * Sample the children that the workers didn't, and put all the rows
+	 * together.
+	 */
+	numrows = 0;
+	for (i = 0; i < nrels; i++)
+	{
+		Relation	childrel = rels[i];
+
+		if (!childdone[i])
 		{
+			/*
+			 * Report progress.  The sampling function will normally report
+			 * blocks done/total, but we need to reset them to 0 here, so that
+			 * they don't show an old value until that.
+			 */
 			const int	progress_index[] = {
 				PROGRESS_ANALYZE_CURRENT_CHILD_TABLE_RELID,
 				PROGRESS_ANALYZE_BLOCKS_DONE,
@@ -1545,71 +1840,876 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 			};
 
 			pgstat_progress_update_multi_param(3, progress_index, progress_vals);
-		}
-
-		if (childblocks > 0)
-		{
-			int			childtargrows;
 
-			childtargrows = (int) rint(targrows * childblocks / totalblocks);
-			/* Make sure we don't overrun due to roundoff error */
-			childtargrows = Min(childtargrows, targrows - numrows);
-			if (childtargrows > 0)
+			if (childtargrows[i] > 0)
 			{
-				int			childrows;
 				double		trows,
 							tdrows;
 
 				/* Fetch a random sample of the child's rows */
-				childrows = (*acquirefunc) (childrel, elevel,
-											rows + numrows, childtargrows,
-											&trows, &tdrows);
-
-				/* We may need to convert from child's rowtype to parent's */
-				if (childrows > 0 &&
-					!equalRowTypes(RelationGetDescr(childrel),
-								   RelationGetDescr(onerel)))
-				{
-					TupleConversionMap *map;
-
-					map = convert_tuples_by_name(RelationGetDescr(childrel),
-												 RelationGetDescr(onerel));
-					if (map != NULL)
-					{
-						int			j;
-
-						for (j = 0; j < childrows; j++)
-						{
-							HeapTuple	newtup;
-
-							newtup = execute_attr_map_tuple(rows[numrows + j], map);
-							heap_freetuple(rows[numrows + j]);
-							rows[numrows + j] = newtup;
-						}
-						free_conversion_map(map);
-					}
-				}
-
-				/* And add to counts */
-				numrows += childrows;
+				childrows[i] = (*acquirefuncs[i]) (childrel, elevel,
+												   rows + childstart[i],
+												   childtargrows[i],
+												   &trows, &tdrows);
 				*totalrows += trows;
 				*totaldeadrows += tdrows;
 			}
 		}
 
+		/* We may need to convert from child's rowtype to parent's */
+		if (childrows[i] > 0)
+			convert_child_rows(childrel, onerel, rows + childstart[i],
+							   childrows[i]);
+
+		/* Close the gap left by children that returned fewer rows */
+		if (numrows < childstart[i])
+			memmove(rows + numrows, rows + childstart[i],
+					childrows[i] * sizeof(HeapTuple));
+		numrows += childrows[i];
+
 		/*
 		 * Note: we cannot release the child-table locks, since we may have
 		 * pointers to their TOAST tables in the sampled rows.
 		 */
 		table_close(childrel, NoLock);
-		pgstat_progress_update_param(PROGRESS_ANALYZE_CHILD_TABLES_DONE,
-									 i + 1);
+		if (!childdone[i])
+			pgstat_progress_update_param(PROGRESS_ANALYZE_CHILD_TABLES_DONE,
+										 ++ndone);
 	}
 
 	return numrows;
 }
 
 
+/*
+ * convert_child_rows -- convert sampled rows of a child to parent's rowtype
+ */
+static void
+convert_child_rows(Relation childrel, Relation onerel,
+				   HeapTuple *rows, int numrows)
+{
+	TupleConversionMap *map;
+	int			j;
+
+	if (equalRowTypes(RelationGetDescr(childrel), RelationGetDescr(onerel)))
+		return;
+
+	map = convert_tuples_by_name(RelationGetDescr(childrel),
+								 RelationGetDescr(onerel));
+	if (map == NULL)
+		return;
+
+	for (j = 0; j < numrows; j++)
+	{
+		HeapTuple	newtup;
+
+		newtup = execute_attr_map_tuple(rows[j], map);
+		heap_freetuple(rows[j]);
+		rows[j] = newtup;
+	}
+	free_conversion_map(map);
+}
+
+
+/*
+ * Parallel ANALYZE
+ *
+ * Two parts of ANALYZE can be done by parallel workers.  When analyzing an
+ * inheritance tree, the workers can sample the child tables, each taking one
+ * child at a time and sending the rows it sampled back to the leader through
+ * a shm_mq.  The leader only collects the rows while the workers run, and
+ * samples the children that the workers can't deal with, such as foreign
+ * tables, once they are done.
+ *
+ * Once the sample has been acquired, the workers can compute the statistics
+ * of the columns.  The sample is copied into the DSM segment, and each
+ * participant, leader included, takes one column at a time.  The workers
+ * send the resulting statistics back to the leader, which stores them into
+ * its VacAttrStats as if it had computed them itself.  Only columns of
+ * built-in data types are handed out, since the functions used to compute
+ * their statistics are known to be parallel safe.
+ *
+ * Sampling the blocks of a single table stays serial either way.
+ */
+
+/*
+ * Can the statistics of the column be computed by a parallel worker?
+ */
+static bool
+column_is_parallel_safe(VacAttrStats *stats)
+{
+	return stats->attrtypid < FirstNormalObjectId &&
+		stats->attrtype->typanalyze < FirstNormalObjectId;
+}
+
+/*
+ * Does the sample of the relation possibly contain rows of a temporary table,
+ * whose TOAST data parallel workers can't read?
+ */
+static bool
+sample_uses_local_buffers(Relation onerel, bool inh)
+{
+	List	   *tableOIDs;
+	ListCell   *lc;
+
+	if (RelationUsesLocalBuffers(onerel))
+		return true;
+	if (!inh)
+		return false;
+
+	/* We already hold locks on all the children */
+	tableOIDs = find_all_inheritors(RelationGetRelid(onerel), NoLock, NULL);
+	foreach(lc, tableOIDs)
+	{
+		if (get_rel_persistence(lfirst_oid(lc)) == RELPERSISTENCE_TEMP)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Compute the number of parallel workers to use.
+ *
+ * nrequested is the number of workers requested by the user, or 0 to choose
+ * one.  maxworkers is the largest number of workers that could be kept busy.
+ * worthwhile tells whether there's enough work to choose parallelism on our
+ * own.
+ */
+static int
+compute_parallel_analyze_workers(int nrequested, int maxworkers,
+								 bool worthwhile)
+{
+	int			nworkers;
+
+	if (nrequested < 0 || maxworkers <= 0 ||
+		max_parallel_maintenance_workers == 0)
+		return 0;
+
+	if (nrequested == 0 && !worthwhile)
+		return 0;
+
+	nworkers = nrequested > 0 ? nrequested : maxworkers;
+	nworkers = Min(nworkers, maxworkers);
+
+	/* Cap by max_parallel_maintenance_workers */
+	return Min(nworkers, max_parallel_maintenance_workers);
+}
+
+/*
+ * Set up the DSM segment for a parallel ANALYZE, and launch the workers.
+ *
+ * For the compute phase, rows, numrows and totalrows describe the sample the
+ * statistics are computed from.  Returns NULL if no workers could be
+ * launched, in which case the caller has to do all the work itself.
+ */
+static ParallelAnalyzeState *
+begin_parallel_analyze(Relation onerel, ParallelAnalyzePhase phase,
+					   int elevel, int nworkers, PAItem *items, int nitems,
+					   HeapTuple *rows, int numrows, double totalrows)
+{
+	ParallelAnalyzeState *pas;
+	ParallelContext *pcxt;
+	PAShared   *shared;
+	PAItem	   *shared_items;
+	char	   *mqspace;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	Size		est_items;
+	Size		est_sample = 0;
+	Size		est_queues;
+	int			querylen;
+	int			i;
+
+	Assert(nworkers > 0);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "parallel_analyze_main",
+								 nworkers);
+
+	/* Estimate size for shared information -- PARALLEL_ANALYZE_KEY_SHARED */
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(PAShared));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate size for work items -- PARALLEL_ANALYZE_KEY_ITEMS */
+	est_items = mul_size(sizeof(PAItem), nitems);
+	shm_toc_estimate_chunk(&pcxt->estimator, est_items);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate size for the sample -- PARALLEL_ANALYZE_KEY_SAMPLE.  It's
+	 * stored as an array of offsets and an array of lengths, followed by the
+	 * contents of the rows.
+	 */
+	if (phase == PARALLEL_ANALYZE_COMPUTE)
+	{
+		est_sample = MAXALIGN(mul_size(sizeof(Size) + sizeof(uint32),
+									   numrows));
+		for (i = 0; i < numrows; i++)
+			est_sample = add_size(est_sample, MAXALIGN(rows[i]->t_len));
+		shm_toc_estimate_chunk(&pcxt->estimator, est_sample);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
+	/* Estimate size for result queues -- PARALLEL_ANALYZE_KEY_QUEUES */
+	est_queues = mul_size(PARALLEL_ANALYZE_QUEUE_SIZE, pcxt->nworkers);
+	shm_toc_estimate_chunk(&pcxt->estimator, est_queues);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for BufferUsage and WalUsage --
+	 * PARALLEL_ANALYZE_KEY_BUFFER_USAGE and PARALLEL_ANALYZE_KEY_WAL_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_ANALYZE_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	/* Prepare shared information */
+	shared = (PAShared *) shm_toc_allocate(pcxt->toc, sizeof(PAShared));
+	MemSet(shared, 0, sizeof(PAShared));
+	shared->phase = phase;
+	shared->relid = RelationGetRelid(onerel);
+	shared->elevel = elevel;
+	shared->queryid = pgstat_get_my_query_id();
+	shared->ring_nbuffers = vac_strategy ?
+		GetAccessStrategyBufferCount(vac_strategy) : 0;
+	shared->numrows = numrows;
+	shared->totalrows = totalrows;
+	shared->nitems = nitems;
+	pg_atomic_init_u32(&shared->nextitem, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_SHARED, shared);
+
+	shared_items = (PAItem *) shm_toc_allocate(pcxt->toc, est_items);
+	memcpy(shared_items, items, sizeof(PAItem) * nitems);
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_ITEMS, shared_items);
+
+	/* Copy the sample */
+	if (phase == PARALLEL_ANALYZE_COMPUTE)
+	{
+		char	   *sample;
+		Size	   *offsets;
+		uint32	   *lengths;
+		Size		offset;
+
+		sample = shm_toc_allocate(pcxt->toc, est_sample);
+		offsets = (Size *) sample;
+		lengths = (uint32 *) (sample + sizeof(Size) * numrows);
+		offset = MAXALIGN(mul_size(sizeof(Size) + sizeof(uint32), numrows));
+		for (i = 0; i < numrows; i++)
+		{
+			offsets[i] = offset;
+			lengths[i] = rows[i]->t_len;
+			memcpy(sample + offset, rows[i]->t_data, rows[i]->t_len);
+			offset += MAXALIGN(rows[i]->t_len);
+		}
+		shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_SAMPLE, sample);
+	}
+
+	/* Set up a result queue for each worker */
+	mqspace = shm_toc_allocate(pcxt->toc, est_queues);
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(mqspace + i * (Size) PARALLEL_ANALYZE_QUEUE_SIZE,
+						   (Size) PARALLEL_ANALYZE_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_QUEUES, mqspace);
+
+	/*
+	 * Allocate space for each worker's BufferUsage and WalUsage; no need to
+	 * initialize
+	 */
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_BUFFER_USAGE, buffer_usage);
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_WAL_USAGE, wal_usage);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	LaunchParallelWorkers(pcxt);
+
+	if (phase == PARALLEL_ANALYZE_COMPUTE)
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel analyze worker for computing statistics (planned: %d)",
+								 "launched %d parallel analyze workers for computing statistics (planned: %d)",
+								 pcxt->nworkers_launched),
+						pcxt->nworkers_launched, nworkers)));
+	else
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel analyze worker for sampling child tables (planned: %d)",
+								 "launched %d parallel analyze workers for sampling child tables (planned: %d)",
+								 pcxt->nworkers_launched),
+						pcxt->nworkers_launched, nworkers)));
+
+	/* If no workers were launched, back out */
+	if (pcxt->nworkers_launched == 0)
+	{
+		WaitForParallelWorkersToFinish(pcxt);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	pas = (ParallelAnalyzeState *) palloc0(sizeof(ParallelAnalyzeState));
+	pas->pcxt = pcxt;
+	pas->shared = shared;
+	pas->buffer_usage = buffer_usage;
+	pas->wal_usage = wal_usage;
+
+	/* Attach to the queues of the workers that were launched */
+	pas->queues = (shm_mq_handle **)
+		palloc(pcxt->nworkers_launched * sizeof(shm_mq_handle *));
+	pas->detached = (bool *) palloc0(pcxt->nworkers_launched * sizeof(bool));
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = (shm_mq *) (mqspace + i * (Size) PARALLEL_ANALYZE_QUEUE_SIZE);
+		pas->queues[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+		shm_mq_set_handle(pas->queues[i], pcxt->worker[i].bgwhandle);
+	}
+	pas->nlive = pcxt->nworkers_launched;
+	pas->nextqueue = 0;
+
+	return pas;
+}
+
+/*
+ * Wait for the workers of a parallel ANALYZE to finish, accumulate their
+ * buffer and WAL usage, and end parallel mode.
+ */
+static void
+end_parallel_analyze(ParallelAnalyzeState *pas)
+{
+	int			i;
+
+	WaitForParallelWorkersToFinish(pas->pcxt);
+
+	for (i = 0; i < pas->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&pas->buffer_usage[i], &pas->wal_usage[i]);
+
+	for (i = 0; i < pas->pcxt->nworkers_launched; i++)
+	{
+		if (!pas->detached[i])
+			shm_mq_detach(pas->queues[i]);
+	}
+
+	DestroyParallelContext(pas->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Take the next work item, or return -1 if there are none left.
+ */
+static int
+parallel_analyze_next_item(PAShared *shared)
+{
+	uint32		item;
+
+	/*
+	 * Don't let the counter run past the number of items, so that it can't
+	 * wrap around however often it's asked.
+	 */
+	if (pg_atomic_read_u32(&shared->nextitem) >= shared->nitems)
+		return -1;
+
+	item = pg_atomic_fetch_add_u32(&shared->nextitem, 1);
+	if (item >= shared->nitems)
+		return -1;
+
+	return (int) item;
+}
+
+/*
+ * Receive the next message sent by any worker.
+ *
+ * The queues are read in turn, so that no worker is kept waiting for long.
+ * Returns false if no message is available without waiting and nowait is
+ * true, or if all workers have detached from their queues.
+ */
+static bool
+parallel_analyze_receive(ParallelAnalyzeState *pas, bool nowait,
+						 int *worker, Size *nbytes, void **data)
+{
+	int			nqueues = pas->pcxt->nworkers_launched;
+
+	for (;;)
+	{
+		int			nvisited;
+
+		for (nvisited = 0; nvisited < nqueues && pas->nlive > 0; nvisited++)
+		{
+			int			i = pas->nextqueue;
+			shm_mq_result result;
+
+			pas->nextqueue = (i + 1) % nqueues;
+			if (pas->detached[i])
+				continue;
+
+			result = shm_mq_receive(pas->queues[i], nbytes, data, true);
+			if (result == SHM_MQ_SUCCESS)
+			{
+				*worker = i;
+				return true;
+			}
+			else if (result == SHM_MQ_DETACHED)
+			{
+				pas->detached[i] = true;
+				pas->nlive--;
+			}
+		}
+
+		if (pas->nlive == 0 || nowait)
+			return false;
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+						 WAIT_EVENT_PARALLEL_ANALYZE_RESULTS);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * compute_stats_parallel -- compute column statistics with parallel workers
+ *
+ * Computes the statistics of the columns accepted by column_is_parallel_safe,
+ * leaving the others to the caller.  Returns false if no workers could be
+ * launched, in which case nothing was done.
+ */
+static bool
+compute_stats_parallel(Relation onerel, int elevel, int nworkers,
+					   VacAttrStats **vacattrstats, int attr_cnt,
+					   HeapTuple *rows, int numrows, double totalrows,
+					   MemoryContext col_context)
+{
+	ParallelAnalyzeState *pas;
+	MemoryContext old_context;
+	PAItem	   *items;
+	VacAttrStats **itemstats;
+	int			nitems = 0;
+	int			item;
+	int			worker;
+	Size		nbytes;
+	void	   *data;
+	int			i;
+
+	/* The parallel state has to survive resets of col_context */
+	old_context = MemoryContextSwitchTo(anl_context);
+
+	items = (PAItem *) palloc0(attr_cnt * sizeof(PAItem));
+	itemstats = (VacAttrStats **) palloc(attr_cnt * sizeof(VacAttrStats *));
+	for (i = 0; i < attr_cnt; i++)
+	{
+		if (column_is_parallel_safe(vacattrstats[i]))
+		{
+			items[nitems].attnum = vacattrstats[i]->tupattnum;
+			itemstats[nitems++] = vacattrstats[i];
+		}
+	}
+
+	pas = begin_parallel_analyze(onerel, PARALLEL_ANALYZE_COMPUTE, elevel,
+								 nworkers, items, nitems,
+								 rows, numrows, totalrows);
+	if (pas == NULL)
+	{
+		MemoryContextSwitchTo(old_context);
+		return false;
+	}
+
+	/*
+	 * Take part in the work, collecting whatever results have arrived in
+	 * between columns so as not to keep the workers waiting.
+	 */
+	MemoryContextSwitchTo(col_context);
+	while ((item = parallel_analyze_next_item(pas->shared)) >= 0)
+	{
+		VacAttrStats *stats = itemstats[item];
+
+		while (parallel_analyze_receive(pas, true, &worker, &nbytes, &data))
+			receive_column_stats(itemstats, nitems, data, nbytes);
+
+		stats->rows = rows;
+		stats->tupDesc = onerel->rd_att;
+		stats->compute_stats(stats,
+							 std_fetch_func,
+							 numrows,
+							 totalrows);
+		MemoryContextReset(col_context);
+	}
+
+	/* Collect the rest of the results */
+	while (parallel_analyze_receive(pas, false, &worker, &nbytes, &data))
+		receive_column_stats(itemstats, nitems, data, nbytes);
+
+	end_parallel_analyze(pas);
+	MemoryContextSwitchTo(old_context);
+
+	return true;
+}
+
+/*
+ * Send the statistics computed for a column to the leader.
+ */
+static void
+send_column_stats(shm_mq_handle *mqh, int item, VacAttrStats *stats)
+{
+	PAColumnStats hdr;
+	Size		len;
+	char	   *buf;
+	char	   *ptr;
+	int			k;
+	int			j;
+	shm_mq_result result;
+
+	MemSet(&hdr, 0, sizeof(PAColumnStats));
+	hdr.item = item;
+	hdr.stats_valid = stats->stats_valid;
+	hdr.stanullfrac = stats->stanullfrac;
+	hdr.stawidth = stats->stawidth;
+	hdr.stadistinct = stats->stadistinct;
+
+	len = sizeof(PAColumnStats);
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		hdr.stakind[k] = stats->stakind[k];
+		hdr.staop[k] = stats->staop[k];
+		hdr.stacoll[k] = stats->stacoll[k];
+		hdr.numnumbers[k] = stats->numnumbers[k];
+		hdr.numvalues[k] = stats->numvalues[k];
+		hdr.statypid[k] = stats->statypid[k];
+		hdr.statyplen[k] = stats->statyplen[k];
+		hdr.statypbyval[k] = stats->statypbyval[k];
+		hdr.statypalign[k] = stats->statypalign[k];
+
+		len = add_size(len, mul_size(sizeof(float4), stats->numnumbers[k]));
+		for (j = 0; j < stats->numvalues[k]; j++)
+			len = add_size(len,
+						   datumEstimateSpace(stats->stavalues[k][j], false,
+											  stats->statypbyval[k],
+											  stats->statyplen[k]));
+	}
+
+	buf = palloc(len);
+	memcpy(buf, &hdr, sizeof(PAColumnStats));
+	ptr = buf + sizeof(PAColumnStats);
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		if (stats->numnumbers[k] > 0)
+		{
+			memcpy(ptr, stats->stanumbers[k],
+				   sizeof(float4) * stats->numnumbers[k]);
+			ptr += sizeof(float4) * stats->numnumbers[k];
+		}
+		for (j = 0; j < stats->numvalues[k]; j++)
+			datumSerialize(stats->stavalues[k][j], false,
+						   stats->statypbyval[k], stats->statyplen[k], &ptr);
+	}
+	Assert(ptr == buf + len);
+
+	result = shm_mq_send(mqh, len, buf, false, true);
+	if (result != SHM_MQ_SUCCESS)
+		elog(ERROR, "could not send statistics to parallel analyze leader");
+
+	pfree(buf);
+}
+
+/*
+ * Store the statistics a worker computed for a column into the leader's
+ * VacAttrStats.
+ */
+static void
+receive_column_stats(VacAttrStats **itemstats, int nitems,
+					 char *data, Size nbytes)
+{
+	PAColumnStats hdr;
+	VacAttrStats *stats;
+	MemoryContext old_context;
+	char	   *ptr;
+	int			k;
+	int			j;
+
+	Assert(nbytes >= sizeof(PAColumnStats));
+	memcpy(&hdr, data, sizeof(PAColumnStats));
+	if (hdr.item < 0 || hdr.item >= nitems)
+		elog(ERROR, "invalid column in parallel analyze results");
+	stats = itemstats[hdr.item];
+
+	/* The results have to live as long as if we'd computed them ourselves */
+	old_context = MemoryContextSwitchTo(stats->anl_context);
+
+	stats->stats_valid = hdr.stats_valid;
+	stats->stanullfrac = hdr.stanullfrac;
+	stats->stawidth = hdr.stawidth;
+	stats->stadistinct = hdr.stadistinct;
+
+	ptr = data + sizeof(PAColumnStats);
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		stats->stakind[k] = hdr.stakind[k];
+		stats->staop[k] = hdr.staop[k];
+		stats->stacoll[k] = hdr.stacoll[k];
+		stats->numnumbers[k] = hdr.numnumbers[k];
+		stats->numvalues[k] = hdr.numvalues[k];
+		stats->statypid[k] = hdr.statypid[k];
+		stats->statyplen[k] = hdr.statyplen[k];
+		stats->statypbyval[k] = hdr.statypbyval[k];
+		stats->statypalign[k] = hdr.statypalign[k];
+
+		stats->stanumbers[k] = NULL;
+		if (hdr.numnumbers[k] > 0)
+		{
+			stats->stanumbers[k] = (float4 *)
+				palloc(sizeof(float4) * hdr.numnumbers[k]);
+			memcpy(stats->stanumbers[k], ptr,
+				   sizeof(float4) * hdr.numnumbers[k]);
+			ptr += sizeof(float4) * hdr.numnumbers[k];
+		}
+
+		stats->stavalues[k] = NULL;
+		if (hdr.numvalues[k] > 0)
+		{
+			stats->stavalues[k] = (Datum *)
+				palloc(sizeof(Datum) * hdr.numvalues[k]);
+			for (j = 0; j < hdr.numvalues[k]; j++)
+			{
+				bool		isnull;
+
+				stats->stavalues[k][j] = datumRestore(&ptr, &isnull);
+			}
+		}
+	}
+	Assert(ptr == data + nbytes);
+
+	MemoryContextSwitchTo(old_context);
+}
+
+/*
+ * Send the rows sampled from a child table to the leader.
+ */
+static void
+send_sampled_rows(shm_mq_handle *mqh, int item, HeapTuple *rows, int numrows,
+				  double totalrows, double totaldeadrows)
+{
+	PASampleHeader hdr;
+	shm_mq_result result;
+	int			i;
+
+	hdr.item = item;
+	hdr.numrows = numrows;
+	hdr.totalrows = totalrows;
+	hdr.totaldeadrows = totaldeadrows;
+	result = shm_mq_send(mqh, sizeof(PASampleHeader), &hdr, false,
+						 numrows == 0);
+
+	for (i = 0; i < numrows && result == SHM_MQ_SUCCESS; i++)
+	{
+		shm_mq_iovec iov[2];
+
+		iov[0].data = (const char *) &rows[i]->t_self;
+		iov[0].len = sizeof(ItemPointerData);
+		iov[1].data = (const char *) rows[i]->t_data;
+		iov[1].len = rows[i]->t_len;
+		result = shm_mq_sendv(mqh, iov, 2, false, i == numrows - 1);
+	}
+
+	if (result != SHM_MQ_SUCCESS)
+		elog(ERROR, "could not send sampled rows to parallel analyze leader");
+}
+
+/*
+ * Make a palloc'd copy of a row sent by send_sampled_rows.
+ */
+static HeapTuple
+copy_sampled_row(char *data, Size nbytes, Oid tableoid)
+{
+	HeapTuple	tuple;
+	Size		len = nbytes - sizeof(ItemPointerData);
+
+	tuple = (HeapTuple) palloc(HEAPTUPLESIZE + len);
+	tuple->t_len = len;
+	memcpy(&tuple->t_self, data, sizeof(ItemPointerData));
+	tuple->t_tableOid = tableoid;
+	tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+	memcpy(tuple->t_data, data + sizeof(ItemPointerData), len);
+
+	return tuple;
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+parallel_analyze_main(dsm_segment *seg, shm_toc *toc)
+{
+	PAShared   *shared;
+	PAItem	   *items;
+	char	   *sharedquery;
+	char	   *mqspace;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	Relation	onerel;
+	HeapTuple  *rows = NULL;
+	MemoryContext item_context;
+	MemoryContext old_context;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	int			item;
+
+	shared = (PAShared *) shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_SHARED,
+										 false);
+	items = (PAItem *) shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_ITEMS, false);
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Track query ID */
+	pgstat_report_query_id(shared->queryid, false);
+
+	/* Set up the queue to send our results to the leader through */
+	mqspace = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_QUEUES, false);
+	mq = (shm_mq *) (mqspace +
+					 ParallelWorkerNumber * (Size) PARALLEL_ANALYZE_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/*
+	 * The leader holds ShareUpdateExclusiveLock on the relation, which we can
+	 * take too, being in its lock group.
+	 */
+	onerel = table_open(shared->relid, ShareUpdateExclusiveLock);
+
+	/* Each parallel ANALYZE worker gets its own access strategy */
+	vac_strategy = GetAccessStrategyWithSize(BAS_VACUUM,
+											 shared->ring_nbuffers * (BLCKSZ / 1024));
+
+	/* Rebuild the sample from the copy in the DSM segment */
+	if (shared->phase == PARALLEL_ANALYZE_COMPUTE)
+	{
+		char	   *sample;
+		Size	   *offsets;
+		uint32	   *lengths;
+		HeapTupleData *tuples;
+		int			i;
+
+		sample = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_SAMPLE, false);
+		offsets = (Size *) sample;
+		lengths = (uint32 *) (sample + sizeof(Size) * shared->numrows);
+		rows = (HeapTuple *) palloc(shared->numrows * sizeof(HeapTuple));
+		tuples = (HeapTupleData *)
+			palloc(shared->numrows * sizeof(HeapTupleData));
+		for (i = 0; i < shared->numrows; i++)
+		{
+			tuples[i].t_len = lengths[i];
+			ItemPointerSetInvalid(&tuples[i].t_self);
+			tuples[i].t_tableOid = shared->relid;
+			tuples[i].t_data = (HeapTupleHeader) (sample + offsets[i]);
+			rows[i] = &tuples[i];
+		}
+	}
+
+	item_context = AllocSetContextCreate(CurrentMemoryContext,
+										 "Analyze",
+										 ALLOCSET_DEFAULT_SIZES);
+	anl_context = item_context;
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	while ((item = parallel_analyze_next_item(shared)) >= 0)
+	{
+		PAItem	   *pitem = &items[item];
+
+		old_context = MemoryContextSwitchTo(item_context);
+
+		if (shared->phase == PARALLEL_ANALYZE_ACQUIRE)
+		{
+			Relation	childrel;
+			HeapTuple  *childrows;
+			int			numrows;
+			double		totalrows,
+						totaldeadrows;
+
+			childrel = table_open(pitem->relid, AccessShareLock);
+			childrows = (HeapTuple *) palloc(pitem->targrows * sizeof(HeapTuple));
+			numrows = acquire_sample_rows(childrel, shared->elevel,
+										  childrows, pitem->targrows,
+										  &totalrows, &totaldeadrows);
+			send_sampled_rows(mqh, item, childrows, numrows,
+							  totalrows, totaldeadrows);
+			table_close(childrel, AccessShareLock);
+		}
+		else
+		{
+			VacAttrStats *stats;
+
+			stats = examine_attribute(onerel, pitem->attnum, NULL);
+			if (stats == NULL)
+				elog(ERROR, "column %d of relation \"%s\" cannot be analyzed",
+					 pitem->attnum, RelationGetRelationName(onerel));
+			stats->rows = rows;
+			stats->tupDesc = onerel->rd_att;
+			stats->compute_stats(stats,
+								 std_fetch_func,
+								 shared->numrows,
+								 shared->totalrows);
+			send_column_stats(mqh, item, stats);
+		}
+
+		MemoryContextSwitchTo(old_context);
+		MemoryContextReset(item_context);
+	}
+
+	/* Report buffer/WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	shm_mq_detach(mqh);
+	table_close(onerel, ShareUpdateExclusiveLock);
+	FreeAccessStrategy(vac_strategy);
+	MemoryContextDelete(item_context);
+	anl_context = NULL;
+}
+
+
 /*
  *	update_attstats() -- update attribute statistics for one relation
  *
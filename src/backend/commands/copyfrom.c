@@ -420,6 +420,19 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 						   buffer->bistate);
 		MemoryContextSwitchTo(oldcontext);
 
+		/*
+		 * Insert the whole batch into the indexes that can take it in one go.
+		 * Errors raised here can't be attributed to a single line, so report
+		 * only the relation name as for the FDW case above.
+		 */
+		if (resultRelInfo->ri_NumIndices > 0)
+		{
+			Assert(!cstate->relname_only);
+			cstate->relname_only = true;
+			ExecInsertIndexTuplesBatch(resultRelInfo, slots, nused, estate);
+			cstate->relname_only = false;
+		}
+
 		for (i = 0; i < nused; i++)
 		{
 			/*
@@ -434,7 +447,7 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 				recheckIndexes =
 					ExecInsertIndexTuples(resultRelInfo,
 										  buffer->slots[i], estate, false,
-										  false, NULL, NIL, false);
+										  false, NULL, NIL, false, true);
 				ExecARInsertTriggers(estate, resultRelInfo,
 									 slots[i], recheckIndexes,
 									 cstate->transition_capture);
@@ -1289,6 +1302,7 @@ CopyFrom(CopyFromState cstate)
 																   false,
 																   NULL,
 																   NIL,
+																   false,
 																   false);
 					}
 
@@ -28,20 +28,34 @@
 #include "access/reloptions.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/dependency.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_aggregate.h"
+#include "catalog/pg_inherits.h"
+#include "catalog/pg_namespace.h"
+#include "catalog/pg_trigger.h"
 #include "catalog/toasting.h"
 #include "commands/createas.h"
 #include "commands/matview.h"
 #include "commands/prepare.h"
 #include "commands/tablecmds.h"
+#include "commands/trigger.h"
 #include "commands/view.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_coerce.h"
+#include "parser/parse_collate.h"
+#include "parser/parse_func.h"
+#include "parser/parse_oper.h"
+#include "parser/parser.h"
 #include "rewrite/rewriteHandler.h"
+#include "rewrite/rewriteManip.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
+#include "utils/regproc.h"
 #include "utils/rel.h"
 #include "utils/rls.h"
 #include "utils/snapmgr.h"
@@ -62,6 +76,18 @@ typedef struct
 static ObjectAddress create_ctas_internal(List *attrList, IntoClause *into);
 static ObjectAddress create_ctas_nodata(List *tlist, IntoClause *into);
 
+/* utility functions for incremental materialized views */
+static void check_ivm_restriction(Query *query, List *colNames);
+static bool check_ivm_vars_walker(Node *node, void *context);
+static const char *ivm_aggregate_name(Aggref *aggref);
+static Query *rewrite_query_for_ivm(Query *query);
+static void add_ivm_hidden_column(ParseState *pstate, Query *query,
+								  const char *aggname, Node *arg,
+								  const char *colname);
+static void create_ivm_triggers(Oid matviewOid, Query *query);
+static void create_ivm_trigger(Oid relid, Oid matviewOid, int16 timing,
+							   int16 events);
+
 /* DestReceiver routines for collecting data */
 static void intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
 static bool intorel_receive(TupleTableSlot *slot, DestReceiver *self);
@@ -137,6 +163,15 @@ create_ctas_internal(List *attrList, IntoClause *into)
 
 		StoreViewQuery(intoRelationAddr.objectId, query, false);
 		CommandCounterIncrement();
+
+		if (into->ivm)
+		{
+			Relation	matviewRel;
+
+			matviewRel = table_open(intoRelationAddr.objectId, NoLock);
+			SetMatViewIVMState(matviewRel, true);
+			table_close(matviewRel, NoLock);
+		}
 	}
 
 	return intoRelationAddr;
@@ -214,6 +249,462 @@ create_ctas_nodata(List *tlist, IntoClause *into)
 }
 
 
+/*
+ * check_ivm_restriction
+ *
+ * Check that the query of an incremental materialized view is one whose
+ * changes can be derived from the changes to its base tables: an inner join
+ * of plain tables, optionally grouped, whose only aggregates are count, sum,
+ * avg, min and max.
+ */
+static void
+check_ivm_restriction(Query *query, List *colNames)
+{
+	List	   *relids = NIL;
+	ListCell   *lc;
+
+	if (query->cteList != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("WITH is not supported in incremental materialized views")));
+	if (query->setOperations != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("UNION, INTERSECT and EXCEPT are not supported in incremental materialized views")));
+	if (query->distinctClause != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("DISTINCT is not supported in incremental materialized views")));
+	if (query->havingQual != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("HAVING is not supported in incremental materialized views")));
+	if (query->groupingSets != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("GROUPING SETS, ROLLUP and CUBE are not supported in incremental materialized views")));
+	if (query->sortClause != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("ORDER BY is not supported in incremental materialized views")));
+	if (query->limitCount != NULL || query->limitOffset != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("LIMIT and OFFSET are not supported in incremental materialized views")));
+	if (query->rowMarks != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("FOR UPDATE and FOR SHARE are not supported in incremental materialized views")));
+	if (query->hasWindowFuncs)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("window functions are not supported in incremental materialized views")));
+	if (query->hasSubLinks)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("subqueries are not supported in incremental materialized views")));
+	if (query->hasTargetSRFs)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-returning functions are not supported in incremental materialized views")));
+	if (contain_volatile_functions((Node *) query))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("volatile functions are not supported in incremental materialized views")));
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		switch (rte->rtekind)
+		{
+			case RTE_RELATION:
+				if (rte->relkind != RELKIND_RELATION)
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("\"%s\" is not a table",
+									get_rel_name(rte->relid)),
+							 errdetail("Incremental materialized views can only reference plain tables.")));
+				if (rte->tablesample != NULL)
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("TABLESAMPLE is not supported in incremental materialized views")));
+				if (rte->inh && has_subclass(rte->relid))
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("table \"%s\" has inheritance children",
+									get_rel_name(rte->relid)),
+							 errhint("Use ONLY to reference the table by itself.")));
+				if (list_member_oid(relids, rte->relid))
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("table \"%s\" is referenced more than once",
+									get_rel_name(rte->relid)),
+							 errdetail("Self-joins are not supported in incremental materialized views.")));
+				relids = lappend_oid(relids, rte->relid);
+				break;
+			case RTE_JOIN:
+				if (rte->jointype != JOIN_INNER)
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("outer joins are not supported in incremental materialized views")));
+				break;
+			case RTE_GROUP:
+				break;
+			default:
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("incremental materialized views can only reference plain tables")));
+				break;
+		}
+	}
+
+	(void) query_tree_walker(query, check_ivm_vars_walker, NULL,
+							 QTW_IGNORE_JOINALIASES);
+
+	if (query->targetList == NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("incremental materialized views must have at least one column")));
+
+	foreach(lc, query->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		/* ORDER BY is rejected above, so only GROUP BY can add junk columns */
+		if (tle->resjunk)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("GROUP BY expressions must appear in the select list of incremental materialized views")));
+
+		if (strncmp(tle->resname, IVM_HIDDEN_COLUMN_PREFIX,
+					strlen(IVM_HIDDEN_COLUMN_PREFIX)) == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_RESERVED_NAME),
+					 errmsg("column name \"%s\" is reserved for incremental view maintenance",
+							tle->resname)));
+
+		if (query->hasAggs || query->groupClause != NIL)
+		{
+			Aggref	   *aggref;
+
+			if (!IsA(tle->expr, Aggref))
+			{
+				if (contain_aggs_of_level((Node *) tle->expr, 0))
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("expressions containing aggregate functions are not supported in incremental materialized views")));
+				continue;
+			}
+
+			aggref = (Aggref *) tle->expr;
+			if (ivm_aggregate_name(aggref) == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("aggregate function %s is not supported in incremental materialized views",
+								format_procedure(aggref->aggfnoid))));
+			if (aggref->aggdistinct != NIL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("aggregate functions with DISTINCT are not supported in incremental materialized views")));
+			if (aggref->aggorder != NIL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("aggregate functions with ORDER BY are not supported in incremental materialized views")));
+			if (aggref->aggfilter != NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("aggregate functions with FILTER are not supported in incremental materialized views")));
+
+			/* min and max are recomputed when the current value goes away */
+			if (strcmp(ivm_aggregate_name(aggref), "min") == 0 ||
+				strcmp(ivm_aggregate_name(aggref), "max") == 0)
+				get_sort_group_operators(aggref->aggtype, false, true, false,
+										 NULL, NULL, NULL, NULL);
+		}
+		else
+		{
+			/*
+			 * Without aggregation the view keeps duplicate rows, and deleted
+			 * rows are found by comparing all of their columns.
+			 */
+			get_sort_group_operators(exprType((Node *) tle->expr),
+									 true, true, false,
+									 NULL, NULL, NULL, NULL);
+		}
+	}
+
+	foreach(lc, colNames)
+	{
+		char	   *colname = strVal(lfirst(lc));
+
+		if (strncmp(colname, IVM_HIDDEN_COLUMN_PREFIX,
+					strlen(IVM_HIDDEN_COLUMN_PREFIX)) == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_RESERVED_NAME),
+					 errmsg("column name \"%s\" is reserved for incremental view maintenance",
+							colname)));
+	}
+
+	/* Hidden columns follow the view's own, so they can't be renamed */
+	if (list_length(colNames) > list_length(query->targetList))
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("too many column names were specified")));
+}
+
+/*
+ * Reject references to columns that the transition tables don't have.
+ */
+static bool
+check_ivm_vars_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varattno == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("whole-row references are not supported in incremental materialized views")));
+		if (var->varattno < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("system columns are not supported in incremental materialized views")));
+		return false;
+	}
+	return expression_tree_walker(node, check_ivm_vars_walker, context);
+}
+
+/*
+ * Return the name of the aggregate if incremental view maintenance knows how
+ * to maintain it, or NULL otherwise.
+ */
+static const char *
+ivm_aggregate_name(Aggref *aggref)
+{
+	static const char *const supported[] = {"count", "sum", "avg", "min", "max"};
+	char	   *aggname;
+
+	if (aggref->aggkind != AGGKIND_NORMAL ||
+		get_func_namespace(aggref->aggfnoid) != PG_CATALOG_NAMESPACE)
+		return NULL;
+
+	aggname = get_func_name(aggref->aggfnoid);
+	for (int i = 0; i < lengthof(supported); i++)
+	{
+		if (strcmp(aggname, supported[i]) == 0)
+			return supported[i];
+	}
+	return NULL;
+}
+
+/*
+ * rewrite_query_for_ivm
+ *
+ * Add the hidden columns needed to maintain an aggregate view to its query:
+ * the number of rows in each group, and the number of non-null inputs of each
+ * sum and avg, plus the sum behind each avg.  Base tables are also marked so
+ * that inheritance children that appear later aren't scanned, since changes
+ * to those wouldn't fire the maintenance triggers.
+ */
+static Query *
+rewrite_query_for_ivm(Query *query)
+{
+	ParseState *pstate;
+	List	   *tlist;
+	ListCell   *lc;
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind == RTE_RELATION)
+			rte->inh = false;
+	}
+
+	if (!query->hasAggs && query->groupClause == NIL)
+		return query;
+
+	pstate = make_parsestate(NULL);
+	pstate->p_rtable = query->rtable;
+	pstate->p_rteperminfos = query->rteperminfos;
+	pstate->p_expr_kind = EXPR_KIND_SELECT_TARGET;
+
+	add_ivm_hidden_column(pstate, query, "count", NULL, IVM_COUNT_COLUMN_NAME);
+
+	tlist = list_copy(query->targetList);
+	foreach(lc, tlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		Aggref	   *aggref;
+		const char *aggname;
+		Node	   *arg;
+
+		if (!IsA(tle->expr, Aggref))
+			continue;
+		aggref = (Aggref *) tle->expr;
+		aggname = ivm_aggregate_name(aggref);
+		if (aggname == NULL ||
+			(strcmp(aggname, "sum") != 0 && strcmp(aggname, "avg") != 0))
+			continue;
+
+		arg = (Node *) linitial_node(TargetEntry, aggref->args)->expr;
+
+		if (strcmp(aggname, "avg") == 0)
+		{
+			Node	   *sumarg;
+
+			/* Sum in the result type of avg, so that sum / count is avg */
+			sumarg = coerce_to_target_type(pstate, copyObject(arg),
+										   exprType(arg), aggref->aggtype, -1,
+										   COERCION_EXPLICIT,
+										   COERCE_EXPLICIT_CAST, -1);
+			if (sumarg == NULL)
+				elog(ERROR, "could not coerce %s to %s",
+					 format_type_be(exprType(arg)),
+					 format_type_be(aggref->aggtype));
+			add_ivm_hidden_column(pstate, query, "sum", sumarg,
+								  psprintf(IVM_HIDDEN_COLUMN_PREFIX "sum_%d__",
+										   tle->resno));
+		}
+		add_ivm_hidden_column(pstate, query, "count", copyObject(arg),
+							  psprintf(IVM_HIDDEN_COLUMN_PREFIX "count_%d__",
+									   tle->resno));
+	}
+
+	free_parsestate(pstate);
+
+	return query;
+}
+
+/*
+ * Append a hidden column computing the given aggregate over arg, or count(*)
+ * if arg is NULL, to the query's target list.
+ */
+static void
+add_ivm_hidden_column(ParseState *pstate, Query *query, const char *aggname,
+					  Node *arg, const char *colname)
+{
+	List	   *funcname = SystemFuncName(pstrdup(aggname));
+	List	   *fargs = arg ? list_make1(arg) : NIL;
+	FuncCall   *fn;
+	Node	   *expr;
+	TargetEntry *tle;
+
+	fn = makeFuncCall(funcname, fargs, COERCE_EXPLICIT_CALL, -1);
+	fn->agg_star = (arg == NULL);
+	expr = ParseFuncOrColumn(pstate, funcname, fargs, NULL, fn, false, -1);
+	assign_expr_collations(pstate, expr);
+
+	tle = makeTargetEntry((Expr *) expr,
+						  list_length(query->targetList) + 1,
+						  pstrdup(colname),
+						  false);
+	query->targetList = lappend(query->targetList, tle);
+}
+
+/*
+ * create_ivm_triggers
+ *
+ * Create the internal triggers that maintain an incremental materialized
+ * view on each of its base tables.  A statement-level BEFORE trigger notes
+ * that a statement is changing the table, and statement-level AFTER triggers
+ * apply the statement's changes, collected in transition tables, to the view.
+ */
+static void
+create_ivm_triggers(Oid matviewOid, Query *query)
+{
+	List	   *relids = NIL;
+	ListCell   *lc;
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind == RTE_RELATION)
+			relids = list_append_unique_oid(relids, rte->relid);
+	}
+
+	foreach_oid(relid, relids)
+	{
+		create_ivm_trigger(relid, matviewOid, TRIGGER_TYPE_BEFORE,
+						   TRIGGER_TYPE_INSERT | TRIGGER_TYPE_UPDATE |
+						   TRIGGER_TYPE_DELETE | TRIGGER_TYPE_TRUNCATE);
+		/* transition tables need a trigger per event */
+		create_ivm_trigger(relid, matviewOid, TRIGGER_TYPE_AFTER,
+						   TRIGGER_TYPE_INSERT);
+		create_ivm_trigger(relid, matviewOid, TRIGGER_TYPE_AFTER,
+						   TRIGGER_TYPE_UPDATE);
+		create_ivm_trigger(relid, matviewOid, TRIGGER_TYPE_AFTER,
+						   TRIGGER_TYPE_DELETE);
+		create_ivm_trigger(relid, matviewOid, TRIGGER_TYPE_AFTER,
+						   TRIGGER_TYPE_TRUNCATE);
+	}
+}
+
+static void
+create_ivm_trigger(Oid relid, Oid matviewOid, int16 timing, int16 events)
+{
+	CreateTrigStmt *ivm_trigger;
+	ObjectAddress trigAddress;
+	ObjectAddress matviewAddress;
+
+	ivm_trigger = makeNode(CreateTrigStmt);
+	ivm_trigger->replace = false;
+	ivm_trigger->isconstraint = false;
+	ivm_trigger->trigname = "IVM_trigger";
+	ivm_trigger->relation = NULL;
+	if (timing == TRIGGER_TYPE_BEFORE)
+		ivm_trigger->funcname = SystemFuncName("ivm_immediate_before");
+	else
+		ivm_trigger->funcname = SystemFuncName("ivm_immediate_maintenance");
+	ivm_trigger->args = list_make1(makeString(psprintf("%u", matviewOid)));
+	ivm_trigger->row = false;
+	ivm_trigger->timing = timing;
+	ivm_trigger->events = events;
+	ivm_trigger->columns = NIL;
+	ivm_trigger->whenClause = NULL;
+	ivm_trigger->transitionRels = NIL;
+	if (timing == TRIGGER_TYPE_AFTER &&
+		(events & (TRIGGER_TYPE_UPDATE | TRIGGER_TYPE_DELETE)))
+	{
+		TriggerTransition *tt = makeNode(TriggerTransition);
+
+		tt->name = IVM_OLD_TABLE_NAME;
+		tt->isNew = false;
+		tt->isTable = true;
+		ivm_trigger->transitionRels = lappend(ivm_trigger->transitionRels, tt);
+	}
+	if (timing == TRIGGER_TYPE_AFTER &&
+		(events & (TRIGGER_TYPE_INSERT | TRIGGER_TYPE_UPDATE)))
+	{
+		TriggerTransition *tt = makeNode(TriggerTransition);
+
+		tt->name = IVM_NEW_TABLE_NAME;
+		tt->isNew = true;
+		tt->isTable = true;
+		ivm_trigger->transitionRels = lappend(ivm_trigger->transitionRels, tt);
+	}
+	ivm_trigger->deferrable = false;
+	ivm_trigger->initdeferred = false;
+	ivm_trigger->constrrel = NULL;
+
+	trigAddress = CreateTrigger(ivm_trigger, NULL, relid, InvalidOid,
+								InvalidOid, InvalidOid, InvalidOid,
+								InvalidOid, NULL, true, false);
+
+	/* The trigger goes away along with the materialized view */
+	ObjectAddressSet(matviewAddress, RelationRelationId, matviewOid);
+	recordDependencyOn(&trigAddress, &matviewAddress, DEPENDENCY_AUTO);
+
+	/* Make changes-so-far visible */
+	CommandCounterIncrement();
+}
+
+
 /*
  * ExecCreateTableAs -- execute a CREATE TABLE AS command
  */
@@ -267,6 +758,19 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		into->skipData = true;
 	}
 
+	/*
+	 * An incrementally maintained view needs some additional columns for its
+	 * maintenance, which are added to a copy of the view's query so as not to
+	 * scribble on the statement.
+	 */
+	if (is_matview && into->ivm)
+	{
+		check_ivm_restriction(into->viewQuery, into->colNames);
+		into = copyObject(into);
+		into->viewQuery = rewrite_query_for_ivm(into->viewQuery);
+		query = into->viewQuery;
+	}
+
 	if (into->skipData)
 	{
 		/*
@@ -277,6 +781,10 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		 */
 		address = create_ctas_nodata(query->targetList, into);
 
+		/* Set up the triggers that keep an incremental view up to date */
+		if (is_matview && into->ivm)
+			create_ivm_triggers(address.objectId, into->viewQuery);
+
 		/*
 		 * For materialized views, reuse the REFRESH logic, which locks down
 		 * security-restricted operations and restricts the search_path.  This
@@ -128,6 +128,7 @@ static void show_sort_info(SortState *sortstate, ExplainState *es);
 static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
 									   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_nestloop_info(NestLoopState *nlstate, ExplainState *es);
 static void show_material_info(MaterialState *mstate, ExplainState *es);
 static void show_windowagg_info(WindowAggState *winstate, ExplainState *es);
 static void show_ctescan_info(CteScanState *ctescanstate, ExplainState *es);
@@ -137,6 +138,8 @@ static void show_recursive_union_info(RecursiveUnionState *rstate,
 									  ExplainState *es);
 static void show_memoize_info(MemoizeState *mstate, List *ancestors,
 							  ExplainState *es);
+static void show_redistribute_info(RedistributeState *rstate, List *ancestors,
+								   ExplainState *es);
 static void show_hashagg_info(AggState *aggstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 								ExplainState *es);
@@ -1055,6 +1058,9 @@ ExplainPrintJIT(ExplainState *es, int jit_flags, JitInstrumentation *ji)
 		es->indent++;
 
 		ExplainPropertyInteger("Functions", NULL, ji->created_functions, es);
+		if (ji->cached_functions > 0)
+			ExplainPropertyInteger("Cached Functions", NULL,
+								   ji->cached_functions, es);
 
 		ExplainIndentText(es);
 		appendStringInfo(es->str, "Options: %s %s, %s %s, %s %s, %s %s\n",
@@ -1081,6 +1087,8 @@ ExplainPrintJIT(ExplainState *es, int jit_flags, JitInstrumentation *ji)
 	else
 	{
 		ExplainPropertyInteger("Functions", NULL, ji->created_functions, es);
+		ExplainPropertyInteger("Cached Functions", NULL, ji->cached_functions,
+							   es);
 
 		ExplainOpenGroup("Options", "Options", true, es);
 		ExplainPropertyBool("Inlining", jit_flags & PGJIT_INLINE, es);
@@ -1568,6 +1576,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_GatherMerge:
 			pname = sname = "Gather Merge";
 			break;
+		case T_Redistribute:
+			pname = sname = "Redistribute";
+			break;
 		case T_IndexScan:
 			pname = sname = "Index Scan";
 			break;
@@ -2293,6 +2304,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 2,
 										   planstate, es);
+			if (es->analyze)
+				show_nestloop_info(castNode(NestLoopState, planstate), es);
 			break;
 		case T_MergeJoin:
 			show_upper_qual(((MergeJoin *) plan)->mergeclauses,
@@ -2380,6 +2393,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_memoize_info(castNode(MemoizeState, planstate), ancestors,
 							  es);
 			break;
+		case T_Redistribute:
+			show_redistribute_info(castNode(RedistributeState, planstate),
+								   ancestors, es);
+			break;
 		case T_RecursiveUnion:
 			show_recursive_union_info(castNode(RecursiveUnionState,
 											   planstate), es);
@@ -3383,6 +3400,34 @@ show_incremental_sort_info(IncrementalSortState *incrsortstate,
 	}
 }
 
+/*
+ * Show whether a nested loop switched to hashing its inner side.
+ *
+ * Only the local process's state is available; in a parallel query each
+ * worker decides on its own.
+ */
+static void
+show_nestloop_info(NestLoopState *nlstate, ExplainState *es)
+{
+	if (nlstate->nl_SwitchedAfter <= 0)
+		return;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainIndentText(es);
+		appendStringInfo(es->str,
+						 "Switched to Hashed Inner: after %.0f outer rows, %.0f inner rows hashed\n",
+						 nlstate->nl_SwitchedAfter, nlstate->nl_InnerHashed);
+	}
+	else
+	{
+		ExplainPropertyFloat("Switched to Hashed Inner After", "rows",
+							 nlstate->nl_SwitchedAfter, 0, es);
+		ExplainPropertyFloat("Hashed Inner Rows", NULL,
+							 nlstate->nl_InnerHashed, 0, es);
+	}
+}
+
 /*
  * Show information on hash buckets/batches.
  */
@@ -3734,6 +3779,38 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 	}
 }
 
+/*
+ * Show the keys and the number of partitions of a Redistribute node.
+ */
+static void
+show_redistribute_info(RedistributeState *rstate, List *ancestors,
+					   ExplainState *es)
+{
+	Redistribute *plan = (Redistribute *) rstate->ps.plan;
+	List	   *context;
+	List	   *result = NIL;
+	bool		useprefix;
+	ListCell   *lc;
+
+	useprefix = es->rtable_size > 1 || es->verbose;
+
+	/* Set up deparsing context */
+	context = set_deparse_context_plan(es->deparse_cxt,
+									   (Plan *) plan,
+									   ancestors);
+
+	foreach(lc, plan->hashkeys)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		result = lappend(result,
+						 deparse_expression(expr, context, useprefix, true));
+	}
+
+	ExplainPropertyList("Hash Key", result, es);
+	ExplainPropertyInteger("Partitions", NULL, plan->npartitions, es);
+}
+
 /*
  * Show information on hash aggregate memory usage and batches.
  */
@@ -24,22 +24,32 @@
 #include "catalog/namespace.h"
 #include "catalog/pg_am.h"
 #include "catalog/pg_opclass.h"
+#include "catalog/pg_type.h"
 #include "commands/cluster.h"
 #include "commands/matview.h"
 #include "commands/tablecmds.h"
 #include "commands/tablespace.h"
+#include "commands/trigger.h"
 #include "executor/executor.h"
 #include "executor/spi.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_oper.h"
 #include "pgstat.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/lmgr.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/guc.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
+#include "utils/tuplestore.h"
 
 
 typedef struct
@@ -984,3 +994,1028 @@ CloseMatViewIncrementalMaintenance(void)
 	matview_maintenance_depth--;
 	Assert(matview_maintenance_depth >= 0);
 }
+
+/*
+ * Incremental view maintenance
+ *
+ * An incremental materialized view has triggers on each of its base tables.
+ * The statement-level BEFORE trigger locks the view and records that a
+ * statement changing the table is in progress; the statement-level AFTER
+ * triggers compute the change to the view from the statement's transition
+ * tables and apply it.
+ *
+ * The change to the view is computed by running the view's query with the
+ * changed table replaced by the transition table, against the current
+ * contents of the other base tables.  That is only right if those don't have
+ * changes that aren't reflected in the view yet, which can happen when a
+ * statement changes several base tables (through triggers or data-modifying
+ * WITH queries).  In that case the view is instead recomputed from scratch
+ * once the last of those statements ends.  TRUNCATE has no transition tables,
+ * so it always leads to a recompute.
+ */
+typedef struct IvmOpenStatement
+{
+	Oid			matviewOid;		/* view to maintain */
+	Oid			relid;			/* base table being changed */
+	SubTransactionId subid;		/* subtransaction the statement started in */
+} IvmOpenStatement;
+
+/*
+ * A view that a transaction using a single snapshot has locked and found
+ * unchanged by transactions its snapshot doesn't see, see
+ * ivm_immediate_before().
+ */
+typedef struct IvmCheckedView
+{
+	Oid			matviewOid;
+	SubTransactionId subid;		/* subtransaction that took the lock */
+} IvmCheckedView;
+
+/* these lists are allocated in TopTransactionContext */
+static List *ivm_open_statements = NIL;
+static List *ivm_pending_recomputes = NIL;
+static List *ivm_checked_views = NIL;
+
+/* what a column of an aggregate view holds */
+typedef enum IvmColumnKind
+{
+	IVM_COLUMN_PLAIN,			/* neither a group key nor an aggregate */
+	IVM_COLUMN_GROUP_KEY,
+	IVM_COLUMN_COUNT,
+	IVM_COLUMN_SUM,
+	IVM_COLUMN_AVG,
+	IVM_COLUMN_MIN,
+	IVM_COLUMN_MAX,
+} IvmColumnKind;
+
+typedef struct IvmColumn
+{
+	IvmColumnKind kind;
+	const char *name;			/* quoted column name */
+	Oid			type;
+	Oid			eqop;			/* equality operator, if needed */
+	int			countcol;		/* count of non-null inputs of sum or avg */
+	int			sumcol;			/* sum behind avg */
+} IvmColumn;
+
+typedef struct IvmView
+{
+	Relation	matviewRel;
+	Query	   *query;			/* the view's query */
+	char	   *matviewname;	/* quoted, schema-qualified name */
+	bool		aggregate;		/* aggregates and/or GROUP BY? */
+	bool		grouped;		/* GROUP BY? */
+	bool		minmax;			/* any min or max columns? */
+	int			ncolumns;
+	IvmColumn  *columns;
+	int			countcol;		/* number of rows in the group */
+} IvmView;
+
+/* name of the ephemeral relation holding the change to the view */
+#define IVM_DELTA_NAME		"__ivm_delta"
+
+static Oid	ivm_trigger_matview(TriggerData *trigdata);
+static bool ivm_statements_in_progress(Oid matviewOid, Oid skip_relid);
+static void ivm_lock_for_xact_snapshot(Oid matviewOid);
+static bool ivm_changed_since_snapshot(Oid matviewOid);
+static bool ivm_xid_committed_unseen(TransactionId xid, Snapshot snapshot);
+static IvmView *ivm_open_view(Relation matviewRel);
+static int	ivm_find_column(IvmView *view, const char *resname);
+static char *ivm_delta_query(IvmView *view, Oid relid, const char *tablename);
+static Tuplestorestate *ivm_store_delta(IvmView *view, const char *query);
+static void ivm_drop_delta(Tuplestorestate *delta);
+static void ivm_append_match(StringInfo buf, IvmView *view,
+							 const char *left, const char *right);
+static void ivm_append_aggregate_updates(StringInfo buf, IvmView *view,
+										 bool insert);
+static void ivm_append_sum(StringInfo buf, IvmView *view, IvmColumn *col,
+						  bool insert);
+static void ivm_apply_delete(IvmView *view, Oid relid);
+static void ivm_apply_insert(IvmView *view, Oid relid);
+static void ivm_recompute_minmax(IvmView *view);
+static void ivm_recompute(IvmView *view);
+
+/*
+ * SetMatViewIVMState
+ *		Mark a materialized view as incrementally maintained, or not.
+ *
+ * NOTE: caller must be holding an appropriate lock on the relation.
+ */
+void
+SetMatViewIVMState(Relation relation, bool newstate)
+{
+	Relation	pgrel;
+	HeapTuple	tuple;
+
+	Assert(relation->rd_rel->relkind == RELKIND_MATVIEW);
+
+	pgrel = table_open(RelationRelationId, RowExclusiveLock);
+	tuple = SearchSysCacheCopy1(RELOID,
+								ObjectIdGetDatum(RelationGetRelid(relation)));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for relation %u",
+			 RelationGetRelid(relation));
+
+	((Form_pg_class) GETSTRUCT(tuple))->relisivm = newstate;
+
+	CatalogTupleUpdate(pgrel, &tuple->t_self, tuple);
+
+	heap_freetuple(tuple);
+	table_close(pgrel, RowExclusiveLock);
+
+	CommandCounterIncrement();
+}
+
+/*
+ * ivm_immediate_before
+ *		BEFORE statement trigger on the base tables of an incremental view.
+ */
+Datum
+ivm_immediate_before(PG_FUNCTION_ARGS)
+{
+	TriggerData *trigdata = (TriggerData *) fcinfo->context;
+	Oid			matviewOid;
+	MemoryContext oldcxt;
+	IvmOpenStatement *stmt;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		elog(ERROR, "ivm_immediate_before: not fired by trigger manager");
+
+	matviewOid = ivm_trigger_matview(trigdata);
+
+	/*
+	 * Changes to the view are serialized by this lock, which is held until
+	 * the end of the transaction.
+	 */
+	if (!IsolationUsesXactSnapshot())
+		LockRelationOid(matviewOid, ExclusiveLock);
+	else
+		ivm_lock_for_xact_snapshot(matviewOid);
+
+	oldcxt = MemoryContextSwitchTo(TopTransactionContext);
+	stmt = palloc(sizeof(IvmOpenStatement));
+	stmt->matviewOid = matviewOid;
+	stmt->relid = RelationGetRelid(trigdata->tg_relation);
+	stmt->subid = GetCurrentSubTransactionId();
+	ivm_open_statements = lappend(ivm_open_statements, stmt);
+	MemoryContextSwitchTo(oldcxt);
+
+	return PointerGetDatum(NULL);
+}
+
+/*
+ * Lock a view for maintenance by a transaction using a single snapshot.
+ *
+ * Such a transaction can't see the changes of transactions that committed
+ * after its snapshot was taken, so it can't maintain the view correctly if
+ * any of them changed the view.  That is certainly the case if we have to
+ * wait for the lock, but a transaction may also have changed the view and
+ * committed before we came along.  Either way, we raise a serialization
+ * failure, like heap_update() does when the tuple to update was changed by
+ * a concurrent transaction.
+ */
+static void
+ivm_lock_for_xact_snapshot(Oid matviewOid)
+{
+	MemoryContext oldcxt;
+	IvmCheckedView *checked;
+
+	/* Nobody else can have changed the view since we last checked */
+	foreach_ptr(IvmCheckedView, view, ivm_checked_views)
+	{
+		if (view->matviewOid == matviewOid)
+			return;
+	}
+
+	if (!ConditionalLockRelationOid(matviewOid, ExclusiveLock))
+	{
+		LockRelationOid(matviewOid, ExclusiveLock);
+		ereport(ERROR,
+				(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+				 errmsg("could not serialize access due to concurrent update of materialized view \"%s\"",
+						get_rel_name(matviewOid))));
+	}
+
+	if (ivm_changed_since_snapshot(matviewOid))
+		ereport(ERROR,
+				(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+				 errmsg("could not serialize access due to concurrent update of materialized view \"%s\"",
+						get_rel_name(matviewOid))));
+
+	oldcxt = MemoryContextSwitchTo(TopTransactionContext);
+	checked = palloc(sizeof(IvmCheckedView));
+	checked->matviewOid = matviewOid;
+	checked->subid = GetCurrentSubTransactionId();
+	ivm_checked_views = lappend(ivm_checked_views, checked);
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Has the view been changed by a transaction that the transaction snapshot
+ * doesn't see?
+ *
+ * The view's rows are only changed by holders of its ExclusiveLock, which
+ * the caller holds now, so all such transactions have ended.  It's enough to
+ * look for rows inserted or deleted by a committed transaction that the
+ * snapshot considers to be in progress.
+ */
+static bool
+ivm_changed_since_snapshot(Oid matviewOid)
+{
+	Snapshot	snapshot = GetTransactionSnapshot();
+	Relation	matviewRel;
+	TableScanDesc scan;
+	HeapTuple	tuple;
+	bool		changed = false;
+
+	matviewRel = table_open(matviewOid, NoLock);
+	scan = table_beginscan(matviewRel, SnapshotAny, 0, NULL);
+	while (!changed &&
+		   (tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		HeapTupleHeader htup = tuple->t_data;
+
+		if (ivm_xid_committed_unseen(HeapTupleHeaderGetXmin(htup), snapshot))
+			changed = true;
+		else if (!(htup->t_infomask & HEAP_XMAX_INVALID) &&
+				 !HEAP_XMAX_IS_LOCKED_ONLY(htup->t_infomask) &&
+				 ivm_xid_committed_unseen(HeapTupleHeaderGetUpdateXid(htup),
+										  snapshot))
+			changed = true;
+	}
+	table_endscan(scan);
+	table_close(matviewRel, NoLock);
+
+	return changed;
+}
+
+/*
+ * Did xid commit without being visible to the snapshot?
+ */
+static bool
+ivm_xid_committed_unseen(TransactionId xid, Snapshot snapshot)
+{
+	return TransactionIdIsNormal(xid) &&
+		XidInMVCCSnapshot(xid, snapshot) &&
+		TransactionIdDidCommit(xid);
+}
+
+/*
+ * ivm_immediate_maintenance
+ *		AFTER statement trigger on the base tables of an incremental view,
+ *		which applies the statement's changes to the view.
+ */
+Datum
+ivm_immediate_maintenance(PG_FUNCTION_ARGS)
+{
+	TriggerData *trigdata = (TriggerData *) fcinfo->context;
+	Oid			matviewOid;
+	Oid			relid;
+	bool		recompute;
+	Relation	matviewRel;
+	Oid			save_userid;
+	int			save_sec_context;
+	int			save_nestlevel;
+	int			old_depth = matview_maintenance_depth;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		elog(ERROR, "ivm_immediate_maintenance: not fired by trigger manager");
+
+	matviewOid = ivm_trigger_matview(trigdata);
+	relid = RelationGetRelid(trigdata->tg_relation);
+
+	/* The statement is done, so forget about it */
+	for (int i = list_length(ivm_open_statements) - 1; i >= 0; i--)
+	{
+		IvmOpenStatement *stmt = list_nth(ivm_open_statements, i);
+
+		if (stmt->matviewOid == matviewOid && stmt->relid == relid)
+		{
+			ivm_open_statements = list_delete_nth_cell(ivm_open_statements, i);
+			pfree(stmt);
+			break;
+		}
+	}
+
+	/*
+	 * Decide between applying the changes and recomputing the view, which
+	 * might have to wait for other statements to end.  Nested statements on
+	 * the same table are fine for the former, since the view's query
+	 * references each table only once.
+	 */
+	recompute = TRIGGER_FIRED_BY_TRUNCATE(trigdata->tg_event) ||
+		list_member_oid(ivm_pending_recomputes, matviewOid);
+	if (ivm_statements_in_progress(matviewOid,
+								   recompute ? InvalidOid : relid))
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(TopTransactionContext);
+
+		ivm_pending_recomputes = list_append_unique_oid(ivm_pending_recomputes,
+														matviewOid);
+		MemoryContextSwitchTo(oldcxt);
+		return PointerGetDatum(NULL);
+	}
+	if (recompute)
+		ivm_pending_recomputes = list_delete_oid(ivm_pending_recomputes,
+												 matviewOid);
+
+	/* Already locked by the BEFORE trigger */
+	matviewRel = table_open(matviewOid, ExclusiveLock);
+
+	/* Nothing to do until the view is refreshed */
+	if (!RelationIsPopulated(matviewRel))
+	{
+		table_close(matviewRel, NoLock);
+		return PointerGetDatum(NULL);
+	}
+
+	/* Run as the view's owner, like REFRESH MATERIALIZED VIEW */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(matviewRel->rd_rel->relowner,
+						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
+	save_nestlevel = NewGUCNestLevel();
+	RestrictSearchPath();
+
+	PG_TRY();
+	{
+		IvmView    *view;
+
+		if (SPI_connect() != SPI_OK_CONNECT)
+			elog(ERROR, "SPI_connect failed");
+		if (SPI_register_trigger_data(trigdata) != SPI_OK_TD_REGISTER)
+			elog(ERROR, "SPI_register_trigger_data failed");
+
+		OpenMatViewIncrementalMaintenance();
+
+		view = ivm_open_view(matviewRel);
+		if (recompute)
+			ivm_recompute(view);
+		else
+		{
+			if (trigdata->tg_oldtable != NULL &&
+				tuplestore_tuple_count(trigdata->tg_oldtable) > 0)
+				ivm_apply_delete(view, relid);
+			if (trigdata->tg_newtable != NULL &&
+				tuplestore_tuple_count(trigdata->tg_newtable) > 0)
+				ivm_apply_insert(view, relid);
+		}
+
+		CloseMatViewIncrementalMaintenance();
+
+		if (SPI_finish() != SPI_OK_FINISH)
+			elog(ERROR, "SPI_finish failed");
+	}
+	PG_CATCH();
+	{
+		matview_maintenance_depth = old_depth;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	/* Roll back any GUC changes */
+	AtEOXact_GUC(false, save_nestlevel);
+
+	/* Restore userid and security context */
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	table_close(matviewRel, NoLock);
+
+	return PointerGetDatum(NULL);
+}
+
+/*
+ * Get the OID of the view maintained by an IVM trigger.
+ */
+static Oid
+ivm_trigger_matview(TriggerData *trigdata)
+{
+	Trigger    *trigger = trigdata->tg_trigger;
+
+	if (!TRIGGER_FIRED_FOR_STATEMENT(trigdata->tg_event) ||
+		trigger->tgnargs != 1)
+		elog(ERROR, "invalid incremental view maintenance trigger \"%s\"",
+			 trigger->tgname);
+
+	return DatumGetObjectId(DirectFunctionCall1(oidin,
+												CStringGetDatum(trigger->tgargs[0])));
+}
+
+/*
+ * Are statements on base tables of the view other than skip_relid still in
+ * progress?
+ */
+static bool
+ivm_statements_in_progress(Oid matviewOid, Oid skip_relid)
+{
+	foreach_ptr(IvmOpenStatement, stmt, ivm_open_statements)
+	{
+		if (stmt->matviewOid == matviewOid && stmt->relid != skip_relid)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Collect what we need to know about an incremental view's columns.
+ */
+static IvmView *
+ivm_open_view(Relation matviewRel)
+{
+	IvmView    *view = palloc0(sizeof(IvmView));
+	TupleDesc	tupdesc = RelationGetDescr(matviewRel);
+	Query	   *query;
+
+	if (matviewRel->rd_rules == NULL || matviewRel->rd_rules->numLocks != 1)
+		elog(ERROR, "materialized view \"%s\" is missing rewrite information",
+			 RelationGetRelationName(matviewRel));
+	query = linitial_node(Query, matviewRel->rd_rules->rules[0]->actions);
+
+	view->matviewRel = matviewRel;
+	view->query = copyObject(query);
+	view->matviewname =
+		quote_qualified_identifier(get_namespace_name(RelationGetNamespace(matviewRel)),
+								   RelationGetRelationName(matviewRel));
+	view->aggregate = query->hasAggs || query->groupClause != NIL;
+	view->grouped = query->groupClause != NIL;
+	view->ncolumns = list_length(query->targetList);
+	view->columns = palloc0(sizeof(IvmColumn) * view->ncolumns);
+	view->countcol = -1;
+
+	foreach_node(TargetEntry, tle, query->targetList)
+	{
+		IvmColumn  *col = &view->columns[tle->resno - 1];
+		SortGroupClause *sgc;
+
+		col->name = quote_identifier(NameStr(TupleDescAttr(tupdesc, tle->resno - 1)->attname));
+		col->type = exprType((Node *) tle->expr);
+		col->kind = IVM_COLUMN_PLAIN;
+		col->countcol = -1;
+		col->sumcol = -1;
+
+		if (!view->aggregate)
+		{
+			/* rows to delete are found by comparing all columns */
+			get_sort_group_operators(col->type, false, true, false,
+									 NULL, &col->eqop, NULL, NULL);
+		}
+		else if (IsA(tle->expr, Aggref))
+		{
+			char	   *aggname = get_func_name(((Aggref *) tle->expr)->aggfnoid);
+
+			if (strcmp(aggname, "count") == 0)
+				col->kind = IVM_COLUMN_COUNT;
+			else if (strcmp(aggname, "sum") == 0)
+				col->kind = IVM_COLUMN_SUM;
+			else if (strcmp(aggname, "avg") == 0)
+				col->kind = IVM_COLUMN_AVG;
+			else if (strcmp(aggname, "min") == 0)
+				col->kind = IVM_COLUMN_MIN;
+			else if (strcmp(aggname, "max") == 0)
+				col->kind = IVM_COLUMN_MAX;
+			else
+				elog(ERROR, "unexpected aggregate %s in incremental materialized view",
+					 aggname);
+
+			if (col->kind == IVM_COLUMN_MIN || col->kind == IVM_COLUMN_MAX)
+			{
+				get_sort_group_operators(col->type, false, true, false,
+										 NULL, &col->eqop, NULL, NULL);
+				view->minmax = true;
+			}
+		}
+		else if (tle->ressortgroupref != 0 &&
+				 (sgc = get_sortgroupref_clause_noerr(tle->ressortgroupref,
+													  query->groupClause)) != NULL)
+		{
+			col->kind = IVM_COLUMN_GROUP_KEY;
+			col->eqop = sgc->eqop;
+		}
+	}
+
+	if (!view->aggregate)
+		return view;
+
+	/* Find the hidden columns, which are all counts and sums */
+	view->countcol = ivm_find_column(view, IVM_COUNT_COLUMN_NAME);
+	for (int i = 0; i < view->ncolumns; i++)
+	{
+		IvmColumn  *col = &view->columns[i];
+
+		if (col->kind != IVM_COLUMN_SUM && col->kind != IVM_COLUMN_AVG)
+			continue;
+
+		col->countcol = ivm_find_column(view,
+										psprintf(IVM_HIDDEN_COLUMN_PREFIX "count_%d__",
+												 i + 1));
+		view->columns[col->countcol].kind = IVM_COLUMN_COUNT;
+
+		if (col->kind == IVM_COLUMN_AVG)
+		{
+			col->sumcol = ivm_find_column(view,
+										  psprintf(IVM_HIDDEN_COLUMN_PREFIX "sum_%d__",
+												   i + 1));
+			view->columns[col->sumcol].kind = IVM_COLUMN_SUM;
+			view->columns[col->sumcol].countcol = col->countcol;
+		}
+	}
+
+	return view;
+}
+
+/*
+ * Find a hidden column by the name the view's query gives it.  (The view's
+ * columns might have been renamed since.)
+ */
+static int
+ivm_find_column(IvmView *view, const char *resname)
+{
+	foreach_node(TargetEntry, tle, view->query->targetList)
+	{
+		if (strcmp(tle->resname, resname) == 0)
+			return tle->resno - 1;
+	}
+
+	elog(ERROR, "materialized view \"%s\" has no column \"%s\"",
+		 RelationGetRelationName(view->matviewRel), resname);
+	return -1;					/* keep compiler quiet */
+}
+
+/*
+ * Build the query computing the change to the view from one of the
+ * transition tables of a base table, by substituting the transition table for
+ * the table in the view's query.
+ */
+static char *
+ivm_delta_query(IvmView *view, Oid relid, const char *tablename)
+{
+	Query	   *query = copyObject(view->query);
+
+	foreach_node(RangeTblEntry, rte, query->rtable)
+	{
+		Relation	rel;
+		TupleDesc	tupdesc;
+		List	   *colnames = NIL;
+
+		if (rte->rtekind != RTE_RELATION || rte->relid != relid)
+			continue;
+
+		/*
+		 * The transition table has the table's current columns, whose names
+		 * might have changed since the view was created.
+		 */
+		rel = table_open(relid, NoLock);
+		tupdesc = RelationGetDescr(rel);
+		for (int i = 0; i < tupdesc->natts; i++)
+		{
+			Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+
+			colnames = lappend(colnames,
+							   makeString(pstrdup(attr->attisdropped ? "" :
+												  NameStr(attr->attname))));
+		}
+		table_close(rel, NoLock);
+
+		/* Keep the table's name for the column references */
+		if (rte->alias == NULL)
+			rte->alias = makeAlias(rte->eref->aliasname, NIL);
+		rte->eref = makeAlias(rte->eref->aliasname, colnames);
+
+		rte->rtekind = RTE_NAMEDTUPLESTORE;
+		rte->relid = InvalidOid;
+		rte->relkind = 0;
+		rte->rellockmode = NoLock;
+		rte->perminfoindex = 0;
+		rte->enrname = pstrdup(tablename);
+	}
+
+	return pg_get_querydef(query, false);
+}
+
+/*
+ * Run a delta query and keep its result as an ephemeral named relation, to
+ * be used by the statements that apply it to the view.  Returns NULL if the
+ * view doesn't change.
+ */
+static Tuplestorestate *
+ivm_store_delta(IvmView *view, const char *query)
+{
+	Tuplestorestate *delta;
+	EphemeralNamedRelation enr;
+
+	if (SPI_execute(query, false, 0) != SPI_OK_SELECT)
+		elog(ERROR, "SPI_exec failed: %s", query);
+	if (SPI_processed == 0)
+		return NULL;
+
+	delta = tuplestore_begin_heap(false, false, work_mem);
+	for (uint64 i = 0; i < SPI_processed; i++)
+		tuplestore_puttuple(delta, SPI_tuptable->vals[i]);
+	SPI_freetuptable(SPI_tuptable);
+
+	/* The delta has the view's row type */
+	enr = palloc(sizeof(EphemeralNamedRelationData));
+	enr->md.name = IVM_DELTA_NAME;
+	enr->md.reliddesc = InvalidOid;
+	enr->md.tupdesc = CreateTupleDescCopy(RelationGetDescr(view->matviewRel));
+	enr->md.enrtype = ENR_NAMED_TUPLESTORE;
+	enr->md.enrtuples = tuplestore_tuple_count(delta);
+	enr->reldata = delta;
+	if (SPI_register_relation(enr) != SPI_OK_REL_REGISTER)
+		elog(ERROR, "SPI_register_relation failed");
+
+	return delta;
+}
+
+static void
+ivm_drop_delta(Tuplestorestate *delta)
+{
+	if (SPI_unregister_relation(IVM_DELTA_NAME) != SPI_OK_REL_UNREGISTER)
+		elog(ERROR, "SPI_unregister_relation failed");
+	tuplestore_end(delta);
+}
+
+/*
+ * Append a condition matching rows of the view with rows of the delta that
+ * belong to the same group, or for a view without aggregates that are equal.
+ * NULLs match each other here, as they do for grouping.
+ */
+static void
+ivm_append_match(StringInfo buf, IvmView *view,
+				 const char *left, const char *right)
+{
+	bool		first = true;
+
+	for (int i = 0; i < view->ncolumns; i++)
+	{
+		IvmColumn  *col = &view->columns[i];
+		char	   *leftop;
+		char	   *rightop;
+
+		if (view->aggregate && col->kind != IVM_COLUMN_GROUP_KEY)
+			continue;
+
+		leftop = psprintf("%s.%s", left, col->name);
+		rightop = psprintf("%s.%s", right, col->name);
+
+		if (!first)
+			appendStringInfoString(buf, " AND ");
+		appendStringInfoChar(buf, '(');
+		generate_operator_clause(buf, leftop, col->type, col->eqop,
+								 rightop, col->type);
+		appendStringInfo(buf, " OR (%s IS NULL AND %s IS NULL))",
+						 leftop, rightop);
+		first = false;
+	}
+
+	if (first)
+		appendStringInfoString(buf, "true");
+}
+
+/*
+ * Append the SET list of an UPDATE folding the aggregates of the delta "d"
+ * into the matching groups of the view "mv".
+ */
+static void
+ivm_append_aggregate_updates(StringInfo buf, IvmView *view, bool insert)
+{
+	bool		first = true;
+
+	for (int i = 0; i < view->ncolumns; i++)
+	{
+		IvmColumn  *col = &view->columns[i];
+		char	   *mvcol = psprintf("mv.%s", col->name);
+		char	   *dcol = psprintf("d.%s", col->name);
+
+		if (col->kind == IVM_COLUMN_PLAIN || col->kind == IVM_COLUMN_GROUP_KEY)
+			continue;
+
+		if (!first)
+			appendStringInfoString(buf, ", ");
+		first = false;
+		appendStringInfo(buf, "%s = ", col->name);
+
+		switch (col->kind)
+		{
+			case IVM_COLUMN_COUNT:
+				appendStringInfo(buf, "%s OPERATOR(pg_catalog.%s) %s",
+								 mvcol, insert ? "+" : "-", dcol);
+				break;
+			case IVM_COLUMN_SUM:
+				ivm_append_sum(buf, view, col, insert);
+				break;
+			case IVM_COLUMN_AVG:
+				{
+					IvmColumn  *countcol = &view->columns[col->countcol];
+					Oid			divtype;
+
+					/* interval is divided by float8 */
+					divtype = (col->type == INTERVALOID) ? FLOAT8OID : col->type;
+					appendStringInfoChar(buf, '(');
+					ivm_append_sum(buf, view, &view->columns[col->sumcol],
+								   insert);
+					appendStringInfo(buf,
+									 ") / (mv.%s OPERATOR(pg_catalog.%s) d.%s)::%s",
+									 countcol->name, insert ? "+" : "-",
+									 countcol->name,
+									 format_type_be_qualified(divtype));
+				}
+				break;
+			case IVM_COLUMN_MIN:
+			case IVM_COLUMN_MAX:
+				if (insert)
+					appendStringInfo(buf, "%s(%s, %s)",
+									 col->kind == IVM_COLUMN_MIN ? "LEAST" : "GREATEST",
+									 mvcol, dcol);
+				else
+				{
+					/* removing the current value calls for a recompute */
+					appendStringInfoString(buf, "CASE WHEN ");
+					generate_operator_clause(buf, mvcol, col->type, col->eqop,
+											 dcol, col->type);
+					appendStringInfo(buf, " THEN NULL ELSE %s END", mvcol);
+				}
+				break;
+			default:
+				elog(ERROR, "unexpected column kind %d", (int) col->kind);
+				break;
+		}
+	}
+}
+
+/*
+ * Append the new value of a sum.  A sum is NULL rather than zero while it has
+ * no non-null inputs.
+ */
+static void
+ivm_append_sum(StringInfo buf, IvmView *view, IvmColumn *col, bool insert)
+{
+	IvmColumn  *countcol = &view->columns[col->countcol];
+
+	appendStringInfoString(buf, "CASE ");
+	if (!insert)
+		appendStringInfo(buf,
+						 "WHEN mv.%s OPERATOR(pg_catalog.=) d.%s THEN NULL ",
+						 countcol->name, countcol->name);
+	appendStringInfo(buf, "WHEN d.%s IS NULL THEN mv.%s ",
+					 col->name, col->name);
+	if (insert)
+		appendStringInfo(buf, "WHEN mv.%s IS NULL THEN d.%s ",
+						 col->name, col->name);
+	appendStringInfo(buf, "ELSE mv.%s OPERATOR(pg_catalog.%s) d.%s END",
+					 col->name, insert ? "+" : "-", col->name);
+}
+
+/*
+ * Apply the rows removed from a base table to the view.
+ */
+static void
+ivm_apply_delete(IvmView *view, Oid relid)
+{
+	Tuplestorestate *delta;
+	StringInfoData querybuf;
+
+	delta = ivm_store_delta(view, ivm_delta_query(view, relid,
+												  IVM_OLD_TABLE_NAME));
+	if (delta == NULL)
+		return;
+
+	initStringInfo(&querybuf);
+
+	if (view->aggregate)
+	{
+		appendStringInfo(&querybuf, "UPDATE %s mv SET ", view->matviewname);
+		ivm_append_aggregate_updates(&querybuf, view, false);
+		appendStringInfoString(&querybuf, " FROM " IVM_DELTA_NAME " d WHERE ");
+		ivm_append_match(&querybuf, view, "mv", "d");
+		if (SPI_exec(querybuf.data, 0) != SPI_OK_UPDATE)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+		/* Drop groups that have no rows left */
+		if (view->grouped)
+		{
+			resetStringInfo(&querybuf);
+			appendStringInfo(&querybuf,
+							 "DELETE FROM %s mv WHERE mv.%s OPERATOR(pg_catalog.=) 0",
+							 view->matviewname,
+							 view->columns[view->countcol].name);
+			if (SPI_exec(querybuf.data, 0) != SPI_OK_DELETE)
+				elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+		}
+
+		if (view->minmax)
+			ivm_recompute_minmax(view);
+	}
+	else
+	{
+		StringInfoData columns;
+		StringInfoData dcolumns;
+
+		/*
+		 * The view keeps duplicates, so delete as many of the equal rows as
+		 * the delta has.
+		 */
+		initStringInfo(&columns);
+		initStringInfo(&dcolumns);
+		for (int i = 0; i < view->ncolumns; i++)
+		{
+			appendStringInfo(&columns, "%smv.%s",
+							 i > 0 ? ", " : "", view->columns[i].name);
+			appendStringInfo(&dcolumns, "%sd.%s",
+							 i > 0 ? ", " : "", view->columns[i].name);
+		}
+
+		appendStringInfo(&querybuf,
+						 "DELETE FROM %s mv USING "
+						 "(SELECT t.__ivm_tid__ FROM "
+						 "(SELECT mv.ctid AS __ivm_tid__, "
+						 "pg_catalog.row_number() OVER (PARTITION BY %s) AS __ivm_rn__, %s "
+						 "FROM %s mv WHERE EXISTS (SELECT 1 FROM " IVM_DELTA_NAME " d WHERE ",
+						 view->matviewname, columns.data, columns.data,
+						 view->matviewname);
+		ivm_append_match(&querybuf, view, "mv", "d");
+		appendStringInfo(&querybuf,
+						 ")) t, "
+						 "(SELECT %s, pg_catalog.count(*) AS __ivm_count__ "
+						 "FROM " IVM_DELTA_NAME " d GROUP BY %s) dd WHERE ",
+						 dcolumns.data, dcolumns.data);
+		ivm_append_match(&querybuf, view, "t", "dd");
+		appendStringInfoString(&querybuf,
+							   " AND t.__ivm_rn__ OPERATOR(pg_catalog.<=) dd.__ivm_count__) x "
+							   "WHERE mv.ctid OPERATOR(pg_catalog.=) x.__ivm_tid__");
+		if (SPI_exec(querybuf.data, 0) != SPI_OK_DELETE)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+	}
+
+	ivm_drop_delta(delta);
+}
+
+/*
+ * Apply the rows added to a base table to the view.
+ */
+static void
+ivm_apply_insert(IvmView *view, Oid relid)
+{
+	Tuplestorestate *delta;
+	StringInfoData querybuf;
+
+	initStringInfo(&querybuf);
+
+	/* Without aggregates, the delta's rows just get added */
+	if (!view->aggregate)
+	{
+		appendStringInfo(&querybuf, "INSERT INTO %s %s", view->matviewname,
+						 ivm_delta_query(view, relid, IVM_NEW_TABLE_NAME));
+		if (SPI_exec(querybuf.data, 0) != SPI_OK_INSERT)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+		return;
+	}
+
+	delta = ivm_store_delta(view, ivm_delta_query(view, relid,
+												  IVM_NEW_TABLE_NAME));
+	if (delta == NULL)
+		return;
+
+	/* Update the groups the view has already ... */
+	appendStringInfo(&querybuf, "UPDATE %s mv SET ", view->matviewname);
+	ivm_append_aggregate_updates(&querybuf, view, true);
+	appendStringInfoString(&querybuf, " FROM " IVM_DELTA_NAME " d WHERE ");
+	ivm_append_match(&querybuf, view, "mv", "d");
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_UPDATE)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	/* ... and add the others */
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf,
+					 "INSERT INTO %s SELECT * FROM " IVM_DELTA_NAME " d "
+					 "WHERE NOT EXISTS (SELECT 1 FROM %s mv WHERE ",
+					 view->matviewname, view->matviewname);
+	ivm_append_match(&querybuf, view, "mv", "d");
+	appendStringInfoChar(&querybuf, ')');
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_INSERT)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	ivm_drop_delta(delta);
+}
+
+/*
+ * Look up the min and max values of the groups in the delta that lost their
+ * current one, which ivm_append_aggregate_updates set to NULL.  (Groups whose
+ * inputs are all NULL get looked up again too, which is harmless.)
+ */
+static void
+ivm_recompute_minmax(IvmView *view)
+{
+	StringInfoData querybuf;
+	StringInfoData targets;
+	StringInfoData values;
+	StringInfoData nulls;
+	StringInfoData aliases;
+
+	initStringInfo(&targets);
+	initStringInfo(&values);
+	initStringInfo(&nulls);
+	initStringInfo(&aliases);
+	for (int i = 0; i < view->ncolumns; i++)
+	{
+		IvmColumn  *col = &view->columns[i];
+
+		appendStringInfo(&aliases, "%s%s", i > 0 ? ", " : "", col->name);
+
+		if (col->kind != IVM_COLUMN_MIN && col->kind != IVM_COLUMN_MAX)
+			continue;
+		appendStringInfo(&targets, "%s%s",
+						 targets.len > 0 ? ", " : "", col->name);
+		appendStringInfo(&values, "%sv.%s",
+						 values.len > 0 ? ", " : "", col->name);
+		appendStringInfo(&nulls, "%smv.%s IS NULL",
+						 nulls.len > 0 ? " OR " : "", col->name);
+	}
+
+	initStringInfo(&querybuf);
+	appendStringInfo(&querybuf,
+					 "UPDATE %s mv SET (%s) = (SELECT %s FROM (%s) v(%s) WHERE ",
+					 view->matviewname, targets.data, values.data,
+					 pg_get_querydef(copyObject(view->query), false),
+					 aliases.data);
+	ivm_append_match(&querybuf, view, "v", "mv");
+	appendStringInfoString(&querybuf, ") FROM " IVM_DELTA_NAME " d WHERE ");
+	ivm_append_match(&querybuf, view, "mv", "d");
+	appendStringInfo(&querybuf, " AND (%s)", nulls.data);
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_UPDATE)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+}
+
+/*
+ * Recompute the whole view, for when its base tables changed in ways that
+ * can't be applied incrementally.
+ */
+static void
+ivm_recompute(IvmView *view)
+{
+	StringInfoData querybuf;
+
+	initStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "DELETE FROM %s", view->matviewname);
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_DELETE)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "INSERT INTO %s %s", view->matviewname,
+					 pg_get_querydef(copyObject(view->query), false));
+	if (SPI_exec(querybuf.data, 0) != SPI_OK_INSERT)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+}
+
+/*
+ * AtEOXact_IVM
+ *		Forget the state of incremental view maintenance at transaction end.
+ */
+void
+AtEOXact_IVM(void)
+{
+	/* the lists went away with TopTransactionContext */
+	ivm_open_statements = NIL;
+	ivm_pending_recomputes = NIL;
+	ivm_checked_views = NIL;
+}
+
+/*
+ * AtEOSubXact_IVM
+ *		Forget statements that were in progress in an aborted subtransaction,
+ *		since their AFTER triggers won't fire, and the views it locked.
+ */
+void
+AtEOSubXact_IVM(bool isCommit, SubTransactionId mySubid,
+				SubTransactionId parentSubid)
+{
+	foreach_ptr(IvmOpenStatement, stmt, ivm_open_statements)
+	{
+		if (stmt->subid != mySubid)
+			continue;
+
+		if (isCommit)
+			stmt->subid = parentSubid;
+		else
+		{
+			ivm_open_statements = foreach_delete_current(ivm_open_statements,
+														 stmt);
+			pfree(stmt);
+		}
+	}
+
+	/* the aborted subtransaction released the locks it took */
+	foreach_ptr(IvmCheckedView, view, ivm_checked_views)
+	{
+		if (view->subid != mySubid)
+			continue;
+
+		if (isCommit)
+			view->subid = parentSubid;
+		else
+		{
+			ivm_checked_views = foreach_delete_current(ivm_checked_views,
+													   view);
+			pfree(view);
+		}
+	}
+}
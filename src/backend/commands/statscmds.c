@@ -21,12 +21,14 @@
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
+#include "catalog/pg_constraint.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_statistic_ext.h"
 #include "catalog/pg_statistic_ext_data.h"
 #include "commands/comment.h"
 #include "commands/defrem.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
 #include "statistics/statistics.h"
@@ -42,6 +44,8 @@
 static char *ChooseExtendedStatisticName(const char *name1, const char *name2,
 										 const char *label, Oid namespaceid);
 static char *ChooseExtendedStatisticNameAddition(List *exprs);
+static Oid	FindJoinStatisticsForeignKey(Node *quals, Relation lrel,
+										 Relation rrel, int *refvarno);
 
 
 /* qsort comparator for the attnums in CreateStatistics */
@@ -77,6 +81,11 @@ CreateStatistics(CreateStatsStmt *stmt)
 	Datum		exprsDatum;
 	Relation	statrel;
 	Relation	rel = NULL;
+	Relation	rels[2];
+	int			nrels = 0;
+	JoinExpr   *join = NULL;
+	Oid			fkeyoid = InvalidOid;
+	int			refvarno = 1;
 	Oid			relid;
 	ObjectAddress parentobject,
 				myself;
@@ -95,17 +104,25 @@ CreateStatistics(CreateStatsStmt *stmt)
 	Assert(IsA(stmt, CreateStatsStmt));
 
 	/*
-	 * Examine the FROM clause.  Currently, we only allow it to be a single
-	 * simple table, but later we'll probably allow multiple tables and JOIN
-	 * syntax.  The grammar is already prepared for that, so we have to check
-	 * here that what we got is what we can support.
+	 * Examine the FROM clause.  We allow either a single simple table, or an
+	 * inner join of two tables along a foreign key, in which case the
+	 * statistics are defined on columns of the referenced table but describe
+	 * the rows of the referencing one (see FindJoinStatisticsForeignKey).
+	 * The grammar accepts more than that, so we have to check here that what
+	 * we got is what we can support.
 	 */
 	if (list_length(stmt->relations) != 1)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("only a single relation is allowed in CREATE STATISTICS")));
 
-	foreach(cell, stmt->relations)
+	if (IsA(linitial(stmt->relations), JoinExpr))
+	{
+		/* transformStatsStmt has checked the shape of the join */
+		join = (JoinExpr *) linitial(stmt->relations);
+	}
+
+	foreach(cell, join ? list_make2(join->larg, join->rarg) : stmt->relations)
 	{
 		Node	   *rln = (Node *) lfirst(cell);
 
@@ -145,6 +162,37 @@ CreateStatistics(CreateStatsStmt *stmt)
 					(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
 					 errmsg("permission denied: \"%s\" is a system catalog",
 							RelationGetRelationName(rel))));
+
+		/*
+		 * Statistics on a join are built by probing one table for each row
+		 * sampled from the other, which we don't do across partitions.
+		 */
+		if (join && rel->rd_rel->relkind != RELKIND_RELATION)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("cannot define statistics on a join with relation \"%s\"",
+							RelationGetRelationName(rel)),
+					 errdetail("Statistics on a join are supported only for plain tables.")));
+
+		rels[nrels++] = rel;
+	}
+
+	if (join)
+	{
+		if (RelationGetRelid(rels[0]) == RelationGetRelid(rels[1]))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot define statistics on a join of a table with itself")));
+
+		fkeyoid = FindJoinStatisticsForeignKey(join->quals, rels[0], rels[1],
+											   &refvarno);
+
+		/*
+		 * The statistics object belongs to the referenced table; hang on to
+		 * the lock on the other one until commit.
+		 */
+		rel = rels[refvarno - 1];
+		relation_close(rels[2 - refvarno], NoLock);
 	}
 
 	Assert(rel);
@@ -263,6 +311,12 @@ CreateStatistics(CreateStatsStmt *stmt)
 			Var		   *var = (Var *) selem->expr;
 			TypeCacheEntry *type;
 
+			if (join && var->varno != refvarno)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+						 errmsg("statistics on a join can refer only to columns of the referenced table \"%s\"",
+								RelationGetRelationName(rel))));
+
 			/* Disallow use of system attributes in extended stats */
 			if (var->varattno <= 0)
 				ereport(ERROR,
@@ -290,6 +344,11 @@ CreateStatistics(CreateStatsStmt *stmt)
 
 			Assert(expr != NULL);
 
+			if (join)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("statistics on a join cannot be built on expressions")));
+
 			/* Disallow expressions referencing system attributes. */
 			pull_varattnos(expr, 1, &attnums);
 
@@ -375,8 +434,19 @@ CreateStatistics(CreateStatsStmt *stmt)
 	/*
 	 * If no statistic type was specified, build them all (but only when the
 	 * statistics is defined on more than one column/expression).
+	 *
+	 * Statistics on a join only come as an MCV list, which is also what
+	 * makes them useful on a single column.
 	 */
-	if ((!requested_type) && (numcols >= 2))
+	if (join)
+	{
+		if (build_ndistinct || build_dependencies)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("only statistics kind \"mcv\" is supported on a join")));
+		build_mcv = true;
+	}
+	else if ((!requested_type) && (numcols >= 2))
 	{
 		build_ndistinct = true;
 		build_dependencies = true;
@@ -394,7 +464,7 @@ CreateStatistics(CreateStatsStmt *stmt)
 	 * Check that at least two columns were specified in the statement, or
 	 * that we're building statistics on a single expression.
 	 */
-	if ((numcols < 2) && (list_length(stxexprs) != 1))
+	if ((numcols < 2) && (list_length(stxexprs) != 1) && !join)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
 				 errmsg("extended statistics require at least 2 columns")));
@@ -496,6 +566,7 @@ CreateStatistics(CreateStatsStmt *stmt)
 	values[Anum_pg_statistic_ext_stxname - 1] = NameGetDatum(&stxname);
 	values[Anum_pg_statistic_ext_stxnamespace - 1] = ObjectIdGetDatum(namespaceId);
 	values[Anum_pg_statistic_ext_stxowner - 1] = ObjectIdGetDatum(stxowner);
+	values[Anum_pg_statistic_ext_stxfkey - 1] = ObjectIdGetDatum(fkeyoid);
 	values[Anum_pg_statistic_ext_stxkeys - 1] = PointerGetDatum(stxkeys);
 	nulls[Anum_pg_statistic_ext_stxstattarget - 1] = true;
 	values[Anum_pg_statistic_ext_stxkind - 1] = PointerGetDatum(stxkind);
@@ -567,6 +638,16 @@ CreateStatistics(CreateStatsStmt *stmt)
 										DEPENDENCY_NORMAL,
 										DEPENDENCY_AUTO, false);
 
+	/*
+	 * Statistics on a join go away with the foreign key they follow, which
+	 * also takes care of the referencing table being dropped.
+	 */
+	if (OidIsValid(fkeyoid))
+	{
+		ObjectAddressSet(parentobject, ConstraintRelationId, fkeyoid);
+		recordDependencyOn(&myself, &parentobject, DEPENDENCY_AUTO);
+	}
+
 	/*
 	 * Also add dependencies on namespace and owner.  These are required
 	 * because the stats object might have a different namespace and/or owner
@@ -592,6 +673,102 @@ CreateStatistics(CreateStatsStmt *stmt)
 	return myself;
 }
 
+/*
+ * FindJoinStatisticsForeignKey
+ *		Match the ON condition of CREATE STATISTICS ... FROM a JOIN b to a
+ *		foreign key between the two tables.
+ *
+ * The condition must equate each column of the foreign key with the column it
+ * references, using the constraint's equality operators, and nothing else.
+ * lrel and rrel are range table entries 1 and 2 of the transformed condition.
+ * Returns the OID of the constraint, and sets *refvarno to the range table
+ * index of the referenced table.
+ */
+static Oid
+FindJoinStatisticsForeignKey(Node *quals, Relation lrel, Relation rrel,
+							 int *refvarno)
+{
+	List	   *conds = make_ands_implicit((Expr *) quals);
+	int			nconds = list_length(conds);
+	ListCell   *lc;
+
+	foreach(lc, conds)
+	{
+		OpExpr	   *op = (OpExpr *) lfirst(lc);
+		Var		   *lvar;
+		Var		   *rvar;
+
+		if (!IsA(op, OpExpr) || list_length(op->args) != 2 ||
+			!IsA(linitial(op->args), Var) || !IsA(lsecond(op->args), Var))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("join condition of statistics must be a conjunction of column equalities")));
+
+		lvar = (Var *) linitial(op->args);
+		rvar = (Var *) lsecond(op->args);
+		if (lvar->varno == rvar->varno ||
+			lvar->varattno <= 0 || rvar->varattno <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("join condition of statistics must compare a column of each table")));
+	}
+
+	/* Try each table in turn as the referenced one */
+	for (int varno = 1; varno <= 2; varno++)
+	{
+		Relation	refrel = (varno == 1) ? lrel : rrel;
+		Relation	fkrel = (varno == 1) ? rrel : lrel;
+		List	   *fkeys = copyObject(RelationGetFKeyList(fkrel));
+
+		foreach_node(ForeignKeyCacheInfo, fk, fkeys)
+		{
+			Bitmapset  *matched = NULL;
+
+			if (fk->confrelid != RelationGetRelid(refrel) ||
+				fk->nkeys != nconds)
+				continue;
+
+			foreach(lc, conds)
+			{
+				OpExpr	   *op = (OpExpr *) lfirst(lc);
+				Var		   *lvar = (Var *) linitial(op->args);
+				Var		   *rvar = (Var *) lsecond(op->args);
+				Var		   *refvar = (lvar->varno == varno) ? lvar : rvar;
+				Var		   *fkvar = (lvar->varno == varno) ? rvar : lvar;
+
+				for (int k = 0; k < fk->nkeys; k++)
+				{
+					Oid			eqop = fk->conpfeqop[k];
+
+					if (fk->conkey[k] != fkvar->varattno ||
+						fk->confkey[k] != refvar->varattno)
+						continue;
+
+					/* conpfeqop takes the referenced column on the left */
+					if (refvar != lvar)
+						eqop = get_commutator(eqop);
+					if (op->opno == eqop)
+						matched = bms_add_member(matched, k);
+					break;
+				}
+			}
+
+			if (bms_num_members(matched) == nconds)
+			{
+				*refvarno = varno;
+				return fk->conoid;
+			}
+		}
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+			 errmsg("join condition does not match a foreign key between \"%s\" and \"%s\"",
+					RelationGetRelationName(lrel),
+					RelationGetRelationName(rrel))));
+	return InvalidOid;			/* keep compiler quiet */
+}
+
 /*
  *		ALTER STATISTICS
  */
@@ -44,6 +44,7 @@
 #include "executor/nodeNestloop.h"
 #include "executor/nodeProjectSet.h"
 #include "executor/nodeRecursiveunion.h"
+#include "executor/nodeRedistribute.h"
 #include "executor/nodeResult.h"
 #include "executor/nodeSamplescan.h"
 #include "executor/nodeSeqscan.h"
@@ -177,6 +178,10 @@ ExecReScan(PlanState *node)
 			ExecReScanGatherMerge((GatherMergeState *) node);
 			break;
 
+		case T_RedistributeState:
+			ExecReScanRedistribute((RedistributeState *) node);
+			break;
+
 		case T_IndexScanState:
 			ExecReScanIndexScan((IndexScanState *) node);
 			break;
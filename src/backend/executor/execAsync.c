@@ -18,6 +18,7 @@
 #include "executor/executor.h"
 #include "executor/nodeAppend.h"
 #include "executor/nodeForeignscan.h"
+#include "executor/nodeGather.h"
 
 /*
  * Asynchronously request a tuple from a designed async-capable node.
@@ -37,6 +38,9 @@ ExecAsyncRequest(AsyncRequest *areq)
 		case T_ForeignScanState:
 			ExecAsyncForeignScanRequest(areq);
 			break;
+		case T_GatherState:
+			ExecAsyncGatherRequest(areq);
+			break;
 		default:
 			/* If the node doesn't support async, caller messed up. */
 			elog(ERROR, "unrecognized node type: %d",
@@ -57,6 +61,9 @@ ExecAsyncRequest(AsyncRequest *areq)
  * make a single call of the following form:
  *
  * AddWaitEventToSet(set, WL_SOCKET_READABLE, fd, NULL, areq);
+ *
+ * or, if it is waiting for our process latch to be set rather than for a
+ * socket, a call of ExecAsyncConfigureLatchWait(areq).
  */
 void
 ExecAsyncConfigureWait(AsyncRequest *areq)
@@ -70,6 +77,9 @@ ExecAsyncConfigureWait(AsyncRequest *areq)
 		case T_ForeignScanState:
 			ExecAsyncForeignScanConfigureWait(areq);
 			break;
+		case T_GatherState:
+			ExecAsyncGatherConfigureWait(areq);
+			break;
 		default:
 			/* If the node doesn't support async, caller messed up. */
 			elog(ERROR, "unrecognized node type: %d",
@@ -96,6 +106,9 @@ ExecAsyncNotify(AsyncRequest *areq)
 		case T_ForeignScanState:
 			ExecAsyncForeignScanNotify(areq);
 			break;
+		case T_GatherState:
+			ExecAsyncGatherNotify(areq);
+			break;
 		default:
 			/* If the node doesn't support async, caller messed up. */
 			elog(ERROR, "unrecognized node type: %d",
@@ -152,3 +165,20 @@ ExecAsyncRequestPending(AsyncRequest *areq)
 	areq->request_complete = false;
 	areq->result = NULL;
 }
+
+/*
+ * A requestee node that is waiting for our process latch to be set should
+ * call this function from its ExecAsyncConfigureWait callback, instead of
+ * adding the latch to the wait event set itself: the set can contain the
+ * latch only once, however many requests are waiting for it.
+ *
+ * Before sleeping, the requestor resets the latch and calls back such
+ * requests once more, so they need not worry about the latch having been
+ * reset by something else since they found they had to wait.
+ */
+void
+ExecAsyncConfigureLatchWait(AsyncRequest *areq)
+{
+	Assert(areq->callback_pending);
+	areq->latch_wait = true;
+}
@@ -138,6 +138,7 @@ static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 static bool index_recheck_constraint(Relation index, const Oid *constr_procs,
 									 const Datum *existing_values, const bool *existing_isnull,
 									 const Datum *new_values);
+static bool index_is_batchable(Relation indexRelation, IndexInfo *indexInfo);
 static bool index_unchanged_by_update(ResultRelInfo *resultRelInfo,
 									  EState *estate, IndexInfo *indexInfo,
 									  Relation indexRelation);
@@ -297,6 +298,10 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *
  *		If 'arbiterIndexes' is nonempty, noDupErr applies only to
  *		those indexes.  NIL means noDupErr applies to all indexes.
+ *
+ *		If skipBatchable is set, the caller has already inserted
+ *		the tuple into the indexes that ExecInsertIndexTuplesBatch
+ *		handles, so only the remaining indexes are processed.
  * ----------------------------------------------------------------
  */
 List *
@@ -307,7 +312,8 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 					  bool noDupErr,
 					  bool *specConflict,
 					  List *arbiterIndexes,
-					  bool onlySummarizing)
+					  bool onlySummarizing,
+					  bool skipBatchable)
 {
 	ItemPointer tupleid = &slot->tts_tid;
 	List	   *result = NIL;
@@ -370,6 +376,10 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 		if (onlySummarizing && !indexInfo->ii_Summarizing)
 			continue;
 
+		/* Skip indexes the caller has already taken care of */
+		if (skipBatchable && index_is_batchable(indexRelation, indexInfo))
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -511,6 +521,97 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecInsertIndexTuplesBatch
+ *
+ *		Insert index tuples for a batch of heap tuples that have
+ *		just been inserted into the result relation, e.g. by
+ *		table_multi_insert().  Each index that can be handled this
+ *		way (see index_is_batchable) receives all of the batch's
+ *		entries in a single index_insert_batch() call, which allows
+ *		the access method to amortize its per-tuple work.
+ *
+ *		The remaining indexes must still be maintained by calling
+ *		ExecInsertIndexTuples() for each tuple with skipBatchable
+ *		set.  As batchable indexes have no constraints to enforce,
+ *		nothing is ever added to the recheck list here.
+ * ----------------------------------------------------------------
+ */
+void
+ExecInsertIndexTuplesBatch(ResultRelInfo *resultRelInfo,
+						   TupleTableSlot **slots,
+						   int ntuples,
+						   EState *estate)
+{
+	int			numIndices;
+	RelationPtr relationDescs;
+	Relation	heapRelation;
+	IndexInfo **indexInfoArray;
+	ExprContext *econtext;
+	MemoryContext oldContext;
+	Datum	  **values = NULL;
+	bool	  **isnull = NULL;
+	ItemPointer tids = NULL;
+	bool	   *is_unique = NULL;
+	int			i;
+	int			j;
+
+	numIndices = resultRelInfo->ri_NumIndices;
+	relationDescs = resultRelInfo->ri_IndexRelationDescs;
+	indexInfoArray = resultRelInfo->ri_IndexRelationInfo;
+	heapRelation = resultRelInfo->ri_RelationDesc;
+
+	/* The batch's working arrays only need to live in per-tuple memory */
+	econtext = GetPerTupleExprContext(estate);
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < numIndices; i++)
+	{
+		Relation	indexRelation = relationDescs[i];
+		IndexInfo  *indexInfo;
+
+		if (indexRelation == NULL)
+			continue;
+
+		indexInfo = indexInfoArray[i];
+
+		if (!indexInfo->ii_ReadyForInserts ||
+			!index_is_batchable(indexRelation, indexInfo))
+			continue;
+
+		/* Set up the arrays on first use; they're reused for all indexes */
+		if (values == NULL)
+		{
+			values = palloc(ntuples * sizeof(Datum *));
+			isnull = palloc(ntuples * sizeof(bool *));
+			tids = palloc(ntuples * sizeof(ItemPointerData));
+			is_unique = palloc(ntuples * sizeof(bool));
+			for (j = 0; j < ntuples; j++)
+			{
+				Assert(ItemPointerIsValid(&slots[j]->tts_tid));
+				Assert(slots[j]->tts_tableOid == RelationGetRelid(heapRelation));
+
+				values[j] = palloc(INDEX_MAX_KEYS * sizeof(Datum));
+				isnull[j] = palloc(INDEX_MAX_KEYS * sizeof(bool));
+				ItemPointerCopy(&slots[j]->tts_tid, &tids[j]);
+			}
+		}
+
+		for (j = 0; j < ntuples; j++)
+		{
+			econtext->ecxt_scantuple = slots[j];
+			FormIndexDatum(indexInfo, slots[j], estate,
+						   values[j], isnull[j]);
+		}
+
+		index_insert_batch(indexRelation, ntuples, values, isnull, tids,
+						   heapRelation, UNIQUE_CHECK_NO, is_unique,
+						   indexInfo);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
 /* ----------------------------------------------------------------
  *		ExecCheckIndexConstraints
  *
@@ -987,6 +1088,25 @@ index_recheck_constraint(Relation index, const Oid *constr_procs,
 	return true;
 }
 
+/*
+ * Can ExecInsertIndexTuplesBatch insert into this index?
+ *
+ * That requires an access method with batch insertion support, and an index
+ * that needs no per-tuple work besides forming its entries: no uniqueness or
+ * exclusion constraint to check and no predicate or expressions to evaluate.
+ * Indexes that do need such work stay on the per-tuple path so that any error
+ * it raises can still be attributed to the offending tuple.
+ */
+static bool
+index_is_batchable(Relation indexRelation, IndexInfo *indexInfo)
+{
+	return indexRelation->rd_indam->aminsertbatch != NULL &&
+		!indexRelation->rd_index->indisunique &&
+		indexInfo->ii_ExclusionOps == NULL &&
+		indexInfo->ii_Predicate == NIL &&
+		indexInfo->ii_Expressions == NIL;
+}
+
 /*
  * Check if ExecInsertIndexTuples() should pass indexUnchanged hint.
  *
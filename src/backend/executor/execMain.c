@@ -59,6 +59,7 @@
 #include "utils/lsyscache.h"
 #include "utils/partcache.h"
 #include "utils/rls.h"
+#include "utils/sharedresultcache.h"
 #include "utils/snapmgr.h"
 
 
@@ -88,7 +89,7 @@ static bool ExecCheckOneRelPerms(RTEPermissionInfo *perminfo);
 static bool ExecCheckPermissionsModified(Oid relOid, Oid userid,
 										 Bitmapset *modifiedCols,
 										 AclMode requiredPerms);
-static void ExecCheckXactReadOnly(PlannedStmt *plannedstmt);
+static void ExecCheckXactReadOnly(PlannedStmt *plannedstmt, int eflags);
 static void EvalPlanQualStart(EPQState *epqstate, Plan *planTree);
 
 /* end of local decls */
@@ -156,8 +157,10 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	 * would require (a) storing the combo CID hash in shared memory, rather
 	 * than synchronizing it just once at the start of parallelism, and (b) an
 	 * alternative to heap_update()'s reliance on xmax for mutual exclusion.
-	 * INSERT may have no such troubles, but we forbid it to simplify the
-	 * checks.
+	 * INSERT has no such troubles, so a parallel worker may run the leader's
+	 * INSERT, which the planner vetted for this purpose.  Any other INSERT,
+	 * such as one issued by a function the worker calls, is forbidden to
+	 * simplify the checks.
 	 *
 	 * We have lower-level defenses in CommandCounterIncrement and elsewhere
 	 * against performing unsafe operations in parallel mode, but this gives a
@@ -165,7 +168,7 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	 */
 	if ((XactReadOnly || IsInParallelMode()) &&
 		!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
-		ExecCheckXactReadOnly(queryDesc->plannedstmt);
+		ExecCheckXactReadOnly(queryDesc->plannedstmt, eflags);
 
 	/*
 	 * Build EState, switch into per-query memory context for startup.
@@ -310,6 +313,7 @@ standard_ExecutorRun(QueryDesc *queryDesc,
 	CmdType		operation;
 	DestReceiver *dest;
 	bool		sendTuples;
+	SharedResultCacheProbe *rcprobe = NULL;
 	MemoryContext oldcontext;
 
 	/* sanity checks */
@@ -346,6 +350,17 @@ standard_ExecutorRun(QueryDesc *queryDesc,
 	sendTuples = (operation == CMD_SELECT ||
 				  queryDesc->plannedstmt->hasReturning);
 
+	/*
+	 * If the result may be shared with other backends, either send a stored
+	 * copy of it or collect it as it is sent, to store it afterwards.
+	 */
+	if (sendTuples && !ScanDirectionIsNoMovement(direction))
+	{
+		rcprobe = SharedResultCacheLookup(queryDesc, direction, count);
+		if (rcprobe != NULL && !rcprobe->hit)
+			dest = SharedResultCacheCaptureReceiver(rcprobe, dest);
+	}
+
 	if (sendTuples)
 		dest->rStartup(dest, operation, queryDesc->tupDesc);
 
@@ -358,15 +373,23 @@ standard_ExecutorRun(QueryDesc *queryDesc,
 			elog(ERROR, "can't re-execute query flagged for single execution");
 		queryDesc->already_executed = true;
 
-		ExecutePlan(estate,
-					queryDesc->planstate,
-					queryDesc->plannedstmt->parallelModeNeeded,
-					operation,
-					sendTuples,
-					count,
-					direction,
-					dest,
-					execute_once);
+		if (rcprobe != NULL && rcprobe->hit)
+			SharedResultCacheSendTuples(rcprobe, queryDesc, dest);
+		else
+		{
+			ExecutePlan(estate,
+						queryDesc->planstate,
+						queryDesc->plannedstmt->parallelModeNeeded,
+						operation,
+						sendTuples,
+						count,
+						direction,
+						dest,
+						execute_once);
+
+			if (rcprobe != NULL)
+				SharedResultCacheStore(rcprobe);
+		}
 	}
 
 	/*
@@ -787,14 +810,15 @@ ExecCheckPermissionsModified(Oid relOid, Oid userid, Bitmapset *modifiedCols,
 /*
  * Check that the query does not imply any writes to non-temp tables;
  * unless we're in parallel mode, in which case don't even allow writes
- * to temp tables.
+ * to temp tables, except for a parallel worker's share of the leader's
+ * INSERT.
  *
  * Note: in a Hot Standby this would need to reject writes to temp
  * tables just as we do in parallel mode; but an HS standby can't have created
  * any temp tables in the first place, so no need to check that.
  */
 static void
-ExecCheckXactReadOnly(PlannedStmt *plannedstmt)
+ExecCheckXactReadOnly(PlannedStmt *plannedstmt, int eflags)
 {
 	ListCell   *l;
 
@@ -815,7 +839,10 @@ ExecCheckXactReadOnly(PlannedStmt *plannedstmt)
 		PreventCommandIfReadOnly(CreateCommandName((Node *) plannedstmt));
 	}
 
-	if (plannedstmt->commandType != CMD_SELECT || plannedstmt->hasModifyingCTE)
+	if ((plannedstmt->commandType != CMD_SELECT &&
+		 !(plannedstmt->commandType == CMD_INSERT &&
+		   (eflags & EXEC_FLAG_PARALLEL_WORKER))) ||
+		plannedstmt->hasModifyingCTE)
 		PreventCommandIfParallelMode(CreateCommandName((Node *) plannedstmt));
 }
 
@@ -1634,7 +1661,15 @@ ExecutePlan(EState *estate,
 
 	estate->es_use_parallel_mode = use_parallel_mode;
 	if (use_parallel_mode)
+	{
+		/*
+		 * A parallel INSERT needs a transaction ID, which can't be assigned
+		 * once we're in parallel mode.  The workers will share ours.
+		 */
+		if (operation != CMD_SELECT)
+			(void) GetCurrentTransactionId();
 		EnterParallelMode();
+	}
 
 	/*
 	 * Loop until we've processed the proper number of tuples from the plan.
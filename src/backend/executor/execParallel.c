@@ -36,6 +36,7 @@
 #include "executor/nodeIndexonlyscan.h"
 #include "executor/nodeIndexscan.h"
 #include "executor/nodeMemoize.h"
+#include "executor/nodeRedistribute.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeSort.h"
 #include "executor/nodeSubplan.h"
@@ -76,6 +77,7 @@ typedef struct FixedParallelExecutorState
 	dsa_pointer param_exec;
 	int			eflags;
 	int			jit_flags;
+	pg_atomic_uint64 processed; /* rows inserted by workers */
 } FixedParallelExecutorState;
 
 /*
@@ -177,6 +179,16 @@ ExecSerializePlan(Plan *plan, EState *estate)
 	pstmt->hasReturning = false;
 	pstmt->hasModifyingCTE = false;
 	pstmt->canSetTag = true;
+
+	/*
+	 * In a parallel INSERT, the workers run the ModifyTable node too, and the
+	 * worker's executor must be set up for that.
+	 */
+	if (IsA(plan, ModifyTable))
+	{
+		pstmt->commandType = ((ModifyTable *) plan)->operation;
+		pstmt->canSetTag = ((ModifyTable *) plan)->canSetTag;
+	}
 	pstmt->transientPlan = false;
 	pstmt->dependsOnRole = false;
 	pstmt->parallelModeNeeded = false;
@@ -276,6 +288,11 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecHashJoinEstimate((HashJoinState *) planstate,
 									 e->pcxt);
 			break;
+		case T_RedistributeState:
+			if (planstate->plan->parallel_aware)
+				ExecRedistributeEstimate((RedistributeState *) planstate,
+										 e->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashEstimate((HashState *) planstate, e->pcxt);
@@ -500,6 +517,11 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecHashJoinInitializeDSM((HashJoinState *) planstate,
 										  d->pcxt);
 			break;
+		case T_RedistributeState:
+			if (planstate->plan->parallel_aware)
+				ExecRedistributeInitializeDSM((RedistributeState *) planstate,
+											  d->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeDSM((HashState *) planstate, d->pcxt);
@@ -744,6 +766,7 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	fpes->param_exec = InvalidDsaPointer;
 	fpes->eflags = estate->es_top_eflags;
 	fpes->jit_flags = estate->es_jit_flags;
+	pg_atomic_init_u64(&fpes->processed, 0);
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, fpes);
 
 	/* Store query string */
@@ -924,6 +947,7 @@ ExecParallelReinitialize(PlanState *planstate,
 	pei->finished = false;
 
 	fpes = shm_toc_lookup(pei->pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
+	pg_atomic_write_u64(&fpes->processed, 0);
 
 	/* Free any serialized parameters from the last round. */
 	if (DsaPointerIsValid(fpes->param_exec))
@@ -1000,6 +1024,11 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 				ExecHashJoinReInitializeDSM((HashJoinState *) planstate,
 											pcxt);
 			break;
+		case T_RedistributeState:
+			if (planstate->plan->parallel_aware)
+				ExecRedistributeReInitializeDSM((RedistributeState *) planstate,
+												pcxt);
+			break;
 		case T_HashState:
 		case T_SortState:
 		case T_IncrementalSortState:
@@ -1134,6 +1163,7 @@ void
 ExecParallelFinish(ParallelExecutorInfo *pei)
 {
 	int			nworkers = pei->pcxt->nworkers_launched;
+	FixedParallelExecutorState *fpes;
 	int			i;
 
 	/* Make this be a no-op if called twice in a row. */
@@ -1174,6 +1204,10 @@ ExecParallelFinish(ParallelExecutorInfo *pei)
 	for (i = 0; i < nworkers; i++)
 		InstrAccumParallelQuery(&pei->buffer_usage[i], &pei->wal_usage[i]);
 
+	/* Likewise, count the rows the workers inserted as our own. */
+	fpes = shm_toc_lookup(pei->pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
+	pei->planstate->state->es_processed += pg_atomic_read_u64(&fpes->processed);
+
 	pei->finished = true;
 }
 
@@ -1354,6 +1388,11 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 				ExecHashJoinInitializeWorker((HashJoinState *) planstate,
 											 pwcxt);
 			break;
+		case T_RedistributeState:
+			if (planstate->plan->parallel_aware)
+				ExecRedistributeInitializeWorker((RedistributeState *) planstate,
+												 pwcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeWorker((HashState *) planstate, pwcxt);
@@ -1438,7 +1477,7 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 
 	/* Start up the executor */
 	queryDesc->plannedstmt->jitFlags = fpes->jit_flags;
-	ExecutorStart(queryDesc, fpes->eflags);
+	ExecutorStart(queryDesc, fpes->eflags | EXEC_FLAG_PARALLEL_WORKER);
 
 	/* Special executor initialization steps for parallel workers */
 	queryDesc->planstate->state->es_query_dsa = area;
@@ -1477,6 +1516,11 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Shut down the executor */
 	ExecutorFinish(queryDesc);
 
+	/* Report rows inserted; the leader counts the rows it gets from us. */
+	if (queryDesc->operation != CMD_SELECT)
+		pg_atomic_add_fetch_u64(&fpes->processed,
+								queryDesc->estate->es_processed);
+
 	/* Report buffer/WAL usage during parallel execution. */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
 	wal_usage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
@@ -26,11 +26,14 @@
 #include "partitioning/partdesc.h"
 #include "partitioning/partprune.h"
 #include "rewrite/rewriteManip.h"
+#include "storage/lmgr.h"
 #include "utils/acl.h"
 #include "utils/lsyscache.h"
 #include "utils/partcache.h"
 #include "utils/rls.h"
 #include "utils/ruleutils.h"
+#include "utils/sharedresultcache.h"
+#include "utils/snapmgr.h"
 
 
 /*-----------------------
@@ -192,6 +195,9 @@ static void InitPartitionPruneContext(PartitionPruneContext *context,
 static void PartitionPruneFixSubPlanMap(PartitionPruneState *prunestate,
 										Bitmapset *initially_valid_subplans,
 										int n_total_subplans);
+static Bitmapset *exclude_unlocked_partitions(EState *estate,
+											  PartitionPruneInfo *pruneinfo,
+											  Bitmapset *validsubplans);
 static void find_matching_subplans_recurse(PartitionPruningData *prunedata,
 										   PartitionedRelPruningData *pprune,
 										   bool initial_prune,
@@ -518,6 +524,7 @@ ExecInitPartitionInfo(ModifyTableState *mtstate, EState *estate,
 					  0,
 					  rootResultRelInfo,
 					  estate->es_instrument);
+	SharedResultCacheNoteWrite(partrel);
 
 	/*
 	 * Verify result relation is a valid target for an INSERT.  An UPDATE of a
@@ -1814,7 +1821,15 @@ ExecInitPartitionPruning(PlanState *planstate,
 	 * Perform an initial partition prune pass, if required.
 	 */
 	if (prunestate->do_initial_prune)
+	{
 		*initially_valid_subplans = ExecFindMatchingSubPlans(prunestate, true);
+
+		if (estate->es_plannedstmt &&
+			estate->es_plannedstmt->prunedRelids != NULL)
+			*initially_valid_subplans =
+				exclude_unlocked_partitions(estate, pruneinfo,
+											*initially_valid_subplans);
+	}
 	else
 	{
 		/* No pruning, so we'll need to initialize all subplans */
@@ -2414,3 +2429,241 @@ find_matching_subplans_recurse(PartitionPruningData *prunedata,
 		}
 	}
 }
+
+/*
+ * exclude_unlocked_partitions
+ *		Remove from 'validsubplans' the subplans for leaf partitions that
+ *		plancache.c pruned, and did not lock, before the plan was started
+ *
+ * The initial pruning normally leaves the same partitions as the pruning done
+ * by AcquireUnprunedPartitionLocks, but a stable function in the pruning
+ * expressions could return a different result by now.  The plan's validity
+ * was only checked with the partitions locked back then, so those are the
+ * only ones we may scan.  A partition that has been locked since, say by
+ * another execution of the same plan in this transaction, can be kept.
+ */
+static Bitmapset *
+exclude_unlocked_partitions(EState *estate, PartitionPruneInfo *pruneinfo,
+							Bitmapset *validsubplans)
+{
+	Bitmapset  *prunedRelids = estate->es_plannedstmt->prunedRelids;
+	ListCell   *lc;
+
+	foreach(lc, pruneinfo->prune_infos)
+	{
+		List	   *prune_infos = lfirst(lc);
+		ListCell   *lc2;
+
+		foreach(lc2, prune_infos)
+		{
+			PartitionedRelPruneInfo *pinfo = lfirst(lc2);
+			int			i;
+
+			for (i = 0; i < pinfo->nparts; i++)
+			{
+				int			rti = pinfo->leafpart_rti_map[i];
+				RangeTblEntry *rte;
+
+				if (rti == 0 ||
+					!bms_is_member(pinfo->subplan_map[i], validsubplans) ||
+					!bms_is_member(rti, prunedRelids))
+					continue;
+
+				rte = exec_rt_fetch(rti, estate);
+				if (!CheckRelationOidLockedByMe(rte->relid, rte->rellockmode,
+												true))
+					validsubplans = bms_del_member(validsubplans,
+												   pinfo->subplan_map[i]);
+			}
+		}
+	}
+
+	return validsubplans;
+}
+
+/*
+ * find_initial_pruning_nodes
+ *		Collect the Append and MergeAppend nodes in a plan tree that do
+ *		initial pruning.
+ */
+static void
+find_initial_pruning_nodes(Plan *plan, List **nodes)
+{
+	PartitionPruneInfo *pruneinfo = NULL;
+	List	   *children = NIL;
+	ListCell   *lc;
+
+	if (plan == NULL)
+		return;
+
+	check_stack_depth();
+
+	switch (nodeTag(plan))
+	{
+		case T_Append:
+			pruneinfo = ((Append *) plan)->part_prune_info;
+			children = ((Append *) plan)->appendplans;
+			break;
+		case T_MergeAppend:
+			pruneinfo = ((MergeAppend *) plan)->part_prune_info;
+			children = ((MergeAppend *) plan)->mergeplans;
+			break;
+		case T_BitmapAnd:
+			children = ((BitmapAnd *) plan)->bitmapplans;
+			break;
+		case T_BitmapOr:
+			children = ((BitmapOr *) plan)->bitmapplans;
+			break;
+		case T_SubqueryScan:
+			children = list_make1(((SubqueryScan *) plan)->subplan);
+			break;
+		case T_CustomScan:
+			children = ((CustomScan *) plan)->custom_plans;
+			break;
+		default:
+			break;
+	}
+
+	if (pruneinfo)
+	{
+		foreach(lc, pruneinfo->prune_infos)
+		{
+			List	   *prune_infos = lfirst(lc);
+			ListCell   *lc2;
+			bool		found = false;
+
+			foreach(lc2, prune_infos)
+			{
+				PartitionedRelPruneInfo *pinfo = lfirst(lc2);
+
+				if (pinfo->initial_pruning_steps != NIL)
+				{
+					*nodes = lappend(*nodes, plan);
+					found = true;
+					break;
+				}
+			}
+			if (found)
+				break;
+		}
+	}
+
+	foreach(lc, children)
+		find_initial_pruning_nodes((Plan *) lfirst(lc), nodes);
+	find_initial_pruning_nodes(plan->lefttree, nodes);
+	find_initial_pruning_nodes(plan->righttree, nodes);
+}
+
+/*
+ * ExecGetUnprunedRelids
+ *		Find the prunable leaf partitions of a plan that survive initial
+ *		pruning
+ *
+ * This runs the initial pruning steps of the plan ahead of execution, so that
+ * the caller can lock just the partitions in plannedstmt->prunableRelids that
+ * will be scanned; see AcquireExecutorLocks.  All other relations of the plan
+ * must be locked already.  'params' are the values of the plan's external
+ * parameters.
+ *
+ * The caller passes the result on to the executor through
+ * plannedstmt->prunedRelids.  The executor repeats this pruning once the plan
+ * is started, and should it come to a different conclusion, which can only
+ * happen if stable functions in the pruning expressions return different
+ * results, it goes with the partitions that were locked here; see
+ * exclude_unlocked_partitions.
+ */
+Bitmapset *
+ExecGetUnprunedRelids(PlannedStmt *plannedstmt, ParamListInfo params)
+{
+	Bitmapset  *result = NULL;
+	List	   *nodes = NIL;
+	EState	   *estate;
+	MemoryContext oldcontext;
+	bool		snapshot_set = false;
+	ListCell   *lc;
+
+	find_initial_pruning_nodes(plannedstmt->planTree, &nodes);
+	foreach(lc, plannedstmt->subplans)
+		find_initial_pruning_nodes((Plan *) lfirst(lc), &nodes);
+
+	if (nodes == NIL)
+		return NULL;
+
+	/* Any previous result must not restrict this pruning */
+	Assert(plannedstmt->prunedRelids == NULL);
+
+	/* Pruning expressions may call functions that need a snapshot */
+	if (!ActiveSnapshotSet())
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+		snapshot_set = true;
+	}
+
+	estate = CreateExecutorState();
+	estate->es_param_list_info = params;
+	estate->es_plannedstmt = plannedstmt;
+	ExecInitRangeTable(estate, plannedstmt->rtable, plannedstmt->permInfos);
+
+	foreach(lc, nodes)
+	{
+		Plan	   *plan = (Plan *) lfirst(lc);
+		PartitionPruneInfo *pruneinfo;
+		PlanState  *planstate;
+		Bitmapset  *validsubplans;
+		int			nsubplans;
+		ListCell   *lc2;
+
+		oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+		/* A bare PlanState is all the pruning code needs */
+		if (IsA(plan, Append))
+		{
+			pruneinfo = ((Append *) plan)->part_prune_info;
+			nsubplans = list_length(((Append *) plan)->appendplans);
+			planstate = (PlanState *) makeNode(AppendState);
+		}
+		else
+		{
+			pruneinfo = ((MergeAppend *) plan)->part_prune_info;
+			nsubplans = list_length(((MergeAppend *) plan)->mergeplans);
+			planstate = (PlanState *) makeNode(MergeAppendState);
+		}
+		planstate->plan = plan;
+		planstate->state = estate;
+
+		(void) ExecInitPartitionPruning(planstate, nsubplans, pruneinfo,
+										&validsubplans);
+
+		MemoryContextSwitchTo(oldcontext);
+
+		foreach(lc2, pruneinfo->prune_infos)
+		{
+			List	   *prune_infos = lfirst(lc2);
+			ListCell   *lc3;
+
+			foreach(lc3, prune_infos)
+			{
+				PartitionedRelPruneInfo *pinfo = lfirst(lc3);
+				int			i;
+
+				for (i = 0; i < pinfo->nparts; i++)
+				{
+					int			rti = pinfo->leafpart_rti_map[i];
+
+					if (rti > 0 &&
+						bms_is_member(pinfo->subplan_map[i], validsubplans) &&
+						bms_is_member(rti, plannedstmt->prunableRelids))
+						result = bms_add_member(result, rti);
+				}
+			}
+		}
+	}
+
+	ExecCloseRangeTableRelations(estate);
+	FreeExecutorState(estate);
+
+	if (snapshot_set)
+		PopActiveSnapshot();
+
+	return result;
+}
@@ -611,7 +611,8 @@ ExecSimpleRelationInsert(ResultRelInfo *resultRelInfo,
 												   slot, estate, false,
 												   conflictindexes ? true : false,
 												   &conflict,
-												   conflictindexes, false);
+												   conflictindexes, false,
+												   false);
 
 		/*
 		 * Checks the conflict indexes to fetch the conflicting local tuple
@@ -708,7 +709,8 @@ ExecSimpleRelationUpdate(ResultRelInfo *resultRelInfo,
 												   slot, estate, true,
 												   conflictindexes ? true : false,
 												   &conflict, conflictindexes,
-												   (update_indexes == TU_Summarizing));
+												   (update_indexes == TU_Summarizing),
+												   false);
 
 		/*
 		 * Refer to the comments above the call to CheckAndReportConflict() in
@@ -59,6 +59,7 @@
 #include "utils/builtins.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/sharedresultcache.h"
 #include "utils/typcache.h"
 
 
@@ -777,6 +778,20 @@ ExecGetRangeTableRelation(EState *estate, Index rti)
 
 		if (!IsParallelWorker())
 		{
+			/*
+			 * A leaf partition that plancache.c pruned when reusing a generic
+			 * plan has not been locked, and the executor's initial pruning
+			 * leaves it out for that reason (see exclude_unlocked_partitions).
+			 * Locking it now would be too late, since the plan's validity has
+			 * been checked already.
+			 */
+			if (unlikely(estate->es_plannedstmt &&
+						 bms_is_member(rti,
+									   estate->es_plannedstmt->prunedRelids)) &&
+				!CheckRelationOidLockedByMe(rte->relid, rte->rellockmode, true))
+				elog(ERROR, "partition %u pruned by the plan cache was not locked",
+					 rte->relid);
+
 			/*
 			 * In a normal query, we should already have the appropriate lock,
 			 * but verify that through an Assert.  Since there's already an
@@ -825,6 +840,10 @@ ExecInitResultRelation(EState *estate, ResultRelInfo *resultRelInfo,
 					  NULL,
 					  estate->es_instrument);
 
+	/* Keep others from using outdated copies of query results */
+	if (!(estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		SharedResultCacheNoteWrite(resultRelationDesc);
+
 	if (estate->es_result_relations == NULL)
 		estate->es_result_relations = (ResultRelInfo **)
 			palloc0(estate->es_range_table_size * sizeof(ResultRelInfo *));
@@ -253,6 +253,7 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 			areq->requestee = appendplanstates[i];
 			areq->request_index = i;
 			areq->callback_pending = false;
+			areq->latch_wait = false;
 			areq->request_complete = false;
 			areq->result = NULL;
 
@@ -452,6 +453,7 @@ ExecReScanAppend(AppendState *node)
 			AsyncRequest *areq = node->as_asyncrequests[i];
 
 			areq->callback_pending = false;
+			areq->latch_wait = false;
 			areq->request_complete = false;
 			areq->result = NULL;
 		}
@@ -1016,10 +1018,11 @@ ExecAppendAsyncRequest(AppendState *node, TupleTableSlot **result)
 static void
 ExecAppendAsyncEventWait(AppendState *node)
 {
-	int			nevents = node->as_nasyncplans + 1;
+	int			nevents = node->as_nasyncplans + 2;
 	long		timeout = node->as_syncdone ? -1 : 0;
 	WaitEvent	occurred_event[EVENT_BUFFER_SIZE];
 	int			noccurred;
+	bool		latch_wait = false;
 	int			i;
 
 	/* We should never be called when there are no valid async subplans. */
@@ -1037,9 +1040,53 @@ ExecAppendAsyncEventWait(AppendState *node)
 		AsyncRequest *areq = node->as_asyncrequests[i];
 
 		if (areq->callback_pending)
+		{
 			ExecAsyncConfigureWait(areq);
+			if (areq->latch_wait)
+				latch_wait = true;
+		}
+	}
+
+	/*
+	 * Before sleeping on the latch, reset it and poll the subplans waiting
+	 * for it once more.  They may have found nothing to do a while ago, and
+	 * whatever set the latch since then may have been consumed by a sync
+	 * subplan or a lock wait resetting it in the meantime.
+	 */
+	if (latch_wait && timeout != 0)
+	{
+		ResetLatch(MyLatch);
+
+		latch_wait = false;
+		i = -1;
+		while ((i = bms_next_member(node->as_asyncplans, i)) >= 0)
+		{
+			AsyncRequest *areq = node->as_asyncrequests[i];
+
+			if (areq->callback_pending && areq->latch_wait)
+			{
+				areq->callback_pending = false;
+				areq->latch_wait = false;
+				ExecAsyncNotify(areq);
+
+				/* Don't sleep if we got a tuple or reached the end */
+				if (!areq->callback_pending)
+					timeout = 0;
+				else
+				{
+					ExecAsyncConfigureWait(areq);
+					if (areq->latch_wait)
+						latch_wait = true;
+				}
+			}
+		}
 	}
 
+	/* Subplans waiting for our latch share a single event for it. */
+	if (latch_wait)
+		AddWaitEventToSet(node->as_eventset, WL_LATCH_SET, PGINVALID_SOCKET,
+						  MyLatch, NULL);
+
 	/*
 	 * No need for further processing if there are no configured events other
 	 * than the postmaster death event.
@@ -1092,6 +1139,26 @@ ExecAppendAsyncEventWait(AppendState *node)
 				ExecAsyncNotify(areq);
 			}
 		}
+		else if ((w->events & WL_LATCH_SET) != 0)
+		{
+			int			j;
+
+			ResetLatch(MyLatch);
+
+			/* Call back all the subplans that were waiting for it. */
+			j = -1;
+			while ((j = bms_next_member(node->as_asyncplans, j)) >= 0)
+			{
+				AsyncRequest *areq = node->as_asyncrequests[j];
+
+				if (areq->callback_pending && areq->latch_wait)
+				{
+					areq->callback_pending = false;
+					areq->latch_wait = false;
+					ExecAsyncNotify(areq);
+				}
+			}
+		}
 	}
 }
 
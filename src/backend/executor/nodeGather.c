@@ -22,6 +22,11 @@
  * return the results.  Therefore, a plan used with a single-copy Gather
  * node need not be parallel-aware.
  *
+ * Under an async-aware Append, a Gather node is executed asynchronously: it
+ * returns a tuple if one is available, and otherwise lets the Append wait for
+ * our latch, which the workers set whenever they send more tuples.  This way
+ * the workers of several Gather nodes can all be running at the same time.
+ *
  * IDENTIFICATION
  *	  src/backend/executor/nodeGather.c
  *
@@ -30,6 +35,7 @@
 
 #include "postgres.h"
 
+#include "executor/execAsync.h"
 #include "executor/execParallel.h"
 #include "executor/executor.h"
 #include "executor/nodeGather.h"
@@ -40,8 +46,9 @@
 
 
 static TupleTableSlot *ExecGather(PlanState *pstate);
-static TupleTableSlot *gather_getnext(GatherState *gatherstate);
-static MinimalTuple gather_readnext(GatherState *gatherstate);
+static void gather_start(GatherState *node);
+static TupleTableSlot *gather_getnext(GatherState *gatherstate, bool nowait);
+static MinimalTuple gather_readnext(GatherState *gatherstate, bool nowait);
 static void ExecShutdownGatherWorkers(GatherState *node);
 
 
@@ -149,71 +156,7 @@ ExecGather(PlanState *pstate)
 	 * only if it is really needed.
 	 */
 	if (!node->initialized)
-	{
-		EState	   *estate = node->ps.state;
-		Gather	   *gather = (Gather *) node->ps.plan;
-
-		/*
-		 * Sometimes we might have to run without parallelism; but if parallel
-		 * mode is active then we can try to fire up some workers.
-		 */
-		if (gather->num_workers > 0 && estate->es_use_parallel_mode)
-		{
-			ParallelContext *pcxt;
-
-			/* Initialize, or re-initialize, shared state needed by workers. */
-			if (!node->pei)
-				node->pei = ExecInitParallelPlan(outerPlanState(node),
-												 estate,
-												 gather->initParam,
-												 gather->num_workers,
-												 node->tuples_needed);
-			else
-				ExecParallelReinitialize(outerPlanState(node),
-										 node->pei,
-										 gather->initParam);
-
-			/*
-			 * Register backend workers. We might not get as many as we
-			 * requested, or indeed any at all.
-			 */
-			pcxt = node->pei->pcxt;
-			LaunchParallelWorkers(pcxt);
-			/* We save # workers launched for the benefit of EXPLAIN */
-			node->nworkers_launched = pcxt->nworkers_launched;
-
-			/*
-			 * Count number of workers originally wanted and actually
-			 * launched.
-			 */
-			estate->es_parallel_workers_to_launch += pcxt->nworkers_to_launch;
-			estate->es_parallel_workers_launched += pcxt->nworkers_launched;
-
-			/* Set up tuple queue readers to read the results. */
-			if (pcxt->nworkers_launched > 0)
-			{
-				ExecParallelCreateReaders(node->pei);
-				/* Make a working array showing the active readers */
-				node->nreaders = pcxt->nworkers_launched;
-				node->reader = (TupleQueueReader **)
-					palloc(node->nreaders * sizeof(TupleQueueReader *));
-				memcpy(node->reader, node->pei->reader,
-					   node->nreaders * sizeof(TupleQueueReader *));
-			}
-			else
-			{
-				/* No workers?	Then never mind. */
-				node->nreaders = 0;
-				node->reader = NULL;
-			}
-			node->nextreader = 0;
-		}
-
-		/* Run plan locally if no workers or enabled and not single-copy. */
-		node->need_to_scan_locally = (node->nreaders == 0)
-			|| (!gather->single_copy && parallel_leader_participation);
-		node->initialized = true;
-	}
+		gather_start(node);
 
 	/*
 	 * Reset per-tuple memory context to free any expression evaluation
@@ -226,7 +169,7 @@ ExecGather(PlanState *pstate)
 	 * Get next tuple, either from one of our workers, or by running the plan
 	 * ourselves.
 	 */
-	slot = gather_getnext(node);
+	slot = gather_getnext(node, false);
 	if (TupIsNull(slot))
 		return NULL;
 
@@ -241,6 +184,77 @@ ExecGather(PlanState *pstate)
 	return ExecProject(node->ps.ps_ProjInfo);
 }
 
+/*
+ * Launch the workers and set up the readers for their tuple queues.
+ */
+static void
+gather_start(GatherState *node)
+{
+	EState	   *estate = node->ps.state;
+	Gather	   *gather = (Gather *) node->ps.plan;
+
+	/*
+	 * Sometimes we might have to run without parallelism; but if parallel
+	 * mode is active then we can try to fire up some workers.
+	 */
+	if (gather->num_workers > 0 && estate->es_use_parallel_mode)
+	{
+		ParallelContext *pcxt;
+
+		/* Initialize, or re-initialize, shared state needed by workers. */
+		if (!node->pei)
+			node->pei = ExecInitParallelPlan(outerPlanState(node),
+											 estate,
+											 gather->initParam,
+											 gather->num_workers,
+											 node->tuples_needed);
+		else
+			ExecParallelReinitialize(outerPlanState(node),
+									 node->pei,
+									 gather->initParam);
+
+		/*
+		 * Register backend workers. We might not get as many as we
+		 * requested, or indeed any at all.
+		 */
+		pcxt = node->pei->pcxt;
+		LaunchParallelWorkers(pcxt);
+		/* We save # workers launched for the benefit of EXPLAIN */
+		node->nworkers_launched = pcxt->nworkers_launched;
+
+		/*
+		 * Count number of workers originally wanted and actually
+		 * launched.
+		 */
+		estate->es_parallel_workers_to_launch += pcxt->nworkers_to_launch;
+		estate->es_parallel_workers_launched += pcxt->nworkers_launched;
+
+		/* Set up tuple queue readers to read the results. */
+		if (pcxt->nworkers_launched > 0)
+		{
+			ExecParallelCreateReaders(node->pei);
+			/* Make a working array showing the active readers */
+			node->nreaders = pcxt->nworkers_launched;
+			node->reader = (TupleQueueReader **)
+				palloc(node->nreaders * sizeof(TupleQueueReader *));
+			memcpy(node->reader, node->pei->reader,
+				   node->nreaders * sizeof(TupleQueueReader *));
+		}
+		else
+		{
+			/* No workers?	Then never mind. */
+			node->nreaders = 0;
+			node->reader = NULL;
+		}
+		node->nextreader = 0;
+	}
+
+	/* Run plan locally if no workers or enabled and not single-copy. */
+	node->need_to_scan_locally = (node->nreaders == 0)
+		|| (!gather->single_copy && parallel_leader_participation);
+	node->initialized = true;
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndGather
  *
@@ -258,9 +272,12 @@ ExecEndGather(GatherState *node)
  * Read the next tuple.  We might fetch a tuple from one of the tuple queues
  * using gather_readnext, or if no tuple queue contains a tuple and the
  * single_copy flag is not set, we might generate one locally instead.
+ *
+ * If nowait is true, return NULL rather than waiting for the workers to
+ * produce a tuple.
  */
 static TupleTableSlot *
-gather_getnext(GatherState *gatherstate)
+gather_getnext(GatherState *gatherstate, bool nowait)
 {
 	PlanState  *outerPlan = outerPlanState(gatherstate);
 	TupleTableSlot *outerTupleSlot;
@@ -273,7 +290,7 @@ gather_getnext(GatherState *gatherstate)
 
 		if (gatherstate->nreaders > 0)
 		{
-			tup = gather_readnext(gatherstate);
+			tup = gather_readnext(gatherstate, nowait);
 
 			if (HeapTupleIsValid(tup))
 			{
@@ -282,6 +299,13 @@ gather_getnext(GatherState *gatherstate)
 									  false);	/* don't pfree tuple  */
 				return fslot;
 			}
+
+			/* Would have had to wait for the workers? */
+			if (gatherstate->nreaders > 0 && !gatherstate->need_to_scan_locally)
+			{
+				Assert(nowait);
+				return NULL;
+			}
 		}
 
 		if (gatherstate->need_to_scan_locally)
@@ -308,7 +332,7 @@ gather_getnext(GatherState *gatherstate)
  * Attempt to read a tuple from one of our parallel workers.
  */
 static MinimalTuple
-gather_readnext(GatherState *gatherstate)
+gather_readnext(GatherState *gatherstate, bool nowait)
 {
 	int			nvisited = 0;
 
@@ -378,7 +402,7 @@ gather_readnext(GatherState *gatherstate)
 			 * If (still) running plan locally, return NULL so caller can
 			 * generate another tuple from the local copy of the plan.
 			 */
-			if (gatherstate->need_to_scan_locally)
+			if (gatherstate->need_to_scan_locally || nowait)
 				return NULL;
 
 			/* Nothing to do except wait for developments. */
@@ -427,6 +451,65 @@ ExecShutdownGather(GatherState *node)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		ExecAsyncGatherRequest
+ *
+ *		Asynchronously request a tuple from a Gather node
+ * ----------------------------------------------------------------
+ */
+void
+ExecAsyncGatherRequest(AsyncRequest *areq)
+{
+	GatherState *node = castNode(GatherState, areq->requestee);
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	TupleTableSlot *slot;
+
+	if (!node->initialized)
+		gather_start(node);
+
+	ResetExprContext(econtext);
+
+	slot = gather_getnext(node, true);
+	if (slot == NULL)
+	{
+		ExecAsyncRequestPending(areq);
+		return;
+	}
+
+	if (!TupIsNull(slot) && node->ps.ps_ProjInfo != NULL)
+	{
+		econtext->ecxt_outertuple = slot;
+		slot = ExecProject(node->ps.ps_ProjInfo);
+	}
+
+	ExecAsyncRequestDone(areq, slot);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAsyncGatherConfigureWait
+ *
+ *		In async mode, configure for a wait
+ * ----------------------------------------------------------------
+ */
+void
+ExecAsyncGatherConfigureWait(AsyncRequest *areq)
+{
+	/* The workers set our latch when they put tuples in their queues */
+	ExecAsyncConfigureLatchWait(areq);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAsyncGatherNotify
+ *
+ *		Callback invoked when our latch has been set
+ * ----------------------------------------------------------------
+ */
+void
+ExecAsyncGatherNotify(AsyncRequest *areq)
+{
+	ExecAsyncGatherRequest(areq);
+}
+
 /* ----------------------------------------------------------------
  *						Join Support
  * ----------------------------------------------------------------
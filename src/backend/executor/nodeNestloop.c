@@ -24,6 +24,19 @@
 #include "executor/execdebug.h"
 #include "executor/nodeNestloop.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/optimizer.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+/* GUC parameter */
+double		adaptive_nestloop_threshold = 0;
+
+static void ExecNestLoopInitHashing(NestLoopState *nlstate, NestLoop *node);
+static bool ExecNestLoopBuildHashTable(NestLoopState *node);
+static void ExecNestLoopDropHashTable(NestLoopState *node);
+static List *ExecNestLoopLookupChain(NestLoopState *node);
+static bool slotHasNulls(TupleTableSlot *slot);
 
 
 /* ----------------------------------------------------------------
@@ -121,6 +134,28 @@ ExecNestLoop(PlanState *pstate)
 			node->nl_NeedNewOuter = false;
 			node->nl_MatchedOuter = false;
 
+			/*
+			 * If the outer side has grown well past its estimate, try to load
+			 * the inner side into a hash table, so that we needn't rescan it
+			 * for each remaining outer tuple.
+			 */
+			node->nl_OuterRows += 1;
+			if (node->nl_SwitchAt > 0 && !node->nl_Hashed &&
+				node->nl_OuterRows > node->nl_SwitchAt)
+			{
+				ENL1_printf("switching to hashed inner");
+				if (!ExecNestLoopBuildHashTable(node))
+					node->nl_SwitchAt = 0;	/* too big, don't try again */
+				econtext->ecxt_outertuple = outerTupleSlot;
+			}
+
+			if (node->nl_Hashed)
+			{
+				node->nl_HashChain = ExecNestLoopLookupChain(node);
+				node->nl_HashPos = 0;
+				continue;
+			}
+
 			/*
 			 * fetch the values of any outer Vars that must be passed to the
 			 * inner scan, and store them in the appropriate PARAM_EXEC slots.
@@ -152,11 +187,25 @@ ExecNestLoop(PlanState *pstate)
 		}
 
 		/*
-		 * we have an outerTuple, try to get the next inner tuple.
+		 * we have an outerTuple, try to get the next inner tuple.  If the
+		 * inner side is hashed, that's the next member of the chain of inner
+		 * tuples with a matching join key.
 		 */
 		ENL1_printf("getting new inner tuple");
 
-		innerTupleSlot = ExecProcNode(innerPlan);
+		if (node->nl_Hashed)
+		{
+			if (node->nl_HashPos < list_length(node->nl_HashChain))
+				innerTupleSlot =
+					ExecStoreMinimalTuple(list_nth(node->nl_HashChain,
+												   node->nl_HashPos++),
+										  node->nl_HashInnerSlot,
+										  false);
+			else
+				innerTupleSlot = NULL;
+		}
+		else
+			innerTupleSlot = ExecProcNode(innerPlan);
 		econtext->ecxt_innertuple = innerTupleSlot;
 
 		if (TupIsNull(innerTupleSlot))
@@ -300,6 +349,17 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 		eflags &= ~EXEC_FLAG_REWIND;
 	innerPlanState(nlstate) = ExecInitNode(innerPlan(node), estate, eflags);
 
+	/*
+	 * If we might switch to hashing the inner side, inner tuples can come
+	 * either from the inner plan or from our own slot, so expressions must
+	 * not assume a fixed slot type for them.
+	 */
+	if (node->hashclauses != NIL && adaptive_nestloop_threshold > 0)
+	{
+		nlstate->js.ps.inneropsset = true;
+		nlstate->js.ps.inneropsfixed = false;
+	}
+
 	/*
 	 * Initialize result slot, type and projection.
 	 */
@@ -315,6 +375,9 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 	nlstate->js.joinqual =
 		ExecInitQual(node->join.joinqual, (PlanState *) nlstate);
 
+	if (node->hashclauses != NIL && adaptive_nestloop_threshold > 0)
+		ExecNestLoopInitHashing(nlstate, node);
+
 	/*
 	 * detect whether we need only consider the first matching inner tuple
 	 */
@@ -363,6 +426,8 @@ ExecEndNestLoop(NestLoopState *node)
 	NL1_printf("ExecEndNestLoop: %s\n",
 			   "ending node processing");
 
+	ExecNestLoopDropHashTable(node);
+
 	/*
 	 * close down subplans
 	 */
@@ -393,8 +458,264 @@ ExecReScanNestLoop(NestLoopState *node)
 	 * innerPlan is re-scanned for each new outer tuple and MUST NOT be
 	 * re-scanned from here or you'll get troubles from inner index scans when
 	 * outer Vars are used as run-time keys...
+	 *
+	 * A hashed inner side stays valid unless the inner plan's parameters
+	 * changed.
 	 */
+	if (node->nl_Hashed && innerPlanState(node)->chgParam != NULL)
+		ExecNestLoopDropHashTable(node);
 
 	node->nl_NeedNewOuter = true;
 	node->nl_MatchedOuter = false;
+	node->nl_OuterRows = 0;
+}
+
+/*
+ * ExecNestLoopInitHashing
+ *		Prepare for switching to a hashed inner side at runtime.
+ *
+ * The hash table itself is not built until we decide to switch; see
+ * ExecNestLoopBuildHashTable.  This parallels the setup done for hashed
+ * subplans in ExecInitSubPlan.
+ */
+static void
+ExecNestLoopInitHashing(NestLoopState *nlstate, NestLoop *node)
+{
+	EState	   *estate = nlstate->js.ps.state;
+	int			ncols = list_length(node->hashclauses);
+	List	   *lefttlist = NIL;
+	List	   *righttlist = NIL;
+	Oid		   *cross_eq_funcoids;
+	TupleDesc	tupDescLeft;
+	TupleDesc	tupDescRight;
+	TupleTableSlot *slot;
+	ListCell   *lc;
+	int			i;
+
+	nlstate->nl_SwitchAt = adaptive_nestloop_threshold *
+		Max(outerPlan(node)->plan_rows, 1.0);
+
+	nlstate->nl_HashTableCxt =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "NestLoop HashTable Context",
+							  ALLOCSET_DEFAULT_SIZES);
+	nlstate->nl_HashTempCxt =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "NestLoop HashTable Temp Context",
+							  ALLOCSET_SMALL_SIZES);
+
+	nlstate->nl_NumHashCols = ncols;
+	nlstate->nl_KeyColIdx = (AttrNumber *) palloc(ncols * sizeof(AttrNumber));
+	nlstate->nl_TabEqFuncOids = (Oid *) palloc(ncols * sizeof(Oid));
+	nlstate->nl_TabCollations = (Oid *) palloc(ncols * sizeof(Oid));
+	nlstate->nl_TabHashFuncs = (FmgrInfo *) palloc(ncols * sizeof(FmgrInfo));
+	nlstate->nl_OuterHashFuncs = (FmgrInfo *) palloc(ncols * sizeof(FmgrInfo));
+	cross_eq_funcoids = (Oid *) palloc(ncols * sizeof(Oid));
+
+	/*
+	 * The hash clauses have been commuted to have the outer side on the left,
+	 * so each supplies one outer and one inner key column.
+	 */
+	i = 1;
+	foreach(lc, node->hashclauses)
+	{
+		OpExpr	   *opexpr = lfirst_node(OpExpr, lc);
+		Oid			rhs_eq_oper;
+		Oid			left_hashfn;
+		Oid			right_hashfn;
+
+		Assert(list_length(opexpr->args) == 2);
+
+		lefttlist = lappend(lefttlist,
+							makeTargetEntry((Expr *) linitial(opexpr->args),
+											i, NULL, false));
+		righttlist = lappend(righttlist,
+							 makeTargetEntry((Expr *) lsecond(opexpr->args),
+											 i, NULL, false));
+
+		cross_eq_funcoids[i - 1] = get_opcode(opexpr->opno);
+
+		if (!get_compatible_hash_operators(opexpr->opno,
+										   NULL, &rhs_eq_oper))
+			elog(ERROR, "could not find compatible hash operator for operator %u",
+				 opexpr->opno);
+		nlstate->nl_TabEqFuncOids[i - 1] = get_opcode(rhs_eq_oper);
+
+		if (!get_op_hash_functions(opexpr->opno,
+								   &left_hashfn, &right_hashfn))
+			elog(ERROR, "could not find hash function for hash operator %u",
+				 opexpr->opno);
+		fmgr_info(left_hashfn, &nlstate->nl_OuterHashFuncs[i - 1]);
+		fmgr_info(right_hashfn, &nlstate->nl_TabHashFuncs[i - 1]);
+
+		nlstate->nl_TabCollations[i - 1] = opexpr->inputcollid;
+		nlstate->nl_KeyColIdx[i - 1] = i;
+		i++;
+	}
+
+	/* Both key lists are evaluated in the node's own expression context */
+	tupDescLeft = ExecTypeFromTL(lefttlist);
+	slot = ExecInitExtraTupleSlot(estate, tupDescLeft, &TTSOpsVirtual);
+	nlstate->nl_OuterKeyProj =
+		ExecBuildProjectionInfo(lefttlist, nlstate->js.ps.ps_ExprContext,
+								slot, (PlanState *) nlstate, NULL);
+
+	tupDescRight = ExecTypeFromTL(righttlist);
+	slot = ExecInitExtraTupleSlot(estate, tupDescRight, &TTSOpsVirtual);
+	nlstate->nl_InnerKeyProj =
+		ExecBuildProjectionInfo(righttlist, nlstate->js.ps.ps_ExprContext,
+								slot, (PlanState *) nlstate, NULL);
+
+	nlstate->nl_CrossEq = ExecBuildGroupingEqual(tupDescLeft, tupDescRight,
+												 &TTSOpsVirtual,
+												 &TTSOpsMinimalTuple,
+												 ncols,
+												 nlstate->nl_KeyColIdx,
+												 cross_eq_funcoids,
+												 nlstate->nl_TabCollations,
+												 (PlanState *) nlstate);
+
+	nlstate->nl_HashInnerSlot =
+		ExecInitExtraTupleSlot(estate,
+							   ExecGetResultType(innerPlanState(nlstate)),
+							   &TTSOpsMinimalTuple);
+}
+
+/*
+ * ExecNestLoopBuildHashTable
+ *		Read the whole inner side into a hash table keyed by join key.
+ *
+ * Each entry's "additional" field points to a list of the inner tuples
+ * having that key, in the order the inner plan returned them, so that the
+ * join produces its output in the same order as before the switch.  Inner
+ * tuples with a null key are left out, since the hash clauses are strict.
+ *
+ * Returns false, leaving the node in its normal mode, if the inner side
+ * does not fit in hash_mem.
+ */
+static bool
+ExecNestLoopBuildHashTable(NestLoopState *node)
+{
+	PlanState  *innerPlan = innerPlanState(node);
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+	Size		hash_mem_limit = get_hash_memory_limit();
+	double		ninner = 0;
+
+	Assert(!node->nl_Hashed);
+
+	node->nl_HashTable =
+		BuildTupleHashTableExt((PlanState *) node,
+							   node->nl_InnerKeyProj->pi_state.resultslot->tts_tupleDescriptor,
+							   node->nl_NumHashCols,
+							   node->nl_KeyColIdx,
+							   node->nl_TabEqFuncOids,
+							   node->nl_TabHashFuncs,
+							   node->nl_TabCollations,
+							   clamp_cardinality_to_long(innerPlan->plan->plan_rows),
+							   0,
+							   node->nl_HashTableCxt,
+							   node->nl_HashTableCxt,
+							   node->nl_HashTempCxt,
+							   false);
+
+	ExecReScan(innerPlan);
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(innerPlan);
+		TupleTableSlot *keyslot;
+		TupleHashEntry entry;
+		MemoryContext oldcxt;
+		bool		isnew;
+
+		if (TupIsNull(slot))
+			break;
+
+		ResetExprContext(econtext);
+		econtext->ecxt_innertuple = slot;
+		keyslot = ExecProject(node->nl_InnerKeyProj);
+		if (slotHasNulls(keyslot))
+			continue;
+
+		entry = LookupTupleHashEntry(node->nl_HashTable, keyslot,
+									 &isnew, NULL);
+
+		oldcxt = MemoryContextSwitchTo(node->nl_HashTableCxt);
+		if (isnew)
+			entry->additional = NIL;
+		entry->additional = lappend((List *) entry->additional,
+									ExecCopySlotMinimalTuple(slot));
+		MemoryContextSwitchTo(oldcxt);
+		ninner += 1;
+
+		if (MemoryContextMemAllocated(node->nl_HashTableCxt, true) >
+			hash_mem_limit)
+		{
+			ExecNestLoopDropHashTable(node);
+			ResetExprContext(econtext);
+			return false;
+		}
+	}
+	ResetExprContext(econtext);
+
+	node->nl_Hashed = true;
+	node->nl_SwitchedAfter = node->nl_OuterRows;
+	node->nl_InnerHashed = ninner;
+	return true;
+}
+
+/*
+ * ExecNestLoopDropHashTable
+ *		Discard the hashed inner side, if any, and go back to rescanning it.
+ */
+static void
+ExecNestLoopDropHashTable(NestLoopState *node)
+{
+	if (node->nl_HashTableCxt == NULL)
+		return;
+
+	node->nl_HashTable = NULL;
+	node->nl_HashChain = NIL;
+	node->nl_HashPos = 0;
+	node->nl_Hashed = false;
+	MemoryContextReset(node->nl_HashTableCxt);
+	MemoryContextReset(node->nl_HashTempCxt);
+	if (node->nl_HashInnerSlot)
+		ExecClearTuple(node->nl_HashInnerSlot);
+}
+
+/*
+ * ExecNestLoopLookupChain
+ *		Return the list of hashed inner tuples matching the current outer
+ *		tuple's join key.
+ */
+static List *
+ExecNestLoopLookupChain(NestLoopState *node)
+{
+	TupleTableSlot *keyslot;
+	TupleHashEntry entry;
+
+	keyslot = ExecProject(node->nl_OuterKeyProj);
+	if (slotHasNulls(keyslot))
+		return NIL;
+
+	entry = FindTupleHashEntry(node->nl_HashTable, keyslot,
+							   node->nl_CrossEq, node->nl_OuterHashFuncs);
+	return entry ? (List *) entry->additional : NIL;
+}
+
+/*
+ * slotHasNulls: does the (projected key) slot contain any NULL?
+ */
+static bool
+slotHasNulls(TupleTableSlot *slot)
+{
+	int			ncols = slot->tts_tupleDescriptor->natts;
+	int			i;
+
+	for (i = 1; i <= ncols; i++)
+	{
+		if (slot_attisnull(slot, i))
+			return true;
+	}
+	return false;
 }
@@ -0,0 +1,466 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeRedistribute.c
+ *	  Routines to hand rows with equal keys to the same parallel participant.
+ *
+ * A Redistribute node appears below a Gather or Gather Merge, inside the
+ * part of the plan that every participant runs.  Its input is a partial
+ * plan, so each participant initially sees an arbitrary subset of the rows.
+ * Redistribute hashes the hash keys of each input row to pick one of a fixed
+ * number of partitions, and writes the row into that partition's
+ * SharedTuplestore.  Once all participants have finished writing, each one
+ * repeatedly claims a whole partition that no one has claimed yet and
+ * returns its rows.  All rows with equal keys end up in the same process,
+ * so nodes above Redistribute (for example a WindowAgg partitioned by the
+ * hash keys) can produce correct results without seeing the rest of the
+ * data.
+ *
+ * Partitions are claimed rather than assigned, because the number of
+ * workers actually launched is not known when the shared state is set up,
+ * and workers that start late may find that the input has already been
+ * consumed.  The planner asks for several partitions per planned
+ * participant so that the work is reasonably balanced.
+ *
+ * When the plan runs without a parallel context (for example because no
+ * DSM segment could be created), the single process sees all the rows
+ * anyway, and Redistribute just returns its input unchanged.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeRedistribute.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecRedistribute			- return rows of the partitions we claim
+ *		ExecInitRedistribute		- initialize node and subnodes
+ *		ExecEndRedistribute			- shutdown node and subnodes
+ */
+#include "postgres.h"
+
+#include "executor/executor.h"
+#include "executor/nodeRedistribute.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/barrier.h"
+#include "storage/sharedfileset.h"
+#include "utils/lsyscache.h"
+#include "utils/sharedtuplestore.h"
+#include "utils/wait_event.h"
+
+/*
+ * Phases of ParallelRedistributeState's barrier.  Participants that attach
+ * in the partitioning phase feed their share of the input into the
+ * partitions; anyone arriving later has nothing left to read from the
+ * subplan, and goes straight to claiming partitions.
+ */
+#define REDISTRIBUTE_PHASE_PARTITION	0
+#define REDISTRIBUTE_PHASE_CLAIM		1
+
+/*
+ * Shared state, followed by npartitions SharedTuplestore objects of
+ * sts_size bytes each.
+ */
+typedef struct ParallelRedistributeState
+{
+	Barrier		barrier;		/* see REDISTRIBUTE_PHASE_* */
+	pg_atomic_uint32 next_partition;	/* next partition to hand out */
+	int			nparticipants;	/* planned workers plus the leader */
+	Size		sts_size;		/* MAXALIGN'd size of each tuplestore */
+	SharedFileSet fileset;		/* space for the partitions' files */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} ParallelRedistributeState;
+
+#define RedistributePartition(pstate, i) \
+	((SharedTuplestore *) ((pstate)->data + (pstate)->sts_size * (i)))
+
+static void ExecRedistributePartitionInput(RedistributeState *node);
+static Size ExecRedistributeSharedSize(Redistribute *plan, int nparticipants);
+static void ExecRedistributeEndScan(RedistributeState *node);
+
+
+/* ----------------------------------------------------------------
+ *		ExecRedistribute
+ *
+ *		The first call partitions this participant's share of the input.
+ *		Then we return the rows of one claimed partition after another until
+ *		none remain unclaimed.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecRedistribute(PlanState *pstate)
+{
+	RedistributeState *node = castNode(RedistributeState, pstate);
+	Redistribute *plan = (Redistribute *) node->ps.plan;
+	ParallelRedistributeState *shared = node->pstate;
+	TupleTableSlot *slot = node->ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* Without shared state, our input already holds every row. */
+	if (shared == NULL)
+		return ExecProcNode(outerPlanState(node));
+
+	if (!node->partitioned)
+	{
+		ExecRedistributePartitionInput(node);
+		node->partitioned = true;
+	}
+
+	for (;;)
+	{
+		uint32		partition;
+
+		if (node->curpartition >= 0)
+		{
+			MinimalTuple tuple;
+
+			tuple = sts_parallel_scan_next(node->accessors[node->curpartition],
+										   NULL);
+			if (tuple != NULL)
+			{
+				ExecForceStoreMinimalTuple(tuple, slot, false);
+				return slot;
+			}
+			ExecRedistributeEndScan(node);
+		}
+
+		/* Claim the next partition nobody has read yet, if any. */
+		partition = pg_atomic_fetch_add_u32(&shared->next_partition, 1);
+		if (partition >= plan->npartitions)
+			return ExecClearTuple(slot);
+
+		node->curpartition = partition;
+		sts_begin_parallel_scan(node->accessors[partition]);
+	}
+}
+
+/*
+ * Write this participant's share of the input into the partitions, and wait
+ * for everyone else who is doing the same.
+ */
+static void
+ExecRedistributePartitionInput(RedistributeState *node)
+{
+	Redistribute *plan = (Redistribute *) node->ps.plan;
+	ParallelRedistributeState *shared = node->pstate;
+	PlanState  *outerNode = outerPlanState(node);
+	ExprContext *econtext = node->ps.ps_ExprContext;
+
+	if (BarrierAttach(&shared->barrier) != REDISTRIBUTE_PHASE_PARTITION)
+	{
+		/* Too late; the others have already consumed the whole input. */
+		BarrierDetach(&shared->barrier);
+		return;
+	}
+
+	for (;;)
+	{
+		TupleTableSlot *slot = ExecProcNode(outerNode);
+		MinimalTuple tuple;
+		bool		shouldFree;
+		bool		isnull;
+		uint32		hashvalue;
+
+		if (TupIsNull(slot))
+			break;
+
+		econtext->ecxt_outertuple = slot;
+		ResetExprContext(econtext);
+		hashvalue = DatumGetUInt32(ExecEvalExprSwitchContext(node->hashexpr,
+															 econtext,
+															 &isnull));
+
+		tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+		sts_puttuple(node->accessors[hashvalue % plan->npartitions],
+					 NULL, tuple);
+		if (shouldFree)
+			heap_free_minimal_tuple(tuple);
+	}
+
+	for (int i = 0; i < plan->npartitions; i++)
+		sts_end_write(node->accessors[i]);
+
+	BarrierArriveAndWait(&shared->barrier,
+						 WAIT_EVENT_REDISTRIBUTE_PARTITION);
+	BarrierDetach(&shared->barrier);
+}
+
+/*
+ * Stop reading the partition we claimed, if any.
+ */
+static void
+ExecRedistributeEndScan(RedistributeState *node)
+{
+	if (node->curpartition >= 0)
+	{
+		sts_end_parallel_scan(node->accessors[node->curpartition]);
+		node->curpartition = -1;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitRedistribute
+ * ----------------------------------------------------------------
+ */
+RedistributeState *
+ExecInitRedistribute(Redistribute *node, EState *estate, int eflags)
+{
+	RedistributeState *state;
+	Oid		   *hashfuncs;
+	bool	   *hashstrict;
+	ListCell   *lc;
+	int			nkeys;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	state = makeNode(RedistributeState);
+	state->ps.plan = (Plan *) node;
+	state->ps.state = estate;
+	state->ps.ExecProcNode = ExecRedistribute;
+	state->curpartition = -1;
+
+	/*
+	 * Miscellaneous initialization: we need an ExprContext to evaluate the
+	 * hash keys.
+	 */
+	ExecAssignExprContext(estate, &state->ps);
+
+	/*
+	 * initialize child nodes
+	 */
+	outerPlanState(state) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * Initialize result type and slot.  Redistribute doesn't project; the
+	 * rows of a claimed partition come back as MinimalTuples.
+	 */
+	ExecInitResultTupleSlotTL(&state->ps, &TTSOpsMinimalTuple);
+	state->ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Build the expression that computes a row's hash value.  NULL keys are
+	 * hashed too, since rows with NULL keys must stay together just like any
+	 * others.
+	 */
+	nkeys = list_length(node->hashoperators);
+	hashfuncs = palloc_array(Oid, nkeys);
+	hashstrict = palloc_array(bool, nkeys);
+	foreach(lc, node->hashoperators)
+	{
+		Oid			hashop = lfirst_oid(lc);
+		int			i = foreach_current_index(lc);
+
+		if (!get_op_hash_functions(hashop, &hashfuncs[i], NULL))
+			elog(ERROR, "could not find hash function for hash operator %u",
+				 hashop);
+		hashstrict[i] = op_strict(hashop);
+	}
+
+	state->hashexpr =
+		ExecBuildHash32Expr(ExecGetResultType(outerPlanState(state)),
+							ExecGetResultSlotOps(outerPlanState(state), NULL),
+							hashfuncs,
+							node->hashcollations,
+							node->hashkeys,
+							hashstrict,
+							&state->ps,
+							0,
+							true);
+
+	return state;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndRedistribute
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndRedistribute(RedistributeState *node)
+{
+	ExecEndNode(outerPlanState(node));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecShutdownRedistribute
+ *
+ *		Close the partition we were reading before the DSM segment goes
+ *		away.
+ * ----------------------------------------------------------------
+ */
+void
+ExecShutdownRedistribute(RedistributeState *node)
+{
+	if (node->pstate != NULL)
+		ExecRedistributeEndScan(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecReScanRedistribute
+ * ----------------------------------------------------------------
+ */
+void
+ExecReScanRedistribute(RedistributeState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/*
+	 * Shared state is reset by ExecRedistributeReInitializeDSM, which also
+	 * hands us new accessors.  Here we only forget our own progress.
+	 */
+	if (node->pstate != NULL)
+		ExecRedistributeEndScan(node);
+	node->partitioned = false;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Query Support
+ * ----------------------------------------------------------------
+ */
+
+static Size
+ExecRedistributeSharedSize(Redistribute *plan, int nparticipants)
+{
+	return add_size(offsetof(ParallelRedistributeState, data),
+					mul_size(MAXALIGN(sts_estimate(nparticipants)),
+							 plan->npartitions));
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRedistributeEstimate
+ *
+ *		Estimate space required to propagate redistribution state.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRedistributeEstimate(RedistributeState *node, ParallelContext *pcxt)
+{
+	Redistribute *plan = (Redistribute *) node->ps.plan;
+
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   ExecRedistributeSharedSize(plan, pcxt->nworkers + 1));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/*
+ * Create the partitions' tuplestores, and the leader's accessors for them.
+ */
+static void
+ExecRedistributeCreatePartitions(RedistributeState *node)
+{
+	Redistribute *plan = (Redistribute *) node->ps.plan;
+	ParallelRedistributeState *shared = node->pstate;
+
+	node->accessors = palloc_array(SharedTuplestoreAccessor *,
+								   plan->npartitions);
+	for (int i = 0; i < plan->npartitions; i++)
+	{
+		char		name[MAXPGPATH];
+
+		snprintf(name, sizeof(name), "r%d", i);
+		node->accessors[i] =
+			sts_initialize(RedistributePartition(shared, i),
+						   shared->nparticipants,
+						   0,
+						   0,
+						   SHARED_TUPLESTORE_SINGLE_PASS,
+						   &shared->fileset,
+						   name);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRedistributeInitializeDSM
+ *
+ *		Set up the shared partitions.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRedistributeInitializeDSM(RedistributeState *node, ParallelContext *pcxt)
+{
+	Redistribute *plan = (Redistribute *) node->ps.plan;
+	ParallelRedistributeState *shared;
+	int			nparticipants = pcxt->nworkers + 1;
+
+	/*
+	 * The partitions live in temporary files shared through the DSM segment.
+	 * Without a real segment no workers can run, and we fall back to passing
+	 * rows straight through.
+	 */
+	if (pcxt->seg == NULL)
+		return;
+
+	shared = shm_toc_allocate(pcxt->toc,
+							  ExecRedistributeSharedSize(plan, nparticipants));
+	BarrierInit(&shared->barrier, 0);
+	pg_atomic_init_u32(&shared->next_partition, 0);
+	shared->nparticipants = nparticipants;
+	shared->sts_size = MAXALIGN(sts_estimate(nparticipants));
+	SharedFileSetInit(&shared->fileset, pcxt->seg);
+	shm_toc_insert(pcxt->toc, plan->plan.plan_node_id, shared);
+
+	node->pstate = shared;
+	ExecRedistributeCreatePartitions(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRedistributeReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRedistributeReInitializeDSM(RedistributeState *node,
+								ParallelContext *pcxt)
+{
+	ParallelRedistributeState *shared = node->pstate;
+
+	if (shared == NULL)
+		return;
+
+	ExecRedistributeEndScan(node);
+	SharedFileSetDeleteAll(&shared->fileset);
+	BarrierInit(&shared->barrier, 0);
+	pg_atomic_write_u32(&shared->next_partition, 0);
+	ExecRedistributeCreatePartitions(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRedistributeInitializeWorker
+ *
+ *		Attach to the partitions set up by the leader.
+ * ----------------------------------------------------------------
+ */
+void
+ExecRedistributeInitializeWorker(RedistributeState *node,
+								 ParallelWorkerContext *pwcxt)
+{
+	Redistribute *plan = (Redistribute *) node->ps.plan;
+	ParallelRedistributeState *shared;
+
+	shared = shm_toc_lookup(pwcxt->toc, plan->plan.plan_node_id, false);
+	SharedFileSetAttach(&shared->fileset, pwcxt->seg);
+	node->pstate = shared;
+
+	node->accessors = palloc_array(SharedTuplestoreAccessor *,
+								   plan->npartitions);
+	for (int i = 0; i < plan->npartitions; i++)
+		node->accessors[i] = sts_attach(RedistributePartition(shared, i),
+										ParallelWorkerNumber + 1,
+										&shared->fileset);
+}
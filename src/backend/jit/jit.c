@@ -39,6 +39,8 @@ bool		jit_tuple_deforming = true;
 double		jit_above_cost = 100000;
 double		jit_inline_above_cost = 500000;
 double		jit_optimize_above_cost = 500000;
+int			jit_code_cache_size = 0;
+bool		jit_code_cache_shared = false;
 
 static JitProviderCallbacks provider;
 static bool provider_successfully_loaded = false;
@@ -187,4 +189,5 @@ InstrJitAgg(JitInstrumentation *dst, JitInstrumentation *add)
 	INSTR_TIME_ADD(dst->inlining_counter, add->inlining_counter);
 	INSTR_TIME_ADD(dst->optimization_counter, add->optimization_counter);
 	INSTR_TIME_ADD(dst->emission_counter, add->emission_counter);
+	dst->cached_functions += add->cached_functions;
 }
@@ -13,6 +13,10 @@
 
 #include "postgres.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <llvm-c/Analysis.h>
 #include <llvm-c/BitReader.h>
 #include <llvm-c/BitWriter.h>
@@ -26,6 +30,7 @@
 #include <llvm-c/LLJIT.h>
 #include <llvm-c/Support.h>
 #include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
 #if LLVM_VERSION_MAJOR < 17
 #include <llvm-c/Transforms/IPO.h>
 #include <llvm-c/Transforms/PassManagerBuilder.h>
@@ -33,23 +38,58 @@
 #include <llvm-c/Transforms/Utils.h>
 #endif
 
+#include "common/cryptohash.h"
+#include "common/file_utils.h"
+#include "common/sha2.h"
 #include "jit/llvmjit.h"
 #include "jit/llvmjit_emit.h"
+#include "lib/ilist.h"
 #include "miscadmin.h"
 #include "portability/instr_time.h"
+#include "storage/fd.h"
 #include "storage/ipc.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
 #include "utils/resowner.h"
 
 #define LLVMJIT_LLVM_CONTEXT_REUSE_MAX 100
 
+/* directory and file name prefix of code shared via jit_code_cache_shared */
+#define LLVMJIT_SHARED_CODE_DIR		"base/" PG_TEMP_FILES_DIR
+#define LLVMJIT_SHARED_CODE_PREFIX	PG_TEMP_FILE_PREFIX "_jit_"
+
 /* Handle of a module emitted via ORC JIT */
 typedef struct LLVMJitHandle
 {
 	LLVMOrcLLJITRef lljit;
 	LLVMOrcResourceTrackerRef resource_tracker;
+
+	/* cache entry owning the emitted code, NULL if owned by the handle */
+	struct LLVMJitCacheEntry *cache_entry;
 } LLVMJitHandle;
 
+/*
+ * Emitted code kept around for reuse by later queries, see
+ * llvm_compile_module(). Entries are keyed by a hash of the module's IR.
+ */
+typedef struct LLVMJitCacheEntry
+{
+	uint8		key[PG_SHA256_DIGEST_LENGTH];	/* hash key, must be first */
+	LLVMOrcLLJITRef lljit;
+	LLVMOrcResourceTrackerRef resource_tracker;
+	int			nfunctions;		/* number of functions defined by the code */
+	int			refcount;		/* number of handles using the code */
+	dlist_node	lru_node;		/* position in llvm_code_cache_lru */
+} LLVMJitCacheEntry;
+
+/* A generated function, and the name of its code in a cache entry */
+typedef struct LLVMJitCachedSymbol
+{
+	char	   *funcname;
+	char	   *symname;
+} LLVMJitCachedSymbol;
+
 
 /* types & functions commonly needed for JITing */
 LLVMTypeRef TypeSizeT;
@@ -98,12 +138,40 @@ static LLVMOrcThreadSafeContextRef llvm_ts_context;
 static LLVMOrcLLJITRef llvm_opt0_orc;
 static LLVMOrcLLJITRef llvm_opt3_orc;
 
+/* target machines emitting object files for jit_code_cache_shared */
+static LLVMTargetMachineRef llvm_opt0_tm;
+static LLVMTargetMachineRef llvm_opt3_tm;
+
+/* cached code, and its entries in least recently used order */
+static HTAB *llvm_code_cache = NULL;
+static dlist_head llvm_code_cache_lru = DLIST_STATIC_INIT(llvm_code_cache_lru);
+
+/* paths of the shared code files we wrote, oldest first */
+static List *llvm_shared_code_files = NIL;
+
 
 static void llvm_release_context(JitContext *context);
 static void llvm_session_initialize(void);
 static void llvm_shutdown(int code, Datum arg);
 static void llvm_compile_module(LLVMJitContext *context);
 static void llvm_optimize_module(LLVMJitContext *context, LLVMModuleRef module);
+static char *llvm_name_cacheable_functions(LLVMJitContext *context,
+										  uint8 *key, int *nfunctions);
+static bool llvm_use_cached_code(LLVMJitContext *context, const uint8 *key,
+								 const char *keyhex, int nfunctions,
+								 LLVMOrcLLJITRef compile_orc);
+static LLVMJitCacheEntry *llvm_code_cache_insert(const uint8 *key,
+												 LLVMOrcLLJITRef lljit,
+												 LLVMOrcResourceTrackerRef resource_tracker,
+												 int nfunctions);
+static void llvm_code_cache_evict(void);
+static char *llvm_shared_code_path(const char *keyhex);
+static LLVMMemoryBufferRef llvm_read_shared_code(const char *keyhex);
+static void llvm_write_shared_code(const char *keyhex, const char *data,
+								   size_t len);
+static void llvm_remove_shared_code(int nkeep);
+static void llvm_remove_code(LLVMOrcLLJITRef lljit,
+							 LLVMOrcResourceTrackerRef resource_tracker);
 
 static void llvm_create_types(void);
 static void llvm_set_target(void);
@@ -272,33 +340,37 @@ llvm_release_context(JitContext *context)
 		llvm_jit_context->module = NULL;
 	}
 
+	if (llvm_jit_context->reloc_builder)
+		list_free(llvm_end_relocations(llvm_jit_context));
+
 	foreach(lc, llvm_jit_context->handles)
 	{
 		LLVMJitHandle *jit_handle = (LLVMJitHandle *) lfirst(lc);
 
-		{
-			LLVMOrcExecutionSessionRef ee;
-			LLVMOrcSymbolStringPoolRef sp;
-
-			LLVMOrcResourceTrackerRemove(jit_handle->resource_tracker);
-			LLVMOrcReleaseResourceTracker(jit_handle->resource_tracker);
-
-			/*
-			 * Without triggering cleanup of the string pool, we'd leak
-			 * memory. It'd be sufficient to do this far less often, but in
-			 * experiments the required time was small enough to just always
-			 * do it.
-			 */
-			ee = LLVMOrcLLJITGetExecutionSession(jit_handle->lljit);
-			sp = LLVMOrcExecutionSessionGetSymbolStringPool(ee);
-			LLVMOrcSymbolStringPoolClearDeadEntries(sp);
-		}
+		/* cached code stays around until evicted from the cache */
+		if (jit_handle->cache_entry)
+			jit_handle->cache_entry->refcount--;
+		else
+			llvm_remove_code(jit_handle->lljit, jit_handle->resource_tracker);
 
 		pfree(jit_handle);
 	}
 	list_free(llvm_jit_context->handles);
 	llvm_jit_context->handles = NIL;
 
+	foreach(lc, llvm_jit_context->cached_symbols)
+	{
+		LLVMJitCachedSymbol *sym = (LLVMJitCachedSymbol *) lfirst(lc);
+
+		pfree(sym->funcname);
+		pfree(sym->symname);
+		pfree(sym);
+	}
+	list_free(llvm_jit_context->cached_symbols);
+	llvm_jit_context->cached_symbols = NIL;
+
+	llvm_code_cache_evict();
+
 	llvm_leave_fatal_on_oom();
 
 	if (llvm_jit_context->resowner)
@@ -319,6 +391,7 @@ llvm_mutable_module(LLVMJitContext *context)
 	if (!context->module)
 	{
 		context->compiled = false;
+		context->module_cacheable = (jit_code_cache_size > 0);
 		context->module_generation = llvm_generation++;
 		context->module = LLVMModuleCreateWithNameInContext("pg", llvm_context);
 		LLVMSetTarget(context->module, llvm_triple);
@@ -370,6 +443,18 @@ llvm_get_function(LLVMJitContext *context, const char *funcname)
 		llvm_compile_module(context);
 	}
 
+	/* if the function's code came from the cache, look up its name there */
+	foreach(lc, context->cached_symbols)
+	{
+		LLVMJitCachedSymbol *sym = (LLVMJitCachedSymbol *) lfirst(lc);
+
+		if (strcmp(sym->funcname, funcname) == 0)
+		{
+			funcname = sym->symname;
+			break;
+		}
+	}
+
 	/*
 	 * ORC's symbol table is of *unmangled* symbols. Therefore we don't need
 	 * to mangle here.
@@ -565,6 +650,11 @@ llvm_function_reference(LLVMJitContext *context,
 		 */
 		LLVMValueRef v_fn_addr;
 
+		/* the address may differ between executions, see llvm_reloc_ptr() */
+		if (context->reloc_builder)
+			return llvm_reloc_ptr(context, fcinfo->flinfo->fn_addr,
+								  TypePGFunction);
+
 		funcname = psprintf("pgoidextern.%u",
 							fcinfo->flinfo->fn_oid);
 		v_fn = LLVMGetNamedGlobal(mod, funcname);
@@ -592,6 +682,111 @@ llvm_function_reference(LLVMJitContext *context,
 	return v_fn;
 }
 
+/*
+ * Start emitting relocatable pointers for the function being generated.
+ *
+ * Code whose IR embeds pointers into executor state as constants can't be
+ * reused by another execution of the same plan, let alone by another
+ * backend. Therefore, if the module's code may be cached, such pointers are
+ * loaded from a per-function relocation table instead, whose contents the
+ * caller has to provide at runtime, in the order returned by
+ * llvm_end_relocations(). v_table is a pointer to the table, and the loads
+ * are emitted before v_insert_before, which has to be in the function's
+ * entry block.
+ */
+void
+llvm_begin_relocations(LLVMJitContext *context,
+					   LLVMValueRef v_insert_before,
+					   LLVMValueRef v_table)
+{
+	Assert(context->module_cacheable);
+	Assert(context->reloc_builder == NULL);
+
+	context->reloc_builder =
+		LLVMCreateBuilderInContext(LLVMGetModuleContext(context->module));
+	LLVMPositionBuilderBefore(context->reloc_builder, v_insert_before);
+	context->reloc_table = LLVMBuildPointerCast(context->reloc_builder,
+												v_table, l_ptr(TypeSizeT),
+												"v.relocs");
+	context->relocs = NIL;
+}
+
+/*
+ * Stop emitting relocatable pointers, returning the list of values to store
+ * into the relocation table.
+ */
+List *
+llvm_end_relocations(LLVMJitContext *context)
+{
+	List	   *relocs = context->relocs;
+
+	if (context->reloc_builder)
+		LLVMDisposeBuilder(context->reloc_builder);
+	context->reloc_builder = NULL;
+	context->reloc_table = NULL;
+	context->relocs = NIL;
+
+	return relocs;
+}
+
+/* Load value from the relocation table, adding it if necessary */
+static LLVMValueRef
+llvm_reloc_load(LLVMJitContext *context, Datum value)
+{
+	LLVMContextRef lc = LLVMGetModuleContext(context->module);
+	LLVMValueRef v_load;
+	ListCell   *cell;
+	int			slot = 0;
+	const char *invariant_load = "invariant.load";
+
+	foreach(cell, context->relocs)
+	{
+		if (PointerGetDatum(lfirst(cell)) == value)
+			break;
+		slot++;
+	}
+	if (cell == NULL)
+		context->relocs = lappend(context->relocs, DatumGetPointer(value));
+
+	v_load = l_load_gep1(context->reloc_builder, TypeSizeT,
+						 context->reloc_table, l_int32_const(lc, slot), "");
+
+	/* the table never changes, allowing the loads to be hoisted */
+	LLVMSetMetadata(v_load,
+					LLVMGetMDKindIDInContext(lc, invariant_load,
+											 strlen(invariant_load)),
+					LLVMMetadataAsValue(lc, LLVMMDNodeInContext2(lc, NULL, 0)));
+
+	return v_load;
+}
+
+/*
+ * Return pointer value of the given type, either as a constant or, while
+ * generating relocatable code, loaded from the relocation table.
+ */
+LLVMValueRef
+llvm_reloc_ptr(LLVMJitContext *context, void *ptr, LLVMTypeRef type)
+{
+	if (context->reloc_builder == NULL)
+		return l_ptr_const(ptr, type);
+
+	return LLVMBuildIntToPtr(context->reloc_builder,
+							 llvm_reloc_load(context, PointerGetDatum(ptr)),
+							 type, "");
+}
+
+/*
+ * Like llvm_reloc_ptr(), for a Datum that may be a pointer.
+ */
+LLVMValueRef
+llvm_reloc_datum(LLVMJitContext *context, Datum value)
+{
+	if (context->reloc_builder == NULL)
+		return l_sizet_const(value);
+
+	return llvm_reloc_load(context, value);
+}
+
 /*
  * Optimize code in module using the flags set in context.
  */
@@ -705,11 +900,37 @@ llvm_compile_module(LLVMJitContext *context)
 	instr_time	starttime;
 	instr_time	endtime;
 	LLVMOrcLLJITRef compile_orc;
+	LLVMTargetMachineRef compile_tm;
+	uint8		key[PG_SHA256_DIGEST_LENGTH];
+	char	   *keyhex = NULL;
+	int			nfunctions = 0;
 
 	if (context->base.flags & PGJIT_OPT3)
+	{
 		compile_orc = llvm_opt3_orc;
+		compile_tm = llvm_opt3_tm;
+	}
 	else
+	{
 		compile_orc = llvm_opt0_orc;
+		compile_tm = llvm_opt0_tm;
+	}
+
+	/*
+	 * If the code can be cached, first check whether an earlier query already
+	 * emitted the same code, in which case only linking remains to be done.
+	 */
+	if (context->module_cacheable && jit_code_cache_size > 0)
+	{
+		keyhex = llvm_name_cacheable_functions(context, key, &nfunctions);
+
+		if (llvm_use_cached_code(context, key, keyhex, nfunctions,
+								 compile_orc))
+		{
+			pfree(keyhex);
+			return;
+		}
+	}
 
 	/* perform inlining */
 	if (context->base.flags & PGJIT_INLINE)
@@ -752,7 +973,7 @@ llvm_compile_module(LLVMJitContext *context)
 	}
 
 	handle = (LLVMJitHandle *)
-		MemoryContextAlloc(TopMemoryContext, sizeof(LLVMJitHandle));
+		MemoryContextAllocZero(TopMemoryContext, sizeof(LLVMJitHandle));
 
 	/*
 	 * Emit the code. Note that this can, depending on the optimization
@@ -761,6 +982,40 @@ llvm_compile_module(LLVMJitContext *context)
 	 * faster instruction selection mechanism is used.
 	 */
 	INSTR_TIME_SET_CURRENT(starttime);
+	if (keyhex && jit_code_cache_shared)
+	{
+		LLVMMemoryBufferRef buffer;
+		LLVMErrorRef error;
+		char	   *message;
+		LLVMOrcJITDylibRef jd = LLVMOrcLLJITGetMainJITDylib(compile_orc);
+
+		/*
+		 * To make the code usable by other backends, emit an object file
+		 * ourselves, rather than leaving that to LLJIT.
+		 */
+		if (LLVMTargetMachineEmitToMemoryBuffer(compile_tm, context->module,
+												LLVMObjectFile, &message,
+												&buffer))
+			elog(ERROR, "failed to JIT module: %s", message);
+
+		llvm_write_shared_code(keyhex, LLVMGetBufferStart(buffer),
+							   LLVMGetBufferSize(buffer));
+
+		LLVMDisposeModule(context->module);
+		context->module = NULL;
+
+		handle->lljit = compile_orc;
+		handle->resource_tracker = LLVMOrcJITDylibCreateResourceTracker(jd);
+
+		/* LLVMOrcLLJITAddObjectFileWithRT takes ownership of the buffer */
+		error = LLVMOrcLLJITAddObjectFileWithRT(compile_orc,
+												handle->resource_tracker,
+												buffer);
+		if (error)
+			elog(ERROR, "failed to JIT module: %s",
+				 llvm_error_message(error));
+	}
+	else
 	{
 		LLVMOrcThreadSafeModuleRef ts_module;
 		LLVMErrorRef error;
@@ -801,6 +1056,17 @@ llvm_compile_module(LLVMJitContext *context)
 	context->handles = lappend(context->handles, handle);
 	MemoryContextSwitchTo(oldcontext);
 
+	/* and keep it around for later queries, if possible */
+	if (keyhex)
+	{
+		handle->cache_entry = llvm_code_cache_insert(key, handle->lljit,
+													 handle->resource_tracker,
+													 nfunctions);
+		handle->cache_entry->refcount++;
+		llvm_code_cache_evict();
+		pfree(keyhex);
+	}
+
 	ereport(DEBUG1,
 			(errmsg_internal("time to inline: %.3fs, opt: %.3fs, emit: %.3fs",
 							 INSTR_TIME_GET_DOUBLE(context->base.instr.inlining_counter),
@@ -810,6 +1076,455 @@ llvm_compile_module(LLVMJitContext *context)
 			 errhidecontext(true)));
 }
 
+/*
+ * Give the functions defined by the current module names determined by the
+ * module's contents, and compute the key identifying its code in the cache.
+ *
+ * The IR of the same expressions is the same across executions, except for
+ * the names of the generated functions, which include a per-backend counter.
+ * Therefore the functions are first renamed by position, then the module is
+ * hashed, and finally the hash becomes part of their names, so that the
+ * symbols of different cache entries don't conflict. The mapping from the
+ * original names is remembered in the context, for llvm_get_function().
+ *
+ * Returns the key in hex, and the number of defined functions.
+ */
+static char *
+llvm_name_cacheable_functions(LLVMJitContext *context, uint8 *key,
+							  int *nfunctions)
+{
+	LLVMModuleRef mod = context->module;
+	LLVMValueRef func;
+	List	   *funcs = NIL;
+	List	   *syms = NIL;
+	ListCell   *lc_sym;
+	ListCell   *lc_func;
+	char	   *ir;
+	char	   *keyhex;
+	int			flags;
+	int			funcno;
+	pg_cryptohash_ctx *hashctx;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	funcno = 0;
+	for (func = LLVMGetFirstFunction(mod);
+		 func != NULL;
+		 func = LLVMGetNextFunction(func))
+	{
+		LLVMJitCachedSymbol *sym;
+		char		name[32];
+
+		if (LLVMIsDeclaration(func))
+			continue;
+
+		sym = palloc0(sizeof(LLVMJitCachedSymbol));
+		sym->funcname = pstrdup(LLVMGetValueName(func));
+		syms = lappend(syms, sym);
+		funcs = lappend(funcs, func);
+
+		snprintf(name, sizeof(name), "pgjit_%d", funcno++);
+		LLVMSetValueName2(func, name, strlen(name));
+	}
+	*nfunctions = funcno;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/*
+	 * Inlining and optimization happen after this, so the options controlling
+	 * them are part of the key.
+	 */
+	flags = context->base.flags & (PGJIT_OPT3 | PGJIT_INLINE);
+	ir = LLVMPrintModuleToString(mod);
+
+	hashctx = pg_cryptohash_create(PG_SHA256);
+	if (pg_cryptohash_init(hashctx) < 0 ||
+		pg_cryptohash_update(hashctx, (uint8 *) &flags, sizeof(flags)) < 0 ||
+		pg_cryptohash_update(hashctx, (uint8 *) ir, strlen(ir)) < 0 ||
+		pg_cryptohash_final(hashctx, key, PG_SHA256_DIGEST_LENGTH) < 0)
+		elog(ERROR, "could not compute JIT code cache key: %s",
+			 pg_cryptohash_error(hashctx));
+	pg_cryptohash_free(hashctx);
+	LLVMDisposeMessage(ir);
+
+	keyhex = palloc(PG_SHA256_DIGEST_LENGTH * 2 + 1);
+	hex_encode((const char *) key, PG_SHA256_DIGEST_LENGTH, keyhex);
+	keyhex[PG_SHA256_DIGEST_LENGTH * 2] = '\0';
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	forboth(lc_sym, syms, lc_func, funcs)
+	{
+		LLVMJitCachedSymbol *sym = (LLVMJitCachedSymbol *) lfirst(lc_sym);
+
+		func = (LLVMValueRef) lfirst(lc_func);
+		sym->symname = psprintf("pgjit_%s_%d", keyhex,
+								foreach_current_index(lc_sym));
+		LLVMSetValueName2(func, sym->symname, strlen(sym->symname));
+	}
+	context->cached_symbols = list_concat(context->cached_symbols, syms);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	list_free(syms);
+	list_free(funcs);
+
+	return keyhex;
+}
+
+/*
+ * Use code for the current module found in the cache, or in a file written
+ * by another backend. Returns false if there's no such code.
+ */
+static bool
+llvm_use_cached_code(LLVMJitContext *context, const uint8 *key,
+					 const char *keyhex, int nfunctions,
+					 LLVMOrcLLJITRef compile_orc)
+{
+	LLVMJitCacheEntry *entry = NULL;
+	LLVMJitHandle *handle;
+	MemoryContext oldcontext;
+	instr_time	starttime;
+	instr_time	endtime;
+
+	INSTR_TIME_SET_CURRENT(starttime);
+
+	if (llvm_code_cache)
+		entry = (LLVMJitCacheEntry *) hash_search(llvm_code_cache, key,
+												  HASH_FIND, NULL);
+
+	if (entry == NULL && jit_code_cache_shared)
+	{
+		LLVMMemoryBufferRef buffer;
+		LLVMOrcJITDylibRef jd;
+		LLVMOrcResourceTrackerRef resource_tracker;
+		LLVMErrorRef error;
+
+		buffer = llvm_read_shared_code(keyhex);
+		if (buffer == NULL)
+			return false;
+
+		jd = LLVMOrcLLJITGetMainJITDylib(compile_orc);
+		resource_tracker = LLVMOrcJITDylibCreateResourceTracker(jd);
+
+		/* LLVMOrcLLJITAddObjectFileWithRT takes ownership of the buffer */
+		error = LLVMOrcLLJITAddObjectFileWithRT(compile_orc, resource_tracker,
+												buffer);
+		if (error)
+		{
+			elog(LOG, "could not use shared JIT code \"%s\": %s",
+				 llvm_shared_code_path(keyhex), llvm_error_message(error));
+			LLVMOrcReleaseResourceTracker(resource_tracker);
+			return false;
+		}
+
+		entry = llvm_code_cache_insert(key, compile_orc, resource_tracker,
+									   nfunctions);
+	}
+
+	if (entry == NULL)
+		return false;
+
+	Assert(entry->nfunctions == nfunctions);
+
+	handle = (LLVMJitHandle *)
+		MemoryContextAllocZero(TopMemoryContext, sizeof(LLVMJitHandle));
+	handle->lljit = entry->lljit;
+	handle->resource_tracker = entry->resource_tracker;
+	handle->cache_entry = entry;
+
+	entry->refcount++;
+	dlist_move_head(&llvm_code_cache_lru, &entry->lru_node);
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	context->handles = lappend(context->handles, handle);
+	MemoryContextSwitchTo(oldcontext);
+
+	LLVMDisposeModule(context->module);
+	context->module = NULL;
+	context->compiled = true;
+
+	context->base.instr.cached_functions += nfunctions;
+
+	INSTR_TIME_SET_CURRENT(endtime);
+	INSTR_TIME_ACCUM_DIFF(context->base.instr.emission_counter,
+						  endtime, starttime);
+
+	llvm_code_cache_evict();
+
+	return true;
+}
+
+/*
+ * Add emitted code to the cache. The caller has to take care of pinning it,
+ * if necessary.
+ */
+static LLVMJitCacheEntry *
+llvm_code_cache_insert(const uint8 *key, LLVMOrcLLJITRef lljit,
+					   LLVMOrcResourceTrackerRef resource_tracker,
+					   int nfunctions)
+{
+	LLVMJitCacheEntry *entry;
+	bool		found;
+
+	if (llvm_code_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = PG_SHA256_DIGEST_LENGTH;
+		ctl.entrysize = sizeof(LLVMJitCacheEntry);
+		ctl.hcxt = TopMemoryContext;
+		llvm_code_cache = hash_create("LLVM JIT code cache", 64, &ctl,
+									  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = (LLVMJitCacheEntry *) hash_search(llvm_code_cache, key,
+											  HASH_ENTER, &found);
+	Assert(!found);
+
+	entry->lljit = lljit;
+	entry->resource_tracker = resource_tracker;
+	entry->nfunctions = nfunctions;
+	entry->refcount = 0;
+	dlist_push_head(&llvm_code_cache_lru, &entry->lru_node);
+
+	return entry;
+}
+
+/*
+ * Remove the least recently used code not in use by any context, until the
+ * cache is no larger than jit_code_cache_size.
+ */
+static void
+llvm_code_cache_evict(void)
+{
+	if (llvm_code_cache == NULL)
+		return;
+
+	while (hash_get_num_entries(llvm_code_cache) > jit_code_cache_size)
+	{
+		LLVMJitCacheEntry *victim = NULL;
+		dlist_iter	iter;
+
+		dlist_reverse_foreach(iter, &llvm_code_cache_lru)
+		{
+			LLVMJitCacheEntry *entry =
+				dlist_container(LLVMJitCacheEntry, lru_node, iter.cur);
+
+			if (entry->refcount == 0)
+			{
+				victim = entry;
+				break;
+			}
+		}
+
+		/* everything is in use, try again once it isn't anymore */
+		if (victim == NULL)
+			break;
+
+		dlist_delete(&victim->lru_node);
+		llvm_remove_code(victim->lljit, victim->resource_tracker);
+		hash_search(llvm_code_cache, victim->key, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Return path of the file containing the object code shared with other
+ * backends. Such files live in the temporary files directory, and therefore
+ * are removed when the server restarts, which is required as they refer to
+ * the server's binaries.
+ */
+static char *
+llvm_shared_code_path(const char *keyhex)
+{
+	return psprintf("%s/%s%s.o",
+					LLVMJIT_SHARED_CODE_DIR, LLVMJIT_SHARED_CODE_PREFIX, keyhex);
+}
+
+/*
+ * Read shared object code, returning NULL if there's none.
+ */
+static LLVMMemoryBufferRef
+llvm_read_shared_code(const char *keyhex)
+{
+	char	   *path = llvm_shared_code_path(keyhex);
+	LLVMMemoryBufferRef buffer;
+	struct stat st;
+	char	   *data;
+	int			fd;
+	int			rc;
+
+	fd = OpenTransientFile(path, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+	{
+		if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", path)));
+		pfree(path);
+		return NULL;
+	}
+
+	if (fstat(fd, &st) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+		CloseTransientFile(fd);
+		pfree(path);
+		return NULL;
+	}
+
+	data = palloc_extended(st.st_size, MCXT_ALLOC_HUGE);
+	rc = read(fd, data, st.st_size);
+	if (rc != st.st_size)
+	{
+		if (rc < 0)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+		else
+			ereport(LOG,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("could not read file \"%s\": read %d of %zu",
+							path, rc, (Size) st.st_size)));
+		CloseTransientFile(fd);
+		pfree(data);
+		pfree(path);
+		return NULL;
+	}
+	CloseTransientFile(fd);
+
+	buffer = LLVMCreateMemoryBufferWithMemoryRangeCopy(data, st.st_size, path);
+
+	pfree(data);
+	pfree(path);
+
+	return buffer;
+}
+
+/*
+ * Write object code for use by other backends. Failing to do so isn't a
+ * reason to fail the query, so problems are just logged.
+ */
+static void
+llvm_write_shared_code(const char *keyhex, const char *data, size_t len)
+{
+	char	   *path = llvm_shared_code_path(keyhex);
+	char	   *tmppath = psprintf("%s.%d", path, MyProcPid);
+	int			fd;
+
+	fd = OpenTransientFile(tmppath, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY);
+	if (fd < 0 && errno == ENOENT)
+	{
+		/* the temporary files directory is created on demand */
+		(void) MakePGDirectory(LLVMJIT_SHARED_CODE_DIR);
+		fd = OpenTransientFile(tmppath,
+							   O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY);
+	}
+	if (fd < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", tmppath)));
+		goto out;
+	}
+
+	errno = 0;
+	if (write(fd, data, len) != len)
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not write file \"%s\": %m", tmppath)));
+		CloseTransientFile(fd);
+		unlink(tmppath);
+		goto out;
+	}
+
+	if (CloseTransientFile(fd) != 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", tmppath)));
+		unlink(tmppath);
+		goto out;
+	}
+
+	/* readers never see partially written files */
+	if (rename(tmppath, path) != 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not rename file \"%s\" to \"%s\": %m",
+						tmppath, path)));
+		unlink(tmppath);
+		goto out;
+	}
+
+	/*
+	 * Remember the file, so that we can remove it again.  Each backend keeps
+	 * at most jit_code_cache_size files around, which bounds the size of the
+	 * directory.
+	 */
+	llvm_shared_code_files = lappend(llvm_shared_code_files,
+									 MemoryContextStrdup(TopMemoryContext,
+														 path));
+	llvm_remove_shared_code(jit_code_cache_size);
+
+out:
+	pfree(tmppath);
+	pfree(path);
+}
+
+/*
+ * Remove the oldest shared code files written by this backend, until at most
+ * nkeep are left.  Other backends that already loaded the code keep using
+ * it; later ones just have to emit it themselves.
+ */
+static void
+llvm_remove_shared_code(int nkeep)
+{
+	while (list_length(llvm_shared_code_files) > nkeep)
+	{
+		char	   *path = linitial(llvm_shared_code_files);
+
+		if (unlink(path) != 0 && errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m", path)));
+
+		llvm_shared_code_files = list_delete_first(llvm_shared_code_files);
+		pfree(path);
+	}
+}
+
+/*
+ * Remove emitted code from the JIT.
+ */
+static void
+llvm_remove_code(LLVMOrcLLJITRef lljit,
+				 LLVMOrcResourceTrackerRef resource_tracker)
+{
+	LLVMOrcExecutionSessionRef ee;
+	LLVMOrcSymbolStringPoolRef sp;
+
+	LLVMOrcResourceTrackerRemove(resource_tracker);
+	LLVMOrcReleaseResourceTracker(resource_tracker);
+
+	/*
+	 * Without triggering cleanup of the string pool, we'd leak memory. It'd
+	 * be sufficient to do this far less often, but in experiments the
+	 * required time was small enough to just always do it.
+	 */
+	ee = LLVMOrcLLJITGetExecutionSession(lljit);
+	sp = LLVMOrcExecutionSessionGetSymbolStringPool(ee);
+	LLVMOrcSymbolStringPoolClearDeadEntries(sp);
+}
+
 /*
  * Per session initialization.
  */
@@ -877,6 +1592,16 @@ llvm_session_initialize(void)
 								LLVMCodeGenLevelAggressive,
 								LLVMRelocDefault,
 								LLVMCodeModelJITDefault);
+	llvm_opt0_tm =
+		LLVMCreateTargetMachine(llvm_targetref, llvm_triple, cpu, features,
+								LLVMCodeGenLevelNone,
+								LLVMRelocDefault,
+								LLVMCodeModelJITDefault);
+	llvm_opt3_tm =
+		LLVMCreateTargetMachine(llvm_targetref, llvm_triple, cpu, features,
+								LLVMCodeGenLevelAggressive,
+								LLVMRelocDefault,
+								LLVMCodeModelJITDefault);
 
 	LLVMDisposeMessage(cpu);
 	cpu = NULL;
@@ -906,6 +1631,9 @@ llvm_session_initialize(void)
 static void
 llvm_shutdown(int code, Datum arg)
 {
+	/* Shared code files don't outlive the backend that wrote them */
+	llvm_remove_shared_code(0);
+
 	/*
 	 * If llvm_shutdown() is reached while in a fatal-on-oom section an error
 	 * has occurred in the middle of LLVM code. It is not safe to call back
@@ -940,6 +1668,16 @@ llvm_shutdown(int code, Datum arg)
 			LLVMOrcDisposeThreadSafeContext(llvm_ts_context);
 			llvm_ts_context = NULL;
 		}
+		if (llvm_opt3_tm)
+		{
+			LLVMDisposeTargetMachine(llvm_opt3_tm);
+			llvm_opt3_tm = NULL;
+		}
+		if (llvm_opt0_tm)
+		{
+			LLVMDisposeTargetMachine(llvm_opt0_tm);
+			llvm_opt0_tm = NULL;
+		}
 	}
 }
 
@@ -49,6 +49,8 @@ typedef struct CompiledExprState
 {
 	LLVMJitContext *context;
 	const char *funcname;
+	/* values for the code's relocation table, see llvm_begin_relocations() */
+	Datum		relocs[FLEXIBLE_ARRAY_MEMBER];
 } CompiledExprState;
 
 
@@ -57,7 +59,8 @@ static Datum ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *
 static LLVMValueRef BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
 								LLVMModuleRef mod, FunctionCallInfo fcinfo,
 								LLVMValueRef *v_fcinfo_isnull);
-static LLVMValueRef build_EvalXFuncInt(LLVMBuilderRef b, LLVMModuleRef mod,
+static LLVMValueRef build_EvalXFuncInt(LLVMJitContext *context,
+									   LLVMBuilderRef b, LLVMModuleRef mod,
 									   const char *funcname,
 									   LLVMValueRef v_state,
 									   ExprEvalStep *op,
@@ -65,8 +68,8 @@ static LLVMValueRef build_EvalXFuncInt(LLVMBuilderRef b, LLVMModuleRef mod,
 static LLVMValueRef create_LifetimeEnd(LLVMModuleRef mod);
 
 /* macro making it easier to call ExecEval* functions */
-#define build_EvalXFunc(b, mod, funcname, v_state, op, ...) \
-	build_EvalXFuncInt(b, mod, funcname, v_state, op, \
+#define build_EvalXFunc(context, b, mod, funcname, v_state, op, ...) \
+	build_EvalXFuncInt(context, b, mod, funcname, v_state, op, \
 					   lengthof(((LLVMValueRef[]){__VA_ARGS__})), \
 					   ((LLVMValueRef[]){__VA_ARGS__}))
 
@@ -88,6 +91,9 @@ llvm_compile_expr(ExprState *state)
 	LLVMValueRef eval_fn;
 	LLVMBasicBlockRef entry;
 	LLVMBasicBlockRef *opblocks;
+	LLVMValueRef v_entry_br;
+	LLVMValueRef v_relocs = NULL;
+	List	   *relocs = NIL;
 
 	/* state itself */
 	LLVMValueRef v_state;
@@ -265,8 +271,33 @@ llvm_compile_expr(ExprState *state)
 	for (int opno = 0; opno < state->steps_len; opno++)
 		opblocks[opno] = l_bb_append_v(eval_fn, "b.op.%d.start", opno);
 
+	/*
+	 * If the code may be cached, pointers into this execution's state are
+	 * loaded from the relocation table at the end of CompiledExprState.
+	 */
+	if (context->module_cacheable)
+	{
+		LLVMValueRef v_private;
+		LLVMValueRef v_offset;
+
+		v_private = l_load_struct_gep(b,
+									  StructExprState,
+									  v_state,
+									  FIELDNO_EXPRSTATE_EVALFUNC_PRIVATE,
+									  "v.state.private");
+		v_offset = l_sizet_const(offsetof(CompiledExprState, relocs));
+		v_relocs = l_gep(b, LLVMInt8TypeInContext(lc),
+						 LLVMBuildPointerCast(b, v_private,
+											  l_ptr(LLVMInt8TypeInContext(lc)),
+											  ""),
+						 &v_offset, 1, "");
+	}
+
 	/* jump from entry to first block */
-	LLVMBuildBr(b, opblocks[0]);
+	v_entry_br = LLVMBuildBr(b, opblocks[0]);
+
+	if (v_relocs)
+		llvm_begin_relocations(context, v_entry_br, v_relocs);
 
 	for (int opno = 0; opno < state->steps_len; opno++)
 	{
@@ -280,8 +311,8 @@ llvm_compile_expr(ExprState *state)
 		op = &state->steps[opno];
 		opcode = ExecEvalStepOp(state, op);
 
-		v_resvaluep = l_ptr_const(op->resvalue, l_ptr(TypeSizeT));
-		v_resnullp = l_ptr_const(op->resnull, l_ptr(TypeStorageBool));
+		v_resvaluep = llvm_reloc_ptr(context, op->resvalue, l_ptr(TypeSizeT));
+		v_resnullp = llvm_reloc_ptr(context, op->resnull, l_ptr(TypeStorageBool));
 
 		switch (opcode)
 		{
@@ -442,7 +473,7 @@ llvm_compile_expr(ExprState *state)
 					else
 						v_slot = v_scanslot;
 
-					build_EvalXFunc(b, mod, "ExecEvalSysVar",
+					build_EvalXFunc(context, b, mod, "ExecEvalSysVar",
 									v_state, op, v_econtext, v_slot);
 
 					LLVMBuildBr(b, opblocks[opno + 1]);
@@ -450,7 +481,7 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_WHOLEROW:
-				build_EvalXFunc(b, mod, "ExecEvalWholeRowVar",
+				build_EvalXFunc(context, b, mod, "ExecEvalWholeRowVar",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -574,7 +605,7 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_constvalue,
 								v_constnull;
 
-					v_constvalue = l_sizet_const(op->d.constval.value);
+					v_constvalue = llvm_reloc_datum(context, op->d.constval.value);
 					v_constnull = l_sbool_const(op->d.constval.isnull);
 
 					LLVMBuildStore(b, v_constvalue, v_resvaluep);
@@ -609,7 +640,7 @@ llvm_compile_expr(ExprState *state)
 							elog(ERROR, "argumentless strict functions are pointless");
 
 						v_fcinfo =
-							l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+							llvm_reloc_ptr(context, fcinfo, l_ptr(StructFunctionCallInfoData));
 
 						/*
 						 * set resnull to true, if the function is actually
@@ -669,14 +700,14 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_FUNCEXPR_FUSAGE:
-				build_EvalXFunc(b, mod, "ExecEvalFuncExprFusage",
+				build_EvalXFunc(context, b, mod, "ExecEvalFuncExprFusage",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 
 			case EEOP_FUNCEXPR_STRICT_FUSAGE:
-				build_EvalXFunc(b, mod, "ExecEvalFuncExprStrictFusage",
+				build_EvalXFunc(context, b, mod, "ExecEvalFuncExprStrictFusage",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -711,8 +742,8 @@ llvm_compile_expr(ExprState *state)
 					b_boolcont = l_bb_before_v(opblocks[opno + 1],
 											   "b.%d.boolcont", opno);
 
-					v_boolanynullp = l_ptr_const(op->d.boolexpr.anynull,
-												 l_ptr(TypeStorageBool));
+					v_boolanynullp = llvm_reloc_ptr(context, op->d.boolexpr.anynull,
+													l_ptr(TypeStorageBool));
 
 					if (opcode == EEOP_BOOL_AND_STEP_FIRST)
 						LLVMBuildStore(b, l_sbool_const(0), v_boolanynullp);
@@ -808,8 +839,8 @@ llvm_compile_expr(ExprState *state)
 					b_boolcont = l_bb_before_v(opblocks[opno + 1],
 											   "b.%d.boolcont", opno);
 
-					v_boolanynullp = l_ptr_const(op->d.boolexpr.anynull,
-												 l_ptr(TypeStorageBool));
+					v_boolanynullp = llvm_reloc_ptr(context, op->d.boolexpr.anynull,
+													l_ptr(TypeStorageBool));
 
 					if (opcode == EEOP_BOOL_OR_STEP_FIRST)
 						LLVMBuildStore(b, l_sbool_const(0), v_boolanynullp);
@@ -1037,13 +1068,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_NULLTEST_ROWISNULL:
-				build_EvalXFunc(b, mod, "ExecEvalRowNull",
+				build_EvalXFunc(context, b, mod, "ExecEvalRowNull",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_NULLTEST_ROWISNOTNULL:
-				build_EvalXFunc(b, mod, "ExecEvalRowNotNull",
+				build_EvalXFunc(context, b, mod, "ExecEvalRowNotNull",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1114,13 +1145,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_PARAM_EXEC:
-				build_EvalXFunc(b, mod, "ExecEvalParamExec",
+				build_EvalXFunc(context, b, mod, "ExecEvalParamExec",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_PARAM_EXTERN:
-				build_EvalXFunc(b, mod, "ExecEvalParamExtern",
+				build_EvalXFunc(context, b, mod, "ExecEvalParamExtern",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1130,11 +1161,11 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_func;
 					LLVMValueRef v_params[3];
 
-					v_func = l_ptr_const(op->d.cparam.paramfunc,
-										 llvm_pg_var_type("TypeExecEvalSubroutine"));
+					v_func = llvm_reloc_ptr(context, op->d.cparam.paramfunc,
+											llvm_pg_var_type("TypeExecEvalSubroutine"));
 
 					v_params[0] = v_state;
-					v_params[1] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+					v_params[1] = llvm_reloc_ptr(context, op, l_ptr(StructExprEvalStep));
 					v_params[2] = v_econtext;
 					l_call(b,
 						   LLVMGetFunctionType(ExecEvalSubroutineTemplate),
@@ -1146,7 +1177,7 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_PARAM_SET:
-				build_EvalXFunc(b, mod, "ExecEvalParamSet",
+				build_EvalXFunc(context, b, mod, "ExecEvalParamSet",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1158,11 +1189,11 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_params[3];
 					LLVMValueRef v_ret;
 
-					v_func = l_ptr_const(op->d.sbsref_subscript.subscriptfunc,
-										 llvm_pg_var_type("TypeExecEvalBoolSubroutine"));
+					v_func = llvm_reloc_ptr(context, op->d.sbsref_subscript.subscriptfunc,
+											llvm_pg_var_type("TypeExecEvalBoolSubroutine"));
 
 					v_params[0] = v_state;
-					v_params[1] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+					v_params[1] = llvm_reloc_ptr(context, op, l_ptr(StructExprEvalStep));
 					v_params[2] = v_econtext;
 					v_ret = l_call(b,
 								   LLVMGetFunctionType(ExecEvalBoolSubroutineTemplate),
@@ -1185,11 +1216,11 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_func;
 					LLVMValueRef v_params[3];
 
-					v_func = l_ptr_const(op->d.sbsref.subscriptfunc,
-										 llvm_pg_var_type("TypeExecEvalSubroutine"));
+					v_func = llvm_reloc_ptr(context, op->d.sbsref.subscriptfunc,
+											llvm_pg_var_type("TypeExecEvalSubroutine"));
 
 					v_params[0] = v_state;
-					v_params[1] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+					v_params[1] = llvm_reloc_ptr(context, op, l_ptr(StructExprEvalStep));
 					v_params[2] = v_econtext;
 					l_call(b,
 						   LLVMGetFunctionType(ExecEvalSubroutineTemplate),
@@ -1215,10 +1246,10 @@ llvm_compile_expr(ExprState *state)
 					b_notavail = l_bb_before_v(opblocks[opno + 1],
 											   "op.%d.notavail", opno);
 
-					v_casevaluep = l_ptr_const(op->d.casetest.value,
-											   l_ptr(TypeSizeT));
-					v_casenullp = l_ptr_const(op->d.casetest.isnull,
-											  l_ptr(TypeStorageBool));
+					v_casevaluep = llvm_reloc_ptr(context, op->d.casetest.value,
+												  l_ptr(TypeSizeT));
+					v_casenullp = llvm_reloc_ptr(context, op->d.casetest.isnull,
+												 l_ptr(TypeStorageBool));
 
 					v_casevaluenull =
 						LLVMBuildICmp(b, LLVMIntEQ,
@@ -1267,8 +1298,8 @@ llvm_compile_expr(ExprState *state)
 					b_notnull = l_bb_before_v(opblocks[opno + 1],
 											  "op.%d.readonly.notnull", opno);
 
-					v_nullp = l_ptr_const(op->d.make_readonly.isnull,
-										  l_ptr(TypeStorageBool));
+					v_nullp = llvm_reloc_ptr(context, op->d.make_readonly.isnull,
+											 l_ptr(TypeStorageBool));
 
 					v_null = l_load(b, TypeStorageBool, v_nullp, "");
 
@@ -1284,8 +1315,8 @@ llvm_compile_expr(ExprState *state)
 					/* if value is not null, convert to RO datum */
 					LLVMPositionBuilderAtEnd(b, b_notnull);
 
-					v_valuep = l_ptr_const(op->d.make_readonly.value,
-										   l_ptr(TypeSizeT));
+					v_valuep = llvm_reloc_ptr(context, op->d.make_readonly.value,
+											  l_ptr(TypeSizeT));
 
 					v_value = l_load(b, TypeSizeT, v_valuep, "");
 
@@ -1336,8 +1367,8 @@ llvm_compile_expr(ExprState *state)
 
 					v_fn_out = llvm_function_reference(context, b, mod, fcinfo_out);
 					v_fn_in = llvm_function_reference(context, b, mod, fcinfo_in);
-					v_fcinfo_out = l_ptr_const(fcinfo_out, l_ptr(StructFunctionCallInfoData));
-					v_fcinfo_in = l_ptr_const(fcinfo_in, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo_out = llvm_reloc_ptr(context, fcinfo_out, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo_in = llvm_reloc_ptr(context, fcinfo_in, l_ptr(StructFunctionCallInfoData));
 
 					v_fcinfo_in_isnullp =
 						l_struct_gep(b,
@@ -1438,7 +1469,7 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_IOCOERCE_SAFE:
-				build_EvalXFunc(b, mod, "ExecEvalCoerceViaIOSafe",
+				build_EvalXFunc(context, b, mod, "ExecEvalCoerceViaIOSafe",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1471,7 +1502,7 @@ llvm_compile_expr(ExprState *state)
 					b_bothargnull = l_bb_before_v(opblocks[opno + 1], "op.%d.bothargnull", opno);
 					b_anyargnull = l_bb_before_v(opblocks[opno + 1], "op.%d.anyargnull", opno);
 
-					v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo = llvm_reloc_ptr(context, fcinfo, l_ptr(StructFunctionCallInfoData));
 
 					/* load args[0|1].isnull for both arguments */
 					v_argnull0 = l_funcnull(b, v_fcinfo, 0);
@@ -1566,7 +1597,7 @@ llvm_compile_expr(ExprState *state)
 					b_argsequal = l_bb_before_v(opblocks[opno + 1],
 												"b.%d.argsequal", opno);
 
-					v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+					v_fcinfo = llvm_reloc_ptr(context, fcinfo, l_ptr(StructFunctionCallInfoData));
 
 					/* if either argument is NULL they can't be equal */
 					v_argnull0 = l_funcnull(b, v_fcinfo, 0);
@@ -1622,37 +1653,37 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_SQLVALUEFUNCTION:
-				build_EvalXFunc(b, mod, "ExecEvalSQLValueFunction",
+				build_EvalXFunc(context, b, mod, "ExecEvalSQLValueFunction",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_CURRENTOFEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalCurrentOfExpr",
+				build_EvalXFunc(context, b, mod, "ExecEvalCurrentOfExpr",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_NEXTVALUEEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalNextValueExpr",
+				build_EvalXFunc(context, b, mod, "ExecEvalNextValueExpr",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_ARRAYEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalArrayExpr",
+				build_EvalXFunc(context, b, mod, "ExecEvalArrayExpr",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_ARRAYCOERCE:
-				build_EvalXFunc(b, mod, "ExecEvalArrayCoerce",
+				build_EvalXFunc(context, b, mod, "ExecEvalArrayCoerce",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_ROW:
-				build_EvalXFunc(b, mod, "ExecEvalRow",
+				build_EvalXFunc(context, b, mod, "ExecEvalRow",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1687,8 +1718,8 @@ llvm_compile_expr(ExprState *state)
 						LLVMValueRef v_argnull1;
 						LLVMValueRef v_anyargisnull;
 
-						v_fcinfo = l_ptr_const(fcinfo,
-											   l_ptr(StructFunctionCallInfoData));
+						v_fcinfo = llvm_reloc_ptr(context, fcinfo,
+												  l_ptr(StructFunctionCallInfoData));
 
 						v_argnull0 = l_funcnull(b, v_fcinfo, 0);
 						v_argnull1 = l_funcnull(b, v_fcinfo, 1);
@@ -1807,25 +1838,25 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_MINMAX:
-				build_EvalXFunc(b, mod, "ExecEvalMinMax",
+				build_EvalXFunc(context, b, mod, "ExecEvalMinMax",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_FIELDSELECT:
-				build_EvalXFunc(b, mod, "ExecEvalFieldSelect",
+				build_EvalXFunc(context, b, mod, "ExecEvalFieldSelect",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_FIELDSTORE_DEFORM:
-				build_EvalXFunc(b, mod, "ExecEvalFieldStoreDeForm",
+				build_EvalXFunc(context, b, mod, "ExecEvalFieldStoreDeForm",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_FIELDSTORE_FORM:
-				build_EvalXFunc(b, mod, "ExecEvalFieldStoreForm",
+				build_EvalXFunc(context, b, mod, "ExecEvalFieldStoreForm",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1845,10 +1876,10 @@ llvm_compile_expr(ExprState *state)
 					b_notavail = l_bb_before_v(opblocks[opno + 1],
 											   "op.%d.notavail", opno);
 
-					v_casevaluep = l_ptr_const(op->d.casetest.value,
-											   l_ptr(TypeSizeT));
-					v_casenullp = l_ptr_const(op->d.casetest.isnull,
-											  l_ptr(TypeStorageBool));
+					v_casevaluep = llvm_reloc_ptr(context, op->d.casetest.value,
+												  l_ptr(TypeSizeT));
+					v_casenullp = llvm_reloc_ptr(context, op->d.casetest.isnull,
+												 l_ptr(TypeStorageBool));
 
 					v_casevaluenull =
 						LLVMBuildICmp(b, LLVMIntEQ,
@@ -1889,13 +1920,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_DOMAIN_NOTNULL:
-				build_EvalXFunc(b, mod, "ExecEvalConstraintNotNull",
+				build_EvalXFunc(context, b, mod, "ExecEvalConstraintNotNull",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_DOMAIN_CHECK:
-				build_EvalXFunc(b, mod, "ExecEvalConstraintCheck",
+				build_EvalXFunc(context, b, mod, "ExecEvalConstraintCheck",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -1942,8 +1973,8 @@ llvm_compile_expr(ExprState *state)
 						LLVMValueRef v_tmp2;
 						LLVMValueRef tmp;
 
-						tmp = l_ptr_const(&op->d.hashdatum.iresult->value,
-										  l_ptr(TypeSizeT));
+						tmp = llvm_reloc_ptr(context, &op->d.hashdatum.iresult->value,
+											 l_ptr(TypeSizeT));
 
 						/*
 						 * Fetch the previously hashed value from where the
@@ -1977,8 +2008,8 @@ llvm_compile_expr(ExprState *state)
 					if (fcinfo->nargs != 1)
 						elog(ERROR, "incorrect number of function arguments");
 
-					v_fcinfo = l_ptr_const(fcinfo,
-										   l_ptr(StructFunctionCallInfoData));
+					v_fcinfo = llvm_reloc_ptr(context, fcinfo,
+											  l_ptr(StructFunctionCallInfoData));
 
 					b_checkargnull = l_bb_before_v(b_ifnotnull,
 												   "b.%d.isnull.0", opno);
@@ -2067,8 +2098,8 @@ llvm_compile_expr(ExprState *state)
 						LLVMValueRef v_tmp2;
 						LLVMValueRef tmp;
 
-						tmp = l_ptr_const(&op->d.hashdatum.iresult->value,
-										  l_ptr(TypeSizeT));
+						tmp = llvm_reloc_ptr(context, &op->d.hashdatum.iresult->value,
+											 l_ptr(TypeSizeT));
 
 						/*
 						 * Fetch the previously hashed value from where the
@@ -2111,37 +2142,37 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_CONVERT_ROWTYPE:
-				build_EvalXFunc(b, mod, "ExecEvalConvertRowtype",
+				build_EvalXFunc(context, b, mod, "ExecEvalConvertRowtype",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_SCALARARRAYOP:
-				build_EvalXFunc(b, mod, "ExecEvalScalarArrayOp",
+				build_EvalXFunc(context, b, mod, "ExecEvalScalarArrayOp",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_HASHED_SCALARARRAYOP:
-				build_EvalXFunc(b, mod, "ExecEvalHashedScalarArrayOp",
+				build_EvalXFunc(context, b, mod, "ExecEvalHashedScalarArrayOp",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_XMLEXPR:
-				build_EvalXFunc(b, mod, "ExecEvalXmlExpr",
+				build_EvalXFunc(context, b, mod, "ExecEvalXmlExpr",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_JSON_CONSTRUCTOR:
-				build_EvalXFunc(b, mod, "ExecEvalJsonConstructor",
+				build_EvalXFunc(context, b, mod, "ExecEvalJsonConstructor",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_IS_JSON:
-				build_EvalXFunc(b, mod, "ExecEvalJsonIsPredicate",
+				build_EvalXFunc(context, b, mod, "ExecEvalJsonIsPredicate",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -2155,7 +2186,7 @@ llvm_compile_expr(ExprState *state)
 					 * Call ExecEvalJsonExprPath().  It returns the address of
 					 * the step to perform next.
 					 */
-					v_ret = build_EvalXFunc(b, mod, "ExecEvalJsonExprPath",
+					v_ret = build_EvalXFunc(context, b, mod, "ExecEvalJsonExprPath",
 											v_state, op, v_econtext);
 
 					/*
@@ -2241,14 +2272,14 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_JSONEXPR_COERCION:
-				build_EvalXFunc(b, mod, "ExecEvalJsonCoercion",
+				build_EvalXFunc(context, b, mod, "ExecEvalJsonCoercion",
 								v_state, op, v_econtext);
 
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_JSONEXPR_COERCION_FINISH:
-				build_EvalXFunc(b, mod, "ExecEvalJsonCoercionFinish",
+				build_EvalXFunc(context, b, mod, "ExecEvalJsonCoercionFinish",
 								v_state, op);
 
 				LLVMBuildBr(b, opblocks[opno + 1]);
@@ -2275,7 +2306,7 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_GROUPING_FUNC:
-				build_EvalXFunc(b, mod, "ExecEvalGroupingFunc",
+				build_EvalXFunc(context, b, mod, "ExecEvalGroupingFunc",
 								v_state, op);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -2293,8 +2324,8 @@ llvm_compile_expr(ExprState *state)
 					 * up in ExecInitWindowAgg() after initializing the
 					 * expression). So load it from memory each time round.
 					 */
-					v_wfuncnop = l_ptr_const(&wfunc->wfuncno,
-											 l_ptr(LLVMInt32TypeInContext(lc)));
+					v_wfuncnop = llvm_reloc_ptr(context, &wfunc->wfuncno,
+												l_ptr(LLVMInt32TypeInContext(lc)));
 					v_wfuncno = l_load(b, LLVMInt32TypeInContext(lc), v_wfuncnop, "v_wfuncno");
 
 					/* load window func value / null */
@@ -2311,13 +2342,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_MERGE_SUPPORT_FUNC:
-				build_EvalXFunc(b, mod, "ExecEvalMergeSupportFunc",
+				build_EvalXFunc(context, b, mod, "ExecEvalMergeSupportFunc",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_SUBPLAN:
-				build_EvalXFunc(b, mod, "ExecEvalSubPlan",
+				build_EvalXFunc(context, b, mod, "ExecEvalSubPlan",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -2342,8 +2373,8 @@ llvm_compile_expr(ExprState *state)
 						b_deserialize = l_bb_before_v(opblocks[opno + 1],
 													  "op.%d.deserialize", opno);
 
-						v_fcinfo = l_ptr_const(fcinfo,
-											   l_ptr(StructFunctionCallInfoData));
+						v_fcinfo = llvm_reloc_ptr(context, fcinfo,
+												  l_ptr(StructFunctionCallInfoData));
 						v_argnull0 = l_funcnull(b, v_fcinfo, 0);
 
 						LLVMBuildCondBr(b,
@@ -2361,8 +2392,8 @@ llvm_compile_expr(ExprState *state)
 					fcinfo = op->d.agg_deserialize.fcinfo_data;
 
 					v_tmpcontext =
-						l_ptr_const(aggstate->tmpcontext->ecxt_per_tuple_memory,
-									l_ptr(StructMemoryContextData));
+						llvm_reloc_ptr(context, aggstate->tmpcontext->ecxt_per_tuple_memory,
+									   l_ptr(StructMemoryContextData));
 					v_oldcontext = l_mcxt_switch(mod, b, v_tmpcontext);
 					v_retval = BuildV1Call(context, b, mod, fcinfo,
 										   &v_fcinfo_isnull);
@@ -2390,8 +2421,8 @@ llvm_compile_expr(ExprState *state)
 					Assert(nargs > 0);
 
 					jumpnull = op->d.agg_strict_input_check.jumpnull;
-					v_argsp = l_ptr_const(args, l_ptr(StructNullableDatum));
-					v_nullsp = l_ptr_const(nulls, l_ptr(TypeStorageBool));
+					v_argsp = llvm_reloc_ptr(context, args, l_ptr(StructNullableDatum));
+					v_nullsp = llvm_reloc_ptr(context, nulls, l_ptr(TypeStorageBool));
 
 					/* create blocks for checking args */
 					b_checknulls = palloc(sizeof(LLVMBasicBlockRef *) * nargs);
@@ -2525,8 +2556,8 @@ llvm_compile_expr(ExprState *state)
 
 					v_aggstatep =
 						LLVMBuildBitCast(b, v_parent, l_ptr(StructAggState), "");
-					v_pertransp = l_ptr_const(pertrans,
-											  l_ptr(StructAggStatePerTransData));
+					v_pertransp = llvm_reloc_ptr(context, pertrans,
+												 l_ptr(StructAggStatePerTransData));
 
 					/*
 					 * pergroup = &aggstate->all_pergroups
@@ -2579,8 +2610,8 @@ llvm_compile_expr(ExprState *state)
 
 							LLVMPositionBuilderAtEnd(b, b_init);
 
-							v_aggcontext = l_ptr_const(op->d.agg_trans.aggcontext,
-													   l_ptr(StructExprContext));
+							v_aggcontext = llvm_reloc_ptr(context, op->d.agg_trans.aggcontext,
+														  l_ptr(StructExprContext));
 
 							params[0] = v_aggstatep;
 							params[1] = v_pertransp;
@@ -2626,10 +2657,10 @@ llvm_compile_expr(ExprState *state)
 					}
 
 
-					v_fcinfo = l_ptr_const(fcinfo,
-										   l_ptr(StructFunctionCallInfoData));
-					v_aggcontext = l_ptr_const(op->d.agg_trans.aggcontext,
-											   l_ptr(StructExprContext));
+					v_fcinfo = llvm_reloc_ptr(context, fcinfo,
+											  l_ptr(StructFunctionCallInfoData));
+					v_aggcontext = llvm_reloc_ptr(context, op->d.agg_trans.aggcontext,
+												  l_ptr(StructExprContext));
 
 					v_current_setp =
 						l_struct_gep(b,
@@ -2658,8 +2689,8 @@ llvm_compile_expr(ExprState *state)
 
 					/* invoke transition function in per-tuple context */
 					v_tmpcontext =
-						l_ptr_const(aggstate->tmpcontext->ecxt_per_tuple_memory,
-									l_ptr(StructMemoryContextData));
+						llvm_reloc_ptr(context, aggstate->tmpcontext->ecxt_per_tuple_memory,
+									   l_ptr(StructMemoryContextData));
 					v_oldcontext = l_mcxt_switch(mod, b, v_tmpcontext);
 
 					/* store transvalue in fcinfo->args[0] */
@@ -2779,8 +2810,8 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_args[2];
 					LLVMValueRef v_ret;
 
-					v_args[0] = l_ptr_const(aggstate, l_ptr(StructAggState));
-					v_args[1] = l_ptr_const(pertrans, l_ptr(StructAggStatePerTransData));
+					v_args[0] = llvm_reloc_ptr(context, aggstate, l_ptr(StructAggState));
+					v_args[1] = llvm_reloc_ptr(context, pertrans, l_ptr(StructAggStatePerTransData));
 
 					v_ret = l_call(b, LLVMGetFunctionType(v_fn), v_fn, v_args, 2, "");
 					v_ret = LLVMBuildZExt(b, v_ret, TypeStorageBool, "");
@@ -2803,8 +2834,8 @@ llvm_compile_expr(ExprState *state)
 					LLVMValueRef v_args[2];
 					LLVMValueRef v_ret;
 
-					v_args[0] = l_ptr_const(aggstate, l_ptr(StructAggState));
-					v_args[1] = l_ptr_const(pertrans, l_ptr(StructAggStatePerTransData));
+					v_args[0] = llvm_reloc_ptr(context, aggstate, l_ptr(StructAggState));
+					v_args[1] = llvm_reloc_ptr(context, pertrans, l_ptr(StructAggStatePerTransData));
 
 					v_ret = l_call(b, LLVMGetFunctionType(v_fn), v_fn, v_args, 2, "");
 					v_ret = LLVMBuildZExt(b, v_ret, TypeStorageBool, "");
@@ -2818,13 +2849,13 @@ llvm_compile_expr(ExprState *state)
 				}
 
 			case EEOP_AGG_ORDERED_TRANS_DATUM:
-				build_EvalXFunc(b, mod, "ExecEvalAggOrderedTransDatum",
+				build_EvalXFunc(context, b, mod, "ExecEvalAggOrderedTransDatum",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
 			case EEOP_AGG_ORDERED_TRANS_TUPLE:
-				build_EvalXFunc(b, mod, "ExecEvalAggOrderedTransTuple",
+				build_EvalXFunc(context, b, mod, "ExecEvalAggOrderedTransTuple",
 								v_state, op, v_econtext);
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
@@ -2844,11 +2875,20 @@ llvm_compile_expr(ExprState *state)
 	 * remapping overhead.
 	 */
 	{
+		CompiledExprState *cstate;
+		ListCell   *lc_reloc;
 
-		CompiledExprState *cstate = palloc0(sizeof(CompiledExprState));
+		if (v_relocs)
+			relocs = llvm_end_relocations(context);
 
+		cstate = palloc0(offsetof(CompiledExprState, relocs) +
+						 list_length(relocs) * sizeof(Datum));
 		cstate->context = context;
 		cstate->funcname = funcname;
+		foreach(lc_reloc, relocs)
+			cstate->relocs[foreach_current_index(lc_reloc)] =
+				PointerGetDatum(lfirst(lc_reloc));
+		list_free(relocs);
 
 		state->evalfunc = ExecRunCompiledExpr;
 		state->evalfunc_private = cstate;
@@ -2906,7 +2946,7 @@ BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
 
 	v_fn = llvm_function_reference(context, b, mod, fcinfo);
 
-	v_fcinfo = l_ptr_const(fcinfo, l_ptr(StructFunctionCallInfoData));
+	v_fcinfo = llvm_reloc_ptr(context, fcinfo, l_ptr(StructFunctionCallInfoData));
 	v_fcinfo_isnullp = l_struct_gep(b,
 									StructFunctionCallInfoData,
 									v_fcinfo,
@@ -2928,11 +2968,11 @@ BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
 		LLVMValueRef params[2];
 
 		params[0] = l_int64_const(lc, sizeof(NullableDatum) * fcinfo->nargs);
-		params[1] = l_ptr_const(fcinfo->args, l_ptr(LLVMInt8TypeInContext(lc)));
+		params[1] = llvm_reloc_ptr(context, fcinfo->args, l_ptr(LLVMInt8TypeInContext(lc)));
 		l_call(b, LLVMGetFunctionType(v_lifetime), v_lifetime, params, lengthof(params), "");
 
 		params[0] = l_int64_const(lc, sizeof(fcinfo->isnull));
-		params[1] = l_ptr_const(&fcinfo->isnull, l_ptr(LLVMInt8TypeInContext(lc)));
+		params[1] = llvm_reloc_ptr(context, &fcinfo->isnull, l_ptr(LLVMInt8TypeInContext(lc)));
 		l_call(b, LLVMGetFunctionType(v_lifetime), v_lifetime, params, lengthof(params), "");
 	}
 
@@ -2943,7 +2983,8 @@ BuildV1Call(LLVMJitContext *context, LLVMBuilderRef b,
  * Implement an expression step by calling the function funcname.
  */
 static LLVMValueRef
-build_EvalXFuncInt(LLVMBuilderRef b, LLVMModuleRef mod, const char *funcname,
+build_EvalXFuncInt(LLVMJitContext *context,
+				   LLVMBuilderRef b, LLVMModuleRef mod, const char *funcname,
 				   LLVMValueRef v_state, ExprEvalStep *op,
 				   int nargs, LLVMValueRef *v_args)
 {
@@ -2960,7 +3001,7 @@ build_EvalXFuncInt(LLVMBuilderRef b, LLVMModuleRef mod, const char *funcname,
 	params = palloc(sizeof(LLVMValueRef) * (2 + nargs));
 
 	params[argno++] = v_state;
-	params[argno++] = l_ptr_const(op, l_ptr(StructExprEvalStep));
+	params[argno++] = llvm_reloc_ptr(context, op, l_ptr(StructExprEvalStep));
 
 	for (int i = 0; i < nargs; i++)
 		params[argno++] = v_args[i];
@@ -0,0 +1,613 @@
+/*-------------------------------------------------------------------------
+ *
+ * stenciljit.c
+ *	  Template based JIT provider.
+ *
+ * This provider JIT compiles expressions without needing a compiler at
+ * runtime.  Each step of an expression is implemented by a precompiled
+ * template (see stenciljit_ops.c); compiling an expression just stitches
+ * calls to the templates of its steps together, patching in the address of
+ * each step and the targets of its jumps.  That removes the interpreter's
+ * dispatch overhead, in particular the hard to predict indirect jump after
+ * every step, at a compilation cost of microseconds rather than the
+ * milliseconds LLVM needs.  In turn, the emitted code is not optimized
+ * across steps, and neither tuple deforming nor functions are inlined.
+ *
+ * The code of all expressions compiled for a query is collected in a buffer,
+ * and only copied into executable memory once one of the expressions is
+ * evaluated for the first time.
+ *
+ * Code is currently only emitted for x86-64, using the System V calling
+ * convention.  Elsewhere, expressions are left to the interpreter.
+ *
+ * Copyright (c) 2024, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/stencil/stenciljit.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#if defined(__x86_64__) && !defined(WIN32)
+#define STENCILJIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "executor/execExpr.h"
+#include "jit/jit.h"
+#include "jit/stenciljit.h"
+#include "lib/stringinfo.h"
+#include "nodes/execnodes.h"
+#include "portability/instr_time.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+typedef struct StencilJitContext
+{
+	JitContext	base;
+
+	/* used to ensure cleanup of context */
+	ResourceOwner resowner;
+
+	/* code of compiled expressions not yet in executable memory */
+	StringInfoData code;
+
+	/* positions in code that need the code's final address added */
+	List	   *code_relocs;
+
+	/* StencilJitFunctions whose code is in code */
+	List	   *pending;
+
+	/* executable memory regions, as StencilJitRegions */
+	List	   *regions;
+} StencilJitContext;
+
+typedef struct StencilJitRegion
+{
+	void	   *addr;
+	Size		size;
+} StencilJitRegion;
+
+/* state of a compiled expression, stored in ExprState->evalfunc_private */
+typedef struct StencilJitFunction
+{
+	StencilJitContext *context;
+
+	/* offset of the function in the context's code */
+	int			offset;
+
+	/* was emission attempted, and its result */
+	bool		emitted;
+	ExprStateEvalFunc func;
+} StencilJitFunction;
+
+/* set once creating executable memory failed, no point retrying */
+static bool stencil_exec_memory_unavailable = false;
+
+
+static void stencil_release_context(JitContext *context);
+static void stencil_reset_after_error(void);
+static bool stencil_compile_expr(ExprState *state);
+
+static Datum ExecRunCompiledExpr(ExprState *state, ExprContext *econtext,
+								 bool *isNull);
+
+/* ResourceOwner callbacks to hold JitContexts  */
+static void ResOwnerReleaseJitContext(Datum res);
+
+static const ResourceOwnerDesc jit_resowner_desc =
+{
+	.name = "stencil JIT context",
+	.release_phase = RESOURCE_RELEASE_BEFORE_LOCKS,
+	.release_priority = RELEASE_PRIO_JIT_CONTEXTS,
+	.ReleaseResource = ResOwnerReleaseJitContext,
+	.DebugPrint = NULL			/* the default message is fine */
+};
+
+/* Convenience wrappers over ResourceOwnerRemember/Forget */
+static inline void
+ResourceOwnerRememberJIT(ResourceOwner owner, StencilJitContext *handle)
+{
+	ResourceOwnerRemember(owner, PointerGetDatum(handle), &jit_resowner_desc);
+}
+static inline void
+ResourceOwnerForgetJIT(ResourceOwner owner, StencilJitContext *handle)
+{
+	ResourceOwnerForget(owner, PointerGetDatum(handle), &jit_resowner_desc);
+}
+
+PG_MODULE_MAGIC;
+
+
+/*
+ * Initialize template JIT provider.
+ */
+void
+_PG_jit_provider_init(JitProviderCallbacks *cb)
+{
+	cb->reset_after_error = stencil_reset_after_error;
+	cb->release_context = stencil_release_context;
+	cb->compile_expr = stencil_compile_expr;
+}
+
+/*
+ * Create a context for JITing work.
+ *
+ * The context, including subsidiary resources, will be cleaned up either when
+ * the context is explicitly released, or when the lifetime of
+ * CurrentResourceOwner ends (usually the end of the current [sub]xact).
+ */
+static StencilJitContext *
+stencil_create_context(int jitFlags)
+{
+	StencilJitContext *context;
+
+	ResourceOwnerEnlarge(CurrentResourceOwner);
+
+	context = MemoryContextAllocZero(TopMemoryContext,
+									 sizeof(StencilJitContext));
+	context->base.flags = jitFlags;
+
+	/* ensure cleanup */
+	context->resowner = CurrentResourceOwner;
+	ResourceOwnerRememberJIT(CurrentResourceOwner, context);
+
+	return context;
+}
+
+/*
+ * Release resources required by one stencil context.
+ */
+static void
+stencil_release_context(JitContext *context)
+{
+	StencilJitContext *stencil_context = (StencilJitContext *) context;
+
+	if (stencil_context->code.data)
+		pfree(stencil_context->code.data);
+	list_free(stencil_context->code_relocs);
+	list_free(stencil_context->pending);
+
+	/* unmapping can't fail for memory we mapped ourselves */
+#ifdef STENCILJIT_SUPPORTED
+	foreach_ptr(StencilJitRegion, region, stencil_context->regions)
+		munmap(region->addr, region->size);
+#endif
+	list_free_deep(stencil_context->regions);
+	stencil_context->regions = NIL;
+
+	if (stencil_context->resowner)
+		ResourceOwnerForgetJIT(stencil_context->resowner, stencil_context);
+}
+
+/*
+ * Nothing to do, all state is either in memory contexts or owned by
+ * resource owners.
+ */
+static void
+stencil_reset_after_error(void)
+{
+}
+
+#ifdef STENCILJIT_SUPPORTED
+
+/*
+ * Machine code building blocks.
+ *
+ * The emitted function keeps its arguments (state, econtext, isnull) in
+ * callee-saved registers, and passes them to each step's template as
+ * (state, op, econtext, isnull).  Pushing three registers also keeps the
+ * stack aligned to 16 bytes for the calls.
+ */
+static const unsigned char stencil_prologue[] = {
+	0x53,						/* push %rbx */
+	0x41, 0x54,					/* push %r12 */
+	0x41, 0x55,					/* push %r13 */
+	0x48, 0x89, 0xfb,			/* mov %rdi,%rbx */
+	0x49, 0x89, 0xf4,			/* mov %rsi,%r12 */
+	0x49, 0x89, 0xd5,			/* mov %rdx,%r13 */
+};
+
+static const unsigned char stencil_epilogue[] = {
+	0x41, 0x5d,					/* pop %r13 */
+	0x41, 0x5c,					/* pop %r12 */
+	0x5b,						/* pop %rbx */
+	0xc3,						/* ret */
+};
+
+/* position of a rel32 jump operand, and the step it jumps to */
+typedef struct StencilJumpFixup
+{
+	int			offset;
+	int			target;
+} StencilJumpFixup;
+
+static inline void
+emit_bytes(StringInfo code, const unsigned char *bytes, int len)
+{
+	appendBinaryStringInfoNT(code, bytes, len);
+}
+
+static inline void
+emit_byte(StringInfo code, unsigned char byte)
+{
+	appendStringInfoCharMacro(code, (char) byte);
+}
+
+static inline void
+emit_imm64(StringInfo code, uint64 value)
+{
+	appendBinaryStringInfoNT(code, &value, sizeof(value));
+}
+
+/* emit a rel32 operand to be pointed at step target later */
+static inline void
+emit_jump_target(StringInfo code, StencilJumpFixup *fixups, int *nfixups,
+				 int target)
+{
+	int32		placeholder = 0;
+
+	fixups[*nfixups].offset = code->len;
+	fixups[*nfixups].target = target;
+	(*nfixups)++;
+
+	appendBinaryStringInfoNT(code, &placeholder, sizeof(placeholder));
+}
+
+/* emit a call of the template of step op */
+static void
+emit_template_call(StringInfo code, ExprEvalStep *op, void *func)
+{
+	static const unsigned char mov_state[] = {0x48, 0x89, 0xdf};	/* mov %rbx,%rdi */
+	static const unsigned char mov_econtext[] = {0x4c, 0x89, 0xe2}; /* mov %r12,%rdx */
+	static const unsigned char mov_isnull[] = {0x4c, 0x89, 0xe9};	/* mov %r13,%rcx */
+	static const unsigned char call_rax[] = {0xff, 0xd0};	/* call *%rax */
+
+	emit_bytes(code, mov_state, sizeof(mov_state));
+	/* movabs $op,%rsi */
+	emit_byte(code, 0x48);
+	emit_byte(code, 0xbe);
+	emit_imm64(code, (uint64) (uintptr_t) op);
+	emit_bytes(code, mov_econtext, sizeof(mov_econtext));
+	emit_bytes(code, mov_isnull, sizeof(mov_isnull));
+	/* movabs $func,%rax */
+	emit_byte(code, 0x48);
+	emit_byte(code, 0xb8);
+	emit_imm64(code, (uint64) (uintptr_t) func);
+	emit_bytes(code, call_rax, sizeof(call_rax));
+}
+
+#endif							/* STENCILJIT_SUPPORTED */
+
+/*
+ * JIT compile expression.
+ */
+static bool
+stencil_compile_expr(ExprState *state)
+{
+#ifdef STENCILJIT_SUPPORTED
+	PlanState  *parent = state->parent;
+	StencilJitContext *context;
+	StencilJitFunction *function;
+	StringInfo	code;
+	int			start;
+	int		   *step_offsets;
+	StencilJumpFixup *fixups;
+	int			nfixups = 0;
+	List	   *table_refs = NIL;
+	instr_time	starttime;
+	instr_time	endtime;
+
+	/* see llvm_compile_expr() */
+	Assert(parent);
+
+	if (stencil_exec_memory_unavailable)
+		return false;
+
+	/*
+	 * The interpreter has fast paths for the most common very short
+	 * expressions, which compiled code couldn't beat.
+	 */
+	if (state->steps_len <= 3)
+		return false;
+
+	/* get or create JIT context */
+	if (parent->state->es_jit)
+		context = (StencilJitContext *) parent->state->es_jit;
+	else
+	{
+		context = stencil_create_context(parent->state->es_jit_flags);
+		parent->state->es_jit = &context->base;
+	}
+
+	INSTR_TIME_SET_CURRENT(starttime);
+
+	code = &context->code;
+	if (code->data == NULL)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+		initStringInfo(code);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	/* start functions at 16 byte boundaries, pad with int3 */
+	while (code->len % 16 != 0)
+		emit_byte(code, 0xcc);
+	start = code->len;
+
+	step_offsets = palloc(sizeof(int) * state->steps_len);
+	fixups = palloc(sizeof(StencilJumpFixup) *
+					state->steps_len * STENCIL_MAX_JUMPS);
+
+	emit_bytes(code, stencil_prologue, sizeof(stencil_prologue));
+
+	for (int opno = 0; opno < state->steps_len; opno++)
+	{
+		ExprEvalStep *op = &state->steps[opno];
+		Stencil		stencil;
+
+		step_offsets[opno] = code->len;
+
+		if (!stencil_for_step(state, op, &stencil))
+		{
+			/* leave the expression to the interpreter */
+			code->len = start;
+			pfree(step_offsets);
+			pfree(fixups);
+			list_free(table_refs);
+			return false;
+		}
+
+		if (stencil.kind == STENCIL_JUMP)
+		{
+			/* jmp rel32 */
+			emit_byte(code, 0xe9);
+			emit_jump_target(code, fixups, &nfixups, stencil.jumps[0]);
+			continue;
+		}
+
+		emit_template_call(code, op, stencil.func);
+
+		switch (stencil.kind)
+		{
+			case STENCIL_NEXT:
+				break;
+			case STENCIL_JUMP:
+				Assert(false);
+				break;
+			case STENCIL_JUMP_IF_TRUE:
+			case STENCIL_JUMP_IF_FALSE:
+				/* test %al,%al */
+				emit_byte(code, 0x84);
+				emit_byte(code, 0xc0);
+				/* jnz / jz rel32 */
+				emit_byte(code, 0x0f);
+				emit_byte(code,
+						  stencil.kind == STENCIL_JUMP_IF_TRUE ? 0x85 : 0x84);
+				emit_jump_target(code, fixups, &nfixups, stencil.jumps[0]);
+				break;
+			case STENCIL_SWITCH:
+				for (int i = 0; i < STENCIL_MAX_JUMPS; i++)
+				{
+					/* cmp $(i + 1),%eax */
+					emit_byte(code, 0x83);
+					emit_byte(code, 0xf8);
+					emit_byte(code, (unsigned char) (i + 1));
+					/* je rel32 */
+					emit_byte(code, 0x0f);
+					emit_byte(code, 0x84);
+					emit_jump_target(code, fixups, &nfixups, stencil.jumps[i]);
+				}
+				break;
+			case STENCIL_DYNAMIC:
+				{
+					static const unsigned char jump_via_table[] = {
+						0x48, 0x63, 0xc0,	/* movslq %eax,%rax */
+						0x48, 0xb9, /* movabs $table,%rcx */
+					};
+					static const unsigned char jmp_indirect[] = {
+						0xff, 0x24, 0xc1	/* jmp *(%rcx,%rax,8) */
+					};
+
+					emit_bytes(code, jump_via_table, sizeof(jump_via_table));
+					table_refs = lappend_int(table_refs, code->len);
+					emit_imm64(code, 0);
+					emit_bytes(code, jmp_indirect, sizeof(jmp_indirect));
+				}
+				break;
+			case STENCIL_DONE:
+				emit_bytes(code, stencil_epilogue, sizeof(stencil_epilogue));
+				break;
+		}
+	}
+
+	/* point jumps at their target steps */
+	for (int i = 0; i < nfixups; i++)
+	{
+		int			target = fixups[i].target;
+		int32		rel;
+
+		Assert(target >= 0 && target < state->steps_len);
+		rel = step_offsets[target] - (fixups[i].offset + 4);
+		memcpy(code->data + fixups[i].offset, &rel, sizeof(rel));
+	}
+
+	/*
+	 * Steps continuing at a step determined at runtime jump via a table of
+	 * the addresses of all steps, appended to the function.
+	 */
+	if (table_refs != NIL)
+	{
+		int			table_offset;
+
+		while (code->len % 8 != 0)
+			emit_byte(code, 0xcc);
+		table_offset = code->len;
+
+		for (int opno = 0; opno < state->steps_len; opno++)
+		{
+			context->code_relocs = lappend_int(context->code_relocs, code->len);
+			emit_imm64(code, (uint64) step_offsets[opno]);
+		}
+
+		foreach_int(ref, table_refs)
+		{
+			uint64		value = (uint64) table_offset;
+
+			memcpy(code->data + ref, &value, sizeof(value));
+			context->code_relocs = lappend_int(context->code_relocs, ref);
+		}
+		list_free(table_refs);
+	}
+
+	pfree(step_offsets);
+	pfree(fixups);
+
+	function = palloc0(sizeof(StencilJitFunction));
+	function->context = context;
+	function->offset = start;
+	context->pending = lappend(context->pending, function);
+
+	/*
+	 * The code is only made executable when an expression is evaluated for
+	 * the first time, see ExecRunCompiledExpr().
+	 */
+	state->evalfunc = ExecRunCompiledExpr;
+	state->evalfunc_private = function;
+
+	INSTR_TIME_SET_CURRENT(endtime);
+	INSTR_TIME_ACCUM_DIFF(context->base.instr.generation_counter,
+						  endtime, starttime);
+
+	context->base.instr.created_functions++;
+
+	return true;
+#else
+	return false;
+#endif							/* STENCILJIT_SUPPORTED */
+}
+
+/*
+ * Copy the code of all pending functions of context into executable memory.
+ * If that fails, the functions are left without code.
+ */
+static void
+stencil_emit_pending(StencilJitContext *context)
+{
+#ifdef STENCILJIT_SUPPORTED
+	StringInfo	code = &context->code;
+	Size		pagesize = (Size) sysconf(_SC_PAGESIZE);
+	Size		size;
+	char	   *addr;
+	instr_time	starttime;
+	instr_time	endtime;
+
+	INSTR_TIME_SET_CURRENT(starttime);
+
+	size = TYPEALIGN(pagesize, code->len);
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (addr == MAP_FAILED)
+	{
+		elog(DEBUG1, "could not map memory for JIT code: %m");
+		addr = NULL;
+	}
+	else
+	{
+		memcpy(addr, code->data, code->len);
+
+		foreach_int(reloc, context->code_relocs)
+		{
+			uint64		value;
+
+			memcpy(&value, addr + reloc, sizeof(value));
+			value += (uint64) (uintptr_t) addr;
+			memcpy(addr + reloc, &value, sizeof(value));
+		}
+
+		/* never have memory be writable and executable at the same time */
+		if (mprotect(addr, size, PROT_READ | PROT_EXEC) != 0)
+		{
+			/* e.g. forbidden by SELinux, don't try again */
+			elog(DEBUG1, "could not make JIT code executable: %m");
+			stencil_exec_memory_unavailable = true;
+			munmap(addr, size);
+			addr = NULL;
+		}
+		else
+		{
+			StencilJitRegion *region;
+
+			region = MemoryContextAlloc(TopMemoryContext,
+										sizeof(StencilJitRegion));
+			region->addr = addr;
+			region->size = size;
+			context->regions = lappend(context->regions, region);
+		}
+	}
+
+	foreach_ptr(StencilJitFunction, function, context->pending)
+	{
+		function->emitted = true;
+		if (addr)
+			function->func = (ExprStateEvalFunc) (addr + function->offset);
+	}
+
+	list_free(context->pending);
+	context->pending = NIL;
+	list_free(context->code_relocs);
+	context->code_relocs = NIL;
+	resetStringInfo(code);
+
+	INSTR_TIME_SET_CURRENT(endtime);
+	INSTR_TIME_ACCUM_DIFF(context->base.instr.emission_counter,
+						  endtime, starttime);
+#endif							/* STENCILJIT_SUPPORTED */
+}
+
+/*
+ * Run compiled expression.
+ *
+ * This will only be called the first time a JITed expression is called. We
+ * first make sure the expression is still up-to-date, and then copy the code
+ * into executable memory, together with that of the other expressions
+ * compiled since.  If that isn't possible, the expression is interpreted
+ * instead.
+ */
+static Datum
+ExecRunCompiledExpr(ExprState *state, ExprContext *econtext, bool *isNull)
+{
+	StencilJitFunction *function = state->evalfunc_private;
+
+	if (!function->emitted)
+		stencil_emit_pending(function->context);
+
+	if (function->func == NULL)
+	{
+		ExecReadyInterpretedExpr(state);
+		return state->evalfunc(state, econtext, isNull);
+	}
+
+	CheckExprStillValid(state, econtext);
+
+	/* remove indirection via this function for future calls */
+	state->evalfunc = function->func;
+
+	return state->evalfunc(state, econtext, isNull);
+}
+
+/*
+ * ResourceOwner callbacks
+ */
+static void
+ResOwnerReleaseJitContext(Datum res)
+{
+	StencilJitContext *context = (StencilJitContext *) DatumGetPointer(res);
+
+	context->resowner = NULL;
+	jit_release_context(&context->base);
+}
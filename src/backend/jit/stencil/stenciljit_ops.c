@@ -0,0 +1,1305 @@
+/*-------------------------------------------------------------------------
+ *
+ * stenciljit_ops.c
+ *	  Precompiled templates for the expression steps of the template based
+ *	  JIT provider.
+ *
+ * Each template implements one ExprEvalOp the same way the corresponding
+ * EEO_CASE in execExprInterp.c does, except that control flow is left to the
+ * emitted code: templates of steps that may jump return where to continue
+ * (see StencilKind).  Steps that the interpreter implements out of line use
+ * the same out of line functions directly as their templates.
+ *
+ * Keep this in sync with ExecInterpExpr().
+ *
+ * Copyright (c) 2024, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/jit/stencil/stenciljit_ops.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "executor/nodeAgg.h"
+#include "jit/stenciljit.h"
+#include "nodes/execnodes.h"
+#include "port/pg_bitutils.h"
+#include "utils/expandeddatum.h"
+
+
+static Datum
+stencil_done(ExprState *state, ExprEvalStep *op, ExprContext *econtext,
+			 bool *isnull)
+{
+	*isnull = state->resnull;
+	return state->resvalue;
+}
+
+static void
+stencil_inner_fetchsome(ExprState *state, ExprEvalStep *op,
+						ExprContext *econtext)
+{
+	slot_getsomeattrs(econtext->ecxt_innertuple, op->d.fetch.last_var);
+}
+
+static void
+stencil_outer_fetchsome(ExprState *state, ExprEvalStep *op,
+						ExprContext *econtext)
+{
+	slot_getsomeattrs(econtext->ecxt_outertuple, op->d.fetch.last_var);
+}
+
+static void
+stencil_scan_fetchsome(ExprState *state, ExprEvalStep *op,
+					   ExprContext *econtext)
+{
+	slot_getsomeattrs(econtext->ecxt_scantuple, op->d.fetch.last_var);
+}
+
+static void
+stencil_inner_var(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
+{
+	TupleTableSlot *slot = econtext->ecxt_innertuple;
+	int			attnum = op->d.var.attnum;
+
+	Assert(attnum >= 0 && attnum < slot->tts_nvalid);
+	*op->resvalue = slot->tts_values[attnum];
+	*op->resnull = slot->tts_isnull[attnum];
+}
+
+static void
+stencil_outer_var(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
+{
+	TupleTableSlot *slot = econtext->ecxt_outertuple;
+	int			attnum = op->d.var.attnum;
+
+	Assert(attnum >= 0 && attnum < slot->tts_nvalid);
+	*op->resvalue = slot->tts_values[attnum];
+	*op->resnull = slot->tts_isnull[attnum];
+}
+
+static void
+stencil_scan_var(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
+{
+	TupleTableSlot *slot = econtext->ecxt_scantuple;
+	int			attnum = op->d.var.attnum;
+
+	Assert(attnum >= 0 && attnum < slot->tts_nvalid);
+	*op->resvalue = slot->tts_values[attnum];
+	*op->resnull = slot->tts_isnull[attnum];
+}
+
+static void
+stencil_inner_sysvar(ExprState *state, ExprEvalStep *op,
+					 ExprContext *econtext)
+{
+	ExecEvalSysVar(state, op, econtext, econtext->ecxt_innertuple);
+}
+
+static void
+stencil_outer_sysvar(ExprState *state, ExprEvalStep *op,
+					 ExprContext *econtext)
+{
+	ExecEvalSysVar(state, op, econtext, econtext->ecxt_outertuple);
+}
+
+static void
+stencil_scan_sysvar(ExprState *state, ExprEvalStep *op,
+					ExprContext *econtext)
+{
+	ExecEvalSysVar(state, op, econtext, econtext->ecxt_scantuple);
+}
+
+static void
+stencil_assign_inner_var(ExprState *state, ExprEvalStep *op,
+						 ExprContext *econtext)
+{
+	TupleTableSlot *resultslot = state->resultslot;
+	TupleTableSlot *slot = econtext->ecxt_innertuple;
+	int			resultnum = op->d.assign_var.resultnum;
+	int			attnum = op->d.assign_var.attnum;
+
+	Assert(attnum >= 0 && attnum < slot->tts_nvalid);
+	Assert(resultnum >= 0 && resultnum < resultslot->tts_tupleDescriptor->natts);
+	resultslot->tts_values[resultnum] = slot->tts_values[attnum];
+	resultslot->tts_isnull[resultnum] = slot->tts_isnull[attnum];
+}
+
+static void
+stencil_assign_outer_var(ExprState *state, ExprEvalStep *op,
+						 ExprContext *econtext)
+{
+	TupleTableSlot *resultslot = state->resultslot;
+	TupleTableSlot *slot = econtext->ecxt_outertuple;
+	int			resultnum = op->d.assign_var.resultnum;
+	int			attnum = op->d.assign_var.attnum;
+
+	Assert(attnum >= 0 && attnum < slot->tts_nvalid);
+	Assert(resultnum >= 0 && resultnum < resultslot->tts_tupleDescriptor->natts);
+	resultslot->tts_values[resultnum] = slot->tts_values[attnum];
+	resultslot->tts_isnull[resultnum] = slot->tts_isnull[attnum];
+}
+
+static void
+stencil_assign_scan_var(ExprState *state, ExprEvalStep *op,
+						ExprContext *econtext)
+{
+	TupleTableSlot *resultslot = state->resultslot;
+	TupleTableSlot *slot = econtext->ecxt_scantuple;
+	int			resultnum = op->d.assign_var.resultnum;
+	int			attnum = op->d.assign_var.attnum;
+
+	Assert(attnum >= 0 && attnum < slot->tts_nvalid);
+	Assert(resultnum >= 0 && resultnum < resultslot->tts_tupleDescriptor->natts);
+	resultslot->tts_values[resultnum] = slot->tts_values[attnum];
+	resultslot->tts_isnull[resultnum] = slot->tts_isnull[attnum];
+}
+
+static void
+stencil_assign_tmp(ExprState *state, ExprEvalStep *op)
+{
+	TupleTableSlot *resultslot = state->resultslot;
+	int			resultnum = op->d.assign_tmp.resultnum;
+
+	Assert(resultnum >= 0 && resultnum < resultslot->tts_tupleDescriptor->natts);
+	resultslot->tts_values[resultnum] = state->resvalue;
+	resultslot->tts_isnull[resultnum] = state->resnull;
+}
+
+static void
+stencil_assign_tmp_make_ro(ExprState *state, ExprEvalStep *op)
+{
+	TupleTableSlot *resultslot = state->resultslot;
+	int			resultnum = op->d.assign_tmp.resultnum;
+
+	Assert(resultnum >= 0 && resultnum < resultslot->tts_tupleDescriptor->natts);
+	resultslot->tts_isnull[resultnum] = state->resnull;
+	if (!resultslot->tts_isnull[resultnum])
+		resultslot->tts_values[resultnum] =
+			MakeExpandedObjectReadOnlyInternal(state->resvalue);
+	else
+		resultslot->tts_values[resultnum] = state->resvalue;
+}
+
+static void
+stencil_const(ExprState *state, ExprEvalStep *op)
+{
+	*op->resnull = op->d.constval.isnull;
+	*op->resvalue = op->d.constval.value;
+}
+
+static void
+stencil_funcexpr(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+	Datum		d;
+
+	fcinfo->isnull = false;
+	d = op->d.func.fn_addr(fcinfo);
+	*op->resvalue = d;
+	*op->resnull = fcinfo->isnull;
+}
+
+static void
+stencil_funcexpr_strict(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+	NullableDatum *args = fcinfo->args;
+	int			nargs = op->d.func.nargs;
+	Datum		d;
+
+	for (int argno = 0; argno < nargs; argno++)
+	{
+		if (args[argno].isnull)
+		{
+			*op->resnull = true;
+			return;
+		}
+	}
+	fcinfo->isnull = false;
+	d = op->d.func.fn_addr(fcinfo);
+	*op->resvalue = d;
+	*op->resnull = fcinfo->isnull;
+}
+
+static bool
+stencil_bool_and_step_first(ExprState *state, ExprEvalStep *op)
+{
+	*op->d.boolexpr.anynull = false;
+
+	if (*op->resnull)
+		*op->d.boolexpr.anynull = true;
+	else if (!DatumGetBool(*op->resvalue))
+		return true;
+
+	return false;
+}
+
+static bool
+stencil_bool_and_step(ExprState *state, ExprEvalStep *op)
+{
+	if (*op->resnull)
+		*op->d.boolexpr.anynull = true;
+	else if (!DatumGetBool(*op->resvalue))
+		return true;
+
+	return false;
+}
+
+static void
+stencil_bool_and_step_last(ExprState *state, ExprEvalStep *op)
+{
+	if (!*op->resnull && DatumGetBool(*op->resvalue) &&
+		*op->d.boolexpr.anynull)
+	{
+		*op->resvalue = (Datum) 0;
+		*op->resnull = true;
+	}
+}
+
+static bool
+stencil_bool_or_step_first(ExprState *state, ExprEvalStep *op)
+{
+	*op->d.boolexpr.anynull = false;
+
+	if (*op->resnull)
+		*op->d.boolexpr.anynull = true;
+	else if (DatumGetBool(*op->resvalue))
+		return true;
+
+	return false;
+}
+
+static bool
+stencil_bool_or_step(ExprState *state, ExprEvalStep *op)
+{
+	if (*op->resnull)
+		*op->d.boolexpr.anynull = true;
+	else if (DatumGetBool(*op->resvalue))
+		return true;
+
+	return false;
+}
+
+static void
+stencil_bool_or_step_last(ExprState *state, ExprEvalStep *op)
+{
+	if (!*op->resnull && !DatumGetBool(*op->resvalue) &&
+		*op->d.boolexpr.anynull)
+	{
+		*op->resvalue = (Datum) 0;
+		*op->resnull = true;
+	}
+}
+
+static void
+stencil_bool_not_step(ExprState *state, ExprEvalStep *op)
+{
+	*op->resvalue = BoolGetDatum(!DatumGetBool(*op->resvalue));
+}
+
+static bool
+stencil_qual(ExprState *state, ExprEvalStep *op)
+{
+	if (*op->resnull || !DatumGetBool(*op->resvalue))
+	{
+		*op->resnull = false;
+		*op->resvalue = BoolGetDatum(false);
+		return true;
+	}
+
+	return false;
+}
+
+static bool
+stencil_jump_if_null(ExprState *state, ExprEvalStep *op)
+{
+	return *op->resnull;
+}
+
+static bool
+stencil_jump_if_not_null(ExprState *state, ExprEvalStep *op)
+{
+	return !*op->resnull;
+}
+
+static bool
+stencil_jump_if_not_true(ExprState *state, ExprEvalStep *op)
+{
+	return *op->resnull || !DatumGetBool(*op->resvalue);
+}
+
+static void
+stencil_nulltest_isnull(ExprState *state, ExprEvalStep *op)
+{
+	*op->resvalue = BoolGetDatum(*op->resnull);
+	*op->resnull = false;
+}
+
+static void
+stencil_nulltest_isnotnull(ExprState *state, ExprEvalStep *op)
+{
+	*op->resvalue = BoolGetDatum(!*op->resnull);
+	*op->resnull = false;
+}
+
+static void
+stencil_booltest_is_true(ExprState *state, ExprEvalStep *op)
+{
+	if (*op->resnull)
+	{
+		*op->resvalue = BoolGetDatum(false);
+		*op->resnull = false;
+	}
+}
+
+static void
+stencil_booltest_is_not_true(ExprState *state, ExprEvalStep *op)
+{
+	if (*op->resnull)
+	{
+		*op->resvalue = BoolGetDatum(true);
+		*op->resnull = false;
+	}
+	else
+		*op->resvalue = BoolGetDatum(!DatumGetBool(*op->resvalue));
+}
+
+static void
+stencil_booltest_is_false(ExprState *state, ExprEvalStep *op)
+{
+	if (*op->resnull)
+	{
+		*op->resvalue = BoolGetDatum(false);
+		*op->resnull = false;
+	}
+	else
+		*op->resvalue = BoolGetDatum(!DatumGetBool(*op->resvalue));
+}
+
+static void
+stencil_booltest_is_not_false(ExprState *state, ExprEvalStep *op)
+{
+	if (*op->resnull)
+	{
+		*op->resvalue = BoolGetDatum(true);
+		*op->resnull = false;
+	}
+}
+
+static void
+stencil_case_testval(ExprState *state, ExprEvalStep *op,
+					 ExprContext *econtext)
+{
+	if (op->d.casetest.value)
+	{
+		*op->resvalue = *op->d.casetest.value;
+		*op->resnull = *op->d.casetest.isnull;
+	}
+	else
+	{
+		*op->resvalue = econtext->caseValue_datum;
+		*op->resnull = econtext->caseValue_isNull;
+	}
+}
+
+static void
+stencil_domain_testval(ExprState *state, ExprEvalStep *op,
+					   ExprContext *econtext)
+{
+	if (op->d.casetest.value)
+	{
+		*op->resvalue = *op->d.casetest.value;
+		*op->resnull = *op->d.casetest.isnull;
+	}
+	else
+	{
+		*op->resvalue = econtext->domainValue_datum;
+		*op->resnull = econtext->domainValue_isNull;
+	}
+}
+
+static void
+stencil_make_readonly(ExprState *state, ExprEvalStep *op)
+{
+	if (!*op->d.make_readonly.isnull)
+		*op->resvalue =
+			MakeExpandedObjectReadOnlyInternal(*op->d.make_readonly.value);
+	*op->resnull = *op->d.make_readonly.isnull;
+}
+
+static void
+stencil_iocoerce(ExprState *state, ExprEvalStep *op)
+{
+	char	   *str;
+
+	if (*op->resnull)
+		str = NULL;
+	else
+	{
+		FunctionCallInfo fcinfo_out;
+
+		fcinfo_out = op->d.iocoerce.fcinfo_data_out;
+		fcinfo_out->args[0].value = *op->resvalue;
+		fcinfo_out->args[0].isnull = false;
+
+		fcinfo_out->isnull = false;
+		str = DatumGetCString(FunctionCallInvoke(fcinfo_out));
+
+		Assert(!fcinfo_out->isnull);
+	}
+
+	if (!op->d.iocoerce.finfo_in->fn_strict || str != NULL)
+	{
+		FunctionCallInfo fcinfo_in;
+		Datum		d;
+
+		fcinfo_in = op->d.iocoerce.fcinfo_data_in;
+		fcinfo_in->args[0].value = PointerGetDatum(str);
+		fcinfo_in->args[0].isnull = *op->resnull;
+
+		fcinfo_in->isnull = false;
+		d = FunctionCallInvoke(fcinfo_in);
+		*op->resvalue = d;
+
+		Assert((str == NULL) == *op->resnull);
+		Assert((str == NULL) == fcinfo_in->isnull);
+	}
+}
+
+static void
+stencil_distinct(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+
+	if (fcinfo->args[0].isnull && fcinfo->args[1].isnull)
+	{
+		*op->resvalue = BoolGetDatum(false);
+		*op->resnull = false;
+	}
+	else if (fcinfo->args[0].isnull || fcinfo->args[1].isnull)
+	{
+		*op->resvalue = BoolGetDatum(true);
+		*op->resnull = false;
+	}
+	else
+	{
+		Datum		eqresult;
+
+		fcinfo->isnull = false;
+		eqresult = op->d.func.fn_addr(fcinfo);
+		*op->resvalue = BoolGetDatum(!DatumGetBool(eqresult));
+		*op->resnull = fcinfo->isnull;
+	}
+}
+
+static void
+stencil_not_distinct(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+
+	if (fcinfo->args[0].isnull && fcinfo->args[1].isnull)
+	{
+		*op->resvalue = BoolGetDatum(true);
+		*op->resnull = false;
+	}
+	else if (fcinfo->args[0].isnull || fcinfo->args[1].isnull)
+	{
+		*op->resvalue = BoolGetDatum(false);
+		*op->resnull = false;
+	}
+	else
+	{
+		Datum		eqresult;
+
+		fcinfo->isnull = false;
+		eqresult = op->d.func.fn_addr(fcinfo);
+		*op->resvalue = eqresult;
+		*op->resnull = fcinfo->isnull;
+	}
+}
+
+static void
+stencil_nullif(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.func.fcinfo_data;
+
+	if (!fcinfo->args[0].isnull && !fcinfo->args[1].isnull)
+	{
+		Datum		result;
+
+		fcinfo->isnull = false;
+		result = op->d.func.fn_addr(fcinfo);
+
+		if (!fcinfo->isnull && DatumGetBool(result))
+		{
+			*op->resvalue = (Datum) 0;
+			*op->resnull = true;
+			return;
+		}
+	}
+
+	*op->resvalue = fcinfo->args[0].value;
+	*op->resnull = fcinfo->args[0].isnull;
+}
+
+/* returns 1 to jump to jumpnull, 2 to jump to jumpdone */
+static int
+stencil_rowcompare_step(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.rowcompare_step.fcinfo_data;
+	Datum		d;
+
+	if (op->d.rowcompare_step.finfo->fn_strict &&
+		(fcinfo->args[0].isnull || fcinfo->args[1].isnull))
+	{
+		*op->resnull = true;
+		return 1;
+	}
+
+	fcinfo->isnull = false;
+	d = op->d.rowcompare_step.fn_addr(fcinfo);
+	*op->resvalue = d;
+
+	if (fcinfo->isnull)
+	{
+		*op->resnull = true;
+		return 1;
+	}
+	*op->resnull = false;
+
+	if (DatumGetInt32(*op->resvalue) != 0)
+		return 2;
+
+	return 0;
+}
+
+static void
+stencil_rowcompare_final(ExprState *state, ExprEvalStep *op)
+{
+	int32		cmpresult = DatumGetInt32(*op->resvalue);
+	RowCompareType rctype = op->d.rowcompare_final.rctype;
+
+	*op->resnull = false;
+	switch (rctype)
+	{
+			/* EQ and NE cases aren't allowed here */
+		case ROWCOMPARE_LT:
+			*op->resvalue = BoolGetDatum(cmpresult < 0);
+			break;
+		case ROWCOMPARE_LE:
+			*op->resvalue = BoolGetDatum(cmpresult <= 0);
+			break;
+		case ROWCOMPARE_GE:
+			*op->resvalue = BoolGetDatum(cmpresult >= 0);
+			break;
+		case ROWCOMPARE_GT:
+			*op->resvalue = BoolGetDatum(cmpresult > 0);
+			break;
+		default:
+			Assert(false);
+			break;
+	}
+}
+
+static void
+stencil_hashdatum_set_initval(ExprState *state, ExprEvalStep *op)
+{
+	*op->resvalue = op->d.hashdatum_initvalue.init_value;
+	*op->resnull = false;
+}
+
+static void
+stencil_hashdatum_first(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.hashdatum.fcinfo_data;
+
+	if (!fcinfo->args[0].isnull)
+		*op->resvalue = op->d.hashdatum.fn_addr(fcinfo);
+	else
+		*op->resvalue = (Datum) 0;
+
+	*op->resnull = false;
+}
+
+static bool
+stencil_hashdatum_first_strict(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.hashdatum.fcinfo_data;
+
+	if (fcinfo->args[0].isnull)
+	{
+		*op->resnull = true;
+		*op->resvalue = (Datum) 0;
+		return true;
+	}
+
+	*op->resvalue = op->d.hashdatum.fn_addr(fcinfo);
+	*op->resnull = false;
+
+	return false;
+}
+
+static void
+stencil_hashdatum_next32(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.hashdatum.fcinfo_data;
+	uint32		existinghash;
+
+	existinghash = DatumGetUInt32(op->d.hashdatum.iresult->value);
+	existinghash = pg_rotate_left32(existinghash, 1);
+
+	if (!fcinfo->args[0].isnull)
+	{
+		uint32		hashvalue;
+
+		hashvalue = DatumGetUInt32(op->d.hashdatum.fn_addr(fcinfo));
+		existinghash = existinghash ^ hashvalue;
+	}
+
+	*op->resvalue = UInt32GetDatum(existinghash);
+	*op->resnull = false;
+}
+
+static bool
+stencil_hashdatum_next32_strict(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.hashdatum.fcinfo_data;
+	uint32		existinghash;
+	uint32		hashvalue;
+
+	if (fcinfo->args[0].isnull)
+	{
+		*op->resnull = true;
+		*op->resvalue = (Datum) 0;
+		return true;
+	}
+
+	existinghash = DatumGetUInt32(op->d.hashdatum.iresult->value);
+	existinghash = pg_rotate_left32(existinghash, 1);
+
+	hashvalue = DatumGetUInt32(op->d.hashdatum.fn_addr(fcinfo));
+	*op->resvalue = UInt32GetDatum(existinghash ^ hashvalue);
+	*op->resnull = false;
+
+	return false;
+}
+
+static void
+stencil_aggref(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
+{
+	int			aggno = op->d.aggref.aggno;
+
+	Assert(econtext->ecxt_aggvalues != NULL);
+
+	*op->resvalue = econtext->ecxt_aggvalues[aggno];
+	*op->resnull = econtext->ecxt_aggnulls[aggno];
+}
+
+static void
+stencil_window_func(ExprState *state, ExprEvalStep *op,
+					ExprContext *econtext)
+{
+	WindowFuncExprState *wfunc = op->d.window_func.wfstate;
+
+	Assert(econtext->ecxt_aggvalues != NULL);
+
+	*op->resvalue = econtext->ecxt_aggvalues[wfunc->wfuncno];
+	*op->resnull = econtext->ecxt_aggnulls[wfunc->wfuncno];
+}
+
+static int
+stencil_json_expr_path(ExprState *state, ExprEvalStep *op,
+					   ExprContext *econtext)
+{
+	return ExecEvalJsonExprPath(state, op, econtext);
+}
+
+static void
+stencil_agg_deserialize(ExprState *state, ExprEvalStep *op)
+{
+	FunctionCallInfo fcinfo = op->d.agg_deserialize.fcinfo_data;
+	AggState   *aggstate = castNode(AggState, state->parent);
+	MemoryContext oldContext;
+
+	oldContext = MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+	fcinfo->isnull = false;
+	*op->resvalue = FunctionCallInvoke(fcinfo);
+	*op->resnull = fcinfo->isnull;
+	MemoryContextSwitchTo(oldContext);
+}
+
+static bool
+stencil_agg_strict_deserialize(ExprState *state, ExprEvalStep *op)
+{
+	/* Don't call a strict deserialization function with NULL input */
+	if (op->d.agg_deserialize.fcinfo_data->args[0].isnull)
+		return true;
+
+	stencil_agg_deserialize(state, op);
+
+	return false;
+}
+
+static bool
+stencil_agg_strict_input_check_args(ExprState *state, ExprEvalStep *op)
+{
+	NullableDatum *args = op->d.agg_strict_input_check.args;
+	int			nargs = op->d.agg_strict_input_check.nargs;
+
+	for (int argno = 0; argno < nargs; argno++)
+	{
+		if (args[argno].isnull)
+			return true;
+	}
+	return false;
+}
+
+static bool
+stencil_agg_strict_input_check_nulls(ExprState *state, ExprEvalStep *op)
+{
+	bool	   *nulls = op->d.agg_strict_input_check.nulls;
+	int			nargs = op->d.agg_strict_input_check.nargs;
+
+	for (int argno = 0; argno < nargs; argno++)
+	{
+		if (nulls[argno])
+			return true;
+	}
+	return false;
+}
+
+static bool
+stencil_agg_plain_pergroup_nullcheck(ExprState *state, ExprEvalStep *op)
+{
+	AggState   *aggstate = castNode(AggState, state->parent);
+
+	return aggstate->all_pergroups[op->d.agg_plain_pergroup_nullcheck.setoff] == NULL;
+}
+
+/*
+ * Invoke the transition function of a plain aggregate, copy of the
+ * interpreter's ExecAggPlainTransByVal() / ExecAggPlainTransByRef().
+ */
+static pg_attribute_always_inline void
+stencil_agg_plain_trans(AggState *aggstate, ExprEvalStep *op,
+						AggStatePerGroup pergroup, bool byref)
+{
+	AggStatePerTrans pertrans = op->d.agg_trans.pertrans;
+	FunctionCallInfo fcinfo = pertrans->transfn_fcinfo;
+	MemoryContext oldContext;
+	Datum		newVal;
+
+	/* cf. select_current_set() */
+	aggstate->curaggcontext = op->d.agg_trans.aggcontext;
+	aggstate->current_set = op->d.agg_trans.setno;
+
+	/* set up aggstate->curpertrans for AggGetAggref() */
+	aggstate->curpertrans = pertrans;
+
+	/* invoke transition function in per-tuple context */
+	oldContext = MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+
+	fcinfo->args[0].value = pergroup->transValue;
+	fcinfo->args[0].isnull = pergroup->transValueIsNull;
+	fcinfo->isnull = false;		/* just in case transfn doesn't set it */
+
+	newVal = FunctionCallInvoke(fcinfo);
+
+	/* see ExecAggPlainTransByRef() */
+	if (byref &&
+		DatumGetPointer(newVal) != DatumGetPointer(pergroup->transValue))
+		newVal = ExecAggCopyTransValue(aggstate, pertrans,
+									   newVal, fcinfo->isnull,
+									   pergroup->transValue,
+									   pergroup->transValueIsNull);
+
+	pergroup->transValue = newVal;
+	pergroup->transValueIsNull = fcinfo->isnull;
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+static pg_attribute_always_inline AggStatePerGroup
+stencil_agg_pergroup(AggState *aggstate, ExprEvalStep *op)
+{
+	return &aggstate->all_pergroups[op->d.agg_trans.setoff][op->d.agg_trans.transno];
+}
+
+static void
+stencil_agg_plain_trans_init_strict_byval(ExprState *state, ExprEvalStep *op)
+{
+	AggState   *aggstate = castNode(AggState, state->parent);
+	AggStatePerGroup pergroup = stencil_agg_pergroup(aggstate, op);
+
+	if (pergroup->noTransValue)
+		ExecAggInitGroup(aggstate, op->d.agg_trans.pertrans, pergroup,
+						 op->d.agg_trans.aggcontext);
+	else if (likely(!pergroup->transValueIsNull))
+		stencil_agg_plain_trans(aggstate, op, pergroup, false);
+}
+
+static void
+stencil_agg_plain_trans_strict_byval(ExprState *state, ExprEvalStep *op)
+{
+	AggState   *aggstate = castNode(AggState, state->parent);
+	AggStatePerGroup pergroup = stencil_agg_pergroup(aggstate, op);
+
+	if (likely(!pergroup->transValueIsNull))
+		stencil_agg_plain_trans(aggstate, op, pergroup, false);
+}
+
+static void
+stencil_agg_plain_trans_byval(ExprState *state, ExprEvalStep *op)
+{
+	AggState   *aggstate = castNode(AggState, state->parent);
+
+	stencil_agg_plain_trans(aggstate, op, stencil_agg_pergroup(aggstate, op),
+							false);
+}
+
+static void
+stencil_agg_plain_trans_init_strict_byref(ExprState *state, ExprEvalStep *op)
+{
+	AggState   *aggstate = castNode(AggState, state->parent);
+	AggStatePerGroup pergroup = stencil_agg_pergroup(aggstate, op);
+
+	if (pergroup->noTransValue)
+		ExecAggInitGroup(aggstate, op->d.agg_trans.pertrans, pergroup,
+						 op->d.agg_trans.aggcontext);
+	else if (likely(!pergroup->transValueIsNull))
+		stencil_agg_plain_trans(aggstate, op, pergroup, true);
+}
+
+static void
+stencil_agg_plain_trans_strict_byref(ExprState *state, ExprEvalStep *op)
+{
+	AggState   *aggstate = castNode(AggState, state->parent);
+	AggStatePerGroup pergroup = stencil_agg_pergroup(aggstate, op);
+
+	if (likely(!pergroup->transValueIsNull))
+		stencil_agg_plain_trans(aggstate, op, pergroup, true);
+}
+
+static void
+stencil_agg_plain_trans_byref(ExprState *state, ExprEvalStep *op)
+{
+	AggState   *aggstate = castNode(AggState, state->parent);
+
+	stencil_agg_plain_trans(aggstate, op, stencil_agg_pergroup(aggstate, op),
+							true);
+}
+
+static bool
+stencil_agg_presorted_distinct_single(ExprState *state, ExprEvalStep *op)
+{
+	return ExecEvalPreOrderedDistinctSingle(castNode(AggState, state->parent),
+											op->d.agg_presorted_distinctcheck.pertrans);
+}
+
+static bool
+stencil_agg_presorted_distinct_multi(ExprState *state, ExprEvalStep *op)
+{
+	return ExecEvalPreOrderedDistinctMulti(castNode(AggState, state->parent),
+										   op->d.agg_presorted_distinctcheck.pertrans);
+}
+
+
+/*
+ * Look up the template implementing an expression step, and how execution
+ * continues after it.  Returns false if there's no template for the step.
+ */
+bool
+stencil_for_step(ExprState *state, ExprEvalStep *op, Stencil *stencil)
+{
+	stencil->kind = STENCIL_NEXT;
+	stencil->func = NULL;
+
+	switch (ExecEvalStepOp(state, op))
+	{
+		case EEOP_DONE:
+			stencil->kind = STENCIL_DONE;
+			stencil->func = (void *) stencil_done;
+			break;
+
+		case EEOP_INNER_FETCHSOME:
+			stencil->func = (void *) stencil_inner_fetchsome;
+			break;
+		case EEOP_OUTER_FETCHSOME:
+			stencil->func = (void *) stencil_outer_fetchsome;
+			break;
+		case EEOP_SCAN_FETCHSOME:
+			stencil->func = (void *) stencil_scan_fetchsome;
+			break;
+
+		case EEOP_INNER_VAR:
+			stencil->func = (void *) stencil_inner_var;
+			break;
+		case EEOP_OUTER_VAR:
+			stencil->func = (void *) stencil_outer_var;
+			break;
+		case EEOP_SCAN_VAR:
+			stencil->func = (void *) stencil_scan_var;
+			break;
+
+		case EEOP_INNER_SYSVAR:
+			stencil->func = (void *) stencil_inner_sysvar;
+			break;
+		case EEOP_OUTER_SYSVAR:
+			stencil->func = (void *) stencil_outer_sysvar;
+			break;
+		case EEOP_SCAN_SYSVAR:
+			stencil->func = (void *) stencil_scan_sysvar;
+			break;
+
+		case EEOP_WHOLEROW:
+			stencil->func = (void *) ExecEvalWholeRowVar;
+			break;
+
+		case EEOP_ASSIGN_INNER_VAR:
+			stencil->func = (void *) stencil_assign_inner_var;
+			break;
+		case EEOP_ASSIGN_OUTER_VAR:
+			stencil->func = (void *) stencil_assign_outer_var;
+			break;
+		case EEOP_ASSIGN_SCAN_VAR:
+			stencil->func = (void *) stencil_assign_scan_var;
+			break;
+		case EEOP_ASSIGN_TMP:
+			stencil->func = (void *) stencil_assign_tmp;
+			break;
+		case EEOP_ASSIGN_TMP_MAKE_RO:
+			stencil->func = (void *) stencil_assign_tmp_make_ro;
+			break;
+
+		case EEOP_CONST:
+			stencil->func = (void *) stencil_const;
+			break;
+
+		case EEOP_FUNCEXPR:
+			stencil->func = (void *) stencil_funcexpr;
+			break;
+		case EEOP_FUNCEXPR_STRICT:
+			stencil->func = (void *) stencil_funcexpr_strict;
+			break;
+		case EEOP_FUNCEXPR_FUSAGE:
+			stencil->func = (void *) ExecEvalFuncExprFusage;
+			break;
+		case EEOP_FUNCEXPR_STRICT_FUSAGE:
+			stencil->func = (void *) ExecEvalFuncExprStrictFusage;
+			break;
+
+		case EEOP_BOOL_AND_STEP_FIRST:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_bool_and_step_first;
+			stencil->jumps[0] = op->d.boolexpr.jumpdone;
+			break;
+		case EEOP_BOOL_AND_STEP:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_bool_and_step;
+			stencil->jumps[0] = op->d.boolexpr.jumpdone;
+			break;
+		case EEOP_BOOL_AND_STEP_LAST:
+			stencil->func = (void *) stencil_bool_and_step_last;
+			break;
+		case EEOP_BOOL_OR_STEP_FIRST:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_bool_or_step_first;
+			stencil->jumps[0] = op->d.boolexpr.jumpdone;
+			break;
+		case EEOP_BOOL_OR_STEP:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_bool_or_step;
+			stencil->jumps[0] = op->d.boolexpr.jumpdone;
+			break;
+		case EEOP_BOOL_OR_STEP_LAST:
+			stencil->func = (void *) stencil_bool_or_step_last;
+			break;
+		case EEOP_BOOL_NOT_STEP:
+			stencil->func = (void *) stencil_bool_not_step;
+			break;
+
+		case EEOP_QUAL:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_qual;
+			stencil->jumps[0] = op->d.qualexpr.jumpdone;
+			break;
+
+		case EEOP_JUMP:
+			stencil->kind = STENCIL_JUMP;
+			stencil->jumps[0] = op->d.jump.jumpdone;
+			break;
+		case EEOP_JUMP_IF_NULL:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_jump_if_null;
+			stencil->jumps[0] = op->d.jump.jumpdone;
+			break;
+		case EEOP_JUMP_IF_NOT_NULL:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_jump_if_not_null;
+			stencil->jumps[0] = op->d.jump.jumpdone;
+			break;
+		case EEOP_JUMP_IF_NOT_TRUE:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_jump_if_not_true;
+			stencil->jumps[0] = op->d.jump.jumpdone;
+			break;
+
+		case EEOP_NULLTEST_ISNULL:
+			stencil->func = (void *) stencil_nulltest_isnull;
+			break;
+		case EEOP_NULLTEST_ISNOTNULL:
+			stencil->func = (void *) stencil_nulltest_isnotnull;
+			break;
+		case EEOP_NULLTEST_ROWISNULL:
+			stencil->func = (void *) ExecEvalRowNull;
+			break;
+		case EEOP_NULLTEST_ROWISNOTNULL:
+			stencil->func = (void *) ExecEvalRowNotNull;
+			break;
+
+		case EEOP_BOOLTEST_IS_TRUE:
+			stencil->func = (void *) stencil_booltest_is_true;
+			break;
+		case EEOP_BOOLTEST_IS_NOT_TRUE:
+			stencil->func = (void *) stencil_booltest_is_not_true;
+			break;
+		case EEOP_BOOLTEST_IS_FALSE:
+			stencil->func = (void *) stencil_booltest_is_false;
+			break;
+		case EEOP_BOOLTEST_IS_NOT_FALSE:
+			stencil->func = (void *) stencil_booltest_is_not_false;
+			break;
+
+		case EEOP_PARAM_EXEC:
+			stencil->func = (void *) ExecEvalParamExec;
+			break;
+		case EEOP_PARAM_EXTERN:
+			stencil->func = (void *) ExecEvalParamExtern;
+			break;
+		case EEOP_PARAM_CALLBACK:
+			/* call the extension's function directly */
+			stencil->func = (void *) op->d.cparam.paramfunc;
+			break;
+		case EEOP_PARAM_SET:
+			stencil->func = (void *) ExecEvalParamSet;
+			break;
+
+		case EEOP_CASE_TESTVAL:
+			stencil->func = (void *) stencil_case_testval;
+			break;
+		case EEOP_MAKE_READONLY:
+			stencil->func = (void *) stencil_make_readonly;
+			break;
+
+		case EEOP_IOCOERCE:
+			stencil->func = (void *) stencil_iocoerce;
+			break;
+		case EEOP_IOCOERCE_SAFE:
+			stencil->func = (void *) ExecEvalCoerceViaIOSafe;
+			break;
+		case EEOP_DISTINCT:
+			stencil->func = (void *) stencil_distinct;
+			break;
+		case EEOP_NOT_DISTINCT:
+			stencil->func = (void *) stencil_not_distinct;
+			break;
+		case EEOP_NULLIF:
+			stencil->func = (void *) stencil_nullif;
+			break;
+
+		case EEOP_SQLVALUEFUNCTION:
+			stencil->func = (void *) ExecEvalSQLValueFunction;
+			break;
+		case EEOP_CURRENTOFEXPR:
+			stencil->func = (void *) ExecEvalCurrentOfExpr;
+			break;
+		case EEOP_NEXTVALUEEXPR:
+			stencil->func = (void *) ExecEvalNextValueExpr;
+			break;
+		case EEOP_ARRAYEXPR:
+			stencil->func = (void *) ExecEvalArrayExpr;
+			break;
+		case EEOP_ARRAYCOERCE:
+			stencil->func = (void *) ExecEvalArrayCoerce;
+			break;
+		case EEOP_ROW:
+			stencil->func = (void *) ExecEvalRow;
+			break;
+
+		case EEOP_ROWCOMPARE_STEP:
+			stencil->kind = STENCIL_SWITCH;
+			stencil->func = (void *) stencil_rowcompare_step;
+			stencil->jumps[0] = op->d.rowcompare_step.jumpnull;
+			stencil->jumps[1] = op->d.rowcompare_step.jumpdone;
+			break;
+		case EEOP_ROWCOMPARE_FINAL:
+			stencil->func = (void *) stencil_rowcompare_final;
+			break;
+
+		case EEOP_MINMAX:
+			stencil->func = (void *) ExecEvalMinMax;
+			break;
+		case EEOP_FIELDSELECT:
+			stencil->func = (void *) ExecEvalFieldSelect;
+			break;
+		case EEOP_FIELDSTORE_DEFORM:
+			stencil->func = (void *) ExecEvalFieldStoreDeForm;
+			break;
+		case EEOP_FIELDSTORE_FORM:
+			stencil->func = (void *) ExecEvalFieldStoreForm;
+			break;
+
+		case EEOP_SBSREF_SUBSCRIPTS:
+			/* the subscript checking function returns false for NULL */
+			stencil->kind = STENCIL_JUMP_IF_FALSE;
+			stencil->func = (void *) op->d.sbsref_subscript.subscriptfunc;
+			stencil->jumps[0] = op->d.sbsref_subscript.jumpdone;
+			break;
+		case EEOP_SBSREF_OLD:
+		case EEOP_SBSREF_ASSIGN:
+		case EEOP_SBSREF_FETCH:
+			stencil->func = (void *) op->d.sbsref.subscriptfunc;
+			break;
+
+		case EEOP_DOMAIN_TESTVAL:
+			stencil->func = (void *) stencil_domain_testval;
+			break;
+		case EEOP_DOMAIN_NOTNULL:
+			stencil->func = (void *) ExecEvalConstraintNotNull;
+			break;
+		case EEOP_DOMAIN_CHECK:
+			stencil->func = (void *) ExecEvalConstraintCheck;
+			break;
+
+		case EEOP_HASHDATUM_SET_INITVAL:
+			stencil->func = (void *) stencil_hashdatum_set_initval;
+			break;
+		case EEOP_HASHDATUM_FIRST:
+			stencil->func = (void *) stencil_hashdatum_first;
+			break;
+		case EEOP_HASHDATUM_FIRST_STRICT:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_hashdatum_first_strict;
+			stencil->jumps[0] = op->d.hashdatum.jumpdone;
+			break;
+		case EEOP_HASHDATUM_NEXT32:
+			stencil->func = (void *) stencil_hashdatum_next32;
+			break;
+		case EEOP_HASHDATUM_NEXT32_STRICT:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_hashdatum_next32_strict;
+			stencil->jumps[0] = op->d.hashdatum.jumpdone;
+			break;
+
+		case EEOP_CONVERT_ROWTYPE:
+			stencil->func = (void *) ExecEvalConvertRowtype;
+			break;
+		case EEOP_SCALARARRAYOP:
+			stencil->func = (void *) ExecEvalScalarArrayOp;
+			break;
+		case EEOP_HASHED_SCALARARRAYOP:
+			stencil->func = (void *) ExecEvalHashedScalarArrayOp;
+			break;
+		case EEOP_XMLEXPR:
+			stencil->func = (void *) ExecEvalXmlExpr;
+			break;
+		case EEOP_JSON_CONSTRUCTOR:
+			stencil->func = (void *) ExecEvalJsonConstructor;
+			break;
+		case EEOP_IS_JSON:
+			stencil->func = (void *) ExecEvalJsonIsPredicate;
+			break;
+		case EEOP_JSONEXPR_PATH:
+			stencil->kind = STENCIL_DYNAMIC;
+			stencil->func = (void *) stencil_json_expr_path;
+			break;
+		case EEOP_JSONEXPR_COERCION:
+			stencil->func = (void *) ExecEvalJsonCoercion;
+			break;
+		case EEOP_JSONEXPR_COERCION_FINISH:
+			stencil->func = (void *) ExecEvalJsonCoercionFinish;
+			break;
+
+		case EEOP_AGGREF:
+			stencil->func = (void *) stencil_aggref;
+			break;
+		case EEOP_GROUPING_FUNC:
+			stencil->func = (void *) ExecEvalGroupingFunc;
+			break;
+		case EEOP_WINDOW_FUNC:
+			stencil->func = (void *) stencil_window_func;
+			break;
+		case EEOP_MERGE_SUPPORT_FUNC:
+			stencil->func = (void *) ExecEvalMergeSupportFunc;
+			break;
+		case EEOP_SUBPLAN:
+			stencil->func = (void *) ExecEvalSubPlan;
+			break;
+
+		case EEOP_AGG_STRICT_DESERIALIZE:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_agg_strict_deserialize;
+			stencil->jumps[0] = op->d.agg_deserialize.jumpnull;
+			break;
+		case EEOP_AGG_DESERIALIZE:
+			stencil->func = (void *) stencil_agg_deserialize;
+			break;
+		case EEOP_AGG_STRICT_INPUT_CHECK_ARGS:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_agg_strict_input_check_args;
+			stencil->jumps[0] = op->d.agg_strict_input_check.jumpnull;
+			break;
+		case EEOP_AGG_STRICT_INPUT_CHECK_NULLS:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_agg_strict_input_check_nulls;
+			stencil->jumps[0] = op->d.agg_strict_input_check.jumpnull;
+			break;
+		case EEOP_AGG_PLAIN_PERGROUP_NULLCHECK:
+			stencil->kind = STENCIL_JUMP_IF_TRUE;
+			stencil->func = (void *) stencil_agg_plain_pergroup_nullcheck;
+			stencil->jumps[0] = op->d.agg_plain_pergroup_nullcheck.jumpnull;
+			break;
+		case EEOP_AGG_PLAIN_TRANS_INIT_STRICT_BYVAL:
+			stencil->func = (void *) stencil_agg_plain_trans_init_strict_byval;
+			break;
+		case EEOP_AGG_PLAIN_TRANS_STRICT_BYVAL:
+			stencil->func = (void *) stencil_agg_plain_trans_strict_byval;
+			break;
+		case EEOP_AGG_PLAIN_TRANS_BYVAL:
+			stencil->func = (void *) stencil_agg_plain_trans_byval;
+			break;
+		case EEOP_AGG_PLAIN_TRANS_INIT_STRICT_BYREF:
+			stencil->func = (void *) stencil_agg_plain_trans_init_strict_byref;
+			break;
+		case EEOP_AGG_PLAIN_TRANS_STRICT_BYREF:
+			stencil->func = (void *) stencil_agg_plain_trans_strict_byref;
+			break;
+		case EEOP_AGG_PLAIN_TRANS_BYREF:
+			stencil->func = (void *) stencil_agg_plain_trans_byref;
+			break;
+		case EEOP_AGG_PRESORTED_DISTINCT_SINGLE:
+			stencil->kind = STENCIL_JUMP_IF_FALSE;
+			stencil->func = (void *) stencil_agg_presorted_distinct_single;
+			stencil->jumps[0] = op->d.agg_presorted_distinctcheck.jumpdistinct;
+			break;
+		case EEOP_AGG_PRESORTED_DISTINCT_MULTI:
+			stencil->kind = STENCIL_JUMP_IF_FALSE;
+			stencil->func = (void *) stencil_agg_presorted_distinct_multi;
+			stencil->jumps[0] = op->d.agg_presorted_distinctcheck.jumpdistinct;
+			break;
+		case EEOP_AGG_ORDERED_TRANS_DATUM:
+			stencil->func = (void *) ExecEvalAggOrderedTransDatum;
+			break;
+		case EEOP_AGG_ORDERED_TRANS_TUPLE:
+			stencil->func = (void *) ExecEvalAggOrderedTransTuple;
+			break;
+
+		case EEOP_LAST:
+			return false;
+	}
+
+	return stencil->func != NULL || stencil->kind == STENCIL_JUMP;
+}
@@ -394,6 +394,23 @@ ClientAuthentication(Port *port)
 
 	CHECK_FOR_INTERRUPTS();
 
+	/*
+	 * A connection proxy adding a backend to a session pool has already seen
+	 * this user authenticate for the same database through a connection of
+	 * its own, so only explicit or implicit rejection applies here.
+	 */
+	if (port->proxy_trusted &&
+		port->hba->auth_method != uaReject &&
+		port->hba->auth_method != uaImplicitReject)
+	{
+		if (Log_connections)
+			ereport(LOG,
+					errmsg("connection authenticated: user=\"%s\" method=proxy",
+						   port->user_name));
+		sendAuthRequest(port, AUTH_REQ_OK, NULL, 0);
+		return;
+	}
+
 	/*
 	 * This is the first point where we have access to the hba record for the
 	 * current connection, so perform any verifications based on the hba
@@ -1864,6 +1881,15 @@ auth_peer(hbaPort *port)
 	int			ret;
 #endif
 
+	/* The peer of a proxied connection is the proxy, not the client */
+	if (port->proxied)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("peer authentication is not supported through a connection proxy")));
+		return STATUS_ERROR;
+	}
+
 	if (getpeereid(port->sock, &uid, &gid) != 0)
 	{
 		/* Provide special error message if getpeereid is a stub */
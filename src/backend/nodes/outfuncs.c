@@ -432,6 +432,7 @@ _outForeignKeyOptInfo(StringInfo str, const ForeignKeyOptInfo *node)
 
 	WRITE_NODE_TYPE("FOREIGNKEYOPTINFO");
 
+	WRITE_OID_FIELD(conoid);
 	WRITE_UINT_FIELD(con_relid);
 	WRITE_UINT_FIELD(ref_relid);
 	WRITE_INT_FIELD(nkeys);
@@ -46,6 +46,7 @@
 #include "partitioning/partbounds.h"
 #include "port/pg_bitutils.h"
 #include "rewrite/rewriteManip.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
 
 
@@ -78,6 +79,8 @@ typedef enum pushdown_safe_type
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+int			join_search_method = JOIN_SEARCH_GEQO;
+int			idp_block_size;
 int			min_parallel_table_scan_size;
 int			min_parallel_index_scan_size;
 
@@ -89,6 +92,7 @@ join_search_hook_type join_search_hook = NULL;
 
 
 static void set_base_rel_consider_startup(PlannerInfo *root);
+static void finish_join_level(PlannerInfo *root, int lev);
 static void set_base_rel_sizes(PlannerInfo *root);
 static void set_base_rel_pathlists(PlannerInfo *root);
 static void set_rel_size(PlannerInfo *root, RelOptInfo *rel,
@@ -3383,7 +3387,11 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
+		{
+			if (join_search_method == JOIN_SEARCH_IDP)
+				return idp_join_search(root, levels_needed, initial_rels);
 			return geqo(root, levels_needed, initial_rels);
+		}
 		else
 			return standard_join_search(root, levels_needed, initial_rels);
 	}
@@ -3447,8 +3455,6 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 
 	for (lev = 2; lev <= levels_needed; lev++)
 	{
-		ListCell   *lc;
-
 		/*
 		 * Determine all possible pairs of relations to be joined at this
 		 * level, and build paths for making each one from every available
@@ -3456,39 +3462,7 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 		 */
 		join_search_one_level(root, lev);
 
-		/*
-		 * Run generate_partitionwise_join_paths() and
-		 * generate_useful_gather_paths() for each just-processed joinrel.  We
-		 * could not do this earlier because both regular and partial paths
-		 * can get added to a particular joinrel at multiple times within
-		 * join_search_one_level.
-		 *
-		 * After that, we're done creating paths for the joinrel, so run
-		 * set_cheapest().
-		 */
-		foreach(lc, root->join_rel_level[lev])
-		{
-			rel = (RelOptInfo *) lfirst(lc);
-
-			/* Create paths for partitionwise joins. */
-			generate_partitionwise_join_paths(root, rel);
-
-			/*
-			 * Except for the topmost scan/join rel, consider gathering
-			 * partial paths.  We'll do the same for the topmost scan/join rel
-			 * once we know the final targetlist (see grouping_planner's and
-			 * its call to apply_scanjoin_target_to_paths).
-			 */
-			if (!bms_equal(rel->relids, root->all_query_rels))
-				generate_useful_gather_paths(root, rel, false);
-
-			/* Find and save the cheapest paths for this rel */
-			set_cheapest(rel);
-
-#ifdef OPTIMIZER_DEBUG
-			pprint(rel);
-#endif
-		}
+		finish_join_level(root, lev);
 	}
 
 	/*
@@ -3505,6 +3479,171 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 	return rel;
 }
 
+/*
+ * finish_join_level
+ *	  Complete the paths of the joinrels built at one level of the join search.
+ *
+ * Run generate_partitionwise_join_paths() and generate_useful_gather_paths()
+ * for each just-processed joinrel.  We could not do this earlier because both
+ * regular and partial paths can get added to a particular joinrel at multiple
+ * times within join_search_one_level.
+ *
+ * After that, we're done creating paths for the joinrel, so run
+ * set_cheapest().
+ */
+static void
+finish_join_level(PlannerInfo *root, int lev)
+{
+	ListCell   *lc;
+
+	foreach(lc, root->join_rel_level[lev])
+	{
+		RelOptInfo *rel = (RelOptInfo *) lfirst(lc);
+
+		/* Create paths for partitionwise joins. */
+		generate_partitionwise_join_paths(root, rel);
+
+		/*
+		 * Except for the topmost scan/join rel, consider gathering partial
+		 * paths.  We'll do the same for the topmost scan/join rel once we
+		 * know the final targetlist (see grouping_planner's and its call to
+		 * apply_scanjoin_target_to_paths).
+		 */
+		if (!bms_equal(rel->relids, root->all_query_rels))
+			generate_useful_gather_paths(root, rel, false);
+
+		/* Find and save the cheapest paths for this rel */
+		set_cheapest(rel);
+
+#ifdef OPTIMIZER_DEBUG
+		pprint(rel);
+#endif
+	}
+}
+
+/*
+ * idp_join_search
+ *	  Find a join order by iterative dynamic programming.
+ *
+ * This is the "IDP-1" algorithm of Kossmann and Stocker.  Each round runs the
+ * same dynamic programming search as standard_join_search(), but only up to
+ * joins of idp_block_size items.  The cheapest join found at the top level
+ * is then kept as a single item in place of the items it is made of, and the
+ * search is repeated until the remaining items fit in one block.  So unlike
+ * the exhaustive search, the work done in each round is bounded by the block
+ * size rather than by the number of items, and unlike GEQO, the result is
+ * deterministic.  With a block size of 2, this degenerates to a greedy
+ * search that makes the cheapest available join at each step.
+ *
+ * Arguments and result are as for standard_join_search().
+ */
+RelOptInfo *
+idp_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	List	   *rels = list_copy(initial_rels);
+	int			nrels = levels_needed;
+	RelOptInfo *best;
+
+	Assert(root->join_rel_level == NULL);
+
+	for (;;)
+	{
+		int			savelength = list_length(root->join_rel_list);
+		int			top_level = 0;
+		int			lev;
+		List	   *newrels;
+		ListCell   *lc;
+
+		/* has_legal_joinclause() must see the items of this round */
+		root->initial_rels = rels;
+
+		root->join_rel_level = (List **) palloc0((nrels + 1) * sizeof(List *));
+		root->join_rel_level[1] = rels;
+
+		/*
+		 * Search up to the block size.  When special joins are involved, it
+		 * may not be possible to join that many items (see the comments at
+		 * the end of join_search_one_level()), in which case we go on until
+		 * we manage to build some join.
+		 */
+		for (lev = 2; lev <= nrels; lev++)
+		{
+			if (lev > idp_block_size && top_level > 0)
+				break;
+
+			join_search_one_level(root, lev);
+			finish_join_level(root, lev);
+
+			if (root->join_rel_level[lev] != NIL)
+				top_level = lev;
+		}
+
+		if (top_level == 0)
+			elog(ERROR, "failed to build any %d-way joins", nrels);
+
+		/* If all the remaining items were joined, we're done */
+		if (top_level == nrels)
+		{
+			Assert(list_length(root->join_rel_level[nrels]) == 1);
+			best = (RelOptInfo *) linitial(root->join_rel_level[nrels]);
+			break;
+		}
+
+		/*
+		 * Pick the cheapest of the largest joins.  Ties go to the one found
+		 * first, so that the result doesn't depend on anything but the input.
+		 */
+		best = NULL;
+		foreach(lc, root->join_rel_level[top_level])
+		{
+			RelOptInfo *rel = (RelOptInfo *) lfirst(lc);
+
+			if (best == NULL ||
+				rel->cheapest_total_path->total_cost <
+				best->cheapest_total_path->total_cost)
+				best = rel;
+		}
+
+		/*
+		 * Forget about the other joinrels built in this round.  Besides
+		 * keeping the lookups cheap, this is necessary for correctness:
+		 * build_join_rel() adds a joinrel to join_rel_level[] only when
+		 * creating it, so a joinrel left over from this round would be
+		 * missing from the levels of the next.  The memory isn't reclaimed,
+		 * though, because the chosen joinrel's paths may refer to it.
+		 */
+		root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+		if (root->join_rel_hash)
+		{
+			hash_destroy(root->join_rel_hash);
+			root->join_rel_hash = NULL;
+		}
+		root->join_rel_list = lappend(root->join_rel_list, best);
+
+		/* Replace the items that make up the chosen join with it */
+		newrels = NIL;
+		foreach(lc, rels)
+		{
+			RelOptInfo *rel = (RelOptInfo *) lfirst(lc);
+
+			if (!bms_is_subset(rel->relids, best->relids))
+				newrels = lappend(newrels, rel);
+		}
+		newrels = lappend(newrels, best);
+
+		list_free(rels);
+		rels = newrels;
+		nrels = list_length(rels);
+		pfree(root->join_rel_level);
+		root->join_rel_level = NULL;
+	}
+
+	root->join_rel_level = NULL;
+	root->initial_rels = initial_rels;
+
+	return best;
+}
+
 /*****************************************************************************
  *			PUSHING QUALS DOWN INTO SUBQUERIES
  *****************************************************************************/
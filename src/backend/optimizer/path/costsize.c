@@ -104,6 +104,7 @@
 #include "optimizer/plancat.h"
 #include "optimizer/restrictinfo.h"
 #include "parser/parsetree.h"
+#include "statistics/statistics.h"
 #include "utils/lsyscache.h"
 #include "utils/selfuncs.h"
 #include "utils/spccache.h"
@@ -158,11 +159,15 @@ bool		enable_hashjoin = true;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
+bool		enable_eager_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_insert = false;
+bool		enable_parallel_redistribute = false;
 bool		enable_partition_pruning = true;
 bool		enable_presorted_aggregate = true;
 bool		enable_async_append = true;
+bool		enable_async_gather = false;
 
 typedef struct
 {
@@ -538,6 +543,58 @@ cost_gather_merge(GatherMergePath *path, PlannerInfo *root,
 	path->path.total_cost = (startup_cost + run_cost + input_total_cost);
 }
 
+/*
+ * cost_redistribute
+ *	  Determines and returns the cost of a redistribute path.
+ *
+ * Every participant hashes its share of the input and writes it out to the
+ * shared partitions, and must wait until everyone has done so before reading
+ * anything back; so all of that is startup cost.  Reading the claimed
+ * partitions is run cost.
+ *
+ * 'numGroups' is the estimated number of distinct hash key values.  A
+ * participant always receives whole groups, so when there are fewer groups
+ * than participants the output is spread over fewer processes.
+ */
+void
+cost_redistribute(RedistributePath *path, PlannerInfo *root,
+				  double numGroups)
+{
+	Path	   *subpath = path->subpath;
+	double		parallel_divisor = get_parallel_divisor(subpath);
+	double		input_tuples = subpath->rows;
+	double		output_tuples;
+	double		input_pages;
+	double		output_pages;
+	Cost		startup_cost;
+	Cost		run_cost;
+
+	if (numGroups < 1.0)
+		numGroups = 1.0;
+	if (numGroups >= parallel_divisor)
+		output_tuples = input_tuples;
+	else
+		output_tuples = clamp_row_est(input_tuples * parallel_divisor /
+									  numGroups);
+
+	input_pages = page_size(input_tuples, subpath->pathtarget->width);
+	output_pages = page_size(output_tuples, subpath->pathtarget->width);
+
+	/* compute the hash keys, and write out all the input */
+	startup_cost = subpath->total_cost;
+	startup_cost += cpu_operator_cost * list_length(path->hashkeys) *
+		input_tuples;
+	startup_cost += seq_page_cost * input_pages;
+
+	/* read back our partitions */
+	run_cost = seq_page_cost * output_pages + cpu_tuple_cost * output_tuples;
+
+	path->path.rows = output_tuples;
+	path->path.disabled_nodes = subpath->disabled_nodes;
+	path->path.startup_cost = startup_cost;
+	path->path.total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_index
  *	  Determines and returns the cost of scanning a relation using an index.
@@ -5821,6 +5878,20 @@ get_foreign_key_join_selectivity(PlannerInfo *root,
 			fkselec *= 1.0 / ref_tuples;
 		}
 
+		/*
+		 * Both estimates above assume the referencing rows are spread over
+		 * the referenced rows independently of the restrictions on the
+		 * latter.  Statistics defined on this join may know better.
+		 */
+		{
+			RelOptInfo *ref_rel = find_base_rel(root, fkinfo->ref_relid);
+
+			if (ref_rel->fkeystatlist != NIL)
+				fkselec *= statext_fkey_join_correction(root, ref_rel,
+														fkinfo->con_relid,
+														fkinfo->conoid);
+		}
+
 		/*
 		 * If any of the FK columns participated in ec_has_const ECs, then
 		 * equivclass.c will have generated "var = const" restrictions for
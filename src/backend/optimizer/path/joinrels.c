@@ -780,6 +780,44 @@ make_join_rel(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2)
 	return joinrel;
 }
 
+/*
+ * make_grouped_join_rel
+ *	   Build a join RelOptInfo for the inner join of rel1 and rel2, at least
+ *	   one of which has been partially aggregated, and add paths to it.
+ *
+ * 'joinrel' is the regular join relation for the same set of base rels, and
+ * 'target' is what the join is to emit.  This is used by eager aggregation,
+ * after the regular join search is complete; the caller must have checked
+ * that the join is a plain inner join.  Returns NULL if the join is provably
+ * empty or no paths could be built.
+ */
+RelOptInfo *
+make_grouped_join_rel(PlannerInfo *root, RelOptInfo *joinrel,
+					  RelOptInfo *rel1, RelOptInfo *rel2,
+					  PathTarget *target)
+{
+	SpecialJoinInfo sjinfo;
+	RelOptInfo *grouped_joinrel;
+	List	   *restrictlist;
+
+	Assert(bms_equal(joinrel->relids, bms_union(rel1->relids, rel2->relids)));
+
+	init_dummy_sjinfo(&sjinfo, rel1->relids, rel2->relids);
+
+	grouped_joinrel = build_grouped_join_rel(root, joinrel, rel1, rel2,
+											 target, &sjinfo, &restrictlist);
+
+	populate_joinrel_with_paths(root, rel1, rel2, grouped_joinrel, &sjinfo,
+								restrictlist);
+
+	if (grouped_joinrel->pathlist == NIL || is_dummy_rel(grouped_joinrel))
+		return NULL;
+
+	set_cheapest(grouped_joinrel);
+
+	return grouped_joinrel;
+}
+
 /*
  * add_outer_joins_to_relids
  *	  Add relids to input_relids to represent any outer joins that will be
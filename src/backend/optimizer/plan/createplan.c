@@ -233,6 +233,7 @@ static BitmapAnd *make_bitmap_and(List *bitmapplans);
 static BitmapOr *make_bitmap_or(List *bitmapplans);
 static NestLoop *make_nestloop(List *tlist,
 							   List *joinclauses, List *otherclauses, List *nestParams,
+							   List *hashclauses,
 							   Plan *lefttree, Plan *righttree,
 							   JoinType jointype, bool inner_unique);
 static HashJoin *make_hashjoin(List *tlist,
@@ -319,6 +320,11 @@ static ModifyTable *make_modifytable(PlannerInfo *root, Plan *subplan,
 									 int epqParam);
 static GatherMerge *create_gather_merge_plan(PlannerInfo *root,
 											 GatherMergePath *best_path);
+static Redistribute *create_redistribute_plan(PlannerInfo *root,
+											  RedistributePath *best_path,
+											  int flags);
+static Redistribute *make_redistribute(Plan *lefttree, List *hashkeys,
+									   List *hashoperators, int npartitions);
 
 
 /*
@@ -356,9 +362,11 @@ create_plan(PlannerInfo *root, Path *best_path)
 	 * column names and other decorative info.  Targetlists generated within
 	 * the planner don't bother with that stuff, but we must have it on the
 	 * top-level tlist seen at execution time.  However, ModifyTable plan
-	 * nodes don't have a tlist matching the querytree targetlist.
+	 * nodes don't have a tlist matching the querytree targetlist, and
+	 * neither does a Gather collecting the results of a parallel INSERT.
 	 */
-	if (!IsA(plan, ModifyTable))
+	if (!IsA(plan, ModifyTable) &&
+		!(IsA(plan, Gather) && IsA(outerPlan(plan), ModifyTable)))
 		apply_tlist_labeling(plan->targetlist, root->processed_tlist);
 
 	/*
@@ -544,6 +552,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 			plan = (Plan *) create_gather_merge_plan(root,
 													 (GatherMergePath *) best_path);
 			break;
+		case T_Redistribute:
+			plan = (Plan *) create_redistribute_plan(root,
+													 (RedistributePath *) best_path,
+													 flags);
+			break;
 		default:
 			elog(ERROR, "unrecognized node type: %d",
 				 (int) best_path->pathtype);
@@ -1199,6 +1212,15 @@ mark_async_capable_plan(Plan *plan, Path *path)
 										((ProjectionPath *) path)->subpath))
 				return true;
 			return false;
+		case T_GatherPath:
+
+			/*
+			 * A Gather node can wait for its workers while the other subplans
+			 * are being run.
+			 */
+			if (enable_async_gather && IsA(plan, Gather))
+				break;
+			return false;
 		default:
 			return false;
 	}
@@ -2006,6 +2028,37 @@ create_gather_merge_plan(PlannerInfo *root, GatherMergePath *best_path)
 	return gm_plan;
 }
 
+/*
+ * create_redistribute_plan
+ *
+ *	  Create a Redistribute plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ */
+static Redistribute *
+create_redistribute_plan(PlannerInfo *root, RedistributePath *best_path,
+						 int flags)
+{
+	Redistribute *plan;
+	Plan	   *subplan;
+
+	/*
+	 * Every row gets written to a temporary file, so don't carry excess
+	 * columns.  Redistribute doesn't project, so other tlist requirements
+	 * pass through.
+	 */
+	subplan = create_plan_recurse(root, best_path->subpath,
+								  flags | CP_SMALL_TLIST);
+
+	plan = make_redistribute(subplan,
+							 best_path->hashkeys,
+							 best_path->hashoperators,
+							 best_path->npartitions);
+
+	copy_generic_path_info(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_projection_plan
  *
@@ -4356,6 +4409,7 @@ create_nestloop_plan(PlannerInfo *root,
 	List	   *otherclauses;
 	Relids		outerrelids;
 	List	   *nestParams;
+	List	   *hashclauses = NIL;
 	Relids		saveOuterRels = root->curOuterRels;
 
 	/*
@@ -4421,10 +4475,46 @@ create_nestloop_plan(PlannerInfo *root,
 	outerrelids = best_path->jpath.outerjoinpath->parent->relids;
 	nestParams = identify_current_nestloop_params(root, outerrelids);
 
+	/*
+	 * If the inner side does not depend on the outer one, remember which of
+	 * the join clauses are hashable, so that the executor can switch to
+	 * hashing the inner side should the outer side turn out to be much
+	 * larger than estimated.  These clauses stay in the joinqual, too.
+	 */
+	if (nestParams == NIL &&
+		best_path->jpath.path.param_info == NULL &&
+		bms_is_empty(PATH_REQ_OUTER(best_path->jpath.innerjoinpath)))
+	{
+		Relids		innerrelids = best_path->jpath.innerjoinpath->parent->relids;
+		List	   *hashrinfos = NIL;
+		ListCell   *lc;
+
+		foreach(lc, joinrestrictclauses)
+		{
+			RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+			if (rinfo->pseudoconstant)
+				continue;
+			if (IS_OUTER_JOIN(best_path->jpath.jointype) &&
+				RINFO_IS_PUSHED_DOWN(rinfo, best_path->jpath.path.parent->relids))
+				continue;
+			if (!rinfo->can_join || !OidIsValid(rinfo->hashjoinoperator))
+				continue;
+			if (!clause_sides_match_join(rinfo, outerrelids, innerrelids))
+				continue;
+			if (!rinfo->outer_is_left &&
+				!OidIsValid(get_commutator(castNode(OpExpr, rinfo->clause)->opno)))
+				continue;
+			hashrinfos = lappend(hashrinfos, rinfo);
+		}
+		hashclauses = get_switched_clauses(hashrinfos, outerrelids);
+	}
+
 	join_plan = make_nestloop(tlist,
 							  joinclauses,
 							  otherclauses,
 							  nestParams,
+							  hashclauses,
 							  outer_plan,
 							  inner_plan,
 							  best_path->jpath.jointype,
@@ -6023,6 +6113,7 @@ make_nestloop(List *tlist,
 			  List *joinclauses,
 			  List *otherclauses,
 			  List *nestParams,
+			  List *hashclauses,
 			  Plan *lefttree,
 			  Plan *righttree,
 			  JoinType jointype,
@@ -6039,6 +6130,7 @@ make_nestloop(List *tlist,
 	node->join.inner_unique = inner_unique;
 	node->join.joinqual = joinclauses;
 	node->nestParams = nestParams;
+	node->hashclauses = hashclauses;
 
 	return node;
 }
@@ -6951,6 +7043,31 @@ make_gather(List *qptlist,
 	return node;
 }
 
+static Redistribute *
+make_redistribute(Plan *lefttree,
+				  List *hashkeys,
+				  List *hashoperators,
+				  int npartitions)
+{
+	Redistribute *node = makeNode(Redistribute);
+	Plan	   *plan = &node->plan;
+	ListCell   *lc;
+
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+	node->hashkeys = hashkeys;
+	node->hashoperators = hashoperators;
+	node->hashcollations = NIL;
+	foreach(lc, hashkeys)
+		node->hashcollations = lappend_oid(node->hashcollations,
+										   exprCollation(lfirst(lc)));
+	node->npartitions = npartitions;
+
+	return node;
+}
+
 /*
  * distinctList is a list of SortGroupClauses, identifying the targetlist
  * items that should be considered by the SetOp filter.  The input path must
@@ -7301,6 +7418,7 @@ is_projection_capable_path(Path *path)
 		case T_Hash:
 		case T_Material:
 		case T_Memoize:
+		case T_Redistribute:
 		case T_Sort:
 		case T_IncrementalSort:
 		case T_Unique:
@@ -7351,6 +7469,7 @@ is_projection_capable_plan(Plan *plan)
 		case T_Hash:
 		case T_Material:
 		case T_Memoize:
+		case T_Redistribute:
 		case T_Sort:
 		case T_Unique:
 		case T_SetOp:
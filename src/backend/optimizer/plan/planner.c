@@ -19,6 +19,7 @@
 #include <math.h>
 
 #include "access/genam.h"
+#include "access/nbtree.h"
 #include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -55,6 +56,7 @@
 #include "parser/analyze.h"
 #include "parser/parse_agg.h"
 #include "parser/parse_clause.h"
+#include "parser/parse_oper.h"
 #include "parser/parse_relation.h"
 #include "parser/parsetree.h"
 #include "partitioning/partdesc.h"
@@ -62,6 +64,7 @@
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
+#include "utils/sharedresultcache.h"
 
 /* GUC parameters */
 double		cursor_tuple_fraction = DEFAULT_CURSOR_TUPLE_FRACTION;
@@ -131,6 +134,8 @@ static Node *preprocess_expression(PlannerInfo *root, Node *expr, int kind);
 static void preprocess_qual_conditions(PlannerInfo *root, Node *jtnode);
 static void grouping_planner(PlannerInfo *root, double tuple_fraction,
 							 SetOperationStmt *setops);
+static void add_parallel_insert_path(PlannerInfo *root, RelOptInfo *final_rel,
+									 Path *subpath);
 static grouping_sets_data *preprocess_grouping_sets(PlannerInfo *root);
 static List *remap_to_groupclause_idx(List *groupClause, List *gsets,
 									  int *tleref_to_colnum_map);
@@ -181,13 +186,20 @@ static RelOptInfo *create_window_paths(PlannerInfo *root,
 									   bool output_target_parallel_safe,
 									   WindowFuncLists *wflists,
 									   List *activeWindows);
-static void create_one_window_path(PlannerInfo *root,
-								   RelOptInfo *window_rel,
-								   Path *path,
-								   PathTarget *input_target,
-								   PathTarget *output_target,
-								   WindowFuncLists *wflists,
-								   List *activeWindows);
+static Path *create_one_window_path(PlannerInfo *root,
+									RelOptInfo *window_rel,
+									Path *path,
+									PathTarget *input_target,
+									PathTarget *output_target,
+									WindowFuncLists *wflists,
+									List *activeWindows);
+static void create_partial_window_path(PlannerInfo *root,
+									   RelOptInfo *window_rel,
+									   RelOptInfo *input_rel,
+									   PathTarget *input_target,
+									   PathTarget *output_target,
+									   WindowFuncLists *wflists,
+									   List *activeWindows);
 static RelOptInfo *create_distinct_paths(PlannerInfo *root,
 										 RelOptInfo *input_rel,
 										 PathTarget *target);
@@ -235,6 +247,19 @@ static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 												 grouping_sets_data *gd,
 												 GroupPathExtraData *extra,
 												 bool force_rel_creation);
+static bool can_eager_agg(PlannerInfo *root, RelOptInfo *input_rel,
+						  GroupPathExtraData *extra);
+static void create_eager_aggregation_paths(PlannerInfo *root,
+										   RelOptInfo *input_rel,
+										   RelOptInfo *grouped_rel,
+										   RelOptInfo *partially_grouped_rel,
+										   GroupPathExtraData *extra);
+static void create_redistributed_grouping_paths(PlannerInfo *root,
+												RelOptInfo *input_rel,
+												RelOptInfo *grouped_rel,
+												const AggClauseCosts *agg_costs,
+												double dNumGroups,
+												GroupPathExtraData *extra);
 static void gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel);
 static bool can_partial_agg(PlannerInfo *root);
 static void apply_scanjoin_target_to_paths(PlannerInfo *root,
@@ -298,6 +323,13 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	Plan	   *top_plan;
 	ListCell   *lp,
 			   *lr;
+	bool		resultCacheable;
+
+	/*
+	 * Decide whether the result may go to the shared result cache.  This
+	 * must look at the query before planning modifies it.
+	 */
+	resultCacheable = SharedResultCacheQueryIsCacheable(parse);
 
 	/*
 	 * Set up global state for this planner invocation.  This data is needed
@@ -317,6 +349,7 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	glob->finalrowmarks = NIL;
 	glob->resultRelations = NIL;
 	glob->appendRelations = NIL;
+	glob->prunableRelids = NULL;
 	glob->relationOids = NIL;
 	glob->invalItems = NIL;
 	glob->paramExecTypes = NIL;
@@ -334,13 +367,13 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	 * functions are present in the query tree.
 	 *
 	 * (Note that we do allow CREATE TABLE AS, SELECT INTO, and CREATE
-	 * MATERIALIZED VIEW to use parallel plans, but this is safe only because
-	 * the command is writing into a completely new table which workers won't
-	 * be able to see.  If the workers could see the table, the fact that
-	 * group locking would cause them to ignore the leader's heavyweight GIN
-	 * page locks would make this unsafe.  We'll have to fix that somehow if
-	 * we want to allow parallel inserts in general; updates and deletes have
-	 * additional problems especially around combo CIDs.)
+	 * MATERIALIZED VIEW to use parallel plans, since the command is writing
+	 * into a completely new table which workers won't be able to see.  We
+	 * also allow INSERT if enable_parallel_insert is on; max_parallel_hazard
+	 * then checks the target table too, and heavyweight page locks conflict
+	 * among group members so that workers inserting into a GIN index don't
+	 * ignore each other.  Updates and deletes have additional problems
+	 * especially around combo CIDs.)
 	 *
 	 * We don't try to use parallel mode unless interruptible.  The leader
 	 * expects ProcessInterrupts() calls to reach HandleParallelMessages().
@@ -354,7 +387,8 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	 */
 	if ((cursorOptions & CURSOR_OPT_PARALLEL_OK) != 0 &&
 		IsUnderPostmaster &&
-		parse->commandType == CMD_SELECT &&
+		(parse->commandType == CMD_SELECT ||
+		 (parse->commandType == CMD_INSERT && enable_parallel_insert)) &&
 		!parse->hasModifyingCTE &&
 		max_parallel_workers_per_gather > 0 &&
 		INTERRUPTS_CAN_BE_PROCESSED() &&
@@ -541,6 +575,21 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 		lfirst(lp) = set_plan_references(subroot, subplan);
 	}
 
+	/*
+	 * Partitions that are result relations or have row marks are opened by
+	 * the executor whether or not pruning removes their subplans, so they
+	 * must be locked up front like any other relation.
+	 */
+	foreach(lp, glob->resultRelations)
+		glob->prunableRelids = bms_del_member(glob->prunableRelids,
+											  lfirst_int(lp));
+	foreach(lp, glob->finalrowmarks)
+	{
+		PlanRowMark *rc = lfirst_node(PlanRowMark, lp);
+
+		glob->prunableRelids = bms_del_member(glob->prunableRelids, rc->rti);
+	}
+
 	/* build the PlannedStmt result */
 	result = makeNode(PlannedStmt);
 
@@ -552,11 +601,13 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	result->transientPlan = glob->transientPlan;
 	result->dependsOnRole = glob->dependsOnRole;
 	result->parallelModeNeeded = glob->parallelModeNeeded;
+	result->resultCacheable = resultCacheable;
 	result->planTree = top_plan;
 	result->rtable = glob->finalrtable;
 	result->permInfos = glob->finalrteperminfos;
 	result->resultRelations = glob->resultRelations;
 	result->appendRelations = glob->appendRelations;
+	result->prunableRelids = glob->prunableRelids;
 	result->subplans = glob->subplans;
 	result->rewindPlanIDs = glob->rewindPlanIDs;
 	result->rowMarks = glob->finalrowmarks;
@@ -1796,8 +1847,8 @@ grouping_planner(PlannerInfo *root, double tuple_fraction,
 	 * If the input rel is marked consider_parallel and there's nothing that's
 	 * not parallel-safe in the LIMIT clause, then the final_rel can be marked
 	 * consider_parallel as well.  Note that if the query has rowMarks or is
-	 * not a SELECT, consider_parallel will be false for every relation in the
-	 * query.
+	 * not a SELECT or INSERT, consider_parallel will be false for every
+	 * relation in the query.
 	 */
 	if (current_rel->consider_parallel &&
 		is_parallel_safe(root, parse->limitOffset) &&
@@ -2055,6 +2106,21 @@ grouping_planner(PlannerInfo *root, double tuple_fraction,
 		add_path(final_rel, path);
 	}
 
+	/*
+	 * An INSERT can also be done by the parallel workers themselves, each
+	 * inserting the rows it computes, if nothing has to happen afterwards in
+	 * the leader.  max_parallel_hazard has vetted the target table already.
+	 */
+	if (parse->commandType == CMD_INSERT &&
+		final_rel->consider_parallel &&
+		current_rel->partial_pathlist != NIL &&
+		parse->returningList == NIL &&
+		root->rowMarks == NIL &&
+		!limit_needed(parse) &&
+		is_parallel_safe(root, (Node *) parse->withCheckOptions))
+		add_parallel_insert_path(root, final_rel,
+								 linitial(current_rel->partial_pathlist));
+
 	/*
 	 * Generate partial paths for final_rel, too, if outer query levels might
 	 * be able to make use of them.
@@ -2094,6 +2160,52 @@ grouping_planner(PlannerInfo *root, double tuple_fraction,
 	/* Note: currently, we leave it to callers to do set_cheapest() */
 }
 
+/*
+ * add_parallel_insert_path
+ *	  Add a path that runs a single-table INSERT below a Gather node.
+ *
+ * 'subpath' is a partial path computing the rows to insert.  Every
+ * participant inserts the rows it gets from its own copy of the subpath, so
+ * nothing but the count of inserted rows comes back to the leader.
+ */
+static void
+add_parallel_insert_path(PlannerInfo *root, RelOptInfo *final_rel,
+						 Path *subpath)
+{
+	Query	   *parse = root->parse;
+	ModifyTablePath *mtpath;
+	Path	   *path;
+
+	Assert(parse->commandType == CMD_INSERT && subpath->parallel_workers > 0);
+
+	mtpath = create_modifytable_path(root, final_rel,
+									 subpath,
+									 CMD_INSERT,
+									 parse->canSetTag,
+									 parse->resultRelation,
+									 0,
+									 false,
+									 list_make1_int(parse->resultRelation),
+									 NIL,
+									 parse->withCheckOptions ?
+									 list_make1(parse->withCheckOptions) : NIL,
+									 NIL,
+									 NIL,
+									 NULL,
+									 NIL,
+									 NIL,
+									 assign_special_exec_param(root));
+
+	/* Unlike a top-level ModifyTable, this one runs in every participant */
+	mtpath->path.parallel_safe = true;
+	mtpath->path.parallel_workers = subpath->parallel_workers;
+
+	path = (Path *) create_gather_path(root, final_rel, &mtpath->path,
+									   create_empty_pathtarget(),
+									   NULL, NULL);
+	add_path(final_rel, path);
+}
+
 /*
  * Do preprocessing for groupingSets clause and related data.  This handles the
  * preliminary steps of expanding the grouping sets, organizing them into lists
@@ -4080,6 +4192,7 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 	RelOptInfo *partially_grouped_rel = NULL;
 	double		dNumGroups;
 	PartitionwiseAggregateType patype = PARTITIONWISE_AGGREGATE_NONE;
+	bool		eager_agg;
 
 	/*
 	 * If this is the topmost grouping relation or if the parent relation is
@@ -4112,6 +4225,14 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 			patype = PARTITIONWISE_AGGREGATE_NONE;
 	}
 
+	/*
+	 * Check whether we might aggregate part of the input before the topmost
+	 * join.  Don't bother if we're doing partitionwise aggregation.
+	 */
+	eager_agg = (patype == PARTITIONWISE_AGGREGATE_NONE &&
+				 !IS_OTHER_REL(input_rel) &&
+				 can_eager_agg(root, input_rel, extra));
+
 	/*
 	 * Before generating paths for grouped_rel, we first generate any possible
 	 * partially grouped paths; that way, later code can easily consider both
@@ -4124,9 +4245,10 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 		/*
 		 * If we're doing partitionwise aggregation at this level, force
 		 * creation of a partially_grouped_rel so we can add partitionwise
-		 * paths to it.
+		 * paths to it.  Likewise for eager aggregation paths.
 		 */
-		force_rel_creation = (patype == PARTITIONWISE_AGGREGATE_PARTIAL);
+		force_rel_creation = (patype == PARTITIONWISE_AGGREGATE_PARTIAL ||
+							  eager_agg);
 
 		partially_grouped_rel =
 			create_partial_grouping_paths(root,
@@ -4159,10 +4281,15 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 
 	/* Gather any partially grouped partial paths. */
 	if (partially_grouped_rel && partially_grouped_rel->partial_pathlist)
-	{
 		gather_grouping_paths(root, partially_grouped_rel);
+
+	/* Consider partially aggregating one input of the topmost join. */
+	if (eager_agg)
+		create_eager_aggregation_paths(root, input_rel, grouped_rel,
+									   partially_grouped_rel, extra);
+
+	if (partially_grouped_rel && partially_grouped_rel->pathlist)
 		set_cheapest(partially_grouped_rel);
-	}
 
 	/*
 	 * Estimate number of groups.
@@ -4172,6 +4299,17 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 									  gd,
 									  extra->targetList);
 
+	/*
+	 * Consider aggregating whole groups in each participant of a parallel
+	 * query.  add_paths_to_grouping_rel will gather the resulting partial
+	 * paths.
+	 */
+	if (!IS_OTHER_REL(input_rel) && gd == NULL &&
+		grouped_rel->consider_parallel && enable_parallel_redistribute &&
+		input_rel->partial_pathlist != NIL)
+		create_redistributed_grouping_paths(root, input_rel, grouped_rel,
+											agg_costs, dNumGroups, extra);
+
 	/* Build final grouping paths */
 	add_paths_to_grouping_rel(root, input_rel, grouped_rel,
 							  partially_grouped_rel, agg_costs, gd,
@@ -4615,14 +4753,29 @@ create_window_paths(PlannerInfo *root,
 			pathkeys_count_contained_in(root->window_pathkeys, path->pathkeys,
 										&presorted_keys) ||
 			presorted_keys > 0)
-			create_one_window_path(root,
+			add_path(window_rel,
+					 create_one_window_path(root,
+											window_rel,
+											path,
+											input_target,
+											output_target,
+											wflists,
+											activeWindows));
+	}
+
+	/*
+	 * Consider computing the window functions in the workers of a parallel
+	 * query, too.
+	 */
+	if (window_rel->consider_parallel && enable_parallel_redistribute &&
+		input_rel->partial_pathlist != NIL)
+		create_partial_window_path(root,
 								   window_rel,
-								   path,
+								   input_rel,
 								   input_target,
 								   output_target,
 								   wflists,
 								   activeWindows);
-	}
 
 	/*
 	 * If there is an FDW that's responsible for all baserels of the query,
@@ -4647,7 +4800,7 @@ create_window_paths(PlannerInfo *root,
 
 /*
  * Stack window-function implementation steps atop the given Path, and
- * add the result to window_rel.
+ * return the result, which belongs to window_rel.
  *
  * window_rel: upperrel to contain result
  * path: input Path to use (must return input_target)
@@ -4656,7 +4809,7 @@ create_window_paths(PlannerInfo *root,
  * wflists: result of find_window_functions
  * activeWindows: result of select_active_windows
  */
-static void
+static Path *
 create_one_window_path(PlannerInfo *root,
 					   RelOptInfo *window_rel,
 					   Path *path,
@@ -4812,7 +4965,100 @@ create_one_window_path(PlannerInfo *root,
 								  topwindow ? topqual : NIL, topwindow);
 	}
 
-	add_path(window_rel, path);
+	return path;
+}
+
+/*
+ * create_partial_window_path
+ *
+ * A window partition must be processed by a single WindowAgg, but different
+ * partitions are independent.  If every active window partitions by some
+ * common hashable expressions, redistribute the cheapest partial input path
+ * by those expressions, so that each participant of a parallel query gets
+ * complete window partitions, and compute the window functions below a
+ * Gather.  The same set of expressions also works for windows that partition
+ * by more columns, since rows that are equal on all of those columns are
+ * certainly equal on the common ones.
+ *
+ * Arguments are as for create_one_window_path, plus input_rel, whose partial
+ * paths must also return input_target.
+ */
+static void
+create_partial_window_path(PlannerInfo *root,
+						   RelOptInfo *window_rel,
+						   RelOptInfo *input_rel,
+						   PathTarget *input_target,
+						   PathTarget *output_target,
+						   WindowFuncLists *wflists,
+						   List *activeWindows)
+{
+	WindowClause *firstwc = linitial_node(WindowClause, activeWindows);
+	Path	   *cheapest_partial_path = linitial(input_rel->partial_pathlist);
+	List	   *hashkeys = NIL;
+	List	   *hashoperators = NIL;
+	double		total_rows;
+	double		numGroups;
+	Path	   *path;
+	ListCell   *lc;
+
+	foreach(lc, firstwc->partitionClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		bool		common = sgc->hashable;
+		ListCell   *lc2;
+
+		for_each_from(lc2, activeWindows, 1)
+		{
+			WindowClause *wc = lfirst_node(WindowClause, lc2);
+			ListCell   *lc3;
+
+			if (!common)
+				break;
+			common = false;
+			foreach(lc3, wc->partitionClause)
+			{
+				SortGroupClause *other = lfirst_node(SortGroupClause, lc3);
+
+				if (other->tleSortGroupRef == sgc->tleSortGroupRef &&
+					other->eqop == sgc->eqop)
+				{
+					common = true;
+					break;
+				}
+			}
+		}
+
+		if (common)
+		{
+			hashkeys = lappend(hashkeys,
+							   get_sortgroupclause_expr(sgc,
+														root->processed_tlist));
+			hashoperators = lappend_oid(hashoperators, sgc->eqop);
+		}
+	}
+
+	if (hashkeys == NIL)
+		return;
+
+	total_rows = compute_gather_rows(cheapest_partial_path);
+	numGroups = estimate_num_groups(root, hashkeys, total_rows, NULL, NULL);
+
+	path = (Path *) create_redistribute_path(root, window_rel,
+											 cheapest_partial_path,
+											 hashkeys, hashoperators,
+											 numGroups);
+	path = create_one_window_path(root,
+								  window_rel,
+								  path,
+								  input_target,
+								  output_target,
+								  wflists,
+								  activeWindows);
+
+	/* Apart from run conditions, window functions keep every row */
+	add_path(window_rel, (Path *)
+			 create_gather_path(root, window_rel, path, path->pathtarget,
+								NULL, &total_rows));
 }
 
 /*
@@ -7289,6 +7535,107 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 		gather_grouping_paths(root, grouped_rel);
 }
 
+/*
+ * create_redistributed_grouping_paths
+ *
+ * Add partial paths to grouped_rel that redistribute the cheapest partial
+ * input path by the hashable grouping columns, so that each participant
+ * sees every row of the groups it sees at all, and then aggregate normally
+ * in each participant.  Unlike partial aggregation, this needs no combine
+ * step, so it also works for aggregates that lack combine functions or use
+ * DISTINCT or ORDER BY, and it saves the leader from finalizing every group
+ * when there are many.
+ */
+static void
+create_redistributed_grouping_paths(PlannerInfo *root,
+									RelOptInfo *input_rel,
+									RelOptInfo *grouped_rel,
+									const AggClauseCosts *agg_costs,
+									double dNumGroups,
+									GroupPathExtraData *extra)
+{
+	Query	   *parse = root->parse;
+	Path	   *cheapest_partial_path = linitial(input_rel->partial_pathlist);
+	List	   *havingQual = (List *) extra->havingQual;
+	List	   *hashkeys = NIL;
+	List	   *hashoperators = NIL;
+	double		total_rows;
+	double		dNumRedistributeGroups;
+	double		dNumPartialGroups;
+	Path	   *path;
+	ListCell   *lc;
+
+	if (parse->groupingSets)
+		return;
+
+	/* Any subset of the grouping columns keeps each group in one process */
+	foreach(lc, root->processed_groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+
+		if (!sgc->hashable)
+			continue;
+		hashkeys = lappend(hashkeys,
+						   get_sortgroupclause_expr(sgc, extra->targetList));
+		hashoperators = lappend_oid(hashoperators, sgc->eqop);
+	}
+
+	if (hashkeys == NIL)
+		return;
+
+	total_rows = compute_gather_rows(cheapest_partial_path);
+	dNumRedistributeGroups = estimate_num_groups(root, hashkeys, total_rows,
+												 NULL, NULL);
+	path = (Path *) create_redistribute_path(root, grouped_rel,
+											 cheapest_partial_path,
+											 hashkeys, hashoperators,
+											 dNumRedistributeGroups);
+
+	/* Each participant gets its share of the groups along with the rows */
+	dNumPartialGroups = clamp_row_est(dNumGroups * path->rows / total_rows);
+
+	if ((extra->flags & GROUPING_CAN_USE_SORT) != 0)
+	{
+		Path	   *sorted_path;
+
+		sorted_path = (Path *) create_sort_path(root, grouped_rel, path,
+												root->group_pathkeys, -1.0);
+
+		if (parse->hasAggs)
+			add_partial_path(grouped_rel, (Path *)
+							 create_agg_path(root,
+											 grouped_rel,
+											 sorted_path,
+											 grouped_rel->reltarget,
+											 AGG_SORTED,
+											 AGGSPLIT_SIMPLE,
+											 root->processed_groupClause,
+											 havingQual,
+											 agg_costs,
+											 dNumPartialGroups));
+		else
+			add_partial_path(grouped_rel, (Path *)
+							 create_group_path(root,
+											   grouped_rel,
+											   sorted_path,
+											   root->processed_groupClause,
+											   havingQual,
+											   dNumPartialGroups));
+	}
+
+	if ((extra->flags & GROUPING_CAN_USE_HASH) != 0)
+		add_partial_path(grouped_rel, (Path *)
+						 create_agg_path(root, grouped_rel,
+										 path,
+										 grouped_rel->reltarget,
+										 AGG_HASHED,
+										 AGGSPLIT_SIMPLE,
+										 root->processed_groupClause,
+										 havingQual,
+										 agg_costs,
+										 dNumPartialGroups));
+}
+
 /*
  * create_partial_grouping_paths
  *
@@ -7591,6 +7938,279 @@ create_partial_grouping_paths(PlannerInfo *root,
 	return partially_grouped_rel;
 }
 
+/*
+ * can_eager_agg
+ *
+ * Determines whether eager aggregation should be considered for a grouping
+ * step on top of input_rel.  This only does the cheap checks; see
+ * create_eager_aggregation_paths for the rest.
+ */
+static bool
+can_eager_agg(PlannerInfo *root, RelOptInfo *input_rel,
+			  GroupPathExtraData *extra)
+{
+	if (!enable_eager_aggregate)
+		return false;
+
+	/* We need aggregates, and they must support partial aggregation */
+	if (!root->parse->hasAggs ||
+		(extra->flags & GROUPING_CAN_PARTIAL_AGG) == 0)
+		return false;
+
+	/* There must be a join to push the aggregation below */
+	if (input_rel->reloptkind != RELOPT_JOINREL || IS_DUMMY_REL(input_rel))
+		return false;
+
+	/*
+	 * Only plain inner joins are handled.  Rows on the nullable side of an
+	 * outer join, or rows that are filtered by a semijoin, can't be grouped
+	 * before the join in general; LATERAL references and PlaceHolderVars
+	 * would need to be carried through the aggregation.
+	 */
+	if (root->join_info_list != NIL || root->hasLateralRTEs ||
+		root->placeholder_list != NIL)
+		return false;
+
+	return true;
+}
+
+/*
+ * create_eager_aggregation_paths
+ *
+ * Eager aggregation: if all the aggregates take their input from a single
+ * base relation of the topmost join, consider partially aggregating that
+ * relation by the columns that are needed above it, joining the result to
+ * the other relations, and finalizing the aggregation on top of the join.
+ * That can make the join's input much smaller.
+ *
+ * This is correct for inner joins because all the rows of a partial group
+ * have the same values in the columns that the join looks at, so they join
+ * to the same rows of the other side.  A partial aggregate state appearing
+ * once for each of those rows therefore stands for each of its input rows
+ * appearing once per joined row, which is what aggregating above the join
+ * would have seen.  That requires that the grouping columns' equality
+ * implies image equality; otherwise rows that the grouping puts together
+ * might still differ in the eyes of a join clause or an expression above.
+ *
+ * The join paths are added to partially_grouped_rel, so that
+ * add_paths_to_grouping_rel finalizes them like any other partially
+ * aggregated path and they compete with the plans that aggregate after
+ * joining.
+ */
+static void
+create_eager_aggregation_paths(PlannerInfo *root, RelOptInfo *input_rel,
+							   RelOptInfo *grouped_rel,
+							   RelOptInfo *partially_grouped_rel,
+							   GroupPathExtraData *extra)
+{
+	List	   *upper_exprs;
+	Relids		agg_relids = NULL;
+	int			relid;
+	RelOptInfo *rel;
+	Relids		other_relids;
+	RelOptInfo *other_rel;
+	PathTarget *input_target;
+	PathTarget *agg_target;
+	List	   *groupClause = NIL;
+	List	   *groupExprs = NIL;
+	Index		maxref = 0;
+	double		dNumGroups;
+	RelOptInfo *agg_rel;
+	RelOptInfo *grouped_joinrel;
+	Path	   *path;
+	ListCell   *lc;
+	int			i;
+
+	Assert(extra->partial_costs_set);
+
+	/*
+	 * Collect the Aggrefs, and the Vars used outside of them, from the
+	 * grouping target and HAVING, as make_partial_grouping_target does.
+	 */
+	upper_exprs = pull_var_clause((Node *) list_make2(grouped_rel->reltarget->exprs,
+													  extra->havingQual),
+								  PVC_INCLUDE_AGGREGATES |
+								  PVC_RECURSE_WINDOWFUNCS |
+								  PVC_INCLUDE_PLACEHOLDERS);
+
+	/* Find the one relation that the aggregates read from */
+	foreach(lc, upper_exprs)
+	{
+		Node	   *node = (Node *) lfirst(lc);
+
+		if (!IsA(node, Aggref))
+			continue;
+
+		/* Volatile arguments must be evaluated once per joined row */
+		if (contain_volatile_functions(node))
+			return;
+
+		agg_relids = bms_add_members(agg_relids, pull_varnos(root, node));
+	}
+	if (!bms_get_singleton_member(agg_relids, &relid))
+		return;
+
+	rel = find_base_rel(root, relid);
+	if (rel->reloptkind != RELOPT_BASEREL || IS_DUMMY_REL(rel))
+		return;
+
+	/* The rest of the join must have been planned already */
+	other_relids = bms_difference(input_rel->relids, rel->relids);
+	if (bms_membership(other_relids) == BMS_SINGLETON)
+		other_rel = find_base_rel(root, bms_singleton_member(other_relids));
+	else
+		other_rel = find_join_rel(root, other_relids);
+	if (other_rel == NULL || other_rel->cheapest_total_path == NULL ||
+		IS_DUMMY_REL(other_rel))
+		return;
+
+	/* New grouping columns get sortgrouprefs beyond those already in use */
+	foreach(lc, root->processed_tlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		maxref = Max(maxref, tle->ressortgroupref);
+	}
+
+	/*
+	 * Group the relation by every column that is needed above it, other than
+	 * as an aggregate argument: by the join clauses, or by the grouping
+	 * target and HAVING.
+	 */
+	input_target = copy_pathtarget(rel->reltarget);
+	if (input_target->sortgrouprefs == NULL)
+		input_target->sortgrouprefs = (Index *)
+			palloc0(list_length(input_target->exprs) * sizeof(Index));
+	agg_target = create_empty_pathtarget();
+
+	i = 0;
+	foreach(lc, input_target->exprs)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+		Relids		attr_needed;
+		Oid			sortop;
+		Oid			eqop;
+		bool		hashable;
+		Oid			lefttype;
+		Oid			righttype;
+		List	   *opfamilies;
+		Oid			equalimageproc;
+		SortGroupClause *sgc;
+
+		if (!IsA(var, Var) || var->varno != relid)
+			return;
+
+		attr_needed = rel->attr_needed[var->varattno - rel->min_attr];
+		if (bms_next_member(attr_needed, 0) < 0 &&
+			!list_member(upper_exprs, var))
+		{
+			/* Needed only by the aggregates */
+			i++;
+			continue;
+		}
+
+		if (var->varattno <= 0)
+			return;
+
+		/* Partial aggregation is always hashed, so we need a hashable type */
+		get_sort_group_operators(var->vartype, false, false, false,
+								 &sortop, &eqop, NULL, &hashable);
+		if (!OidIsValid(eqop) || !hashable)
+			return;
+
+		opfamilies = get_mergejoin_opfamilies(eqop);
+		if (opfamilies == NIL)
+			return;
+		op_input_types(eqop, &lefttype, &righttype);
+		equalimageproc = get_opfamily_proc(linitial_oid(opfamilies),
+										   lefttype, lefttype,
+										   BTEQUALIMAGE_PROC);
+		if (!OidIsValid(equalimageproc) ||
+			!DatumGetBool(OidFunctionCall1Coll(equalimageproc,
+											   var->varcollid,
+											   ObjectIdGetDatum(lefttype))))
+			return;
+
+		sgc = makeNode(SortGroupClause);
+		sgc->tleSortGroupRef = ++maxref;
+		sgc->eqop = eqop;
+		sgc->sortop = sortop;
+		sgc->reverse_sort = false;
+		sgc->nulls_first = false;
+		sgc->hashable = true;
+		groupClause = lappend(groupClause, sgc);
+		groupExprs = lappend(groupExprs, var);
+
+		input_target->sortgrouprefs[i] = sgc->tleSortGroupRef;
+		add_column_to_pathtarget(agg_target, (Expr *) var,
+								 sgc->tleSortGroupRef);
+		i++;
+	}
+
+	/* Add the aggregates, in the same partial form as the join will emit */
+	foreach(lc, upper_exprs)
+	{
+		Aggref	   *aggref = (Aggref *) lfirst(lc);
+
+		if (IsA(aggref, Aggref))
+		{
+			Aggref	   *newaggref = makeNode(Aggref);
+
+			memcpy(newaggref, aggref, sizeof(Aggref));
+			mark_partial_aggref(newaggref, AGGSPLIT_INITIAL_SERIAL);
+			add_new_column_to_pathtarget(agg_target, (Expr *) newaggref);
+		}
+	}
+	set_pathtarget_cost_width(root, agg_target);
+
+	/*
+	 * Unless the groups are reasonably large, the extra aggregation step
+	 * can't pay for itself; don't spend planning effort on it.
+	 */
+	dNumGroups = estimate_num_groups(root, groupExprs, rel->rows, NULL, NULL);
+	if (dNumGroups > rel->rows / 2)
+		return;
+
+	/* Build the partially aggregated relation */
+	agg_rel = build_grouped_rel(root, rel, agg_target, dNumGroups);
+	path = (Path *) create_projection_path(root, rel,
+										   rel->cheapest_total_path,
+										   input_target);
+	add_path(agg_rel, (Path *)
+			 create_agg_path(root,
+							 agg_rel,
+							 path,
+							 agg_target,
+							 AGG_HASHED,
+							 AGGSPLIT_INITIAL_SERIAL,
+							 groupClause,
+							 NIL,
+							 &extra->agg_partial_costs,
+							 dNumGroups));
+	set_cheapest(agg_rel);
+
+	/* Join it to the other relations */
+	grouped_joinrel = make_grouped_join_rel(root, input_rel, agg_rel,
+											other_rel,
+											partially_grouped_rel->reltarget);
+	if (grouped_joinrel == NULL)
+		return;
+
+	/*
+	 * Hand the join paths over to partially_grouped_rel.  They keep
+	 * grouped_joinrel as their parent, which has the right relids for
+	 * creating the join plans, and is not used any further.
+	 */
+	foreach(lc, grouped_joinrel->pathlist)
+	{
+		path = (Path *) lfirst(lc);
+
+		if (path->param_info == NULL)
+			add_path(partially_grouped_rel, path);
+	}
+	grouped_joinrel->pathlist = NIL;
+}
+
 /*
  * Generate Gather and Gather Merge paths for a grouping relation or partial
  * grouping relation.
@@ -155,6 +155,9 @@ static Plan *set_append_references(PlannerInfo *root,
 static Plan *set_mergeappend_references(PlannerInfo *root,
 										MergeAppend *mplan,
 										int rtoffset);
+static void set_part_prune_references(PlannerInfo *root,
+									  PartitionPruneInfo *pruneinfo,
+									  int rtoffset);
 static void set_hash_references(PlannerInfo *root, Plan *plan, int rtoffset);
 static Relids offset_relid_set(Relids relids, int rtoffset);
 static Node *fix_scan_expr(PlannerInfo *root, Node *node,
@@ -862,6 +865,33 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			set_hash_references(root, plan, rtoffset);
 			break;
 
+		case T_Redistribute:
+			{
+				Redistribute *rplan = (Redistribute *) plan;
+				indexed_tlist *subplan_itlist;
+
+				/*
+				 * Like Hash, Redistribute evaluates its hash keys over the
+				 * rows of its outer plan, and doesn't project.
+				 */
+				subplan_itlist = build_tlist_index(plan->lefttree->targetlist);
+				rplan->hashkeys = (List *)
+					fix_upper_expr(root,
+								   (Node *) rplan->hashkeys,
+								   subplan_itlist,
+								   OUTER_VAR,
+								   rtoffset,
+								   NRM_EQUAL,
+								   NUM_EXEC_QUAL(plan));
+				pfree(subplan_itlist);
+
+				set_dummy_tlist_references(plan, rtoffset);
+
+				/* Redistribute nodes don't have their own quals */
+				Assert(plan->qual == NIL);
+			}
+			break;
+
 		case T_Memoize:
 			{
 				Memoize    *mplan = (Memoize *) plan;
@@ -1785,20 +1815,7 @@ set_append_references(PlannerInfo *root,
 	aplan->apprelids = offset_relid_set(aplan->apprelids, rtoffset);
 
 	if (aplan->part_prune_info)
-	{
-		foreach(l, aplan->part_prune_info->prune_infos)
-		{
-			List	   *prune_infos = lfirst(l);
-			ListCell   *l2;
-
-			foreach(l2, prune_infos)
-			{
-				PartitionedRelPruneInfo *pinfo = lfirst(l2);
-
-				pinfo->rtindex += rtoffset;
-			}
-		}
-	}
+		set_part_prune_references(root, aplan->part_prune_info, rtoffset);
 
 	/* We don't need to recurse to lefttree or righttree ... */
 	Assert(aplan->plan.lefttree == NULL);
@@ -1861,26 +1878,69 @@ set_mergeappend_references(PlannerInfo *root,
 	mplan->apprelids = offset_relid_set(mplan->apprelids, rtoffset);
 
 	if (mplan->part_prune_info)
+		set_part_prune_references(root, mplan->part_prune_info, rtoffset);
+
+	/* We don't need to recurse to lefttree or righttree ... */
+	Assert(mplan->plan.lefttree == NULL);
+	Assert(mplan->plan.righttree == NULL);
+
+	return (Plan *) mplan;
+}
+
+/*
+ * set_part_prune_references
+ *		Do set_plan_references processing on a PartitionPruneInfo
+ *
+ * Besides adjusting the RT indexes, record the leaf partitions of each
+ * partitioning hierarchy that has initial pruning steps in
+ * glob->prunableRelids, so that their locks can be deferred until it's known
+ * whether they survive that pruning.
+ */
+static void
+set_part_prune_references(PlannerInfo *root, PartitionPruneInfo *pruneinfo,
+						  int rtoffset)
+{
+	ListCell   *l;
+
+	foreach(l, pruneinfo->prune_infos)
 	{
-		foreach(l, mplan->part_prune_info->prune_infos)
+		List	   *prune_infos = lfirst(l);
+		bool		needs_init_pruning = false;
+		ListCell   *l2;
+
+		foreach(l2, prune_infos)
 		{
-			List	   *prune_infos = lfirst(l);
-			ListCell   *l2;
+			PartitionedRelPruneInfo *pinfo = lfirst(l2);
+			int			i;
 
-			foreach(l2, prune_infos)
+			pinfo->rtindex += rtoffset;
+			for (i = 0; i < pinfo->nparts; i++)
 			{
-				PartitionedRelPruneInfo *pinfo = lfirst(l2);
-
-				pinfo->rtindex += rtoffset;
+				if (pinfo->leafpart_rti_map[i] > 0)
+					pinfo->leafpart_rti_map[i] += rtoffset;
 			}
+
+			if (pinfo->initial_pruning_steps != NIL)
+				needs_init_pruning = true;
 		}
-	}
 
-	/* We don't need to recurse to lefttree or righttree ... */
-	Assert(mplan->plan.lefttree == NULL);
-	Assert(mplan->plan.righttree == NULL);
+		if (!needs_init_pruning)
+			continue;
 
-	return (Plan *) mplan;
+		foreach(l2, prune_infos)
+		{
+			PartitionedRelPruneInfo *pinfo = lfirst(l2);
+			int			i;
+
+			for (i = 0; i < pinfo->nparts; i++)
+			{
+				if (pinfo->leafpart_rti_map[i] > 0)
+					root->glob->prunableRelids =
+						bms_add_member(root->glob->prunableRelids,
+									   pinfo->leafpart_rti_map[i]);
+			}
+		}
+	}
 }
 
 /*
@@ -2328,6 +2388,15 @@ set_join_references(PlannerInfo *root, Join *join, int rtoffset)
 				  nlp->paramval->varno == OUTER_VAR))
 				elog(ERROR, "NestLoopParam was not reduced to a simple Var");
 		}
+
+		nl->hashclauses = fix_join_expr(root,
+										nl->hashclauses,
+										outer_itlist,
+										inner_itlist,
+										(Index) 0,
+										rtoffset,
+										NRM_EQUAL,
+										NUM_EXEC_QUAL((Plan *) join));
 	}
 	else if (IsA(join, MergeJoin))
 	{
@@ -2671,6 +2671,8 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			{
 				finalize_primnode((Node *) ((Join *) plan)->joinqual,
 								  &context);
+				finalize_primnode((Node *) ((NestLoop *) plan)->hashclauses,
+								  &context);
 				/* collect set of params that will be passed to right child */
 				foreach(l, ((NestLoop *) plan)->nestParams)
 				{
@@ -2701,6 +2703,11 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 							  &context);
 			break;
 
+		case T_Redistribute:
+			finalize_primnode((Node *) ((Redistribute *) plan)->hashkeys,
+							  &context);
+			break;
+
 		case T_Limit:
 			finalize_primnode(((Limit *) plan)->limitOffset,
 							  &context);
@@ -19,7 +19,10 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/table.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_language.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_proc.h"
@@ -41,6 +44,7 @@
 #include "parser/analyze.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_func.h"
+#include "parser/parsetree.h"
 #include "rewrite/rewriteHandler.h"
 #include "rewrite/rewriteManip.h"
 #include "tcop/tcopprot.h"
@@ -53,6 +57,8 @@
 #include "utils/jsonpath.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/partcache.h"
+#include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
 
@@ -100,6 +106,10 @@ static bool contain_volatile_functions_walker(Node *node, void *context);
 static bool contain_volatile_functions_not_nextval_walker(Node *node, void *context);
 static bool max_parallel_hazard_walker(Node *node,
 									   max_parallel_hazard_context *context);
+static bool max_parallel_hazard_test(char proparallel,
+									 max_parallel_hazard_context *context);
+static bool target_rel_max_parallel_hazard(Query *parse,
+										   max_parallel_hazard_context *context);
 static bool contain_nonstrict_functions_walker(Node *node, void *context);
 static bool contain_exec_param_walker(Node *node, List *param_ids);
 static bool contain_context_dependent_node(Node *clause);
@@ -738,10 +748,99 @@ max_parallel_hazard(Query *parse)
 	context.max_hazard = PROPARALLEL_SAFE;
 	context.max_interesting = PROPARALLEL_UNSAFE;
 	context.safe_param_ids = NIL;
-	(void) max_parallel_hazard_walker((Node *) parse, &context);
+	if (!max_parallel_hazard_walker((Node *) parse, &context) &&
+		parse->commandType == CMD_INSERT)
+		(void) target_rel_max_parallel_hazard(parse, &context);
 	return context.max_hazard;
 }
 
+/*
+ * target_rel_max_parallel_hazard
+ *		Check what an INSERT would run on its own, outside the query tree
+ *
+ * The query tree doesn't show everything that inserting a row involves: the
+ * target's triggers, CHECK constraints, partition constraint, stored
+ * generated columns and index expressions and predicates run too, wherever
+ * the insertion happens.  Any trigger could do anything, so we give up on
+ * those, and likewise on other kinds of target and on tables that don't use
+ * the heap access method.  The rest must be parallel-safe; since no plan
+ * node accounts for these expressions, anything less makes the whole
+ * statement parallel-unsafe.
+ */
+static bool
+target_rel_max_parallel_hazard(Query *parse,
+							   max_parallel_hazard_context *context)
+{
+	RangeTblEntry *rte = rt_fetch(parse->resultRelation, parse->rtable);
+	max_parallel_hazard_context target_context;
+	Relation	rel;
+	TupleDesc	tupdesc;
+	bool		hazard;
+
+	/* Speculative insertion relies on locks that group members ignore */
+	if (parse->onConflict != NULL)
+		return max_parallel_hazard_test(PROPARALLEL_UNSAFE, context);
+
+	target_context.max_hazard = PROPARALLEL_SAFE;
+	target_context.max_interesting = PROPARALLEL_RESTRICTED;
+	target_context.safe_param_ids = NIL;
+
+	/* The parser already locked the target */
+	rel = table_open(rte->relid, NoLock);
+	tupdesc = RelationGetDescr(rel);
+
+	hazard = (rel->rd_rel->relkind != RELKIND_RELATION ||
+			  rel->rd_rel->relam != HEAP_TABLE_AM_OID ||
+			  RelationUsesLocalBuffers(rel) ||
+			  rel->rd_rel->relhastriggers);
+
+	if (!hazard && tupdesc->constr != NULL)
+	{
+		TupleConstr *constr = tupdesc->constr;
+
+		for (int i = 0; i < constr->num_check && !hazard; i++)
+			hazard = max_parallel_hazard_walker(stringToNode(constr->check[i].ccbin),
+												&target_context);
+
+		for (int i = 0; i < tupdesc->natts && !hazard; i++)
+		{
+			if (TupleDescAttr(tupdesc, i)->attgenerated == ATTRIBUTE_GENERATED_STORED)
+				hazard = max_parallel_hazard_walker(build_column_default(rel, i + 1),
+													&target_context);
+		}
+	}
+
+	if (!hazard && rel->rd_rel->relispartition)
+		hazard = max_parallel_hazard_walker((Node *) RelationGetPartitionQual(rel),
+											&target_context);
+
+	if (!hazard && rel->rd_rel->relhasindex)
+	{
+		List	   *indexoidlist = RelationGetIndexList(rel);
+		ListCell   *lc;
+
+		foreach(lc, indexoidlist)
+		{
+			Relation	indexRelation = index_open(lfirst_oid(lc), AccessShareLock);
+
+			hazard = max_parallel_hazard_walker((Node *) RelationGetIndexExpressions(indexRelation),
+												&target_context) ||
+				max_parallel_hazard_walker((Node *) RelationGetIndexPredicate(indexRelation),
+										   &target_context);
+			index_close(indexRelation, NoLock);
+			if (hazard)
+				break;
+		}
+		list_free(indexoidlist);
+	}
+
+	table_close(rel, NoLock);
+
+	if (hazard)
+		return max_parallel_hazard_test(PROPARALLEL_UNSAFE, context);
+	return false;
+}
+
 /*
  * is_parallel_safe
  *		Detect whether the given expr contains only parallel-safe functions
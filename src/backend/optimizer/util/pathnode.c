@@ -2074,6 +2074,51 @@ create_gather_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
 	return pathnode;
 }
 
+/*
+ * create_redistribute_path
+ *	  Creates a path corresponding to a redistribute node, returning the
+ *	  pathnode.
+ *
+ * 'subpath' must be a partial path.  The result is a partial path whose
+ * participants each see all the rows for the hashkeys values they see at
+ * all.  'numGroups' estimates the number of distinct hashkeys values.
+ */
+RedistributePath *
+create_redistribute_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
+						 List *hashkeys, List *hashoperators,
+						 double numGroups)
+{
+	RedistributePath *pathnode = makeNode(RedistributePath);
+
+	Assert(subpath->parallel_safe && subpath->parallel_workers > 0);
+	Assert(list_length(hashkeys) == list_length(hashoperators));
+
+	pathnode->path.pathtype = T_Redistribute;
+	pathnode->path.parent = rel;
+	pathnode->path.pathtarget = subpath->pathtarget;
+	pathnode->path.param_info = subpath->param_info;
+	pathnode->path.parallel_aware = true;
+	pathnode->path.parallel_safe = rel->consider_parallel &&
+		subpath->parallel_safe;
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	pathnode->path.pathkeys = NIL;	/* partitions come back in no order */
+
+	pathnode->subpath = subpath;
+	pathnode->hashkeys = hashkeys;
+	pathnode->hashoperators = hashoperators;
+
+	/*
+	 * Participants claim partitions dynamically, so use a few per planned
+	 * participant to spread the work out even if the partitions come out
+	 * uneven.
+	 */
+	pathnode->npartitions = (subpath->parallel_workers + 1) * 4;
+
+	cost_redistribute(pathnode, root, numGroups);
+
+	return pathnode;
+}
+
 /*
  * create_subqueryscan_path
  *	  Creates a path corresponding to a scan of a subquery,
@@ -93,6 +93,7 @@ static void set_baserel_partition_constraint(Relation relation,
  *	max_attr	highest valid AttrNumber
  *	indexlist	list of IndexOptInfos for relation's indexes
  *	statlist	list of StatisticExtInfo for relation's statistic objects
+ *	fkeystatlist	likewise, for statistics on foreign key joins to it
  *	serverid	if it's a foreign table, the server OID
  *	fdwroutine	if it's a foreign table, the FDW function pointers
  *	pages		number of pages
@@ -660,6 +661,7 @@ get_relation_foreign_keys(PlannerInfo *root, RelOptInfo *rel,
 
 			/* OK, let's make an entry */
 			info = makeNode(ForeignKeyOptInfo);
+			info->conoid = cachedfk->conoid;
 			info->con_relid = rel->relid;
 			info->ref_relid = rti;
 			info->nkeys = cachedfk->nkeys;
@@ -1392,7 +1394,7 @@ get_relation_constraints(PlannerInfo *root,
 static void
 get_relation_statistics_worker(List **stainfos, RelOptInfo *rel,
 							   Oid statOid, bool inh,
-							   Bitmapset *keys, List *exprs)
+							   Bitmapset *keys, List *exprs, Oid fkey)
 {
 	Form_pg_statistic_ext_data dataForm;
 	HeapTuple	dtup;
@@ -1415,6 +1417,7 @@ get_relation_statistics_worker(List **stainfos, RelOptInfo *rel,
 		info->kind = STATS_EXT_NDISTINCT;
 		info->keys = bms_copy(keys);
 		info->exprs = exprs;
+		info->fkey = fkey;
 
 		*stainfos = lappend(*stainfos, info);
 	}
@@ -1429,6 +1432,7 @@ get_relation_statistics_worker(List **stainfos, RelOptInfo *rel,
 		info->kind = STATS_EXT_DEPENDENCIES;
 		info->keys = bms_copy(keys);
 		info->exprs = exprs;
+		info->fkey = fkey;
 
 		*stainfos = lappend(*stainfos, info);
 	}
@@ -1443,6 +1447,7 @@ get_relation_statistics_worker(List **stainfos, RelOptInfo *rel,
 		info->kind = STATS_EXT_MCV;
 		info->keys = bms_copy(keys);
 		info->exprs = exprs;
+		info->fkey = fkey;
 
 		*stainfos = lappend(*stainfos, info);
 	}
@@ -1457,6 +1462,7 @@ get_relation_statistics_worker(List **stainfos, RelOptInfo *rel,
 		info->kind = STATS_EXT_EXPRESSIONS;
 		info->keys = bms_copy(keys);
 		info->exprs = exprs;
+		info->fkey = fkey;
 
 		*stainfos = lappend(*stainfos, info);
 	}
@@ -1471,6 +1477,10 @@ get_relation_statistics_worker(List **stainfos, RelOptInfo *rel,
  * Returns a List (possibly empty) of StatisticExtInfo objects describing
  * the statistics.  Note that this doesn't load the actual statistics data,
  * just the identifying metadata.  Only stats actually built are considered.
+ *
+ * Statistics on a foreign key join to the table describe the referencing
+ * table's rows rather than this table's, so they go into rel->fkeystatlist
+ * instead, for use when estimating such a join.
  */
 static List *
 get_relation_statistics(RelOptInfo *rel, Relation relation)
@@ -1552,11 +1562,21 @@ get_relation_statistics(RelOptInfo *rel, Relation relation)
 			}
 		}
 
-		/* extract statistics for possible values of stxdinherit flag */
+		/* statistics on a join are only ever built without inheritance */
+		if (OidIsValid(staForm->stxfkey))
+			get_relation_statistics_worker(&rel->fkeystatlist, rel, statOid,
+										   false, keys, exprs,
+										   staForm->stxfkey);
+		else
+		{
+			/* extract statistics for possible values of stxdinherit flag */
 
-		get_relation_statistics_worker(&stainfos, rel, statOid, true, keys, exprs);
+			get_relation_statistics_worker(&stainfos, rel, statOid, true,
+										   keys, exprs, InvalidOid);
 
-		get_relation_statistics_worker(&stainfos, rel, statOid, false, keys, exprs);
+			get_relation_statistics_worker(&stainfos, rel, statOid, false,
+										   keys, exprs, InvalidOid);
+		}
 
 		ReleaseSysCache(htup);
 		bms_free(keys);
@@ -226,6 +226,7 @@ build_simple_rel(PlannerInfo *root, int relid, RelOptInfo *parent)
 	rel->lateral_vars = NIL;
 	rel->indexlist = NIL;
 	rel->statlist = NIL;
+	rel->fkeystatlist = NIL;
 	rel->pages = 0;
 	rel->tuples = 0;
 	rel->allvisfrac = 0;
@@ -733,6 +734,7 @@ build_join_rel(PlannerInfo *root,
 	joinrel->lateral_referencers = NULL;
 	joinrel->indexlist = NIL;
 	joinrel->statlist = NIL;
+	joinrel->fkeystatlist = NIL;
 	joinrel->pages = 0;
 	joinrel->tuples = 0;
 	joinrel->allvisfrac = 0;
@@ -1010,6 +1012,82 @@ build_child_join_rel(PlannerInfo *root, RelOptInfo *outer_rel,
 	return joinrel;
 }
 
+/*
+ * build_grouped_rel
+ *	  Build a RelOptInfo representing the rows of 'rel' after partial
+ *	  aggregation, for eager aggregation.
+ *
+ * The result has the same relids as 'rel', so that it can take part in joins
+ * just like 'rel', but it emits 'target', and is expected to produce 'rows'
+ * rows.  It is not entered into the planner's lookup structures; the caller
+ * adds paths to it.
+ */
+RelOptInfo *
+build_grouped_rel(PlannerInfo *root, RelOptInfo *rel, PathTarget *target,
+				  double rows)
+{
+	RelOptInfo *grouped_rel = makeNode(RelOptInfo);
+
+	memcpy(grouped_rel, rel, sizeof(RelOptInfo));
+
+	grouped_rel->rows = rows;
+	grouped_rel->reltarget = target;
+	grouped_rel->consider_parallel = false;
+	grouped_rel->pathlist = NIL;
+	grouped_rel->ppilist = NIL;
+	grouped_rel->partial_pathlist = NIL;
+	grouped_rel->cheapest_startup_path = NULL;
+	grouped_rel->cheapest_total_path = NULL;
+	grouped_rel->cheapest_unique_path = NULL;
+	grouped_rel->cheapest_parameterized_paths = NIL;
+	grouped_rel->unique_for_rels = NIL;
+	grouped_rel->non_unique_for_rels = NIL;
+
+	/*
+	 * An FDW or a partitionwise join would join the underlying rows rather
+	 * than the aggregated ones.
+	 */
+	grouped_rel->serverid = InvalidOid;
+	grouped_rel->fdwroutine = NULL;
+	grouped_rel->fdw_private = NULL;
+	grouped_rel->consider_partitionwise_join = false;
+	grouped_rel->part_scheme = NULL;
+
+	return grouped_rel;
+}
+
+/*
+ * build_grouped_join_rel
+ *	  Build a RelOptInfo for the join of 'outer_rel' and 'inner_rel', where
+ *	  one or both have been partially aggregated, emitting 'target'.
+ *
+ * 'joinrel' is the regular join relation with the same relids, which supplies
+ * everything but the target and the size estimate.  The restrictlist that
+ * goes with the join is returned in *restrictlist_ptr.
+ */
+RelOptInfo *
+build_grouped_join_rel(PlannerInfo *root,
+					   RelOptInfo *joinrel,
+					   RelOptInfo *outer_rel,
+					   RelOptInfo *inner_rel,
+					   PathTarget *target,
+					   SpecialJoinInfo *sjinfo,
+					   List **restrictlist_ptr)
+{
+	RelOptInfo *grouped_joinrel;
+	List	   *restrictlist;
+
+	grouped_joinrel = build_grouped_rel(root, joinrel, target, 0);
+
+	restrictlist = build_joinrel_restrictlist(root, grouped_joinrel,
+											  outer_rel, inner_rel, sjinfo);
+	set_joinrel_size_estimates(root, grouped_joinrel, outer_rel, inner_rel,
+							   sjinfo, restrictlist);
+
+	*restrictlist_ptr = restrictlist;
+	return grouped_joinrel;
+}
+
 /*
  * min_join_parameterization
  *
@@ -1425,6 +1425,8 @@ expandTableLikeClause(RangeVar *heapRel, TableLikeClause *table_like_clause)
 													RelationGetRelid(childrel),
 													parent_stat_oid,
 													attmap);
+			if (stats_stmt == NULL)
+				continue;
 
 			/* Copy comment on statistics object, if requested */
 			if (table_like_clause->options & CREATE_TABLE_LIKE_COMMENTS)
@@ -1863,6 +1865,9 @@ generateClonedIndexStmt(RangeVar *heapRel, Relation source_idx,
  * heapRelid.
  *
  * Attribute numbers in expression Vars are adjusted according to attmap.
+ *
+ * Returns NULL for statistics on a foreign key join, which describe the
+ * referencing table as much as the one being copied and are not cloned.
  */
 static CreateStatsStmt *
 generateClonedExtStatsStmt(RangeVar *heapRel, Oid heapRelid,
@@ -1890,6 +1895,12 @@ generateClonedExtStatsStmt(RangeVar *heapRel, Oid heapRelid,
 		elog(ERROR, "cache lookup failed for statistics object %u", source_statsid);
 	statsrec = (Form_pg_statistic_ext) GETSTRUCT(ht_stats);
 
+	if (OidIsValid(statsrec->stxfkey))
+	{
+		ReleaseSysCache(ht_stats);
+		return NULL;
+	}
+
 	/* Determine which statistics types exist */
 	datum = SysCacheGetAttrNotNull(STATEXTOID, ht_stats,
 								   Anum_pg_statistic_ext_stxkind);
@@ -2962,7 +2973,9 @@ transformIndexStmt(Oid relid, IndexStmt *stmt, const char *queryString)
  *
  * To avoid race conditions, it's important that this function relies only on
  * the passed-in relid (and not on stmt->relation) to determine the target
- * relation.
+ * relation.  Statistics on a join are the exception: both tables are looked
+ * up here, and CreateStatistics() works out from the join condition which
+ * one is the target.
  */
 CreateStatsStmt *
 transformStatsStmt(Oid relid, CreateStatsStmt *stmt, const char *queryString)
@@ -2971,6 +2984,8 @@ transformStatsStmt(Oid relid, CreateStatsStmt *stmt, const char *queryString)
 	ParseNamespaceItem *nsitem;
 	ListCell   *l;
 	Relation	rel;
+	Relation	joinrel = NULL;
+	JoinExpr   *join = NULL;
 
 	/* Nothing to do if statement already transformed. */
 	if (stmt->transformed)
@@ -2980,18 +2995,66 @@ transformStatsStmt(Oid relid, CreateStatsStmt *stmt, const char *queryString)
 	pstate = make_parsestate(NULL);
 	pstate->p_sourcetext = queryString;
 
-	/*
-	 * Put the parent table into the rtable so that the expressions can refer
-	 * to its fields without qualification.  Caller is responsible for locking
-	 * relation, but we still need to open it.
-	 */
-	rel = relation_open(relid, NoLock);
-	nsitem = addRangeTableEntryForRelation(pstate, rel,
-										   AccessShareLock,
-										   NULL, false, true);
+	if (list_length(stmt->relations) == 1 &&
+		IsA(linitial(stmt->relations), JoinExpr))
+		join = (JoinExpr *) linitial(stmt->relations);
 
-	/* no to join list, yes to namespaces */
-	addNSItemToQuery(pstate, nsitem, false, true, true);
+	if (join == NULL)
+	{
+		/*
+		 * Put the parent table into the rtable so that the expressions can
+		 * refer to its fields without qualification.  Caller is responsible
+		 * for locking relation, but we still need to open it.
+		 */
+		rel = relation_open(relid, NoLock);
+		nsitem = addRangeTableEntryForRelation(pstate, rel,
+											   AccessShareLock,
+											   NULL, false, true);
+
+		/* no to join list, yes to namespaces */
+		addNSItemToQuery(pstate, nsitem, false, true, true);
+	}
+	else
+	{
+		ParseNamespaceItem *joinnsitem;
+
+		if (join->jointype != JOIN_INNER || join->isNatural ||
+			join->usingClause != NIL || join->quals == NULL ||
+			!IsA(join->larg, RangeVar) || !IsA(join->rarg, RangeVar))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("only an inner join of two tables with an ON condition is allowed in CREATE STATISTICS")));
+
+		/*
+		 * Put both tables into the rtable, in the order they're written,
+		 * which is what CreateStatistics() expects the varnos of the join
+		 * condition and of any columns written as "(table.column)" to follow.
+		 */
+		rel = relation_open(RangeVarGetRelid((RangeVar *) join->larg,
+											 ShareUpdateExclusiveLock,
+											 false),
+							NoLock);
+		nsitem = addRangeTableEntryForRelation(pstate, rel,
+											   AccessShareLock,
+											   ((RangeVar *) join->larg)->alias,
+											   false, true);
+		joinrel = relation_open(RangeVarGetRelid((RangeVar *) join->rarg,
+												 ShareUpdateExclusiveLock,
+												 false),
+								NoLock);
+		joinnsitem = addRangeTableEntryForRelation(pstate, joinrel,
+												   AccessShareLock,
+												   ((RangeVar *) join->rarg)->alias,
+												   false, true);
+
+		checkNameSpaceConflicts(pstate, list_make1(nsitem),
+								list_make1(joinnsitem));
+		addNSItemToQuery(pstate, nsitem, false, true, true);
+		addNSItemToQuery(pstate, joinnsitem, false, true, true);
+
+		join->quals = transformWhereClause(pstate, join->quals,
+										   EXPR_KIND_JOIN_ON, "JOIN/ON");
+	}
 
 	/* take care of any expressions */
 	foreach(l, stmt->exprs)
@@ -3013,15 +3076,17 @@ transformStatsStmt(Oid relid, CreateStatsStmt *stmt, const char *queryString)
 	 * Check that only the base rel is mentioned.  (This should be dead code
 	 * now that add_missing_from is history.)
 	 */
-	if (list_length(pstate->p_rtable) != 1)
+	if (list_length(pstate->p_rtable) != (join ? 2 : 1))
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
 				 errmsg("statistics expressions can refer only to the table being referenced")));
 
 	free_parsestate(pstate);
 
-	/* Close relation */
+	/* Close relations */
 	table_close(rel, NoLock);
+	if (joinrel)
+		table_close(joinrel, NoLock);
 
 	/* Mark statement as successfully transformed */
 	stmt->transformed = true;
@@ -0,0 +1,2170 @@
+/*-------------------------------------------------------------------------
+ *
+ * connproxy.c
+ *	  Connection proxies: multiplexing client sessions onto pooled backends
+ *
+ * When connection_proxies is set, the postmaster starts that many proxy
+ * processes as background workers.  Each accepts client connections on
+ * proxy_port, using SO_REUSEPORT to let the kernel spread TCP connections
+ * over all of them; Unix-domain sockets cannot be shared that way, so only
+ * the first proxy listens on those.  A proxy handles all its clients in a
+ * single event loop, so an idle client costs it a socket and a few buffers
+ * rather than a whole backend.
+ *
+ * Clients are authenticated by the server, not by the proxy: for every new
+ * client the proxy opens a connection to the server with the client's own
+ * startup packet, and relays messages between the two until the backend
+ * reports ReadyForQuery (or fails).  The proxy adds a "proxy_client" option
+ * carrying a secret only the postmaster's children know, along with the
+ * client's address, so that the backend applies pg_hba.conf to the real
+ * client.  Once authenticated, the client belongs to a session pool, keyed
+ * by its startup packet (user, database and any other options), and the
+ * backend that authenticated it joins the pool if the pool has room.
+ *
+ * Clients borrow a backend from their pool at the start of each
+ * transaction and give it back when the backend reports being idle outside
+ * a transaction block.  We track that by counting the messages that each
+ * produce a ReadyForQuery (Query, FunctionCall and Sync); extended-query
+ * messages not yet followed by a Sync also keep the backend attached.  If a
+ * pool needs more backends, the proxy opens them itself, marking them as
+ * pre-authenticated; a pool only exists once some client has authenticated
+ * for it.
+ *
+ * A session that leaves state behind in its backend (temporary tables,
+ * prepared statements, held cursors, LISTEN, session advisory locks or
+ * SET parameters) must keep that backend.  The backend notices this when it
+ * goes idle and tells the proxy with a ParameterStatus message, which the
+ * proxy swallows; from then on client and backend stay together, outside
+ * the pool, until the client disconnects.
+ *
+ * Query cancellation works by handing each client a cancel key made up by
+ * the proxy, whose process ID part identifies the proxy.  A proxy that
+ * receives a cancel request for another proxy's client passes it on
+ * through shared memory.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/connproxy.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "catalog/namespace.h"
+#include "commands/async.h"
+#include "commands/prepare.h"
+#include "common/ip.h"
+#include "funcapi.h"
+#include "lib/ilist.h"
+#include "libpq/libpq.h"
+#include "libpq/pqcomm.h"
+#include "libpq/pqformat.h"
+#include "libpq/protocol.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_bswap.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/connproxy.h"
+#include "postmaster/interrupt.h"
+#include "postmaster/postmaster.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/portal.h"
+#include "utils/varlena.h"
+
+/* GUC parameters */
+int			connection_proxies = 0;
+int			proxy_port = 6543;
+int			session_pool_size = 10;
+
+char		ConnProxySecret[CONN_PROXY_SECRET_LEN + 1];
+
+#define PROXY_RECV_SIZE			8192
+#define PROXY_MAX_PENDING		(1024 * 1024)	/* stop reading a peer whose
+												 * output exceeds this */
+#define PROXY_BUFFER_KEEP		(64 * 1024) /* shrink idle buffers above
+											 * this */
+#define PROXY_MAX_LISTEN		64
+#define PROXY_MAX_EVENTS		64
+#define PROXY_MAX_CANCELS		16
+
+/*
+ * Cancel keys handed to clients use the low bits of the process ID for a
+ * client counter and the high bits for the proxy number plus one.
+ */
+#define PROXY_CLIENT_ID_BITS	22
+#define PROXY_CLIENT_ID_MASK	((1 << PROXY_CLIENT_ID_BITS) - 1)
+
+/* Per-proxy shared state: statistics and a mailbox for cancel requests */
+typedef struct ConnProxySlot
+{
+	slock_t		mutex;
+	pid_t		pid;
+	Latch	   *latch;
+	int			clients;
+	int			pinned_clients;
+	int			waiting_clients;
+	int			backends;
+	int			idle_backends;
+	int64		transactions;
+	int			ncancels;
+	struct
+	{
+		uint32		pid;
+		uint32		key;
+	}			cancels[PROXY_MAX_CANCELS];
+} ConnProxySlot;
+
+typedef struct ConnProxyCtlData
+{
+	int			nproxies;
+	ConnProxySlot slots[FLEXIBLE_ARRAY_MEMBER];
+} ConnProxyCtlData;
+
+static ConnProxyCtlData *ConnProxyCtl = NULL;
+
+typedef enum ProxyChannelKind
+{
+	PROXY_CLIENT,
+	PROXY_BACKEND,
+} ProxyChannelKind;
+
+typedef enum ProxyClientState
+{
+	CLIENT_STARTUP,				/* waiting for the startup packet */
+	CLIENT_AUTH,				/* authenticating through a backend */
+	CLIENT_IDLE,				/* between transactions, no backend */
+	CLIENT_WAITING,				/* queued for a backend */
+	CLIENT_ACTIVE,				/* attached to a backend */
+	CLIENT_CLOSING,				/* flushing output before closing */
+} ProxyClientState;
+
+typedef enum ProxyBackendState
+{
+	BACKEND_AUTH,				/* authenticating a new client */
+	BACKEND_STARTUP,			/* starting up to join a pool */
+	BACKEND_IDLE,				/* in its pool's idle list */
+	BACKEND_ACTIVE,				/* attached to a client */
+	BACKEND_CLOSING,			/* flushing output before closing */
+} ProxyBackendState;
+
+struct ProxyPool;
+
+/*
+ * A socket, either to a client or to a backend.  outbuf.cursor is the
+ * amount of outbuf already sent, inbuf.cursor the amount of inbuf already
+ * processed.
+ */
+typedef struct ProxyChannel
+{
+	ProxyChannelKind kind;
+	pgsocket	sock;
+	int			event_pos;		/* position in wait event set, or -1 */
+	uint32		events;			/* events we're waiting for */
+	bool		closing;		/* close once outbuf is sent */
+	bool		dead;			/* to be closed by proxy_reap() */
+	StringInfoData inbuf;
+	StringInfoData outbuf;
+	struct ProxyChannel *peer;	/* client's backend or backend's client */
+	struct ProxyPool *pool;
+	dlist_node	node;			/* in ProxyChannels */
+	dlist_node	pool_node;		/* in pool's idle or waiting list */
+	dlist_node	dead_node;		/* in ProxyDeadChannels */
+
+	/* client fields */
+	ProxyClientState cstate;
+	char	   *startup;		/* startup packet, until authenticated */
+	int			startup_len;
+	uint32		cancel_pid;		/* cancel key we gave the client */
+	uint32		cancel_key;
+	char		host[NI_MAXHOST];
+	char		port[NI_MAXSERV];
+
+	/* backend fields */
+	ProxyBackendState bstate;
+	uint32		backend_pid;	/* cancel key the backend gave us */
+	uint32		backend_key;
+	int			pending;		/* requests not yet answered by
+								 * ReadyForQuery */
+	bool		unsynced;		/* extended-query messages sent since the
+								 * last Sync */
+	char		txn_status;		/* from the last ReadyForQuery */
+	bool		error_reported; /* startup failure passed to a client */
+
+	/* both */
+	bool		pinned;			/* client and backend stay together */
+} ProxyChannel;
+
+/*
+ * A session pool: backends serving clients with the same startup packet.
+ * nbackends counts the pool's backends that are starting, idle or lent to
+ * a client, but not those pinned to a client.
+ */
+typedef struct ProxyPool
+{
+	char	   *key;
+	int			keylen;
+	int			nclients;
+	int			nbackends;
+	int			nstarting;
+	int			nwaiting;
+	dlist_head	idle_backends;
+	dlist_head	waiting_clients;
+	dlist_node	node;
+} ProxyPool;
+
+static int	ProxyIndex;
+static ConnProxySlot *MyProxySlot;
+
+static pgsocket ListenSockets[PROXY_MAX_LISTEN];
+static int	NumListenSockets = 0;
+static SockAddr ServerAddr;
+
+static WaitEventSet *ProxyWaitSet = NULL;
+static ProxyChannel **ProxyEventChannels = NULL;	/* by event position */
+static int	ProxyWaitSetSize = 0;
+static int	ProxyWaitSetUsed = 0;
+static int	ProxyDeadEvents = 0;
+static bool ProxyRebuildWaitSet = true;
+static uint32 ProxyBaseEvents;
+
+static dlist_head ProxyChannels = DLIST_STATIC_INIT(ProxyChannels);
+static dlist_head ProxyDeadChannels = DLIST_STATIC_INIT(ProxyDeadChannels);
+static dlist_head ProxyPools = DLIST_STATIC_INIT(ProxyPools);
+static int	NumChannels = 0;
+
+/* statistics, copied to shared memory once per loop */
+static int	ProxyClients = 0;
+static int	ProxyPinnedClients = 0;
+static int	ProxyWaitingClients = 0;
+static int	ProxyBackends = 0;
+static int	ProxyIdleBackends = 0;
+static int64 ProxyTransactions = 0;
+
+static uint32 ProxyNextClientId = 0;
+
+static void proxy_shmem_exit(int code, Datum arg);
+static void proxy_unlink_socket(int code, Datum arg);
+static void proxy_listen(void);
+static void proxy_listen_on(const char *host, const char *service,
+							int family);
+static void proxy_init_server_address(void);
+static pgsocket proxy_connect_server(void);
+static void proxy_rebuild_wait_set(void);
+static void proxy_add_event(ProxyChannel *chan);
+static void proxy_update_events(ProxyChannel *chan);
+static void proxy_publish_stats(void);
+static void proxy_accept(pgsocket lsock);
+static ProxyChannel *proxy_new_channel(ProxyChannelKind kind, pgsocket sock);
+static void proxy_read(ProxyChannel *chan);
+static void proxy_flush(ProxyChannel *chan);
+static void proxy_consume_input(StringInfo in);
+static void proxy_kill(ProxyChannel *chan);
+static void proxy_close_after_flush(ProxyChannel *chan);
+static void proxy_disconnect(ProxyChannel *chan);
+static void proxy_reap(void);
+static int	proxy_next_message(StringInfo in, char *msgtype);
+static void proxy_put_message(ProxyChannel *chan, char msgtype,
+							  const char *data, int len);
+static void proxy_fail(ProxyChannel *client, const char *sqlstate,
+					   const char *msg);
+static void proxy_client_process(ProxyChannel *client);
+static void proxy_client_startup(ProxyChannel *client);
+static void proxy_client_startup_packet(ProxyChannel *client,
+										const char *body, int len);
+static void proxy_client_messages(ProxyChannel *client);
+static void proxy_backend_messages(ProxyChannel *backend);
+static void proxy_auth_done(ProxyChannel *backend);
+static ProxyChannel *proxy_open_backend(const char *params, int len,
+										bool trusted, ProxyChannel *client);
+static void proxy_link(ProxyChannel *client, ProxyChannel *backend);
+static void proxy_release(ProxyChannel *backend);
+static void proxy_terminate(ProxyChannel *backend);
+static void proxy_pin(ProxyChannel *backend);
+static ProxyPool *proxy_get_pool(const char *key, int keylen);
+static void proxy_pool_service(ProxyPool *pool);
+static ProxyChannel *proxy_pop_waiting(ProxyPool *pool);
+static void proxy_route_cancel(uint32 pid, uint32 key);
+static void proxy_process_cancels(void);
+static void proxy_cancel(uint32 pid, uint32 key);
+
+
+/*
+ * Report shared-memory space needed by ConnProxyShmemInit
+ */
+Size
+ConnProxyShmemSize(void)
+{
+	return add_size(offsetof(ConnProxyCtlData, slots),
+					mul_size(connection_proxies, sizeof(ConnProxySlot)));
+}
+
+/*
+ * Allocate and initialize connection proxy shared memory
+ */
+void
+ConnProxyShmemInit(void)
+{
+	bool		found;
+
+	ConnProxyCtl = (ConnProxyCtlData *)
+		ShmemInitStruct("Connection Proxy Data", ConnProxyShmemSize(), &found);
+
+	if (!found)
+	{
+		memset(ConnProxyCtl, 0, ConnProxyShmemSize());
+		ConnProxyCtl->nproxies = connection_proxies;
+		for (int i = 0; i < connection_proxies; i++)
+			SpinLockInit(&ConnProxyCtl->slots[i].mutex);
+	}
+}
+
+/*
+ * ConnProxyRegister
+ *		Register the connection proxy background workers, and make up the
+ *		secret they will use to identify themselves to the server.
+ */
+void
+ConnProxyRegister(void)
+{
+	BackgroundWorker bgw;
+	uint8		secret[CONN_PROXY_SECRET_LEN / 2];
+
+	if (connection_proxies == 0 || IsBinaryUpgrade)
+		return;
+
+	if (!pg_strong_random(secret, sizeof(secret)))
+		ereport(FATAL,
+				(errmsg("could not generate secret for connection proxies")));
+	hex_encode((const char *) secret, sizeof(secret), ConnProxySecret);
+	ConnProxySecret[CONN_PROXY_SECRET_LEN] = '\0';
+
+	for (int i = 0; i < connection_proxies; i++)
+	{
+		memset(&bgw, 0, sizeof(bgw));
+		bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		bgw.bgw_start_time = BgWorkerStart_ConsistentState;
+		snprintf(bgw.bgw_library_name, MAXPGPATH, "postgres");
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ConnProxyMain");
+		snprintf(bgw.bgw_name, BGW_MAXLEN, "connection proxy %d", i);
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "connection proxy");
+		bgw.bgw_restart_time = 5;
+		bgw.bgw_notify_pid = 0;
+		bgw.bgw_main_arg = Int32GetDatum(i);
+
+		RegisterBackgroundWorker(&bgw);
+	}
+}
+
+/*
+ * ProcessProxyClientOption
+ *		Handle the "proxy_client" startup packet option.
+ *
+ * The value is "SECRET MODE [HOST PORT]", where MODE is "auth" for a
+ * connection that authenticates a client as usual, or "pool" for one the
+ * proxy opens on its own to serve already-authenticated clients.  HOST and
+ * PORT give the client's address, and are absent for clients that used a
+ * Unix-domain socket.
+ */
+void
+ProcessProxyClientOption(Port *port, const char *value)
+{
+	char	   *buf = pstrdup(value);
+	char	   *saveptr;
+	char	   *secret;
+	char	   *mode;
+	char	   *host;
+	char	   *service;
+	int			diff = 0;
+
+	/* Compare in constant time, so as not to give the secret away */
+	secret = strtok_r(buf, " ", &saveptr);
+	if (secret != NULL && strlen(secret) == CONN_PROXY_SECRET_LEN)
+	{
+		for (int i = 0; i < CONN_PROXY_SECRET_LEN; i++)
+			diff |= secret[i] ^ ConnProxySecret[i];
+	}
+	else
+		diff = 1;
+	if (ConnProxySecret[0] == '\0' || diff != 0)
+		ereport(FATAL,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid value for parameter \"%s\"",
+						CONN_PROXY_OPTION)));
+
+	mode = strtok_r(NULL, " ", &saveptr);
+	if (mode != NULL && strcmp(mode, "pool") == 0)
+		port->proxy_trusted = true;
+	else if (mode == NULL || strcmp(mode, "auth") != 0)
+		ereport(FATAL,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid value for parameter \"%s\"",
+						CONN_PROXY_OPTION)));
+
+	host = strtok_r(NULL, " ", &saveptr);
+	service = strtok_r(NULL, " ", &saveptr);
+	if (host != NULL)
+	{
+		struct addrinfo hint;
+		struct addrinfo *addrs = NULL;
+		int			ret;
+
+		memset(&hint, 0, sizeof(hint));
+		hint.ai_family = AF_UNSPEC;
+		hint.ai_socktype = SOCK_STREAM;
+		hint.ai_flags = AI_NUMERICHOST;
+
+		ret = pg_getaddrinfo_all(host, service, &hint, &addrs);
+		if (ret != 0 || addrs == NULL ||
+			addrs->ai_addrlen > sizeof(port->raddr.addr))
+			ereport(FATAL,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("invalid client address \"%s\" in parameter \"%s\"",
+							host, CONN_PROXY_OPTION)));
+
+		memcpy(&port->raddr.addr, addrs->ai_addr, addrs->ai_addrlen);
+		port->raddr.salen = addrs->ai_addrlen;
+		pg_freeaddrinfo_all(hint.ai_family, addrs);
+	}
+
+	port->proxied = true;
+	pfree(buf);
+}
+
+/*
+ * ConnProxyCheckSessionState
+ *		Called by a backend serving a connection proxy whenever it is about
+ *		to report being idle outside a transaction block.
+ *
+ * If the session now has state that would be lost, or leak to another
+ * client, were the proxy to give this backend to someone else, tell the
+ * proxy to keep client and backend together.  That lasts for the rest of
+ * the session, so we only need to say it once.
+ */
+void
+ConnProxyCheckSessionState(void)
+{
+	static bool pinned = false;
+	Oid			tempNamespaceId;
+	Oid			tempToastNamespaceId;
+	StringInfoData buf;
+
+	if (pinned)
+		return;
+
+	GetTempNamespaceState(&tempNamespaceId, &tempToastNamespaceId);
+
+	if (!OidIsValid(tempNamespaceId) &&
+		!HavePreparedStatements() &&
+		!ThereAreHeldPortals() &&
+		!Async_IsListening() &&
+		!LockHeldBySession(USER_LOCKMETHOD) &&
+		!HaveSessionOptions())
+		return;
+
+	pinned = true;
+
+	pq_beginmessage(&buf, PqMsg_ParameterStatus);
+	pq_sendstring(&buf, CONN_PROXY_PINNED_PARAM);
+	pq_sendstring(&buf, "on");
+	pq_endmessage(&buf);
+}
+
+/*
+ * Main entry point for a connection proxy process
+ */
+void
+ConnProxyMain(Datum main_arg)
+{
+	WaitEvent	events[PROXY_MAX_EVENTS];
+
+	ProxyIndex = DatumGetInt32(main_arg);
+
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, SignalHandlerForShutdownRequest);
+	BackgroundWorkerUnblockSignals();
+
+	Assert(ProxyIndex >= 0 && ProxyIndex < ConnProxyCtl->nproxies);
+	MyProxySlot = &ConnProxyCtl->slots[ProxyIndex];
+	SpinLockAcquire(&MyProxySlot->mutex);
+	MyProxySlot->pid = MyProcPid;
+	MyProxySlot->latch = MyLatch;
+	MyProxySlot->ncancels = 0;
+	SpinLockRelease(&MyProxySlot->mutex);
+	on_shmem_exit(proxy_shmem_exit, (Datum) 0);
+
+	/* All our data lives as long as the process */
+	MemoryContextSwitchTo(AllocSetContextCreate(TopMemoryContext,
+												"Connection proxy",
+												ALLOCSET_DEFAULT_SIZES));
+
+	/*
+	 * Where the kernel can tell us about sockets closed by the other end, we
+	 * can stop reading from a channel whose peer is not keeping up without
+	 * missing its disconnection.
+	 */
+	ProxyBaseEvents = WaitEventSetCanReportClosed() ?
+		WL_SOCKET_CLOSED : WL_SOCKET_READABLE;
+
+	proxy_init_server_address();
+	proxy_listen();
+	if (NumListenSockets == 0)
+	{
+		/* Nothing to do, and no point in restarting */
+		ereport(LOG,
+				(errmsg("connection proxy %d has no socket to listen on",
+						ProxyIndex)));
+		proc_exit(0);
+	}
+
+	for (;;)
+	{
+		int			nevents;
+		bool		any_live = false;
+
+		if (ShutdownRequestPending)
+			proc_exit(1);
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		/* Compact the event set if closed sockets dominate it */
+		if (ProxyDeadEvents > NumChannels + PROXY_MAX_EVENTS)
+			ProxyRebuildWaitSet = true;
+		if (ProxyRebuildWaitSet)
+			proxy_rebuild_wait_set();
+
+		proxy_publish_stats();
+
+		nevents = WaitEventSetWait(ProxyWaitSet, -1, events, lengthof(events),
+								   WAIT_EVENT_CONNECTION_PROXY_MAIN);
+
+		for (int i = 0; i < nevents; i++)
+		{
+			WaitEvent  *event = &events[i];
+			ProxyChannel *chan;
+
+			if (event->events & WL_LATCH_SET)
+			{
+				ResetLatch(MyLatch);
+				proxy_process_cancels();
+				any_live = true;
+				continue;
+			}
+
+			if (event->pos < 2 + NumListenSockets)
+			{
+				proxy_accept(event->fd);
+				any_live = true;
+				continue;
+			}
+
+			/*
+			 * Sockets we have closed are still in the event set.  Some
+			 * implementations keep reporting them, in which case we had
+			 * better rebuild the set.
+			 */
+			chan = ProxyEventChannels[event->pos];
+			if (chan == NULL)
+				continue;
+			any_live = true;
+
+			if (event->events & WL_SOCKET_WRITEABLE)
+				proxy_flush(chan);
+			if (event->events & (WL_SOCKET_READABLE | WL_SOCKET_CLOSED))
+				proxy_read(chan);
+
+			proxy_reap();
+		}
+
+		if (nevents > 0 && !any_live)
+			ProxyRebuildWaitSet = true;
+	}
+}
+
+/*
+ * Before exiting, forget our entry in shared memory
+ */
+static void
+proxy_shmem_exit(int code, Datum arg)
+{
+	SpinLockAcquire(&MyProxySlot->mutex);
+	MyProxySlot->pid = 0;
+	MyProxySlot->latch = NULL;
+	MyProxySlot->clients = 0;
+	MyProxySlot->pinned_clients = 0;
+	MyProxySlot->waiting_clients = 0;
+	MyProxySlot->backends = 0;
+	MyProxySlot->idle_backends = 0;
+	MyProxySlot->ncancels = 0;
+	SpinLockRelease(&MyProxySlot->mutex);
+}
+
+static void
+proxy_unlink_socket(int code, Datum arg)
+{
+	unlink(DatumGetCString(arg));
+}
+
+/*
+ * Open the sockets to listen on.  Failures are logged, but don't stop us
+ * from using whatever sockets we did manage to open.
+ */
+static void
+proxy_listen(void)
+{
+	char		service[32];
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+
+	snprintf(service, sizeof(service), "%d", proxy_port);
+
+	/*
+	 * Without SO_REUSEPORT, proxies can't share a TCP port, so only the first
+	 * one listens.
+	 */
+#ifndef SO_REUSEPORT
+	if (ProxyIndex == 0)
+#endif
+	{
+		rawstring = pstrdup(ListenAddresses);
+		if (!SplitGUCList(rawstring, ',', &elemlist))
+			ereport(FATAL,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid list syntax in parameter \"%s\"",
+							"listen_addresses")));
+
+		foreach(l, elemlist)
+		{
+			char	   *curhost = (char *) lfirst(l);
+
+			proxy_listen_on(strcmp(curhost, "*") == 0 ? NULL : curhost,
+							service, AF_UNSPEC);
+		}
+	}
+
+	/* Unix-domain sockets can't be shared at all */
+	if (ProxyIndex == 0)
+	{
+		rawstring = pstrdup(Unix_socket_directories);
+		if (!SplitDirectoriesString(rawstring, ',', &elemlist))
+			ereport(FATAL,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid list syntax in parameter \"%s\"",
+							"unix_socket_directories")));
+
+		foreach(l, elemlist)
+		{
+			char		path[MAXPGPATH];
+
+			UNIXSOCK_PATH(path, proxy_port, (char *) lfirst(l));
+			if (strlen(path) >= UNIXSOCK_PATH_BUFLEN)
+			{
+				ereport(LOG,
+						(errmsg("Unix-domain socket path \"%s\" is too long (maximum %d bytes)",
+								path, (int) (UNIXSOCK_PATH_BUFLEN - 1))));
+				continue;
+			}
+			proxy_listen_on(NULL, path, AF_UNIX);
+		}
+	}
+}
+
+/*
+ * Listen on one host name (NULL for all addresses) or Unix-domain socket
+ * path
+ */
+static void
+proxy_listen_on(const char *host, const char *service, int family)
+{
+	struct addrinfo hint;
+	struct addrinfo *addrs = NULL;
+	struct addrinfo *addr;
+	int			ret;
+
+	memset(&hint, 0, sizeof(hint));
+	hint.ai_family = family;
+	hint.ai_flags = AI_PASSIVE;
+	hint.ai_socktype = SOCK_STREAM;
+
+	ret = pg_getaddrinfo_all(host, service, &hint, &addrs);
+	if (ret || !addrs)
+	{
+		ereport(LOG,
+				(errmsg("could not translate %s \"%s\" for connection proxy: %s",
+						family == AF_UNIX ? "socket path" : "host name",
+						family == AF_UNIX ? service : (host ? host : "*"),
+						gai_strerror(ret))));
+		if (addrs)
+			pg_freeaddrinfo_all(hint.ai_family, addrs);
+		return;
+	}
+
+	for (addr = addrs; addr; addr = addr->ai_next)
+	{
+		pgsocket	fd;
+		int			one = 1;
+
+		if (family != AF_UNIX && addr->ai_family == AF_UNIX)
+			continue;
+		if (NumListenSockets >= PROXY_MAX_LISTEN)
+			break;
+
+		if (addr->ai_family == AF_UNIX && service[0] != '@')
+		{
+			pgsocket	probe;
+
+			/*
+			 * Remove a stale socket file, but not one somebody is still
+			 * listening on.
+			 */
+			probe = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (probe != PGINVALID_SOCKET &&
+				connect(probe, addr->ai_addr, addr->ai_addrlen) == 0)
+			{
+				closesocket(probe);
+				ereport(LOG,
+						(errmsg("could not create connection proxy socket \"%s\": another server is listening on it",
+								service)));
+				continue;
+			}
+			if (probe != PGINVALID_SOCKET)
+				closesocket(probe);
+			unlink(service);
+		}
+
+		if ((fd = socket(addr->ai_family, SOCK_STREAM, 0)) == PGINVALID_SOCKET)
+		{
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not create socket for connection proxy: %m")));
+			continue;
+		}
+
+		if (addr->ai_family != AF_UNIX)
+		{
+			(void) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+							  (char *) &one, sizeof(one));
+#ifdef SO_REUSEPORT
+			if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+						   (char *) &one, sizeof(one)) == -1)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("%s(%s) failed: %m", "setsockopt", "SO_REUSEPORT")));
+#endif
+#ifdef IPV6_V6ONLY
+			if (addr->ai_family == AF_INET6)
+				(void) setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY,
+								  (char *) &one, sizeof(one));
+#endif
+		}
+
+		if (bind(fd, addr->ai_addr, addr->ai_addrlen) < 0 ||
+			listen(fd, MaxConnections * 2) < 0 ||
+			!pg_set_noblock(fd))
+		{
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not listen on connection proxy socket \"%s\" port %s: %m",
+							host ? host : "*", service)));
+			closesocket(fd);
+			continue;
+		}
+
+		if (addr->ai_family == AF_UNIX && service[0] != '@')
+		{
+			(void) chmod(service, Unix_socket_permissions);
+			on_proc_exit(proxy_unlink_socket,
+						 CStringGetDatum(MemoryContextStrdup(TopMemoryContext,
+															 service)));
+		}
+
+		ListenSockets[NumListenSockets++] = fd;
+	}
+
+	pg_freeaddrinfo_all(hint.ai_family, addrs);
+}
+
+/*
+ * Work out how to reach the server ourselves: through the first Unix-domain
+ * socket if there is one, or else through TCP on localhost.
+ */
+static void
+proxy_init_server_address(void)
+{
+	struct addrinfo hint;
+	struct addrinfo *addrs = NULL;
+	char	   *rawstring;
+	List	   *elemlist;
+	char		path[MAXPGPATH];
+	char		service[32];
+	int			ret;
+
+	memset(&hint, 0, sizeof(hint));
+	hint.ai_socktype = SOCK_STREAM;
+
+	rawstring = pstrdup(Unix_socket_directories);
+	if (SplitDirectoriesString(rawstring, ',', &elemlist) && elemlist != NIL)
+	{
+		UNIXSOCK_PATH(path, PostPortNumber, (char *) linitial(elemlist));
+		hint.ai_family = AF_UNIX;
+		ret = pg_getaddrinfo_all(NULL, path, &hint, &addrs);
+	}
+	else
+	{
+		snprintf(service, sizeof(service), "%d", PostPortNumber);
+		hint.ai_family = AF_UNSPEC;
+		ret = pg_getaddrinfo_all("localhost", service, &hint, &addrs);
+	}
+
+	if (ret || !addrs || addrs->ai_addrlen > sizeof(ServerAddr.addr))
+		ereport(FATAL,
+				(errmsg("could not determine server address for connection proxy: %s",
+						gai_strerror(ret))));
+
+	memcpy(&ServerAddr.addr, addrs->ai_addr, addrs->ai_addrlen);
+	ServerAddr.salen = addrs->ai_addrlen;
+	pg_freeaddrinfo_all(hint.ai_family, addrs);
+}
+
+/*
+ * Open a non-blocking connection to the server.  The connection is local,
+ * so we don't bother to connect asynchronously.
+ */
+static pgsocket
+proxy_connect_server(void)
+{
+	pgsocket	sock;
+
+	sock = socket(ServerAddr.addr.ss_family, SOCK_STREAM, 0);
+	if (sock == PGINVALID_SOCKET)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket for connection proxy: %m")));
+		return PGINVALID_SOCKET;
+	}
+
+	if (connect(sock, (struct sockaddr *) &ServerAddr.addr,
+				ServerAddr.salen) < 0 ||
+		!pg_set_noblock(sock))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("connection proxy could not connect to server: %m")));
+		closesocket(sock);
+		return PGINVALID_SOCKET;
+	}
+
+	if (ServerAddr.addr.ss_family != AF_UNIX)
+	{
+		int			on = 1;
+
+		(void) setsockopt(sock, IPPROTO_TCP, TCP_NODELAY,
+						  (char *) &on, sizeof(on));
+	}
+
+	return sock;
+}
+
+/*
+ * (Re)create the wait event set from scratch, with room to add channels.
+ *
+ * There is no way to remove a socket from a WaitEventSet, so the positions
+ * of closed channels stay in the set until we rebuild it.
+ */
+static void
+proxy_rebuild_wait_set(void)
+{
+	dlist_iter	iter;
+	int			size;
+
+	if (ProxyWaitSet)
+		FreeWaitEventSet(ProxyWaitSet);
+	if (ProxyEventChannels)
+		pfree(ProxyEventChannels);
+
+	size = 2 + NumListenSockets + Max(2 * NumChannels, 256);
+	ProxyWaitSet = CreateWaitEventSet(NULL, size);
+	ProxyEventChannels = palloc0(size * sizeof(ProxyChannel *));
+	ProxyWaitSetSize = size;
+
+	AddWaitEventToSet(ProxyWaitSet, WL_LATCH_SET, PGINVALID_SOCKET,
+					  MyLatch, NULL);
+	AddWaitEventToSet(ProxyWaitSet, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET,
+					  NULL, NULL);
+	for (int i = 0; i < NumListenSockets; i++)
+		AddWaitEventToSet(ProxyWaitSet, WL_SOCKET_ACCEPT, ListenSockets[i],
+						  NULL, NULL);
+
+	ProxyWaitSetUsed = 2 + NumListenSockets;
+	ProxyDeadEvents = 0;
+	ProxyRebuildWaitSet = false;
+
+	dlist_foreach(iter, &ProxyChannels)
+	{
+		ProxyChannel *chan = dlist_container(ProxyChannel, node, iter.cur);
+
+		chan->event_pos = -1;
+		proxy_add_event(chan);
+	}
+}
+
+static void
+proxy_add_event(ProxyChannel *chan)
+{
+	if (ProxyRebuildWaitSet)
+		return;					/* the rebuild will add it */
+
+	if (ProxyWaitSetUsed >= ProxyWaitSetSize)
+	{
+		ProxyRebuildWaitSet = true;
+		return;
+	}
+
+	chan->event_pos = AddWaitEventToSet(ProxyWaitSet, chan->events,
+										chan->sock, NULL, NULL);
+	ProxyEventChannels[chan->event_pos] = chan;
+	ProxyWaitSetUsed++;
+}
+
+/*
+ * Wait for output to drain if there is any, and for input unless our peer
+ * has more than enough of our output queued up already.
+ */
+static void
+proxy_update_events(ProxyChannel *chan)
+{
+	uint32		events = ProxyBaseEvents;
+
+	if (chan->dead)
+		return;
+
+	if (chan->outbuf.cursor < chan->outbuf.len)
+		events |= WL_SOCKET_WRITEABLE;
+	if (!chan->closing &&
+		(chan->peer == NULL ||
+		 chan->peer->outbuf.len - chan->peer->outbuf.cursor < PROXY_MAX_PENDING))
+		events |= WL_SOCKET_READABLE;
+
+	if (events != chan->events)
+	{
+		chan->events = events;
+		if (chan->event_pos >= 0)
+			ModifyWaitEvent(ProxyWaitSet, chan->event_pos, events, NULL);
+	}
+}
+
+static void
+proxy_publish_stats(void)
+{
+	SpinLockAcquire(&MyProxySlot->mutex);
+	MyProxySlot->clients = ProxyClients;
+	MyProxySlot->pinned_clients = ProxyPinnedClients;
+	MyProxySlot->waiting_clients = ProxyWaitingClients;
+	MyProxySlot->backends = ProxyBackends;
+	MyProxySlot->idle_backends = ProxyIdleBackends;
+	MyProxySlot->transactions = ProxyTransactions;
+	SpinLockRelease(&MyProxySlot->mutex);
+}
+
+/*
+ * Accept all pending connections on a listening socket
+ */
+static void
+proxy_accept(pgsocket lsock)
+{
+	for (;;)
+	{
+		struct sockaddr_storage addr;
+		socklen_t	addrlen = sizeof(addr);
+		pgsocket	sock;
+		ProxyChannel *client;
+
+		sock = accept(lsock, (struct sockaddr *) &addr, &addrlen);
+		if (sock == PGINVALID_SOCKET)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("could not accept new connection: %m")));
+			return;
+		}
+
+		if (!pg_set_noblock(sock))
+		{
+			closesocket(sock);
+			continue;
+		}
+
+		client = proxy_new_channel(PROXY_CLIENT, sock);
+		client->cstate = CLIENT_STARTUP;
+
+		if (addr.ss_family != AF_UNIX)
+		{
+			int			on = 1;
+
+			(void) setsockopt(sock, IPPROTO_TCP, TCP_NODELAY,
+							  (char *) &on, sizeof(on));
+			if (pg_getnameinfo_all(&addr, addrlen,
+								   client->host, sizeof(client->host),
+								   client->port, sizeof(client->port),
+								   NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+				client->host[0] = client->port[0] = '\0';
+		}
+	}
+}
+
+static ProxyChannel *
+proxy_new_channel(ProxyChannelKind kind, pgsocket sock)
+{
+	ProxyChannel *chan = palloc0(sizeof(ProxyChannel));
+
+	chan->kind = kind;
+	chan->sock = sock;
+	chan->event_pos = -1;
+	chan->events = ProxyBaseEvents | WL_SOCKET_READABLE;
+	chan->txn_status = 'I';
+	initStringInfo(&chan->inbuf);
+	initStringInfo(&chan->outbuf);
+
+	dlist_push_tail(&ProxyChannels, &chan->node);
+	NumChannels++;
+	if (kind == PROXY_CLIENT)
+		ProxyClients++;
+	else
+		ProxyBackends++;
+
+	proxy_add_event(chan);
+
+	return chan;
+}
+
+/*
+ * Read what's available on a socket and act on it
+ */
+static void
+proxy_read(ProxyChannel *chan)
+{
+	StringInfo	in = &chan->inbuf;
+	ssize_t		n;
+
+	if (chan->dead)
+		return;
+
+	enlargeStringInfo(in, PROXY_RECV_SIZE);
+	n = recv(chan->sock, in->data + in->len, PROXY_RECV_SIZE, 0);
+	if (n < 0)
+	{
+		if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+			proxy_kill(chan);
+		return;
+	}
+	if (n == 0)
+	{
+		proxy_kill(chan);
+		return;
+	}
+
+	in->len += n;
+	in->data[in->len] = '\0';
+
+	if (chan->closing)
+	{
+		resetStringInfo(in);
+		return;
+	}
+
+	if (chan->kind == PROXY_CLIENT)
+		proxy_client_process(chan);
+	else
+		proxy_backend_messages(chan);
+}
+
+/*
+ * Send as much queued output as the socket takes
+ */
+static void
+proxy_flush(ProxyChannel *chan)
+{
+	StringInfo	out = &chan->outbuf;
+
+	if (chan->dead)
+		return;
+
+	while (out->cursor < out->len)
+	{
+		ssize_t		n;
+
+		n = send(chan->sock, out->data + out->cursor, out->len - out->cursor, 0);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			proxy_kill(chan);
+			return;
+		}
+		out->cursor += n;
+	}
+
+	if (out->cursor == out->len)
+	{
+		if (out->maxlen > PROXY_BUFFER_KEEP)
+		{
+			pfree(out->data);
+			initStringInfo(out);
+		}
+		else
+			resetStringInfo(out);
+
+		if (chan->closing)
+		{
+			proxy_kill(chan);
+			return;
+		}
+
+		/* Our peer may have stopped reading while we were behind */
+		if (chan->peer)
+			proxy_update_events(chan->peer);
+	}
+
+	proxy_update_events(chan);
+}
+
+/*
+ * Discard the processed part of an input buffer
+ */
+static void
+proxy_consume_input(StringInfo in)
+{
+	if (in->cursor == 0)
+		return;
+
+	if (in->cursor >= in->len)
+	{
+		if (in->maxlen > PROXY_BUFFER_KEEP)
+		{
+			pfree(in->data);
+			initStringInfo(in);
+		}
+		else
+			resetStringInfo(in);
+		return;
+	}
+
+	memmove(in->data, in->data + in->cursor, in->len - in->cursor);
+	in->len -= in->cursor;
+	in->cursor = 0;
+	in->data[in->len] = '\0';
+}
+
+/*
+ * Mark a channel to be closed as soon as we're back in the main loop.
+ *
+ * Deferring the actual work keeps channels that callers further up the
+ * stack are looking at from going away underneath them.
+ */
+static void
+proxy_kill(ProxyChannel *chan)
+{
+	if (chan->dead)
+		return;
+	chan->dead = true;
+	dlist_push_tail(&ProxyDeadChannels, &chan->dead_node);
+}
+
+/*
+ * Detach a channel from everything, then close it once its output has
+ * been sent
+ */
+static void
+proxy_close_after_flush(ProxyChannel *chan)
+{
+	proxy_disconnect(chan);
+	chan->closing = true;
+	if (chan->outbuf.cursor == chan->outbuf.len)
+		proxy_kill(chan);
+	else
+		proxy_update_events(chan);
+}
+
+/*
+ * Sever a channel's ties with its pool and its peer, which might be
+ * another client's way of getting a backend.
+ */
+static void
+proxy_disconnect(ProxyChannel *chan)
+{
+	ProxyChannel *peer = chan->peer;
+
+	if (chan->kind == PROXY_CLIENT)
+	{
+		if (chan->cstate == CLIENT_CLOSING)
+			return;
+
+		if (chan->cstate == CLIENT_WAITING)
+		{
+			dlist_delete(&chan->pool_node);
+			chan->pool->nwaiting--;
+			ProxyWaitingClients--;
+		}
+		if (chan->pool)
+			chan->pool->nclients--;
+		if (chan->pinned)
+			ProxyPinnedClients--;
+
+		chan->cstate = CLIENT_CLOSING;
+		chan->peer = NULL;
+
+		if (peer && !peer->dead)
+		{
+			peer->peer = NULL;
+
+			/* A backend that is idle can serve somebody else */
+			if (peer->bstate == BACKEND_ACTIVE && !peer->pinned &&
+				peer->pending == 0 && !peer->unsynced &&
+				peer->txn_status == 'I')
+				proxy_release(peer);
+			else
+				proxy_terminate(peer);
+		}
+	}
+	else
+	{
+		ProxyPool  *pool = chan->pool;
+
+		if (chan->bstate == BACKEND_CLOSING)
+			return;
+
+		if (chan->bstate == BACKEND_IDLE)
+		{
+			dlist_delete(&chan->pool_node);
+			ProxyIdleBackends--;
+		}
+		else if (chan->bstate == BACKEND_STARTUP)
+		{
+			ProxyChannel *client;
+
+			pool->nstarting--;
+
+			/* Make sure some client hears about the failure */
+			if (!chan->error_reported &&
+				(client = proxy_pop_waiting(pool)) != NULL)
+				proxy_fail(client, "08006",
+						   "could not start a server connection for the session pool");
+		}
+
+		chan->bstate = BACKEND_CLOSING;
+		chan->peer = NULL;
+		chan->pool = NULL;
+
+		if (peer && !peer->dead)
+		{
+			/* The client has received whatever the backend last said */
+			peer->peer = NULL;
+			proxy_close_after_flush(peer);
+		}
+
+		if (pool)
+		{
+			pool->nbackends--;
+			proxy_pool_service(pool);
+		}
+	}
+}
+
+/*
+ * Close the channels marked as dead, and forget about them
+ */
+static void
+proxy_reap(void)
+{
+	while (!dlist_is_empty(&ProxyDeadChannels))
+	{
+		ProxyChannel *chan = dlist_container(ProxyChannel, dead_node,
+											 dlist_pop_head_node(&ProxyDeadChannels));
+		ProxyPool  *pool = chan->pool;
+
+		proxy_disconnect(chan);
+
+		closesocket(chan->sock);
+		if (chan->event_pos >= 0)
+		{
+			ProxyEventChannels[chan->event_pos] = NULL;
+			ProxyDeadEvents++;
+		}
+		dlist_delete(&chan->node);
+		NumChannels--;
+		if (chan->kind == PROXY_CLIENT)
+			ProxyClients--;
+		else
+			ProxyBackends--;
+
+		/* Free a client's pool when nothing is left of it */
+		if (chan->kind == PROXY_CLIENT && pool &&
+			pool->nclients == 0 && pool->nbackends == 0)
+		{
+			dlist_delete(&pool->node);
+			pfree(pool->key);
+			pfree(pool);
+		}
+
+		if (chan->startup)
+			pfree(chan->startup);
+		pfree(chan->inbuf.data);
+		pfree(chan->outbuf.data);
+		pfree(chan);
+	}
+}
+
+/*
+ * Check for a complete protocol message at the cursor of an input buffer.
+ * Returns its total length, 0 if it hasn't arrived completely, or -1 if
+ * the length word is bogus.
+ */
+static int
+proxy_next_message(StringInfo in, char *msgtype)
+{
+	uint32		len;
+
+	if (in->len - in->cursor < 5)
+		return 0;
+
+	*msgtype = in->data[in->cursor];
+	memcpy(&len, in->data + in->cursor + 1, 4);
+	len = pg_ntoh32(len);
+
+	if (len < 4 || len > PQ_LARGE_MESSAGE_LIMIT)
+		return -1;
+	if (in->len - in->cursor < 1 + (int) len)
+		return 0;
+
+	return 1 + len;
+}
+
+/*
+ * Queue a protocol message for a channel
+ */
+static void
+proxy_put_message(ProxyChannel *chan, char msgtype, const char *data, int len)
+{
+	uint32		n32 = pg_hton32(len + 4);
+
+	appendStringInfoChar(&chan->outbuf, msgtype);
+	appendBinaryStringInfo(&chan->outbuf, &n32, 4);
+	if (len > 0)
+		appendBinaryStringInfo(&chan->outbuf, data, len);
+}
+
+/*
+ * Send a client a FATAL error of our own, and close its connection
+ */
+static void
+proxy_fail(ProxyChannel *client, const char *sqlstate, const char *msg)
+{
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, PG_DIAG_SEVERITY);
+	appendBinaryStringInfo(&buf, "FATAL", 6);
+	appendStringInfoChar(&buf, PG_DIAG_SEVERITY_NONLOCALIZED);
+	appendBinaryStringInfo(&buf, "FATAL", 6);
+	appendStringInfoChar(&buf, PG_DIAG_SQLSTATE);
+	appendBinaryStringInfo(&buf, sqlstate, strlen(sqlstate) + 1);
+	appendStringInfoChar(&buf, PG_DIAG_MESSAGE_PRIMARY);
+	appendBinaryStringInfo(&buf, msg, strlen(msg) + 1);
+	appendStringInfoChar(&buf, '\0');
+
+	proxy_put_message(client, PqMsg_ErrorResponse, buf.data, buf.len);
+	pfree(buf.data);
+
+	proxy_close_after_flush(client);
+	proxy_flush(client);
+}
+
+/*
+ * Act on new input from a client
+ */
+static void
+proxy_client_process(ProxyChannel *client)
+{
+	StringInfo	in = &client->inbuf;
+
+	if (client->cstate == CLIENT_STARTUP)
+		proxy_client_startup(client);
+
+	if (client->dead || client->closing)
+		resetStringInfo(in);
+	else if (client->cstate == CLIENT_AUTH)
+	{
+		/* Relay the authentication exchange as is */
+		appendBinaryStringInfo(&client->peer->outbuf,
+							   in->data + in->cursor, in->len - in->cursor);
+		in->cursor = in->len;
+		proxy_flush(client->peer);
+	}
+	else if (client->cstate != CLIENT_STARTUP)
+		proxy_client_messages(client);
+
+	proxy_consume_input(in);
+	proxy_flush(client);
+}
+
+/*
+ * Process the packets a client sends before its startup packet proper:
+ * SSL and GSSAPI encryption requests, which we turn down, and cancel
+ * requests.
+ */
+static void
+proxy_client_startup(ProxyChannel *client)
+{
+	StringInfo	in = &client->inbuf;
+
+	while (client->cstate == CLIENT_STARTUP && !client->dead && !client->closing)
+	{
+		uint32		len;
+		uint32		code;
+		const char *body;
+
+		if (in->len - in->cursor < 8)
+			break;
+
+		memcpy(&len, in->data + in->cursor, 4);
+		len = pg_ntoh32(len);
+		memcpy(&code, in->data + in->cursor + 4, 4);
+		code = pg_ntoh32(code);
+
+		if (len < 8 || len > MAX_STARTUP_PACKET_LENGTH)
+		{
+			/* Not a startup packet; maybe a direct SSL connection attempt */
+			proxy_kill(client);
+			return;
+		}
+		if (in->len - in->cursor < (int) len)
+			break;
+
+		body = in->data + in->cursor + 4;
+		in->cursor += len;
+
+		if (code == CANCEL_REQUEST_CODE)
+		{
+			if (len == sizeof(CancelRequestPacket) + 4)
+			{
+				const CancelRequestPacket *canc = (const CancelRequestPacket *) body;
+
+				proxy_route_cancel(pg_ntoh32(canc->backendPID),
+								   pg_ntoh32(canc->cancelAuthCode));
+			}
+			proxy_kill(client);
+			return;
+		}
+
+		if (code == NEGOTIATE_SSL_CODE || code == NEGOTIATE_GSS_CODE)
+		{
+			appendStringInfoChar(&client->outbuf, 'N');
+			continue;
+		}
+
+		proxy_client_startup_packet(client, body, len - 4);
+	}
+}
+
+/*
+ * Check a client's startup packet, and start authenticating the client
+ * through a fresh backend
+ */
+static void
+proxy_client_startup_packet(ProxyChannel *client, const char *body, int len)
+{
+	uint32		proto;
+	int			offset;
+	ProxyChannel *backend;
+
+	memcpy(&proto, body, 4);
+	proto = pg_ntoh32(proto);
+	if (PG_PROTOCOL_MAJOR(proto) != 3)
+	{
+		proxy_fail(client, "0A000", "unsupported frontend protocol");
+		return;
+	}
+
+	if (body[len - 1] != '\0')
+	{
+		proxy_fail(client, "08P01",
+				   "invalid startup packet layout: expected terminator as last byte");
+		return;
+	}
+
+	offset = 4;
+	while (offset < len - 1)
+	{
+		const char *name = body + offset;
+		const char *value;
+
+		offset += strlen(name) + 1;
+		if (offset >= len)
+		{
+			proxy_fail(client, "08P01", "invalid startup packet layout");
+			return;
+		}
+		value = body + offset;
+		offset += strlen(value) + 1;
+
+		if (strcmp(name, "replication") == 0 &&
+			strcmp(value, "false") != 0 && strcmp(value, "0") != 0)
+		{
+			proxy_fail(client, "0A000",
+					   "replication connections are not supported by connection proxies");
+			return;
+		}
+		if (strcmp(name, CONN_PROXY_OPTION) == 0)
+		{
+			proxy_fail(client, "08P01", "invalid startup packet option");
+			return;
+		}
+	}
+
+	client->cancel_pid = ((uint32) (ProxyIndex + 1) << PROXY_CLIENT_ID_BITS) |
+		(++ProxyNextClientId & PROXY_CLIENT_ID_MASK);
+	if (!pg_strong_random(&client->cancel_key, sizeof(client->cancel_key)))
+	{
+		proxy_fail(client, "XX000", "could not generate random cancel key");
+		return;
+	}
+
+	client->startup = palloc(len);
+	memcpy(client->startup, body, len);
+	client->startup_len = len;
+
+	backend = proxy_open_backend(client->startup, len, false, client);
+	if (backend == NULL)
+	{
+		proxy_fail(client, "08006", "could not connect to server");
+		return;
+	}
+
+	client->peer = backend;
+	backend->peer = client;
+	client->cstate = CLIENT_AUTH;
+	backend->bstate = BACKEND_AUTH;
+}
+
+/*
+ * Forward a client's complete messages to its backend, borrowing one from
+ * the pool if it has none
+ */
+static void
+proxy_client_messages(ProxyChannel *client)
+{
+	StringInfo	in = &client->inbuf;
+	ProxyChannel *backend = NULL;
+
+	while (!client->dead && !client->closing)
+	{
+		char		msgtype;
+		int			size;
+
+		size = proxy_next_message(in, &msgtype);
+		if (size < 0)
+		{
+			proxy_kill(client);
+			return;
+		}
+		if (size == 0)
+			break;
+
+		if (msgtype == PqMsg_Terminate)
+		{
+			in->cursor = in->len;
+			proxy_kill(client);
+			return;
+		}
+
+		if (client->peer == NULL)
+		{
+			if (client->cstate == CLIENT_IDLE)
+			{
+				ProxyPool  *pool = client->pool;
+
+				if (!dlist_is_empty(&pool->idle_backends))
+				{
+					backend = dlist_container(ProxyChannel, pool_node,
+											  dlist_pop_head_node(&pool->idle_backends));
+					ProxyIdleBackends--;
+					proxy_link(client, backend);
+				}
+				else
+				{
+					client->cstate = CLIENT_WAITING;
+					dlist_push_tail(&pool->waiting_clients, &client->pool_node);
+					pool->nwaiting++;
+					ProxyWaitingClients++;
+					proxy_pool_service(pool);
+				}
+			}
+			if (client->peer == NULL)
+				break;
+		}
+
+		backend = client->peer;
+		switch (msgtype)
+		{
+			case PqMsg_Query:
+			case PqMsg_FunctionCall:
+				backend->pending++;
+				break;
+			case PqMsg_Sync:
+				backend->pending++;
+				backend->unsynced = false;
+				break;
+			case PqMsg_Parse:
+			case PqMsg_Bind:
+			case PqMsg_Describe:
+			case PqMsg_Execute:
+			case PqMsg_Close:
+			case PqMsg_Flush:
+				backend->unsynced = true;
+				break;
+			default:
+				break;
+		}
+
+		appendBinaryStringInfo(&backend->outbuf, in->data + in->cursor, size);
+		in->cursor += size;
+	}
+
+	if (backend)
+		proxy_flush(backend);
+	proxy_update_events(client);
+}
+
+/*
+ * Act on complete messages from a backend
+ */
+static void
+proxy_backend_messages(ProxyChannel *backend)
+{
+	StringInfo	in = &backend->inbuf;
+
+	while (!backend->dead && !backend->closing)
+	{
+		ProxyChannel *client = backend->peer;
+		char		msgtype;
+		const char *msg;
+		const char *payload;
+		int			size;
+		int			plen;
+
+		size = proxy_next_message(in, &msgtype);
+		if (size < 0)
+		{
+			proxy_kill(backend);
+			break;
+		}
+		if (size == 0)
+			break;
+
+		msg = in->data + in->cursor;
+		payload = msg + 5;
+		plen = size - 5;
+		in->cursor += size;
+
+		switch (backend->bstate)
+		{
+			case BACKEND_AUTH:
+				if (msgtype == PqMsg_BackendKeyData && plen == 8)
+				{
+					uint32		ours[2];
+
+					/* Keep the real key, and give the client ours */
+					memcpy(&backend->backend_pid, payload, 4);
+					backend->backend_pid = pg_ntoh32(backend->backend_pid);
+					memcpy(&backend->backend_key, payload + 4, 4);
+					backend->backend_key = pg_ntoh32(backend->backend_key);
+
+					ours[0] = pg_hton32(client->cancel_pid);
+					ours[1] = pg_hton32(client->cancel_key);
+					proxy_put_message(client, PqMsg_BackendKeyData,
+									  (const char *) ours, sizeof(ours));
+				}
+				else
+				{
+					appendBinaryStringInfo(&client->outbuf, msg, size);
+					if (msgtype == PqMsg_ReadyForQuery)
+						proxy_auth_done(backend);
+				}
+				break;
+
+			case BACKEND_STARTUP:
+				if (msgtype == PqMsg_BackendKeyData && plen == 8)
+				{
+					memcpy(&backend->backend_pid, payload, 4);
+					backend->backend_pid = pg_ntoh32(backend->backend_pid);
+					memcpy(&backend->backend_key, payload + 4, 4);
+					backend->backend_key = pg_ntoh32(backend->backend_key);
+				}
+				else if (msgtype == PqMsg_ReadyForQuery)
+				{
+					backend->pool->nstarting--;
+					backend->bstate = BACKEND_ACTIVE;
+					proxy_release(backend);
+				}
+				else if (msgtype == PqMsg_ErrorResponse)
+				{
+					ProxyChannel *waiting = proxy_pop_waiting(backend->pool);
+
+					/* Let a waiting client see why we failed */
+					if (waiting)
+					{
+						appendBinaryStringInfo(&waiting->outbuf, msg, size);
+						proxy_close_after_flush(waiting);
+						proxy_flush(waiting);
+					}
+					backend->error_reported = true;
+				}
+				else if (msgtype == PqMsg_AuthenticationRequest &&
+						 (plen < 4 || memcmp(payload, "\0\0\0\0", 4) != 0))
+				{
+					/* We're in no position to answer a password request */
+					proxy_kill(backend);
+				}
+				break;
+
+			case BACKEND_ACTIVE:
+				if (msgtype == PqMsg_ParameterStatus &&
+					strcmp(payload, CONN_PROXY_PINNED_PARAM) == 0)
+				{
+					proxy_pin(backend);
+					break;
+				}
+
+				appendBinaryStringInfo(&client->outbuf, msg, size);
+
+				if (msgtype == PqMsg_ReadyForQuery && plen == 1)
+				{
+					backend->txn_status = payload[0];
+					if (backend->pending > 0)
+						backend->pending--;
+
+					/* Give the backend back at the end of a transaction */
+					if (backend->pending == 0 && !backend->unsynced &&
+						backend->txn_status == 'I' && !backend->pinned)
+					{
+						proxy_flush(client);
+						client->peer = NULL;
+						client->cstate = CLIENT_IDLE;
+						backend->peer = NULL;
+						ProxyTransactions++;
+						proxy_release(backend);
+
+						/* Maybe the client has sent its next request already */
+						if (!client->dead && !client->closing)
+							proxy_client_messages(client);
+						proxy_consume_input(&client->inbuf);
+					}
+				}
+				break;
+
+			case BACKEND_IDLE:
+			case BACKEND_CLOSING:
+				/* Nobody to tell; it'll be a notice or parameter change */
+				break;
+		}
+	}
+
+	proxy_consume_input(in);
+	if (backend->peer)
+		proxy_flush(backend->peer);
+	proxy_update_events(backend);
+}
+
+/*
+ * A backend has finished authenticating its client.  Put the client in its
+ * session pool, and keep the backend there if the pool has room.
+ */
+static void
+proxy_auth_done(ProxyChannel *backend)
+{
+	ProxyChannel *client = backend->peer;
+	ProxyPool  *pool;
+
+	pool = proxy_get_pool(client->startup, client->startup_len);
+	pool->nclients++;
+	client->pool = pool;
+	pfree(client->startup);
+	client->startup = NULL;
+
+	proxy_flush(client);
+	client->peer = NULL;
+	client->cstate = CLIENT_IDLE;
+	backend->peer = NULL;
+
+	if (pool->nbackends < session_pool_size)
+	{
+		backend->pool = pool;
+		pool->nbackends++;
+		proxy_release(backend);
+	}
+	else
+		proxy_terminate(backend);
+
+	if (!client->dead && !client->closing)
+		proxy_client_messages(client);
+}
+
+/*
+ * Open a backend for the given startup packet
+ */
+static ProxyChannel *
+proxy_open_backend(const char *params, int len, bool trusted,
+				   ProxyChannel *client)
+{
+	ProxyChannel *backend;
+	pgsocket	sock;
+	StringInfoData buf;
+	uint32		n32;
+
+	sock = proxy_connect_server();
+	if (sock == PGINVALID_SOCKET)
+		return NULL;
+
+	backend = proxy_new_channel(PROXY_BACKEND, sock);
+
+	/* The client's packet, up to its terminator, then our own option */
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, "\0\0\0\0", 4);
+	appendBinaryStringInfo(&buf, params, len - 1);
+	appendBinaryStringInfo(&buf, CONN_PROXY_OPTION,
+						   strlen(CONN_PROXY_OPTION) + 1);
+	appendStringInfo(&buf, "%s %s", ConnProxySecret,
+					 trusted ? "pool" : "auth");
+	if (client->host[0] != '\0')
+		appendStringInfo(&buf, " %s %s", client->host, client->port);
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, '\0');
+	n32 = pg_hton32(buf.len);
+	memcpy(buf.data, &n32, 4);
+
+	appendBinaryStringInfo(&backend->outbuf, buf.data, buf.len);
+	pfree(buf.data);
+	proxy_flush(backend);
+
+	return backend;
+}
+
+/*
+ * Lend a backend to a client
+ */
+static void
+proxy_link(ProxyChannel *client, ProxyChannel *backend)
+{
+	client->peer = backend;
+	backend->peer = client;
+	client->cstate = CLIENT_ACTIVE;
+	backend->bstate = BACKEND_ACTIVE;
+	backend->pending = 0;
+	backend->unsynced = false;
+
+	proxy_update_events(client);
+	proxy_update_events(backend);
+}
+
+/*
+ * Hand a pool backend that has no client to the next waiting client, or
+ * put it in the pool's idle list
+ */
+static void
+proxy_release(ProxyChannel *backend)
+{
+	ProxyPool  *pool = backend->pool;
+	ProxyChannel *client;
+
+	Assert(pool != NULL && backend->peer == NULL);
+
+	/* Shrink the pool if session_pool_size has been reduced */
+	if (pool->nbackends > session_pool_size)
+	{
+		proxy_terminate(backend);
+		return;
+	}
+
+	client = proxy_pop_waiting(pool);
+	if (client)
+	{
+		proxy_link(client, backend);
+		proxy_client_messages(client);
+		proxy_consume_input(&client->inbuf);
+	}
+	else
+	{
+		backend->bstate = BACKEND_IDLE;
+		dlist_push_head(&pool->idle_backends, &backend->pool_node);
+		ProxyIdleBackends++;
+		proxy_update_events(backend);
+	}
+}
+
+/*
+ * Politely close a backend
+ */
+static void
+proxy_terminate(ProxyChannel *backend)
+{
+	proxy_disconnect(backend);
+	proxy_put_message(backend, PqMsg_Terminate, NULL, 0);
+	proxy_close_after_flush(backend);
+	proxy_flush(backend);
+}
+
+/*
+ * The backend asked to stay with its current client
+ */
+static void
+proxy_pin(ProxyChannel *backend)
+{
+	ProxyPool  *pool = backend->pool;
+
+	if (backend->pinned)
+		return;
+
+	backend->pinned = true;
+	backend->peer->pinned = true;
+	ProxyPinnedClients++;
+
+	/* The pool can replace it with a backend that's free to move */
+	if (pool)
+	{
+		backend->pool = NULL;
+		pool->nbackends--;
+		proxy_pool_service(pool);
+	}
+}
+
+/*
+ * Find or make the session pool for a startup packet
+ */
+static ProxyPool *
+proxy_get_pool(const char *key, int keylen)
+{
+	dlist_iter	iter;
+	ProxyPool  *pool;
+
+	dlist_foreach(iter, &ProxyPools)
+	{
+		pool = dlist_container(ProxyPool, node, iter.cur);
+		if (pool->keylen == keylen && memcmp(pool->key, key, keylen) == 0)
+			return pool;
+	}
+
+	pool = palloc0(sizeof(ProxyPool));
+	pool->key = palloc(keylen);
+	memcpy(pool->key, key, keylen);
+	pool->keylen = keylen;
+	dlist_init(&pool->idle_backends);
+	dlist_init(&pool->waiting_clients);
+	dlist_push_head(&ProxyPools, &pool->node);
+
+	return pool;
+}
+
+/*
+ * Open more backends for a pool's waiting clients, if it has room for them
+ */
+static void
+proxy_pool_service(ProxyPool *pool)
+{
+	while (pool->nwaiting > pool->nstarting &&
+		   pool->nbackends < session_pool_size)
+	{
+		ProxyChannel *client;
+		ProxyChannel *backend;
+
+		client = dlist_container(ProxyChannel, pool_node,
+								 dlist_head_node(&pool->waiting_clients));
+		backend = proxy_open_backend(pool->key, pool->keylen, true, client);
+		if (backend == NULL)
+		{
+			/* The server isn't reachable, so nobody waiting will get in */
+			while ((client = proxy_pop_waiting(pool)) != NULL)
+				proxy_fail(client, "08006", "could not connect to server");
+			break;
+		}
+
+		backend->pool = pool;
+		backend->bstate = BACKEND_STARTUP;
+		pool->nbackends++;
+		pool->nstarting++;
+	}
+}
+
+static ProxyChannel *
+proxy_pop_waiting(ProxyPool *pool)
+{
+	ProxyChannel *client;
+
+	if (dlist_is_empty(&pool->waiting_clients))
+		return NULL;
+
+	client = dlist_container(ProxyChannel, pool_node,
+							 dlist_pop_head_node(&pool->waiting_clients));
+	client->cstate = CLIENT_IDLE;
+	pool->nwaiting--;
+	ProxyWaitingClients--;
+
+	return client;
+}
+
+/*
+ * Deal with a cancel request, here or in the proxy it belongs to
+ */
+static void
+proxy_route_cancel(uint32 pid, uint32 key)
+{
+	int			target = (int) (pid >> PROXY_CLIENT_ID_BITS) - 1;
+	ConnProxySlot *slot;
+
+	if (target == ProxyIndex)
+	{
+		proxy_cancel(pid, key);
+		return;
+	}
+	if (target < 0 || target >= ConnProxyCtl->nproxies)
+		return;
+
+	slot = &ConnProxyCtl->slots[target];
+	SpinLockAcquire(&slot->mutex);
+	if (slot->latch != NULL && slot->ncancels < PROXY_MAX_CANCELS)
+	{
+		slot->cancels[slot->ncancels].pid = pid;
+		slot->cancels[slot->ncancels].key = key;
+		slot->ncancels++;
+		SetLatch(slot->latch);
+	}
+	SpinLockRelease(&slot->mutex);
+}
+
+/*
+ * Handle cancel requests other proxies have passed on to us
+ */
+static void
+proxy_process_cancels(void)
+{
+	int			ncancels;
+	struct
+	{
+		uint32		pid;
+		uint32		key;
+	}			cancels[PROXY_MAX_CANCELS];
+
+	SpinLockAcquire(&MyProxySlot->mutex);
+	ncancels = MyProxySlot->ncancels;
+	memcpy(cancels, MyProxySlot->cancels, ncancels * sizeof(cancels[0]));
+	MyProxySlot->ncancels = 0;
+	SpinLockRelease(&MyProxySlot->mutex);
+
+	for (int i = 0; i < ncancels; i++)
+		proxy_cancel(cancels[i].pid, cancels[i].key);
+}
+
+/*
+ * Cancel whatever the backend currently serving a client is doing
+ */
+static void
+proxy_cancel(uint32 pid, uint32 key)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &ProxyChannels)
+	{
+		ProxyChannel *client = dlist_container(ProxyChannel, node, iter.cur);
+		ProxyChannel *backend = client->peer;
+		struct
+		{
+			uint32		len;
+			CancelRequestPacket cp;
+		}			crp;
+		pgsocket	sock;
+
+		if (client->kind != PROXY_CLIENT || client->cancel_pid != pid)
+			continue;
+		if (client->cancel_key != key || backend == NULL ||
+			backend->backend_pid == 0)
+			return;
+
+		crp.len = pg_hton32(sizeof(crp));
+		crp.cp.cancelRequestCode = pg_hton32(CANCEL_REQUEST_CODE);
+		crp.cp.backendPID = pg_hton32(backend->backend_pid);
+		crp.cp.cancelAuthCode = pg_hton32(backend->backend_key);
+
+		sock = proxy_connect_server();
+		if (sock != PGINVALID_SOCKET)
+		{
+			(void) send(sock, (char *) &crp, sizeof(crp), 0);
+			closesocket(sock);
+		}
+		return;
+	}
+}
+
+/*
+ * SQL-callable function returning a row per running connection proxy
+ */
+Datum
+pg_stat_get_connection_proxies(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_CONNECTION_PROXIES_COLS	8
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	for (int i = 0; i < ConnProxyCtl->nproxies; i++)
+	{
+		ConnProxySlot *slot = &ConnProxyCtl->slots[i];
+		Datum		values[PG_STAT_GET_CONNECTION_PROXIES_COLS] = {0};
+		bool		nulls[PG_STAT_GET_CONNECTION_PROXIES_COLS] = {0};
+		pid_t		pid;
+
+		SpinLockAcquire(&slot->mutex);
+		pid = slot->pid;
+		values[2] = Int32GetDatum(slot->clients);
+		values[3] = Int32GetDatum(slot->pinned_clients);
+		values[4] = Int32GetDatum(slot->waiting_clients);
+		values[5] = Int32GetDatum(slot->backends);
+		values[6] = Int32GetDatum(slot->idle_backends);
+		values[7] = Int64GetDatum(slot->transactions);
+		SpinLockRelease(&slot->mutex);
+
+		if (pid == 0)
+			continue;
+
+		values[0] = Int32GetDatum(i);
+		values[1] = Int32GetDatum(pid);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	return (Datum) 0;
+}
@@ -44,6 +44,7 @@
 #include "postmaster/auxprocess.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/connproxy.h"
 #include "postmaster/fork_process.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
@@ -60,6 +61,7 @@
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
 #include "storage/procsignal.h"
+#include "tcop/backend_pool.h"
 #include "tcop/backend_startup.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
@@ -126,6 +128,7 @@ typedef struct
 	bool		query_id_enabled;
 	int			max_safe_fds;
 	int			MaxBackends;
+	char		ConnProxySecret[CONN_PROXY_SECRET_LEN + 1];
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -244,6 +247,10 @@ postmaster_child_launch(BackendType child_type,
 		/* Close the postmaster's sockets */
 		ClosePostmasterPorts(child_type == B_LOGGER);
 
+		/* Only backends take part in handing clients to pooled backends */
+		if (child_type != B_BACKEND)
+			BackendPoolCloseSockets();
+
 		/* Detangle from postmaster */
 		InitPostmasterChild();
 
@@ -742,6 +749,8 @@ save_backend_variables(BackendParameters *param, ClientSocket *client_sock,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+	strlcpy(param->ConnProxySecret, ConnProxySecret,
+			sizeof(param->ConnProxySecret));
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -1001,6 +1010,8 @@ restore_backend_variables(BackendParameters *param)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+	strlcpy(ConnProxySecret, param->ConnProxySecret,
+			sizeof(ConnProxySecret));
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
@@ -104,6 +104,7 @@
 #include "postmaster/autovacuum.h"
 #include "postmaster/auxprocess.h"
 #include "postmaster/bgworker_internals.h"
+#include "postmaster/connproxy.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/syslogger.h"
@@ -115,6 +116,7 @@
 #include "storage/ipc.h"
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
+#include "tcop/backend_pool.h"
 #include "tcop/backend_startup.h"
 #include "tcop/tcopprot.h"
 #include "utils/datetime.h"
@@ -137,7 +139,8 @@
 #define BACKEND_TYPE_AUTOVAC	0x0002	/* autovacuum worker process */
 #define BACKEND_TYPE_WALSND		0x0004	/* walsender process */
 #define BACKEND_TYPE_BGWORKER	0x0008	/* bgworker process */
-#define BACKEND_TYPE_ALL		0x000F	/* OR of all the above */
+#define BACKEND_TYPE_POOLED		0x0010	/* backend waiting for a client */
+#define BACKEND_TYPE_ALL		0x001F	/* OR of all the above */
 
 /*
  * List of active backends (or child processes anyway; we don't actually
@@ -151,7 +154,8 @@
  * labeled BACKEND_TYPE_NORMAL; we relabel them to BACKEND_TYPE_WALSND
  * upon noticing they've changed their PMChildFlags entry.  Hence that check
  * must be done before any operation that needs to distinguish walsenders
- * from normal backends.)
+ * from normal backends.  Likewise, pooled backends are relabeled
+ * BACKEND_TYPE_NORMAL once they have been handed a client.)
  *
  * Also, "dead_end" children are in it: these are children launched just for
  * the purpose of sending a friendly rejection message to a would-be client.
@@ -173,11 +177,20 @@ typedef struct bkend
 	bool		dead_end;		/* is it going to send an error and quit? */
 	RegisteredBgWorker *rw;		/* bgworker info, if this is a bgworker */
 	bool		bgworker_notify;	/* gets bgworker start/stop notifications */
+	int			backend_pool;	/* pool of a BACKEND_TYPE_POOLED backend */
 	dlist_node	elem;			/* list link in BackendList */
 } Backend;
 
 static dlist_head BackendList = DLIST_STATIC_INIT(BackendList);
 
+/*
+ * For each backend pool, the number of pooled backends we have started that
+ * haven't been handed a client (as far as we know), and when we may next
+ * start one if the last one failed.
+ */
+static int *PooledBackendCount = NULL;
+static TimestampTz *PooledBackendRestartAt = NULL;
+
 BackgroundWorker *MyBgworkerEntry = NULL;
 
 
@@ -422,6 +435,10 @@ static void maybe_start_bgworkers(void);
 static bool CreateOptsFile(int argc, char *argv[], char *fullprogname);
 static pid_t StartChildProcess(BackendType type);
 static void StartAutovacuumWorker(void);
+static bool StartPooledBackend(int pool);
+static void maybe_start_pooled_backends(void);
+static TimestampTz NextPooledBackendStart(void);
+static void CheckPooledBackendClaimed(Backend *bp);
 static void InitPostmasterDeathWatchHandle(void);
 
 #ifdef WIN32
@@ -881,6 +898,18 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	ApplyLauncherRegister();
 
+	/* Likewise for the connection proxies, if enabled. */
+	ConnProxyRegister();
+
+	/* Set up the backend pools, if any */
+	BackendPoolInit();
+	if (BackendPoolNumDatabases() > 0)
+	{
+		PooledBackendCount = palloc0_array(int, BackendPoolNumDatabases());
+		PooledBackendRestartAt = palloc0_array(TimestampTz,
+											   BackendPoolNumDatabases());
+	}
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -1513,7 +1542,9 @@ DetermineSleepTime(void)
 
 			return Max(seconds * 1000, 0);
 		}
-		else
+
+		next_wakeup = NextPooledBackendStart();
+		if (next_wakeup == 0)
 			return 60 * 1000;
 	}
 
@@ -1523,6 +1554,7 @@ DetermineSleepTime(void)
 	if (HaveCrashedWorker)
 	{
 		dlist_mutable_iter iter;
+		TimestampTz pool_wakeup;
 
 		/*
 		 * When there are crashed bgworkers, we sleep just long enough that
@@ -1552,6 +1584,11 @@ DetermineSleepTime(void)
 			if (next_wakeup == 0 || this_wakeup < next_wakeup)
 				next_wakeup = this_wakeup;
 		}
+
+		/* Backend pools may need to be filled again, too */
+		pool_wakeup = NextPooledBackendStart();
+		if (pool_wakeup != 0 && (next_wakeup == 0 || pool_wakeup < next_wakeup))
+			next_wakeup = pool_wakeup;
 	}
 
 	if (next_wakeup != 0)
@@ -2111,7 +2148,12 @@ process_pm_shutdown_request(void)
 			 * later state, do not change it.
 			 */
 			if (pmState == PM_RUN || pmState == PM_HOT_STANDBY)
+			{
 				connsAllowed = false;
+
+				/* Pooled backends have no clients to wait for */
+				SignalSomeChildren(SIGTERM, BACKEND_TYPE_POOLED);
+			}
 			else if (pmState == PM_STARTUP || pmState == PM_RECOVERY)
 			{
 				/* There should be no clients, so proceed to stop children */
@@ -2582,6 +2624,21 @@ CleanupBackend(Backend *bp,
 	if (!EXIT_STATUS_0(exitstatus) && !EXIT_STATUS_1(exitstatus))
 		crashed = true;
 
+	/*
+	 * A pooled backend that leaves its pool must be replaced.  If it failed
+	 * before it was handed a client, give whatever made it fail some time to
+	 * go away first.
+	 */
+	if (bp->bkend_type == BACKEND_TYPE_POOLED)
+	{
+		PooledBackendCount[bp->backend_pool]--;
+		if (!EXIT_STATUS_0(exitstatus) &&
+			!BackendPoolChildClaimed(bp->child_slot))
+			PooledBackendRestartAt[bp->backend_pool] =
+				TimestampTzPlusSeconds(GetCurrentTimestamp(),
+									   BACKEND_POOL_RESTART_DELAY);
+	}
+
 #ifdef WIN32
 
 	/*
@@ -3240,6 +3297,10 @@ LaunchMissingBackgroundProcesses(void)
 	/* Get other worker processes running, if needed */
 	if (StartWorkerNeeded || HaveCrashedWorker)
 		maybe_start_bgworkers();
+
+	/* Keep the backend pools filled */
+	if (PooledBackendCount != NULL)
+		maybe_start_pooled_backends();
 }
 
 /*
@@ -3329,6 +3390,9 @@ SignalSomeChildren(int signal, int target)
 				IsPostmasterChildWalSender(bp->child_slot))
 				bp->bkend_type = BACKEND_TYPE_WALSND;
 
+			/* Likewise for pooled backends that have been handed a client */
+			CheckPooledBackendClaimed(bp);
+
 			if (!(target & bp->bkend_type))
 				continue;
 		}
@@ -3403,6 +3467,8 @@ BackendStartup(ClientSocket *client_sock)
 
 	/* Pass down canAcceptConnections state */
 	startup_data.canAcceptConnections = canAcceptConnections(BACKEND_TYPE_NORMAL);
+	startup_data.backend_pool = -1;
+	startup_data.fork_started = GetCurrentTimestamp();
 	bn->dead_end = (startup_data.canAcceptConnections != CAC_OK);
 	bn->rw = NULL;
 
@@ -3644,6 +3710,15 @@ process_pm_pmsignal(void)
 	 * cannot have any (immediate) effect on the state machine, but does
 	 * depend on what state we're in now.
 	 */
+	/* Replace pooled backends that have been handed a client */
+	if (CheckPostmasterSignal(PMSIGNAL_BACKEND_POOL))
+	{
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &BackendList)
+			CheckPooledBackendClaimed(dlist_container(Backend, elem, iter.cur));
+	}
+
 	if (CheckPostmasterSignal(PMSIGNAL_ADVANCE_STATE_MACHINE))
 	{
 		PostmasterStateMachine();
@@ -3709,6 +3784,9 @@ CountChildren(int target)
 				IsPostmasterChildWalSender(bp->child_slot))
 				bp->bkend_type = BACKEND_TYPE_WALSND;
 
+			/* Likewise for pooled backends that have been handed a client */
+			CheckPooledBackendClaimed(bp);
+
 			if (!(target & bp->bkend_type))
 				continue;
 		}
@@ -3825,6 +3903,146 @@ StartAutovacuumWorker(void)
 	}
 }
 
+/*
+ * StartPooledBackend
+ *		Start a backend to wait in the given backend pool.
+ *
+ * Returns false if that failed, in which case we've set things up to try
+ * again later.
+ *
+ * NB -- this code very roughly matches BackendStartup.
+ */
+static bool
+StartPooledBackend(int pool)
+{
+	Backend    *bn;
+	pid_t		pid;
+	BackendStartupData startup_data;
+
+	bn = (Backend *) palloc_extended(sizeof(Backend), MCXT_ALLOC_NO_OOM);
+	if (!bn)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		return false;
+	}
+
+	startup_data.canAcceptConnections = CAC_OK;
+	startup_data.backend_pool = pool;
+	startup_data.fork_started = 0;
+
+	/* Pooled backends are not dead_end and need a child slot */
+	bn->dead_end = false;
+	bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
+	bn->bgworker_notify = false;
+	bn->rw = NULL;
+	BackendPoolPrepareChild(bn->child_slot);
+
+	pid = postmaster_child_launch(B_BACKEND,
+								  (char *) &startup_data, sizeof(startup_data),
+								  NULL);
+	if (pid < 0)
+	{
+		/* in parent, fork failed */
+		int			save_errno = errno;
+
+		(void) ReleasePostmasterChildSlot(bn->child_slot);
+		pfree(bn);
+		errno = save_errno;
+		ereport(LOG,
+				(errmsg("could not fork pooled backend process: %m")));
+		PooledBackendRestartAt[pool] =
+			TimestampTzPlusSeconds(GetCurrentTimestamp(),
+								   BACKEND_POOL_RESTART_DELAY);
+		return false;
+	}
+
+	bn->pid = pid;
+	bn->bkend_type = BACKEND_TYPE_POOLED;
+	bn->backend_pool = pool;
+	dlist_push_head(&BackendList, &bn->elem);
+	PooledBackendCount[pool]++;
+
+	return true;
+}
+
+/*
+ * Start pooled backends for any backend pool that isn't full.
+ *
+ * Pools that are larger than backend_pool_size are left alone: their
+ * backends notice that themselves, when they reload the configuration.
+ */
+static void
+maybe_start_pooled_backends(void)
+{
+	TimestampTz now = 0;
+
+	if (Shutdown > NoShutdown)
+		return;
+
+	for (int i = 0; i < BackendPoolNumDatabases(); i++)
+	{
+		if (PooledBackendCount[i] >= backend_pool_size)
+			continue;
+
+		if (PooledBackendRestartAt[i] != 0)
+		{
+			if (now == 0)
+				now = GetCurrentTimestamp();
+			if (now < PooledBackendRestartAt[i])
+				continue;
+			PooledBackendRestartAt[i] = 0;
+		}
+
+		while (PooledBackendCount[i] < backend_pool_size)
+		{
+			/* Leave room for clients and other processes, as they'd need */
+			if (canAcceptConnections(BACKEND_TYPE_NORMAL) != CAC_OK)
+				return;
+			if (!StartPooledBackend(i))
+				break;
+		}
+	}
+}
+
+/*
+ * When a backend pool that lost a backend may next be filled again, or 0 if
+ * no pool is waiting for that.
+ */
+static TimestampTz
+NextPooledBackendStart(void)
+{
+	TimestampTz result = 0;
+
+	if (PooledBackendRestartAt == NULL || Shutdown > NoShutdown)
+		return 0;
+
+	for (int i = 0; i < BackendPoolNumDatabases(); i++)
+	{
+		TimestampTz restart_at = PooledBackendRestartAt[i];
+
+		if (restart_at != 0 && (result == 0 || restart_at < result))
+			result = restart_at;
+	}
+	return result;
+}
+
+/*
+ * Relabel a pooled backend as a normal one once it has been handed a client,
+ * which takes it out of its pool.
+ */
+static void
+CheckPooledBackendClaimed(Backend *bp)
+{
+	if (bp->bkend_type == BACKEND_TYPE_POOLED &&
+		BackendPoolChildClaimed(bp->child_slot))
+	{
+		bp->bkend_type = BACKEND_TYPE_NORMAL;
+		PooledBackendCount[bp->backend_pool]--;
+	}
+}
+
 
 /*
  * Create the opts file
@@ -152,16 +152,48 @@
  * session-level locks because both locks could be acquired outside the
  * transaction, and the stream lock in the leader needs to persist across
  * transaction boundaries i.e. until the end of the streaming transaction.
+ *
+ * Non-streamed transactions
+ * -------------------------
+ * When parallel_apply_non_streamed is enabled, the leader apply worker also
+ * uses the parallel apply workers for transactions that are sent as a whole
+ * at commit time. The leader collects the messages of such a transaction in
+ * memory (see pa_handle_nonstreamed_message()) and, at COMMIT, sends them to
+ * a free parallel apply worker without waiting for it to finish. This lets
+ * several non-streamed transactions be applied at the same time.
+ *
+ * To avoid the failures described at the top of this file, the leader
+ * computes a hash of the remote replica identity key of every row changed by
+ * the transaction and does not dispatch a transaction until all earlier
+ * in-flight transactions that changed a row with the same key have finished.
+ * This is only reliable for relations where nothing else on the subscriber
+ * can make changes of rows with different keys conflict, see
+ * logicalrep_rel_mark_parallel_apply_safe(); transactions touching any other
+ * relation, as well as transactions containing anything but DML, are applied
+ * by the leader itself after waiting for all in-flight transactions.
+ *
+ * The commit order is still preserved: each parallel apply worker waits for
+ * the transaction dispatched just before its own to commit before committing
+ * (see pa_wait_for_preceding_xact()), using the transaction lock of that
+ * transaction, so the wait is visible to the deadlock detector. Since all
+ * workers share the leader's replication origin, this also makes sure that
+ * the origin never moves past a transaction that has not been committed. The
+ * leader notices finished transactions in pa_process_dispatched_xacts() and
+ * only then reports their commit LSNs as flushed to the publisher.
  *-------------------------------------------------------------------------
  */
 
 #include "postgres.h"
 
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "common/hashfn.h"
 #include "libpq/pqformat.h"
 #include "libpq/pqmq.h"
 #include "pgstat.h"
 #include "postmaster/interrupt.h"
 #include "replication/logicallauncher.h"
+#include "replication/logicalrelation.h"
 #include "replication/logicalworker.h"
 #include "replication/origin.h"
 #include "replication/worker_internal.h"
@@ -254,6 +286,67 @@ static ParallelApplyWorkerInfo *stream_apply_worker = NULL;
 /* A list to maintain subtransactions, if any. */
 static List *subxactlist = NIL;
 
+/*
+ * A non-streamed transaction that has been sent to a parallel apply worker
+ * but has not been seen to finish yet.
+ */
+typedef struct ParallelApplyDispatchedXact
+{
+	uint64		seqno;			/* position in the dispatch order */
+	TransactionId xid;			/* remote transaction ID */
+	XLogRecPtr	end_lsn;		/* end LSN of the remote commit record */
+	ParallelApplyWorkerInfo *winfo;
+	int			nkeys;			/* number of entries in keys */
+	uint64	   *keys;			/* hashes of the replica identity keys */
+} ParallelApplyDispatchedXact;
+
+/*
+ * Hash table entry to map the hash of a replica identity key to the last
+ * dispatched transaction that changed a row with that key.
+ */
+typedef struct ParallelApplyKeyEntry
+{
+	uint64		key;			/* Hash key -- must be first */
+	uint64		seqno;
+} ParallelApplyKeyEntry;
+
+/*
+ * A RELATION message remembered to be sent to the parallel apply workers
+ * before they apply a non-streamed transaction.
+ */
+typedef struct ParallelApplyRelationEntry
+{
+	LogicalRepRelId remoteid;	/* Hash key -- must be first */
+	uint64		seqno;			/* value of relation_msgs_seqno when stored */
+	int			len;
+	char	   *data;
+} ParallelApplyRelationEntry;
+
+/* In-flight non-streamed transactions, in commit order. */
+static List *DispatchedXacts = NIL;
+static uint64 dispatched_xacts_seqno = 0;
+static HTAB *ParallelApplyKeyHash = NULL;
+
+static HTAB *ParallelApplyRelationHash = NULL;
+static uint64 relation_msgs_seqno = 0;
+
+/*
+ * State of the non-streamed transaction being collected by the leader. The
+ * messages are stored in xact_buffer, each preceded by its length.
+ */
+static bool buffering_xact = false;
+static MemoryContext ParallelApplyBufferContext = NULL;
+static StringInfoData xact_buffer;
+static Size xact_buffer_queue_size;
+static TransactionId buffered_xid;
+static List *buffered_relids = NIL;
+static uint64 *buffered_keys = NULL;
+static int	buffered_nkeys = 0;
+static int	buffered_maxkeys = 0;
+
+/* When did we last fail to launch a worker for a non-streamed transaction? */
+static TimestampTz last_launch_failure_time = 0;
+
 static void pa_free_worker_info(ParallelApplyWorkerInfo *winfo);
 static ParallelTransState pa_get_xact_state(ParallelApplyWorkerShared *wshared);
 static PartialFileSetState pa_get_fileset_state(void);
@@ -369,6 +462,8 @@ pa_setup_dsm(ParallelApplyWorkerInfo *winfo)
 	pg_atomic_init_u32(&(shared->pending_stream_count), 0);
 	shared->last_commit_end = InvalidXLogRecPtr;
 	shared->fileset_state = FS_EMPTY;
+	shared->preceding_xid = InvalidTransactionId;
+	shared->preceding_end_lsn = InvalidXLogRecPtr;
 
 	shm_toc_insert(toc, PARALLEL_APPLY_KEY_SHARED, shared);
 
@@ -504,6 +599,8 @@ pa_allocate_worker(TransactionId xid)
 	SpinLockAcquire(&winfo->shared->mutex);
 	winfo->shared->xact_state = PARALLEL_TRANS_UNKNOWN;
 	winfo->shared->xid = xid;
+	winfo->shared->preceding_xid = InvalidTransactionId;
+	winfo->shared->preceding_end_lsn = InvalidXLogRecPtr;
 	SpinLockRelease(&winfo->shared->mutex);
 
 	winfo->in_use = true;
@@ -1637,3 +1734,721 @@ pa_xact_finish(ParallelApplyWorkerInfo *winfo, XLogRecPtr remote_lsn)
 
 	pa_free_worker(winfo);
 }
+
+/*
+ * Can the leader apply worker hand non-streamed transactions to parallel
+ * apply workers?
+ */
+static bool
+pa_can_dispatch_xacts(void)
+{
+	if (!parallel_apply_non_streamed ||
+		max_parallel_apply_workers_per_subscription == 0)
+		return false;
+
+	/* See pa_send_data(). */
+	if (unlikely(debug_logical_replication_streaming == DEBUG_LOGICAL_REP_STREAMING_IMMEDIATE))
+		return false;
+
+	return pa_can_start();
+}
+
+/*
+ * Forget the non-streamed transaction collected so far.
+ */
+static void
+pa_reset_buffered_xact(void)
+{
+	buffering_xact = false;
+
+	if (ParallelApplyBufferContext == NULL)
+		ParallelApplyBufferContext = AllocSetContextCreate(ApplyContext,
+														   "ParallelApplyBufferContext",
+														   ALLOCSET_DEFAULT_SIZES);
+	else
+		MemoryContextReset(ParallelApplyBufferContext);
+
+	xact_buffer.data = NULL;
+	xact_buffer_queue_size = 0;
+	buffered_xid = InvalidTransactionId;
+	buffered_relids = NIL;
+	buffered_keys = NULL;
+	buffered_nkeys = 0;
+	buffered_maxkeys = 0;
+}
+
+/*
+ * Add a protocol message to the non-streamed transaction being collected.
+ */
+static void
+pa_buffer_message(StringInfo s)
+{
+	MemoryContext oldctx;
+
+	oldctx = MemoryContextSwitchTo(ParallelApplyBufferContext);
+
+	if (xact_buffer.data == NULL)
+		initStringInfo(&xact_buffer);
+
+	appendBinaryStringInfo(&xact_buffer, &s->len, sizeof(int));
+	appendBinaryStringInfo(&xact_buffer, s->data, s->len);
+
+	MemoryContextSwitchTo(oldctx);
+
+	/* Account for the space the message will take in the shm_mq. */
+	xact_buffer_queue_size += sizeof(Size) + MAXALIGN(s->len);
+}
+
+/*
+ * Remember the hash of the replica identity key of the given remote tuple of
+ * the relation.
+ *
+ * Returns false if the key cannot be determined.
+ */
+static bool
+pa_buffer_tuple_key(LogicalRepRelMapEntry *rel, LogicalRepTupleData *tuple)
+{
+	LogicalRepRelation *remoterel = &rel->remoterel;
+	uint64		key;
+	int			attnum = -1;
+
+	key = hash_bytes_uint32_extended(remoterel->remoteid, 0);
+
+	while ((attnum = bms_next_member(remoterel->attkeys, attnum)) >= 0)
+	{
+		char		status;
+
+		if (attnum >= tuple->ncols)
+			return false;
+
+		status = tuple->colstatus[attnum];
+
+		/* An unchanged toasted value doesn't tell us the key. */
+		if (status == LOGICALREP_COLUMN_UNCHANGED)
+			return false;
+
+		key = hash_combine64(key, (uint64) status);
+
+		if (status == LOGICALREP_COLUMN_TEXT ||
+			status == LOGICALREP_COLUMN_BINARY)
+		{
+			StringInfo	value = &tuple->colvalues[attnum];
+
+			key = hash_combine64(key,
+								 hash_bytes_extended((unsigned char *) value->data,
+													 value->len, 0));
+		}
+	}
+
+	if (buffered_nkeys >= buffered_maxkeys)
+	{
+		if (buffered_maxkeys == 0)
+		{
+			buffered_maxkeys = 16;
+			buffered_keys = MemoryContextAlloc(ParallelApplyBufferContext,
+											   buffered_maxkeys * sizeof(uint64));
+		}
+		else
+		{
+			buffered_maxkeys *= 2;
+			buffered_keys = repalloc(buffered_keys,
+									 buffered_maxkeys * sizeof(uint64));
+		}
+	}
+
+	buffered_keys[buffered_nkeys++] = key;
+
+	return true;
+}
+
+/*
+ * Remember the keys of the rows changed by an INSERT, UPDATE or DELETE
+ * message of the transaction being collected, and the relation it changes.
+ *
+ * Returns false if the keys cannot be determined.
+ */
+static bool
+pa_buffer_change_keys(LogicalRepMsgType action, StringInfo s)
+{
+	StringInfoData msg = *s;
+	LogicalRepRelId relid;
+	LogicalRepRelMapEntry *rel;
+	LogicalRepTupleData oldtup;
+	LogicalRepTupleData newtup;
+	bool		has_oldtup = false;
+	bool		has_newtup = false;
+	MemoryContext oldctx;
+
+	/* Skip the message type. */
+	msg.cursor++;
+
+	switch (action)
+	{
+		case LOGICAL_REP_MSG_INSERT:
+			relid = logicalrep_read_insert(&msg, &newtup);
+			has_newtup = true;
+			break;
+
+		case LOGICAL_REP_MSG_UPDATE:
+			relid = logicalrep_read_update(&msg, &has_oldtup, &oldtup,
+										   &newtup);
+			has_newtup = true;
+			break;
+
+		case LOGICAL_REP_MSG_DELETE:
+			relid = logicalrep_read_delete(&msg, &oldtup);
+			has_oldtup = true;
+			break;
+
+		default:
+			elog(ERROR, "unexpected message type \"%c\"", action);
+			return false;		/* silence compiler warning */
+	}
+
+	rel = logicalrep_rel_lookup(relid);
+	if (rel == NULL || bms_is_empty(rel->remoterel.attkeys))
+		return false;
+
+	if (has_oldtup && !pa_buffer_tuple_key(rel, &oldtup))
+		return false;
+
+	if (has_newtup && !pa_buffer_tuple_key(rel, &newtup))
+		return false;
+
+	oldctx = MemoryContextSwitchTo(ParallelApplyBufferContext);
+	buffered_relids = list_append_unique_oid(buffered_relids, relid);
+	MemoryContextSwitchTo(oldctx);
+
+	return true;
+}
+
+/*
+ * Apply the non-streamed transaction collected so far in the leader apply
+ * worker itself, after all dispatched transactions have finished.
+ */
+static void
+pa_apply_buffered_xact(void)
+{
+	int			offset = 0;
+
+	pa_process_dispatched_xacts(true);
+
+	buffering_xact = false;
+
+	while (xact_buffer.data != NULL && offset < xact_buffer.len)
+	{
+		StringInfoData msg;
+		int			len;
+
+		memcpy(&len, xact_buffer.data + offset, sizeof(int));
+		offset += sizeof(int);
+
+		initReadOnlyStringInfo(&msg, xact_buffer.data + offset, len);
+		offset += len;
+
+		/* Skip the 'w' and the statistics fields, see LogicalRepApplyLoop. */
+		msg.cursor = 1 + SIZE_STATS_MESSAGE;
+
+		apply_dispatch(&msg);
+
+		MemoryContextReset(ApplyMessageContext);
+	}
+
+	pa_reset_buffered_xact();
+}
+
+/*
+ * Check that all relations changed by the collected transaction allow their
+ * changes to be applied in parallel.
+ */
+static bool
+pa_buffered_relations_are_safe(void)
+{
+	foreach_oid(relid, buffered_relids)
+	{
+		LogicalRepRelMapEntry *rel = logicalrep_rel_lookup(relid);
+
+		if (rel == NULL)
+			return false;
+
+		/* Refresh the local information if it has been invalidated. */
+		if (!rel->localrelvalid)
+		{
+			MemoryContext oldctx = CurrentMemoryContext;
+
+			StartTransactionCommand();
+			rel = logicalrep_rel_open(relid, AccessShareLock);
+			logicalrep_rel_close(rel, AccessShareLock);
+			CommitTransactionCommand();
+
+			MemoryContextSwitchTo(oldctx);
+		}
+
+		if (!rel->parallel_apply_safe)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Get a parallel apply worker to apply a non-streamed transaction, waiting
+ * for a dispatched transaction to finish if necessary.
+ *
+ * Returns NULL if no worker can be had.
+ */
+static ParallelApplyWorkerInfo *
+pa_get_worker_for_dispatch(void)
+{
+	for (;;)
+	{
+		ListCell   *lc;
+
+		foreach(lc, ParallelApplyWorkerPool)
+		{
+			ParallelApplyWorkerInfo *winfo = (ParallelApplyWorkerInfo *) lfirst(lc);
+
+			if (!winfo->in_use)
+				return winfo;
+		}
+
+		/*
+		 * Start a new worker if allowed, but don't retry too often if we
+		 * failed to, e.g. because all worker slots are in use.
+		 */
+		if (list_length(ParallelApplyWorkerPool) <
+			max_parallel_apply_workers_per_subscription &&
+			TimestampDifferenceExceeds(last_launch_failure_time,
+									   GetCurrentTimestamp(),
+									   wal_retrieve_retry_interval))
+		{
+			ParallelApplyWorkerInfo *winfo = pa_launch_parallel_worker();
+
+			if (winfo)
+				return winfo;
+
+			last_launch_failure_time = GetCurrentTimestamp();
+		}
+
+		if (DispatchedXacts == NIL)
+			return NULL;
+
+		/* Wait for the oldest dispatched transaction to free its worker. */
+		pa_wait_for_xact_finish(((ParallelApplyDispatchedXact *) linitial(DispatchedXacts))->winfo);
+		pa_process_dispatched_xacts(false);
+	}
+}
+
+/*
+ * Send the RELATION messages that the worker has not seen yet.
+ */
+static void
+pa_send_relation_messages(ParallelApplyWorkerInfo *winfo)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplyRelationEntry *entry;
+
+	if (winfo->relation_msgs_sent == relation_msgs_seqno)
+		return;
+
+	hash_seq_init(&status, ParallelApplyRelationHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->seqno <= winfo->relation_msgs_sent)
+			continue;
+
+		if (!pa_send_data(winfo, entry->len, entry->data))
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("could not send data to shared-memory queue")));
+	}
+
+	winfo->relation_msgs_sent = relation_msgs_seqno;
+}
+
+/*
+ * Try to hand the collected non-streamed transaction, whose commit record
+ * ends at end_lsn, to a parallel apply worker.
+ *
+ * Returns false if it must be applied by the leader instead.
+ */
+static bool
+pa_dispatch_buffered_xact(XLogRecPtr end_lsn)
+{
+	ParallelApplyWorkerInfo *winfo;
+	ParallelApplyDispatchedXact *pred = NULL;
+	ParallelApplyDispatchedXact *dxact;
+	MemoryContext oldctx;
+	uint64		depends_on = 0;
+	int			offset = 0;
+	int			i;
+
+	/*
+	 * Recheck whether parallel apply is still allowed, and whether the
+	 * relations have changed, now that the whole transaction has arrived.
+	 */
+	AcceptInvalidationMessages();
+
+	if (!pa_can_dispatch_xacts() || !pa_buffered_relations_are_safe())
+		return false;
+
+	pa_process_dispatched_xacts(false);
+
+	/*
+	 * Wait for all in-flight transactions that changed a row with one of the
+	 * keys changed by this transaction. Since they finish in commit order, it
+	 * is enough to wait for the latest of them.
+	 */
+	if (ParallelApplyKeyHash != NULL && DispatchedXacts != NIL)
+	{
+		for (i = 0; i < buffered_nkeys; i++)
+		{
+			ParallelApplyKeyEntry *entry;
+
+			entry = hash_search(ParallelApplyKeyHash, &buffered_keys[i],
+								HASH_FIND, NULL);
+			if (entry && entry->seqno > depends_on)
+				depends_on = entry->seqno;
+		}
+
+		while (DispatchedXacts != NIL)
+		{
+			ParallelApplyDispatchedXact *oldest = linitial(DispatchedXacts);
+
+			if (oldest->seqno > depends_on)
+				break;
+
+			pa_wait_for_xact_finish(oldest->winfo);
+			pa_process_dispatched_xacts(false);
+		}
+	}
+
+	winfo = pa_get_worker_for_dispatch();
+	if (!winfo)
+		return false;
+
+	if (DispatchedXacts != NIL)
+		pred = llast(DispatchedXacts);
+
+	SpinLockAcquire(&winfo->shared->mutex);
+	winfo->shared->xact_state = PARALLEL_TRANS_UNKNOWN;
+	winfo->shared->xid = buffered_xid;
+	winfo->shared->preceding_xid = pred ? pred->xid : InvalidTransactionId;
+	winfo->shared->preceding_end_lsn = pred ? pred->end_lsn : InvalidXLogRecPtr;
+	SpinLockRelease(&winfo->shared->mutex);
+
+	winfo->in_use = true;
+	winfo->serialize_changes = false;
+
+	/*
+	 * The worker waits on the transaction lock of the preceding transaction
+	 * before committing, so make sure the preceding worker holds it by then.
+	 */
+	if (pred)
+		pa_wait_for_xact_state(pred->winfo, PARALLEL_TRANS_STARTED);
+
+	pa_send_relation_messages(winfo);
+
+	while (offset < xact_buffer.len)
+	{
+		int			len;
+
+		memcpy(&len, xact_buffer.data + offset, sizeof(int));
+		offset += sizeof(int);
+
+		if (!pa_send_data(winfo, len, xact_buffer.data + offset))
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("could not send data to shared-memory queue")));
+
+		offset += len;
+	}
+
+	/* Remember the transaction and the keys it changes. */
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+
+	dxact = palloc(sizeof(ParallelApplyDispatchedXact));
+	dxact->seqno = ++dispatched_xacts_seqno;
+	dxact->xid = buffered_xid;
+	dxact->end_lsn = end_lsn;
+	dxact->winfo = winfo;
+	dxact->nkeys = buffered_nkeys;
+	dxact->keys = NULL;
+	if (buffered_nkeys > 0)
+	{
+		dxact->keys = palloc(buffered_nkeys * sizeof(uint64));
+		memcpy(dxact->keys, buffered_keys, buffered_nkeys * sizeof(uint64));
+	}
+
+	DispatchedXacts = lappend(DispatchedXacts, dxact);
+
+	MemoryContextSwitchTo(oldctx);
+
+	if (ParallelApplyKeyHash == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(uint64);
+		ctl.entrysize = sizeof(ParallelApplyKeyEntry);
+		ctl.hcxt = ApplyContext;
+
+		ParallelApplyKeyHash = hash_create("logical replication parallel apply keys hash",
+										   1024, &ctl,
+										   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	for (i = 0; i < dxact->nkeys; i++)
+	{
+		ParallelApplyKeyEntry *entry;
+
+		entry = hash_search(ParallelApplyKeyHash, &dxact->keys[i],
+							HASH_ENTER, NULL);
+		entry->seqno = dxact->seqno;
+	}
+
+	elog(DEBUG1, "dispatched remote transaction %u to logical replication parallel apply worker",
+		 buffered_xid);
+
+	pa_reset_buffered_xact();
+
+	return true;
+}
+
+/*
+ * Handle a protocol message received by the leader apply worker, collecting
+ * non-streamed transactions that could be applied by parallel apply workers.
+ *
+ * s is the whole message, positioned at the message type. Returns true if the
+ * message has been consumed, false if the caller must apply it as usual.
+ */
+bool
+pa_handle_nonstreamed_message(StringInfo s)
+{
+	LogicalRepMsgType action;
+
+	if (!am_leader_apply_worker() || s->cursor >= s->len)
+		return false;
+
+	action = (LogicalRepMsgType) s->data[s->cursor];
+
+	if (!buffering_xact)
+	{
+		if (action == LOGICAL_REP_MSG_BEGIN && pa_can_dispatch_xacts())
+		{
+			StringInfoData msg = *s;
+			LogicalRepBeginData begin_data;
+
+			msg.cursor++;
+			logicalrep_read_begin(&msg, &begin_data);
+
+			pa_reset_buffered_xact();
+			buffering_xact = true;
+			buffered_xid = begin_data.xid;
+			pa_buffer_message(s);
+
+			return true;
+		}
+
+		/*
+		 * Anything else the leader applies itself must not run concurrently
+		 * with the dispatched transactions.
+		 */
+		pa_process_dispatched_xacts(true);
+
+		return false;
+	}
+
+	switch (action)
+	{
+		case LOGICAL_REP_MSG_INSERT:
+		case LOGICAL_REP_MSG_UPDATE:
+		case LOGICAL_REP_MSG_DELETE:
+			if (!pa_buffer_change_keys(action, s))
+				break;
+
+			pa_buffer_message(s);
+
+			/*
+			 * Don't let a large transaction fill up the memory of the leader
+			 * or the queue of the worker.
+			 */
+			if (xact_buffer_queue_size > DSM_QUEUE_SIZE / 2)
+				pa_apply_buffered_xact();
+			return true;
+
+		case LOGICAL_REP_MSG_ORIGIN:
+		case LOGICAL_REP_MSG_MESSAGE:
+			pa_buffer_message(s);
+			return true;
+
+		case LOGICAL_REP_MSG_COMMIT:
+			{
+				StringInfoData msg = *s;
+				LogicalRepCommitData commit_data;
+
+				msg.cursor++;
+				logicalrep_read_commit(&msg, &commit_data);
+
+				pa_buffer_message(s);
+
+				if (!pa_dispatch_buffered_xact(commit_data.end_lsn))
+					pa_apply_buffered_xact();
+
+				return true;
+			}
+
+		default:
+			break;
+	}
+
+	/* Apply what we have so far, and let the caller apply the rest. */
+	pa_apply_buffered_xact();
+
+	return false;
+}
+
+/*
+ * Process the non-streamed transactions that parallel apply workers have
+ * finished, in the order they were dispatched. If wait is true, wait for all
+ * of them to finish.
+ */
+void
+pa_process_dispatched_xacts(bool wait)
+{
+	while (DispatchedXacts != NIL)
+	{
+		ParallelApplyDispatchedXact *dxact = linitial(DispatchedXacts);
+		MemoryContext oldctx = CurrentMemoryContext;
+		int			i;
+
+		if (wait)
+			pa_wait_for_xact_finish(dxact->winfo);
+		else if (pa_get_xact_state(dxact->winfo->shared) != PARALLEL_TRANS_FINISHED)
+			break;
+
+		store_flush_position(dxact->end_lsn, dxact->winfo->shared->last_commit_end);
+		MemoryContextSwitchTo(oldctx);
+
+		/* Forget the keys unless a later transaction changed them too. */
+		for (i = 0; i < dxact->nkeys; i++)
+		{
+			ParallelApplyKeyEntry *entry;
+
+			entry = hash_search(ParallelApplyKeyHash, &dxact->keys[i],
+								HASH_FIND, NULL);
+			if (entry && entry->seqno == dxact->seqno)
+				hash_search(ParallelApplyKeyHash, &dxact->keys[i],
+							HASH_REMOVE, NULL);
+		}
+
+		dxact->winfo->in_use = false;
+
+		DispatchedXacts = list_delete_first(DispatchedXacts);
+		if (dxact->keys)
+			pfree(dxact->keys);
+		pfree(dxact);
+	}
+}
+
+/*
+ * Are there non-streamed transactions being applied by parallel apply
+ * workers?
+ */
+bool
+pa_have_dispatched_xacts(void)
+{
+	return DispatchedXacts != NIL;
+}
+
+/*
+ * Remember a RELATION message processed by the leader apply worker, so that
+ * it can be sent to parallel apply workers before they apply a non-streamed
+ * transaction changing the relation. data and len are the message contents
+ * following the message type.
+ */
+void
+pa_remember_relation_message(LogicalRepRelId remoteid, const char *data,
+							 int len)
+{
+	ParallelApplyRelationEntry *entry;
+	bool		found;
+	char	   *msg;
+	int			msglen = 1 + SIZE_STATS_MESSAGE + 1 + len;
+
+	if (!am_leader_apply_worker())
+		return;
+
+	if (ParallelApplyRelationHash == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(LogicalRepRelId);
+		ctl.entrysize = sizeof(ParallelApplyRelationEntry);
+		ctl.hcxt = ApplyContext;
+
+		ParallelApplyRelationHash = hash_create("logical replication parallel apply relations hash",
+												128, &ctl,
+												HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = hash_search(ParallelApplyRelationHash, &remoteid, HASH_ENTER,
+						&found);
+	if (found)
+		pfree(entry->data);
+
+	/*
+	 * Build the message the way the worker expects it, i.e. as a 'w' message
+	 * with (ignored) statistics fields.
+	 */
+	msg = MemoryContextAllocZero(ApplyContext, msglen);
+	msg[0] = 'w';
+	msg[1 + SIZE_STATS_MESSAGE] = LOGICAL_REP_MSG_RELATION;
+	memcpy(msg + 1 + SIZE_STATS_MESSAGE + 1, data, len);
+
+	entry->seqno = ++relation_msgs_seqno;
+	entry->len = msglen;
+	entry->data = msg;
+}
+
+/*
+ * Wait for the non-streamed transaction that has to be committed before the
+ * one being applied by this parallel apply worker, if any.
+ */
+void
+pa_wait_for_preceding_xact(void)
+{
+	TransactionId preceding_xid;
+	XLogRecPtr	preceding_end_lsn;
+
+	Assert(am_parallel_apply_worker());
+
+	SpinLockAcquire(&MyParallelShared->mutex);
+	preceding_xid = MyParallelShared->preceding_xid;
+	preceding_end_lsn = MyParallelShared->preceding_end_lsn;
+	SpinLockRelease(&MyParallelShared->mutex);
+
+	/*
+	 * Make sure the transaction writes a commit record, even if it ended up
+	 * not changing anything, so that it advances the replication origin and
+	 * the check below works for the transaction following this one.
+	 */
+	if (!IsTransactionState())
+		StartTransactionCommand();
+	(void) GetCurrentTransactionId();
+
+	if (!TransactionIdIsValid(preceding_xid))
+		return;
+
+	pa_lock_transaction(preceding_xid, AccessShareLock);
+	pa_unlock_transaction(preceding_xid, AccessShareLock);
+
+	/*
+	 * The lock is also released if the worker applying the preceding
+	 * transaction failed, in which case we must not commit either.
+	 */
+	if (replorigin_session_get_progress(false) < preceding_end_lsn)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("logical replication parallel apply worker could not apply remote transaction %u because the preceding transaction %u was not committed",
+						MyParallelShared->xid, preceding_xid)));
+}
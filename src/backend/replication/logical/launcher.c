@@ -50,6 +50,7 @@
 int			max_logical_replication_workers = 4;
 int			max_sync_workers_per_subscription = 2;
 int			max_parallel_apply_workers_per_subscription = 2;
+bool		parallel_apply_non_streamed = false;
 
 LogicalRepWorker *MyLogicalRepWorker = NULL;
 
@@ -24,11 +24,14 @@
 #include "access/table.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_subscription_rel.h"
+#include "catalog/pg_type.h"
+#include "commands/trigger.h"
 #include "executor/executor.h"
 #include "nodes/makefuncs.h"
 #include "replication/logicalrelation.h"
 #include "replication/worker_internal.h"
 #include "utils/inval.h"
+#include "utils/lsyscache.h"
 
 
 static MemoryContext LogicalRepRelMapContext = NULL;
@@ -318,6 +321,151 @@ logicalrep_rel_mark_updatable(LogicalRepRelMapEntry *entry)
 	}
 }
 
+/*
+ * Does equality of values of the given built-in type imply that their output
+ * representations are identical?
+ *
+ * The leader apply worker compares the remote replica identity key values of
+ * changes as sent by the publisher to find dependencies between transactions,
+ * so this must hold for all key columns of a relation whose changes are
+ * applied in parallel.  (Counterexamples are numeric, where 1.0 = 1.00, and
+ * interval, where '1 day' = '24 hours'.)
+ */
+static bool
+logicalrep_type_has_canonical_output(Oid typid)
+{
+	switch (typid)
+	{
+		case BOOLOID:
+		case CHAROID:
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case OIDOID:
+		case TEXTOID:
+		case VARCHAROID:
+		case BYTEAOID:
+		case UUIDOID:
+		case DATEOID:
+		case TIMEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Set if changes to the relation can be applied by a parallel apply worker
+ * concurrently with other non-streamed transactions.
+ *
+ * The leader apply worker only considers two transactions dependent if they
+ * change rows with the same remote replica identity key (see
+ * applyparallelworker.c).  That is only good enough if nothing on the
+ * subscriber makes changes to rows with different keys interfere with each
+ * other, so we give up on partitioned tables, on tables with triggers that
+ * fire during replication, and on tables with unique or exclusion indexes
+ * that could report conflicts between rows with different keys.  The key
+ * columns themselves must have the same type on both sides, and a type and
+ * collation for which equal values have identical representations.
+ */
+static void
+logicalrep_rel_mark_parallel_apply_safe(LogicalRepRelMapEntry *entry)
+{
+	Relation	rel = entry->localrel;
+	LogicalRepRelation *remoterel = &entry->remoterel;
+	TupleDesc	desc = RelationGetDescr(rel);
+	List	   *indexlist;
+	int			i;
+
+	entry->parallel_apply_safe = false;
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION)
+		return;
+
+	/* Without a key we cannot tell which rows a change conflicts with. */
+	if (bms_is_empty(remoterel->attkeys))
+		return;
+
+	if (rel->trigdesc)
+	{
+		for (i = 0; i < rel->trigdesc->numtriggers; i++)
+		{
+			char		tgenabled = rel->trigdesc->triggers[i].tgenabled;
+
+			if (tgenabled == TRIGGER_FIRES_ALWAYS ||
+				tgenabled == TRIGGER_FIRES_ON_REPLICA)
+				return;
+		}
+	}
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(desc, i);
+		int			remoteattnum = entry->attrmap->attnums[i];
+
+		if (remoteattnum < 0 ||
+			!bms_is_member(remoteattnum, remoterel->attkeys))
+			continue;
+
+		if (attr->atttypid != remoterel->atttyps[remoteattnum] ||
+			!logicalrep_type_has_canonical_output(attr->atttypid))
+			return;
+
+		if (OidIsValid(attr->attcollation) &&
+			!get_collation_isdeterministic(attr->attcollation))
+			return;
+	}
+
+	/*
+	 * Two rows can only conflict in a unique index if they agree on all its
+	 * key columns, so it is enough that those include the remote key.
+	 */
+	indexlist = RelationGetIndexList(rel);
+
+	foreach_oid(idxoid, indexlist)
+	{
+		Relation	idxrel;
+		Form_pg_index index;
+		Bitmapset  *indexkeys = NULL;
+		bool		covered = true;
+
+		idxrel = index_open(idxoid, AccessShareLock);
+		index = idxrel->rd_index;
+
+		if (index->indisexclusion)
+			covered = false;
+		else if (index->indisunique)
+		{
+			for (i = 0; i < index->indnkeyatts; i++)
+			{
+				AttrNumber	attnum = index->indkey.values[i];
+
+				if (AttributeNumberIsValid(attnum) &&
+					entry->attrmap->attnums[AttrNumberGetAttrOffset(attnum)] >= 0)
+					indexkeys = bms_add_member(indexkeys,
+											   entry->attrmap->attnums[AttrNumberGetAttrOffset(attnum)]);
+			}
+
+			covered = bms_is_subset(remoterel->attkeys, indexkeys);
+			bms_free(indexkeys);
+		}
+
+		index_close(idxrel, AccessShareLock);
+
+		if (!covered)
+		{
+			list_free(indexlist);
+			return;
+		}
+	}
+
+	list_free(indexlist);
+
+	entry->parallel_apply_safe = true;
+}
+
 /*
  * Open the local relation associated with the remote one.
  *
@@ -455,6 +603,8 @@ logicalrep_rel_open(LogicalRepRelId remoteid, LOCKMODE lockmode)
 		entry->localindexoid = FindLogicalRepLocalIndex(entry->localrel, remoterel,
 														entry->attrmap);
 
+		logicalrep_rel_mark_parallel_apply_safe(entry);
+
 		entry->localrelvalid = true;
 	}
 
@@ -466,6 +616,22 @@ logicalrep_rel_open(LogicalRepRelId remoteid, LOCKMODE lockmode)
 	return entry;
 }
 
+/*
+ * Look up the relation map entry for the remote relation without opening the
+ * local relation.
+ *
+ * Returns NULL if no RELATION message has been received for it yet.  The
+ * local information in the entry is only meaningful if localrelvalid is set.
+ */
+LogicalRepRelMapEntry *
+logicalrep_rel_lookup(LogicalRepRelId remoteid)
+{
+	if (LogicalRepRelMap == NULL)
+		return NULL;
+
+	return hash_search(LogicalRepRelMap, &remoteid, HASH_FIND, NULL);
+}
+
 /*
  * Close the previously opened logical relation.
  */
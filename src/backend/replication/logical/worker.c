@@ -58,7 +58,9 @@
  *
  * This approach is used when the user has set the subscription's streaming
  * option as parallel. See logical/applyparallelworker.c for information about
- * this approach.
+ * this approach. If parallel_apply_non_streamed is enabled, the parallel apply
+ * workers are also used for regular transactions that are independent of the
+ * ones still being applied, see pa_handle_nonstreamed_message().
  *
  * TWO_PHASE TRANSACTIONS
  * ----------------------
@@ -189,6 +191,7 @@
 #include "utils/pg_lsn.h"
 #include "utils/rel.h"
 #include "utils/rls.h"
+#include "utils/sharedresultcache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 #include "utils/usercontext.h"
@@ -567,6 +570,14 @@ handle_streamed_transaction(LogicalRepMsgType action, StringInfo s)
 	if (apply_action == TRANS_LEADER_APPLY)
 		return false;
 
+	/*
+	 * A parallel apply worker applying a non-streamed transaction (see
+	 * pa_handle_nonstreamed_message()) receives the changes as usual.
+	 */
+	if (apply_action == TRANS_PARALLEL_APPLY &&
+		!TransactionIdIsValid(stream_xid))
+		return false;
+
 	Assert(TransactionIdIsValid(stream_xid));
 
 	/*
@@ -677,6 +688,7 @@ create_edata_for_relation(LogicalRepRelMapEntry *rel)
 	 * again.
 	 */
 	InitResultRelInfo(resultRelInfo, rel->localrel, 1, NULL, 0);
+	SharedResultCacheNoteWrite(rel->localrel);
 
 	/*
 	 * We put the ResultRelInfo in the es_opened_result_relations list, even
@@ -1000,6 +1012,16 @@ apply_handle_begin(StringInfo s)
 
 	maybe_start_skipping_changes(begin_data.final_lsn);
 
+	/*
+	 * The transaction has been handed to us by the leader apply worker. Lock
+	 * it the same way as a streamed one, see pa_wait_for_xact_finish().
+	 */
+	if (am_parallel_apply_worker())
+	{
+		pa_lock_transaction(MyParallelShared->xid, AccessExclusiveLock);
+		pa_set_xact_state(MyParallelShared, PARALLEL_TRANS_STARTED);
+	}
+
 	in_remote_transaction = true;
 
 	pgstat_report_activity(STATE_RUNNING, NULL);
@@ -1024,7 +1046,28 @@ apply_handle_commit(StringInfo s)
 								 LSN_FORMAT_ARGS(commit_data.commit_lsn),
 								 LSN_FORMAT_ARGS(remote_final_lsn))));
 
-	apply_handle_commit_internal(&commit_data);
+	if (am_parallel_apply_worker())
+	{
+		TransactionId xid = MyParallelShared->xid;
+
+		/* Preserve the commit order of non-streamed transactions. */
+		pa_wait_for_preceding_xact();
+
+		apply_handle_commit_internal(&commit_data);
+
+		MyParallelShared->last_commit_end = XactLastCommitEnd;
+
+		/*
+		 * It is important to set the transaction state as finished before
+		 * releasing the lock. See pa_wait_for_xact_finish.
+		 */
+		pa_set_xact_state(MyParallelShared, PARALLEL_TRANS_FINISHED);
+		pa_unlock_transaction(xid, AccessExclusiveLock);
+
+		pa_reset_subtrans();
+	}
+	else
+		apply_handle_commit_internal(&commit_data);
 
 	/* Process any tables that are being synchronized in parallel. */
 	process_syncing_tables(commit_data.end_lsn);
@@ -2322,13 +2365,19 @@ static void
 apply_handle_relation(StringInfo s)
 {
 	LogicalRepRelation *rel;
+	int			body_start;
 
 	if (handle_streamed_transaction(LOGICAL_REP_MSG_RELATION, s))
 		return;
 
+	body_start = s->cursor;
 	rel = logicalrep_read_rel(s);
 	logicalrep_relmap_update(rel);
 
+	/* Parallel apply workers may need it for non-streamed transactions. */
+	pa_remember_relation_message(rel->remoteid, s->data + body_start,
+								 s->len - body_start);
+
 	/* Also reset all entries in the partition map that refer to remoterel. */
 	logicalrep_partmap_reset_relmap(rel);
 }
@@ -3518,7 +3567,8 @@ get_flush_position(XLogRecPtr *write, XLogRecPtr *flush,
 		}
 	}
 
-	*have_pending_txes = !dlist_is_empty(&lsn_mapping);
+	*have_pending_txes = !dlist_is_empty(&lsn_mapping) ||
+		pa_have_dispatched_xacts();
 }
 
 /*
@@ -3676,7 +3726,8 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 
 						UpdateWorkerStats(last_received, send_time, false);
 
-						apply_dispatch(&s);
+						if (!pa_handle_nonstreamed_message(&s))
+							apply_dispatch(&s);
 					}
 					else if (c == 'k')
 					{
@@ -3703,6 +3754,9 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 			}
 		}
 
+		/* Collect the transactions finished by parallel apply workers. */
+		pa_process_dispatched_xacts(false);
+
 		/* confirm all writes so far */
 		send_feedback(last_received, false, false);
 
@@ -3716,6 +3770,13 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 			AcceptInvalidationMessages();
 			maybe_reread_subscription();
 
+			/*
+			 * Table synchronization assumes that everything received so far
+			 * has been applied.
+			 */
+			if (pa_have_dispatched_xacts() && !AllTablesyncsReady())
+				pa_process_dispatched_xacts(true);
+
 			/* Process any table synchronization changes. */
 			process_syncing_tables(last_received);
 		}
@@ -3735,7 +3796,7 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 		 * no particular urgency about waking up unless we get data or a
 		 * signal.
 		 */
-		if (!dlist_is_empty(&lsn_mapping))
+		if (!dlist_is_empty(&lsn_mapping) || pa_have_dispatched_xacts())
 			wait_time = WalWriterDelay;
 		else
 			wait_time = NAPTIME_PER_CYCLE;
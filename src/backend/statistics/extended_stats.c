@@ -20,15 +20,19 @@
 #include "access/genam.h"
 #include "access/htup_details.h"
 #include "access/table.h"
+#include "access/tableam.h"
 #include "catalog/indexing.h"
+#include "catalog/pg_constraint.h"
 #include "catalog/pg_statistic_ext.h"
 #include "catalog/pg_statistic_ext_data.h"
 #include "commands/defrem.h"
 #include "commands/progress.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
+#include "parser/parse_coerce.h"
 #include "parser/parsetree.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
@@ -43,7 +47,9 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/rls.h"
 #include "utils/selfuncs.h"
+#include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
 /*
@@ -70,10 +76,21 @@ typedef struct StatExtEntry
 	List	   *types;			/* 'char' list of enabled statistics kinds */
 	int			stattarget;		/* statistics target (-1 for default) */
 	List	   *exprs;			/* expressions */
+	Oid			fkey;			/* foreign key of a join, or InvalidOid */
 } StatExtEntry;
 
 
-static List *fetch_statentries_for_relation(Relation pg_statext, Oid relid);
+static List *fetch_statentries_for_relation(Relation pg_statext, Oid relid,
+											Oid fkey);
+static List *fetch_fkey_statentries(Relation pg_statext, Relation onerel);
+static void build_fkey_join_statistics(Relation onerel, double totalrows,
+									   int numrows, HeapTuple *rows,
+									   List *statslist);
+static StatsBuildData *make_fkey_join_build_data(Relation onerel,
+												 StatExtEntry *stat,
+												 ForeignKeyCacheInfo *fk,
+												 int numrows, HeapTuple *rows,
+												 int stattarget);
 static VacAttrStats **lookup_var_attr_stats(Relation rel, Bitmapset *attrs, List *exprs,
 											int nvacatts, VacAttrStats **vacatts);
 static void statext_store(Oid statOid, bool inh,
@@ -126,7 +143,8 @@ BuildRelationExtStatistics(Relation onerel, bool inh, double totalrows,
 
 	/* the list of stats has to be allocated outside the memory context */
 	pg_stext = table_open(StatisticExtRelationId, RowExclusiveLock);
-	statslist = fetch_statentries_for_relation(pg_stext, RelationGetRelid(onerel));
+	statslist = fetch_statentries_for_relation(pg_stext, RelationGetRelid(onerel),
+											   InvalidOid);
 
 	/* memory context for building each statistics object */
 	cxt = AllocSetContextCreate(CurrentMemoryContext,
@@ -245,6 +263,20 @@ BuildRelationExtStatistics(Relation onerel, bool inh, double totalrows,
 
 	list_free(statslist);
 
+	/*
+	 * Statistics on joins along this table's foreign keys are built from the
+	 * same sample.  They describe the sampled rows themselves, so there's
+	 * nothing to build them from when analyzing an inheritance tree.
+	 */
+	if (!inh)
+	{
+		statslist = fetch_fkey_statentries(pg_stext, onerel);
+		if (statslist != NIL)
+			build_fkey_join_statistics(onerel, totalrows, numrows, rows,
+									   statslist);
+		list_free(statslist);
+	}
+
 	table_close(pg_stext, RowExclusiveLock);
 }
 
@@ -282,7 +314,8 @@ ComputeExtStatisticsRows(Relation onerel,
 	oldcxt = MemoryContextSwitchTo(cxt);
 
 	pg_stext = table_open(StatisticExtRelationId, RowExclusiveLock);
-	lstats = fetch_statentries_for_relation(pg_stext, RelationGetRelid(onerel));
+	lstats = fetch_statentries_for_relation(pg_stext, RelationGetRelid(onerel),
+											InvalidOid);
 
 	foreach(lc, lstats)
 	{
@@ -314,6 +347,23 @@ ComputeExtStatisticsRows(Relation onerel,
 			result = stattarget;
 	}
 
+	/*
+	 * Statistics on joins along the table's foreign keys are built from its
+	 * sample too.  We know nothing about the referenced columns' targets
+	 * here, so only the object's own target or the default applies.
+	 */
+	lstats = fetch_fkey_statentries(pg_stext, onerel);
+	foreach(lc, lstats)
+	{
+		StatExtEntry *stat = (StatExtEntry *) lfirst(lc);
+		int			stattarget;
+
+		stattarget = statext_compute_stattarget(stat->stattarget, 0, NULL);
+
+		if (stattarget > result)
+			result = stattarget;
+	}
+
 	table_close(pg_stext, RowExclusiveLock);
 
 	MemoryContextSwitchTo(oldcxt);
@@ -417,9 +467,12 @@ statext_is_kind_built(HeapTuple htup, char type)
 
 /*
  * Return a list (of StatExtEntry) of statistics objects for the given relation.
+ *
+ * With a valid fkey, only statistics on the join along that foreign key are
+ * returned, otherwise only statistics on the relation alone.
  */
 static List *
-fetch_statentries_for_relation(Relation pg_statext, Oid relid)
+fetch_statentries_for_relation(Relation pg_statext, Oid relid, Oid fkey)
 {
 	SysScanDesc scan;
 	ScanKeyData skey;
@@ -449,9 +502,13 @@ fetch_statentries_for_relation(Relation pg_statext, Oid relid)
 		Form_pg_statistic_ext staForm;
 		List	   *exprs = NIL;
 
-		entry = palloc0(sizeof(StatExtEntry));
 		staForm = (Form_pg_statistic_ext) GETSTRUCT(htup);
+		if (staForm->stxfkey != fkey)
+			continue;
+
+		entry = palloc0(sizeof(StatExtEntry));
 		entry->statOid = staForm->oid;
+		entry->fkey = staForm->stxfkey;
 		entry->schema = get_namespace_name(staForm->stxnamespace);
 		entry->name = pstrdup(NameStr(staForm->stxname));
 		for (i = 0; i < staForm->stxkeys.dim1; i++)
@@ -518,6 +575,28 @@ fetch_statentries_for_relation(Relation pg_statext, Oid relid)
 	return result;
 }
 
+/*
+ * Return a list (of StatExtEntry) of statistics objects on joins along the
+ * foreign keys of the given relation.  These are stored with the referenced
+ * tables, but built when analyzing the referencing one.
+ */
+static List *
+fetch_fkey_statentries(Relation pg_statext, Relation onerel)
+{
+	List	   *fkeys = copyObject(RelationGetFKeyList(onerel));
+	List	   *result = NIL;
+
+	foreach_node(ForeignKeyCacheInfo, fk, fkeys)
+		result = list_concat(result,
+							 fetch_statentries_for_relation(pg_statext,
+															fk->confrelid,
+															fk->conoid));
+
+	list_free_deep(fkeys);
+
+	return result;
+}
+
 /*
  * examine_attribute -- pre-analysis of a single column
  *
@@ -2039,6 +2118,102 @@ statext_clauselist_selectivity(PlannerInfo *root, List *clauses, int varRelid,
 	return sel;
 }
 
+/*
+ * statext_fkey_join_correction
+ *		Correct the selectivity of a join along a foreign key for the way the
+ *		referencing rows are distributed over the referenced table.
+ *
+ * The foreign key join estimate treats the restriction clauses on the
+ * referenced table (ref_rel) as filtering the referencing rows by their
+ * selectivity on that table.  If there's an MCV list built on the join, for
+ * the columns those clauses use, it tells what fraction of the referencing
+ * rows actually satisfy them.  We return the ratio between the two, which the
+ * caller multiplies into its estimate, or 1.0 if there are no applicable
+ * statistics.
+ */
+Selectivity
+statext_fkey_join_correction(PlannerInfo *root, RelOptInfo *ref_rel,
+							 Index con_relid, Oid conoid)
+{
+	RangeTblEntry *rte = planner_rt_fetch(ref_rel->relid, root);
+	RangeTblEntry *con_rte = planner_rt_fetch(con_relid, root);
+	Oid			userid;
+	StatisticExtInfo *stat = NULL;
+	List	   *stat_clauses = NIL;
+	Selectivity ref_sel;
+	Selectivity mcv_sel;
+	Selectivity mcv_basesel;
+	Selectivity mcv_totalsel;
+	Selectivity sel;
+	ListCell   *lc;
+
+	/* statistics on a join are never built with inheritance */
+	if (rte->inh)
+		return 1.0;
+
+	/*
+	 * The MCV list describes how the referencing rows are distributed, so
+	 * the user must be able to read both tables, and must not be subject to
+	 * row-level security on the referencing one.
+	 */
+	userid = OidIsValid(ref_rel->userid) ? ref_rel->userid : GetUserId();
+	if (pg_class_aclcheck(rte->relid, userid, ACL_SELECT) != ACLCHECK_OK ||
+		pg_class_aclcheck(con_rte->relid, userid, ACL_SELECT) != ACLCHECK_OK ||
+		check_enable_rls(con_rte->relid, userid, true) == RLS_ENABLED)
+		return 1.0;
+
+	/* pick the statistics covering the most restriction clauses */
+	foreach(lc, ref_rel->fkeystatlist)
+	{
+		StatisticExtInfo *info = (StatisticExtInfo *) lfirst(lc);
+		List	   *clauses = NIL;
+		ListCell   *lc2;
+
+		if (info->fkey != conoid || info->kind != STATS_EXT_MCV)
+			continue;
+
+		foreach(lc2, ref_rel->baserestrictinfo)
+		{
+			Node	   *clause = (Node *) lfirst(lc2);
+			Bitmapset  *attnums = NULL;
+			List	   *exprs = NIL;
+
+			if (statext_is_compatible_clause(root, clause, ref_rel->relid,
+											 &attnums, &exprs) &&
+				exprs == NIL && bms_is_subset(attnums, info->keys))
+				clauses = lappend(clauses, clause);
+		}
+
+		if (list_length(clauses) > list_length(stat_clauses))
+		{
+			stat = info;
+			stat_clauses = clauses;
+		}
+	}
+
+	if (stat == NULL)
+		return 1.0;
+
+	/* the selectivity the caller's estimate implies for these clauses */
+	ref_sel = clauselist_selectivity(root, stat_clauses, 0, JOIN_INNER, NULL);
+	if (ref_sel <= 0.0)
+		return 1.0;
+
+	/*
+	 * The MCV list gives the fraction of referencing rows matching the
+	 * clauses through its items; for the rest, assume the referenced table's
+	 * own selectivity applies.
+	 */
+	mcv_sel = mcv_clauselist_selectivity(root, stat, stat_clauses,
+										 ref_rel->relid, JOIN_INNER, NULL,
+										 ref_rel, &mcv_basesel, &mcv_totalsel);
+
+	sel = mcv_sel + (1.0 - mcv_totalsel) * ref_sel;
+	CLAMP_PROBABILITY(sel);
+
+	return sel / ref_sel;
+}
+
 /*
  * examine_opclause_args
  *		Split an operator expression's arguments into Expr and Const parts.
@@ -2635,3 +2810,246 @@ make_build_data(Relation rel, StatExtEntry *stat, int numrows, HeapTuple *rows,
 
 	return result;
 }
+
+/*
+ * Build statistics on joins along the foreign keys of onerel, from the rows
+ * sampled from it.
+ *
+ * For each sampled row, we look up the referenced row using the unique index
+ * backing the foreign key, and build the MCV list from the values of the
+ * referenced row.  Rows with NULLs in the foreign key columns don't join, and
+ * are left out just like rows whose referenced row we can't see.
+ */
+static void
+build_fkey_join_statistics(Relation onerel, double totalrows,
+						   int numrows, HeapTuple *rows, List *statslist)
+{
+	List	   *fkeys = copyObject(RelationGetFKeyList(onerel));
+	MemoryContext cxt;
+	MemoryContext oldcxt;
+	ListCell   *lc;
+
+	/* memory context for building each statistics object */
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								"build_fkey_join_statistics",
+								ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(cxt);
+
+	foreach(lc, statslist)
+	{
+		StatExtEntry *stat = (StatExtEntry *) lfirst(lc);
+		ForeignKeyCacheInfo *fk = NULL;
+		StatsBuildData *data;
+		MCVList    *mcv;
+		int			stattarget;
+
+		foreach_node(ForeignKeyCacheInfo, fkinfo, fkeys)
+		{
+			if (fkinfo->conoid == stat->fkey)
+				fk = fkinfo;
+		}
+		Assert(fk != NULL);
+
+		stattarget = statext_compute_stattarget(stat->stattarget, 0, NULL);
+		if (stattarget == 0)
+			continue;
+
+		data = make_fkey_join_build_data(onerel, stat, fk, numrows, rows,
+										 stattarget);
+		if (data == NULL)
+		{
+			if (!AmAutoVacuumWorkerProcess())
+				ereport(WARNING,
+						(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+						 errmsg("statistics object \"%s.%s\" could not be computed for relation \"%s.%s\"",
+								stat->schema, stat->name,
+								get_namespace_name(onerel->rd_rel->relnamespace),
+								RelationGetRelationName(onerel)),
+						 errtable(onerel)));
+			MemoryContextReset(cxt);
+			continue;
+		}
+
+		/* scale the table size to the rows that joined */
+		if (data->numrows > 0)
+		{
+			mcv = statext_mcv_build(data, totalrows * data->numrows / numrows,
+									stattarget);
+			statext_store(stat->statOid, false, NULL, NULL, mcv, (Datum) 0,
+						  data->stats);
+		}
+
+		/* free the data used for building this statistics object */
+		MemoryContextReset(cxt);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(cxt);
+
+	list_free_deep(fkeys);
+}
+
+/*
+ * Fetch the values of the statistics columns from the referenced rows of the
+ * sampled rows, for building statistics on a foreign key join.
+ *
+ * Returns NULL if the referenced table can't be probed with the values of the
+ * foreign key columns as they are, or if one of the columns can't be
+ * analyzed.
+ */
+static StatsBuildData *
+make_fkey_join_build_data(Relation onerel, StatExtEntry *stat,
+						  ForeignKeyCacheInfo *fk, int numrows,
+						  HeapTuple *rows, int stattarget)
+{
+	StatsBuildData *result;
+	int			nkeys = bms_num_members(stat->columns);
+	int			fkcol[INDEX_MAX_KEYS];
+	ScanKeyData skey[INDEX_MAX_KEYS];
+	HeapTuple	contup;
+	Oid			indexoid;
+	Relation	refrel;
+	Relation	indexrel;
+	int			nindexkeys;
+	IndexScanDesc scan;
+	TupleTableSlot *slot;
+	Snapshot	snapshot;
+	int			nmatched = 0;
+	int			i;
+	int			k;
+	int			idx;
+
+	contup = SearchSysCache1(CONSTROID, ObjectIdGetDatum(fk->conoid));
+	if (!HeapTupleIsValid(contup))
+		elog(ERROR, "cache lookup failed for constraint %u", fk->conoid);
+	indexoid = ((Form_pg_constraint) GETSTRUCT(contup))->conindid;
+	ReleaseSysCache(contup);
+
+	refrel = table_open(fk->confrelid, AccessShareLock);
+	indexrel = index_open(indexoid, AccessShareLock);
+	nindexkeys = IndexRelationGetNumberOfKeyAttributes(indexrel);
+
+	/*
+	 * Set up a scan key for each column of the index, comparing it with the
+	 * foreign key column it's referenced by.  The constraint's PK = FK
+	 * operators belong to the index's operator families.
+	 */
+	for (i = 0; i < nindexkeys; i++)
+	{
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+		Oid			fktype;
+
+		for (k = 0; k < fk->nkeys; k++)
+		{
+			if (fk->confkey[k] == indexrel->rd_index->indkey.values[i])
+				break;
+		}
+		if (k >= fk->nkeys)
+			elog(ERROR, "index %u does not match foreign key %u",
+				 indexoid, fk->conoid);
+
+		get_op_opfamily_properties(fk->conpfeqop[k],
+								   indexrel->rd_opfamily[i], false,
+								   &strategy, &lefttype, &righttype);
+
+		/* the foreign key values must be usable without conversion */
+		fktype = TupleDescAttr(RelationGetDescr(onerel),
+							   fk->conkey[k] - 1)->atttypid;
+		if (!IsBinaryCoercible(fktype, righttype))
+		{
+			index_close(indexrel, AccessShareLock);
+			table_close(refrel, AccessShareLock);
+			return NULL;
+		}
+
+		ScanKeyEntryInitialize(&skey[i], 0, i + 1, strategy, righttype,
+							   indexrel->rd_indcollation[i],
+							   get_opcode(fk->conpfeqop[k]), (Datum) 0);
+		fkcol[i] = fk->conkey[k];
+	}
+
+	/* allocate the arrays for the worst case of all the rows joining */
+	result = palloc(sizeof(StatsBuildData));
+	result->nattnums = nkeys;
+	result->attnums = palloc(sizeof(AttrNumber) * nkeys);
+	result->stats = palloc(sizeof(VacAttrStats *) * nkeys);
+	result->values = palloc(sizeof(Datum *) * nkeys);
+	result->nulls = palloc(sizeof(bool *) * nkeys);
+
+	idx = 0;
+	k = -1;
+	while ((k = bms_next_member(stat->columns, k)) >= 0)
+	{
+		Form_pg_attribute attr = TupleDescAttr(RelationGetDescr(refrel), k - 1);
+		Var		   *var;
+
+		var = makeVar(1, k, attr->atttypid, attr->atttypmod,
+					  attr->attcollation, 0);
+
+		result->attnums[idx] = k;
+		result->stats[idx] = examine_expression((Node *) var, stattarget);
+		if (result->stats[idx] == NULL)
+		{
+			index_close(indexrel, AccessShareLock);
+			table_close(refrel, AccessShareLock);
+			return NULL;
+		}
+		result->values[idx] = palloc(sizeof(Datum) * numrows);
+		result->nulls[idx] = palloc(sizeof(bool) * numrows);
+
+		idx++;
+	}
+
+	snapshot = RegisterSnapshot(GetTransactionSnapshot());
+	scan = index_beginscan(refrel, indexrel, snapshot, nindexkeys, 0);
+	slot = table_slot_create(refrel, NULL);
+
+	for (i = 0; i < numrows; i++)
+	{
+		bool		hasnull = false;
+
+		vacuum_delay_point();
+
+		for (k = 0; k < nindexkeys; k++)
+		{
+			bool		isnull;
+
+			skey[k].sk_argument = heap_getattr(rows[i], fkcol[k],
+											   RelationGetDescr(onerel),
+											   &isnull);
+			hasnull |= isnull;
+		}
+		if (hasnull)
+			continue;
+
+		index_rescan(scan, skey, nindexkeys, NULL, 0);
+		if (!index_getnext_slot(scan, ForwardScanDirection, slot))
+			continue;
+
+		for (idx = 0; idx < nkeys; idx++)
+		{
+			VacAttrStats *stats = result->stats[idx];
+			bool		isnull;
+			Datum		value;
+
+			value = slot_getattr(slot, result->attnums[idx], &isnull);
+			result->nulls[idx][nmatched] = isnull;
+			result->values[idx][nmatched] = isnull ? (Datum) 0 :
+				datumCopy(value, stats->attrtype->typbyval,
+						  stats->attrtype->typlen);
+		}
+		nmatched++;
+	}
+
+	result->numrows = nmatched;
+
+	ExecDropSingleTupleTableSlot(slot);
+	index_endscan(scan);
+	UnregisterSnapshot(snapshot);
+	index_close(indexrel, AccessShareLock);
+	table_close(refrel, AccessShareLock);
+
+	return result;
+}
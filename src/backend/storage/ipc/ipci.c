@@ -16,6 +16,7 @@
 
 #include "access/clog.h"
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
 #include "access/subtrans.h"
@@ -31,6 +32,7 @@
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/connproxy.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/walsummarizer.h"
 #include "replication/logicallauncher.h"
@@ -51,8 +53,12 @@
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
+#include "tcop/backend_pool.h"
 #include "utils/guc.h"
 #include "utils/injection_point.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
+#include "utils/sharedresultcache.h"
 
 /* GUCs */
 int			shared_memory_type = DEFAULT_SHARED_MEMORY_TYPE;
@@ -126,13 +132,19 @@ CalculateShmemSize(int *num_semaphores)
 	size = add_size(size, CLOGShmemSize());
 	size = add_size(size, CommitTsShmemSize());
 	size = add_size(size, SUBTRANSShmemSize());
+	size = add_size(size, CSNLogShmemSize());
 	size = add_size(size, TwoPhaseShmemSize());
 	size = add_size(size, BackgroundWorkerShmemSize());
+	size = add_size(size, ConnProxyShmemSize());
+	size = add_size(size, BackendPoolShmemSize());
 	size = add_size(size, MultiXactShmemSize());
 	size = add_size(size, LWLockShmemSize());
 	size = add_size(size, ProcArrayShmemSize());
 	size = add_size(size, BackendStatusShmemSize());
 	size = add_size(size, SharedInvalShmemSize());
+	size = add_size(size, SharedCatCacheShmemSize());
+	size = add_size(size, SharedPlanCacheShmemSize());
+	size = add_size(size, SharedResultCacheShmemSize());
 	size = add_size(size, PMSignalShmemSize());
 	size = add_size(size, ProcSignalShmemSize());
 	size = add_size(size, CheckpointerShmemSize());
@@ -291,6 +303,7 @@ CreateOrAttachShmemStructs(void)
 	CLOGShmemInit();
 	CommitTsShmemInit();
 	SUBTRANSShmemInit();
+	CSNLogShmemInit();
 	MultiXactShmemInit();
 	BufferManagerShmemInit();
 
@@ -313,11 +326,16 @@ CreateOrAttachShmemStructs(void)
 	BackendStatusShmemInit();
 	TwoPhaseShmemInit();
 	BackgroundWorkerShmemInit();
+	ConnProxyShmemInit();
+	BackendPoolShmemInit();
 
 	/*
 	 * Set up shared-inval messaging
 	 */
 	SharedInvalShmemInit();
+	SharedCatCacheShmemInit();
+	SharedPlanCacheShmemInit();
+	SharedResultCacheShmemInit();
 
 	/*
 	 * Set up interprocess signaling mechanisms
@@ -47,6 +47,7 @@
 
 #include <signal.h>
 
+#include "access/csnlog.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/twophase.h"
@@ -364,6 +365,8 @@ static inline void ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId l
 static void ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid);
 static void MaintainLatestCompletedXid(TransactionId latestXid);
 static void MaintainLatestCompletedXidRecovery(TransactionId latestXid);
+static void MaintainOldestActiveXid(FullTransactionId nextXid);
+static Snapshot GetSnapshotDataCSN(Snapshot snapshot);
 
 static inline FullTransactionId FullXidRelativeTo(FullTransactionId rel,
 												  TransactionId xid);
@@ -567,6 +570,7 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 	ProcArrayStruct *arrayP = procArray;
 	int			myoff;
 	int			movecount;
+	TransactionId removedXid = InvalidTransactionId;
 
 #ifdef XIDCACHE_DEBUG
 	/* dump stats at backend shutdown, but not prepared-xact end */
@@ -593,6 +597,7 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 		/* Same with xactCompletionCount  */
 		TransamVariables->xactCompletionCount++;
 
+		removedXid = ProcGlobal->xids[myoff];
 		ProcGlobal->xids[myoff] = InvalidTransactionId;
 		ProcGlobal->subxidStates[myoff].overflowed = false;
 		ProcGlobal->subxidStates[myoff].count = 0;
@@ -641,6 +646,12 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 		allProcs[procno].pgxactoff = index;
 	}
 
+	/* We hold XidGenLock, so nextXid can be read directly */
+	if (csn_snapshots && TransactionIdIsValid(removedXid) &&
+		TransactionIdEquals(removedXid,
+							XidFromFullTransactionId(CSNLogGetOldestActiveXid())))
+		MaintainOldestActiveXid(TransamVariables->nextXid);
+
 	/*
 	 * Release in reversed acquisition order, to reduce frequency of having to
 	 * wait for XidGenLock while holding ProcArrayLock.
@@ -731,6 +742,7 @@ static inline void
 ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId latestXid)
 {
 	int			pgxactoff = proc->pgxactoff;
+	TransactionId xid = proc->xid;
 
 	/*
 	 * Note: we need exclusive lock here because we're going to change other
@@ -774,6 +786,12 @@ ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId latestXid)
 
 	/* Same with xactCompletionCount  */
 	TransamVariables->xactCompletionCount++;
+
+	/* And the xmin of CSN snapshots, if we were the oldest */
+	if (csn_snapshots &&
+		TransactionIdEquals(xid,
+							XidFromFullTransactionId(CSNLogGetOldestActiveXid())))
+		MaintainOldestActiveXid(ReadNextFullTransactionId());
 }
 
 /*
@@ -1012,6 +1030,37 @@ MaintainLatestCompletedXidRecovery(TransactionId latestXid)
 	Assert(FullTransactionIdIsNormal(TransamVariables->latestCompletedXid));
 }
 
+/*
+ * Recompute the oldest active XID used as xmin by CSN snapshots, after the
+ * transaction it pointed to has been removed from the ProcArray.
+ *
+ * Caller must hold ProcArrayLock exclusively, which keeps other transactions
+ * from ending concurrently, and must have read nextXid after removing the
+ * transaction.  XIDs assigned after that point can only follow nextXid, so
+ * they need not be seen by the scan below.
+ */
+static void
+MaintainOldestActiveXid(FullTransactionId nextXid)
+{
+	ProcArrayStruct *arrayP = procArray;
+	TransactionId *other_xids = ProcGlobal->xids;
+	TransactionId oldestxid = XidFromFullTransactionId(nextXid);
+
+	Assert(LWLockHeldByMeInMode(ProcArrayLock, LW_EXCLUSIVE));
+
+	for (int pgxactoff = 0; pgxactoff < arrayP->numProcs; pgxactoff++)
+	{
+		/* Fetch xid just once - see GetNewTransactionId */
+		TransactionId xid = UINT32_ACCESS_ONCE(other_xids[pgxactoff]);
+
+		if (TransactionIdIsNormal(xid) &&
+			NormalTransactionIdPrecedes(xid, oldestxid))
+			oldestxid = xid;
+	}
+
+	CSNLogSetOldestActiveXid(FullXidRelativeTo(nextXid, oldestxid));
+}
+
 /*
  * ProcArrayInitRecovery -- initialize recovery xid mgmt environment
  *
@@ -1674,6 +1723,42 @@ TransactionIdIsActive(TransactionId xid)
 	return result;
 }
 
+/*
+ * GetRunningTopLevelXids -- top-level XIDs of all running transactions
+ *
+ * Returns a palloc'd array sorted in xidComparator order, including prepared
+ * transactions, and sets *nxids to its length.  This is for callers that
+ * would otherwise call TransactionIdIsInProgress() for every XID in a range.
+ */
+TransactionId *
+GetRunningTopLevelXids(int *nxids)
+{
+	ProcArrayStruct *arrayP = procArray;
+	TransactionId *other_xids = ProcGlobal->xids;
+	TransactionId *xids;
+	int			count = 0;
+
+	xids = palloc(arrayP->maxProcs * sizeof(TransactionId));
+
+	LWLockAcquire(ProcArrayLock, LW_SHARED);
+
+	for (int pgxactoff = 0; pgxactoff < arrayP->numProcs; pgxactoff++)
+	{
+		/* Fetch xid just once - see GetNewTransactionId */
+		TransactionId xid = UINT32_ACCESS_ONCE(other_xids[pgxactoff]);
+
+		if (TransactionIdIsValid(xid))
+			xids[count++] = xid;
+	}
+
+	LWLockRelease(ProcArrayLock);
+
+	qsort(xids, count, sizeof(TransactionId), xidComparator);
+
+	*nxids = count;
+	return xids;
+}
+
 
 /*
  * Determine XID horizons.
@@ -2226,6 +2311,9 @@ GetSnapshotData(Snapshot snapshot)
 					 errmsg("out of memory")));
 	}
 
+	if (csn_snapshots && !RecoveryInProgress())
+		return GetSnapshotDataCSN(snapshot);
+
 	/*
 	 * It is sufficient to get shared lock on ProcArrayLock, even if we are
 	 * going to set MyProc->xmin.
@@ -2506,6 +2594,7 @@ GetSnapshotData(Snapshot snapshot)
 	snapshot->subxcnt = subcount;
 	snapshot->suboverflowed = suboverflowed;
 	snapshot->snapXactCompletionCount = curXactCompletionCount;
+	snapshot->snapshotcsn = InvalidCommitSeqNo;
 
 	snapshot->curcid = GetCurrentCommandId(false);
 
@@ -2522,6 +2611,107 @@ GetSnapshotData(Snapshot snapshot)
 	return snapshot;
 }
 
+/*
+ * GetSnapshotDataCSN -- GetSnapshotData() for csn_snapshots
+ *
+ * Instead of collecting the running XIDs, remember the next commit sequence
+ * number to be assigned: transactions that committed with an earlier one are
+ * visible to the snapshot, see XidInMVCCSnapshot().  This does not need
+ * ProcArrayLock.
+ *
+ * xmin is the oldest XID still running, and is entered into MyProc->xmin
+ * before the CSN is read.  That keeps concurrent horizon computations from
+ * removing anything the snapshot could need, and keeps pg_csn from being
+ * truncated past it.
+ */
+static Snapshot
+GetSnapshotDataCSN(Snapshot snapshot)
+{
+	TransactionId xmin;
+	TransactionId myxid = MyProc->xid;
+	TransactionId replication_slot_xmin;
+	TransactionId replication_slot_catalog_xmin;
+	FullTransactionId xmin_full;
+	FullTransactionId xmax_full;
+	CommitSeqNo csn;
+
+	xmin_full = CSNLogGetOldestActiveXid();
+
+	if (!TransactionIdIsValid(MyProc->xmin))
+	{
+		MyProc->xmin = TransactionXmin = XidFromFullTransactionId(xmin_full);
+
+		/*
+		 * A checkpoint that computed its truncation point before our xmin
+		 * became visible may have seen a newer oldest active XID than the one
+		 * we just read.  Re-read it now that our xmin is in place.
+		 */
+		pg_memory_barrier();
+		xmin_full = CSNLogGetOldestActiveXid();
+	}
+	xmin = XidFromFullTransactionId(xmin_full);
+
+	csn = CSNLogGetSnapshotCSN(&xmax_full);
+	Assert(FullTransactionIdFollowsOrEquals(xmax_full, xmin_full));
+
+	/* Fetch without the lock; a slightly stale value is harmless here */
+	replication_slot_xmin = procArray->replication_slot_xmin;
+	replication_slot_catalog_xmin = procArray->replication_slot_catalog_xmin;
+
+	/* maintain state for GlobalVis*, as in GetSnapshotData() */
+	{
+		TransactionId def_vis_xid;
+		TransactionId def_vis_xid_data;
+		FullTransactionId def_vis_fxid;
+		FullTransactionId def_vis_fxid_data;
+
+		def_vis_xid_data = TransactionIdOlder(xmin, replication_slot_xmin);
+		def_vis_xid =
+			TransactionIdOlder(replication_slot_catalog_xmin, def_vis_xid_data);
+
+		def_vis_fxid = FullXidRelativeTo(xmax_full, def_vis_xid);
+		def_vis_fxid_data = FullXidRelativeTo(xmax_full, def_vis_xid_data);
+
+		GlobalVisSharedRels.definitely_needed =
+			FullTransactionIdNewer(def_vis_fxid,
+								   GlobalVisSharedRels.definitely_needed);
+		GlobalVisCatalogRels.definitely_needed =
+			FullTransactionIdNewer(def_vis_fxid,
+								   GlobalVisCatalogRels.definitely_needed);
+		GlobalVisDataRels.definitely_needed =
+			FullTransactionIdNewer(def_vis_fxid_data,
+								   GlobalVisDataRels.definitely_needed);
+		if (TransactionIdIsNormal(myxid))
+			GlobalVisTempRels.definitely_needed =
+				FullXidRelativeTo(xmax_full, myxid);
+		else
+			GlobalVisTempRels.definitely_needed = xmax_full;
+		GlobalVisTempRels.maybe_needed = GlobalVisTempRels.definitely_needed;
+	}
+
+	RecentXmin = xmin;
+	Assert(TransactionIdPrecedesOrEquals(TransactionXmin, RecentXmin));
+
+	snapshot->xmin = xmin;
+	snapshot->xmax = XidFromFullTransactionId(xmax_full);
+	snapshot->xcnt = 0;
+	snapshot->subxcnt = 0;
+	snapshot->suboverflowed = false;
+	snapshot->takenDuringRecovery = false;
+	snapshot->snapXactCompletionCount = 0;
+	snapshot->snapshotcsn = csn;
+
+	snapshot->curcid = GetCurrentCommandId(false);
+
+	snapshot->active_count = 0;
+	snapshot->regd_count = 0;
+	snapshot->copied = false;
+	snapshot->lsn = InvalidXLogRecPtr;
+	snapshot->whenTaken = 0;
+
+	return snapshot;
+}
+
 /*
  * ProcArrayInstallImportedXmin -- install imported xmin into MyProc->xmin
  *
@@ -3731,8 +3921,9 @@ CountUserBackends(Oid roleid)
  * CountOtherDBBackends -- check for other backends running in the given DB
  *
  * If there are other backends in the DB, we will wait a maximum of 5 seconds
- * for them to exit.  Autovacuum backends are encouraged to exit early by
- * sending them SIGTERM, but normal user backends are just waited for.
+ * for them to exit.  Autovacuum backends and pooled backends that have no
+ * client yet are encouraged to exit early by sending them SIGTERM, but normal
+ * user backends are just waited for.
  *
  * The current backend is always ignored; it is caller's responsibility to
  * check whether the current backend uses the given DB, if it's important.
@@ -3790,7 +3981,7 @@ CountOtherDBBackends(Oid databaseId, int *nbackends, int *nprepared)
 			else
 			{
 				(*nbackends)++;
-				if ((statusFlags & PROC_IS_AUTOVACUUM) &&
+				if ((statusFlags & (PROC_IS_AUTOVACUUM | PROC_IN_BACKEND_POOL)) &&
 					nautovacs < MAXAUTOVACPIDS)
 					autovac_pids[nautovacs++] = proc->pid;
 			}
@@ -3802,10 +3993,10 @@ CountOtherDBBackends(Oid databaseId, int *nbackends, int *nprepared)
 			return false;		/* no conflicting backends, so done */
 
 		/*
-		 * Send SIGTERM to any conflicting autovacuums before sleeping. We
-		 * postpone this step until after the loop because we don't want to
-		 * hold ProcArrayLock while issuing kill(). We have no idea what might
-		 * block kill() inside the kernel...
+		 * Send SIGTERM to any conflicting autovacuums and pooled backends
+		 * before sleeping. We postpone this step until after the loop because
+		 * we don't want to hold ProcArrayLock while issuing kill(). We have
+		 * no idea what might block kill() inside the kernel...
 		 */
 		for (index = 0; index < nautovacs; index++)
 			(void) kill(autovac_pids[index], SIGTERM);	/* ignore any error */
@@ -548,9 +548,11 @@ FindLockCycleRecurseMember(PGPROC *checkProc,
 	/*
 	 * The relation extension lock can never participate in actual deadlock
 	 * cycle.  See Assert in LockAcquireExtended.  So, there is no advantage
-	 * in checking wait edges from it.
+	 * in checking wait edges from it.  The same goes for page locks, which
+	 * are likewise held only briefly while no other lock is acquired.
 	 */
-	if (LOCK_LOCKTAG(*lock) == LOCKTAG_RELATION_EXTEND)
+	if (LOCK_LOCKTAG(*lock) == LOCKTAG_RELATION_EXTEND ||
+		LOCK_LOCKTAG(*lock) == LOCKTAG_PAGE)
 		return false;
 
 	lockMethodTable = GetLocksMethodTable(lock);
@@ -166,6 +166,18 @@ static const char *const BuiltinTrancheNames[] = {
 	[LWTRANCHE_SUBTRANS_SLRU] = "SubtransSLRU",
 	[LWTRANCHE_XACT_SLRU] = "XactSLRU",
 	[LWTRANCHE_PARALLEL_VACUUM_DSA] = "ParallelVacuumDSA",
+	[LWTRANCHE_CSNLOG_BUFFER] = "CSNLogBuffer",
+	[LWTRANCHE_CSNLOG_SLRU] = "CSNLogSLRU",
+	[LWTRANCHE_SHARED_PLAN_CACHE] = "SharedPlanCache",
+	[LWTRANCHE_SHARED_PLAN_CACHE_DSA] = "SharedPlanCacheDSA",
+	[LWTRANCHE_SHARED_PLAN_CACHE_HASH] = "SharedPlanCacheHash",
+	[LWTRANCHE_SHARED_CATCACHE] = "SharedCatCache",
+	[LWTRANCHE_SHARED_CATCACHE_DSA] = "SharedCatCacheDSA",
+	[LWTRANCHE_SHARED_CATCACHE_HASH] = "SharedCatCacheHash",
+	[LWTRANCHE_SHARED_RESULT_CACHE] = "SharedResultCache",
+	[LWTRANCHE_SHARED_RESULT_CACHE_DSA] = "SharedResultCacheDSA",
+	[LWTRANCHE_SHARED_RESULT_CACHE_HASH] = "SharedResultCacheHash",
+	[LWTRANCHE_SHARED_RESULT_CACHE_WRITERS] = "SharedResultCacheWriters",
 };
 
 StaticAssertDecl(lengthof(BuiltinTrancheNames) ==
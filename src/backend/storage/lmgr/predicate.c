@@ -3969,6 +3969,10 @@ XidIsConcurrent(TransactionId xid)
 	if (TransactionIdFollowsOrEquals(xid, snap->xmax))
 		return true;
 
+	/* CSN snapshots have no xip array to search */
+	if (CommitSeqNoIsValid(snap->snapshotcsn))
+		return XidInMVCCSnapshot(xid, snap);
+
 	return pg_lfind32(xid, snap->xip, snap->xcnt);
 }
 
@@ -0,0 +1,988 @@
+/*-------------------------------------------------------------------------
+ *
+ * backend_pool.c
+ *	  Pools of pre-initialized backends waiting for client connections
+ *
+ * Much of the cost of a new connection lies in what a backend does before it
+ * can talk to its client at all: fork, attach to shared memory, set up a
+ * PGPROC, and connect to its database, which means loading the relation
+ * cache.  When backend_pool_databases is set, the postmaster keeps
+ * backend_pool_size backends ready for each of the listed databases, having
+ * done all of that already.  Each waits for a client to be handed to it,
+ * after which it only has to authenticate the client and set up its session.
+ *
+ * The postmaster never reads from client sockets, so it can't know which
+ * database a new client wants.  New connections are therefore still served
+ * by a freshly forked backend, which reads the startup packet as usual.  If
+ * a pooled backend for the requested database is waiting, the new backend
+ * passes it the client's socket together with the contents of the startup
+ * packet, and exits.  This is done over a datagram socket pair per database,
+ * created by the postmaster and inherited by all backends: new backends send
+ * on one end, and the pooled backends all wait on the other one for the
+ * first datagram to arrive.  The forked backend's own cost is small compared
+ * to what the pooled backend saves, since it never touches shared memory.
+ *
+ * Connections that have started SSL or GSSAPI encryption, replication
+ * connections and connections from a connection proxy are not handed over;
+ * neither is a connection whose client sent more data than the startup
+ * packet, since we'd have to pass that on too.
+ *
+ * Every database's pool keeps a count of backends that are waiting and have
+ * not been promised a client.  A backend that wants to hand over a client
+ * decrements the count before sending anything, so that a datagram is never
+ * sent that no-one will read; a pooled backend that wants to leave the pool
+ * must likewise decrement it, or else wait for the datagram it's owed.
+ *
+ * The postmaster replaces pooled backends that have been handed a client, or
+ * that exit.  It learns of the former by a PMSIGNAL_BACKEND_POOL signal and
+ * a flag in shared memory, indexed by the child slot of the backend.  None
+ * of this is supported in EXEC_BACKEND builds, where there's no fork() for
+ * the pooled backends to inherit the sockets by.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/tcop/backend_pool.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "access/xact.h"
+#include "funcapi.h"
+#include "lib/stringinfo.h"
+#include "libpq/hba.h"
+#include "libpq/libpq.h"
+#include "libpq/pqcomm.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "postmaster/interrupt.h"
+#include "postmaster/postmaster.h"
+#include "replication/walsender.h"
+#include "storage/fd.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/pmsignal.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/sinval.h"
+#include "storage/spin.h"
+#include "tcop/backend_pool.h"
+#include "tcop/backend_startup.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/ps_status.h"
+#include "utils/timestamp.h"
+#include "utils/varlena.h"
+
+/* GUC parameters */
+char	   *backend_pool_databases = "";
+int			backend_pool_size = 0;
+
+bool		am_pooled_backend = false;
+
+/*
+ * Largest message we pass along with a client's socket.  It holds the
+ * contents of the startup packet, so it can't be much larger than that.
+ */
+#define BACKEND_POOL_MAX_MESSAGE	(MAX_STARTUP_PACKET_LENGTH + 4096)
+
+/* Markers for NULL and non-NULL strings in a hand-off message */
+#define BACKEND_POOL_NULL_STRING	'N'
+#define BACKEND_POOL_STRING			'S'
+
+/* Shared state of one database's pool */
+typedef struct BackendPoolEntry
+{
+	slock_t		mutex;
+	NameData	dbname;
+	int			nready;			/* waiting backends not promised a client */
+	int64		handoffs;		/* clients handed to a pooled backend */
+	int64		misses;			/* clients for which none was ready */
+} BackendPoolEntry;
+
+typedef struct BackendPoolCtlData
+{
+	int			ndatabases;
+	BackendPoolEntry entries[FLEXIBLE_ARRAY_MEMBER];
+} BackendPoolCtlData;
+
+static BackendPoolCtlData *BackendPoolCtl = NULL;
+
+/*
+ * Flags set by pooled backends once they've been handed a client, indexed by
+ * PMChildSlot.  Only allocated if pools are configured.
+ */
+static bool *BackendPoolClaimed = NULL;
+
+/*
+ * Fixed part of the message passed along with a client's socket.  It is
+ * followed by the strings from the startup packet.
+ */
+typedef struct BackendPoolHandOffHeader
+{
+	SockAddr	raddr;
+	ProtocolVersion proto;
+	int			remote_hostname_resolv;
+	int			remote_hostname_errcode;
+	int			nguc_options;
+	TimestampTz fork_started;
+	TimestampTz fork_ended;
+	TimestampTz startup_ended;
+} BackendPoolHandOffHeader;
+
+/*
+ * The configured databases and their socket pairs.  These are set up by the
+ * postmaster, and inherited by its children.  Backends handing over a client
+ * send on [0]; pooled backends receive on [1].
+ */
+static int	pool_ndatabases = -1;
+static char **pool_dbnames = NULL;
+static pgsocket (*pool_sockets)[2] = NULL;
+
+/* In a pooled backend, the pool it belongs to */
+static int	MyBackendPool = -1;
+
+/* Are we waiting in our pool (as far as the other backends know)? */
+static bool in_backend_pool = false;
+
+static void parse_backend_pool_databases(void);
+static void backend_pool_leave(int code, Datum arg);
+static void set_backend_pool_status_flag(bool in_pool);
+static bool send_client(pgsocket dest, pgsocket sock, const char *data, int len);
+static bool receive_client(pgsocket source, char *buf, Size bufsize,
+						   ssize_t *len, pgsocket *sock);
+static void append_string(StringInfo buf, const char *str);
+static bool read_string(char **p, char *end, char **str);
+static bool unpack_client(char *buf, ssize_t len, BackendPoolHandOffHeader *hdr,
+						  Port *port);
+
+/*
+ * Parse backend_pool_databases into pool_dbnames, unless already done.
+ */
+static void
+parse_backend_pool_databases(void)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *lc;
+	int			i = 0;
+
+	if (pool_ndatabases >= 0)
+		return;
+
+	rawstring = pstrdup(backend_pool_databases);
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid list syntax in parameter \"%s\"",
+						"backend_pool_databases")));
+
+	pool_dbnames = MemoryContextAlloc(TopMemoryContext,
+									  Max(list_length(elemlist), 1) * sizeof(char *));
+	foreach(lc, elemlist)
+	{
+		char	   *dbname = (char *) lfirst(lc);
+
+		if (strlen(dbname) >= NAMEDATALEN)
+			ereport(FATAL,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("database name \"%s\" in parameter \"%s\" is too long",
+							dbname, "backend_pool_databases")));
+		pool_dbnames[i++] = MemoryContextStrdup(TopMemoryContext, dbname);
+	}
+	pool_ndatabases = i;
+
+	list_free(elemlist);
+	pfree(rawstring);
+}
+
+/*
+ * Report shared-memory space needed by the backend pools
+ */
+Size
+BackendPoolShmemSize(void)
+{
+	Size		size = 0;
+
+	/* Not supported in EXEC_BACKEND builds; see BackendPoolInit */
+#ifndef EXEC_BACKEND
+	parse_backend_pool_databases();
+	if (pool_ndatabases > 0)
+	{
+		size = add_size(offsetof(BackendPoolCtlData, entries),
+						mul_size(pool_ndatabases, sizeof(BackendPoolEntry)));
+		size = MAXALIGN(size);
+		size = add_size(size, mul_size(MaxLivePostmasterChildren() + 1,
+									   sizeof(bool)));
+	}
+#endif
+
+	return size;
+}
+
+/*
+ * Allocate and initialize the backend pools' shared memory
+ */
+void
+BackendPoolShmemInit(void)
+{
+	bool		found;
+	Size		size = BackendPoolShmemSize();
+
+	if (size == 0)
+		return;
+
+	BackendPoolCtl = (BackendPoolCtlData *)
+		ShmemInitStruct("Backend Pool Data", size, &found);
+	BackendPoolClaimed = (bool *)
+		((char *) BackendPoolCtl +
+		 MAXALIGN(offsetof(BackendPoolCtlData, entries) +
+				  pool_ndatabases * sizeof(BackendPoolEntry)));
+
+	if (!found)
+	{
+		memset(BackendPoolCtl, 0, size);
+		BackendPoolCtl->ndatabases = pool_ndatabases;
+		for (int i = 0; i < pool_ndatabases; i++)
+		{
+			SpinLockInit(&BackendPoolCtl->entries[i].mutex);
+			namestrcpy(&BackendPoolCtl->entries[i].dbname, pool_dbnames[i]);
+		}
+
+		/*
+		 * After a crash, there might be clients left in the sockets that no
+		 * pooled backend got around to taking.  Close their connections, so
+		 * that their count doesn't go wrong.
+		 */
+		if (pool_sockets != NULL)
+		{
+			char	   *buf = palloc(BACKEND_POOL_MAX_MESSAGE);
+
+			for (int i = 0; i < pool_ndatabases; i++)
+			{
+				ssize_t		len;
+				pgsocket	sock;
+
+				while (receive_client(pool_sockets[i][1], buf,
+									  BACKEND_POOL_MAX_MESSAGE, &len, &sock))
+				{
+					if (sock != PGINVALID_SOCKET)
+						closesocket(sock);
+				}
+			}
+			pfree(buf);
+		}
+	}
+}
+
+/*
+ * BackendPoolInit
+ *		Create the sockets used to hand clients to pooled backends.
+ *
+ * Called by the postmaster at startup.
+ */
+void
+BackendPoolInit(void)
+{
+	parse_backend_pool_databases();
+	if (pool_ndatabases == 0)
+		return;
+
+#ifdef EXEC_BACKEND
+	ereport(LOG,
+			(errmsg("backend pools are not supported by this build")));
+	pool_ndatabases = 0;
+#else
+	pool_sockets = MemoryContextAlloc(TopMemoryContext,
+									  pool_ndatabases * sizeof(*pool_sockets));
+	for (int i = 0; i < pool_ndatabases; i++)
+	{
+		int			fds[2];
+
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) < 0)
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not create socket pair for backend pool: %m")));
+		if (!pg_set_noblock(fds[0]) || !pg_set_noblock(fds[1]))
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not set backend pool socket to nonblocking mode: %m")));
+		pool_sockets[i][0] = fds[0];
+		pool_sockets[i][1] = fds[1];
+	}
+#endif
+}
+
+/*
+ * Number of databases that have a backend pool.  Zero if the feature is off.
+ */
+int
+BackendPoolNumDatabases(void)
+{
+	return pool_sockets != NULL ? pool_ndatabases : 0;
+}
+
+/*
+ * BackendPoolPrepareChild
+ *		Called by the postmaster before it starts a pooled backend.
+ */
+void
+BackendPoolPrepareChild(int child_slot)
+{
+	BackendPoolClaimed[child_slot] = false;
+}
+
+/*
+ * BackendPoolChildClaimed
+ *		Has the pooled backend in the given child slot been handed a client?
+ */
+bool
+BackendPoolChildClaimed(int child_slot)
+{
+	return BackendPoolClaimed[child_slot];
+}
+
+/*
+ * BackendPoolCloseSockets
+ *		Close all the pool sockets, in a process that has no use for them.
+ */
+void
+BackendPoolCloseSockets(void)
+{
+	if (pool_sockets == NULL)
+		return;
+
+	for (int i = 0; i < pool_ndatabases; i++)
+	{
+		closesocket(pool_sockets[i][0]);
+		closesocket(pool_sockets[i][1]);
+	}
+	pool_sockets = NULL;
+}
+
+/*
+ * BackendPoolBackendInit
+ *		Set up a newly started backend to join the pool of the given database.
+ */
+void
+BackendPoolBackendInit(int pool)
+{
+	Assert(pool >= 0 && pool < pool_ndatabases);
+
+	am_pooled_backend = true;
+	MyBackendPool = pool;
+
+	/* We have no client yet */
+	whereToSendOutput = DestNone;
+
+	/* Keep only the socket we receive our client on */
+	for (int i = 0; i < pool_ndatabases; i++)
+	{
+		closesocket(pool_sockets[i][0]);
+		if (i != pool)
+			closesocket(pool_sockets[i][1]);
+	}
+	ReserveExternalFD();
+
+	init_ps_display(psprintf("pooled %s", pool_dbnames[pool]));
+}
+
+/*
+ * The name of the database a pooled backend connects to.
+ */
+const char *
+BackendPoolDatabaseName(void)
+{
+	Assert(am_pooled_backend);
+
+	return pool_dbnames[MyBackendPool];
+}
+
+/*
+ * BackendPoolHandOff
+ *		Try to hand a new client over to a pooled backend.
+ *
+ * Called by a new backend once it has read the startup packet.  Returns true
+ * if the client now belongs to a pooled backend, in which case the caller
+ * should just exit.  Either way, we're done with the pool sockets.
+ */
+bool
+BackendPoolHandOff(Port *port)
+{
+	BackendPoolHandOffHeader hdr;
+	BackendPoolEntry *entry;
+	StringInfoData buf;
+	ListCell   *lc;
+	int			pool = -1;
+	bool		promised = false;
+	bool		result = false;
+
+	if (pool_sockets == NULL)
+		return false;
+
+	if (!am_walsender && !port->ssl_in_use && !port->proxied &&
+#ifdef ENABLE_GSS
+		!(port->gss && port->gss->enc) &&
+#endif
+		pq_buffer_remaining_data() == 0 &&
+		port->database_name != NULL)
+	{
+		for (int i = 0; i < pool_ndatabases; i++)
+		{
+			if (strcmp(port->database_name, pool_dbnames[i]) == 0)
+			{
+				pool = i;
+				break;
+			}
+		}
+	}
+
+	if (pool < 0)
+	{
+		BackendPoolCloseSockets();
+		return false;
+	}
+
+	/* Put together everything the pooled backend needs to know */
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(&hdr.raddr, &port->raddr, sizeof(SockAddr));
+	hdr.proto = port->proto;
+	hdr.remote_hostname_resolv = port->remote_hostname_resolv;
+	hdr.remote_hostname_errcode = port->remote_hostname_errcode;
+	hdr.nguc_options = list_length(port->guc_options);
+	hdr.fork_started = conn_timing.fork_started;
+	hdr.fork_ended = conn_timing.fork_ended;
+	hdr.startup_ended = conn_timing.startup_ended;
+
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, &hdr, sizeof(hdr));
+	append_string(&buf, port->user_name);
+	append_string(&buf, port->database_name);
+	append_string(&buf, port->cmdline_options);
+	append_string(&buf, port->application_name);
+	append_string(&buf, port->remote_host);
+	append_string(&buf, port->remote_port);
+	append_string(&buf, port->remote_hostname);
+	foreach(lc, port->guc_options)
+		append_string(&buf, (char *) lfirst(lc));
+
+	entry = &BackendPoolCtl->entries[pool];
+	if (buf.len <= BACKEND_POOL_MAX_MESSAGE)
+	{
+		SpinLockAcquire(&entry->mutex);
+		if (entry->nready > 0)
+		{
+			entry->nready--;
+			promised = true;
+		}
+		else
+			entry->misses++;
+		SpinLockRelease(&entry->mutex);
+	}
+
+	if (promised)
+	{
+		result = send_client(pool_sockets[pool][0], port->sock,
+							 buf.data, buf.len);
+
+		SpinLockAcquire(&entry->mutex);
+		if (result)
+			entry->handoffs++;
+		else
+		{
+			/* Nobody's getting this one after all */
+			entry->nready++;
+			entry->misses++;
+		}
+		SpinLockRelease(&entry->mutex);
+	}
+
+	pfree(buf.data);
+	BackendPoolCloseSockets();
+
+	return result;
+}
+
+/*
+ * BackendPoolWaitForClient
+ *		Wait in a pooled backend until we're handed a client.
+ *
+ * Called by InitPostgres once we're connected to our database, outside any
+ * transaction.  On return, MyProcPort describes the client, which still has
+ * to be authenticated.
+ */
+void
+BackendPoolWaitForClient(void)
+{
+	BackendPoolEntry *entry = &BackendPoolCtl->entries[MyBackendPool];
+	pgsocket	pool_socket = pool_sockets[MyBackendPool][1];
+	BackendPoolHandOffHeader hdr;
+	WaitEventSet *wes;
+	MemoryContext oldcontext;
+	char	   *buf;
+	pgsocket	sock = PGINVALID_SOCKET;
+	Port	   *port;
+
+	Assert(am_pooled_backend && !IsTransactionOrTransactionBlock());
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	buf = palloc(BACKEND_POOL_MAX_MESSAGE);
+	port = palloc0(sizeof(Port));
+
+	/*
+	 * Let DROP DATABASE and the like get rid of us rather than wait, and make
+	 * ourselves available.
+	 */
+	set_backend_pool_status_flag(true);
+	before_shmem_exit(backend_pool_leave, 0);
+
+	SpinLockAcquire(&entry->mutex);
+	entry->nready++;
+	SpinLockRelease(&entry->mutex);
+	in_backend_pool = true;
+
+	set_ps_display("idle");
+
+	wes = CreateWaitEventSet(NULL, 3);
+	AddWaitEventToSet(wes, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch, NULL);
+	AddWaitEventToSet(wes, WL_SOCKET_READABLE, pool_socket, NULL, NULL);
+	AddWaitEventToSet(wes, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET, NULL, NULL);
+
+	for (;;)
+	{
+		WaitEvent	event;
+		ssize_t		len;
+
+		ResetLatch(MyLatch);
+
+		/* Exiting quietly is all there is to do on SIGTERM */
+		if (ProcDiePending)
+			proc_exit(0);
+
+		if (ConfigReloadPending)
+		{
+			bool		leave = false;
+
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+
+			/*
+			 * The HBA data we inherited from the postmaster might be out of
+			 * date.  Any problems with the files have already been reported
+			 * by the postmaster, so don't report them again.
+			 */
+			(void) load_hba();
+			(void) load_ident();
+
+			/* Leave if the pool has shrunk */
+			SpinLockAcquire(&entry->mutex);
+			if (entry->nready > backend_pool_size)
+			{
+				entry->nready--;
+				leave = true;
+			}
+			SpinLockRelease(&entry->mutex);
+
+			if (leave)
+			{
+				in_backend_pool = false;
+				proc_exit(0);
+			}
+		}
+
+		/* Keep up with invalidations while we wait */
+		if (catchupInterruptPending)
+			ProcessCatchupInterrupt();
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (receive_client(pool_socket, buf, BACKEND_POOL_MAX_MESSAGE,
+						   &len, &sock))
+		{
+			if (sock != PGINVALID_SOCKET && unpack_client(buf, len, &hdr, port))
+				break;
+
+			ereport(LOG,
+					(errmsg("pooled backend received an invalid client hand-off")));
+			if (sock != PGINVALID_SOCKET)
+				closesocket(sock);
+			sock = PGINVALID_SOCKET;
+
+			/* The sender counted on us taking this, so we're still here */
+			SpinLockAcquire(&entry->mutex);
+			entry->nready++;
+			SpinLockRelease(&entry->mutex);
+			continue;
+		}
+
+		(void) WaitEventSetWait(wes, -1, &event, 1,
+								WAIT_EVENT_BACKEND_POOL_CLIENT);
+	}
+
+	/* We're no longer part of the pool; let the postmaster replace us */
+	in_backend_pool = false;
+	BackendPoolClaimed[MyPMChildSlot] = true;
+	pg_memory_barrier();
+	SendPostmasterSignal(PMSIGNAL_BACKEND_POOL);
+	set_backend_pool_status_flag(false);
+
+	FreeWaitEventSet(wes);
+	closesocket(pool_socket);
+	pool_sockets = NULL;
+	ReleaseExternalFD();
+
+	/* Now set ourselves up as BackendInitialize would have */
+	MyClientSocket = palloc(sizeof(ClientSocket));
+	MyClientSocket->sock = sock;
+	memcpy(&MyClientSocket->raddr, &hdr.raddr, sizeof(SockAddr));
+	ReserveExternalFD();
+
+	ClientAuthInProgress = true;
+	MyProcPort = pq_init(MyClientSocket);
+	MyProcPort->proto = hdr.proto;
+	MyProcPort->remote_hostname_resolv = hdr.remote_hostname_resolv;
+	MyProcPort->remote_hostname_errcode = hdr.remote_hostname_errcode;
+	MyProcPort->user_name = port->user_name;
+	MyProcPort->database_name = port->database_name;
+	MyProcPort->cmdline_options = port->cmdline_options;
+	MyProcPort->guc_options = port->guc_options;
+	MyProcPort->application_name = port->application_name;
+	MyProcPort->remote_host = port->remote_host;
+	MyProcPort->remote_port = port->remote_port;
+	MyProcPort->remote_hostname = port->remote_hostname;
+	pfree(port);
+	pfree(buf);
+
+	whereToSendOutput = DestRemote;
+	FrontendProtocol = Min(hdr.proto, PG_PROTOCOL_LATEST);
+
+	/* As far as anyone can tell, the session starts now */
+	MyStartTimestamp = GetCurrentTimestamp();
+	MyStartTime = timestamptz_to_time_t(MyStartTimestamp);
+
+	conn_timing.fork_started = hdr.fork_started;
+	conn_timing.fork_ended = hdr.fork_ended;
+	conn_timing.startup_ended = hdr.startup_ended;
+	conn_timing.handoff_ended = MyStartTimestamp;
+
+	if (MyProcPort->remote_port[0] != '\0')
+		init_ps_display(psprintf("%s %s %s(%s)",
+								 MyProcPort->user_name,
+								 MyProcPort->database_name,
+								 MyProcPort->remote_host,
+								 MyProcPort->remote_port));
+	else
+		init_ps_display(psprintf("%s %s %s",
+								 MyProcPort->user_name,
+								 MyProcPort->database_name,
+								 MyProcPort->remote_host));
+	set_ps_display("initializing");
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * before_shmem_exit callback of a pooled backend.  If the others might still
+ * count on us to take a client, take one before leaving, and close it.
+ */
+static void
+backend_pool_leave(int code, Datum arg)
+{
+	BackendPoolEntry *entry;
+	bool		owed = true;
+	char	   *buf;
+
+	if (!in_backend_pool)
+		return;
+	in_backend_pool = false;
+
+	entry = &BackendPoolCtl->entries[MyBackendPool];
+	SpinLockAcquire(&entry->mutex);
+	if (entry->nready > 0)
+	{
+		entry->nready--;
+		owed = false;
+	}
+	SpinLockRelease(&entry->mutex);
+
+	if (!owed)
+		return;
+
+	/*
+	 * The sender decrements the count just before sending, so the datagram
+	 * should be along any moment.  Don't wait forever, though.
+	 */
+	buf = palloc(BACKEND_POOL_MAX_MESSAGE);
+	for (int i = 0; i < 1000; i++)
+	{
+		ssize_t		len;
+		pgsocket	sock;
+
+		if (receive_client(pool_sockets[MyBackendPool][1], buf,
+						   BACKEND_POOL_MAX_MESSAGE, &len, &sock))
+		{
+			if (sock != PGINVALID_SOCKET)
+				closesocket(sock);
+			break;
+		}
+		pg_usleep(1000L);
+	}
+	pfree(buf);
+}
+
+/*
+ * Advertise in our PGPROC whether we are waiting in a pool.
+ */
+static void
+set_backend_pool_status_flag(bool in_pool)
+{
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	if (in_pool)
+		MyProc->statusFlags |= PROC_IN_BACKEND_POOL;
+	else
+		MyProc->statusFlags &= ~PROC_IN_BACKEND_POOL;
+	ProcGlobal->statusFlags[MyProc->pgxactoff] = MyProc->statusFlags;
+	LWLockRelease(ProcArrayLock);
+}
+
+/*
+ * Send a client's socket, with the given message, to a pooled backend.
+ */
+static bool
+send_client(pgsocket dest, pgsocket sock, const char *data, int len)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			cmsgbuf;
+	struct cmsghdr *cmsg;
+	ssize_t		rc;
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&cmsgbuf, 0, sizeof(cmsgbuf));
+	iov.iov_base = unconstify(char *, data);
+	iov.iov_len = len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &sock, sizeof(int));
+
+	do
+	{
+		rc = sendmsg(dest, &msg, 0);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc != len)
+	{
+		/* A full queue just means we serve the client ourselves */
+		if (rc >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not hand client connection to pooled backend: %m")));
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Receive a client's socket and message, if one is waiting.
+ *
+ * Returns false if there was nothing to receive.  If there was something
+ * that doesn't look right, returns true with *sock set to PGINVALID_SOCKET
+ * or *len set to -1, after closing any socket that came with it.
+ */
+static bool
+receive_client(pgsocket source, char *buf, Size bufsize, ssize_t *len,
+			   pgsocket *sock)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			cmsgbuf;
+	struct cmsghdr *cmsg;
+	ssize_t		rc;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = buf;
+	iov.iov_len = bufsize;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+	*sock = PGINVALID_SOCKET;
+	*len = -1;
+
+	do
+	{
+		rc = recvmsg(source, &msg, 0);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return false;
+		ereport(FATAL,
+				(errcode_for_socket_access(),
+				 errmsg("could not receive client connection for backend pool: %m")));
+	}
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+			cmsg->cmsg_type == SCM_RIGHTS &&
+			cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+			memcpy(sock, CMSG_DATA(cmsg), sizeof(int));
+	}
+
+	if ((msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0)
+	{
+		if (*sock != PGINVALID_SOCKET)
+			closesocket(*sock);
+		*sock = PGINVALID_SOCKET;
+	}
+	else
+		*len = rc;
+
+	return true;
+}
+
+/*
+ * Append a possibly-NULL string to a hand-off message.
+ */
+static void
+append_string(StringInfo buf, const char *str)
+{
+	if (str == NULL)
+		appendStringInfoChar(buf, BACKEND_POOL_NULL_STRING);
+	else
+	{
+		appendStringInfoChar(buf, BACKEND_POOL_STRING);
+		appendBinaryStringInfo(buf, str, strlen(str) + 1);
+	}
+}
+
+/*
+ * Read a string written by append_string, advancing *p past it.
+ */
+static bool
+read_string(char **p, char *end, char **str)
+{
+	size_t		len;
+
+	if (*p >= end)
+		return false;
+
+	if (**p == BACKEND_POOL_NULL_STRING)
+	{
+		*str = NULL;
+		(*p)++;
+		return true;
+	}
+	if (**p != BACKEND_POOL_STRING)
+		return false;
+	(*p)++;
+
+	len = strnlen(*p, end - *p);
+	if (len == end - *p)
+		return false;
+	*str = pstrdup(*p);
+	*p += len + 1;
+	return true;
+}
+
+/*
+ * Unpack a hand-off message into *hdr and the startup packet fields of
+ * *port.  Returns false if it's malformed.
+ */
+static bool
+unpack_client(char *buf, ssize_t len, BackendPoolHandOffHeader *hdr,
+			  Port *port)
+{
+	char	   *p = buf + sizeof(BackendPoolHandOffHeader);
+	char	   *end = buf + len;
+
+	if (len < (ssize_t) sizeof(BackendPoolHandOffHeader))
+		return false;
+	memcpy(hdr, buf, sizeof(BackendPoolHandOffHeader));
+
+	if (!read_string(&p, end, &port->user_name) ||
+		!read_string(&p, end, &port->database_name) ||
+		!read_string(&p, end, &port->cmdline_options) ||
+		!read_string(&p, end, &port->application_name) ||
+		!read_string(&p, end, &port->remote_host) ||
+		!read_string(&p, end, &port->remote_port) ||
+		!read_string(&p, end, &port->remote_hostname))
+		return false;
+
+	/* These were always set by the sender */
+	if (port->user_name == NULL || port->database_name == NULL ||
+		port->remote_host == NULL || port->remote_port == NULL)
+		return false;
+
+	port->guc_options = NIL;
+	for (int i = 0; i < hdr->nguc_options; i++)
+	{
+		char	   *str;
+
+		if (!read_string(&p, end, &str) || str == NULL)
+			return false;
+		port->guc_options = lappend(port->guc_options, str);
+	}
+
+	return p == end;
+}
+
+/*
+ * SQL-callable function reporting the state of the backend pools.
+ */
+Datum
+pg_stat_get_backend_pool(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_BACKEND_POOL_COLS	4
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	if (BackendPoolCtl == NULL)
+		return (Datum) 0;
+
+	for (int i = 0; i < BackendPoolCtl->ndatabases; i++)
+	{
+		BackendPoolEntry *entry = &BackendPoolCtl->entries[i];
+		Datum		values[PG_STAT_GET_BACKEND_POOL_COLS] = {0};
+		bool		nulls[PG_STAT_GET_BACKEND_POOL_COLS] = {0};
+
+		SpinLockAcquire(&entry->mutex);
+		values[0] = NameGetDatum(&entry->dbname);
+		values[1] = Int32GetDatum(Max(entry->nready, 0));
+		values[2] = Int64GetDatum(entry->handoffs);
+		values[3] = Int64GetDatum(entry->misses);
+		SpinLockRelease(&entry->mutex);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	return (Datum) 0;
+}
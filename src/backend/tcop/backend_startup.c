@@ -25,12 +25,14 @@
 #include "libpq/pqformat.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
+#include "postmaster/connproxy.h"
 #include "postmaster/postmaster.h"
 #include "replication/walsender.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/procsignal.h"
 #include "storage/proc.h"
+#include "tcop/backend_pool.h"
 #include "tcop/backend_startup.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
@@ -38,10 +40,13 @@
 #include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/timeout.h"
+#include "utils/timestamp.h"
 
 /* GUCs */
 bool		Trace_connection_negotiation = false;
 
+ConnectionTiming conn_timing;
+
 static void BackendInitialize(ClientSocket *client_sock, CAC_state cac);
 static int	ProcessSSLStartup(Port *port);
 static int	ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done);
@@ -61,8 +66,24 @@ BackendMain(char *startup_data, size_t startup_data_len)
 	BackendStartupData *bsdata = (BackendStartupData *) startup_data;
 
 	Assert(startup_data_len == sizeof(BackendStartupData));
+
+	/*
+	 * A pooled backend has no client yet.  It goes as far as it can without
+	 * one, and then waits for one to be handed to it; see backend_pool.c.
+	 */
+	if (bsdata->backend_pool >= 0)
+	{
+		BackendPoolBackendInit(bsdata->backend_pool);
+		InitProcess();
+		MemoryContextSwitchTo(TopMemoryContext);
+		PostgresMain(BackendPoolDatabaseName(), "");
+	}
+
 	Assert(MyClientSocket != NULL);
 
+	conn_timing.fork_started = bsdata->fork_started;
+	conn_timing.fork_ended = GetCurrentTimestamp();
+
 #ifdef EXEC_BACKEND
 
 	/*
@@ -91,6 +112,11 @@ BackendMain(char *startup_data, size_t startup_data_len)
 
 	/* Perform additional initialization and collect startup packet */
 	BackendInitialize(MyClientSocket, bsdata->canAcceptConnections);
+	conn_timing.startup_ended = GetCurrentTimestamp();
+
+	/* If a pooled backend is ready to take over the client, we're done */
+	if (BackendPoolHandOff(MyProcPort))
+		proc_exit(0);
 
 	/*
 	 * Create a per-backend PGPROC struct in shared memory.  We must do this
@@ -108,6 +134,49 @@ BackendMain(char *startup_data, size_t startup_data_len)
 }
 
 
+/*
+ * LogConnectionSetupTimes -- log how long it took to set up a connection
+ *
+ * Called just before we first report being ready for a query.  The time
+ * not accounted for by the other phases is reported as initialization.
+ */
+void
+LogConnectionSetupTimes(void)
+{
+	TimestampTz now;
+	double		total_ms,
+				fork_ms,
+				startup_ms,
+				handoff_ms = 0,
+				authentication_ms;
+
+	conn_timing.ready_for_use = true;
+
+	if (!Log_connections || conn_timing.fork_started == 0 ||
+		whereToSendOutput != DestRemote)
+		return;
+
+	now = GetCurrentTimestamp();
+	total_ms = (now - conn_timing.fork_started) / 1000.0;
+	fork_ms = (conn_timing.fork_ended - conn_timing.fork_started) / 1000.0;
+	startup_ms = (conn_timing.startup_ended - conn_timing.fork_ended) / 1000.0;
+	if (conn_timing.handoff_ended != 0)
+		handoff_ms = (conn_timing.handoff_ended - conn_timing.startup_ended) / 1000.0;
+	authentication_ms = (conn_timing.auth_ended - conn_timing.auth_started) / 1000.0;
+
+	if (conn_timing.handoff_ended != 0)
+		ereport(LOG,
+				errmsg("connection ready: setup total=%.3f ms, fork=%.3f ms, startup=%.3f ms, handoff=%.3f ms, authentication=%.3f ms, initialization=%.3f ms",
+					   total_ms, fork_ms, startup_ms, handoff_ms, authentication_ms,
+					   total_ms - fork_ms - startup_ms - handoff_ms - authentication_ms));
+	else
+		ereport(LOG,
+				errmsg("connection ready: setup total=%.3f ms, fork=%.3f ms, startup=%.3f ms, authentication=%.3f ms, initialization=%.3f ms",
+					   total_ms, fork_ms, startup_ms, authentication_ms,
+					   total_ms - fork_ms - startup_ms - authentication_ms));
+}
+
+
 /*
  * BackendInitialize -- initialize an interactive (postmaster-child)
  *				backend process, and collect the client's startup packet.
@@ -277,6 +346,24 @@ BackendInitialize(ClientSocket *client_sock, CAC_state cac)
 	if (status == STATUS_OK)
 		status = ProcessStartupPacket(port, false, false);
 
+	/*
+	 * If a connection proxy opened this connection for a TCP client, the
+	 * client's address is the one to log and check from now on.
+	 */
+	if (status == STATUS_OK && port->proxied &&
+		port->raddr.addr.ss_family != AF_UNIX)
+	{
+		remote_host[0] = '\0';
+		remote_port[0] = '\0';
+		(void) pg_getnameinfo_all(&port->raddr.addr, port->raddr.salen,
+								  remote_host, sizeof(remote_host),
+								  remote_port, sizeof(remote_port),
+								  NI_NUMERICHOST | NI_NUMERICSERV);
+		port->remote_host = MemoryContextStrdup(TopMemoryContext, remote_host);
+		port->remote_port = MemoryContextStrdup(TopMemoryContext, remote_port);
+		port->remote_hostname = NULL;
+	}
+
 	/*
 	 * If we're going to reject the connection due to database state, say so
 	 * now instead of wasting cycles on an authentication exchange. (This also
@@ -768,6 +855,8 @@ ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done)
 									valptr),
 							 errhint("Valid values are: \"false\", 0, \"true\", 1, \"database\".")));
 			}
+			else if (strcmp(nameptr, CONN_PROXY_OPTION) == 0)
+				ProcessProxyClientOption(port, valptr);
 			else if (strncmp(nameptr, "_pq_.", 5) == 0)
 			{
 				/*
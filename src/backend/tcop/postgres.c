@@ -54,6 +54,7 @@
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
+#include "postmaster/connproxy.h"
 #include "postmaster/interrupt.h"
 #include "postmaster/postmaster.h"
 #include "replication/logicallauncher.h"
@@ -67,6 +68,8 @@
 #include "storage/proc.h"
 #include "storage/procsignal.h"
 #include "storage/sinval.h"
+#include "tcop/backend_pool.h"
+#include "tcop/backend_startup.h"
 #include "tcop/fastpath.h"
 #include "tcop/pquery.h"
 #include "tcop/tcopprot.h"
@@ -4323,10 +4326,11 @@ PostgresMain(const char *dbname, const char *username)
 
 	/*
 	 * Generate a random cancel key, if this is a backend serving a
-	 * connection. InitPostgres() will advertise it in shared memory.
+	 * connection, or one that will be. InitPostgres() will advertise it in
+	 * shared memory.
 	 */
 	Assert(!MyCancelKeyValid);
-	if (whereToSendOutput == DestRemote)
+	if (whereToSendOutput == DestRemote || am_pooled_backend)
 	{
 		if (!pg_strong_random(&MyCancelKey, sizeof(int32)))
 		{
@@ -4702,11 +4706,19 @@ PostgresMain(const char *dbname, const char *username)
 					enable_timeout_after(IDLE_SESSION_TIMEOUT,
 										 IdleSessionTimeout);
 				}
+
+				/* Tell a connection proxy if we can't serve other clients */
+				if (MyProcPort && MyProcPort->proxied)
+					ConnProxyCheckSessionState();
 			}
 
 			/* Report any recently-changed GUC options */
 			ReportChangedGUCOptions();
 
+			/* Report how long it took to get here, the first time */
+			if (!conn_timing.ready_for_use)
+				LogConnectionSetupTimes();
+
 			ReadyForQuery(whereToSendOutput);
 			send_ready_for_query = false;
 		}
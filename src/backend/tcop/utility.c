@@ -1877,6 +1877,14 @@ ProcessUtilitySlow(ParseState *pstate,
 					CreateStatsStmt *stmt = (CreateStatsStmt *) parsetree;
 					RangeVar   *rel = (RangeVar *) linitial(stmt->relations);
 
+					/*
+					 * Statistics on a join have both tables looked up and
+					 * locked by transformStatsStmt; lock the first one here.
+					 */
+					if (IsA(rel, JoinExpr) &&
+						IsA(((JoinExpr *) rel)->larg, RangeVar))
+						rel = (RangeVar *) ((JoinExpr *) rel)->larg;
+
 					if (!IsA(rel, RangeVar))
 						ereport(ERROR,
 								(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
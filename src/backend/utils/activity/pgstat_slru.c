@@ -97,6 +97,18 @@ pgstat_count_slru_truncate(int slru_idx)
 	get_slru_entry(slru_idx)->truncate += 1;
 }
 
+void
+pgstat_count_slru_xid_cache_hit(int slru_idx)
+{
+	get_slru_entry(slru_idx)->xid_cache_hit += 1;
+}
+
+void
+pgstat_count_slru_xid_cache_miss(int slru_idx)
+{
+	get_slru_entry(slru_idx)->xid_cache_miss += 1;
+}
+
 /*
  * Support function for the SQL-callable pgstat* functions. Returns
  * a pointer to the slru statistics struct.
@@ -188,6 +200,8 @@ pgstat_slru_flush_cb(bool nowait)
 		SLRU_ACC(blocks_exists);
 		SLRU_ACC(flush);
 		SLRU_ACC(truncate);
+		SLRU_ACC(xid_cache_hit);
+		SLRU_ACC(xid_cache_miss);
 #undef SLRU_ACC
 	}
 
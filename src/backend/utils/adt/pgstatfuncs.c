@@ -1544,7 +1544,7 @@ pg_stat_get_wal(PG_FUNCTION_ARGS)
 Datum
 pg_stat_get_slru(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_SLRU_COLS	9
+#define PG_STAT_GET_SLRU_COLS	11
 	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
 	int			i;
 	PgStat_SLRUStats *stats;
@@ -1577,7 +1577,9 @@ pg_stat_get_slru(PG_FUNCTION_ARGS)
 		values[5] = Int64GetDatum(stat.blocks_exists);
 		values[6] = Int64GetDatum(stat.flush);
 		values[7] = Int64GetDatum(stat.truncate);
-		values[8] = TimestampTzGetDatum(stat.stat_reset_timestamp);
+		values[8] = Int64GetDatum(stat.xid_cache_hit);
+		values[9] = Int64GetDatum(stat.xid_cache_miss);
+		values[10] = TimestampTzGetDatum(stat.stat_reset_timestamp);
 
 		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
 	}
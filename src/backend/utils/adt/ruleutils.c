@@ -38,6 +38,7 @@
 #include "catalog/pg_trigger.h"
 #include "catalog/pg_type.h"
 #include "commands/defrem.h"
+#include "commands/matview.h"
 #include "commands/tablespace.h"
 #include "common/keywords.h"
 #include "executor/spi.h"
@@ -361,6 +362,7 @@ static char *pg_get_indexdef_worker(Oid indexrelid, int colno,
 									int prettyFlags, bool missing_ok);
 static char *pg_get_statisticsobj_worker(Oid statextid, bool columns_only,
 										 bool missing_ok);
+static void get_statisticsobj_join(StringInfo buf, Oid conoid);
 static char *pg_get_partkeydef_worker(Oid relid, int prettyFlags,
 									  bool attrsOnly, bool missing_ok);
 static char *pg_get_constraintdef_worker(Oid constraintId, bool fullCommand,
@@ -1816,7 +1818,9 @@ pg_get_statisticsobj_worker(Oid statextid, bool columns_only, bool missing_ok)
 		colno++;
 	}
 
-	if (!columns_only)
+	if (!columns_only && OidIsValid(statextrec->stxfkey))
+		get_statisticsobj_join(&buf, statextrec->stxfkey);
+	else if (!columns_only)
 		appendStringInfo(&buf, " FROM %s",
 						 generate_relation_name(statextrec->stxrelid, NIL));
 
@@ -1825,6 +1829,70 @@ pg_get_statisticsobj_worker(Oid statextid, bool columns_only, bool missing_ok)
 	return buf.data;
 }
 
+/*
+ * Append the FROM clause of statistics on a foreign key join, as
+ * "referencing JOIN referenced ON <key columns equal>".
+ */
+static void
+get_statisticsobj_join(StringInfo buf, Oid conoid)
+{
+	HeapTuple	contup;
+	Form_pg_constraint conform;
+	AttrNumber	conkey[INDEX_MAX_KEYS];
+	AttrNumber	confkey[INDEX_MAX_KEYS];
+	Oid			pfeqop[INDEX_MAX_KEYS];
+	int			nkeys;
+	char	   *fkname;
+	char	   *refname;
+	bool		use_aliases;
+
+	contup = SearchSysCache1(CONSTROID, ObjectIdGetDatum(conoid));
+	if (!HeapTupleIsValid(contup))
+		elog(ERROR, "cache lookup failed for constraint %u", conoid);
+	conform = (Form_pg_constraint) GETSTRUCT(contup);
+	DeconstructFkConstraintRow(contup, &nkeys, conkey, confkey, pfeqop,
+							   NULL, NULL, NULL, NULL);
+
+	fkname = get_relation_name(conform->conrelid);
+	refname = get_relation_name(conform->confrelid);
+
+	appendStringInfo(buf, " FROM %s",
+					 generate_relation_name(conform->conrelid, NIL));
+
+	/* The column references need aliases if the table names clash */
+	use_aliases = (strcmp(fkname, refname) == 0);
+	if (use_aliases)
+	{
+		fkname = "f";
+		refname = "r";
+		appendStringInfoString(buf, " f");
+	}
+
+	appendStringInfo(buf, " JOIN %s",
+					 generate_relation_name(conform->confrelid, NIL));
+	if (use_aliases)
+		appendStringInfoString(buf, " r");
+
+	for (int i = 0; i < nkeys; i++)
+	{
+		appendStringInfo(buf, " %s %s.%s %s %s.%s",
+						 i == 0 ? "ON" : "AND",
+						 quote_identifier(refname),
+						 quote_identifier(get_attname(conform->confrelid,
+													  confkey[i], false)),
+						 generate_operator_name(pfeqop[i],
+												get_atttype(conform->confrelid,
+															confkey[i]),
+												get_atttype(conform->conrelid,
+															conkey[i])),
+						 quote_identifier(fkname),
+						 quote_identifier(get_attname(conform->conrelid,
+													  conkey[i], false)));
+	}
+
+	ReleaseSysCache(contup);
+}
+
 /*
  * Generate text array of expressions for statistics object.
  */
@@ -5548,6 +5616,23 @@ make_viewdef(StringInfo buf, HeapTuple ruletup, TupleDesc rulettc,
 
 	ev_relation = table_open(ev_class, AccessShareLock);
 
+	/*
+	 * Leave out the columns that an incremental materialized view keeps for
+	 * its maintenance; they are added back when the view is created.
+	 */
+	if (ev_relation->rd_rel->relisivm)
+	{
+		List	   *tlist = NIL;
+
+		foreach_node(TargetEntry, tle, query->targetList)
+		{
+			if (strncmp(tle->resname, IVM_HIDDEN_COLUMN_PREFIX,
+						strlen(IVM_HIDDEN_COLUMN_PREFIX)) != 0)
+				tlist = lappend(tlist, tle);
+		}
+		query->targetList = tlist;
+	}
+
 	get_query_def(query, buf, NIL, RelationGetDescr(ev_relation), true,
 				  prettyFlags, wrapColumn, 0);
 	appendStringInfoChar(buf, ';');
@@ -12313,6 +12398,10 @@ get_from_clause_item(Node *jtnode, Query *query, deparse_context *context)
 			case RTE_CTE:
 				appendStringInfoString(buf, quote_identifier(rte->ctename));
 				break;
+			case RTE_NAMEDTUPLESTORE:
+				/* Ephemeral named relation, such as a transition table */
+				appendStringInfoString(buf, quote_identifier(rte->enrname));
+				break;
 			default:
 				elog(ERROR, "unrecognized RTE kind: %d", (int) rte->rtekind);
 				break;
@@ -12521,6 +12610,12 @@ get_rte_alias(RangeTblEntry *rte, int varno, bool use_as,
 		if (strcmp(refname, rte->ctename) != 0)
 			printalias = true;
 	}
+	else if (rte->rtekind == RTE_NAMEDTUPLESTORE)
+	{
+		/* Likewise for an ephemeral named relation */
+		if (strcmp(refname, rte->enrname) != 0)
+			printalias = true;
+	}
 
 	if (printalias)
 		appendStringInfo(context->buf, "%s%s",
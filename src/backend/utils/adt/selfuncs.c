@@ -213,6 +213,8 @@ static bool get_actual_variable_endpoint(Relation heapRel,
 										 MemoryContext outercontext,
 										 Datum *endpointDatum);
 static RelOptInfo *find_join_input_rel(PlannerInfo *root, Relids relids);
+static double btcost_skip_ndistinct(PlannerInfo *root, IndexOptInfo *index,
+									int indexcol);
 
 
 /*
@@ -6794,6 +6796,49 @@ add_predicate_to_index_quals(IndexOptInfo *index, List *indexQuals)
 	return list_concat(predExtraQuals, indexQuals);
 }
 
+/*
+ * Estimate the number of distinct values in a btree index column that a
+ * skip scan would have to step through, for btcostestimate.
+ *
+ * Returns -1 when we can't make a reasonable estimate, in which case the
+ * caller should not assume that the column can be skipped.  We only handle
+ * plain table columns with statistics for now.
+ */
+static double
+btcost_skip_ndistinct(PlannerInfo *root, IndexOptInfo *index, int indexcol)
+{
+	AttrNumber	attnum = index->indexkeys[indexcol];
+	RangeTblEntry *rte;
+	Oid			vartype;
+	int32		vartypmod;
+	Oid			varcollid;
+	Var		   *var;
+	VariableStatData vardata;
+	double		ndistinct;
+	bool		isdefault;
+
+	if (attnum == 0)
+		return -1;				/* expression column */
+
+	rte = planner_rt_fetch(index->rel->relid, root);
+	Assert(rte->rtekind == RTE_RELATION);
+	get_atttypetypmodcoll(rte->relid, attnum,
+						  &vartype, &vartypmod, &varcollid);
+	var = makeVar(index->rel->relid, attnum,
+				  vartype, vartypmod, varcollid, 0);
+
+	examine_variable(root, (Node *) var, 0, &vardata);
+	ndistinct = get_variable_numdistinct(&vardata, &isdefault);
+
+	/* NULLs form a group of their own */
+	if (HeapTupleIsValid(vardata.statsTuple) &&
+		((Form_pg_statistic) GETSTRUCT(vardata.statsTuple))->stanullfrac > 0.0)
+		ndistinct += 1;
+
+	ReleaseVariableStats(vardata);
+
+	return isdefault ? -1 : ndistinct;
+}
 
 void
 btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
@@ -6810,7 +6855,9 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	Cost		descentCost;
 	List	   *indexBoundQuals;
 	int			indexcol;
+	bool		qualHere;
 	bool		eqQualHere;
+	bool		found_skip;
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
@@ -6832,10 +6879,18 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * If there's a ScalarArrayOpExpr in the quals, we'll actually perform up
 	 * to N index descents (not just one), but the ScalarArrayOpExpr's
 	 * operator can be considered to act the same as it normally does.
+	 *
+	 * Index columns without any quals that come before a column with quals
+	 * are handled by skip scan at runtime, which behaves like an '=' qual on
+	 * every distinct value of the skipped column.  We charge for one descent
+	 * per distinct value, much like a ScalarArrayOpExpr.  Parallel scans
+	 * don't use skip scan.
 	 */
 	indexBoundQuals = NIL;
 	indexcol = 0;
+	qualHere = false;
 	eqQualHere = false;
+	found_skip = false;
 	found_saop = false;
 	found_is_null_op = false;
 	num_sa_scans = 1;
@@ -6846,14 +6901,39 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 
 		if (indexcol != iclause->indexcol)
 		{
+			double		num_skip_scans = 1;
+
 			/* Beginning of a new column's quals */
-			if (!eqQualHere)
-				break;			/* done if no '=' qual for indexcol */
+			if (qualHere)
+			{
+				if (!eqQualHere)
+					break;		/* done if no '=' qual for indexcol */
+				indexcol++;
+			}
+			qualHere = false;
 			eqQualHere = false;
-			indexcol++;
+
+			/* Try to skip over any columns without quals */
+			while (indexcol != iclause->indexcol &&
+				   !path->path.parallel_aware)
+			{
+				double		ndistinct;
+
+				ndistinct = btcost_skip_ndistinct(root, index, indexcol);
+				if (ndistinct < 1)
+					break;
+				num_skip_scans *= ndistinct;
+				indexcol++;
+			}
 			if (indexcol != iclause->indexcol)
 				break;			/* no quals at all for indexcol */
+			if (num_skip_scans > 1)
+			{
+				found_skip = true;
+				num_sa_scans *= num_skip_scans;
+			}
 		}
+		qualHere = true;
 
 		/* Examine each indexqual associated with this index clause */
 		foreach(lc2, iclause->indexquals)
@@ -6920,11 +7000,13 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * If index is unique and we found an '=' clause for each column, we can
 	 * just assume numIndexTuples = 1 and skip the expensive
 	 * clauselist_selectivity calculations.  However, a ScalarArrayOp or
-	 * NullTest invalidates that theory, even though it sets eqQualHere.
+	 * NullTest invalidates that theory, even though it sets eqQualHere.  So
+	 * does skipping over a column.
 	 */
 	if (index->unique &&
 		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
+		!found_skip &&
 		!found_saop &&
 		!found_is_null_op)
 		numIndexTuples = 1.0;
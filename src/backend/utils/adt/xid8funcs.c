@@ -26,6 +26,7 @@
 
 #include "postgres.h"
 
+#include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "funcapi.h"
@@ -217,6 +218,62 @@ sort_snapshot(pg_snapshot *snap)
 	}
 }
 
+/*
+ * CSN snapshots don't carry a list of running XIDs, so compute it: these are
+ * the top-level XIDs between xmin and xmax that had not committed when the
+ * snapshot was taken, except for aborted or crashed ones.  Our own XID is
+ * left out, as GetSnapshotData() does.
+ *
+ * Such an XID is either still running, which one pass over the ProcArray
+ * tells us, or it has committed since; only the CSN log, clog and subtrans
+ * are consulted for the XIDs in between.
+ */
+static TransactionId *
+csn_snapshot_xip(Snapshot snapshot, uint32 *nxip)
+{
+	TransactionId *running;
+	int			nrunning;
+	TransactionId *xip;
+	TransactionId xid;
+	uint32		size = 64;
+	uint32		n = 0;
+
+	running = GetRunningTopLevelXids(&nrunning);
+	xip = palloc(size * sizeof(TransactionId));
+
+	for (xid = snapshot->xmin; TransactionIdPrecedes(xid, snapshot->xmax); xid++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		/* xmin and xmax are normal, so this can only happen on wraparound */
+		if (!TransactionIdIsNormal(xid))
+			continue;
+
+		if (!XidInMVCCSnapshot(xid, snapshot) ||
+			TransactionIdIsCurrentTransactionId(xid))
+			continue;
+
+		/* Unless still running, it must since have committed as a top level */
+		if (bsearch(&xid, running, nrunning, sizeof(TransactionId),
+					xidComparator) == NULL &&
+			(!TransactionIdDidCommit(xid) ||
+			 TransactionIdIsValid(SubTransGetParent(xid))))
+			continue;
+
+		if (n >= size)
+		{
+			size *= 2;
+			xip = repalloc(xip, size * sizeof(TransactionId));
+		}
+		xip[n++] = xid;
+	}
+
+	pfree(running);
+
+	*nxip = n;
+	return xip;
+}
+
 /*
  * check fxid visibility.
  */
@@ -410,14 +467,22 @@ pg_current_snapshot(PG_FUNCTION_ARGS)
 	uint32		nxip,
 				i;
 	Snapshot	cur;
+	TransactionId *xip;
 	FullTransactionId next_fxid = ReadNextFullTransactionId();
 
 	cur = GetActiveSnapshot();
 	if (cur == NULL)
 		elog(ERROR, "no active snapshot set");
 
+	if (CommitSeqNoIsValid(cur->snapshotcsn))
+		xip = csn_snapshot_xip(cur, &nxip);
+	else
+	{
+		xip = cur->xip;
+		nxip = cur->xcnt;
+	}
+
 	/* allocate */
-	nxip = cur->xcnt;
 	snap = palloc(PG_SNAPSHOT_SIZE(nxip));
 
 	/* fill */
@@ -425,7 +490,7 @@ pg_current_snapshot(PG_FUNCTION_ARGS)
 	snap->xmax = widen_snapshot_xid(cur->xmax, next_fxid);
 	snap->nxip = nxip;
 	for (i = 0; i < nxip; i++)
-		snap->xip[i] = widen_snapshot_xid(cur->xip[i], next_fxid);
+		snap->xip[i] = widen_snapshot_xid(xip[i], next_fxid);
 
 	/*
 	 * We want them guaranteed to be in ascending order.  This also removes
@@ -26,9 +26,7 @@
 #include "common/pg_prng.h"
 #include "miscadmin.h"
 #include "port/pg_bitutils.h"
-#ifdef CATCACHE_STATS
-#include "storage/ipc.h"		/* for on_proc_exit */
-#endif
+#include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "utils/builtins.h"
 #include "utils/catcache.h"
@@ -38,6 +36,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner.h"
+#include "utils/sharedcatcache.h"
 #include "utils/syscache.h"
 
 
@@ -64,11 +63,21 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* Context for handles of shared catalog cache tuples, created on first use */
+static MemoryContext SharedCatCacheHandleContext = NULL;
+
+/* Database that a cache's tuples are shared under in the shared catcache */
+#define CatCacheSharedDbId(cache) \
+	((cache)->cc_relisshared ? InvalidOid : MyDatabaseId)
+
 static inline HeapTuple SearchCatCacheInternal(CatCache *cache,
 											   int nkeys,
 											   Datum v1, Datum v2,
 											   Datum v3, Datum v4);
 
+static CatCTup *SearchCatCacheShared(CatCache *cache, int nkeys,
+									 Datum *arguments,
+									 uint32 hashValue, Index hashIndex);
 static pg_noinline HeapTuple SearchCatCacheMiss(CatCache *cache,
 												int nkeys,
 												uint32 hashValue,
@@ -95,7 +104,16 @@ static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache,
 										HeapTuple ntp, SysScanDesc scandesc,
 										Datum *arguments,
-										uint32 hashValue, Index hashIndex);
+										uint32 hashValue, Index hashIndex,
+										uint64 loadseq);
+static CatCTup *CatalogCacheCreateHandle(CatCache *cache, HeapTuple stuple,
+										 dsa_pointer ref,
+										 uint32 hashValue, Index hashIndex);
+static void CatCacheLinkEntry(CatCache *cache, CatCTup *ct, bool negative,
+							  uint32 hashValue, Index hashIndex);
+static void CatCacheExtractKeys(CatCache *cache, HeapTuple tuple,
+								Datum *keys);
+static void CatCacheReleaseShared(int code, Datum arg);
 
 static void ReleaseCatCacheWithOwner(HeapTuple tuple, ResourceOwner resowner);
 static void ReleaseCatCacheListWithOwner(CatCList *list, ResourceOwner resowner);
@@ -529,11 +547,14 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 
 	/*
 	 * Free keys when we're dealing with a negative entry, normal entries just
-	 * point into tuple, allocated together with the CatCTup.
+	 * point into tuple, allocated together with the CatCTup or in shared
+	 * memory.
 	 */
 	if (ct->negative)
 		CatCacheFreeKeys(cache->cc_tupdesc, cache->cc_nkeys,
 						 cache->cc_keyno, ct->keys);
+	else if (DsaPointerIsValid(ct->shared_tuple))
+		SharedCatCacheRelease(ct->shared_tuple);
 
 	pfree(ct);
 
@@ -767,6 +788,46 @@ ResetCatalogCaches(void)
 	CACHE_elog(DEBUG2, "end of ResetCatalogCaches call");
 }
 
+/*
+ *		CatCacheReleaseShared
+ *
+ * before_shmem_exit callback giving back all our references to tuples in the
+ * shared catalog cache, since nobody else will do that once we are gone.
+ * The entries are only marked dead; nothing should search the catcaches
+ * anymore at this point.
+ */
+static void
+CatCacheReleaseShared(int code, Datum arg)
+{
+	slist_iter	iter;
+
+	if (SharedCatCacheHandleContext == NULL)
+		return;
+
+	slist_foreach(iter, &CacheHdr->ch_caches)
+	{
+		CatCache   *cache = slist_container(CatCache, cc_next, iter.cur);
+
+		for (int i = 0; i < cache->cc_nbuckets; i++)
+		{
+			dlist_iter	biter;
+
+			dlist_foreach(biter, &cache->cc_bucket[i])
+			{
+				CatCTup    *ct = dlist_container(CatCTup, cache_elem,
+												 biter.cur);
+
+				if (DsaPointerIsValid(ct->shared_tuple))
+				{
+					SharedCatCacheRelease(ct->shared_tuple);
+					ct->shared_tuple = InvalidDsaPointer;
+					ct->dead = true;
+				}
+			}
+		}
+	}
+}
+
 /*
  *		CatalogCacheFlushCatalog
  *
@@ -866,6 +927,14 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+
+		/*
+		 * Give back references to shared catalog cache tuples at backend
+		 * exit.  Registering this here, during InitPostgres, makes it run
+		 * after ShutdownPostgres has released any catcache references held
+		 * by an aborted transaction.
+		 */
+		before_shmem_exit(CatCacheReleaseShared, 0);
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1414,6 +1483,33 @@ SearchCatCacheInternal(CatCache *cache,
 	return SearchCatCacheMiss(cache, nkeys, hashValue, hashIndex, v1, v2, v3, v4);
 }
 
+/*
+ * Search the shared catalog cache for a tuple matching the given keys, and
+ * if found, make a local entry referencing it.
+ */
+static CatCTup *
+SearchCatCacheShared(CatCache *cache, int nkeys, Datum *arguments,
+					 uint32 hashValue, Index hashIndex)
+{
+	HeapTupleData stuple;
+	dsa_pointer ref;
+	Datum		keys[CATCACHE_MAXKEYS];
+
+	if (!SharedCatCacheLookup(CatCacheSharedDbId(cache), cache->id,
+							  hashValue, &stuple, &ref))
+		return NULL;
+
+	/* The shared cache is keyed by hash value only, so check the keys */
+	CatCacheExtractKeys(cache, &stuple, keys);
+	if (!CatalogCacheCompareTuple(cache, nkeys, keys, arguments))
+	{
+		SharedCatCacheRelease(ref);
+		return NULL;
+	}
+
+	return CatalogCacheCreateHandle(cache, &stuple, ref, hashValue, hashIndex);
+}
+
 /*
  * Search the actual catalogs, rather than the cache.
  *
@@ -1437,6 +1533,7 @@ SearchCatCacheMiss(CatCache *cache,
 	HeapTuple	ntp;
 	CatCTup    *ct;
 	bool		stale;
+	uint64		loadseq = 0;
 	Datum		arguments[CATCACHE_MAXKEYS];
 
 	/* Initialize local parameter array */
@@ -1445,6 +1542,34 @@ SearchCatCacheMiss(CatCache *cache,
 	arguments[2] = v3;
 	arguments[3] = v4;
 
+	/*
+	 * Before reading the catalog ourselves, see whether another backend has
+	 * already put the tuple into the shared catalog cache.  If not, we'll
+	 * offer it the tuple we read.
+	 */
+	if (SharedCatCacheUsable())
+	{
+		ct = SearchCatCacheShared(cache, nkeys, arguments,
+								  hashValue, hashIndex);
+		if (ct != NULL)
+		{
+			ResourceOwnerEnlarge(CurrentResourceOwner);
+			ct->refcount++;
+			ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+			CACHE_elog(DEBUG2, "SearchCatCache(%s): found in shared cache",
+					   cache->cc_relname);
+
+#ifdef CATCACHE_STATS
+			cache->cc_newloads++;
+#endif
+
+			return &ct->tuple;
+		}
+
+		loadseq = SharedCatCacheBeginLoad();
+	}
+
 	/*
 	 * Tuple was not found in cache, so we have to try to retrieve it directly
 	 * from the relation.  If found, we will add it to the cache; if not
@@ -1493,7 +1618,7 @@ SearchCatCacheMiss(CatCache *cache,
 		while (HeapTupleIsValid(ntp = systable_getnext(scandesc)))
 		{
 			ct = CatalogCacheCreateEntry(cache, ntp, scandesc, NULL,
-										 hashValue, hashIndex);
+										 hashValue, hashIndex, loadseq);
 			/* upon failure, we must start the scan over */
 			if (ct == NULL)
 			{
@@ -1528,7 +1653,7 @@ SearchCatCacheMiss(CatCache *cache,
 			return NULL;
 
 		ct = CatalogCacheCreateEntry(cache, NULL, NULL, arguments,
-									 hashValue, hashIndex);
+									 hashValue, hashIndex, 0);
 
 		/* Creating a negative cache entry shouldn't fail */
 		Assert(ct != NULL);
@@ -1854,7 +1979,7 @@ SearchCatCacheList(CatCache *cache,
 				{
 					/* We didn't find a usable entry, so make a new one */
 					ct = CatalogCacheCreateEntry(cache, ntp, scandesc, NULL,
-												 hashValue, hashIndex);
+												 hashValue, hashIndex, 0);
 					/* upon failure, we must start the scan over */
 					if (ct == NULL)
 					{
@@ -2034,6 +2159,10 @@ equalTuple(HeapTuple a, HeapTuple b)
  * keys to use.  In either case, hashValue/hashIndex are the hash values
  * computed from the cache keys.
  *
+ * If loadseq is not zero, it's the value SharedCatCacheBeginLoad returned
+ * before ntp was fetched, and we try to put the tuple into the shared
+ * catalog cache instead of copying it into local memory.
+ *
  * Returns NULL if we attempt to detoast the tuple and observe that it
  * became stale.  (This cannot happen for a negative entry.)  Caller must
  * retry the tuple lookup in that case.
@@ -2041,7 +2170,8 @@ equalTuple(HeapTuple a, HeapTuple b)
 static CatCTup *
 CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, SysScanDesc scandesc,
 						Datum *arguments,
-						uint32 hashValue, Index hashIndex)
+						uint32 hashValue, Index hashIndex,
+						uint64 loadseq)
 {
 	CatCTup    *ct;
 	HeapTuple	dtp;
@@ -2049,8 +2179,6 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, SysScanDesc scandesc,
 
 	if (ntp)
 	{
-		int			i;
-
 		/*
 		 * The visibility recheck below essentially never fails during our
 		 * regression tests, and there's no easy way to force it to fail for
@@ -2109,6 +2237,21 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, SysScanDesc scandesc,
 		else
 			dtp = ntp;
 
+		if (loadseq != 0)
+		{
+			HeapTupleData stuple;
+			dsa_pointer ref;
+
+			if (SharedCatCacheInsert(CatCacheSharedDbId(cache), cache->id,
+									 hashValue, loadseq, dtp, &stuple, &ref))
+			{
+				if (dtp != ntp)
+					heap_freetuple(dtp);
+				return CatalogCacheCreateHandle(cache, &stuple, ref,
+												hashValue, hashIndex);
+			}
+		}
+
 		/* Allocate memory for CatCTup and the cached tuple in one go */
 		oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
 
@@ -2129,18 +2272,7 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, SysScanDesc scandesc,
 			heap_freetuple(dtp);
 
 		/* extract keys - they'll point into the tuple if not by-value */
-		for (i = 0; i < cache->cc_nkeys; i++)
-		{
-			Datum		atp;
-			bool		isnull;
-
-			atp = heap_getattr(&ct->tuple,
-							   cache->cc_keyno[i],
-							   cache->cc_tupdesc,
-							   &isnull);
-			Assert(!isnull);
-			ct->keys[i] = atp;
-		}
+		CatCacheExtractKeys(cache, &ct->tuple, ct->keys);
 	}
 	else
 	{
@@ -2157,16 +2289,57 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, SysScanDesc scandesc,
 		MemoryContextSwitchTo(oldcxt);
 	}
 
-	/*
-	 * Finish initializing the CatCTup header, and add it to the cache's
-	 * linked list and counts.
-	 */
+	ct->shared_tuple = InvalidDsaPointer;
+	CatCacheLinkEntry(cache, ct, (ntp == NULL), hashValue, hashIndex);
+
+	return ct;
+}
+
+/*
+ * CatalogCacheCreateHandle
+ *		Create a new CatCTup entry for a tuple in the shared catalog cache.
+ *
+ * stuple and ref are as returned by SharedCatCacheLookup or
+ * SharedCatCacheInsert; the new entry takes over the reference.  Only the
+ * CatCTup itself is allocated in local memory.
+ */
+static CatCTup *
+CatalogCacheCreateHandle(CatCache *cache, HeapTuple stuple, dsa_pointer ref,
+						 uint32 hashValue, Index hashIndex)
+{
+	CatCTup    *ct;
+
+	if (SharedCatCacheHandleContext == NULL)
+		SharedCatCacheHandleContext =
+			AllocSetContextCreate(CacheMemoryContext,
+								  "SharedCatCacheHandles",
+								  ALLOCSET_DEFAULT_SIZES);
+
+	ct = (CatCTup *) MemoryContextAlloc(SharedCatCacheHandleContext,
+										sizeof(CatCTup));
+	ct->tuple = *stuple;
+	ct->shared_tuple = ref;
+	CatCacheExtractKeys(cache, &ct->tuple, ct->keys);
+
+	CatCacheLinkEntry(cache, ct, false, hashValue, hashIndex);
+
+	return ct;
+}
+
+/*
+ * Finish initializing a new CatCTup header, and add it to the cache's
+ * linked list and counts.
+ */
+static void
+CatCacheLinkEntry(CatCache *cache, CatCTup *ct, bool negative,
+				  uint32 hashValue, Index hashIndex)
+{
 	ct->ct_magic = CT_MAGIC;
 	ct->my_cache = cache;
 	ct->c_list = NULL;
 	ct->refcount = 0;			/* for the moment */
 	ct->dead = false;
-	ct->negative = (ntp == NULL);
+	ct->negative = negative;
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
@@ -2180,8 +2353,27 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, SysScanDesc scandesc,
 	 */
 	if (cache->cc_ntup > cache->cc_nbuckets * 2)
 		RehashCatCache(cache);
+}
 
-	return ct;
+/*
+ * Helper routine that extracts the lookup keys of a cached tuple.  Keys that
+ * are not by-value point into the tuple.
+ */
+static void
+CatCacheExtractKeys(CatCache *cache, HeapTuple tuple, Datum *keys)
+{
+	for (int i = 0; i < cache->cc_nkeys; i++)
+	{
+		Datum		atp;
+		bool		isnull;
+
+		atp = heap_getattr(tuple,
+						   cache->cc_keyno[i],
+						   cache->cc_tupdesc,
+						   &isnull);
+		Assert(!isnull);
+		keys[i] = atp;
+	}
 }
 
 /*
@@ -124,6 +124,9 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/relmapper.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
+#include "utils/sharedresultcache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -865,6 +868,20 @@ PostPrepare_Inval(void)
 	AtEOXact_Inval(false);
 }
 
+/*
+ * TransactionHasInvalidations
+ *		Has the current transaction queued any invalidation messages?
+ *
+ * That is the case as soon as it has modified a system catalog, so a false
+ * result means that our catalog lookups see the same tuples as everyone
+ * else's.
+ */
+bool
+TransactionHasInvalidations(void)
+{
+	return transInvalInfo != NULL;
+}
+
 /*
  * xactGetCommittedInvalidationMessages() is called by
  * RecordTransactionCommit() to collect invalidation messages to add to the
@@ -991,7 +1008,10 @@ ProcessCommittedInvalidationMessages(SharedInvalidationMessage *msgs,
 		}
 	}
 
+	SharedCatCacheInvalidate(msgs, nmsgs);
 	SendSharedInvalidMessages(msgs, nmsgs);
+	SharedPlanCacheInvalidate(msgs, nmsgs);
+	SharedResultCacheInvalidate(msgs, nmsgs);
 
 	if (RelcacheInitFileInval)
 		RelationCacheInitFilePostInvalidate();
@@ -1044,8 +1064,18 @@ AtEOXact_Inval(bool isCommit)
 		AppendInvalidationMessages(&transInvalInfo->PriorCmdInvalidMsgs,
 								   &transInvalInfo->CurrentCmdInvalidMsgs);
 
+		/*
+		 * The shared catalog cache must forget the affected tuples before
+		 * anyone can act on the messages we send.
+		 */
+		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
+										 SharedCatCacheInvalidate);
 		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
 										 SendSharedInvalidMessages);
+		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
+										 SharedPlanCacheInvalidate);
+		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
+										 SharedResultCacheInvalidate);
 
 		if (transInvalInfo->RelcacheInitFileInval)
 			RelationCacheInitFilePostInvalidate();
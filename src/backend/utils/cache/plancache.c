@@ -58,11 +58,13 @@
 
 #include "access/transam.h"
 #include "catalog/namespace.h"
+#include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
 #include "parser/analyze.h"
+#include "parser/parsetree.h"
 #include "storage/lmgr.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
@@ -70,6 +72,7 @@
 #include "utils/memutils.h"
 #include "utils/resowner.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -102,14 +105,18 @@ static dlist_head cached_expression_list = DLIST_STATIC_INIT(cached_expression_l
 static void ReleaseGenericPlan(CachedPlanSource *plansource);
 static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 								   QueryEnvironment *queryEnv);
-static bool CheckCachedPlan(CachedPlanSource *plansource);
+static bool CheckCachedPlan(CachedPlanSource *plansource,
+							ParamListInfo boundParams);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 								   ParamListInfo boundParams, QueryEnvironment *queryEnv);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
 static Query *QueryListGetPrimaryStmt(List *stmts);
-static void AcquireExecutorLocks(List *stmt_list, bool acquire);
+static void AcquireExecutorLocks(List *stmt_list, bool acquire,
+								 bool defer_prunable);
+static void AcquireUnprunedPartitionLocks(CachedPlan *plan,
+										  ParamListInfo boundParams);
 static void AcquirePlannerLocks(List *stmt_list, bool acquire);
 static void ScanQueryForLocks(Query *parsetree, bool acquire);
 static bool ScanQueryWalker(Node *node, bool *acquire);
@@ -817,9 +824,10 @@ RevalidateCachedQuery(CachedPlanSource *plansource,
  *
  * On a "true" return, we have acquired the locks needed to run the plan.
  * (We must do this for the "true" result to be race-condition-free.)
+ * boundParams are used to work out which partitions need locking.
  */
 static bool
-CheckCachedPlan(CachedPlanSource *plansource)
+CheckCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams)
 {
 	CachedPlan *plan = plansource->gplan;
 
@@ -853,7 +861,7 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		 */
 		Assert(plan->refcount > 0);
 
-		AcquireExecutorLocks(plan->stmt_list, true);
+		AcquireExecutorLocks(plan->stmt_list, true, true);
 
 		/*
 		 * If plan was transient, check to see if TransactionXmin has
@@ -864,6 +872,15 @@ CheckCachedPlan(CachedPlanSource *plansource)
 			!TransactionIdEquals(plan->saved_xmin, TransactionXmin))
 			plan->is_valid = false;
 
+		/*
+		 * Only once the plan is known to be valid as far as the relations
+		 * locked so far go is it safe to run its initial pruning steps, to
+		 * find and lock the partitions that will be scanned.  That may
+		 * invalidate the plan again, which is checked below.
+		 */
+		if (plan->is_valid)
+			AcquireUnprunedPartitionLocks(plan, boundParams);
+
 		/*
 		 * By now, if any invalidation has happened, the inval callback
 		 * functions will have marked the plan invalid.
@@ -875,7 +892,7 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		}
 
 		/* Oops, the race case happened.  Release useless locks. */
-		AcquireExecutorLocks(plan->stmt_list, false);
+		AcquireExecutorLocks(plan->stmt_list, false, true);
 	}
 
 	/*
@@ -910,6 +927,8 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	List	   *plist;
 	bool		snapshot_set;
 	bool		is_transient;
+	bool		use_shared_cache;
+	SharedPlanCacheProbe probe;
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
 	ListCell   *lc;
@@ -956,11 +975,42 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 		snapshot_set = true;
 	}
 
+	/*
+	 * A generic plan might be available from the shared plan cache.  If so,
+	 * we must lock the relations it uses ourselves, as the planner would
+	 * have done, and make sure it didn't get invalidated while we waited.
+	 */
+	plist = NIL;
+	use_shared_cache = (boundParams == NULL &&
+						SharedPlanCacheEligible(plansource, queryEnv));
+	if (use_shared_cache)
+	{
+		plist = SharedPlanCacheLookup(plansource, &probe);
+		if (plist != NIL)
+		{
+			AcquireExecutorLocks(plist, true, false);
+			if (!SharedPlanCacheRecheck(&probe))
+			{
+				AcquireExecutorLocks(plist, false, false);
+				plist = NIL;
+			}
+			else
+				use_shared_cache = false;	/* no need to store it again */
+		}
+	}
+
 	/*
 	 * Generate the plan.
 	 */
-	plist = pg_plan_queries(qlist, plansource->query_string,
-							plansource->cursor_options, boundParams);
+	if (plist == NIL)
+	{
+		plist = pg_plan_queries(qlist, plansource->query_string,
+								plansource->cursor_options, boundParams);
+
+		/* Share it, unless an invalidation arrived in the meantime */
+		if (use_shared_cache && plansource->is_valid)
+			SharedPlanCacheStore(&probe, plansource, plist);
+	}
 
 	/* Release snapshot if we got one */
 	if (snapshot_set)
@@ -1187,7 +1237,7 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 
 	if (!customplan)
 	{
-		if (CheckCachedPlan(plansource))
+		if (CheckCachedPlan(plansource, boundParams))
 		{
 			/* We want a generic plan, and we already have a valid one */
 			plan = plansource->gplan;
@@ -1767,9 +1817,12 @@ QueryListGetPrimaryStmt(List *stmts)
 /*
  * AcquireExecutorLocks: acquire locks needed for execution of a cached plan;
  * or release them if acquire is false.
+ *
+ * If defer_prunable is true, leaf partitions that initial pruning may remove
+ * are skipped; AcquireUnprunedPartitionLocks deals with those.
  */
 static void
-AcquireExecutorLocks(List *stmt_list, bool acquire)
+AcquireExecutorLocks(List *stmt_list, bool acquire, bool defer_prunable)
 {
 	ListCell   *lc1;
 
@@ -1777,6 +1830,7 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 	{
 		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
 		ListCell   *lc2;
+		Index		rti;
 
 		if (plannedstmt->commandType == CMD_UTILITY)
 		{
@@ -1794,14 +1848,20 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 			continue;
 		}
 
+		rti = 0;
 		foreach(lc2, plannedstmt->rtable)
 		{
 			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc2);
 
+			rti++;
 			if (!(rte->rtekind == RTE_RELATION ||
 				  (rte->rtekind == RTE_SUBQUERY && OidIsValid(rte->relid))))
 				continue;
 
+			if (defer_prunable &&
+				bms_is_member(rti, plannedstmt->prunableRelids))
+				continue;
+
 			/*
 			 * Acquire the appropriate type of lock on each relation OID. Note
 			 * that we don't actually try to open the rel, and hence will not
@@ -1816,6 +1876,59 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 	}
 }
 
+/*
+ * AcquireUnprunedPartitionLocks: acquire locks on the leaf partitions of a
+ * cached plan that survive initial pruning.
+ *
+ * A generic plan over a partitioned table contains every partition that
+ * couldn't be pruned at plan time, which for parameterized queries can be
+ * all of them; the executor will skip most of them again once the parameter
+ * values are known.  Rather than locking them all, run the initial pruning
+ * steps now and lock just the survivors.  There's no need to release these
+ * locks if the plan turns out to be invalid; that's only an optimization.
+ *
+ * The partitions left unlocked are recorded in each PlannedStmt's
+ * prunedRelids, so that the executor doesn't scan them even if its own
+ * initial pruning were to disagree.
+ */
+static void
+AcquireUnprunedPartitionLocks(CachedPlan *plan, ParamListInfo boundParams)
+{
+	ListCell   *lc;
+
+	foreach(lc, plan->stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+		Bitmapset  *unpruned;
+		MemoryContext oldcxt;
+		int			rti;
+
+		if (plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->prunableRelids == NULL)
+			continue;
+
+		/* Forget the result of the previous execution */
+		bms_free(plannedstmt->prunedRelids);
+		plannedstmt->prunedRelids = NULL;
+
+		unpruned = ExecGetUnprunedRelids(plannedstmt, boundParams);
+
+		rti = -1;
+		while ((rti = bms_next_member(unpruned, rti)) >= 0)
+		{
+			RangeTblEntry *rte = rt_fetch(rti, plannedstmt->rtable);
+
+			LockRelationOid(rte->relid, rte->rellockmode);
+		}
+
+		oldcxt = MemoryContextSwitchTo(plan->context);
+		plannedstmt->prunedRelids = bms_difference(plannedstmt->prunableRelids,
+												   unpruned);
+		MemoryContextSwitchTo(oldcxt);
+		bms_free(unpruned);
+	}
+}
+
 /*
  * AcquirePlannerLocks: acquire locks needed for planning of a querytree list;
  * or release them if acquire is false.
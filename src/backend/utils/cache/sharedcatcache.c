@@ -0,0 +1,557 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Catalog cache tuples shared across backends.
+ *
+ * Every backend keeps its own catcache, so with many connections the same
+ * catalog tuples are read from the catalogs and copied into local memory
+ * over and over.  When shared_catalog_cache is enabled, catcache.c consults
+ * a hash table in dynamic shared memory before scanning the catalog, and
+ * publishes the tuples it had to read itself.  A backend that finds a tuple
+ * there only allocates a small CatCTup in local memory, whose tuple header
+ * points into the shared copy.  Each shared tuple carries a reference count:
+ * the hash table holds one reference, and each backend-local handle holds
+ * another, so a tuple is freed only once it has been removed from the table
+ * and every backend has let go of it.  catcache.c drops all its references
+ * when the backend exits.
+ *
+ * Only positive entries found by exact-key searches are shared.  Negative
+ * entries and list searches stay in the local catcache.
+ *
+ * Invalidation: like sharedplancache.c, we hash each (cache ID, hash value)
+ * pair into one of a fixed number of slots, and each slot holds the sequence
+ * number of the last invalidation that mapped to it.  A committing
+ * transaction advances the slots of the catcache entries named in its
+ * invalidation messages after it has become visible as committed, but
+ * *before* it sends those messages, so that a backend that has processed a
+ * message can't find a shared tuple that the message should have flushed.
+ * A backend that loads a tuple remembers the current sequence number and
+ * then takes a fresh catalog snapshot, so the tuple it reads reflects every
+ * commit whose invalidations are covered by that number; the tuple is usable
+ * as long as its slot has not advanced past it.  Stale tuples are removed
+ * lazily when they are looked up, or when space runs out.
+ *
+ * A transaction that has modified the catalogs sees tuples that other
+ * backends must not, so such transactions bypass the shared cache entirely.
+ * So does logical decoding, which reads the catalogs with historic
+ * snapshots.
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
+
+
+/* Number of invalidation slots that catcache hash values are mapped to */
+#define SCC_INVAL_SLOTS		8192
+
+typedef struct SharedCatCacheCtlData
+{
+	LWLock		lock;			/* protects creation of the hash table, and
+								 * serializes reclaiming space */
+	dsa_handle	area_handle;
+	dshash_table_handle hash_handle;
+
+	pg_atomic_uint64 next_seq;	/* next invalidation sequence number */
+	pg_atomic_uint64 reset_seq; /* last invalidation of all tuples */
+	pg_atomic_uint64 slot_seq[SCC_INVAL_SLOTS];
+} SharedCatCacheCtlData;
+
+typedef struct SharedCatCacheKey
+{
+	Oid			dbid;			/* InvalidOid for shared catalogs */
+	int			cacheid;
+	uint32		hashvalue;
+} SharedCatCacheKey;
+
+typedef struct SharedCatCacheEntry
+{
+	SharedCatCacheKey key;		/* hash key; must be first */
+	uint64		loadseq;		/* invalidation sequence when loading began */
+	dsa_pointer tuple;			/* SharedCatCTup */
+} SharedCatCacheEntry;
+
+/*
+ * A shared catalog tuple, followed by its MAXALIGN'd data.  The fields
+ * other than refcount are never changed once the tuple is published.
+ */
+typedef struct SharedCatCTup
+{
+	pg_atomic_uint32 refcount;	/* hash table's reference + local handles */
+	uint32		t_len;
+	ItemPointerData t_self;
+	Oid			t_tableOid;
+} SharedCatCTup;
+
+#define SCC_TUPLE_DATA(stup) \
+	((HeapTupleHeader) ((char *) (stup) + MAXALIGN(sizeof(SharedCatCTup))))
+
+static const dshash_parameters scc_hash_params = {
+	sizeof(SharedCatCacheKey),
+	sizeof(SharedCatCacheEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	dshash_memcpy,
+	LWTRANCHE_SHARED_CATCACHE_HASH
+};
+
+/* GUC parameters */
+bool		shared_catalog_cache = false;
+int			shared_catalog_cache_size = 65536;
+
+static SharedCatCacheCtlData *SharedCatCacheCtl = NULL;
+static dsa_area *scc_area = NULL;
+static dshash_table *scc_hash = NULL;
+
+static void scc_attach(void);
+static bool scc_entry_is_valid(SharedCatCacheEntry *entry);
+static void scc_fill_tuple(dsa_pointer ref, HeapTuple tuple);
+static void scc_unref(dsa_pointer ref);
+static void scc_remove_entry(const SharedCatCacheKey *key, dsa_pointer ref);
+static bool scc_reclaim(bool evict_unused);
+
+static inline uint32
+scc_slot(int cacheid, uint32 hashvalue)
+{
+	return hash_combine(hash_uint32((uint32) cacheid), hashvalue) %
+		SCC_INVAL_SLOTS;
+}
+
+static inline void
+scc_init_key(SharedCatCacheKey *key, Oid dbid, int cacheid, uint32 hashvalue)
+{
+	/* clear padding, as the key is compared with memcmp */
+	memset(key, 0, sizeof(SharedCatCacheKey));
+	key->dbid = dbid;
+	key->cacheid = cacheid;
+	key->hashvalue = hashvalue;
+}
+
+
+/*
+ * Report shared memory space needed by SharedCatCacheShmemInit
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	return sizeof(SharedCatCacheCtlData);
+}
+
+/*
+ * Allocate and initialize the fixed-size part of the shared catalog cache.
+ * The hash table itself is created on first use.
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	bool		found;
+
+	SharedCatCacheCtl = (SharedCatCacheCtlData *)
+		ShmemInitStruct("Shared Catalog Cache", SharedCatCacheShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		LWLockInitialize(&SharedCatCacheCtl->lock, LWTRANCHE_SHARED_CATCACHE);
+		SharedCatCacheCtl->area_handle = DSA_HANDLE_INVALID;
+		SharedCatCacheCtl->hash_handle = DSHASH_HANDLE_INVALID;
+		pg_atomic_init_u64(&SharedCatCacheCtl->next_seq, 1);
+		pg_atomic_init_u64(&SharedCatCacheCtl->reset_seq, 0);
+		for (int i = 0; i < SCC_INVAL_SLOTS; i++)
+			pg_atomic_init_u64(&SharedCatCacheCtl->slot_seq[i], 0);
+	}
+}
+
+/*
+ * Create or attach to the shared hash table, if not already done.
+ */
+static void
+scc_attach(void)
+{
+	MemoryContext oldcontext;
+
+	/* Quick exit if we already did this. */
+	if (scc_hash != NULL)
+		return;
+
+	/* Use a lock to ensure only one process creates the table. */
+	LWLockAcquire(&SharedCatCacheCtl->lock, LW_EXCLUSIVE);
+
+	/* Be sure any local memory allocated by DSA routines is persistent. */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	if (SharedCatCacheCtl->hash_handle == DSHASH_HANDLE_INVALID)
+	{
+		scc_area = dsa_create(LWTRANCHE_SHARED_CATCACHE_DSA);
+		dsa_pin(scc_area);
+		dsa_pin_mapping(scc_area);
+		dsa_set_size_limit(scc_area,
+						   (size_t) shared_catalog_cache_size * 1024);
+		scc_hash = dshash_create(scc_area, &scc_hash_params, NULL);
+
+		/* Store handles in shared memory for other backends to use. */
+		SharedCatCacheCtl->area_handle = dsa_get_handle(scc_area);
+		SharedCatCacheCtl->hash_handle = dshash_get_hash_table_handle(scc_hash);
+	}
+	else
+	{
+		scc_area = dsa_attach(SharedCatCacheCtl->area_handle);
+		dsa_pin_mapping(scc_area);
+		scc_hash = dshash_attach(scc_area, &scc_hash_params,
+								 SharedCatCacheCtl->hash_handle, NULL);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	LWLockRelease(&SharedCatCacheCtl->lock);
+}
+
+/*
+ * Can the current catalog lookup use the shared catalog cache?
+ */
+bool
+SharedCatCacheUsable(void)
+{
+	if (!shared_catalog_cache || shared_catalog_cache_size <= 0)
+		return false;
+
+	/* Nobody to share with in bootstrap or single-user mode */
+	if (!IsUnderPostmaster || SharedCatCacheCtl == NULL)
+		return false;
+
+	/* Cache flush testing wants every lookup to read the catalogs */
+	if (debug_discard_caches > 0)
+		return false;
+
+	/* Our own uncommitted catalog changes, or a historic snapshot */
+	if (TransactionHasInvalidations() || HistoricSnapshotActive())
+		return false;
+
+	return true;
+}
+
+/*
+ * Prepare to read a catalog tuple that may then be published with
+ * SharedCatCacheInsert.  Returns the sequence number to pass to it.
+ *
+ * The catalog snapshot may predate commits whose invalidations we have not
+ * processed yet, so throw it away; the scan will take a new one that sees
+ * everything committed before the returned sequence number was assigned.
+ */
+uint64
+SharedCatCacheBeginLoad(void)
+{
+	uint64		seq;
+
+	seq = pg_atomic_read_u64(&SharedCatCacheCtl->next_seq);
+	pg_read_barrier();
+	InvalidateCatalogSnapshot();
+
+	return seq;
+}
+
+/*
+ * Has the given entry's slot been invalidated since the entry was loaded?
+ */
+static bool
+scc_entry_is_valid(SharedCatCacheEntry *entry)
+{
+	uint32		slot = scc_slot(entry->key.cacheid, entry->key.hashvalue);
+
+	if (pg_atomic_read_u64(&SharedCatCacheCtl->reset_seq) > entry->loadseq)
+		return false;
+	if (pg_atomic_read_u64(&SharedCatCacheCtl->slot_seq[slot]) > entry->loadseq)
+		return false;
+
+	return true;
+}
+
+/*
+ * Point a local tuple header at a shared tuple.
+ */
+static void
+scc_fill_tuple(dsa_pointer ref, HeapTuple tuple)
+{
+	SharedCatCTup *stup = dsa_get_address(scc_area, ref);
+
+	tuple->t_len = stup->t_len;
+	tuple->t_self = stup->t_self;
+	tuple->t_tableOid = stup->t_tableOid;
+	tuple->t_data = SCC_TUPLE_DATA(stup);
+}
+
+/*
+ * Drop a reference to a shared tuple, freeing it if that was the last one.
+ */
+static void
+scc_unref(dsa_pointer ref)
+{
+	SharedCatCTup *stup = dsa_get_address(scc_area, ref);
+
+	if (pg_atomic_sub_fetch_u32(&stup->refcount, 1) == 0)
+		dsa_free(scc_area, ref);
+}
+
+/*
+ * Remove an entry that was found to be stale, unless someone else replaced
+ * it in the meantime.
+ */
+static void
+scc_remove_entry(const SharedCatCacheKey *key, dsa_pointer ref)
+{
+	SharedCatCacheEntry *entry;
+
+	entry = dshash_find(scc_hash, key, true);
+	if (entry == NULL)
+		return;
+
+	if (entry->tuple == ref)
+	{
+		dshash_delete_entry(scc_hash, entry);
+		scc_unref(ref);
+	}
+	else
+		dshash_release_lock(scc_hash, entry);
+}
+
+/*
+ * Look for a shared tuple with the given cache ID and hash value.
+ *
+ * On success, fills in *tuple to point at the shared copy and returns a
+ * reference to it in *ref, which the caller must eventually give back with
+ * SharedCatCacheRelease.  Since different keys can have the same hash value,
+ * the caller must still check that the tuple's keys match.
+ */
+bool
+SharedCatCacheLookup(Oid dbid, int cacheid, uint32 hashvalue,
+					 HeapTuple tuple, dsa_pointer *ref)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	SharedCatCTup *stup;
+
+	scc_attach();
+
+	scc_init_key(&key, dbid, cacheid, hashvalue);
+	entry = dshash_find(scc_hash, &key, false);
+	if (entry == NULL)
+		return false;
+
+	if (!scc_entry_is_valid(entry))
+	{
+		dsa_pointer stale = entry->tuple;
+
+		dshash_release_lock(scc_hash, entry);
+		scc_remove_entry(&key, stale);
+		return false;
+	}
+
+	/*
+	 * Nobody can remove the entry while we hold the partition lock, so the
+	 * tuple has at least the hash table's reference right now.
+	 */
+	*ref = entry->tuple;
+	stup = dsa_get_address(scc_area, *ref);
+	pg_atomic_fetch_add_u32(&stup->refcount, 1);
+	dshash_release_lock(scc_hash, entry);
+
+	scc_fill_tuple(*ref, tuple);
+	return true;
+}
+
+/*
+ * Publish the catalog tuple src, which was read after
+ * SharedCatCacheBeginLoad returned loadseq.
+ *
+ * On success, fills in *tuple and *ref as SharedCatCacheLookup does; the
+ * shared tuple may be one that another backend published concurrently.
+ * Returns false if the tuple could not be shared, in which case the caller
+ * should keep a local copy of src.
+ */
+bool
+SharedCatCacheInsert(Oid dbid, int cacheid, uint32 hashvalue,
+					 uint64 loadseq, HeapTuple src,
+					 HeapTuple tuple, dsa_pointer *ref)
+{
+	SharedCatCacheKey key;
+	SharedCatCacheEntry *entry;
+	SharedCatCTup *stup;
+	dsa_pointer dp;
+	Size		size;
+	bool		found;
+
+	scc_attach();
+
+	size = MAXALIGN(sizeof(SharedCatCTup)) + src->t_len;
+	dp = dsa_allocate_extended(scc_area, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		/* Out of space; discard stale entries, or failing that idle ones */
+		if (scc_reclaim(false))
+			dp = dsa_allocate_extended(scc_area, size, DSA_ALLOC_NO_OOM);
+		if (!DsaPointerIsValid(dp) && scc_reclaim(true))
+			dp = dsa_allocate_extended(scc_area, size, DSA_ALLOC_NO_OOM);
+		if (!DsaPointerIsValid(dp))
+			return false;
+	}
+
+	stup = dsa_get_address(scc_area, dp);
+	pg_atomic_init_u32(&stup->refcount, 2);
+	stup->t_len = src->t_len;
+	stup->t_self = src->t_self;
+	stup->t_tableOid = src->t_tableOid;
+	memcpy(SCC_TUPLE_DATA(stup), src->t_data, src->t_len);
+
+	scc_init_key(&key, dbid, cacheid, hashvalue);
+	entry = dshash_find_or_insert(scc_hash, &key, &found);
+
+	if (found && scc_entry_is_valid(entry))
+	{
+		SharedCatCTup *existing = dsa_get_address(scc_area, entry->tuple);
+
+		dsa_free(scc_area, dp);
+
+		/*
+		 * Someone else got there first.  Use their copy if it is the same
+		 * tuple version; otherwise this is a hash collision between different
+		 * keys, and we leave the existing entry alone.
+		 */
+		if (!ItemPointerEquals(&existing->t_self, &src->t_self) ||
+			existing->t_tableOid != src->t_tableOid)
+		{
+			dshash_release_lock(scc_hash, entry);
+			return false;
+		}
+
+		*ref = entry->tuple;
+		pg_atomic_fetch_add_u32(&existing->refcount, 1);
+		dshash_release_lock(scc_hash, entry);
+	}
+	else
+	{
+		dsa_pointer stale = found ? entry->tuple : InvalidDsaPointer;
+
+		/*
+		 * If the slot was invalidated while we were reading the tuple, it's
+		 * probably outdated already.  Don't bother publishing it.
+		 */
+		entry->loadseq = loadseq;
+		entry->tuple = dp;
+		if (!scc_entry_is_valid(entry))
+		{
+			dshash_delete_entry(scc_hash, entry);
+			dsa_free(scc_area, dp);
+			if (DsaPointerIsValid(stale))
+				scc_unref(stale);
+			return false;
+		}
+		dshash_release_lock(scc_hash, entry);
+
+		if (DsaPointerIsValid(stale))
+			scc_unref(stale);
+		*ref = dp;
+	}
+
+	scc_fill_tuple(*ref, tuple);
+	return true;
+}
+
+/*
+ * Give back a reference obtained from SharedCatCacheLookup or
+ * SharedCatCacheInsert.
+ */
+void
+SharedCatCacheRelease(dsa_pointer ref)
+{
+	Assert(scc_area != NULL);
+
+	scc_unref(ref);
+}
+
+/*
+ * Free up space by removing stale entries, and if evict_unused is true, also
+ * entries that no backend currently references.  Returns false if someone
+ * else is already doing this.
+ */
+static bool
+scc_reclaim(bool evict_unused)
+{
+	dshash_seq_status hstat;
+	SharedCatCacheEntry *entry;
+
+	if (!LWLockConditionalAcquire(&SharedCatCacheCtl->lock, LW_EXCLUSIVE))
+		return false;
+
+	dshash_seq_init(&hstat, scc_hash, true);
+	while ((entry = dshash_seq_next(&hstat)) != NULL)
+	{
+		dsa_pointer ref = entry->tuple;
+		SharedCatCTup *stup = dsa_get_address(scc_area, ref);
+
+		/*
+		 * With the partition locked exclusively, nobody can take a new
+		 * reference, so a count of one means the table's is the only one.
+		 */
+		if (!scc_entry_is_valid(entry) ||
+			(evict_unused && pg_atomic_read_u32(&stup->refcount) == 1))
+		{
+			dshash_delete_current(&hstat);
+			scc_unref(ref);
+		}
+	}
+	dshash_seq_term(&hstat);
+
+	LWLockRelease(&SharedCatCacheCtl->lock);
+
+	return true;
+}
+
+/*
+ * Process invalidation messages of a committed transaction.
+ *
+ * This must be called by the committing backend once its commit is visible
+ * to others, but before the messages are sent; see the file header comments.
+ */
+void
+SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	if (SharedCatCacheCtl == NULL)
+		return;
+
+	for (int i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+		uint64		seq;
+
+		if (msg->id >= 0)
+		{
+			uint32		slot = scc_slot(msg->cc.id, msg->cc.hashValue);
+
+			seq = pg_atomic_add_fetch_u64(&SharedCatCacheCtl->next_seq, 1);
+			pg_atomic_monotonic_advance_u64(&SharedCatCacheCtl->slot_seq[slot],
+											seq);
+		}
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+		{
+			/* tuples of the catalog may have moved; forget them all */
+			seq = pg_atomic_add_fetch_u64(&SharedCatCacheCtl->next_seq, 1);
+			pg_atomic_monotonic_advance_u64(&SharedCatCacheCtl->reset_seq,
+											seq);
+		}
+	}
+}
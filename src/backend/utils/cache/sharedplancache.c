@@ -0,0 +1,712 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Generic plans shared across backends.
+ *
+ * The plan cache in plancache.c is backend-local, so every backend that
+ * prepares the same statement has to plan it on its own.  When the
+ * shared_plan_cache setting is enabled, generic plans are additionally
+ * stored in a hash table in dynamic shared memory, from where other
+ * backends can pick them up instead of invoking the planner.  Parse analysis
+ * and rewriting still happen in each backend; only planning is saved.
+ *
+ * Plans are stored in nodeToString() form, just like parallel query ships
+ * plans to its workers, and are read back into local memory on a hit.  The
+ * hash key consists of the database, the current user, and a hash over the
+ * query text, search_path, the relations that parse analysis resolved the
+ * query's table names to, parameter types, cursor options, and the values
+ * of all settings that can affect parse analysis or planning.  The full key
+ * text is stored in the entry so that hash collisions are detected.
+ *
+ * Invalidation piggybacks on the same dependency information that
+ * plancache.c uses.  Instead of finding the entries that depend on an object
+ * whenever that object changes, we hash each dependency (a relation OID, or
+ * a PlanInvalItem's syscache ID and hash value) into one of a fixed number of
+ * slots in shared memory.  Each slot holds the sequence number of the last
+ * invalidation that mapped to it.  A transaction that commits invalidation
+ * messages advances the slots of the objects it touched, and an entry is
+ * only used if none of its dependency slots has advanced past the sequence
+ * number at which its planning began.  Messages that make plancache.c
+ * discard all plans advance a separate "reset" sequence instead.  Collisions
+ * only cause spurious replanning.
+ *
+ * Plans that use temporary tables, that are transient, or that come from
+ * queries with parser hooks (such as PL/pgSQL) are never shared.  Neither
+ * are plans of sessions that have a temporary schema, since "pg_temp" in
+ * search_path means something different in each session, and a temporary
+ * object could shadow the permanent one that another session planned for.
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "common/hashfn.h"
+#include "funcapi.h"
+#include "lib/dshash.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/dsa.h"
+#include "utils/guc.h"
+#include "utils/guc_tables.h"
+#include "utils/inval.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/sharedplancache.h"
+#include "utils/syscache.h"
+
+
+/* Number of invalidation slots that dependencies are hashed into */
+#define SPC_INVAL_SLOTS		1024
+
+typedef struct SharedPlanCacheCtlData
+{
+	LWLock		lock;			/* protects creation of the hash table */
+	dsa_handle	area_handle;
+	dshash_table_handle hash_handle;
+
+	pg_atomic_uint64 next_seq;	/* next invalidation sequence number */
+	pg_atomic_uint64 reset_seq; /* last invalidation of all plans */
+	pg_atomic_uint64 slot_seq[SPC_INVAL_SLOTS];
+
+	/* statistics */
+	pg_atomic_uint64 hits;
+	pg_atomic_uint64 misses;
+	pg_atomic_uint64 entries;
+} SharedPlanCacheCtlData;
+
+/*
+ * A shared plan.  The data chunk holds, in this order, the array of
+ * dependency slots, the key text, and the NUL-terminated plan text.
+ */
+typedef struct SharedPlanEntry
+{
+	SharedPlanKey key;			/* hash key; must be first */
+	uint64		planseq;		/* invalidation sequence when planning began */
+	dsa_pointer data;
+	int			ndeps;
+	Size		keylen;
+} SharedPlanEntry;
+
+static const dshash_parameters spc_hash_params = {
+	sizeof(SharedPlanKey),
+	sizeof(SharedPlanEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	dshash_memcpy,
+	LWTRANCHE_SHARED_PLAN_CACHE_HASH
+};
+
+/* Settings that can change the result of parse analysis */
+static const char *const spc_parse_settings[] = {
+	"DateStyle",
+	"IntervalStyle",
+	"TimeZone",
+	"row_security",
+	"standard_conforming_strings",
+	"transform_null_equals",
+};
+
+/* GUC parameters */
+bool		shared_plan_cache = false;
+int			shared_plan_cache_size = 65536;
+
+static SharedPlanCacheCtlData *SharedPlanCacheCtl = NULL;
+static dsa_area *spc_area = NULL;
+static dshash_table *spc_hash = NULL;
+
+static void spc_attach(void);
+static void spc_build_key(CachedPlanSource *plansource,
+						  SharedPlanCacheProbe *probe);
+static void spc_begin_planning(SharedPlanCacheProbe *probe);
+static bool spc_deps_are_valid(uint64 planseq, const uint32 *deps, int ndeps);
+static void spc_remove_entry(const SharedPlanKey *key, dsa_pointer data);
+static void spc_invalidate_slot(uint32 slot);
+static void spc_invalidate_all(void);
+
+static inline uint32
+spc_relation_slot(Oid relid)
+{
+	return hash_uint32(relid) % SPC_INVAL_SLOTS;
+}
+
+static inline uint32
+spc_object_slot(int cacheid, uint32 hashvalue)
+{
+	return hash_combine(hash_uint32((uint32) cacheid), hashvalue) %
+		SPC_INVAL_SLOTS;
+}
+
+
+/*
+ * Report shared memory space needed by SharedPlanCacheShmemInit
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	return sizeof(SharedPlanCacheCtlData);
+}
+
+/*
+ * Allocate and initialize the fixed-size part of the shared plan cache.
+ * The hash table itself is created on first use.
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	bool		found;
+
+	SharedPlanCacheCtl = (SharedPlanCacheCtlData *)
+		ShmemInitStruct("Shared Plan Cache", SharedPlanCacheShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		LWLockInitialize(&SharedPlanCacheCtl->lock,
+						 LWTRANCHE_SHARED_PLAN_CACHE);
+		SharedPlanCacheCtl->area_handle = DSA_HANDLE_INVALID;
+		SharedPlanCacheCtl->hash_handle = DSHASH_HANDLE_INVALID;
+		pg_atomic_init_u64(&SharedPlanCacheCtl->next_seq, 1);
+		pg_atomic_init_u64(&SharedPlanCacheCtl->reset_seq, 0);
+		for (int i = 0; i < SPC_INVAL_SLOTS; i++)
+			pg_atomic_init_u64(&SharedPlanCacheCtl->slot_seq[i], 0);
+		pg_atomic_init_u64(&SharedPlanCacheCtl->hits, 0);
+		pg_atomic_init_u64(&SharedPlanCacheCtl->misses, 0);
+		pg_atomic_init_u64(&SharedPlanCacheCtl->entries, 0);
+	}
+}
+
+/*
+ * Create or attach to the shared hash table, if not already done.
+ */
+static void
+spc_attach(void)
+{
+	MemoryContext oldcontext;
+
+	/* Quick exit if we already did this. */
+	if (spc_hash != NULL)
+		return;
+
+	/* Use a lock to ensure only one process creates the table. */
+	LWLockAcquire(&SharedPlanCacheCtl->lock, LW_EXCLUSIVE);
+
+	/* Be sure any local memory allocated by DSA routines is persistent. */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	if (SharedPlanCacheCtl->hash_handle == DSHASH_HANDLE_INVALID)
+	{
+		spc_area = dsa_create(LWTRANCHE_SHARED_PLAN_CACHE_DSA);
+		dsa_pin(spc_area);
+		dsa_pin_mapping(spc_area);
+		dsa_set_size_limit(spc_area, (size_t) shared_plan_cache_size * 1024);
+		spc_hash = dshash_create(spc_area, &spc_hash_params, NULL);
+
+		/* Store handles in shared memory for other backends to use. */
+		SharedPlanCacheCtl->area_handle = dsa_get_handle(spc_area);
+		SharedPlanCacheCtl->hash_handle = dshash_get_hash_table_handle(spc_hash);
+	}
+	else
+	{
+		spc_area = dsa_attach(SharedPlanCacheCtl->area_handle);
+		dsa_pin_mapping(spc_area);
+		spc_hash = dshash_attach(spc_area, &spc_hash_params,
+								 SharedPlanCacheCtl->hash_handle, NULL);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	LWLockRelease(&SharedPlanCacheCtl->lock);
+}
+
+/*
+ * Can the generic plan for this CachedPlanSource be shared?
+ */
+bool
+SharedPlanCacheEligible(CachedPlanSource *plansource,
+						QueryEnvironment *queryEnv)
+{
+	Oid			tempNamespaceId;
+	Oid			tempToastNamespaceId;
+
+	if (!shared_plan_cache || shared_plan_cache_size <= 0)
+		return false;
+
+	/* Nothing to gain for one-shot plans */
+	if (plansource->is_oneshot || plansource->raw_parse_tree == NULL)
+		return false;
+
+	/*
+	 * Parser hooks and query environments make the query's meaning depend on
+	 * state that isn't part of our hash key.
+	 */
+	if (plansource->parserSetup != NULL || queryEnv != NULL)
+		return false;
+
+	/*
+	 * Once we have a temporary schema, unqualified names may resolve to our
+	 * own temporary objects rather than the ones in the rest of search_path.
+	 */
+	GetTempNamespaceState(&tempNamespaceId, &tempToastNamespaceId);
+	if (OidIsValid(tempNamespaceId))
+		return false;
+
+	return true;
+}
+
+/*
+ * Compute the hash key of a plansource's generic plan.
+ */
+static void
+spc_build_key(CachedPlanSource *plansource, SharedPlanCacheProbe *probe)
+{
+	StringInfoData buf;
+	struct config_generic **gucs;
+	int			num_gucs;
+	int			nrels;
+	ListCell   *lc;
+
+	initStringInfo(&buf);
+
+	/* NUL bytes separate the variable-length parts */
+	appendBinaryStringInfo(&buf, plansource->query_string,
+						   strlen(plansource->query_string) + 1);
+	appendBinaryStringInfo(&buf, namespace_search_path,
+						   strlen(namespace_search_path) + 1);
+	appendBinaryStringInfo(&buf, (char *) &plansource->cursor_options,
+						   sizeof(int));
+	appendBinaryStringInfo(&buf, (char *) &plansource->num_params,
+						   sizeof(int));
+	if (plansource->num_params > 0)
+		appendBinaryStringInfo(&buf, (char *) plansource->param_types,
+							   plansource->num_params * sizeof(Oid));
+
+	/* What the query's table names were resolved to by this backend */
+	nrels = list_length(plansource->relationOids);
+	appendBinaryStringInfo(&buf, (char *) &nrels, sizeof(int));
+	foreach(lc, plansource->relationOids)
+	{
+		Oid			relid = lfirst_oid(lc);
+
+		appendBinaryStringInfo(&buf, (char *) &relid, sizeof(Oid));
+	}
+
+	for (int i = 0; i < lengthof(spc_parse_settings); i++)
+	{
+		const char *value = GetConfigOption(spc_parse_settings[i],
+											false, false);
+
+		appendStringInfo(&buf, "%s=%s", spc_parse_settings[i], value);
+		appendStringInfoChar(&buf, '\0');
+	}
+
+	/* Non-default settings that affect planning, as EXPLAIN (SETTINGS) */
+	gucs = get_explain_guc_options(&num_gucs);
+	for (int i = 0; i < num_gucs; i++)
+	{
+		char	   *value = ShowGUCOption(gucs[i], false);
+
+		appendStringInfo(&buf, "%s=%s", gucs[i]->name, value);
+		appendStringInfoChar(&buf, '\0');
+		pfree(value);
+	}
+	pfree(gucs);
+
+	memset(&probe->key, 0, sizeof(SharedPlanKey));
+	probe->key.dbid = MyDatabaseId;
+	probe->key.userid = GetUserId();
+	probe->key.query_hash = hash_bytes_extended((unsigned char *) buf.data,
+												buf.len, 0);
+	probe->keytext = buf.data;
+	probe->keylen = buf.len;
+	probe->planseq = 0;
+	probe->deps = NULL;
+	probe->ndeps = 0;
+}
+
+/*
+ * Check that none of the given dependency slots has been invalidated since
+ * planning began at planseq.
+ */
+static bool
+spc_deps_are_valid(uint64 planseq, const uint32 *deps, int ndeps)
+{
+	if (pg_atomic_read_u64(&SharedPlanCacheCtl->reset_seq) > planseq)
+		return false;
+
+	for (int i = 0; i < ndeps; i++)
+	{
+		if (pg_atomic_read_u64(&SharedPlanCacheCtl->slot_seq[deps[i]]) > planseq)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Remove an entry that was found to be stale, unless someone else replaced
+ * it in the meantime.
+ */
+static void
+spc_remove_entry(const SharedPlanKey *key, dsa_pointer data)
+{
+	SharedPlanEntry *entry;
+
+	entry = dshash_find(spc_hash, key, true);
+	if (entry == NULL)
+		return;
+
+	if (entry->data == data)
+	{
+		dsa_free(spc_area, entry->data);
+		dshash_delete_entry(spc_hash, entry);
+		pg_atomic_fetch_sub_u64(&SharedPlanCacheCtl->entries, 1);
+	}
+	else
+		dshash_release_lock(spc_hash, entry);
+}
+
+/*
+ * Prepare for planning after a lookup didn't produce a usable plan.
+ *
+ * We remember the invalidation sequence number before planning starts, and
+ * then catch up with any pending invalidation messages.  Whoever advances a
+ * slot does so only after sending its messages, so a plan made with catalog
+ * contents older than an invalidation can't end up with a later planseq.
+ */
+static void
+spc_begin_planning(SharedPlanCacheProbe *probe)
+{
+	probe->planseq = pg_atomic_read_u64(&SharedPlanCacheCtl->next_seq);
+	AcceptInvalidationMessages();
+}
+
+/*
+ * Look for a shared generic plan for plansource.
+ *
+ * Returns the list of PlannedStmts, read into the current memory context, or
+ * NIL if there is no usable plan.  The caller must lock the relations that
+ * the plan uses and then call SharedPlanCacheRecheck before relying on it.
+ * Either way, probe is filled in for use by SharedPlanCacheStore.
+ */
+List *
+SharedPlanCacheLookup(CachedPlanSource *plansource,
+					  SharedPlanCacheProbe *probe)
+{
+	SharedPlanEntry *entry;
+	char	   *plantext = NULL;
+	dsa_pointer stale_data = InvalidDsaPointer;
+	List	   *stmt_list;
+
+	spc_build_key(plansource, probe);
+	spc_attach();
+
+	entry = dshash_find(spc_hash, &probe->key, false);
+	if (entry != NULL)
+	{
+		char	   *data = dsa_get_address(spc_area, entry->data);
+		uint32	   *deps = (uint32 *) data;
+		char	   *keytext = data + entry->ndeps * sizeof(uint32);
+
+		if (entry->keylen == probe->keylen &&
+			memcmp(keytext, probe->keytext, probe->keylen) == 0)
+		{
+			if (spc_deps_are_valid(entry->planseq, deps, entry->ndeps))
+			{
+				plantext = pstrdup(keytext + entry->keylen);
+				probe->planseq = entry->planseq;
+				probe->ndeps = entry->ndeps;
+				probe->deps = palloc(entry->ndeps * sizeof(uint32));
+				memcpy(probe->deps, deps, entry->ndeps * sizeof(uint32));
+			}
+			else
+				stale_data = entry->data;
+		}
+		dshash_release_lock(spc_hash, entry);
+	}
+
+	if (DsaPointerIsValid(stale_data))
+		spc_remove_entry(&probe->key, stale_data);
+
+	if (plantext == NULL)
+	{
+		pg_atomic_fetch_add_u64(&SharedPlanCacheCtl->misses, 1);
+		spc_begin_planning(probe);
+		return NIL;
+	}
+
+	stmt_list = (List *) stringToNode(plantext);
+	pfree(plantext);
+
+	return stmt_list;
+}
+
+/*
+ * Recheck a plan returned by SharedPlanCacheLookup, after the caller has
+ * locked the relations it uses.
+ *
+ * Acquiring the locks may have waited for concurrent DDL, which would then
+ * have advanced some of the plan's slots.  Returns false if the plan must
+ * not be used; probe is then ready for the caller to plan afresh.
+ */
+bool
+SharedPlanCacheRecheck(SharedPlanCacheProbe *probe)
+{
+	if (spc_deps_are_valid(probe->planseq, probe->deps, probe->ndeps))
+	{
+		pg_atomic_fetch_add_u64(&SharedPlanCacheCtl->hits, 1);
+		return true;
+	}
+
+	pg_atomic_fetch_add_u64(&SharedPlanCacheCtl->misses, 1);
+	spc_begin_planning(probe);
+	return false;
+}
+
+/*
+ * Store a freshly built generic plan in the shared cache.
+ *
+ * probe must have been set up by SharedPlanCacheLookup before planning.
+ * Plans that can't be shared are silently skipped, as are plans that don't
+ * fit in the remaining space.
+ */
+void
+SharedPlanCacheStore(SharedPlanCacheProbe *probe,
+					 CachedPlanSource *plansource,
+					 List *stmt_list)
+{
+	List	   *relationOids;
+	List	   *invalItems;
+	uint32	   *deps;
+	int			ndeps;
+	char	   *plantext;
+	Size		plantextlen;
+	Size		datalen;
+	dsa_pointer dp;
+	char	   *data;
+	SharedPlanEntry *entry;
+	bool		found;
+	ListCell   *lc;
+
+	/* Gather the dependencies of the queries and the plans */
+	relationOids = list_copy(plansource->relationOids);
+	invalItems = list_copy(plansource->invalItems);
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		if (plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->transientPlan)
+			return;
+
+		relationOids = list_concat(relationOids, plannedstmt->relationOids);
+		invalItems = list_concat(invalItems, plannedstmt->invalItems);
+	}
+
+	ndeps = 0;
+	deps = palloc((list_length(relationOids) + list_length(invalItems) + 1) *
+				  sizeof(uint32));
+	foreach(lc, relationOids)
+	{
+		Oid			relid = lfirst_oid(lc);
+
+		/* Other backends can't see our temporary tables */
+		if (get_rel_persistence(relid) == RELPERSISTENCE_TEMP)
+			return;
+
+		deps[ndeps++] = spc_relation_slot(relid);
+	}
+	foreach(lc, invalItems)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+
+		deps[ndeps++] = spc_object_slot(item->cacheId, item->hashValue);
+	}
+
+	plantext = nodeToString(stmt_list);
+	plantextlen = strlen(plantext) + 1;
+	datalen = ndeps * sizeof(uint32) + probe->keylen + plantextlen;
+
+	spc_attach();
+
+	dp = dsa_allocate_extended(spc_area, datalen, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+		return;					/* cache is full */
+
+	data = dsa_get_address(spc_area, dp);
+	memcpy(data, deps, ndeps * sizeof(uint32));
+	memcpy(data + ndeps * sizeof(uint32), probe->keytext, probe->keylen);
+	memcpy(data + ndeps * sizeof(uint32) + probe->keylen, plantext,
+		   plantextlen);
+
+	entry = dshash_find_or_insert(spc_hash, &probe->key, &found);
+	if (found)
+	{
+		char	   *olddata = dsa_get_address(spc_area, entry->data);
+
+		/* Keep a valid plan that another backend stored concurrently */
+		if (entry->keylen == probe->keylen &&
+			memcmp(olddata + entry->ndeps * sizeof(uint32), probe->keytext,
+				   probe->keylen) == 0 &&
+			spc_deps_are_valid(entry->planseq, (uint32 *) olddata,
+							   entry->ndeps))
+		{
+			dshash_release_lock(spc_hash, entry);
+			dsa_free(spc_area, dp);
+			return;
+		}
+
+		dsa_free(spc_area, entry->data);
+	}
+	else
+		pg_atomic_fetch_add_u64(&SharedPlanCacheCtl->entries, 1);
+
+	entry->planseq = probe->planseq;
+	entry->data = dp;
+	entry->ndeps = ndeps;
+	entry->keylen = probe->keylen;
+	dshash_release_lock(spc_hash, entry);
+}
+
+/*
+ * Advance the sequence number of one invalidation slot.
+ */
+static void
+spc_invalidate_slot(uint32 slot)
+{
+	uint64		seq;
+
+	seq = pg_atomic_add_fetch_u64(&SharedPlanCacheCtl->next_seq, 1);
+	pg_atomic_monotonic_advance_u64(&SharedPlanCacheCtl->slot_seq[slot], seq);
+}
+
+/*
+ * Invalidate all shared plans.
+ */
+static void
+spc_invalidate_all(void)
+{
+	uint64		seq;
+
+	seq = pg_atomic_add_fetch_u64(&SharedPlanCacheCtl->next_seq, 1);
+	pg_atomic_monotonic_advance_u64(&SharedPlanCacheCtl->reset_seq, seq);
+}
+
+/*
+ * Process invalidation messages of a committed transaction.
+ *
+ * This is called once for each committed transaction's messages, after they
+ * have been sent to other backends, rather than by every backend that
+ * receives them.  The mapping from messages to invalidated plans mirrors
+ * the callbacks that plancache.c registers.
+ */
+void
+SharedPlanCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	if (SharedPlanCacheCtl == NULL)
+		return;
+
+	for (int i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+		{
+			switch (msg->cc.id)
+			{
+				case PROCOID:
+				case TYPEOID:
+					spc_invalidate_slot(spc_object_slot(msg->cc.id,
+														msg->cc.hashValue));
+					break;
+				case NAMESPACEOID:
+				case OPEROID:
+				case AMOPOPID:
+				case FOREIGNSERVEROID:
+				case FOREIGNDATAWRAPPEROID:
+					spc_invalidate_all();
+					break;
+				default:
+					break;
+			}
+		}
+		else if (msg->id == SHAREDINVALRELCACHE_ID)
+		{
+			if (OidIsValid(msg->rc.relId))
+				spc_invalidate_slot(spc_relation_slot(msg->rc.relId));
+			else
+				spc_invalidate_all();
+		}
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+			spc_invalidate_all();
+	}
+}
+
+/*
+ * SQL-callable function returning shared plan cache statistics
+ */
+Datum
+pg_stat_get_shared_plan_cache(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_SHARED_PLAN_CACHE_COLS	4
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_SHARED_PLAN_CACHE_COLS] = {0};
+	bool		nulls[PG_STAT_GET_SHARED_PLAN_CACHE_COLS] = {0};
+	int64		memory = 0;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	if (SharedPlanCacheCtl->hash_handle != DSHASH_HANDLE_INVALID)
+	{
+		spc_attach();
+		memory = (int64) dsa_get_total_size(spc_area);
+	}
+
+	values[0] = Int64GetDatum(pg_atomic_read_u64(&SharedPlanCacheCtl->hits));
+	values[1] = Int64GetDatum(pg_atomic_read_u64(&SharedPlanCacheCtl->misses));
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&SharedPlanCacheCtl->entries));
+	values[3] = Int64GetDatum(memory);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * SQL-callable function to discard all shared plans and reset statistics
+ */
+Datum
+pg_stat_reset_shared_plan_cache(PG_FUNCTION_ARGS)
+{
+	pg_atomic_write_u64(&SharedPlanCacheCtl->hits, 0);
+	pg_atomic_write_u64(&SharedPlanCacheCtl->misses, 0);
+
+	if (SharedPlanCacheCtl->hash_handle != DSHASH_HANDLE_INVALID)
+	{
+		dshash_seq_status hstat;
+		SharedPlanEntry *entry;
+
+		spc_attach();
+
+		dshash_seq_init(&hstat, spc_hash, true);
+		while ((entry = dshash_seq_next(&hstat)) != NULL)
+		{
+			dsa_free(spc_area, entry->data);
+			dshash_delete_current(&hstat);
+			pg_atomic_fetch_sub_u64(&SharedPlanCacheCtl->entries, 1);
+		}
+		dshash_seq_term(&hstat);
+	}
+
+	PG_RETURN_VOID();
+}
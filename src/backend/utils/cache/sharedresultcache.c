@@ -0,0 +1,1157 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedresultcache.c
+ *	  Query results shared across backends.
+ *
+ * Dashboards and similar applications tend to run the same read-only
+ * queries over and over, against tables that change far less often.  When
+ * the shared_result_cache setting is enabled, the complete result of a
+ * SELECT sent to the client is stored in a hash table in dynamic shared
+ * memory, and a later execution of the same statement with the same
+ * parameter values by the same role sends the stored tuples to the client
+ * instead of running the plan.
+ *
+ * The hash key consists of the database, the current user, the query
+ * identifier (if one was computed), and a hash over the statement text,
+ * search_path, the settings that can affect parse analysis, and the
+ * serialized parameter values.  The full key text is stored in the entry so
+ * that hash collisions are detected.  Only statements that the planner
+ * found free of mutable functions, row locks and data-modifying WITH
+ * queries, and that read nothing but plain, partitioned and materialized
+ * tables, are considered; see SharedResultCacheQueryIsCacheable.  Results
+ * are never used in serializable transactions, which need the predicate
+ * locks taken by running the plan.
+ *
+ * Invalidation works like in sharedplancache.c: the relations and other
+ * objects a result depends on are hashed into a fixed number of slots, each
+ * holding the sequence number of the last invalidation that mapped to it,
+ * and a result is only used if none of its slots has advanced past the
+ * sequence number read when its execution began.  Committed invalidation
+ * messages advance the slots of schema changes, TRUNCATE and the like.
+ *
+ * Ordinary writes send no invalidation messages, so the executor reports
+ * every relation it opens for writing to SharedResultCacheNoteWrite, which
+ * advances the relation's slot and also records the writer's top-level
+ * transaction ID there.  A result may only be stored or used if all the
+ * transactions recorded in its slots are visible to the query's snapshot.
+ * That takes care of writers that were still running when the snapshot was
+ * taken, even if they committed before the sequence number was read.
+ * Recorded transactions are forgotten once they are visible to every
+ * snapshot, which happens lazily when a slot runs out of room.
+ *
+ * When the memory limit is reached, the least recently used entries are
+ * evicted to make room.
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedresultcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/parallel.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "catalog/catalog.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_class.h"
+#include "common/hashfn.h"
+#include "common/int.h"
+#include "executor/tuptable.h"
+#include "funcapi.h"
+#include "lib/dshash.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/params.h"
+#include "optimizer/optimizer.h"
+#include "storage/lwlock.h"
+#include "storage/procarray.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/dsa.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/sharedresultcache.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
+
+
+/* Number of invalidation slots that dependencies are hashed into */
+#define SRC_INVAL_SLOTS		1024
+
+/* Number of writing transactions remembered per slot */
+#define SRC_WRITERS_PER_SLOT	4
+
+/*
+ * Transactions that have written to the relations mapping to a slot.  When
+ * there's no room for another one, overflow_xid holds the newest of those
+ * that could not be recorded, and stands in for all of them.
+ */
+typedef struct SharedResultWriters
+{
+	TransactionId xids[SRC_WRITERS_PER_SLOT];
+	int			nxids;
+	TransactionId overflow_xid;
+} SharedResultWriters;
+
+typedef struct SharedResultCacheCtlData
+{
+	LWLock		lock;			/* protects creation of the hash table, and
+								 * serializes eviction */
+	LWLock		writer_lock;	/* protects writers[] */
+	dsa_handle	area_handle;
+	dshash_table_handle hash_handle;
+
+	pg_atomic_uint64 next_seq;	/* next invalidation sequence number */
+	pg_atomic_uint64 reset_seq; /* last invalidation of all results */
+	pg_atomic_uint64 slot_seq[SRC_INVAL_SLOTS];
+	SharedResultWriters writers[SRC_INVAL_SLOTS];
+
+	pg_atomic_uint64 use_clock; /* source of entries' last_used stamps */
+
+	/* statistics */
+	pg_atomic_uint64 hits;
+	pg_atomic_uint64 misses;
+	pg_atomic_uint64 stores;
+	pg_atomic_uint64 invalidations;
+	pg_atomic_uint64 evictions;
+	pg_atomic_uint64 entries;
+} SharedResultCacheCtlData;
+
+/*
+ * A shared result.  The data chunk holds, in this order, the array of
+ * dependency slots, the key text, and (at a MAXALIGN'd offset) the result
+ * tuples as consecutive MAXALIGN'd MinimalTuples.
+ */
+typedef struct SharedResultEntry
+{
+	SharedResultKey key;		/* hash key; must be first */
+	uint64		seq;			/* invalidation sequence when execution began */
+	pg_atomic_uint64 last_used; /* use_clock when last stored or used */
+	dsa_pointer data;
+	Size		datalen;
+	int			ndeps;
+	Size		keylen;
+	int			natts;
+	uint64		ntuples;
+} SharedResultEntry;
+
+static const dshash_parameters src_hash_params = {
+	sizeof(SharedResultKey),
+	sizeof(SharedResultEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	dshash_memcpy,
+	LWTRANCHE_SHARED_RESULT_CACHE_HASH
+};
+
+/* Settings that can change the result of parse analysis */
+static const char *const src_parse_settings[] = {
+	"DateStyle",
+	"IntervalStyle",
+	"TimeZone",
+	"row_security",
+	"standard_conforming_strings",
+	"transform_null_equals",
+};
+
+/*
+ * DestReceiver that copies the tuples it is given into a probe, and passes
+ * them on to the real destination.
+ */
+typedef struct SharedResultCaptureReceiver
+{
+	DestReceiver pub;
+	DestReceiver *dest;
+	SharedResultCacheProbe *probe;
+} SharedResultCaptureReceiver;
+
+/* GUC parameters */
+bool		shared_result_cache = false;
+int			shared_result_cache_size = 0;
+int			shared_result_cache_max_entry_size = 1024;
+
+static SharedResultCacheCtlData *SharedResultCacheCtl = NULL;
+static dsa_area *src_area = NULL;
+static dshash_table *src_hash = NULL;
+
+/*
+ * Slots that this backend has already recorded its current transaction as a
+ * writer in.
+ */
+static TransactionId src_noted_xid = InvalidTransactionId;
+static uint32 src_noted_slots[8];
+static int	src_num_noted = 0;
+
+static void src_attach(void);
+static bool src_query_uncacheable_walker(Node *node, void *context);
+static void src_build_key(QueryDesc *queryDesc, SharedResultCacheProbe *probe);
+static void src_collect_deps(PlannedStmt *plannedstmt,
+							 SharedResultCacheProbe *probe);
+static bool src_deps_are_valid(uint64 seq, const uint32 *deps, int ndeps);
+static bool src_writers_are_visible(const uint32 *deps, int ndeps,
+									Snapshot snapshot);
+static void src_prune_writers(SharedResultWriters *writers);
+static void src_remove_entry(const SharedResultKey *key, dsa_pointer data);
+static void src_evict(Size needed);
+static void src_invalidate_slot(uint32 slot);
+static void src_invalidate_all(void);
+static void src_capture_startup(DestReceiver *self, int operation,
+								TupleDesc typeinfo);
+static bool src_capture_receive(TupleTableSlot *slot, DestReceiver *self);
+static void src_capture_shutdown(DestReceiver *self);
+static void src_capture_destroy(DestReceiver *self);
+
+static inline uint32
+src_relation_slot(Oid relid)
+{
+	return hash_uint32(relid) % SRC_INVAL_SLOTS;
+}
+
+static inline uint32
+src_object_slot(int cacheid, uint32 hashvalue)
+{
+	return hash_combine(hash_uint32((uint32) cacheid), hashvalue) %
+		SRC_INVAL_SLOTS;
+}
+
+static inline char *
+src_entry_tuples(char *data, int ndeps, Size keylen)
+{
+	return data + MAXALIGN(ndeps * sizeof(uint32) + keylen);
+}
+
+
+/*
+ * Report shared memory space needed by SharedResultCacheShmemInit
+ */
+Size
+SharedResultCacheShmemSize(void)
+{
+	return sizeof(SharedResultCacheCtlData);
+}
+
+/*
+ * Allocate and initialize the fixed-size part of the shared result cache.
+ * The hash table itself is created on first use.
+ */
+void
+SharedResultCacheShmemInit(void)
+{
+	bool		found;
+
+	SharedResultCacheCtl = (SharedResultCacheCtlData *)
+		ShmemInitStruct("Shared Result Cache", SharedResultCacheShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		LWLockInitialize(&SharedResultCacheCtl->lock,
+						 LWTRANCHE_SHARED_RESULT_CACHE);
+		LWLockInitialize(&SharedResultCacheCtl->writer_lock,
+						 LWTRANCHE_SHARED_RESULT_CACHE_WRITERS);
+		SharedResultCacheCtl->area_handle = DSA_HANDLE_INVALID;
+		SharedResultCacheCtl->hash_handle = DSHASH_HANDLE_INVALID;
+		pg_atomic_init_u64(&SharedResultCacheCtl->next_seq, 1);
+		pg_atomic_init_u64(&SharedResultCacheCtl->reset_seq, 0);
+		for (int i = 0; i < SRC_INVAL_SLOTS; i++)
+		{
+			pg_atomic_init_u64(&SharedResultCacheCtl->slot_seq[i], 0);
+			SharedResultCacheCtl->writers[i].nxids = 0;
+			SharedResultCacheCtl->writers[i].overflow_xid =
+				InvalidTransactionId;
+		}
+		pg_atomic_init_u64(&SharedResultCacheCtl->use_clock, 0);
+		pg_atomic_init_u64(&SharedResultCacheCtl->hits, 0);
+		pg_atomic_init_u64(&SharedResultCacheCtl->misses, 0);
+		pg_atomic_init_u64(&SharedResultCacheCtl->stores, 0);
+		pg_atomic_init_u64(&SharedResultCacheCtl->invalidations, 0);
+		pg_atomic_init_u64(&SharedResultCacheCtl->evictions, 0);
+		pg_atomic_init_u64(&SharedResultCacheCtl->entries, 0);
+	}
+}
+
+/*
+ * Create or attach to the shared hash table, if not already done.
+ */
+static void
+src_attach(void)
+{
+	MemoryContext oldcontext;
+
+	/* Quick exit if we already did this. */
+	if (src_hash != NULL)
+		return;
+
+	/* Use a lock to ensure only one process creates the table. */
+	LWLockAcquire(&SharedResultCacheCtl->lock, LW_EXCLUSIVE);
+
+	/* Be sure any local memory allocated by DSA routines is persistent. */
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	if (SharedResultCacheCtl->hash_handle == DSHASH_HANDLE_INVALID)
+	{
+		src_area = dsa_create(LWTRANCHE_SHARED_RESULT_CACHE_DSA);
+		dsa_pin(src_area);
+		dsa_pin_mapping(src_area);
+		dsa_set_size_limit(src_area, (size_t) shared_result_cache_size * 1024);
+		src_hash = dshash_create(src_area, &src_hash_params, NULL);
+
+		/* Store handles in shared memory for other backends to use. */
+		SharedResultCacheCtl->area_handle = dsa_get_handle(src_area);
+		SharedResultCacheCtl->hash_handle =
+			dshash_get_hash_table_handle(src_hash);
+	}
+	else
+	{
+		src_area = dsa_attach(SharedResultCacheCtl->area_handle);
+		dsa_pin_mapping(src_area);
+		src_hash = dshash_attach(src_area, &src_hash_params,
+								 SharedResultCacheCtl->hash_handle, NULL);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	LWLockRelease(&SharedResultCacheCtl->lock);
+}
+
+/*
+ * Could the result of this query be shared?
+ *
+ * This is called by the planner on the rewritten query, before planning
+ * scribbles on it.  The result must not depend on anything but the contents
+ * of tables whose changes we can track: no mutable functions, no row locks
+ * or data-modifying statements, and only plain, partitioned or materialized
+ * tables that are neither temporary nor system catalogs.
+ */
+bool
+SharedResultCacheQueryIsCacheable(Query *parse)
+{
+	if (!shared_result_cache || shared_result_cache_size <= 0)
+		return false;
+
+	if (parse->commandType != CMD_SELECT || parse->utilityStmt != NULL)
+		return false;
+
+	if (src_query_uncacheable_walker((Node *) parse, NULL))
+		return false;
+
+	return !contain_mutable_functions((Node *) parse);
+}
+
+static bool
+src_query_uncacheable_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, Query))
+	{
+		Query	   *query = (Query *) node;
+		ListCell   *lc;
+
+		if (query->commandType != CMD_SELECT || query->hasModifyingCTE ||
+			query->rowMarks != NIL)
+			return true;
+
+		foreach(lc, query->rtable)
+		{
+			RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+			if (rte->rtekind == RTE_NAMEDTUPLESTORE)
+				return true;
+			if (rte->rtekind != RTE_RELATION)
+				continue;
+
+			if (rte->tablesample != NULL)
+				return true;
+			if (rte->relkind != RELKIND_RELATION &&
+				rte->relkind != RELKIND_PARTITIONED_TABLE &&
+				rte->relkind != RELKIND_MATVIEW)
+				return true;
+			if (IsCatalogRelationOid(rte->relid) ||
+				get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP)
+				return true;
+		}
+
+		return query_tree_walker(query, src_query_uncacheable_walker,
+								 context, 0);
+	}
+
+	return expression_tree_walker(node, src_query_uncacheable_walker,
+								  context);
+}
+
+/*
+ * Compute the hash key of a query's result.
+ */
+static void
+src_build_key(QueryDesc *queryDesc, SharedResultCacheProbe *probe)
+{
+	PlannedStmt *plannedstmt = queryDesc->plannedstmt;
+	const char *query_text = queryDesc->sourceText;
+	int			query_len;
+	StringInfoData buf;
+
+	/* Only the statement's own part of a multi-statement string counts */
+	if (plannedstmt->stmt_location >= 0)
+	{
+		query_text += plannedstmt->stmt_location;
+		query_len = plannedstmt->stmt_len;
+		if (query_len <= 0)
+			query_len = strlen(query_text);
+	}
+	else
+		query_len = strlen(query_text);
+
+	initStringInfo(&buf);
+
+	/* NUL bytes separate the variable-length parts */
+	appendBinaryStringInfo(&buf, query_text, query_len);
+	appendStringInfoChar(&buf, '\0');
+	appendBinaryStringInfo(&buf, namespace_search_path,
+						   strlen(namespace_search_path) + 1);
+
+	for (int i = 0; i < lengthof(src_parse_settings); i++)
+	{
+		const char *value = GetConfigOption(src_parse_settings[i],
+											false, false);
+
+		appendStringInfo(&buf, "%s=%s", src_parse_settings[i], value);
+		appendStringInfoChar(&buf, '\0');
+	}
+
+	/* The parameter values, in the form used to pass them to workers */
+	if (queryDesc->params != NULL && queryDesc->params->numParams > 0)
+	{
+		Size		size = EstimateParamListSpace(queryDesc->params);
+		char	   *start;
+
+		enlargeStringInfo(&buf, size);
+		start = buf.data + buf.len;
+		SerializeParamList(queryDesc->params, &start);
+		buf.len += size;
+		buf.data[buf.len] = '\0';
+	}
+
+	memset(&probe->key, 0, sizeof(SharedResultKey));
+	probe->key.dbid = MyDatabaseId;
+	probe->key.userid = GetUserId();
+	probe->key.query_id = plannedstmt->queryId;
+	probe->key.query_hash = hash_bytes_extended((unsigned char *) buf.data,
+												buf.len, 0);
+	probe->keytext = buf.data;
+	probe->keylen = buf.len;
+}
+
+/*
+ * Compute the invalidation slots that a query's result depends on.
+ */
+static void
+src_collect_deps(PlannedStmt *plannedstmt, SharedResultCacheProbe *probe)
+{
+	ListCell   *lc;
+
+	probe->ndeps = 0;
+	probe->deps = palloc((list_length(plannedstmt->relationOids) +
+						  list_length(plannedstmt->invalItems) + 1) *
+						 sizeof(uint32));
+
+	foreach(lc, plannedstmt->relationOids)
+		probe->deps[probe->ndeps++] = src_relation_slot(lfirst_oid(lc));
+	foreach(lc, plannedstmt->invalItems)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+
+		probe->deps[probe->ndeps++] = src_object_slot(item->cacheId,
+													  item->hashValue);
+	}
+}
+
+/*
+ * Check that none of the given dependency slots has been invalidated since
+ * execution began at seq.
+ */
+static bool
+src_deps_are_valid(uint64 seq, const uint32 *deps, int ndeps)
+{
+	if (pg_atomic_read_u64(&SharedResultCacheCtl->reset_seq) > seq)
+		return false;
+
+	for (int i = 0; i < ndeps; i++)
+	{
+		if (pg_atomic_read_u64(&SharedResultCacheCtl->slot_seq[deps[i]]) > seq)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Check that every transaction recorded as a writer in the given slots is
+ * visible to snapshot, so that the snapshot sees the current contents of
+ * the relations involved.
+ */
+static bool
+src_writers_are_visible(const uint32 *deps, int ndeps, Snapshot snapshot)
+{
+	bool		result = true;
+
+	LWLockAcquire(&SharedResultCacheCtl->writer_lock, LW_SHARED);
+	for (int i = 0; i < ndeps && result; i++)
+	{
+		SharedResultWriters *writers = &SharedResultCacheCtl->writers[deps[i]];
+
+		for (int j = 0; j < writers->nxids; j++)
+		{
+			if (XidInMVCCSnapshot(writers->xids[j], snapshot))
+			{
+				result = false;
+				break;
+			}
+		}
+
+		/* All forgotten writers precede overflow_xid */
+		if (TransactionIdIsValid(writers->overflow_xid) &&
+			!TransactionIdPrecedes(writers->overflow_xid, snapshot->xmin))
+			result = false;
+	}
+	LWLockRelease(&SharedResultCacheCtl->writer_lock);
+
+	return result;
+}
+
+/*
+ * Forget the writers that are visible to every snapshot, present or future.
+ * Caller must hold writer_lock exclusively.
+ */
+static void
+src_prune_writers(SharedResultWriters *writers)
+{
+	TransactionId horizon = GetOldestNonRemovableTransactionId(NULL);
+	int			n = 0;
+
+	for (int i = 0; i < writers->nxids; i++)
+	{
+		if (!TransactionIdPrecedes(writers->xids[i], horizon))
+			writers->xids[n++] = writers->xids[i];
+	}
+	writers->nxids = n;
+
+	if (TransactionIdIsValid(writers->overflow_xid) &&
+		TransactionIdPrecedes(writers->overflow_xid, horizon))
+		writers->overflow_xid = InvalidTransactionId;
+}
+
+/*
+ * Remove an entry that was found to be stale, unless someone else replaced
+ * it in the meantime.
+ */
+static void
+src_remove_entry(const SharedResultKey *key, dsa_pointer data)
+{
+	SharedResultEntry *entry;
+
+	entry = dshash_find(src_hash, key, true);
+	if (entry == NULL)
+		return;
+
+	if (entry->data == data)
+	{
+		dsa_free(src_area, entry->data);
+		dshash_delete_entry(src_hash, entry);
+		pg_atomic_fetch_sub_u64(&SharedResultCacheCtl->entries, 1);
+		pg_atomic_fetch_add_u64(&SharedResultCacheCtl->invalidations, 1);
+	}
+	else
+		dshash_release_lock(src_hash, entry);
+}
+
+typedef struct SharedResultUse
+{
+	uint64		last_used;
+	Size		datalen;
+} SharedResultUse;
+
+static int
+src_use_cmp(const void *a, const void *b)
+{
+	const SharedResultUse *ua = (const SharedResultUse *) a;
+	const SharedResultUse *ub = (const SharedResultUse *) b;
+
+	return pg_cmp_u64(ua->last_used, ub->last_used);
+}
+
+/*
+ * Evict the least recently used entries, until at least needed bytes are
+ * freed.  To avoid doing this for every new entry once the cache is full,
+ * we free an extra sixteenth of the cache's size.
+ */
+static void
+src_evict(Size needed)
+{
+	dshash_seq_status hstat;
+	SharedResultEntry *entry;
+	SharedResultUse *uses;
+	int			nuses = 0;
+	int			maxuses = 64;
+	Size		freed = 0;
+	uint64		cutoff = 0;
+
+	needed += (Size) shared_result_cache_size * 1024 / 16;
+
+	LWLockAcquire(&SharedResultCacheCtl->lock, LW_EXCLUSIVE);
+
+	/* Find how recently each entry was used */
+	uses = palloc(maxuses * sizeof(SharedResultUse));
+	dshash_seq_init(&hstat, src_hash, false);
+	while ((entry = dshash_seq_next(&hstat)) != NULL)
+	{
+		if (nuses >= maxuses)
+		{
+			maxuses *= 2;
+			uses = repalloc(uses, maxuses * sizeof(SharedResultUse));
+		}
+		uses[nuses].last_used = pg_atomic_read_u64(&entry->last_used);
+		uses[nuses].datalen = entry->datalen;
+		nuses++;
+	}
+	dshash_seq_term(&hstat);
+
+	qsort(uses, nuses, sizeof(SharedResultUse), src_use_cmp);
+	for (int i = 0; i < nuses && freed < needed; i++)
+	{
+		cutoff = uses[i].last_used;
+		freed += uses[i].datalen;
+	}
+	pfree(uses);
+
+	/* Remove everything not used since the cutoff */
+	if (nuses > 0)
+	{
+		dshash_seq_init(&hstat, src_hash, true);
+		while ((entry = dshash_seq_next(&hstat)) != NULL)
+		{
+			if (pg_atomic_read_u64(&entry->last_used) > cutoff)
+				continue;
+
+			dsa_free(src_area, entry->data);
+			dshash_delete_current(&hstat);
+			pg_atomic_fetch_sub_u64(&SharedResultCacheCtl->entries, 1);
+			pg_atomic_fetch_add_u64(&SharedResultCacheCtl->evictions, 1);
+		}
+		dshash_seq_term(&hstat);
+	}
+
+	LWLockRelease(&SharedResultCacheCtl->lock);
+}
+
+/*
+ * Look for a shared result of the query about to be run by ExecutorRun.
+ *
+ * Returns NULL if the result can neither be taken from the cache nor stored
+ * there.  Otherwise, if probe->hit is set the caller should send the result
+ * with SharedResultCacheSendTuples instead of running the plan; if not, it
+ * should send the tuples through SharedResultCacheCaptureReceiver and then
+ * call SharedResultCacheStore once the plan has run to completion.
+ */
+SharedResultCacheProbe *
+SharedResultCacheLookup(QueryDesc *queryDesc, ScanDirection direction,
+						uint64 count)
+{
+	EState	   *estate = queryDesc->estate;
+	Snapshot	snapshot = estate->es_snapshot;
+	SharedResultCacheProbe *probe;
+	SharedResultEntry *entry;
+	dsa_pointer stale_data = InvalidDsaPointer;
+
+	if (!shared_result_cache || shared_result_cache_size <= 0 ||
+		!queryDesc->plannedstmt->resultCacheable)
+		return NULL;
+
+	/* Only complete results sent to the client are cached */
+	if (queryDesc->operation != CMD_SELECT ||
+		!ScanDirectionIsForward(direction) || count != 0 ||
+		queryDesc->already_executed || estate->es_instrument != 0 ||
+		queryDesc->queryEnv != NULL)
+		return NULL;
+	if (queryDesc->dest->mydest != DestRemote &&
+		queryDesc->dest->mydest != DestRemoteExecute &&
+		queryDesc->dest->mydest != DestRemoteSimple)
+		return NULL;
+
+	/*
+	 * Our snapshot must be one that others could have used, too: not one
+	 * that sees our own transaction's changes, nor one taken during
+	 * recovery, where writes are not tracked.  Serializable transactions
+	 * must run the plan to take their predicate locks.
+	 */
+	if (!IsMVCCSnapshot(snapshot) || snapshot->takenDuringRecovery ||
+		TransactionIdIsValid(GetTopTransactionIdIfAny()) ||
+		IsolationIsSerializable() || IsInParallelMode())
+		return NULL;
+
+	probe = palloc0(sizeof(SharedResultCacheProbe));
+	probe->cxt = CurrentMemoryContext;
+	probe->natts = queryDesc->tupDesc->natts;
+	src_build_key(queryDesc, probe);
+	src_collect_deps(queryDesc->plannedstmt, probe);
+
+	src_attach();
+
+	entry = dshash_find(src_hash, &probe->key, false);
+	if (entry != NULL)
+	{
+		char	   *data = dsa_get_address(src_area, entry->data);
+		uint32	   *deps = (uint32 *) data;
+		char	   *keytext = data + entry->ndeps * sizeof(uint32);
+
+		if (entry->keylen == probe->keylen &&
+			memcmp(keytext, probe->keytext, probe->keylen) == 0)
+		{
+			if (!src_deps_are_valid(entry->seq, deps, entry->ndeps) ||
+				entry->natts != probe->natts)
+				stale_data = entry->data;
+			else if (src_writers_are_visible(deps, entry->ndeps, snapshot))
+			{
+				char	   *tuples = src_entry_tuples(data, entry->ndeps,
+													  entry->keylen);
+				Size		tupleslen = entry->datalen - (tuples - data);
+
+				initStringInfo(&probe->tuples);
+				appendBinaryStringInfo(&probe->tuples, tuples, tupleslen);
+				probe->ntuples = entry->ntuples;
+				probe->hit = true;
+
+				pg_atomic_write_u64(&entry->last_used,
+									pg_atomic_add_fetch_u64(&SharedResultCacheCtl->use_clock, 1));
+			}
+		}
+		dshash_release_lock(src_hash, entry);
+	}
+
+	if (DsaPointerIsValid(stale_data))
+		src_remove_entry(&probe->key, stale_data);
+
+	if (probe->hit)
+	{
+		pg_atomic_fetch_add_u64(&SharedResultCacheCtl->hits, 1);
+		return probe;
+	}
+
+	pg_atomic_fetch_add_u64(&SharedResultCacheCtl->misses, 1);
+
+	/*
+	 * Capture the result only if our snapshot sees all writes so far.  The
+	 * sequence number must be read first, so that any writer we don't see
+	 * as recorded yet will advance a slot past it.
+	 */
+	probe->seq = pg_atomic_read_u64(&SharedResultCacheCtl->next_seq);
+	if (!src_writers_are_visible(probe->deps, probe->ndeps, snapshot))
+		return NULL;
+
+	probe->capturing = true;
+	initStringInfo(&probe->tuples);
+
+	return probe;
+}
+
+/*
+ * Send a result found by SharedResultCacheLookup to dest.
+ */
+void
+SharedResultCacheSendTuples(SharedResultCacheProbe *probe,
+							QueryDesc *queryDesc, DestReceiver *dest)
+{
+	EState	   *estate = queryDesc->estate;
+	TupleTableSlot *slot;
+	char	   *ptr = probe->tuples.data;
+
+	Assert(probe->hit);
+
+	slot = MakeSingleTupleTableSlot(queryDesc->tupDesc, &TTSOpsMinimalTuple);
+
+	for (uint64 i = 0; i < probe->ntuples; i++)
+	{
+		MinimalTuple tuple = (MinimalTuple) ptr;
+
+		CHECK_FOR_INTERRUPTS();
+
+		ExecStoreMinimalTuple(tuple, slot, false);
+		if (!dest->receiveSlot(slot, dest))
+			break;
+		estate->es_processed++;
+
+		ptr += MAXALIGN(tuple->t_len);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+}
+
+/*
+ * Return a DestReceiver that collects the result in probe on its way to
+ * dest.
+ */
+DestReceiver *
+SharedResultCacheCaptureReceiver(SharedResultCacheProbe *probe,
+								 DestReceiver *dest)
+{
+	SharedResultCaptureReceiver *self;
+
+	Assert(probe->capturing);
+
+	self = (SharedResultCaptureReceiver *)
+		palloc0(sizeof(SharedResultCaptureReceiver));
+	self->pub.receiveSlot = src_capture_receive;
+	self->pub.rStartup = src_capture_startup;
+	self->pub.rShutdown = src_capture_shutdown;
+	self->pub.rDestroy = src_capture_destroy;
+	self->pub.mydest = dest->mydest;
+	self->dest = dest;
+	self->probe = probe;
+
+	return (DestReceiver *) self;
+}
+
+static void
+src_capture_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	SharedResultCaptureReceiver *myState = (SharedResultCaptureReceiver *) self;
+
+	myState->dest->rStartup(myState->dest, operation, typeinfo);
+}
+
+static bool
+src_capture_receive(TupleTableSlot *slot, DestReceiver *self)
+{
+	SharedResultCaptureReceiver *myState = (SharedResultCaptureReceiver *) self;
+	SharedResultCacheProbe *probe = myState->probe;
+
+	if (probe->capturing)
+	{
+		MinimalTuple tuple;
+		bool		shouldFree;
+		Size		len;
+
+		tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+		len = MAXALIGN(tuple->t_len);
+
+		if (probe->tuples.len + len >
+			(Size) shared_result_cache_max_entry_size * 1024)
+		{
+			/* Too big to cache; stop collecting */
+			probe->capturing = false;
+			pfree(probe->tuples.data);
+			probe->tuples.data = NULL;
+		}
+		else
+		{
+			MemoryContext oldcontext = MemoryContextSwitchTo(probe->cxt);
+
+			appendBinaryStringInfo(&probe->tuples, (char *) tuple,
+								   tuple->t_len);
+			if (len > tuple->t_len)
+				appendStringInfoSpaces(&probe->tuples, len - tuple->t_len);
+			probe->ntuples++;
+
+			MemoryContextSwitchTo(oldcontext);
+		}
+
+		if (shouldFree)
+			pfree(tuple);
+	}
+
+	return myState->dest->receiveSlot(slot, myState->dest);
+}
+
+static void
+src_capture_shutdown(DestReceiver *self)
+{
+	SharedResultCaptureReceiver *myState = (SharedResultCaptureReceiver *) self;
+
+	myState->dest->rShutdown(myState->dest);
+}
+
+static void
+src_capture_destroy(DestReceiver *self)
+{
+	pfree(self);
+}
+
+/*
+ * Store a result collected by SharedResultCacheCaptureReceiver in the shared
+ * cache.  The caller must make sure that the complete result was sent.
+ *
+ * Results that have become outdated while being collected, or that don't
+ * fit even after evicting other entries, are silently skipped.
+ */
+void
+SharedResultCacheStore(SharedResultCacheProbe *probe)
+{
+	Size		tuplesoff;
+	Size		datalen;
+	dsa_pointer dp;
+	char	   *data;
+	SharedResultEntry *entry;
+	bool		found;
+	uint64		now;
+
+	if (!probe->capturing)
+		return;
+
+	if (!src_deps_are_valid(probe->seq, probe->deps, probe->ndeps))
+		return;
+
+	tuplesoff = MAXALIGN(probe->ndeps * sizeof(uint32) + probe->keylen);
+	datalen = tuplesoff + probe->tuples.len;
+
+	dp = dsa_allocate_extended(src_area, datalen, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		src_evict(datalen);
+		dp = dsa_allocate_extended(src_area, datalen, DSA_ALLOC_NO_OOM);
+		if (!DsaPointerIsValid(dp))
+			return;
+	}
+
+	data = dsa_get_address(src_area, dp);
+	memcpy(data, probe->deps, probe->ndeps * sizeof(uint32));
+	memcpy(data + probe->ndeps * sizeof(uint32), probe->keytext,
+		   probe->keylen);
+	memcpy(data + tuplesoff, probe->tuples.data, probe->tuples.len);
+
+	now = pg_atomic_add_fetch_u64(&SharedResultCacheCtl->use_clock, 1);
+
+	entry = dshash_find_or_insert(src_hash, &probe->key, &found);
+	if (found)
+	{
+		/* The key text may differ on a hash collision; the newer one wins */
+		dsa_free(src_area, entry->data);
+		pg_atomic_write_u64(&entry->last_used, now);
+	}
+	else
+	{
+		pg_atomic_init_u64(&entry->last_used, now);
+		pg_atomic_fetch_add_u64(&SharedResultCacheCtl->entries, 1);
+	}
+
+	entry->seq = probe->seq;
+	entry->data = dp;
+	entry->datalen = datalen;
+	entry->ndeps = probe->ndeps;
+	entry->keylen = probe->keylen;
+	entry->natts = probe->natts;
+	entry->ntuples = probe->ntuples;
+	dshash_release_lock(src_hash, entry);
+
+	pg_atomic_fetch_add_u64(&SharedResultCacheCtl->stores, 1);
+}
+
+/*
+ * Record that the current transaction is about to write to rel.
+ *
+ * This is called whenever the executor opens a relation as a target of
+ * INSERT, UPDATE, DELETE, MERGE or COPY FROM, or as a partition that tuples
+ * are routed to, and by logical replication apply.  It has to happen even
+ * in sessions that don't use the cache themselves.
+ */
+void
+SharedResultCacheNoteWrite(Relation rel)
+{
+	TransactionId xid;
+	uint32		slot;
+	SharedResultWriters *writers;
+
+	if (SharedResultCacheCtl == NULL || shared_result_cache_size <= 0)
+		return;
+
+	/* Other sessions can't read our temporary tables */
+	if (RelationUsesLocalBuffers(rel) || RecoveryInProgress())
+		return;
+
+	/* The write is going to need a transaction ID anyway */
+	if (IsInParallelMode())
+	{
+		xid = GetTopTransactionIdIfAny();
+		if (!TransactionIdIsValid(xid))
+			return;
+	}
+	else
+		xid = GetTopTransactionId();
+
+	slot = src_relation_slot(RelationGetRelid(rel));
+
+	if (xid != src_noted_xid)
+	{
+		src_noted_xid = xid;
+		src_num_noted = 0;
+	}
+	else
+	{
+		for (int i = 0; i < src_num_noted; i++)
+		{
+			if (src_noted_slots[i] == slot)
+				return;
+		}
+	}
+
+	LWLockAcquire(&SharedResultCacheCtl->writer_lock, LW_EXCLUSIVE);
+
+	writers = &SharedResultCacheCtl->writers[slot];
+	if (writers->nxids == SRC_WRITERS_PER_SLOT)
+		src_prune_writers(writers);
+
+	if (writers->nxids < SRC_WRITERS_PER_SLOT)
+		writers->xids[writers->nxids++] = xid;
+	else if (!TransactionIdIsValid(writers->overflow_xid) ||
+			 TransactionIdFollows(xid, writers->overflow_xid))
+		writers->overflow_xid = xid;
+
+	src_invalidate_slot(slot);
+
+	LWLockRelease(&SharedResultCacheCtl->writer_lock);
+
+	if (src_num_noted < lengthof(src_noted_slots))
+		src_noted_slots[src_num_noted++] = slot;
+}
+
+/*
+ * Advance the sequence number of one invalidation slot.
+ */
+static void
+src_invalidate_slot(uint32 slot)
+{
+	uint64		seq;
+
+	seq = pg_atomic_add_fetch_u64(&SharedResultCacheCtl->next_seq, 1);
+	pg_atomic_monotonic_advance_u64(&SharedResultCacheCtl->slot_seq[slot], seq);
+}
+
+/*
+ * Invalidate all shared results.
+ */
+static void
+src_invalidate_all(void)
+{
+	uint64		seq;
+
+	seq = pg_atomic_add_fetch_u64(&SharedResultCacheCtl->next_seq, 1);
+	pg_atomic_monotonic_advance_u64(&SharedResultCacheCtl->reset_seq, seq);
+}
+
+/*
+ * Process invalidation messages of a committed transaction.
+ *
+ * Like SharedPlanCacheInvalidate, this is called once for each committed
+ * transaction's messages, after they have been sent to other backends.
+ */
+void
+SharedResultCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	if (SharedResultCacheCtl == NULL || shared_result_cache_size <= 0)
+		return;
+
+	for (int i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+		{
+			switch (msg->cc.id)
+			{
+				case PROCOID:
+				case TYPEOID:
+					src_invalidate_slot(src_object_slot(msg->cc.id,
+														msg->cc.hashValue));
+					break;
+				case NAMESPACEOID:
+				case OPEROID:
+				case AMOPOPID:
+				case FOREIGNSERVEROID:
+				case FOREIGNDATAWRAPPEROID:
+					src_invalidate_all();
+					break;
+				default:
+					break;
+			}
+		}
+		else if (msg->id == SHAREDINVALRELCACHE_ID)
+		{
+			if (OidIsValid(msg->rc.relId))
+				src_invalidate_slot(src_relation_slot(msg->rc.relId));
+			else
+				src_invalidate_all();
+		}
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+			src_invalidate_all();
+	}
+}
+
+/*
+ * SQL-callable function returning shared result cache statistics
+ */
+Datum
+pg_stat_get_shared_result_cache(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_SHARED_RESULT_CACHE_COLS	7
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_SHARED_RESULT_CACHE_COLS] = {0};
+	bool		nulls[PG_STAT_GET_SHARED_RESULT_CACHE_COLS] = {0};
+	int64		memory = 0;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	if (SharedResultCacheCtl->hash_handle != DSHASH_HANDLE_INVALID)
+	{
+		src_attach();
+		memory = (int64) dsa_get_total_size(src_area);
+	}
+
+	values[0] = Int64GetDatum(pg_atomic_read_u64(&SharedResultCacheCtl->hits));
+	values[1] = Int64GetDatum(pg_atomic_read_u64(&SharedResultCacheCtl->misses));
+	values[2] = Int64GetDatum(pg_atomic_read_u64(&SharedResultCacheCtl->stores));
+	values[3] = Int64GetDatum(pg_atomic_read_u64(&SharedResultCacheCtl->invalidations));
+	values[4] = Int64GetDatum(pg_atomic_read_u64(&SharedResultCacheCtl->evictions));
+	values[5] = Int64GetDatum(pg_atomic_read_u64(&SharedResultCacheCtl->entries));
+	values[6] = Int64GetDatum(memory);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * SQL-callable function to discard all shared results and reset statistics
+ */
+Datum
+pg_stat_reset_shared_result_cache(PG_FUNCTION_ARGS)
+{
+	pg_atomic_write_u64(&SharedResultCacheCtl->hits, 0);
+	pg_atomic_write_u64(&SharedResultCacheCtl->misses, 0);
+	pg_atomic_write_u64(&SharedResultCacheCtl->stores, 0);
+	pg_atomic_write_u64(&SharedResultCacheCtl->invalidations, 0);
+	pg_atomic_write_u64(&SharedResultCacheCtl->evictions, 0);
+
+	if (SharedResultCacheCtl->hash_handle != DSHASH_HANDLE_INVALID)
+	{
+		dshash_seq_status hstat;
+		SharedResultEntry *entry;
+
+		src_attach();
+
+		dshash_seq_init(&hstat, src_hash, true);
+		while ((entry = dshash_seq_next(&hstat)) != NULL)
+		{
+			dsa_free(src_area, entry->data);
+			dshash_delete_current(&hstat);
+			pg_atomic_fetch_sub_u64(&SharedResultCacheCtl->entries, 1);
+		}
+		dshash_seq_term(&hstat);
+	}
+
+	PG_RETURN_VOID();
+}
@@ -53,6 +53,8 @@
 #include "storage/sinvaladt.h"
 #include "storage/smgr.h"
 #include "storage/sync.h"
+#include "tcop/backend_pool.h"
+#include "tcop/backend_startup.h"
 #include "tcop/tcopprot.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
@@ -69,6 +71,8 @@
 static HeapTuple GetDatabaseTuple(const char *dbname);
 static HeapTuple GetDatabaseTupleByOid(Oid dboid);
 static void PerformAuthentication(Port *port);
+static void AttachToDatabase(const char *in_dbname, Oid dboid, bool bootstrap,
+							 char *dbname, char *out_dbname);
 static void CheckMyDatabase(const char *name, bool am_superuser, bool override_allow_connections);
 static void ShutdownPostgres(int code, Datum arg);
 static void StatementTimeoutHandler(void);
@@ -243,7 +247,9 @@ PerformAuthentication(Port *port)
 	 * Now perform authentication exchange.
 	 */
 	set_ps_display("authentication");
+	conn_timing.auth_started = GetCurrentTimestamp();
 	ClientAuthentication(port); /* might not return, if failure */
+	conn_timing.auth_ended = GetCurrentTimestamp();
 
 	/*
 	 * Done with authentication.  Disable the timeout, and log if needed.
@@ -651,6 +657,166 @@ BaseInit(void)
 }
 
 
+/*
+ * AttachToDatabase -- connect this backend to the given database
+ *
+ * Once this returns, we're able to access the database's catalogs.  The
+ * database's name is returned in dbname, which must be NAMEDATALEN bytes
+ * long, and also copied to out_dbname if that isn't NULL.
+ */
+static void
+AttachToDatabase(const char *in_dbname, Oid dboid, bool bootstrap,
+				 char *dbname, char *out_dbname)
+{
+	char	   *fullpath;
+
+	/*
+	 * Now, take a writer's lock on the database we are trying to connect to.
+	 * If there is a concurrently running DROP DATABASE on that database, this
+	 * will block us until it finishes (and has committed its update of
+	 * pg_database).
+	 *
+	 * Note that the lock is not held long, only until the end of this startup
+	 * transaction.  This is OK since we will advertise our use of the
+	 * database in the ProcArray before dropping the lock (in fact, that's the
+	 * next thing to do).  Anyone trying a DROP DATABASE after this point will
+	 * see us in the array once they have the lock.  Ordering is important for
+	 * this because we don't want to advertise ourselves as being in this
+	 * database until we have the lock; otherwise we create what amounts to a
+	 * deadlock with CountOtherDBBackends().
+	 *
+	 * Note: use of RowExclusiveLock here is reasonable because we envision
+	 * our session as being a concurrent writer of the database.  If we had a
+	 * way of declaring a session as being guaranteed-read-only, we could use
+	 * AccessShareLock for such sessions and thereby not conflict against
+	 * CREATE DATABASE.
+	 */
+	if (!bootstrap)
+		LockSharedObject(DatabaseRelationId, dboid, 0, RowExclusiveLock);
+
+	/*
+	 * Recheck pg_database to make sure the target database hasn't gone away.
+	 * If there was a concurrent DROP DATABASE, this ensures we will die
+	 * cleanly without creating a mess.
+	 */
+	if (!bootstrap)
+	{
+		HeapTuple	tuple;
+		Form_pg_database datform;
+
+		tuple = GetDatabaseTupleByOid(dboid);
+		if (HeapTupleIsValid(tuple))
+			datform = (Form_pg_database) GETSTRUCT(tuple);
+
+		if (!HeapTupleIsValid(tuple) ||
+			(in_dbname && namestrcmp(&datform->datname, in_dbname)))
+		{
+			if (in_dbname)
+				ereport(FATAL,
+						(errcode(ERRCODE_UNDEFINED_DATABASE),
+						 errmsg("database \"%s\" does not exist", in_dbname),
+						 errdetail("It seems to have just been dropped or renamed.")));
+			else
+				ereport(FATAL,
+						(errcode(ERRCODE_UNDEFINED_DATABASE),
+						 errmsg("database %u does not exist", dboid)));
+		}
+
+		strlcpy(dbname, NameStr(datform->datname), NAMEDATALEN);
+
+		if (database_is_invalid_form(datform))
+		{
+			ereport(FATAL,
+					errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					errmsg("cannot connect to invalid database \"%s\"", dbname),
+					errhint("Use DROP DATABASE to drop invalid databases."));
+		}
+
+		MyDatabaseTableSpace = datform->dattablespace;
+		MyDatabaseHasLoginEventTriggers = datform->dathasloginevt;
+		/* pass the database name back to the caller */
+		if (out_dbname)
+			strcpy(out_dbname, dbname);
+	}
+
+	/*
+	 * Now that we rechecked, we are certain to be connected to a database and
+	 * thus can set MyDatabaseId.
+	 *
+	 * It is important that MyDatabaseId only be set once we are sure that the
+	 * target database can no longer be concurrently dropped or renamed.  For
+	 * example, without this guarantee, pgstat_update_dbstats() could create
+	 * entries for databases that were just dropped in the pgstat shutdown
+	 * callback, which could confuse other code paths like the autovacuum
+	 * scheduler.
+	 */
+	MyDatabaseId = dboid;
+
+	/*
+	 * Now we can mark our PGPROC entry with the database ID.
+	 *
+	 * We assume this is an atomic store so no lock is needed; though actually
+	 * things would work fine even if it weren't atomic.  Anyone searching the
+	 * ProcArray for this database's ID should hold the database lock, so they
+	 * would not be executing concurrently with this store.  A process looking
+	 * for another database's ID could in theory see a chance match if it read
+	 * a partially-updated databaseId value; but as long as all such searches
+	 * wait and retry, as in CountOtherDBBackends(), they will certainly see
+	 * the correct value on their next try.
+	 */
+	MyProc->databaseId = MyDatabaseId;
+
+	/*
+	 * We established a catalog snapshot while reading pg_authid and/or
+	 * pg_database; but until we have set up MyDatabaseId, we won't react to
+	 * incoming sinval messages for unshared catalogs, so we won't realize it
+	 * if the snapshot has been invalidated.  Assume it's no good anymore.
+	 */
+	InvalidateCatalogSnapshot();
+
+	/*
+	 * Now we should be able to access the database directory safely. Verify
+	 * it's there and looks reasonable.
+	 */
+	fullpath = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
+
+	if (!bootstrap)
+	{
+		if (access(fullpath, F_OK) == -1)
+		{
+			if (errno == ENOENT)
+				ereport(FATAL,
+						(errcode(ERRCODE_UNDEFINED_DATABASE),
+						 errmsg("database \"%s\" does not exist",
+								dbname),
+						 errdetail("The database subdirectory \"%s\" is missing.",
+								   fullpath)));
+			else
+				ereport(FATAL,
+						(errcode_for_file_access(),
+						 errmsg("could not access directory \"%s\": %m",
+								fullpath)));
+		}
+
+		ValidatePgVersion(fullpath);
+	}
+
+	SetDatabasePath(fullpath);
+	pfree(fullpath);
+
+	/*
+	 * It's now possible to do real access to the system catalogs.
+	 *
+	 * Load relcache entries for the system catalogs.  This must create at
+	 * least the minimum set of "nailed-in" cache entries.
+	 */
+	RelationCacheInitializePhase3();
+
+	/* set up ACL framework (so CheckMyDatabase can check permissions) */
+	initialize_acl();
+}
+
+
 /* --------------------------------
  * InitPostgres
  *		Initialize POSTGRES.
@@ -701,7 +867,6 @@ InitPostgres(const char *in_dbname, Oid dboid,
 {
 	bool		bootstrap = IsBootstrapProcessingMode();
 	bool		am_superuser;
-	char	   *fullpath;
 	char		dbname[NAMEDATALEN];
 	int			nfree = 0;
 
@@ -840,6 +1005,42 @@ InitPostgres(const char *in_dbname, Oid dboid,
 		(void) GetTransactionSnapshot();
 	}
 
+	/*
+	 * A pooled backend connects to its database before it has a client, and
+	 * then waits for one.  Everything from authentication on is done once
+	 * the client is there, in a new transaction.
+	 */
+	if (am_pooled_backend)
+	{
+		HeapTuple	tuple;
+
+		tuple = GetDatabaseTuple(in_dbname);
+		if (!HeapTupleIsValid(tuple))
+			ereport(FATAL,
+					(errcode(ERRCODE_UNDEFINED_DATABASE),
+					 errmsg("database \"%s\" does not exist", in_dbname)));
+		dboid = ((Form_pg_database) GETSTRUCT(tuple))->oid;
+
+		AttachToDatabase(in_dbname, dboid, false, dbname, out_dbname);
+
+		/* Don't hold back the xmin horizon while we wait */
+		CommitTransactionCommand();
+
+		BackendPoolWaitForClient();
+		username = MyProcPort->user_name;
+
+		SetCurrentStatementStartTimestamp();
+		StartTransactionCommand();
+		XactIsoLevel = XACT_READ_COMMITTED;
+		(void) GetTransactionSnapshot();
+
+		/* Login event triggers might have been created in the meantime */
+		tuple = GetDatabaseTupleByOid(MyDatabaseId);
+		if (HeapTupleIsValid(tuple))
+			MyDatabaseHasLoginEventTriggers =
+				((Form_pg_database) GETSTRUCT(tuple))->dathasloginevt;
+	}
+
 	/*
 	 * Perform client authentication if necessary, then figure out our
 	 * postgres user ID, and see if we are a superuser.
@@ -975,9 +1176,11 @@ InitPostgres(const char *in_dbname, Oid dboid,
 	 * But note we won't actually try to touch the database just yet.
 	 *
 	 * We take a shortcut in the bootstrap case, otherwise we have to look up
-	 * the db's entry in pg_database.
+	 * the db's entry in pg_database.  A pooled backend did all this already.
 	 */
-	if (bootstrap)
+	if (am_pooled_backend)
+		Assert(OidIsValid(MyDatabaseId));
+	else if (bootstrap)
 	{
 		dboid = Template1DbOid;
 		MyDatabaseTableSpace = DEFAULTTABLESPACE_OID;
@@ -1011,150 +1214,8 @@ InitPostgres(const char *in_dbname, Oid dboid,
 		return;
 	}
 
-	/*
-	 * Now, take a writer's lock on the database we are trying to connect to.
-	 * If there is a concurrently running DROP DATABASE on that database, this
-	 * will block us until it finishes (and has committed its update of
-	 * pg_database).
-	 *
-	 * Note that the lock is not held long, only until the end of this startup
-	 * transaction.  This is OK since we will advertise our use of the
-	 * database in the ProcArray before dropping the lock (in fact, that's the
-	 * next thing to do).  Anyone trying a DROP DATABASE after this point will
-	 * see us in the array once they have the lock.  Ordering is important for
-	 * this because we don't want to advertise ourselves as being in this
-	 * database until we have the lock; otherwise we create what amounts to a
-	 * deadlock with CountOtherDBBackends().
-	 *
-	 * Note: use of RowExclusiveLock here is reasonable because we envision
-	 * our session as being a concurrent writer of the database.  If we had a
-	 * way of declaring a session as being guaranteed-read-only, we could use
-	 * AccessShareLock for such sessions and thereby not conflict against
-	 * CREATE DATABASE.
-	 */
-	if (!bootstrap)
-		LockSharedObject(DatabaseRelationId, dboid, 0, RowExclusiveLock);
-
-	/*
-	 * Recheck pg_database to make sure the target database hasn't gone away.
-	 * If there was a concurrent DROP DATABASE, this ensures we will die
-	 * cleanly without creating a mess.
-	 */
-	if (!bootstrap)
-	{
-		HeapTuple	tuple;
-		Form_pg_database datform;
-
-		tuple = GetDatabaseTupleByOid(dboid);
-		if (HeapTupleIsValid(tuple))
-			datform = (Form_pg_database) GETSTRUCT(tuple);
-
-		if (!HeapTupleIsValid(tuple) ||
-			(in_dbname && namestrcmp(&datform->datname, in_dbname)))
-		{
-			if (in_dbname)
-				ereport(FATAL,
-						(errcode(ERRCODE_UNDEFINED_DATABASE),
-						 errmsg("database \"%s\" does not exist", in_dbname),
-						 errdetail("It seems to have just been dropped or renamed.")));
-			else
-				ereport(FATAL,
-						(errcode(ERRCODE_UNDEFINED_DATABASE),
-						 errmsg("database %u does not exist", dboid)));
-		}
-
-		strlcpy(dbname, NameStr(datform->datname), sizeof(dbname));
-
-		if (database_is_invalid_form(datform))
-		{
-			ereport(FATAL,
-					errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
-					errmsg("cannot connect to invalid database \"%s\"", dbname),
-					errhint("Use DROP DATABASE to drop invalid databases."));
-		}
-
-		MyDatabaseTableSpace = datform->dattablespace;
-		MyDatabaseHasLoginEventTriggers = datform->dathasloginevt;
-		/* pass the database name back to the caller */
-		if (out_dbname)
-			strcpy(out_dbname, dbname);
-	}
-
-	/*
-	 * Now that we rechecked, we are certain to be connected to a database and
-	 * thus can set MyDatabaseId.
-	 *
-	 * It is important that MyDatabaseId only be set once we are sure that the
-	 * target database can no longer be concurrently dropped or renamed.  For
-	 * example, without this guarantee, pgstat_update_dbstats() could create
-	 * entries for databases that were just dropped in the pgstat shutdown
-	 * callback, which could confuse other code paths like the autovacuum
-	 * scheduler.
-	 */
-	MyDatabaseId = dboid;
-
-	/*
-	 * Now we can mark our PGPROC entry with the database ID.
-	 *
-	 * We assume this is an atomic store so no lock is needed; though actually
-	 * things would work fine even if it weren't atomic.  Anyone searching the
-	 * ProcArray for this database's ID should hold the database lock, so they
-	 * would not be executing concurrently with this store.  A process looking
-	 * for another database's ID could in theory see a chance match if it read
-	 * a partially-updated databaseId value; but as long as all such searches
-	 * wait and retry, as in CountOtherDBBackends(), they will certainly see
-	 * the correct value on their next try.
-	 */
-	MyProc->databaseId = MyDatabaseId;
-
-	/*
-	 * We established a catalog snapshot while reading pg_authid and/or
-	 * pg_database; but until we have set up MyDatabaseId, we won't react to
-	 * incoming sinval messages for unshared catalogs, so we won't realize it
-	 * if the snapshot has been invalidated.  Assume it's no good anymore.
-	 */
-	InvalidateCatalogSnapshot();
-
-	/*
-	 * Now we should be able to access the database directory safely. Verify
-	 * it's there and looks reasonable.
-	 */
-	fullpath = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
-
-	if (!bootstrap)
-	{
-		if (access(fullpath, F_OK) == -1)
-		{
-			if (errno == ENOENT)
-				ereport(FATAL,
-						(errcode(ERRCODE_UNDEFINED_DATABASE),
-						 errmsg("database \"%s\" does not exist",
-								dbname),
-						 errdetail("The database subdirectory \"%s\" is missing.",
-								   fullpath)));
-			else
-				ereport(FATAL,
-						(errcode_for_file_access(),
-						 errmsg("could not access directory \"%s\": %m",
-								fullpath)));
-		}
-
-		ValidatePgVersion(fullpath);
-	}
-
-	SetDatabasePath(fullpath);
-	pfree(fullpath);
-
-	/*
-	 * It's now possible to do real access to the system catalogs.
-	 *
-	 * Load relcache entries for the system catalogs.  This must create at
-	 * least the minimum set of "nailed-in" cache entries.
-	 */
-	RelationCacheInitializePhase3();
-
-	/* set up ACL framework (so CheckMyDatabase can check permissions) */
-	initialize_acl();
+	if (!am_pooled_backend)
+		AttachToDatabase(in_dbname, dboid, bootstrap, dbname, out_dbname);
 
 	/*
 	 * Re-read the pg_database row for our database, check permissions and set
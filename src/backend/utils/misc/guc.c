@@ -2099,6 +2099,27 @@ ResetAllOptions(void)
 	}
 }
 
+/*
+ * Are any options SET at session level?  (Outside a transaction, this tells
+ * whether the session's settings differ from what it started with.)
+ */
+bool
+HaveSessionOptions(void)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &guc_nondef_list)
+	{
+		struct config_generic *gconf = dlist_container(struct config_generic,
+													   nondef_link, iter.cur);
+
+		if (gconf->source == PGC_S_SESSION)
+			return true;
+	}
+
+	return false;
+}
+
 
 /*
  * Apply a change to a GUC variable's "source" field.
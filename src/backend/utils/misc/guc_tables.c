@@ -27,6 +27,7 @@
 #endif
 
 #include "access/commit_ts.h"
+#include "access/csnlog.h"
 #include "access/gin.h"
 #include "access/slru.h"
 #include "access/toast_compression.h"
@@ -46,6 +47,7 @@
 #include "commands/vacuum.h"
 #include "common/file_utils.h"
 #include "common/scram-common.h"
+#include "executor/nodeNestloop.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
 #include "libpq/libpq.h"
@@ -62,6 +64,7 @@
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/connproxy.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/startup.h"
 #include "postmaster/syslogger.h"
@@ -77,6 +80,7 @@
 #include "storage/pg_shmem.h"
 #include "storage/predicate.h"
 #include "storage/standby.h"
+#include "tcop/backend_pool.h"
 #include "tcop/backend_startup.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
@@ -91,6 +95,9 @@
 #include "utils/plancache.h"
 #include "utils/ps_status.h"
 #include "utils/rls.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
+#include "utils/sharedresultcache.h"
 #include "utils/xml.h"
 
 #ifdef TRACE_SYNCSCAN
@@ -326,6 +333,12 @@ static const struct config_enum_entry constraint_exclusion_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry join_search_method_options[] = {
+	{"geqo", JOIN_SEARCH_GEQO, false},
+	{"idp", JOIN_SEARCH_IDP, false},
+	{NULL, 0, false}
+};
+
 /*
  * Although only "on", "off", "remote_apply", "remote_write", and "local" are
  * documented, we accept all the likely variants of "on" and "off".
@@ -929,6 +942,16 @@ struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_eager_aggregate", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partial aggregation of join inputs before joining."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_eager_aggregate,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_parallel_append", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of parallel append plans."),
@@ -949,6 +972,28 @@ struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_insert", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel insert plans."),
+			gettext_noop("Parallel workers then insert the rows of INSERT ... SELECT "
+						 "that they compute themselves."),
+			GUC_EXPLAIN
+		},
+		&enable_parallel_insert,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_redistribute", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of redistribute plans."),
+			gettext_noop("Redistribute moves rows between parallel workers so that "
+						 "rows with equal keys are processed by the same worker."),
+			GUC_EXPLAIN
+		},
+		&enable_parallel_redistribute,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_partition_pruning", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables plan-time and execution-time partition pruning."),
@@ -986,6 +1031,16 @@ struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_async_gather", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of asynchronous execution for Gather nodes in append plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_async_gather,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_group_by_reordering", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables reordering of GROUP BY keys."),
@@ -1055,6 +1110,17 @@ struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"csn_snapshots", PGC_POSTMASTER, LOCK_MANAGEMENT,
+			gettext_noop("Builds snapshots from commit sequence numbers."),
+			gettext_noop("Snapshots are then taken without scanning the process array, "
+						 "at the cost of looking up the commit sequence number of "
+						 "recently completed transactions.")
+		},
+		&csn_snapshots,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"ssl", PGC_SIGHUP, CONN_AUTH_SSL,
 			gettext_noop("Enables SSL connections."),
@@ -1972,6 +2038,46 @@ struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"jit_code_cache_shared", PGC_SUSET, QUERY_TUNING_OTHER,
+			gettext_noop("Shares cached JIT-compiled code with other sessions through files."),
+			gettext_noop("Only has an effect if jit_code_cache_size is not zero.")
+		},
+		&jit_code_cache_shared,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_catalog_cache", PGC_SIGHUP, RESOURCES_MEM,
+			gettext_noop("Shares catalog cache entries across sessions."),
+			NULL
+		},
+		&shared_catalog_cache,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_plan_cache", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Shares generic plans of prepared statements across sessions."),
+			NULL
+		},
+		&shared_plan_cache,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_result_cache", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Shares results of read-only queries across sessions."),
+			NULL
+		},
+		&shared_result_cache,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"jit_debugging_support", PGC_SU_BACKEND, DEVELOPER_OPTIONS,
 			gettext_noop("Register JIT-compiled functions with debugger."),
@@ -2076,6 +2182,16 @@ struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"parallel_apply_non_streamed", PGC_SIGHUP, REPLICATION_SUBSCRIBERS,
+			gettext_noop("Allows parallel apply workers to apply non-streamed transactions."),
+			gettext_noop("Only takes effect for subscriptions created with streaming = parallel."),
+		},
+		&parallel_apply_non_streamed,
+		false,
+		NULL, NULL, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, false, NULL, NULL, NULL
@@ -2130,6 +2246,15 @@ struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"jit_code_cache_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of JIT-compiled modules kept for reuse by later queries."),
+			gettext_noop("0 disables caching of JIT-compiled code.")
+		},
+		&jit_code_cache_size,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
 	{
 		{"join_collapse_limit", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Sets the FROM-list size beyond which JOIN "
@@ -2183,6 +2308,16 @@ struct config_int ConfigureNamesInt[] =
 		0, 0, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"idp_block_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of FROM items joined exhaustively in each round of iterative dynamic programming."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&idp_block_size,
+		8, 2, INT_MAX,
+		NULL, NULL, NULL
+	},
 
 	{
 		/* This is PGC_SUSET to prevent hiding from log_lock_waits. */
@@ -2294,6 +2429,50 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_plan_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the maximum amount of memory used for shared generic plans."),
+			gettext_noop("0 disables the shared plan cache."),
+			GUC_UNIT_KB
+		},
+		&shared_plan_cache_size,
+		65536, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_catalog_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the maximum amount of memory used for catalog cache entries shared across sessions."),
+			gettext_noop("0 disables the shared catalog cache."),
+			GUC_UNIT_KB
+		},
+		&shared_catalog_cache_size,
+		65536, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_result_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the maximum amount of memory used for query results shared across sessions."),
+			gettext_noop("0 disables the shared result cache."),
+			GUC_UNIT_KB
+		},
+		&shared_result_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_result_cache_max_entry_size", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum size of a single query result in the shared result cache."),
+			NULL,
+			GUC_UNIT_KB
+		},
+		&shared_result_cache_max_entry_size,
+		1024, 1, MaxAllocSize / 1024,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We sometimes multiply the number of shared buffers by two without
 	 * checking for overflow, so we mustn't allow more than INT_MAX / 2.
@@ -2451,6 +2630,46 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"connection_proxies", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of connection proxy processes."),
+			gettext_noop("Zero disables connection proxies.")
+		},
+		&connection_proxies,
+		0, 0, 128,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"proxy_port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the TCP port connection proxies listen on."),
+			NULL
+		},
+		&proxy_port,
+		6543, 1, 65535,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"session_pool_size", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the maximum number of backends each connection proxy keeps for one database, user and set of startup options."),
+			NULL
+		},
+		&session_pool_size,
+		10, 1, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"backend_pool_size", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of pre-initialized backends kept waiting for each database in backend_pool_databases."),
+			NULL
+		},
+		&backend_pool_size,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"unix_socket_permissions", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the access permissions of the Unix-domain socket."),
@@ -3858,6 +4077,18 @@ struct config_real ConfigureNamesReal[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"adaptive_nestloop_threshold", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the factor by which a nested loop's outer side must "
+						 "exceed its estimated size before the inner side is hashed."),
+			gettext_noop("Zero disables switching."),
+			GUC_EXPLAIN
+		},
+		&adaptive_nestloop_threshold,
+		0.0, 0.0, 1000000.0,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"geqo_selection_bias", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("GEQO: selective pressure within the population."),
@@ -4484,6 +4715,17 @@ struct config_string ConfigureNamesString[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"backend_pool_databases", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the databases for which pre-initialized backends are kept waiting for connections."),
+			NULL,
+			GUC_LIST_INPUT | GUC_LIST_QUOTE
+		},
+		&backend_pool_databases,
+		"",
+		NULL, NULL, NULL
+	},
+
 	{
 		{"listen_addresses", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the host name or IP address(es) to listen to."),
@@ -4845,6 +5087,17 @@ struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"join_search_method", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Selects the join search method used beyond geqo_threshold."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&join_search_method,
+		JOIN_SEARCH_GEQO, join_search_method_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"default_toast_compression", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets the default compression method for compressible values."),
@@ -1186,6 +1186,34 @@ ThereAreNoReadyPortals(void)
 	return true;
 }
 
+/*
+ * Are there any holdable portals that survived their creating transaction?
+ *
+ * This is meant to be called outside any transaction, when every remaining
+ * portal is a held cursor.
+ */
+bool
+ThereAreHeldPortals(void)
+{
+	HASH_SEQ_STATUS status;
+	PortalHashEnt *hentry;
+
+	hash_seq_init(&status, PortalHashTable);
+
+	while ((hentry = (PortalHashEnt *) hash_seq_search(&status)) != NULL)
+	{
+		Portal		portal = hentry->portal;
+
+		if (portal->createSubid == InvalidSubTransactionId)
+		{
+			hash_seq_term(&status);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * Hold all pinned portals.
  *
@@ -2714,9 +2714,18 @@ describeOneTableDetails(const char *schemaname,
 		/* print any extended statistics */
 		if (pset.sversion >= 140000)
 		{
-			printfPQExpBuffer(&buf,
-							  "SELECT oid, "
-							  "stxrelid::pg_catalog.regclass, "
+			printfPQExpBuffer(&buf, "SELECT oid, ");
+			if (pset.sversion >= 180000)
+				appendPQExpBufferStr(&buf,
+									 "CASE WHEN stxfkey <> 0 THEN\n"
+									 "  (SELECT pg_catalog.format('%s JOIN %s',\n"
+									 "     conrelid::pg_catalog.regclass,\n"
+									 "     confrelid::pg_catalog.regclass)\n"
+									 "   FROM pg_catalog.pg_constraint WHERE oid = stxfkey)\n"
+									 "ELSE stxrelid::pg_catalog.regclass::pg_catalog.text END, ");
+			else
+				appendPQExpBufferStr(&buf, "stxrelid::pg_catalog.regclass, ");
+			appendPQExpBuffer(&buf,
 							  "stxnamespace::pg_catalog.regnamespace::pg_catalog.text AS nsp, "
 							  "stxname,\n"
 							  "pg_catalog.pg_get_statisticsobjdef_columns(oid) AS columns,\n"
@@ -4729,7 +4738,18 @@ listExtendedStats(const char *pattern)
 					  gettext_noop("Schema"),
 					  gettext_noop("Name"));
 
-	if (pset.sversion >= 140000)
+	if (pset.sversion >= 180000)
+		appendPQExpBuffer(&buf,
+						  "pg_catalog.format('%%s FROM %%s', \n"
+						  "  pg_catalog.pg_get_statisticsobjdef_columns(es.oid), \n"
+						  "  CASE WHEN es.stxfkey <> 0 THEN \n"
+						  "    (SELECT pg_catalog.format('%%s JOIN %%s', \n"
+						  "       c.conrelid::pg_catalog.regclass, \n"
+						  "       c.confrelid::pg_catalog.regclass) \n"
+						  "     FROM pg_catalog.pg_constraint c WHERE c.oid = es.stxfkey) \n"
+						  "  ELSE es.stxrelid::pg_catalog.regclass::pg_catalog.text END) AS \"%s\"",
+						  gettext_noop("Definition"));
+	else if (pset.sversion >= 140000)
 		appendPQExpBuffer(&buf,
 						  "pg_catalog.format('%%s FROM %%s', \n"
 						  "  pg_catalog.pg_get_statisticsobjdef_columns(es.oid), \n"
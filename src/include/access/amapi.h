@@ -117,6 +117,17 @@ typedef bool (*aminsert_function) (Relation indexRelation,
 typedef void (*aminsertcleanup_function) (Relation indexRelation,
 										  struct IndexInfo *indexInfo);
 
+/* insert a batch of tuples */
+typedef void (*aminsertbatch_function) (Relation indexRelation,
+										int ntuples,
+										Datum **values,
+										bool **isnull,
+										ItemPointer heap_tids,
+										Relation heapRelation,
+										IndexUniqueCheck checkUnique,
+										bool *is_unique,
+										struct IndexInfo *indexInfo);
+
 /* bulk delete */
 typedef IndexBulkDeleteResult *(*ambulkdelete_function) (IndexVacuumInfo *info,
 														 IndexBulkDeleteResult *stats,
@@ -275,6 +286,7 @@ typedef struct IndexAmRoutine
 	ambuildempty_function ambuildempty;
 	aminsert_function aminsert;
 	aminsertcleanup_function aminsertcleanup;
+	aminsertbatch_function aminsertbatch;	/* can be NULL */
 	ambulkdelete_function ambulkdelete;
 	amvacuumcleanup_function amvacuumcleanup;
 	amcanreturn_function amcanreturn;	/* can be NULL */
@@ -0,0 +1,35 @@
+/*
+ * csnlog.h
+ *
+ * Commit sequence number log manager
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/csnlog.h
+ */
+#ifndef CSNLOG_H
+#define CSNLOG_H
+
+#include "access/transam.h"
+
+/* GUC variable */
+extern PGDLLIMPORT bool csn_snapshots;
+
+extern void CSNLogSetCommitted(TransactionId xid, int nsubxids,
+							   TransactionId *subxids, TransactionId latestXid);
+extern bool CSNLogXidCommittedBefore(TransactionId xid, CommitSeqNo snapshotcsn);
+
+extern FullTransactionId CSNLogGetOldestActiveXid(void);
+extern void CSNLogSetOldestActiveXid(FullTransactionId oldestActiveXid);
+extern CommitSeqNo CSNLogGetSnapshotCSN(FullTransactionId *xmax);
+
+extern Size CSNLogShmemSize(void);
+extern void CSNLogShmemInit(void);
+extern void BootStrapCSNLog(void);
+extern void StartupCSNLog(TransactionId oldestActiveXID);
+extern void CheckPointCSNLog(void);
+extern void ExtendCSNLog(TransactionId newestXact);
+extern void TruncateCSNLog(TransactionId oldestXact);
+
+#endif							/* CSNLOG_H */
@@ -151,6 +151,13 @@ extern bool index_insert(Relation indexRelation,
 						 struct IndexInfo *indexInfo);
 extern void index_insert_cleanup(Relation indexRelation,
 								 struct IndexInfo *indexInfo);
+extern void index_insert_batch(Relation indexRelation, int ntuples,
+							   Datum **values, bool **isnull,
+							   ItemPointer heap_tids,
+							   Relation heapRelation,
+							   IndexUniqueCheck checkUnique,
+							   bool *is_unique,
+							   struct IndexInfo *indexInfo);
 
 extern IndexScanDesc index_beginscan(Relation heapRelation,
 									 Relation indexRelation,
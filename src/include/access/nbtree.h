@@ -1019,15 +1019,32 @@ typedef BTScanPosData *BTScanPos;
 		(scanpos).currPage = InvalidBlockNumber; \
 	} while (0)
 
-/* We need one of these for each equality-type SK_SEARCHARRAY scan key */
+/*
+ * We need one of these for each equality-type SK_SEARCHARRAY scan key.
+ *
+ * Skip arrays are arrays that preprocessing generates for an index column
+ * that has no scan keys of its own, but precedes columns that do.  A skip
+ * array logically contains every possible value of its column (including
+ * NULL).  Its elements are never materialized; the current element is simply
+ * stored in the scan key's sk_argument, taken from an index tuple whenever
+ * the array advances.  Skip arrays have num_elems == -1, and use the
+ * SK_BT_SKIP-related sk_flags bits to represent positions that aren't an
+ * actual element value.
+ */
 typedef struct BTArrayKeyInfo
 {
 	int			scan_key;		/* index of associated key in keyData */
 	int			cur_elem;		/* index of current element in elem_values */
 	int			num_elems;		/* number of elems in current array value */
 	Datum	   *elem_values;	/* array of num_elems Datums */
+
+	/* fields used by skip arrays only */
+	int16		attlen;			/* attribute's typlen */
+	bool		attbyval;		/* attribute's typbyval */
 } BTArrayKeyInfo;
 
+#define BTArrayIsSkip(array)	((array)->num_elems == -1)
+
 typedef struct BTScanOpaqueData
 {
 	/* these fields are set by _bt_preprocess_keys(): */
@@ -1114,6 +1131,14 @@ typedef struct BTReadPageState
  */
 #define SK_BT_REQFWD	0x00010000	/* required to continue forward scan */
 #define SK_BT_REQBKWD	0x00020000	/* required to continue backward scan */
+#define SK_BT_SKIP		0x00040000	/* skip array on otherwise unconstrained
+									 * attribute */
+#define SK_BT_MINVAL	0x00080000	/* skip array is before all values */
+#define SK_BT_MAXVAL	0x00100000	/* skip array is after all values */
+#define SK_BT_NEXT		0x00200000	/* skip array is just after sk_argument */
+#define SK_BT_PRIOR		0x00400000	/* skip array is just before sk_argument */
+#define SK_BT_SKIP_SENTINEL \
+	(SK_BT_MINVAL | SK_BT_MAXVAL | SK_BT_NEXT | SK_BT_PRIOR)
 #define SK_BT_INDOPTION_SHIFT  24	/* must clear the above bits */
 #define SK_BT_DESC			(INDOPTION_DESC << SK_BT_INDOPTION_SHIFT)
 #define SK_BT_NULLS_FIRST	(INDOPTION_NULLS_FIRST << SK_BT_INDOPTION_SHIFT)
@@ -1159,6 +1184,11 @@ extern bool btinsert(Relation rel, Datum *values, bool *isnull,
 					 IndexUniqueCheck checkUnique,
 					 bool indexUnchanged,
 					 struct IndexInfo *indexInfo);
+extern void btinsertbatch(Relation rel, int ntuples,
+						  Datum **values, bool **isnull,
+						  ItemPointer ht_ctids, Relation heapRel,
+						  IndexUniqueCheck checkUnique, bool *is_unique,
+						  struct IndexInfo *indexInfo);
 extern IndexScanDesc btbeginscan(Relation rel, int nkeys, int norderbys);
 extern Size btestimateparallelscan(int nkeys, int norderbys);
 extern void btinitparallelscan(void *target);
@@ -1214,6 +1244,9 @@ extern IndexTuple _bt_swap_posting(IndexTuple newitem, IndexTuple oposting,
 extern bool _bt_doinsert(Relation rel, IndexTuple itup,
 						 IndexUniqueCheck checkUnique, bool indexUnchanged,
 						 Relation heapRel);
+extern void _bt_doinsert_batch(Relation rel, IndexTuple *itups, int ntuples,
+							   IndexUniqueCheck checkUnique, bool *is_unique,
+							   Relation heapRel);
 extern void _bt_finish_split(Relation rel, Relation heaprel, Buffer lbuf,
 							 BTStack stack);
 extern Buffer _bt_getstackbuf(Relation rel, Relation heaprel, BTStack stack,
@@ -153,6 +153,25 @@ FullTransactionIdAdvance(FullTransactionId *dest)
 	(AssertMacro(TransactionIdIsNormal(id1) && TransactionIdIsNormal(id2)), \
 	(int32) ((id1) - (id2)) > 0)
 
+/* ----------------
+ *		Commit sequence numbers, see csnlog.c
+ *
+ *		A CSN orders transaction commits.  InvalidCommitSeqNo means that the
+ *		transaction has not committed (yet), CommittingCommitSeqNo that it is
+ *		in the process of being assigned one, and FrozenCommitSeqNo that it
+ *		committed before every snapshot that can still look at it.
+ * ----------------
+ */
+typedef uint64 CommitSeqNo;
+
+#define InvalidCommitSeqNo			((CommitSeqNo) 0)
+#define CommittingCommitSeqNo		((CommitSeqNo) 1)
+#define FrozenCommitSeqNo			((CommitSeqNo) 2)
+#define FirstNormalCommitSeqNo		((CommitSeqNo) 3)
+
+#define CommitSeqNoIsValid(csn)		((csn) != InvalidCommitSeqNo)
+#define CommitSeqNoIsNormal(csn)	((csn) >= FirstNormalCommitSeqNo)
+
 /* ----------
  *		Object ID (OID) zero is InvalidOid.
  *
@@ -57,6 +57,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	202410141
+#define CATALOG_VERSION_NO	202410149
 
 #endif
@@ -113,6 +113,9 @@ CATALOG(pg_class,1259,RelationRelationId) BKI_BOOTSTRAP BKI_ROWTYPE_OID(83,Relat
 	/* matview currently holds query results */
 	bool		relispopulated BKI_DEFAULT(t);
 
+	/* matview is incrementally maintained */
+	bool		relisivm BKI_DEFAULT(f);
+
 	/* see REPLICA_IDENTITY_xxx constants */
 	char		relreplident BKI_DEFAULT(n);
 
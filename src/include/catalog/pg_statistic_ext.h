@@ -44,6 +44,12 @@ CATALOG(pg_statistic_ext,3381,StatisticExtRelationId)
 
 	Oid			stxowner BKI_LOOKUP(pg_authid); /* statistics object's owner */
 
+	/*
+	 * For statistics on a join, the foreign key along which the referencing
+	 * table is joined to stxrelid, else 0
+	 */
+	Oid			stxfkey BKI_LOOKUP_OPT(pg_constraint);
+
 	/*
 	 * variable-length/nullable fields start here, but we allow direct access
 	 * to stxkeys
@@ -21,7 +21,18 @@
 #include "utils/relcache.h"
 
 
+/*
+ * Names used by incremental view maintenance.  Columns of an incremental
+ * view whose names start with the prefix are maintained internally.
+ */
+#define IVM_HIDDEN_COLUMN_PREFIX	"__ivm_"
+#define IVM_COUNT_COLUMN_NAME		"__ivm_count__"
+#define IVM_OLD_TABLE_NAME			"__ivm_oldtable"
+#define IVM_NEW_TABLE_NAME			"__ivm_newtable"
+
+
 extern void SetMatViewPopulatedState(Relation relation, bool newstate);
+extern void SetMatViewIVMState(Relation relation, bool newstate);
 
 extern ObjectAddress ExecRefreshMatView(RefreshMatViewStmt *stmt, const char *queryString,
 										QueryCompletion *qc);
@@ -33,4 +44,8 @@ extern DestReceiver *CreateTransientRelDestReceiver(Oid transientoid);
 
 extern bool MatViewIncrementalMaintenanceIsEnabled(void);
 
+extern void AtEOXact_IVM(void);
+extern void AtEOSubXact_IVM(bool isCommit, SubTransactionId mySubid,
+							SubTransactionId parentSubid);
+
 #endif							/* MATVIEW_H */
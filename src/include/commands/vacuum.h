@@ -232,9 +232,9 @@ typedef struct VacuumParams
 	Oid			toast_parent;	/* for privilege checks when recursing */
 
 	/*
-	 * The number of parallel vacuum workers.  0 by default which means choose
-	 * based on the number of indexes.  -1 indicates parallel vacuum is
-	 * disabled.
+	 * The number of parallel vacuum or analyze workers.  0 by default which
+	 * means choose based on the number of indexes, or on the amount of work
+	 * for ANALYZE.  -1 indicates parallel vacuum and analyze are disabled.
 	 */
 	int			nworkers;
 } VacuumParams;
@@ -379,6 +379,7 @@ extern void analyze_rel(Oid relid, RangeVar *relation,
 						VacuumParams *params, List *va_cols, bool in_outer_xact,
 						BufferAccessStrategy bstrategy);
 extern bool std_typanalyze(VacAttrStats *stats);
+extern void parallel_analyze_main(dsm_segment *seg, shm_toc *toc);
 
 /* in utils/misc/sampling.c --- duplicate of declarations in utils/sampling.h */
 extern double anl_random_fract(void);
@@ -21,5 +21,6 @@ extern void ExecAsyncNotify(AsyncRequest *areq);
 extern void ExecAsyncResponse(AsyncRequest *areq);
 extern void ExecAsyncRequestDone(AsyncRequest *areq, TupleTableSlot *result);
 extern void ExecAsyncRequestPending(AsyncRequest *areq);
+extern void ExecAsyncConfigureLatchWait(AsyncRequest *areq);
 
 #endif							/* EXECASYNC_H */
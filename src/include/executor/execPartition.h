@@ -127,5 +127,7 @@ extern PartitionPruneState *ExecInitPartitionPruning(PlanState *planstate,
 													 Bitmapset **initially_valid_subplans);
 extern Bitmapset *ExecFindMatchingSubPlans(PartitionPruneState *prunestate,
 										   bool initial_prune);
+extern Bitmapset *ExecGetUnprunedRelids(PlannedStmt *plannedstmt,
+										ParamListInfo params);
 
 #endif							/* EXECPARTITION_H */
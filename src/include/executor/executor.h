@@ -61,6 +61,9 @@
  * WITH_NO_DATA indicates that we are performing REFRESH MATERIALIZED VIEW
  * ... WITH NO DATA.  Currently, the only effect is to suppress errors about
  * scanning unpopulated materialized views.
+ *
+ * PARALLEL_WORKER indicates that a parallel worker is running its share of
+ * the leader's plan.  Only that executor may insert rows in parallel mode.
  */
 #define EXEC_FLAG_EXPLAIN_ONLY		0x0001	/* EXPLAIN, no ANALYZE */
 #define EXEC_FLAG_EXPLAIN_GENERIC	0x0002	/* EXPLAIN (GENERIC_PLAN) */
@@ -69,6 +72,7 @@
 #define EXEC_FLAG_MARK				0x0010	/* need mark/restore */
 #define EXEC_FLAG_SKIP_TRIGGERS		0x0020	/* skip AfterTrigger setup */
 #define EXEC_FLAG_WITH_NO_DATA		0x0040	/* REFRESH ... WITH NO DATA */
+#define EXEC_FLAG_PARALLEL_WORKER	0x0080	/* worker running leader's plan */
 
 
 /* Hook for plugins to get control in ExecutorStart() */
@@ -643,7 +647,11 @@ extern List *ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 								   bool update,
 								   bool noDupErr,
 								   bool *specConflict, List *arbiterIndexes,
-								   bool onlySummarizing);
+								   bool onlySummarizing,
+								   bool skipBatchable);
+extern void ExecInsertIndexTuplesBatch(ResultRelInfo *resultRelInfo,
+									   TupleTableSlot **slots, int ntuples,
+									   EState *estate);
 extern bool ExecCheckIndexConstraints(ResultRelInfo *resultRelInfo,
 									  TupleTableSlot *slot,
 									  EState *estate, ItemPointer conflictTid,
@@ -21,4 +21,8 @@ extern void ExecEndGather(GatherState *node);
 extern void ExecShutdownGather(GatherState *node);
 extern void ExecReScanGather(GatherState *node);
 
+extern void ExecAsyncGatherRequest(AsyncRequest *areq);
+extern void ExecAsyncGatherConfigureWait(AsyncRequest *areq);
+extern void ExecAsyncGatherNotify(AsyncRequest *areq);
+
 #endif							/* NODEGATHER_H */
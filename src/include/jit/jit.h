@@ -43,6 +43,9 @@ typedef struct JitInstrumentation
 
 	/* accumulated time for code emission */
 	instr_time	emission_counter;
+
+	/* number of functions whose emitted code was found in a cache */
+	size_t		cached_functions;
 } JitInstrumentation;
 
 /*
@@ -90,6 +93,8 @@ extern PGDLLIMPORT bool jit_tuple_deforming;
 extern PGDLLIMPORT double jit_above_cost;
 extern PGDLLIMPORT double jit_inline_above_cost;
 extern PGDLLIMPORT double jit_optimize_above_cost;
+extern PGDLLIMPORT int jit_code_cache_size;
+extern PGDLLIMPORT bool jit_code_cache_shared;
 
 
 extern void jit_reset_after_error(void);
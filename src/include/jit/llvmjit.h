@@ -63,6 +63,21 @@ typedef struct LLVMJitContext
 
 	/* list of handles for code emitted via Orc */
 	List	   *handles;
+
+	/*
+	 * Can the code of the current module be cached? That requires all
+	 * pointers into executor state to be loaded from a relocation table (see
+	 * llvm_reloc_ptr()), rather than being emitted as constants.
+	 */
+	bool		module_cacheable;
+
+	/* builder and table for relocations of the function being generated */
+	LLVMBuilderRef reloc_builder;
+	LLVMValueRef reloc_table;
+	List	   *relocs;
+
+	/* generated function names and the names of their cached code */
+	List	   *cached_symbols;
 } LLVMJitContext;
 
 /* type and struct definitions */
@@ -113,6 +128,13 @@ extern LLVMValueRef llvm_function_reference(LLVMJitContext *context,
 						LLVMBuilderRef builder,
 						LLVMModuleRef mod,
 						FunctionCallInfo fcinfo);
+extern void llvm_begin_relocations(LLVMJitContext *context,
+								   LLVMValueRef v_insert_before,
+								   LLVMValueRef v_table);
+extern List *llvm_end_relocations(LLVMJitContext *context);
+extern LLVMValueRef llvm_reloc_ptr(LLVMJitContext *context, void *ptr,
+								   LLVMTypeRef type);
+extern LLVMValueRef llvm_reloc_datum(LLVMJitContext *context, Datum value);
 
 extern void llvm_inline_reset_caches(void);
 extern void llvm_inline(LLVMModuleRef mod);
@@ -0,0 +1,52 @@
+/*-------------------------------------------------------------------------
+ * stenciljit.h
+ *	  Template based JIT provider.
+ *
+ * Copyright (c) 2024, PostgreSQL Global Development Group
+ *
+ * src/include/jit/stenciljit.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef STENCILJIT_H
+#define STENCILJIT_H
+
+#include "executor/execExpr.h"
+
+/*
+ * How execution continues after the template of an expression step has been
+ * called.
+ */
+typedef enum StencilKind
+{
+	STENCIL_NEXT,				/* continue with the next step */
+	STENCIL_JUMP,				/* jump to jumps[0], template isn't called */
+	STENCIL_JUMP_IF_TRUE,		/* jump to jumps[0] if template returns true */
+	STENCIL_JUMP_IF_FALSE,		/* jump to jumps[0] if template returns false */
+	STENCIL_SWITCH,				/* template returns 0 to continue with the
+								 * next step, or i to jump to jumps[i - 1] */
+	STENCIL_DYNAMIC,			/* template returns the number of the step to
+								 * continue with */
+	STENCIL_DONE,				/* template returns the expression's result */
+} StencilKind;
+
+#define STENCIL_MAX_JUMPS	2
+
+/*
+ * Precompiled implementation of an expression step.
+ *
+ * The template is called with the ExprState, the step, the ExprContext and
+ * the isnull pointer passed to the expression, in that order; templates that
+ * don't need all of them may declare fewer parameters.
+ */
+typedef struct Stencil
+{
+	StencilKind kind;
+	void	   *func;
+	int			jumps[STENCIL_MAX_JUMPS];
+} Stencil;
+
+extern bool stencil_for_step(ExprState *state, ExprEvalStep *op,
+							 Stencil *stencil);
+
+#endif							/* STENCILJIT_H */
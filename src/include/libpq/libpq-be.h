@@ -143,6 +143,14 @@ typedef struct Port
 	int			remote_hostname_errcode;	/* see above */
 	char	   *remote_port;	/* text rep of remote port */
 
+	/*
+	 * Set if a connection proxy opened this connection on behalf of the
+	 * client at raddr.  proxy_trusted means the proxy vouches for the user,
+	 * having seen them authenticate on an earlier connection.
+	 */
+	bool		proxied;
+	bool		proxy_trusted;
+
 	/*
 	 * Information that needs to be saved from the startup packet and passed
 	 * into backend execution.  "char *" fields are NULL if not set.
@@ -51,6 +51,8 @@
 
 struct PlanState;				/* forward references in this file */
 struct ParallelHashJoinState;
+struct ParallelRedistributeState;
+struct SharedTuplestoreAccessor;
 struct ExecRowMark;
 struct ExprState;
 struct ExprContext;
@@ -111,6 +113,7 @@ typedef struct ExprState
 	Expr	   *expr;
 
 	/* private state for an evalfunc */
+#define FIELDNO_EXPRSTATE_EVALFUNC_PRIVATE 8
 	void	   *evalfunc_private;
 
 	/*
@@ -612,6 +615,7 @@ typedef struct AsyncRequest
 	struct PlanState *requestee;	/* Node from which a tuple is wanted */
 	int			request_index;	/* Scratch space for requestor */
 	bool		callback_pending;	/* Callback is needed */
+	bool		latch_wait;		/* Callback is needed once our latch is set */
 	bool		request_complete;	/* Request complete, result valid */
 	TupleTableSlot *result;		/* Result (NULL or an empty slot if no more
 								 * tuples) */
@@ -2134,6 +2138,30 @@ typedef struct JoinState
  *		NeedNewOuter	   true if need new outer tuple on next call
  *		MatchedOuter	   true if found a join match for current outer tuple
  *		NullInnerTupleSlot prepared null tuple for left outer joins
+ *
+ *		The remaining fields support switching to hashing the inner side,
+ *		once the outer side turns out much bigger than estimated:
+ *
+ *		SwitchAt		   outer tuples after which to switch, or 0 if not
+ *		OuterRows		   outer tuples fetched in this scan
+ *		Hashed			   true once the inner side is in HashTable
+ *		SwitchedAfter	   OuterRows when we switched (for EXPLAIN)
+ *		InnerHashed		   inner tuples stored in HashTable (for EXPLAIN)
+ *		HashTable		   inner tuples, chained by join key
+ *		HashTableCxt	   memory context holding HashTable's contents
+ *		HashTempCxt		   short-term context for hashing
+ *		NumHashCols		   number of hash clauses
+ *		KeyColIdx		   key column numbers, just 1..NumHashCols
+ *		TabEqFuncOids	   equality functions for the inner key types
+ *		TabHashFuncs	   hash functions for the inner key types
+ *		TabCollations	   collations of the hash clauses
+ *		OuterKeyProj	   computes the join keys of an outer tuple
+ *		InnerKeyProj	   computes the join keys of an inner tuple
+ *		OuterHashFuncs	   hash functions for OuterKeyProj's result
+ *		CrossEq			   compares outer keys with those in HashTable
+ *		HashInnerSlot	   holds the inner tuple being returned
+ *		HashChain		   inner tuples matching the current outer tuple
+ *		HashPos			   next position in HashChain
  * ----------------
  */
 typedef struct NestLoopState
@@ -2142,6 +2170,26 @@ typedef struct NestLoopState
 	bool		nl_NeedNewOuter;
 	bool		nl_MatchedOuter;
 	TupleTableSlot *nl_NullInnerTupleSlot;
+	double		nl_SwitchAt;
+	double		nl_OuterRows;
+	bool		nl_Hashed;
+	double		nl_SwitchedAfter;
+	double		nl_InnerHashed;
+	TupleHashTable nl_HashTable;
+	MemoryContext nl_HashTableCxt;
+	MemoryContext nl_HashTempCxt;
+	int			nl_NumHashCols;
+	AttrNumber *nl_KeyColIdx;
+	Oid		   *nl_TabEqFuncOids;
+	FmgrInfo   *nl_TabHashFuncs;
+	Oid		   *nl_TabCollations;
+	ProjectionInfo *nl_OuterKeyProj;
+	ProjectionInfo *nl_InnerKeyProj;
+	FmgrInfo   *nl_OuterHashFuncs;
+	ExprState  *nl_CrossEq;
+	TupleTableSlot *nl_HashInnerSlot;
+	List	   *nl_HashChain;
+	int			nl_HashPos;
 } NestLoopState;
 
 /* ----------------
@@ -2749,6 +2797,24 @@ typedef struct GatherMergeState
 	struct binaryheap *gm_heap; /* binary heap of slot indices */
 } GatherMergeState;
 
+/* ----------------
+ *	 RedistributeState information
+ *
+ *		Redistribute nodes route each input row to a partition chosen by
+ *		hashing its keys, and return whole partitions claimed by this
+ *		participant.  pstate is NULL if we are not running in parallel.
+ * ----------------
+ */
+typedef struct RedistributeState
+{
+	PlanState	ps;				/* its first field is NodeTag */
+	ExprState  *hashexpr;		/* computes the hash value of an input row */
+	struct ParallelRedistributeState *pstate;	/* shared state, or NULL */
+	struct SharedTuplestoreAccessor **accessors;	/* one per partition */
+	bool		partitioned;	/* have we written our input out yet? */
+	int			curpartition;	/* partition being read, or -1 */
+} RedistributeState;
+
 /* ----------------
  *	 Values displayed by EXPLAIN ANALYZE
  * ----------------
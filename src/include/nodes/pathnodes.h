@@ -128,6 +128,9 @@ typedef struct PlannerGlobal
 	/* "flat" list of AppendRelInfos */
 	List	   *appendRelations;
 
+	/* "flat" RT indexes of leaf partitions subject to initial pruning */
+	Bitmapset  *prunableRelids;
+
 	/* OIDs of relations the plan depends on */
 	List	   *relationOids;
 
@@ -944,6 +947,8 @@ typedef struct RelOptInfo
 	List	   *indexlist;
 	/* list of StatisticExtInfo */
 	List	   *statlist;
+	/* list of StatisticExtInfo for statistics on foreign key joins */
+	List	   *fkeystatlist;
 	/* size estimates derived from pg_class */
 	BlockNumber pages;
 	Cardinality tuples;
@@ -1227,6 +1232,8 @@ typedef struct ForeignKeyOptInfo
 	 * Basic data about the foreign key (fetched from catalogs):
 	 */
 
+	/* OID of the pg_constraint entry */
+	Oid			conoid;
 	/* RT index of the referencing table */
 	Index		con_relid;
 	/* RT index of the referenced table */
@@ -1290,6 +1297,9 @@ typedef struct StatisticExtInfo
 
 	/* expressions */
 	List	   *exprs;
+
+	/* foreign key the statistics follow, if they're on a join, else 0 */
+	Oid			fkey;
 } StatisticExtInfo;
 
 /*
@@ -2062,6 +2072,21 @@ typedef struct GatherMergePath
 	int			num_workers;	/* number of workers sought to help */
 } GatherMergePath;
 
+/*
+ * RedistributePath represents moving the rows of a partial path between the
+ * participants of a parallel query so that all rows whose hashkeys are equal
+ * (per hashoperators) end up in the same process.  The result is again a
+ * partial path.
+ */
+typedef struct RedistributePath
+{
+	Path		path;
+	Path	   *subpath;		/* path for each participant */
+	List	   *hashkeys;		/* expressions to hash */
+	List	   *hashoperators;	/* OIDs of their equality operators */
+	int			npartitions;	/* number of partitions to create */
+} RedistributePath;
+
 
 /*
  * All join-type paths share these fields.
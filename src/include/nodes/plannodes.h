@@ -65,6 +65,9 @@ typedef struct PlannedStmt
 
 	bool		parallelModeNeeded; /* parallel mode required to execute? */
 
+	bool		resultCacheable;	/* may the result be shared across
+									 * backends? */
+
 	int			jitFlags;		/* which forms of JIT should be performed */
 
 	struct Plan *planTree;		/* tree of Plan nodes */
@@ -79,6 +82,19 @@ typedef struct PlannedStmt
 
 	List	   *appendRelations;	/* list of AppendRelInfo nodes */
 
+	/*
+	 * rtable indexes of leaf partitions that initial pruning may remove; the
+	 * locks on those are only taken for the ones that survive it
+	 */
+	Bitmapset  *prunableRelids;
+
+	/*
+	 * the subset of prunableRelids that was pruned, and so not locked, when
+	 * plancache.c last revalidated this generic plan; NULL if not a generic
+	 * plan.  The executor leaves these out of its own initial pruning.
+	 */
+	Bitmapset  *prunedRelids;
+
 	List	   *subplans;		/* Plan trees for SubPlan expressions; note
 								 * that some could be NULL */
 
@@ -809,6 +825,13 @@ typedef struct NestLoop
 {
 	Join		join;
 	List	   *nestParams;		/* list of NestLoopParam nodes */
+
+	/*
+	 * hashable equality clauses from joinqual, outer side on the left, which
+	 * allow switching to hashing the inner side at runtime; NIL if the inner
+	 * side depends on the outer one
+	 */
+	List	   *hashclauses;
 } NestLoop;
 
 typedef struct NestLoopParam
@@ -1187,6 +1210,25 @@ typedef struct GatherMerge
 	Bitmapset  *initParam;
 } GatherMerge;
 
+/* ----------------
+ *		redistribute node
+ *
+ * A parallel-aware node that hashes hashkeys (evaluated over the outer
+ * plan's output) to send every row to one of npartitions partitions, and
+ * then hands out whole partitions to the participants.  hashoperators are
+ * the equality operators whose hash functions are used, and hashcollations
+ * the collations to hash with.
+ * ----------------
+ */
+typedef struct Redistribute
+{
+	Plan		plan;
+	List	   *hashkeys;		/* expressions to hash */
+	List	   *hashoperators;	/* OIDs of their equality operators */
+	List	   *hashcollations; /* OIDs of collations to hash with */
+	int			npartitions;	/* number of partitions to create */
+} Redistribute;
+
 /* ----------------
  *		hash build node
  *
@@ -1471,6 +1513,9 @@ typedef struct PartitionedRelPruneInfo
 	/* relation OID by partition index, or 0 */
 	Oid		   *relid_map pg_node_attr(array_size(nparts));
 
+	/* RT index of leaf partition by partition index, or 0 */
+	int		   *leafpart_rti_map pg_node_attr(array_size(nparts));
+
 	/*
 	 * initial_pruning_steps shows how to prune during executor startup (i.e.,
 	 * without use of any PARAM_EXEC Params); it is NIL if no startup pruning
@@ -103,6 +103,12 @@ extern GatherMergePath *create_gather_merge_path(PlannerInfo *root,
 												 List *pathkeys,
 												 Relids required_outer,
 												 double *rows);
+extern RedistributePath *create_redistribute_path(PlannerInfo *root,
+												  RelOptInfo *rel,
+												  Path *subpath,
+												  List *hashkeys,
+												  List *hashoperators,
+												  double numGroups);
 extern SubqueryScanPath *create_subqueryscan_path(PlannerInfo *root,
 												  RelOptInfo *rel,
 												  Path *subpath,
@@ -352,5 +358,14 @@ extern RelOptInfo *build_child_join_rel(PlannerInfo *root,
 										RelOptInfo *parent_joinrel, List *restrictlist,
 										SpecialJoinInfo *sjinfo,
 										int nappinfos, AppendRelInfo **appinfos);
+extern RelOptInfo *build_grouped_rel(PlannerInfo *root, RelOptInfo *rel,
+									 PathTarget *target, double rows);
+extern RelOptInfo *build_grouped_join_rel(PlannerInfo *root,
+										  RelOptInfo *joinrel,
+										  RelOptInfo *outer_rel,
+										  RelOptInfo *inner_rel,
+										  PathTarget *target,
+										  SpecialJoinInfo *sjinfo,
+										  List **restrictlist_ptr);
 
 #endif							/* PATHNODE_H */
@@ -20,8 +20,18 @@
 /*
  * allpaths.c
  */
+
+/* possible values for join_search_method */
+typedef enum
+{
+	JOIN_SEARCH_GEQO,			/* genetic query optimizer */
+	JOIN_SEARCH_IDP,			/* iterative dynamic programming */
+} JoinSearchMethod;
+
 extern PGDLLIMPORT bool enable_geqo;
 extern PGDLLIMPORT int geqo_threshold;
+extern PGDLLIMPORT int join_search_method;
+extern PGDLLIMPORT int idp_block_size;
 extern PGDLLIMPORT int min_parallel_table_scan_size;
 extern PGDLLIMPORT int min_parallel_index_scan_size;
 extern PGDLLIMPORT bool enable_group_by_reordering;
@@ -52,6 +62,8 @@ extern PGDLLIMPORT join_search_hook_type join_search_hook;
 extern RelOptInfo *make_one_rel(PlannerInfo *root, List *joinlist);
 extern RelOptInfo *standard_join_search(PlannerInfo *root, int levels_needed,
 										List *initial_rels);
+extern RelOptInfo *idp_join_search(PlannerInfo *root, int levels_needed,
+								   List *initial_rels);
 
 extern void generate_gather_paths(PlannerInfo *root, RelOptInfo *rel,
 								  bool override_rows);
@@ -101,6 +113,10 @@ extern void add_paths_to_joinrel(PlannerInfo *root, RelOptInfo *joinrel,
 extern void join_search_one_level(PlannerInfo *root, int level);
 extern RelOptInfo *make_join_rel(PlannerInfo *root,
 								 RelOptInfo *rel1, RelOptInfo *rel2);
+extern RelOptInfo *make_grouped_join_rel(PlannerInfo *root,
+										 RelOptInfo *joinrel,
+										 RelOptInfo *rel1, RelOptInfo *rel2,
+										 PathTarget *target);
 extern Relids add_outer_joins_to_relids(PlannerInfo *root, Relids input_relids,
 										SpecialJoinInfo *sjinfo,
 										List **pushed_down_joins);
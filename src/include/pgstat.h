@@ -267,7 +267,7 @@ typedef struct PgStat_TableXactStatus
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BCAF
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BCB0
 
 typedef struct PgStat_ArchiverStats
 {
@@ -420,6 +420,8 @@ typedef struct PgStat_SLRUStats
 	PgStat_Counter blocks_exists;
 	PgStat_Counter flush;
 	PgStat_Counter truncate;
+	PgStat_Counter xid_cache_hit;
+	PgStat_Counter xid_cache_miss;
 	TimestampTz stat_reset_timestamp;
 } PgStat_SLRUStats;
 
@@ -720,6 +722,8 @@ extern void pgstat_count_slru_page_written(int slru_idx);
 extern void pgstat_count_slru_page_exists(int slru_idx);
 extern void pgstat_count_slru_flush(int slru_idx);
 extern void pgstat_count_slru_truncate(int slru_idx);
+extern void pgstat_count_slru_xid_cache_hit(int slru_idx);
+extern void pgstat_count_slru_xid_cache_miss(int slru_idx);
 extern const char *pgstat_get_slru_name(int slru_idx);
 extern int	pgstat_get_slru_index(const char *name);
 extern PgStat_SLRUStats *pgstat_fetch_slru(void);
@@ -0,0 +1,48 @@
+/*-------------------------------------------------------------------------
+ *
+ * connproxy.h
+ *
+ * Header file for connection proxy processes, which multiplex client
+ * sessions onto pools of server backends.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/include/postmaster/connproxy.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef CONNPROXY_H
+#define CONNPROXY_H
+
+#include "libpq/libpq-be.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT int connection_proxies;
+extern PGDLLIMPORT int proxy_port;
+extern PGDLLIMPORT int session_pool_size;
+
+/*
+ * Secret shared between the postmaster's children, proving that a
+ * connection was opened by a connection proxy.  Empty if proxies are
+ * disabled.
+ */
+#define CONN_PROXY_SECRET_LEN	32
+extern PGDLLIMPORT char ConnProxySecret[CONN_PROXY_SECRET_LEN + 1];
+
+/* Startup packet option a proxy uses to pass on the client's address */
+#define CONN_PROXY_OPTION		"proxy_client"
+
+/* ParameterStatus name a backend uses to ask to stay with its client */
+#define CONN_PROXY_PINNED_PARAM	"proxy_session_pinned"
+
+extern Size ConnProxyShmemSize(void);
+extern void ConnProxyShmemInit(void);
+
+extern void ConnProxyRegister(void);
+extern void ConnProxyMain(Datum main_arg) pg_attribute_noreturn();
+
+extern void ProcessProxyClientOption(Port *port, const char *value);
+extern void ConnProxyCheckSessionState(void);
+
+#endif							/* CONNPROXY_H */
@@ -34,6 +34,12 @@ typedef struct LogicalRepRelMapEntry
 	bool		updatable;		/* Can apply updates/deletes? */
 	Oid			localindexoid;	/* which index to use, or InvalidOid if none */
 
+	/*
+	 * Can changes be applied concurrently with non-conflicting transactions?
+	 * See logicalrep_rel_mark_parallel_apply_safe().
+	 */
+	bool		parallel_apply_safe;
+
 	/* Sync state. */
 	char		state;
 	XLogRecPtr	statelsn;
@@ -44,6 +50,7 @@ extern void logicalrep_partmap_reset_relmap(LogicalRepRelation *remoterel);
 
 extern LogicalRepRelMapEntry *logicalrep_rel_open(LogicalRepRelId remoteid,
 												  LOCKMODE lockmode);
+extern LogicalRepRelMapEntry *logicalrep_rel_lookup(LogicalRepRelId remoteid);
 extern LogicalRepRelMapEntry *logicalrep_partition_open(LogicalRepRelMapEntry *root,
 														Relation partrel, AttrMap *map);
 extern void logicalrep_rel_close(LogicalRepRelMapEntry *rel,
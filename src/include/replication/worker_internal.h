@@ -180,6 +180,16 @@ typedef struct ParallelApplyWorkerShared
 	 */
 	PartialFileSetState fileset_state;
 	FileSet		fileset;
+
+	/*
+	 * For a non-streamed transaction, the remote transaction that has to be
+	 * committed before this one, and the end LSN of its commit record on the
+	 * publisher.  The parallel apply worker waits for it before committing.
+	 * Invalid when there is no such transaction, and for streamed
+	 * transactions, where the leader maintains the commit order.
+	 */
+	TransactionId preceding_xid;
+	XLogRecPtr	preceding_end_lsn;
 } ParallelApplyWorkerShared;
 
 /*
@@ -214,6 +224,12 @@ typedef struct ParallelApplyWorkerInfo
 	 */
 	bool		in_use;
 
+	/*
+	 * Number of RELATION messages remembered by the leader that have already
+	 * been sent to the worker, see pa_send_relation_messages().
+	 */
+	uint64		relation_msgs_sent;
+
 	ParallelApplyWorkerShared *shared;
 } ParallelApplyWorkerInfo;
 
@@ -326,6 +342,13 @@ extern void pa_decr_and_wait_stream_block(void);
 extern void pa_xact_finish(ParallelApplyWorkerInfo *winfo,
 						   XLogRecPtr remote_lsn);
 
+extern bool pa_handle_nonstreamed_message(StringInfo s);
+extern void pa_remember_relation_message(LogicalRepRelId remoteid,
+										 const char *data, int len);
+extern void pa_process_dispatched_xacts(bool wait);
+extern bool pa_have_dispatched_xacts(void);
+extern void pa_wait_for_preceding_xact(void);
+
 #define isParallelApplyWorker(worker) ((worker)->in_use && \
 									   (worker)->type == WORKERTYPE_PARALLEL_APPLY)
 #define isTablesyncWorker(worker) ((worker)->in_use && \
@@ -126,5 +126,9 @@ extern StatisticExtInfo *choose_best_statistics(List *stats, char requiredkind,
 												List **clause_exprs,
 												int nclauses);
 extern HeapTuple statext_expressions_load(Oid stxoid, bool inh, int idx);
+extern Selectivity statext_fkey_join_correction(PlannerInfo *root,
+												RelOptInfo *ref_rel,
+												Index con_relid,
+												Oid conoid);
 
 #endif							/* STATISTICS_H */
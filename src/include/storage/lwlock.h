@@ -215,6 +215,18 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_SUBTRANS_SLRU,
 	LWTRANCHE_XACT_SLRU,
 	LWTRANCHE_PARALLEL_VACUUM_DSA,
+	LWTRANCHE_CSNLOG_BUFFER,
+	LWTRANCHE_CSNLOG_SLRU,
+	LWTRANCHE_SHARED_PLAN_CACHE,
+	LWTRANCHE_SHARED_PLAN_CACHE_DSA,
+	LWTRANCHE_SHARED_PLAN_CACHE_HASH,
+	LWTRANCHE_SHARED_CATCACHE,
+	LWTRANCHE_SHARED_CATCACHE_DSA,
+	LWTRANCHE_SHARED_CATCACHE_HASH,
+	LWTRANCHE_SHARED_RESULT_CACHE,
+	LWTRANCHE_SHARED_RESULT_CACHE_DSA,
+	LWTRANCHE_SHARED_RESULT_CACHE_HASH,
+	LWTRANCHE_SHARED_RESULT_CACHE_WRITERS,
 	LWTRANCHE_FIRST_USER_DEFINED,
 }			BuiltinTrancheIds;
 
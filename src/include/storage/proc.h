@@ -66,6 +66,8 @@ struct XidCache
 #define		PROC_AFFECTS_ALL_HORIZONS	0x20	/* this proc's xmin must be
 												 * included in vacuum horizons
 												 * in all databases */
+#define		PROC_IN_BACKEND_POOL	0x40	/* pooled backend waiting for a
+											 * client */
 
 /* flags reset at EOXact */
 #define		PROC_VACUUM_STATE_MASK \
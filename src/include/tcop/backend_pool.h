@@ -0,0 +1,44 @@
+/*-------------------------------------------------------------------------
+ *
+ * backend_pool.h
+ *	  Pools of pre-initialized backends waiting for client connections.
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ *
+ * src/include/tcop/backend_pool.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BACKEND_POOL_H
+#define BACKEND_POOL_H
+
+#include "libpq/libpq-be.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT char *backend_pool_databases;
+extern PGDLLIMPORT int backend_pool_size;
+
+/* Is this backend one that was started ahead of its client? */
+extern PGDLLIMPORT bool am_pooled_backend;
+
+/* Seconds to wait before replacing a pooled backend that failed */
+#define BACKEND_POOL_RESTART_DELAY	5
+
+extern Size BackendPoolShmemSize(void);
+extern void BackendPoolShmemInit(void);
+
+/* Functions called by the postmaster */
+extern void BackendPoolInit(void);
+extern int	BackendPoolNumDatabases(void);
+extern void BackendPoolPrepareChild(int child_slot);
+extern bool BackendPoolChildClaimed(int child_slot);
+extern void BackendPoolCloseSockets(void);
+
+/* Functions called in backends */
+extern void BackendPoolBackendInit(int pool);
+extern const char *BackendPoolDatabaseName(void);
+extern bool BackendPoolHandOff(Port *port);
+extern void BackendPoolWaitForClient(void);
+
+#endif							/* BACKEND_POOL_H */
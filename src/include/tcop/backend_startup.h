@@ -14,6 +14,8 @@
 #ifndef BACKEND_STARTUP_H
 #define BACKEND_STARTUP_H
 
+#include "datatype/timestamp.h"
+
 /* GUCs */
 extern PGDLLIMPORT bool Trace_connection_negotiation;
 
@@ -37,8 +39,33 @@ typedef enum CAC_state
 typedef struct BackendStartupData
 {
 	CAC_state	canAcceptConnections;
+
+	/* Backend pool to join, or -1 for a backend serving a new connection */
+	int			backend_pool;
+
+	/* When the postmaster started forking this process, if it had a client */
+	TimestampTz fork_started;
 } BackendStartupData;
 
+/*
+ * Times at which a connection went through the phases of its setup, for
+ * log_connections.  A connection that was handed over to a pooled backend
+ * also has a handoff_ended time, when the pooled backend received it.
+ */
+typedef struct ConnectionTiming
+{
+	TimestampTz fork_started;
+	TimestampTz fork_ended;
+	TimestampTz startup_ended;
+	TimestampTz handoff_ended;
+	TimestampTz auth_started;
+	TimestampTz auth_ended;
+	bool		ready_for_use;	/* reported already? */
+} ConnectionTiming;
+
+extern PGDLLIMPORT ConnectionTiming conn_timing;
+
 extern void BackendMain(char *startup_data, size_t startup_data_len) pg_attribute_noreturn();
+extern void LogConnectionSetupTimes(void);
 
 #endif							/* BACKEND_STARTUP_H */
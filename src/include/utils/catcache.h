@@ -23,6 +23,7 @@
 #include "access/htup.h"
 #include "access/skey.h"
 #include "lib/ilist.h"
+#include "utils/dsa.h"
 #include "utils/relcache.h"
 
 /*
@@ -132,7 +133,18 @@ typedef struct catctup
 	struct catclist *c_list;	/* containing CatCList, or NULL if none */
 
 	CatCache   *my_cache;		/* link to owning catcache */
-	/* properly aligned tuple data follows, unless a negative entry */
+
+	/*
+	 * If the tuple lives in the shared catalog cache, this is our reference
+	 * to it and tuple.t_data points into shared memory.  Otherwise it is
+	 * InvalidDsaPointer.
+	 */
+	dsa_pointer shared_tuple;
+
+	/*
+	 * properly aligned tuple data follows, unless a negative entry or a
+	 * shared tuple
+	 */
 } CatCTup;
 
 
@@ -32,6 +32,8 @@ extern void AtEOSubXact_Inval(bool isCommit);
 
 extern void PostPrepare_Inval(void);
 
+extern bool TransactionHasInvalidations(void);
+
 extern void CommandEndInvalidationMessages(void);
 
 extern void CacheInvalidateHeapTuple(Relation relation,
@@ -303,6 +303,7 @@ typedef struct PgStat_KindInfo
  * definitions.
  */
 static const char *const slru_names[] = {
+	"commit_sequence",
 	"commit_timestamp",
 	"multixact_member",
 	"multixact_offset",
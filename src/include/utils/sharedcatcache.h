@@ -0,0 +1,41 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.h
+ *	  Catalog cache tuples shared across backends.
+ *
+ * See sharedcatcache.c for comments.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedcatcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDCATCACHE_H
+#define SHAREDCATCACHE_H
+
+#include "access/htup.h"
+#include "storage/sinval.h"
+#include "utils/dsa.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT bool shared_catalog_cache;
+extern PGDLLIMPORT int shared_catalog_cache_size;
+
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+
+extern bool SharedCatCacheUsable(void);
+extern uint64 SharedCatCacheBeginLoad(void);
+extern bool SharedCatCacheLookup(Oid dbid, int cacheid, uint32 hashvalue,
+								 HeapTuple tuple, dsa_pointer *ref);
+extern bool SharedCatCacheInsert(Oid dbid, int cacheid, uint32 hashvalue,
+								 uint64 loadseq, HeapTuple src,
+								 HeapTuple tuple, dsa_pointer *ref);
+extern void SharedCatCacheRelease(dsa_pointer ref);
+
+extern void SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs,
+									 int n);
+
+#endif							/* SHAREDCATCACHE_H */
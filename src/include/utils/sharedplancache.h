@@ -0,0 +1,66 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Generic plans shared across backends.
+ *
+ * See sharedplancache.c for comments.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "storage/sinval.h"
+#include "utils/plancache.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT bool shared_plan_cache;
+extern PGDLLIMPORT int shared_plan_cache_size;
+
+/*
+ * Hash table key for a shared plan.  query_hash covers the query text and
+ * everything else that could make parse analysis or planning come out
+ * differently; the full text is kept in the entry to detect collisions.
+ */
+typedef struct SharedPlanKey
+{
+	Oid			dbid;
+	Oid			userid;
+	uint64		query_hash;
+} SharedPlanKey;
+
+/*
+ * State carried from SharedPlanCacheLookup to SharedPlanCacheRecheck or
+ * SharedPlanCacheStore.
+ */
+typedef struct SharedPlanCacheProbe
+{
+	SharedPlanKey key;
+	char	   *keytext;		/* palloc'd, not NUL-terminated */
+	Size		keylen;
+	uint64		planseq;		/* invalidation sequence when planning began */
+	uint32	   *deps;			/* dependency slots of a plan that was found */
+	int			ndeps;
+} SharedPlanCacheProbe;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+
+extern bool SharedPlanCacheEligible(CachedPlanSource *plansource,
+									QueryEnvironment *queryEnv);
+extern List *SharedPlanCacheLookup(CachedPlanSource *plansource,
+								   SharedPlanCacheProbe *probe);
+extern bool SharedPlanCacheRecheck(SharedPlanCacheProbe *probe);
+extern void SharedPlanCacheStore(SharedPlanCacheProbe *probe,
+								 CachedPlanSource *plansource,
+								 List *stmt_list);
+
+extern void SharedPlanCacheInvalidate(const SharedInvalidationMessage *msgs,
+									  int n);
+
+#endif							/* SHAREDPLANCACHE_H */
@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedresultcache.h
+ *	  Query results shared across backends.
+ *
+ * See sharedresultcache.c for comments.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedresultcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDRESULTCACHE_H
+#define SHAREDRESULTCACHE_H
+
+#include "access/sdir.h"
+#include "executor/execdesc.h"
+#include "lib/stringinfo.h"
+#include "nodes/parsenodes.h"
+#include "storage/sinval.h"
+#include "utils/relcache.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT bool shared_result_cache;
+extern PGDLLIMPORT int shared_result_cache_size;
+extern PGDLLIMPORT int shared_result_cache_max_entry_size;
+
+/*
+ * Hash table key for a shared result.  query_hash covers the statement text,
+ * the parameter values and the settings that could make parse analysis come
+ * out differently; the full text is kept in the entry to detect collisions.
+ */
+typedef struct SharedResultKey
+{
+	Oid			dbid;
+	Oid			userid;
+	uint64		query_id;
+	uint64		query_hash;
+} SharedResultKey;
+
+/*
+ * State carried from SharedResultCacheLookup through the execution of a
+ * query.  On a hit, tuples holds the cached result; on a miss, it collects
+ * the result as it is sent, for SharedResultCacheStore.
+ */
+typedef struct SharedResultCacheProbe
+{
+	SharedResultKey key;
+	char	   *keytext;		/* palloc'd, not NUL-terminated */
+	Size		keylen;
+	uint32	   *deps;			/* invalidation slots of the query */
+	int			ndeps;
+	uint64		seq;			/* invalidation sequence when execution began */
+	bool		hit;			/* found a usable result? */
+	bool		capturing;		/* still collecting the result? */
+	int			natts;
+	StringInfoData tuples;		/* MAXALIGN'd MinimalTuples */
+	uint64		ntuples;
+	MemoryContext cxt;			/* context holding tuples */
+} SharedResultCacheProbe;
+
+extern Size SharedResultCacheShmemSize(void);
+extern void SharedResultCacheShmemInit(void);
+
+extern bool SharedResultCacheQueryIsCacheable(Query *parse);
+extern SharedResultCacheProbe *SharedResultCacheLookup(QueryDesc *queryDesc,
+													   ScanDirection direction,
+													   uint64 count);
+extern void SharedResultCacheSendTuples(SharedResultCacheProbe *probe,
+										QueryDesc *queryDesc,
+										DestReceiver *dest);
+extern DestReceiver *SharedResultCacheCaptureReceiver(SharedResultCacheProbe *probe,
+													  DestReceiver *dest);
+extern void SharedResultCacheStore(SharedResultCacheProbe *probe);
+
+extern void SharedResultCacheNoteWrite(Relation rel);
+extern void SharedResultCacheInvalidate(const SharedInvalidationMessage *msgs,
+										int n);
+
+#endif							/* SHAREDRESULTCACHE_H */
@@ -14,6 +14,7 @@
 #define SNAPSHOT_H
 
 #include "access/htup.h"
+#include "access/transam.h"
 #include "access/xlogdefs.h"
 #include "datatype/timestamp.h"
 #include "lib/pairingheap.h"
@@ -214,6 +215,14 @@ typedef struct SnapshotData
 	 * transactions completed since the last GetSnapshotData().
 	 */
 	uint64		snapXactCompletionCount;
+
+	/*
+	 * For MVCC snapshots taken with csn_snapshots enabled, the first commit
+	 * sequence number that is invisible to the snapshot.  When valid, xip and
+	 * subxip are unused: XIDs between xmin and xmax are instead checked
+	 * against the CSN log.
+	 */
+	CommitSeqNo snapshotcsn;
 } SnapshotData;
 
 #endif							/* SNAPSHOT_H */
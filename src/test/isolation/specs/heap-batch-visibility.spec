@@ -0,0 +1,63 @@
+# Page-at-a-time visibility checks
+#
+# Sequential scans decide the visibility of all tuples on a page that is not
+# all-visible at once, with HeapTupleSatisfiesMVCCBatch().  Check that they
+# see the same rows as a TID scan, which checks each tuple on its own, with
+# in-progress, aborted, committed and frozen inserters and deleters, and with
+# HOT chains that a concurrent snapshot still needs the old versions of.
+
+setup
+{
+  CREATE TABLE batchvis (id int, val int)
+    WITH (autovacuum_enabled = off, fillfactor = 50);
+  INSERT INTO batchvis SELECT g, 0 FROM generate_series(1, 5) g;
+
+  CREATE FUNCTION batchvis_tidscan() RETURNS text STABLE
+    SET enable_seqscan = off LANGUAGE sql AS
+  $$
+    SELECT string_agg(id || ':' || val, ' ' ORDER BY id) FROM batchvis
+      WHERE ctid = ANY (ARRAY(SELECT format('(0,%s)', i)::tid
+                              FROM generate_series(1, 50) i))
+  $$;
+
+  CREATE VIEW batchvis_check AS
+    SELECT (SELECT string_agg(id || ':' || val, ' ' ORDER BY id)
+              FROM batchvis) AS seqscan,
+           batchvis_tidscan() AS tidscan;
+}
+
+teardown
+{
+  DROP VIEW batchvis_check;
+  DROP FUNCTION batchvis_tidscan();
+  DROP TABLE batchvis;
+}
+
+session s1
+step s1_begin_rr	{ BEGIN ISOLATION LEVEL REPEATABLE READ; }
+step s1_check		{ SELECT * FROM batchvis_check; }
+step s1_commit		{ COMMIT; }
+
+session s2
+step s2_begin		{ BEGIN; }
+step s2_modify		{ INSERT INTO batchvis VALUES (6, 0); DELETE FROM batchvis WHERE id = 1; UPDATE batchvis SET val = 1 WHERE id = 2; }
+step s2_check		{ SELECT * FROM batchvis_check; }
+step s2_update		{ UPDATE batchvis SET val = val + 1 WHERE id IN (3, 4); }
+step s2_delete		{ DELETE FROM batchvis WHERE id = 5; }
+step s2_commit		{ COMMIT; }
+step s2_rollback	{ ROLLBACK; }
+
+session s3
+step s3_freeze		{ VACUUM (FREEZE) batchvis; }
+step s3_check		{ SELECT * FROM batchvis_check; }
+
+# In-progress inserter and deleters, seen by another transaction and by the
+# modifying one itself, then aborted
+permutation s1_check s2_begin s2_modify s2_check s1_check s2_rollback s1_check
+
+# HOT updates and a delete committed after a concurrent snapshot was taken
+permutation s1_begin_rr s1_check s2_update s2_delete s1_check s3_check s1_commit s1_check
+
+# Frozen tuples, first on an all-visible page, then on one that is no longer
+# all-visible because of in-progress and committed changes
+permutation s3_freeze s1_check s2_begin s2_modify s1_check s2_commit s1_check
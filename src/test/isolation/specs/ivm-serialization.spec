@@ -0,0 +1,39 @@
+# Test that a transaction using a single snapshot doesn't maintain an
+# incrementally maintained materialized view based on an outdated view.
+#
+# Such a transaction must fail if another transaction changed the view after
+# its snapshot was taken, whether or not it had to wait for that transaction
+# to finish.
+
+setup
+{
+  CREATE TABLE ivm_base (i int, j int);
+  INSERT INTO ivm_base VALUES (1, 10), (2, 20);
+  CREATE INCREMENTAL MATERIALIZED VIEW ivm_sum AS
+    SELECT i, count(*) AS n, sum(j) AS s FROM ivm_base GROUP BY i;
+}
+
+teardown
+{
+  DROP MATERIALIZED VIEW ivm_sum;
+  DROP TABLE ivm_base;
+}
+
+session s1
+step s1_begin  { BEGIN ISOLATION LEVEL REPEATABLE READ; }
+step s1_read   { SELECT i, n, s FROM ivm_sum ORDER BY i; }
+step s1_insert { INSERT INTO ivm_base VALUES (1, 100); }
+step s1_commit { COMMIT; }
+
+session s2
+step s2_begin  { BEGIN ISOLATION LEVEL REPEATABLE READ; }
+step s2_insert { INSERT INTO ivm_base VALUES (1, 5); }
+step s2_commit { COMMIT; }
+step s2_read   { SELECT i, n, s FROM ivm_sum ORDER BY i; }
+
+# s2 changed the view after s1's snapshot was taken, but s1 doesn't wait
+permutation s1_begin s1_read s2_insert s1_insert s1_commit s2_read
+# s2 changed the view before s1's snapshot was taken
+permutation s1_begin s2_insert s1_read s1_insert s1_commit s2_read
+# s1 changes the view first, and s2 has to wait for it
+permutation s1_begin s1_read s1_insert s2_begin s2_insert s1_commit s2_commit s2_read
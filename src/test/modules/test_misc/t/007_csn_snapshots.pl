@@ -0,0 +1,106 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test MVCC visibility with snapshots built from commit sequence numbers
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+csn_snapshots = on
+max_prepared_transactions = 5
+));
+$node->start;
+
+$node->safe_psql('postgres',
+	"CREATE TABLE csn_test (id int PRIMARY KEY, val int)");
+
+# An open transaction's changes are invisible to others until it commits,
+# and a repeatable read snapshot keeps not seeing them afterwards.
+my $writer = $node->background_psql('postgres');
+my $reader = $node->background_psql('postgres');
+
+$writer->query_safe(
+	"BEGIN; INSERT INTO csn_test VALUES (1, 1); SAVEPOINT s; INSERT INTO csn_test VALUES (2, 2);"
+);
+$reader->query_safe(
+	"BEGIN ISOLATION LEVEL REPEATABLE READ; SELECT 1;");
+
+is($reader->query_safe("SELECT count(*) FROM csn_test"),
+	'0', 'uncommitted rows are invisible');
+like(
+	$node->safe_psql('postgres', "SELECT pg_current_snapshot()"),
+	qr/^\d+:\d+:\d+$/,
+	'running transaction is listed in pg_current_snapshot()');
+
+$writer->query_safe("COMMIT");
+
+is($reader->query_safe("SELECT count(*) FROM csn_test"),
+	'0', 'rows committed after the snapshot was taken are invisible');
+$reader->query_safe("COMMIT");
+is($reader->query_safe("SELECT count(*) FROM csn_test"),
+	'2', 'committed rows, including subtransactions, are visible');
+
+# Aborted subtransactions and transactions stay invisible.
+$writer->query_safe(
+	"BEGIN; INSERT INTO csn_test VALUES (3, 3); SAVEPOINT s; INSERT INTO csn_test VALUES (4, 4); ROLLBACK TO s; COMMIT;"
+);
+$writer->query_safe(
+	"BEGIN; INSERT INTO csn_test VALUES (5, 5); ROLLBACK;");
+is($reader->query_safe("SELECT string_agg(id::text, ',' ORDER BY id) FROM csn_test"),
+	'1,2,3', 'aborted changes are invisible');
+
+# Prepared transactions become visible when committed, also across a
+# restart.
+$node->safe_psql('postgres',
+	"BEGIN; INSERT INTO csn_test VALUES (6, 6); PREPARE TRANSACTION 'p1';");
+$node->safe_psql('postgres',
+	"BEGIN; INSERT INTO csn_test VALUES (7, 7); PREPARE TRANSACTION 'p2';");
+$node->safe_psql('postgres', "COMMIT PREPARED 'p1'");
+is($node->safe_psql('postgres', "SELECT count(*) FROM csn_test"),
+	'4', 'committed prepared transaction is visible');
+
+$writer->quit;
+$reader->quit;
+$node->restart;
+
+is($node->safe_psql('postgres', "SELECT count(*) FROM csn_test"),
+	'4', 'rows committed before restart are visible');
+$node->safe_psql('postgres', "COMMIT PREPARED 'p2'");
+is($node->safe_psql('postgres', "SELECT count(*) FROM csn_test"),
+	'5', 'prepared transaction committed after restart is visible');
+
+# Concurrent transfers between accounts must neither lose nor duplicate
+# updates.
+$node->safe_psql('postgres',
+	"CREATE TABLE csn_accounts AS SELECT g AS id, 100 AS balance FROM generate_series(1, 10) g"
+);
+$node->pgbench(
+	'--no-vacuum --client=5 --transactions=200',
+	0,
+	[qr{processed: 1000/1000}],
+	[qr{^$}],
+	'concurrent transfers',
+	{
+		'001_csn_transfer' => q{
+		\set a random(1, 10)
+		\set b random(1, 10)
+		BEGIN;
+		UPDATE csn_accounts
+		  SET balance = balance + (id = :b)::int - (id = :a)::int
+		  WHERE id IN (:a, :b);
+		SELECT sum(balance) FROM csn_accounts;
+		COMMIT;
+	}
+	});
+is($node->safe_psql('postgres', "SELECT count(*), sum(balance) FROM csn_accounts"),
+	'10|1000', 'transfers preserved the total');
+
+$node->stop;
+
+done_testing();
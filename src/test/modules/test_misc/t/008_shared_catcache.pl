@@ -0,0 +1,83 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test that sessions sharing catalog cache entries see catalog changes
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_catalog_cache = on
+shared_catalog_cache_size = 8MB
+));
+$node->start;
+
+$node->safe_psql('postgres',
+	"CREATE TABLE scc_test (a int, b text); INSERT INTO scc_test VALUES (1, 'one')"
+);
+
+# Load the table's catalog entries in one session, then use them from another
+my $s1 = $node->background_psql('postgres');
+my $s2 = $node->background_psql('postgres');
+
+is($s1->query_safe("SELECT b FROM scc_test"), 'one', 'first session');
+is($s2->query_safe("SELECT b FROM scc_test"), 'one', 'second session');
+is( $s2->query_safe(
+		"SELECT count(*) > 0 FROM pg_backend_memory_contexts WHERE name = 'SharedCatCacheHandles'"
+	),
+	't',
+	'second session uses shared catalog cache entries');
+
+# Changes committed by one session are seen by the others
+$s1->query_safe("ALTER TABLE scc_test RENAME COLUMN b TO c");
+is($s2->query_safe("SELECT c FROM scc_test"),
+	'one', 'renamed column is visible in another session');
+is($node->safe_psql('postgres', "SELECT c FROM scc_test"),
+	'one', 'renamed column is visible in a new session');
+
+# A transaction's own uncommitted changes are not visible to others
+$s1->query_safe("BEGIN; ALTER TABLE scc_test RENAME TO scc_renamed");
+is($s1->query_safe("SELECT c FROM scc_renamed"),
+	'one', 'uncommitted rename is visible in its own session');
+is($s2->query_safe("SELECT count(*) FROM pg_class WHERE relname = 'scc_test'"),
+	'1', 'uncommitted rename is invisible to others');
+$s1->query_safe("ROLLBACK");
+is($s2->query_safe("SELECT c FROM scc_test"),
+	'one', 'rolled back rename left the table in place');
+
+# Dropped objects disappear everywhere
+$s1->query_safe("CREATE FUNCTION scc_func() RETURNS int LANGUAGE sql AS 'SELECT 1'");
+is($s2->query_safe("SELECT scc_func()"), '1', 'function visible');
+$s1->query_safe("DROP FUNCTION scc_func()");
+my ($ret, $stdout, $stderr) =
+  $node->psql('postgres', "SELECT scc_func()");
+isnt($ret, 0, 'dropped function is gone in a new session');
+
+$s1->quit;
+$s2->quit;
+
+# Many relations, read by several sessions
+$node->safe_psql('postgres',
+	"DO \$\$ BEGIN FOR i IN 1..200 LOOP EXECUTE format('CREATE TABLE scc_part_%s (a int)', i); END LOOP; END \$\$"
+);
+$node->pgbench(
+	'--no-vacuum --client=4 --transactions=50',
+	0,
+	[qr{processed: 200/200}],
+	[qr{^$}],
+	'concurrent catalog lookups',
+	{
+		'001_scc_lookup' => q{
+		\set i random(1, 200)
+		SELECT count(*) FROM scc_part_:i;
+	}
+	});
+
+$node->stop;
+
+done_testing();
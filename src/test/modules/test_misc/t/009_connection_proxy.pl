@@ -0,0 +1,156 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test sessions multiplexed onto pooled backends by connection proxies
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+my $proxy_port = PostgreSQL::Test::Cluster::get_free_port();
+$node->append_conf(
+	'postgresql.conf', qq(
+connection_proxies = 2
+proxy_port = $proxy_port
+session_pool_size = 2
+));
+$node->start;
+
+my $proxy_connstr = $node->connstr('postgres') . " port=$proxy_port";
+
+$node->poll_query_until('postgres',
+	"SELECT count(*) = 2 FROM pg_stat_connection_proxies")
+  or die "timed out waiting for connection proxies to start";
+
+$node->safe_psql('postgres', "CREATE TABLE proxy_test (a int)");
+
+# Many clients sharing a few backends
+$node->pgbench(
+	"--no-vacuum --client=40 --transactions=20 --port=$proxy_port",
+	0,
+	[qr{processed: 800/800}],
+	[qr{^$}],
+	'transactions through connection proxies',
+	{
+		'001_proxy_txn' => q{
+		BEGIN;
+		INSERT INTO proxy_test VALUES (1);
+		SELECT count(*) FROM proxy_test;
+		END;
+	}
+	});
+is($node->safe_psql('postgres', "SELECT count(*) FROM proxy_test"),
+	'800', 'all transactions committed');
+is( $node->safe_psql(
+		'postgres',
+		"SELECT sum(backends) <= 4, sum(transactions) >= 800 FROM pg_stat_connection_proxies"
+	),
+	't|t',
+	'proxies used at most session_pool_size backends each');
+
+# The proxies' backends run as the authenticated user
+is( $node->safe_psql(
+		'postgres', "SELECT current_user = session_user",
+		connstr => $proxy_connstr),
+	't',
+	'query through proxy');
+
+# A session with temporary tables keeps its backend
+my $s1 = $node->background_psql('postgres', connstr => $proxy_connstr);
+my $s2 = $node->background_psql('postgres', connstr => $proxy_connstr);
+$s1->query_safe("CREATE TEMP TABLE proxy_tmp AS SELECT 42 AS a");
+my $pid = $s1->query_safe("SELECT pg_backend_pid()");
+for my $i (1 .. 5)
+{
+	$s2->query_safe("SELECT count(*) FROM proxy_test");
+	is($s1->query_safe("SELECT a FROM proxy_tmp"),
+		'42', "temporary table visible in transaction $i");
+}
+is($s1->query_safe("SELECT pg_backend_pid()"),
+	$pid, 'pinned session kept its backend');
+is( $node->safe_psql(
+		'postgres', "SELECT sum(pinned_clients) FROM pg_stat_connection_proxies"
+	),
+	'1',
+	'pinned session reported');
+
+# So does a session that changed a parameter
+$s2->query_safe("SET work_mem = '17MB'");
+$s1->query_safe("SELECT 1");
+is($s2->query_safe("SHOW work_mem"), '17MB', 'SET kept across transactions');
+
+$s1->quit;
+$s2->quit;
+
+# Replication connections are refused
+$node->connect_fails(
+	"$proxy_connstr replication=database",
+	'replication connection through proxy',
+	expected_stderr =>
+	  qr/replication connections are not supported by connection proxies/);
+
+# Tens of thousands of idle clients, the case the proxies are meant for, are
+# only tested on request, since pgbench and the proxies need a file descriptor
+# for each client.  The clients sleep between short transactions.  The number
+# of backends serving them and the latency of their statements go to the test
+# log.
+SKIP:
+{
+	skip "test connection_proxy_scale not enabled in PG_TEST_EXTRA", 5
+	  if (!$ENV{PG_TEST_EXTRA}
+		|| $ENV{PG_TEST_EXTRA} !~ /\bconnection_proxy_scale\b/);
+
+	my $nclients = 10000;
+	my $script = PostgreSQL::Test::Utils::tempdir() . '/idle_client.sql';
+	append_to_file(
+		$script, q{
+BEGIN;
+INSERT INTO proxy_test VALUES (1);
+END;
+\sleep 2 s
+});
+
+	$node->safe_psql('postgres', "TRUNCATE proxy_test");
+
+	my ($stdout, $stderr);
+	my $pgbench = IPC::Run::start(
+		[
+			'pgbench', '--no-vacuum',
+			'--report-per-command', "--client=$nclients",
+			'--jobs=20', '--transactions=5',
+			'--file' => $script, '--host' => $node->host,
+			'--port' => $proxy_port, 'postgres'
+		],
+		'>' => \$stdout,
+		'2>' => \$stderr);
+
+	# pgbench connects all its clients before it starts running transactions
+	$node->poll_query_until('postgres',
+		"SELECT sum(clients) = $nclients FROM pg_stat_connection_proxies")
+	  or die "timed out waiting for $nclients clients to connect";
+	my $backends = $node->safe_psql('postgres',
+		"SELECT count(*) FROM pg_stat_activity WHERE backend_type = 'client backend' AND pid <> pg_backend_pid()"
+	);
+	note "backends serving $nclients clients: $backends";
+	cmp_ok($backends, '<=', 4,
+		'idle clients used at most session_pool_size backends per proxy');
+
+	$pgbench->finish;
+	is($pgbench->result, 0, 'pgbench with idle clients exited cleanly');
+	like($stdout, qr{processed: 50000/50000},
+		'all transactions of idle clients processed');
+	like(
+		$stdout,
+		qr{^\s+[\d.]+\s+0\s+INSERT INTO proxy_test}m,
+		'latency of idle clients\' statements reported');
+	note "pgbench output:\n$stdout";
+	is($node->safe_psql('postgres', "SELECT count(*) FROM proxy_test"),
+		'50000', 'all transactions of idle clients committed');
+}
+
+$node->stop;
+
+done_testing();
@@ -0,0 +1,78 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test connections handed over to pools of pre-initialized backends
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', q(
+backend_pool_databases = 'postgres, pooldb'
+backend_pool_size = 2
+log_connections = on
+));
+$node->start;
+
+if ($node->log_contains('backend pools are not supported by this build'))
+{
+	plan skip_all => 'backend pools not supported by this build';
+}
+
+$node->poll_query_until('postgres',
+	"SELECT idle = 2 FROM pg_stat_backend_pool WHERE database = 'postgres'")
+  or die "timed out waiting for the backend pool to fill";
+
+# A new connection is served by a pooled backend, and logs its setup times
+my $log_offset = -s $node->logfile;
+is($node->safe_psql('postgres', "SELECT current_user = session_user"),
+	't', 'query in a pooled backend');
+$node->wait_for_log(qr/connection ready: setup total=.*handoff=/,
+	$log_offset);
+ok( $node->safe_psql(
+		'postgres',
+		"SELECT handoffs >= 1 FROM pg_stat_backend_pool WHERE database = 'postgres'"
+	),
+	'handoff counted');
+
+# The pool gets filled again
+$node->poll_query_until('postgres',
+	"SELECT idle = 2 FROM pg_stat_backend_pool WHERE database = 'postgres'")
+  or die "timed out waiting for the backend pool to refill";
+
+# Many connections in a row, some of which will find the pool empty
+$node->pgbench(
+	'--no-vacuum --connect --client=4 --transactions=20',
+	0,
+	[qr{processed: 80/80}],
+	[qr{^$}],
+	'new connection per transaction',
+	{
+		'001_pool_connect' => q{
+		SELECT current_database();
+	}
+	});
+
+# A database that doesn't exist yet gets its pool once it does, and dropping
+# it gets rid of the pool's backends
+$node->safe_psql('postgres', "CREATE DATABASE pooldb");
+$node->poll_query_until('postgres',
+	"SELECT idle = 2 FROM pg_stat_backend_pool WHERE database = 'pooldb'")
+  or die "timed out waiting for the backend pool of the new database";
+is($node->safe_psql('pooldb', "SELECT current_database()"),
+	'pooldb', 'connection to new database');
+$node->safe_psql('postgres', "DROP DATABASE pooldb");
+is( $node->safe_psql(
+		'postgres', "SELECT count(*) FROM pg_database WHERE datname = 'pooldb'"),
+	'0',
+	'database with a pool dropped');
+
+# Pooled backends don't hold up a smart shutdown
+$node->stop('smart');
+ok(1, 'smart shutdown with pooled backends');
+
+done_testing();
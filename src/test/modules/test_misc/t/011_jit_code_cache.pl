@@ -0,0 +1,82 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test reuse of JIT-compiled code by later queries and other sessions
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+jit = on
+jit_provider = 'llvmjit'
+jit_above_cost = 0
+jit_inline_above_cost = -1
+jit_optimize_above_cost = 0
+jit_code_cache_size = 2
+));
+$node->start;
+
+if ($node->safe_psql('postgres', "SELECT pg_jit_available()") ne 't')
+{
+	plan skip_all => 'llvmjit not supported by this build';
+}
+
+$node->safe_psql('postgres',
+	"CREATE TABLE jcc_test AS SELECT i AS a, i % 10 AS b FROM generate_series(1, 1000) i"
+);
+
+my $query = "SELECT b, sum(a) FROM jcc_test WHERE a > \$1 GROUP BY b ORDER BY b";
+my $adhoc = "SELECT b, sum(a) FROM jcc_test WHERE a > 100 GROUP BY b";
+my $explain = "EXPLAIN (ANALYZE, COSTS OFF, SUMMARY OFF, TIMING OFF)";
+my $jit_files =
+  "SELECT count(*) FROM pg_ls_tmpdir() WHERE name LIKE 'pgsql_tmp_jit_%'";
+
+# The second execution of a prepared statement reuses the emitted code, and
+# gets the same results even though its executor state lives elsewhere
+my $s1 = $node->background_psql('postgres');
+my $s2 = $node->background_psql('postgres');
+$s1->query_safe("PREPARE q(int) AS $query");
+my $first = $s1->query_safe("$explain EXECUTE q(500)");
+unlike($first, qr/Cached Functions/, 'first execution emits code');
+my $second = $s1->query_safe("$explain EXECUTE q(500)");
+like($second, qr/Cached Functions: [1-9]/, 'second execution uses cache');
+is( $s1->query_safe("EXECUTE q(900)"),
+	$node->safe_psql(
+		'postgres', "SET jit = off; PREPARE q(int) AS $query; EXECUTE q(900)"
+	),
+	'cached code computes the same results');
+
+# With jit_code_cache_shared, code is written to files that another session
+# can load
+$s1->query_safe("SET jit_code_cache_shared = on");
+$s2->query_safe("SET jit_code_cache_shared = on");
+$s1->query_safe("$explain $adhoc");
+isnt($node->safe_psql('postgres', $jit_files), '0', 'shared code written');
+like(
+	$s2->query_safe("$explain $adhoc"),
+	qr/Cached Functions: [1-9]/,
+	'other session uses shared code');
+
+# Each session keeps only jit_code_cache_size files, and removes them when it
+# exits
+for my $i (1 .. 4)
+{
+	$s1->query_safe("$explain SELECT sum(a * $i) FROM jcc_test");
+}
+is($node->safe_psql('postgres', $jit_files),
+	'2', 'files limited by jit_code_cache_size');
+$s1->quit;
+$node->poll_query_until('postgres', "SELECT ($jit_files) = 0")
+  or die "timed out waiting for shared code files to be removed at session exit";
+ok(1, 'files removed at session exit');
+
+$s2->quit;
+
+$node->stop;
+
+done_testing();
@@ -0,0 +1,73 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test expressions compiled by the template based JIT provider
+use strict;
+use warnings FATAL => 'all';
+use Config;
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+jit = on
+jit_provider = 'stenciljit'
+jit_above_cost = 0
+));
+$node->start;
+
+if ($node->safe_psql('postgres', "SELECT pg_jit_available()") ne 't')
+{
+	plan skip_all => 'stenciljit not supported by this build';
+}
+
+# Code is only emitted on x86-64; elsewhere, expressions are interpreted
+my $emits_code = ($Config{archname} =~ /^x86_64/ && !$windows_os);
+
+$node->safe_psql('postgres',
+	"CREATE TABLE sj_test AS
+	   SELECT i AS a, CASE WHEN i % 5 <> 0 THEN i * 2 END AS b,
+			  'row ' || i AS c
+	   FROM generate_series(1, 1000) i"
+);
+
+# Queries whose expressions exercise jumps, NULL handling, function calls and
+# aggregation
+my @queries = (
+	"SELECT count(*), sum(a) FROM sj_test WHERE a % 7 = 3 AND b IS NOT NULL",
+	"SELECT a, CASE WHEN b > 1000 THEN 'big' WHEN b IS NULL THEN 'none' ELSE c END
+	   FROM sj_test WHERE a < 20 OR a > 990 ORDER BY a",
+	"SELECT a % 3, count(b), sum(b) FILTER (WHERE a % 2 = 0),
+			string_agg(c, ',' ORDER BY a) FILTER (WHERE a < 10)
+	   FROM sj_test GROUP BY a % 3 ORDER BY 1",
+	"SELECT coalesce(b, -a) + length(c) FROM sj_test
+	   WHERE a BETWEEN 100 AND 110 ORDER BY a",);
+
+foreach my $query (@queries)
+{
+	is( $node->safe_psql('postgres', $query),
+		$node->safe_psql('postgres', "SET jit = off; $query"),
+		"same results with and without JIT: $query");
+}
+
+SKIP:
+{
+	skip "stenciljit doesn't emit code on this platform", 3
+	  unless $emits_code;
+
+	my $explain = $node->safe_psql('postgres',
+		"EXPLAIN (ANALYZE, COSTS OFF, SUMMARY OFF) $queries[0]");
+	like($explain, qr/JIT:/, 'EXPLAIN reports JIT');
+	like($explain, qr/Functions: [1-9]/, 'expressions were compiled');
+	like(
+		$explain,
+		qr/Timing: Generation [0-9.]+ ms/,
+		'generation time is reported');
+}
+
+$node->stop;
+
+done_testing();
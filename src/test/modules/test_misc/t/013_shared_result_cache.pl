@@ -0,0 +1,118 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test that results shared between sessions are never outdated
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_result_cache = on
+shared_result_cache_size = 8MB
+));
+$node->start;
+
+$node->safe_psql('postgres',
+	"CREATE TABLE src_test (a int, b text); INSERT INTO src_test SELECT i, 'row ' || i FROM generate_series(1, 10) i"
+);
+
+my $query = "SELECT sum(a), max(b) FROM src_test";
+my $s1 = $node->background_psql('postgres');
+my $s2 = $node->background_psql('postgres');
+
+# A result stored by one session is used by another
+is($s1->query_safe($query), '55|row 9', 'first session');
+is($s2->query_safe($query), '55|row 9', 'second session');
+is( $node->safe_psql('postgres',
+		"SELECT stores, hits FROM pg_stat_shared_result_cache"),
+	'1|1',
+	'second session used the stored result');
+
+# Committed writes make the stored result go away
+$s1->query_safe("INSERT INTO src_test VALUES (11, 'row 99')");
+is($s2->query_safe($query), '66|row 99', 'insert is visible');
+is($s1->query_safe($query), '66|row 99', 'new result is shared');
+
+# Results are not shared while a writer is in progress, nor afterwards with
+# snapshots that don't see its changes
+$s1->query_safe("BEGIN; UPDATE src_test SET a = a + 1 WHERE a = 1");
+is($s1->query_safe($query), '67|row 99', 'own update is visible');
+is($s2->query_safe($query), '66|row 99', 'uncommitted update is invisible');
+$s2->query_safe("BEGIN ISOLATION LEVEL REPEATABLE READ");
+is($s2->query_safe($query), '66|row 99', 'snapshot taken before commit');
+$s1->query_safe("COMMIT");
+is($s2->query_safe($query), '66|row 99', 'old snapshot keeps old result');
+$s2->query_safe("COMMIT");
+is($s2->query_safe($query), '67|row 99', 'committed update is visible');
+is($node->safe_psql('postgres', $query),
+	'67|row 99', 'committed update is visible in a new session');
+
+# Writes through partition routing and rolled back writes
+$node->safe_psql('postgres',
+	"CREATE TABLE src_parted (a int) PARTITION BY RANGE (a);
+	 CREATE TABLE src_part1 PARTITION OF src_parted FOR VALUES FROM (0) TO (100);
+	 INSERT INTO src_parted VALUES (1)");
+is($s1->query_safe("SELECT count(*) FROM src_part1"), '1', 'partition');
+$s2->query_safe("INSERT INTO src_parted VALUES (2)");
+is($s1->query_safe("SELECT count(*) FROM src_part1"),
+	'2', 'routed insert is visible');
+$s2->query_safe("BEGIN; DELETE FROM src_part1; ROLLBACK");
+is($s1->query_safe("SELECT count(*) FROM src_part1"),
+	'2', 'rolled back delete is invisible');
+
+# Schema changes invalidate results
+$s1->query_safe("ALTER TABLE src_test RENAME COLUMN b TO c");
+my ($ret, $stdout, $stderr) = $node->psql('postgres', $query);
+isnt($ret, 0, 'renamed column is gone');
+
+# Results are kept apart by role and parameters
+$node->safe_psql('postgres',
+	"CREATE ROLE src_user; GRANT SELECT ON src_test TO src_user;
+	 ALTER TABLE src_test ENABLE ROW LEVEL SECURITY;
+	 CREATE POLICY src_pol ON src_test TO src_user USING (a < 5)");
+is($s1->query_safe("SELECT count(*) FROM src_test"), '11', 'owner');
+is( $s2->query_safe(
+		"SET ROLE src_user; SELECT count(*) FROM src_test; RESET ROLE"),
+	'4',
+	'other role sees only its rows');
+is( $s1->query_safe(
+		"PREPARE q(int) AS SELECT count(*) FROM src_test WHERE a > \$1; EXECUTE q(5)"
+	),
+	'6',
+	'parameter 5');
+is($s1->query_safe("EXECUTE q(8)"), '3', 'parameter 8');
+
+# Serializable transactions run the plan, to take their predicate locks
+my $hits_query = "SELECT hits FROM pg_stat_shared_result_cache";
+$s1->query_safe("SELECT count(*) FROM src_test");
+my $hits = $node->safe_psql('postgres', $hits_query);
+$s2->query_safe("BEGIN ISOLATION LEVEL SERIALIZABLE");
+is($s2->query_safe("SELECT count(*) FROM src_test"),
+	'11', 'serializable transaction');
+is( $s2->query_safe(
+		"SELECT count(*) FROM pg_locks WHERE pid = pg_backend_pid() AND mode = 'SIReadLock' AND relation = 'src_test'::regclass"
+	),
+	'1',
+	'serializable transaction took predicate lock');
+$s2->query_safe("COMMIT");
+is($node->safe_psql('postgres', $hits_query),
+	$hits, 'serializable transaction did not use the stored result');
+
+# Results larger than the maximum entry size are not stored
+$node->safe_psql('postgres', "SELECT pg_stat_reset_shared_result_cache()");
+$s1->query_safe("SET shared_result_cache_max_entry_size = 1");
+$s1->query_safe("SELECT i, repeat('x', 100) FROM src_test, generate_series(1, 100) i");
+is($node->safe_psql('postgres', "SELECT stores FROM pg_stat_shared_result_cache"),
+	'0', 'large result not stored');
+
+$s1->quit;
+$s2->quit;
+
+$node->stop;
+
+done_testing();
@@ -1588,3 +1588,29 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+
+--
+-- Test eager aggregation
+--
+create temp table eager_fact as
+  select i % 10 as k, i as x from generate_series(1, 10000) i;
+create temp table eager_dim as
+  select i as k, 'name ' || i as name from generate_series(0, 99) i;
+analyze eager_fact;
+analyze eager_dim;
+set enable_eager_aggregate = on;
+-- aggregate the fact table by the join key before joining
+explain (costs off)
+select d.name, sum(f.x), count(*)
+  from eager_fact f join eager_dim d on f.k = d.k
+  group by d.name;
+select d.name, sum(f.x), count(*)
+  from eager_fact f join eager_dim d on f.k = d.k
+  group by d.name order by d.name;
+-- not possible when an aggregate reads from both sides of the join
+explain (costs off)
+select d.name, sum(f.x + d.k)
+  from eager_fact f join eager_dim d on f.k = d.k
+  group by d.name;
+reset enable_eager_aggregate;
+drop table eager_fact, eager_dim;
@@ -293,3 +293,35 @@ CREATE TABLE btree_part (id int4) PARTITION BY RANGE (id);
 CREATE INDEX btree_part_idx ON btree_part(id);
 ALTER INDEX btree_part_idx ALTER COLUMN id SET (n_distinct=100);
 DROP TABLE btree_part;
+
+--
+-- Test skip scan, where there are no quals on a leading index column
+--
+CREATE TABLE btree_skip (a int, b int, d text);
+INSERT INTO btree_skip SELECT i % 5, i, 'v' || (i % 3) FROM generate_series(1, 50) i;
+INSERT INTO btree_skip VALUES (NULL, 7, NULL), (NULL, 70, NULL);
+CREATE INDEX btree_skip_idx ON btree_skip (a, b);
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT a, b FROM btree_skip WHERE b = 7 ORDER BY a, b;
+SELECT a, b FROM btree_skip WHERE b IN (7, 20, 33) ORDER BY a DESC, b DESC;
+SELECT a, b FROM btree_skip WHERE b > 45 ORDER BY a, b;
+DROP INDEX btree_skip_idx;
+CREATE INDEX btree_skip_idx ON btree_skip (d, b);
+SELECT d, b FROM btree_skip WHERE b < 4 ORDER BY d, b;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE btree_skip;
+
+-- Skip scan should be chosen on its own merits when the skipped column has
+-- few distinct values
+CREATE TABLE btree_skip (a int, b int, d text);
+INSERT INTO btree_skip SELECT i % 5, i, 'v' || (i % 3) FROM generate_series(1, 10000) i;
+CREATE INDEX btree_skip_idx ON btree_skip (a, b);
+ANALYZE btree_skip;
+SET enable_bitmapscan = off;
+EXPLAIN (COSTS OFF)
+SELECT * FROM btree_skip WHERE b = 7;
+SELECT * FROM btree_skip WHERE b = 7;
+RESET enable_bitmapscan;
+DROP TABLE btree_skip;
@@ -348,3 +348,17 @@ COPY parted_si(id, data) FROM :'filename';
 SELECT tableoid::regclass, id % 2 = 0 is_even, count(*) from parted_si GROUP BY 1, 2 ORDER BY 1;
 
 DROP TABLE parted_si;
+
+-- Test that COPY's batched insertion into btree indexes gives the same index
+-- contents as inserting one tuple at a time.
+CREATE TABLE copy_batch_idx (id int, data text);
+CREATE INDEX copy_batch_idx_id ON copy_batch_idx (id);
+CREATE INDEX copy_batch_idx_data ON copy_batch_idx (data DESC NULLS FIRST);
+COPY copy_batch_idx FROM :'filename';
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(id) FROM copy_batch_idx WHERE id >= 0;
+SELECT count(*) FROM copy_batch_idx WHERE data > '';
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE copy_batch_idx;
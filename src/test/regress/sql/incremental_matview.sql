@@ -0,0 +1,77 @@
+--
+-- Incrementally maintained materialized views
+--
+CREATE TABLE ivm_t (i int, j int);
+INSERT INTO ivm_t VALUES (1, 10), (1, 20), (2, 30);
+CREATE TABLE ivm_u (i int, name text);
+INSERT INTO ivm_u VALUES (1, 'one'), (3, 'three');
+
+-- grouped aggregates
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_agg AS
+  SELECT i, count(*) AS n, sum(j) AS s, avg(j) AS a, min(j) AS lo, max(j) AS hi
+  FROM ivm_t GROUP BY i;
+SELECT relisivm FROM pg_class WHERE oid = 'ivm_agg'::regclass;
+SELECT i, n, s, round(a, 2) AS a, lo, hi FROM ivm_agg ORDER BY i;
+
+INSERT INTO ivm_t VALUES (1, 5), (3, 40);
+SELECT i, n, s, round(a, 2) AS a, lo, hi FROM ivm_agg ORDER BY i;
+
+-- removing the last row of a group removes the group, and removing the
+-- current minimum or maximum finds the next one
+DELETE FROM ivm_t WHERE j = 30;
+UPDATE ivm_t SET j = 25 WHERE j = 20;
+DELETE FROM ivm_t WHERE j = 5;
+SELECT i, n, s, round(a, 2) AS a, lo, hi FROM ivm_agg ORDER BY i;
+
+-- joins keep duplicate rows
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_join AS
+  SELECT u.name, t.j FROM ivm_t t JOIN ivm_u u ON t.i = u.i;
+SELECT name, j FROM ivm_join ORDER BY name, j;
+INSERT INTO ivm_u VALUES (1, 'uno');
+INSERT INTO ivm_t VALUES (1, 10);
+SELECT name, j FROM ivm_join ORDER BY name, j;
+DELETE FROM ivm_t WHERE ctid = (SELECT max(ctid) FROM ivm_t WHERE j = 10);
+DELETE FROM ivm_u WHERE name = 'uno';
+SELECT name, j FROM ivm_join ORDER BY name, j;
+SELECT i, n, s, round(a, 2) AS a, lo, hi FROM ivm_agg ORDER BY i;
+
+-- an aggregate without GROUP BY always has one row
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_total AS
+  SELECT count(*) AS n, sum(j) AS s FROM ivm_t;
+SELECT n, s FROM ivm_total;
+
+-- TRUNCATE recomputes the views
+TRUNCATE ivm_t;
+SELECT n, s IS NULL AS s_null FROM ivm_total;
+SELECT count(*) FROM ivm_join;
+INSERT INTO ivm_t VALUES (2, 7);
+SELECT n, s FROM ivm_total;
+SELECT i, n, s, round(a, 2) AS a, lo, hi FROM ivm_agg ORDER BY i;
+
+-- changes made while the view is not populated are ignored
+REFRESH MATERIALIZED VIEW ivm_total WITH NO DATA;
+INSERT INTO ivm_t VALUES (2, 8);
+REFRESH MATERIALIZED VIEW ivm_total;
+SELECT n, s FROM ivm_total;
+
+-- unsupported queries
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_err AS SELECT DISTINCT i FROM ivm_t;
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_err AS
+  SELECT t.j FROM ivm_t t LEFT JOIN ivm_u u ON t.i = u.i;
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_err AS
+  SELECT a.j FROM ivm_t a, ivm_t b;
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_err AS
+  SELECT string_agg(name, ',') FROM ivm_u;
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_err AS
+  SELECT i AS __ivm_i FROM ivm_t;
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_err AS
+  SELECT random() AS r FROM ivm_t;
+CREATE TABLE ivm_child () INHERITS (ivm_t);
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_err AS SELECT j FROM ivm_t;
+CREATE INCREMENTAL MATERIALIZED VIEW ivm_only AS SELECT j FROM ONLY ivm_t;
+DROP MATERIALIZED VIEW ivm_only;
+
+-- the triggers go away with the views
+DROP MATERIALIZED VIEW ivm_agg, ivm_join, ivm_total;
+SELECT count(*) FROM pg_trigger WHERE tgrelid = 'ivm_t'::regclass;
+DROP TABLE ivm_child, ivm_t, ivm_u;
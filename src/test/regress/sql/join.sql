@@ -386,6 +386,49 @@ select count(*) from tenk1 x where
   x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
 rollback;
 
+-- and with iterative dynamic programming, greedy and not
+begin;
+set geqo = on;
+set geqo_threshold = 2;
+set join_search_method = idp;
+set idp_block_size = 2;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+set idp_block_size = 4;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+-- a join spanning several IDP rounds, whose order is dictated by outer joins
+-- that can't be reassociated
+set idp_block_size = 2;
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+set enable_material = off;
+explain (costs off)
+select i1.f1 as a, i5.f1 as e from int4_tbl i1
+  left join int4_tbl i2 on i2.f1 = i1.f1
+  left join int4_tbl i3 on i3.f1 = coalesce(i2.f1, 0)
+  left join int4_tbl i4 on i4.f1 = coalesce(i3.f1, 0)
+  left join int4_tbl i5 on i5.f1 = coalesce(i4.f1, 0)
+  order by i1.f1;
+select i1.f1 as a, i5.f1 as e from int4_tbl i1
+  left join int4_tbl i2 on i2.f1 = i1.f1
+  left join int4_tbl i3 on i3.f1 = coalesce(i2.f1, 0)
+  left join int4_tbl i4 on i4.f1 = coalesce(i3.f1, 0)
+  left join int4_tbl i5 on i5.f1 = coalesce(i4.f1, 0)
+  order by i1.f1;
+rollback;
+-- same rows as with standard dynamic programming
+select i1.f1 as a, i5.f1 as e from int4_tbl i1
+  left join int4_tbl i2 on i2.f1 = i1.f1
+  left join int4_tbl i3 on i3.f1 = coalesce(i2.f1, 0)
+  left join int4_tbl i4 on i4.f1 = coalesce(i3.f1, 0)
+  left join int4_tbl i5 on i5.f1 = coalesce(i4.f1, 0)
+  order by i1.f1;
+
 --
 -- regression test: be sure we cope with proven-dummy append rels
 --
@@ -2978,3 +3021,41 @@ SELECT t1.a FROM skip_fetch t1 LEFT JOIN skip_fetch t2 ON t2.a = 1 WHERE t2.a IS
 
 RESET enable_indexonlyscan;
 RESET enable_seqscan;
+
+--
+-- Test switching a nested loop to hashing its inner side when the outer
+-- side returns many more rows than estimated
+--
+create function explain_nestloop_switch(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            query)
+    loop
+        if ln ~ 'Nested Loop|Switched' then
+            return next trim(ln);
+        end if;
+    end loop;
+end;
+$$;
+
+begin;
+set local enable_hashjoin = off;
+set local enable_mergejoin = off;
+set local enable_memoize = off;
+set local max_parallel_workers_per_gather = 0;
+set local adaptive_nestloop_threshold = 0.001;
+
+select explain_nestloop_switch('
+select count(*) from tenk1 t left join int4_tbl i on i.f1 = t.unique1');
+select count(*), count(i.f1) from tenk1 t left join int4_tbl i on i.f1 = t.unique1;
+select t.unique1, i.f1 from tenk1 t left join int4_tbl i on i.f1 = t.unique1
+where t.unique1 < 3 order by t.unique1;
+
+rollback;
+
+drop function explain_nestloop_switch(text);
@@ -1338,4 +1338,50 @@ drop table hp_contradict_test;
 drop operator class part_test_int4_ops2 using hash;
 drop operator ===(int4, int4);
 
+
+--
+-- Generic plans lock only the partitions that survive initial pruning
+--
+create table lock_part (a int) partition by list (a);
+create table lock_part1 partition of lock_part for values in (1);
+create table lock_part2 partition of lock_part for values in (2);
+create table lock_part3 partition of lock_part for values in (3);
+set plan_cache_mode = force_generic_plan;
+prepare lock_part_q (int) as select * from lock_part where a = $1;
+execute lock_part_q (1);
+begin;
+execute lock_part_q (2);
+select relation::regclass as rel, mode from pg_locks
+  where pid = pg_backend_pid() and relation::regclass::text like 'lock_part%'
+  order by 1;
+commit;
+deallocate lock_part_q;
+
+-- Should the executor's initial pruning disagree with the plan cache's, only
+-- the partitions that were locked are scanned
+insert into lock_part values (1), (2);
+create function lock_part_flip() returns int language plpgsql stable as
+$$
+declare
+  v int := current_setting('lock_part.flip')::int;
+begin
+  perform set_config('lock_part.flip', (3 - v)::text, false);
+  return v;
+end;
+$$;
+set lock_part.flip = 1;
+prepare lock_part_flip_q as
+  select count(*) from lock_part where a = lock_part_flip();
+execute lock_part_flip_q;
+begin;
+execute lock_part_flip_q;
+select count(*) from pg_locks
+  where pid = pg_backend_pid() and relation::regclass::text ~ '^lock_part\d$';
+commit;
+deallocate lock_part_flip_q;
+drop function lock_part_flip();
+reset lock_part.flip;
+reset plan_cache_mode;
+drop table lock_part;
+
 drop function explain_analyze(text);
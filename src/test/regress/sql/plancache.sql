@@ -2,6 +2,26 @@
 -- Tests to exercise the plan caching/invalidation mechanism
 --
 
+-- A shared generic plan must not be used once a temporary table shadows the
+-- table it was made for.  This has to run before the session has a temporary
+-- schema.
+SET shared_plan_cache = on;
+SET plan_cache_mode = force_generic_plan;
+CREATE TABLE spc_shadow (a text);
+INSERT INTO spc_shadow VALUES ('permanent');
+PREPARE spc_shadow_q1 AS SELECT a FROM spc_shadow;
+EXECUTE spc_shadow_q1;
+CREATE TEMP TABLE spc_shadow (a text);
+INSERT INTO spc_shadow VALUES ('temporary');
+PREPARE spc_shadow_q2 AS SELECT a FROM spc_shadow;
+EXECUTE spc_shadow_q2;
+DEALLOCATE spc_shadow_q1;
+DEALLOCATE spc_shadow_q2;
+DROP TABLE pg_temp.spc_shadow;
+DROP TABLE public.spc_shadow;
+RESET plan_cache_mode;
+RESET shared_plan_cache;
+
 CREATE TEMP TABLE pcachetest AS SELECT * FROM int8_tbl;
 
 -- create and use a cached plan
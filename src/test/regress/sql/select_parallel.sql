@@ -434,6 +434,130 @@ explain (costs off, verbose)
   select count(*) from tenk1 a where (unique1, two) in
     (select unique1, row_number() over() from tenk1 b);
 
+-- Window functions partitioned by hashable keys can run in the workers,
+-- once the rows are redistributed by those keys.
+set enable_parallel_redistribute = on;
+explain (costs off)
+  select ten, unique1, row_number() over (partition by ten order by unique1)
+  from tenk1;
+select count(*) as mismatches from
+  (select unique1, ten,
+          row_number() over (partition by ten order by unique1) as rn
+   from tenk1) s
+  where rn <> (unique1 - ten) / 10 + 1;
+
+-- Likewise, whole groups can be aggregated in the workers, even by
+-- aggregates that don't support partial aggregation.
+explain (costs off)
+  select ten, count(distinct four) from tenk1 group by ten;
+select ten, count(distinct four) from tenk1 group by ten order by ten;
+reset enable_parallel_redistribute;
+
+-- INSERT ... SELECT can insert the rows in the workers, unless the target
+-- table rules it out.
+set enable_parallel_insert = on;
+set parallel_tuple_cost = 0.1;
+create table parallel_insert_target
+  (unique1 int primary key, ten int check (ten >= 0), stringu1 name);
+explain (costs off)
+  insert into parallel_insert_target select unique1, ten, stringu1 from tenk1;
+insert into parallel_insert_target select unique1, ten, stringu1 from tenk1;
+select count(*), count(distinct unique1), sum(ten) from parallel_insert_target;
+create temp table parallel_insert_temp (stringu1 name);
+explain (costs off)
+  insert into parallel_insert_temp select stringu1 from tenk1;
+-- Errors raised in the workers abort the whole INSERT
+set parallel_leader_participation = off;
+\set VERBOSITY terse
+insert into parallel_insert_target select unique1, ten, stringu1 from tenk1;
+\set VERBOSITY default
+reset parallel_leader_participation;
+select count(*) from parallel_insert_target;
+-- Workers inserting into a GIN index share its pending list
+create table parallel_insert_gin (a int[]);
+create index on parallel_insert_gin using gin (a)
+  with (fastupdate = on, gin_pending_list_limit = 64);
+explain (costs off)
+  insert into parallel_insert_gin select array[ten, hundred] from tenk1;
+insert into parallel_insert_gin select array[ten, hundred] from tenk1;
+set enable_seqscan = off;
+select count(*) from parallel_insert_gin where a @> '{3}';
+select count(*) from parallel_insert_gin where a @> '{3,13}';
+reset enable_seqscan;
+-- Workers can also store values out of line in the TOAST table
+create table parallel_insert_toast (a int, b text);
+alter table parallel_insert_toast alter column b set storage external;
+explain (costs off)
+  insert into parallel_insert_toast
+  select unique1, repeat(stringu1, 350) from tenk1 where unique1 < 1000;
+insert into parallel_insert_toast
+  select unique1, repeat(stringu1, 350) from tenk1 where unique1 < 1000;
+select count(*), sum(length(b)),
+       pg_relation_size(reltoastrelid) > 0 as toasted
+  from parallel_insert_toast, pg_class
+  where pg_class.oid = 'parallel_insert_toast'::regclass
+  group by reltoastrelid;
+drop table parallel_insert_target, parallel_insert_temp, parallel_insert_gin,
+  parallel_insert_toast;
+set parallel_tuple_cost = 0;
+reset enable_parallel_insert;
+
+-- An Append can run Gather nodes asynchronously, so that the workers of all
+-- of them run at the same time.  With the Result among the children, the
+-- Append can't be partial, so each child gets a Gather of its own.
+set enable_async_gather = on;
+set enable_parallel_append = off;
+explain (costs off)
+  select count(*), sum(unique1) from
+    ((select unique1 from tenk1 where ten = 1 offset 0)
+     union all
+     (select unique1 from tenk1 where ten = 2 offset 0)
+     union all
+     select 0) u;
+select count(*), sum(unique1) from
+  ((select unique1 from tenk1 where ten = 1 offset 0)
+   union all
+   (select unique1 from tenk1 where ten = 2 offset 0)
+   union all
+   select 0) u;
+-- stopping early shuts down the Gather nodes while their workers still run
+explain (costs off)
+  select unique1 from
+    ((select unique1 from tenk1 where ten = 1 offset 0)
+     union all
+     (select unique1 from tenk1 where ten = 2 offset 0)
+     union all
+     select 0) u
+  limit 10;
+select count(*) from
+  (select unique1 from
+     ((select unique1 from tenk1 where ten = 1 offset 0)
+      union all
+      (select unique1 from tenk1 where ten = 2 offset 0)
+      union all
+      select 0) u
+   limit 10) ss;
+-- A sync Gather Merge among the children waits for its own workers, and
+-- resets our latch while doing so.  The Append mustn't miss that the workers
+-- of the async Gather have sent tuples in the meantime.
+set enable_indexscan = off;
+explain (costs off)
+  select count(*), sum(unique1) from
+    ((select unique1 from tenk1 where ten = 1 offset 0)
+     union all
+     (select unique1 from tenk1 where ten = 2 order by unique1 offset 0)
+     union all
+     select 0) u;
+select count(*), sum(unique1) from
+  ((select unique1 from tenk1 where ten = 1 offset 0)
+   union all
+   (select unique1 from tenk1 where ten = 2 order by unique1 offset 0)
+   union all
+   select 0) u;
+reset enable_indexscan;
+reset enable_parallel_append;
+reset enable_async_gather;
+
 
 -- LIMIT/OFFSET within sub-selects can't be pushed to workers.
 explain (costs off)
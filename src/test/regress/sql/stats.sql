@@ -458,6 +458,31 @@ SELECT pg_stat_reset_slru();
 SELECT stats_reset > :'slru_commit_ts_reset_ts'::timestamptz FROM pg_stat_slru WHERE name = 'commit_timestamp';
 SELECT stats_reset > :'slru_notify_reset_ts'::timestamptz FROM pg_stat_slru WHERE name = 'notify';
 
+-- Test that commit status lookups of tuples without hint bits use the
+-- committed XID range cache, and that resetting the SLRU resets its counters
+CREATE TABLE test_xid_cache (a int) WITH (autovacuum_enabled = off);
+DO $$
+BEGIN
+  FOR i IN 1..100 LOOP
+    INSERT INTO test_xid_cache VALUES (i);
+    COMMIT;
+  END LOOP;
+END
+$$;
+SELECT pg_stat_force_next_flush();
+SELECT xid_cache_hits AS xid_cache_hits_before, xid_cache_misses AS xid_cache_misses_before
+  FROM pg_stat_slru WHERE name = 'transaction' \gset
+SELECT count(*) FROM test_xid_cache;
+SELECT pg_stat_force_next_flush();
+SELECT xid_cache_hits > :xid_cache_hits_before, xid_cache_misses > :xid_cache_misses_before
+  FROM pg_stat_slru WHERE name = 'transaction';
+SELECT xid_cache_hits + xid_cache_misses AS xid_cache_lookups
+  FROM pg_stat_slru WHERE name = 'transaction' \gset
+SELECT pg_stat_reset_slru('transaction');
+SELECT xid_cache_hits + xid_cache_misses < :xid_cache_lookups
+  FROM pg_stat_slru WHERE name = 'transaction';
+DROP TABLE test_xid_cache;
+
 -- Test that reset_shared with archiver specified as the stats type works
 SELECT stats_reset AS archiver_reset_ts FROM pg_stat_archiver \gset
 SELECT pg_stat_reset_shared('archiver');
@@ -1547,6 +1547,65 @@ SELECT c0 FROM ONLY expr_stats_incompatible_test WHERE
 
 DROP TABLE expr_stats_incompatible_test;
 
+-- statistics on a foreign key join
+CREATE TABLE fkjoin_dim (id int PRIMARY KEY, category text)
+  WITH (autovacuum_enabled = off);
+CREATE TABLE fkjoin_fact (id int, dim_id int REFERENCES fkjoin_dim)
+  WITH (autovacuum_enabled = off);
+
+-- 10 'hot' rows, referenced by 90% of the facts
+INSERT INTO fkjoin_dim SELECT i, CASE WHEN i <= 10 THEN 'hot' ELSE 'cold' END
+  FROM generate_series(1, 1000) s(i);
+INSERT INTO fkjoin_fact SELECT i, CASE WHEN i % 10 = 0 THEN 11 + i % 990 ELSE 1 + i % 10 END
+  FROM generate_series(1, 10000) s(i);
+ANALYZE fkjoin_dim, fkjoin_fact;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM fkjoin_fact f JOIN fkjoin_dim d ON f.dim_id = d.id WHERE d.category = ''hot''');
+SELECT * FROM check_estimated_rows('SELECT * FROM fkjoin_fact f JOIN fkjoin_dim d ON f.dim_id = d.id WHERE d.category = ''cold''');
+
+-- invalid definitions
+CREATE STATISTICS fkjoin_stats ON category FROM fkjoin_fact LEFT JOIN fkjoin_dim ON fkjoin_fact.dim_id = fkjoin_dim.id;
+CREATE STATISTICS fkjoin_stats ON category FROM fkjoin_fact JOIN fkjoin_dim ON fkjoin_fact.id = fkjoin_dim.id;
+CREATE STATISTICS fkjoin_stats ON (lower(category)) FROM fkjoin_fact JOIN fkjoin_dim ON fkjoin_fact.dim_id = fkjoin_dim.id;
+CREATE STATISTICS fkjoin_stats ON (fkjoin_fact.id) FROM fkjoin_fact JOIN fkjoin_dim ON fkjoin_fact.dim_id = fkjoin_dim.id;
+CREATE STATISTICS fkjoin_stats (ndistinct) ON category FROM fkjoin_fact JOIN fkjoin_dim ON fkjoin_fact.dim_id = fkjoin_dim.id;
+
+CREATE STATISTICS fkjoin_stats ON category FROM fkjoin_dim JOIN fkjoin_fact ON fkjoin_dim.id = fkjoin_fact.dim_id;
+SELECT pg_get_statisticsobjdef(oid) FROM pg_statistic_ext WHERE stxname = 'fkjoin_stats';
+ANALYZE fkjoin_fact;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM fkjoin_fact f JOIN fkjoin_dim d ON f.dim_id = d.id WHERE d.category = ''hot''');
+SELECT * FROM check_estimated_rows('SELECT * FROM fkjoin_fact f JOIN fkjoin_dim d ON f.dim_id = d.id WHERE d.category = ''cold''');
+
+-- the statistics are used, and shown in pg_stats_ext, only if the user can
+-- read both tables and isn't subject to row-level security on the
+-- referencing one
+CREATE ROLE regress_fkjoin_user;
+ALTER TABLE fkjoin_dim OWNER TO regress_fkjoin_user;
+GRANT SELECT ON fkjoin_fact TO regress_fkjoin_user;
+ALTER TABLE fkjoin_fact ENABLE ROW LEVEL SECURITY;
+CREATE POLICY fkjoin_policy ON fkjoin_fact USING (true);
+SET ROLE regress_fkjoin_user;
+SELECT count(*) FROM pg_stats_ext WHERE statistics_name = 'fkjoin_stats';
+SELECT * FROM check_estimated_rows('SELECT * FROM fkjoin_fact f JOIN fkjoin_dim d ON f.dim_id = d.id WHERE d.category = ''hot''');
+RESET ROLE;
+ALTER TABLE fkjoin_fact DISABLE ROW LEVEL SECURITY;
+SET ROLE regress_fkjoin_user;
+SELECT count(*) FROM pg_stats_ext WHERE statistics_name = 'fkjoin_stats';
+SELECT * FROM check_estimated_rows('SELECT * FROM fkjoin_fact f JOIN fkjoin_dim d ON f.dim_id = d.id WHERE d.category = ''hot''');
+RESET ROLE;
+REVOKE SELECT ON fkjoin_fact FROM regress_fkjoin_user;
+SET ROLE regress_fkjoin_user;
+SELECT count(*) FROM pg_stats_ext WHERE statistics_name = 'fkjoin_stats';
+RESET ROLE;
+
+-- the statistics go away with the foreign key
+ALTER TABLE fkjoin_fact DROP CONSTRAINT fkjoin_fact_dim_id_fkey;
+SELECT count(*) FROM pg_statistic_ext WHERE stxname = 'fkjoin_stats';
+
+DROP TABLE fkjoin_fact, fkjoin_dim;
+DROP ROLE regress_fkjoin_user;
+
 -- Permission tests. Users should not be able to see specific data values in
 -- the extended statistics, if they lack permission to see those values in
 -- the underlying table.
@@ -136,6 +136,18 @@ CREATE INDEX tmp_idx1 ON tmp (a);
 VACUUM (PARALLEL 1, FULL FALSE) tmp; -- parallel vacuum disabled for temp tables
 VACUUM (PARALLEL 0, FULL TRUE) tmp; -- can specify parallel disabled (even though that's implied by FULL)
 RESET min_parallel_index_scan_size;
+-- ANALYZE can use parallel workers too
+ANALYZE (PARALLEL 2) pvactst;
+ANALYZE (PARALLEL 0) pvactst; -- disable parallel analyze
+ANALYZE (PARALLEL -1) pvactst; -- error
+CREATE TABLE pvacparted (a int, b text) PARTITION BY LIST (a);
+CREATE TABLE pvacparted1 PARTITION OF pvacparted FOR VALUES IN (1);
+CREATE TABLE pvacparted2 PARTITION OF pvacparted FOR VALUES IN (2);
+INSERT INTO pvacparted SELECT i % 2 + 1, i::text FROM generate_series(1, 1000) i;
+ANALYZE (PARALLEL 2) pvacparted;
+SELECT tablename, attname, null_frac, n_distinct FROM pg_stats
+  WHERE tablename = 'pvacparted' ORDER BY attname;
+DROP TABLE pvacparted;
 DROP TABLE pvactst;
 
 -- INDEX_CLEANUP option
@@ -0,0 +1,135 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test applying non-streamed transactions using parallel apply workers
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+# Create publisher node
+my $node_publisher = PostgreSQL::Test::Cluster->new('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = PostgreSQL::Test::Cluster->new('subscriber');
+$node_subscriber->init;
+$node_subscriber->append_conf(
+	'postgresql.conf', qq(
+parallel_apply_non_streamed = on
+max_parallel_apply_workers_per_subscription = 4
+log_min_messages = debug1
+));
+$node_subscriber->start;
+
+# tab_key can be applied in parallel, tab_numeric can't as equal numeric
+# values may be sent with different text representations.
+my $ddl = qq(
+	CREATE TABLE tab_key (a int PRIMARY KEY, b text);
+	CREATE TABLE tab_numeric (a numeric PRIMARY KEY, b int););
+$node_publisher->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('postgres', $ddl);
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+my $appname = 'tap_sub';
+
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab_key, tab_numeric");
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub WITH (streaming = parallel)"
+);
+
+$node_subscriber->wait_for_subscription_sync($node_publisher, $appname);
+
+my $offset = -s $node_subscriber->logfile;
+
+# Many small transactions, some of which change rows changed by earlier ones.
+$node_publisher->safe_psql(
+	'postgres', q{
+	DO $$
+	BEGIN
+		FOR i IN 1..500 LOOP
+			INSERT INTO tab_key VALUES (i, 'insert ' || i);
+			COMMIT;
+			IF i % 10 = 0 THEN
+				UPDATE tab_key SET b = 'update ' || a WHERE a > i - 10 AND a <= i;
+				DELETE FROM tab_key WHERE a = i - 5;
+				COMMIT;
+			END IF;
+		END LOOP;
+	END
+	$$;
+	UPDATE tab_key SET a = a + 1000 WHERE a % 7 = 0;
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+$node_subscriber->wait_for_log(
+	qr/DEBUG: ( [A-Z0-9]+:)? dispatched remote transaction \d+ to logical replication parallel apply worker/,
+	$offset);
+
+my $expected = $node_publisher->safe_psql('postgres',
+	"SELECT count(*), sum(a), md5(string_agg(b, ',' ORDER BY a)) FROM tab_key"
+);
+my $result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), sum(a), md5(string_agg(b, ',' ORDER BY a)) FROM tab_key"
+);
+is($result, $expected,
+	'non-streamed transactions applied by parallel apply workers');
+
+# Transactions changing a table that is not safe for parallel apply are
+# applied by the leader apply worker.
+$node_publisher->safe_psql(
+	'postgres', q{
+	DO $$
+	BEGIN
+		FOR i IN 1..100 LOOP
+			INSERT INTO tab_numeric VALUES (i, i);
+			COMMIT;
+			UPDATE tab_numeric SET b = b + 1 WHERE a = i::numeric(10,2);
+			INSERT INTO tab_key VALUES (i + 2000, 'mixed');
+			COMMIT;
+		END LOOP;
+	END
+	$$;
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), sum(b) FROM tab_numeric");
+is($result, qq(100|5150), 'transactions on unsafe table applied');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) FROM tab_key WHERE b = 'mixed'");
+is($result, qq(100), 'mixed transactions applied');
+
+# Changes to the schema are seen by workers that have already been used.
+$node_publisher->safe_psql('postgres',
+	"ALTER TABLE tab_key ADD COLUMN c int DEFAULT 1");
+$node_subscriber->safe_psql('postgres',
+	"ALTER TABLE tab_key ADD COLUMN c int DEFAULT 0");
+$node_publisher->safe_psql(
+	'postgres', q{
+	DO $$
+	BEGIN
+		FOR i IN 1..50 LOOP
+			UPDATE tab_key SET c = i WHERE a = i + 2000;
+			COMMIT;
+		END LOOP;
+	END
+	$$;
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), sum(c) FROM tab_key WHERE a > 2000");
+is($result, qq(100|1275), 'changes after schema change applied');
+
+$node_subscriber->stop;
+$node_publisher->stop;
+
+done_testing();